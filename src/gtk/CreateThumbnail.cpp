@@ -20,6 +20,10 @@ using LibRomData::RomDataFactory;
 // so we have to #include the .cpp file here.
 #include "libromdata/img/TCreateThumbnail.cpp"
 using LibRomData::TCreateThumbnail;
+using LibRomData::CacheManager;
+
+// C includes. (C++ namespace)
+#include <cerrno>
 
 // C++ STL classes.
 using std::string;
@@ -335,7 +339,6 @@ G_MODULE_EXPORT int rp_create_thumbnail(const char *source_file, const char *out
 	}
 
 	// Create the thumbnail.
-	// TODO: If image is larger than maximum_size, resize down.
 	unique_ptr<CreateThumbnailPrivate> d(new CreateThumbnailPrivate());
 	CreateThumbnailPrivate::GetThumbnailOutParams_t outParams;
 	ret = d->getThumbnail(romData, maximum_size, &outParams);
@@ -373,6 +376,11 @@ G_MODULE_EXPORT int rp_create_thumbnail(const char *source_file, const char *out
 		goto cleanup;
 	}
 
+	// Thumbnails are encoded often and decoded rarely,
+	// so the fast profile is used by default.
+	pngWriter->setProfile(static_cast<RpPngWriter::Profile>(
+		Config::instance()->thumbnailPngProfile()));
+
 	/** tEXt chunks. **/
 	// NOTE: These are written before IHDR in order to put the
 	// tEXt chunks before the IDAT chunk.
@@ -499,3 +507,35 @@ cleanup:
 	romData->unref();
 	return ret;
 }
+
+/**
+ * External image download statistics for wrapper programs.
+ * Statistics are combined for all request types.
+ * Only downloads that ran rp-download are counted.
+ * @param buckets	[out] Latency histogram. Bucket i counts downloads that took less than (1 << i) ms.
+ * @param bucket_count	[in] Number of buckets. (must be 16)
+ * @param count		[out] Number of downloads.
+ * @param failed	[out] Number of downloads where no file was downloaded.
+ * @param total_ms	[out] Total time, in milliseconds.
+ * @param max_ms	[out] Slowest download, in milliseconds.
+ * @return 0 on success; non-zero on error.
+ */
+extern "C"
+G_MODULE_EXPORT int rp_get_download_stats(uint32_t *buckets, unsigned int bucket_count,
+	uint32_t *count, uint32_t *failed, uint64_t *total_ms, uint32_t *max_ms)
+{
+	if (!buckets || bucket_count != CacheManager::LatencyHistogram::BUCKET_COUNT ||
+	    !count || !failed || !total_ms || !max_ms)
+	{
+		return -EINVAL;
+	}
+
+	CacheManager::LatencyHistogram hist;
+	CacheManager::getTotalLatencyHistogram(&hist);
+	memcpy(buckets, hist.buckets, sizeof(hist.buckets));
+	*count = hist.count;
+	*failed = hist.failed;
+	*total_ms = hist.total_ms;
+	*max_ms = hist.max_ms;
+	return 0;
+}
@@ -49,6 +49,9 @@ static inline GtkWidget *gtk_tree_view_column_get_button(GtkTreeViewColumn *tree
 # endif
 }
 #endif /* !GTK_CHECK_VERSION(3,0,0) */
+#if !GTK_CHECK_VERSION(2,20,0)
+# define gtk_widget_get_mapped(widget) GTK_WIDGET_MAPPED(widget)
+#endif /* !GTK_CHECK_VERSION(2,20,0) */
 
 
 // References:
@@ -80,7 +83,9 @@ static void	rom_data_view_desc_format_type_changed(RpDescFormatType desc_format_
 						 RomDataView	*page);
 
 static void	rom_data_view_init_header_row	(RomDataView	*page);
-static void	rom_data_view_update_display	(RomDataView	*page);
+static void	rom_data_view_init_header_images(RomDataView	*page);
+static void	rom_data_view_update_display	(RomDataView	*page,
+						 const RomFields *pFields);
 static gboolean	rom_data_view_load_rom_data	(gpointer	 data);
 static void	rom_data_view_delete_tabs	(RomDataView	*page);
 
@@ -136,6 +141,11 @@ struct _RomDataView {
 	/* Timeouts */
 	guint		changed_idle;
 
+	// Background loader serial number.
+	// Incremented when the URI changes or the page is disposed,
+	// which causes results from older loads to be discarded.
+	guint		load_serial;
+
 	// Header row.
 	GtkWidget	*hboxHeaderRow_outer;
 	GtkWidget	*hboxHeaderRow;
@@ -298,6 +308,7 @@ static void
 rom_data_view_init(RomDataView *page)
 {
 	// No ROM data initially.
+	page->load_serial = 0;
 	page->uri = nullptr;
 	page->romData = nullptr;
 	page->tabWidget = nullptr;
@@ -393,6 +404,9 @@ rom_data_view_dispose(GObject *object)
 		page->changed_idle = 0;
 	}
 
+	// Discard results from the background loader, if it's running.
+	page->load_serial++;
+
 	// Delete the icon frames and tabs.
 	rom_data_view_delete_tabs(page);
 
@@ -431,6 +445,29 @@ rom_data_view_new(void)
 	return static_cast<GtkWidget*>(g_object_new(TYPE_ROM_DATA_VIEW, nullptr));
 }
 
+/**
+ * rom_data_view_new_with_romData:
+ * @uri : a URI.
+ * @romData : a RomData object that was already created for @uri.
+ * @desc_format_type : the description label format type.
+ *
+ * Creates a RomDataView that displays an existing RomData object.
+ * This is used by the property page providers, which have to create
+ * a RomData object in order to determine if the file is supported.
+ * The RomData object is ref()'d, so the file doesn't need to be
+ * opened and parsed a second time.
+ *
+ * Return value: a new RomDataView.
+ **/
+GtkWidget*
+rom_data_view_new_with_romData(const gchar *uri, RomData *romData, RpDescFormatType desc_format_type)
+{
+	RomDataView *const page = static_cast<RomDataView*>(g_object_new(TYPE_ROM_DATA_VIEW, nullptr));
+	rom_data_view_set_desc_format_type(page, desc_format_type);
+	rom_data_view_set_uri_with_romData(page, uri, romData);
+	return GTK_WIDGET(page);
+}
+
 static void
 rom_data_view_get_property(GObject	*object,
 			   guint	 prop_id,
@@ -503,8 +540,27 @@ rom_data_view_get_uri(RomDataView *page)
 void
 rom_data_view_set_uri(RomDataView	*page,
 		      const gchar	*uri)
+{
+	rom_data_view_set_uri_with_romData(page, uri, nullptr);
+}
+
+/**
+ * rom_data_view_set_uri_with_romData:
+ * @page : a #RomDataView.
+ * @uri : a URI.
+ * @romData : a RomData object that was already created for @uri, or nullptr.
+ *
+ * Sets the URI for this @page.
+ * If @romData is specified, it will be ref()'d and displayed
+ * instead of opening the file again.
+ **/
+void
+rom_data_view_set_uri_with_romData(RomDataView	*page,
+				   const gchar	*uri,
+				   RomData	*romData)
 {
 	g_return_if_fail(IS_ROM_DATA_VIEW(page));
+	g_return_if_fail(uri != nullptr || romData == nullptr);
 
 	/* Check if we already use this file */
 	if (G_UNLIKELY(!g_strcmp0(page->uri, uri)))
@@ -515,6 +571,9 @@ rom_data_view_set_uri(RomDataView	*page,
 		g_free(page->uri);
 		page->uri = nullptr;
 
+		// Discard results from the background loader, if it's running.
+		page->load_serial++;
+
 		// Unreference the existing RomData object.
 		if (page->romData) {
 			page->romData->unref();
@@ -527,6 +586,10 @@ rom_data_view_set_uri(RomDataView	*page,
 
 	/* Assign the value */
 	page->uri = g_strdup(uri);
+	if (romData) {
+		// RomData object was created by the caller.
+		page->romData = romData->ref();
+	}
 
 	/* Connect to the new file (if any) */
 	if (G_LIKELY(page->uri != nullptr)) {
@@ -628,11 +691,35 @@ rom_data_view_init_header_row(RomDataView *page)
 		C_("RomDataView", "%1$s\n%2$s"), systemName, fileType);
 	gtk_label_set_text(GTK_LABEL(page->lblSysInfo), sysInfo.c_str());
 
+	// Banner and icon are loaded by the background loader.
+	// See rom_data_view_init_header_images().
+	gtk_widget_hide(page->imgBanner);
+	gtk_widget_hide(page->imgIcon);
+
+	// Show the header row. (outer box)
+	gtk_widget_show(page->hboxHeaderRow_outer);
+}
+
+/**
+ * Initialize the banner and icon in the header row.
+ * The images must have already been loaded by the
+ * background loader, so this doesn't access the file.
+ * @param page RomDataView.
+ */
+static void
+rom_data_view_init_header_images(RomDataView *page)
+{
+	assert(page != nullptr);
+	const RomData *const romData = page->romData;
+	if (!romData) {
+		// No ROM data.
+		return;
+	}
+
 	// Supported image types.
 	const uint32_t imgbf = romData->supportedImageTypes();
 
 	// Banner.
-	gtk_widget_hide(page->imgBanner);
 	if (imgbf & RomData::IMGBF_INT_BANNER) {
 		// Get the banner.
 		bool ok = drag_image_set_rp_image(DRAG_IMAGE(page->imgBanner), romData->image(RomData::IMG_INT_BANNER));
@@ -642,7 +729,6 @@ rom_data_view_init_header_row(RomDataView *page)
 	}
 
 	// Icon.
-	gtk_widget_hide(page->imgIcon);
 	if (imgbf & RomData::IMGBF_INT_ICON) {
 		// Get the icon.
 		const rp_image *const icon = romData->image(RomData::IMG_INT_ICON);
@@ -656,12 +742,14 @@ rom_data_view_init_header_row(RomDataView *page)
 			}
 			if (ok) {
 				gtk_widget_show(page->imgIcon);
+				if (gtk_widget_get_mapped(GTK_WIDGET(page))) {
+					// The page was mapped before the icon was loaded,
+					// so the "map" signal handler didn't start the timer.
+					drag_image_start_anim_timer(DRAG_IMAGE(page->imgIcon));
+				}
 			}
 		}
 	}
-
-	// Show the header row. (outer box)
-	gtk_widget_show(page->hboxHeaderRow_outer);
 }
 
 #if GTK_CHECK_VERSION(3,0,0)
@@ -1478,8 +1566,13 @@ rom_data_view_update_multi(RomDataView *page, uint32_t user_lc)
 	}
 }
 
+/**
+ * Update the display widgets.
+ * @param page RomDataView
+ * @param pFields Fields from page->romData, loaded by the worker thread.
+ */
 static void
-rom_data_view_update_display(RomDataView *page)
+rom_data_view_update_display(RomDataView *page, const RomFields *pFields)
 {
 	assert(page != nullptr);
 
@@ -1494,8 +1587,8 @@ rom_data_view_update_display(RomDataView *page)
 		return;
 	}
 
-	// Get the fields.
-	const RomFields *const pFields = page->romData->fields();
+	// NOTE: Don't call page->romData->fields() here, since
+	// the worker thread may still be loading images.
 	assert(pFields != nullptr);
 	if (!pFields) {
 		// No fields.
@@ -1781,53 +1874,225 @@ rom_data_view_update_display(RomDataView *page)
 	}
 }
 
-static gboolean
-rom_data_view_load_rom_data(gpointer data)
+/** Background loader **/
+
+/**
+ * Background load request.
+ * The RomData object is created and its fields and images
+ * are loaded on a worker thread. The results are published
+ * to the UI thread in two stages using idle callbacks:
+ * - Stage 1: Header row text and fields.
+ * - Stage 2: Banner and icon.
+ *
+ * NOTE: Idle sources with the same priority are dispatched
+ * in the order they were added, so stage 2 always runs after
+ * stage 1. Stage 2 frees the request.
+ */
+struct RomDataViewLoadReq {
+	RomDataView *page;	// ref()'d
+	guint serial;		// page->load_serial when the request was created
+	gchar *uri;
+	RomData *romData;	// ref()'d; nullptr if not created yet
+	const RomFields *fields;	// Set by the worker thread; owned by romData
+	gint64 start_time;	// Monotonic time, in microseconds.
+};
+
+// Worker thread pool for the background loader.
+// NOTE: Threads are started on demand.
+static GThreadPool *load_thread_pool = nullptr;
+static const gint LOAD_THREAD_POOL_MAX_THREADS = 2;
+
+/**
+ * Get the current monotonic time.
+ * @return Monotonic time, in microseconds.
+ */
+static inline gint64
+rom_data_view_get_time(void)
 {
-	RomDataView *page = ROM_DATA_VIEW(data);
-	g_return_val_if_fail(page != nullptr || IS_ROM_DATA_VIEW(page), false);
-	g_return_val_if_fail(page->uri != nullptr, false);
+#if GLIB_CHECK_VERSION(2,28,0)
+	return g_get_monotonic_time();
+#else /* !GLIB_CHECK_VERSION(2,28,0) */
+	GTimeVal tv;
+	g_get_current_time(&tv);
+	return ((gint64)tv.tv_sec * G_USEC_PER_SEC) + tv.tv_usec;
+#endif /* GLIB_CHECK_VERSION(2,28,0) */
+}
 
-	if (G_UNLIKELY(page->uri == nullptr)) {
-		// No URI.
-		page->changed_idle = 0;
+/**
+ * Background loader, stage 1: Header row text and fields. (UI thread)
+ * @param data RomDataViewLoadReq
+ * @return False to remove the idle source.
+ */
+static gboolean
+rom_data_view_load_fields_idle(gpointer data)
+{
+	const RomDataViewLoadReq *const req = static_cast<const RomDataViewLoadReq*>(data);
+	RomDataView *const page = req->page;
+	if (req->serial != page->load_serial) {
+		// The URI was changed or the page was disposed.
 		return false;
 	}
 
-	// Check if the URI maps to a local file.
-	IRpFile *file = nullptr;
-	gchar *const filename = g_filename_from_uri(page->uri, nullptr, nullptr);
-	if (filename) {
-		// Local file. Use RpFile.
-		file = new RpFile(filename, RpFile::FM_OPEN_READ_GZ);
-		g_free(filename);
-	} else {
-		// Not a local file. Use RpFileGio.
-		file = new RpFileGio(page->uri);
+	if (!page->romData && req->romData) {
+		page->romData = req->romData->ref();
 	}
 
-	if (file->isOpen()) {
-		// Create the RomData object.
-		// file is ref()'d by RomData.
-		page->romData = RomDataFactory::create(file);
+	// Update the display widgets.
+	// NOTE: The fields were already loaded by the worker thread,
+	// so this only creates widgets.
+	rom_data_view_update_display(page, req->fields);
 
-		// Update the display widgets.
-		rom_data_view_update_display(page);
+	g_debug("RomDataView: %s: fields displayed after %" G_GINT64_FORMAT " us",
+		req->uri, rom_data_view_get_time() - req->start_time);
+	return false;
+}
 
-		// Make sure the underlying file handle is closed,
-		// since we don't need it once the RomData has been
-		// loaded by RomDataView.
-		if (page->romData) {
-			page->romData->close();
+/**
+ * Background loader, stage 2: Banner and icon. (UI thread)
+ * This also frees the load request.
+ * @param data RomDataViewLoadReq
+ * @return False to remove the idle source.
+ */
+static gboolean
+rom_data_view_load_images_idle(gpointer data)
+{
+	RomDataViewLoadReq *const req = static_cast<RomDataViewLoadReq*>(data);
+	RomDataView *const page = req->page;
+	if (req->serial == page->load_serial) {
+		// Images were already loaded by the worker thread.
+		// Animation timer will be started when the page
+		// receives the "map" signal, or immediately if the
+		// page is already mapped.
+		rom_data_view_init_header_images(page);
+
+		g_debug("RomDataView: %s: images displayed after %" G_GINT64_FORMAT " us",
+			req->uri, rom_data_view_get_time() - req->start_time);
+	}
+
+	// Free the load request.
+	if (req->romData) {
+		req->romData->unref();
+	}
+	g_free(req->uri);
+	g_object_unref(page);
+	delete req;
+	return false;
+}
+
+/**
+ * Background loader. (worker thread)
+ *
+ * This does all of the file I/O and parsing, so the UI thread
+ * is only used to create widgets. The UI thread doesn't access
+ * the RomData object until stage 1, and afterwards, it only reads
+ * the header information and the fields pointer that was saved in
+ * the load request, which aren't modified by image loading.
+ *
+ * @param data RomDataViewLoadReq
+ * @param user_data (unused)
+ */
+static void
+rom_data_view_load_thread(gpointer data, gpointer user_data)
+{
+	RP_UNUSED(user_data);
+	RomDataViewLoadReq *const req = static_cast<RomDataViewLoadReq*>(data);
+
+	if (!req->romData) {
+		// Check if the URI maps to a local file.
+		IRpFile *file = nullptr;
+		gchar *const filename = g_filename_from_uri(req->uri, nullptr, nullptr);
+		if (filename) {
+			// Local file. Use RpFile.
+			file = new RpFile(filename, RpFile::FM_OPEN_READ_GZ);
+			g_free(filename);
+		} else {
+			// Not a local file. Use RpFileGio.
+			file = new RpFileGio(req->uri);
+		}
+
+		if (file->isOpen()) {
+			// Create the RomData object.
+			// file is ref()'d by RomData.
+			req->romData = RomDataFactory::create(file);
 		}
+		file->unref();
 	}
-	file->unref();
 
-	// Animation timer will be started when the page
-	// receives the "map" signal.
+	RomData *const romData = req->romData;
+	if (romData) {
+		// Load the fields.
+		req->fields = romData->fields();
+	}
+
+	// Stage 1: Header row text and fields.
+	g_idle_add(rom_data_view_load_fields_idle, req);
+	if (!romData) {
+		// Nothing else to load.
+		g_idle_add(rom_data_view_load_images_idle, req);
+		return;
+	}
+
+	// Load the images. RomData caches these, so the
+	// UI thread doesn't have to access the file.
+	const uint32_t imgbf = romData->supportedImageTypes();
+	if (imgbf & RomData::IMGBF_INT_BANNER) {
+		romData->image(RomData::IMG_INT_BANNER);
+	}
+	if (imgbf & RomData::IMGBF_INT_ICON) {
+		const rp_image *const icon = romData->image(RomData::IMG_INT_ICON);
+		if (icon && icon->isValid()) {
+			romData->iconAnimData();
+		}
+	}
+
+	// Make sure the underlying file handle is closed,
+	// since we don't need it once the RomData has been
+	// loaded by RomDataView.
+	romData->close();
+
+	// Stage 2: Banner and icon.
+	g_idle_add(rom_data_view_load_images_idle, req);
+}
+
+static gboolean
+rom_data_view_load_rom_data(gpointer data)
+{
+	RomDataView *page = ROM_DATA_VIEW(data);
+	g_return_val_if_fail(page != nullptr || IS_ROM_DATA_VIEW(page), false);
+	g_return_val_if_fail(page->uri != nullptr, false);
 
 	// Clear the timeout.
 	page->changed_idle = 0;
+
+	if (G_UNLIKELY(page->uri == nullptr)) {
+		// No URI.
+		return false;
+	}
+
+	if (G_UNLIKELY(!load_thread_pool)) {
+		// Create the worker thread pool.
+		GError *error = nullptr;
+		load_thread_pool = g_thread_pool_new(rom_data_view_load_thread,
+			nullptr, LOAD_THREAD_POOL_MAX_THREADS, false, &error);
+		if (error) {
+			g_critical("Error creating the RomDataView worker thread pool: %s", error->message);
+			g_clear_error(&error);
+			load_thread_pool = nullptr;
+			return false;
+		}
+	}
+
+	// Load the ROM data on a worker thread.
+	// If the RomData object was provided by rom_data_view_set_uri_with_romData(),
+	// the worker thread will load its fields and images.
+	RomDataViewLoadReq *const req = new RomDataViewLoadReq;
+	req->page = static_cast<RomDataView*>(g_object_ref(page));
+	req->serial = page->load_serial;
+	req->uri = g_strdup(page->uri);
+	req->romData = (page->romData ? page->romData->ref() : nullptr);
+	req->fields = nullptr;
+	req->start_time = rom_data_view_get_time();
+	g_thread_pool_push(load_thread_pool, req, nullptr);
 	return false;
 }
 
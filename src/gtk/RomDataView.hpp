@@ -11,6 +11,12 @@
 
 #include <gtk/gtk.h>
 
+#ifdef __cplusplus
+namespace LibRpBase {
+	class RomData;
+}
+#endif /* __cplusplus */
+
 G_BEGIN_DECLS
 
 typedef struct _RomDataViewClass	RomDataViewClass;
@@ -41,6 +47,15 @@ const gchar	*rom_data_view_get_uri		(RomDataView	*page) G_GNUC_INTERNAL;
 void		rom_data_view_set_uri		(RomDataView	*page,
 						 const gchar	*uri) G_GNUC_INTERNAL;
 
+#ifdef __cplusplus
+GtkWidget	*rom_data_view_new_with_romData	(const gchar	*uri,
+						 LibRpBase::RomData *romData,
+						 RpDescFormatType desc_format_type) G_GNUC_INTERNAL G_GNUC_MALLOC;
+void		rom_data_view_set_uri_with_romData(RomDataView	*page,
+						 const gchar	*uri,
+						 LibRpBase::RomData *romData) G_GNUC_INTERNAL;
+#endif /* __cplusplus */
+
 RpDescFormatType rom_data_view_get_desc_format_type(RomDataView *page) G_GNUC_INTERNAL;
 void		rom_data_view_set_desc_format_type(RomDataView *page, RpDescFormatType desc_format_type);
 
@@ -45,7 +45,7 @@ static void   rom_properties_provider_page_provider_init	(NautilusPropertyPagePr
 static GList *rom_properties_provider_get_pages			(NautilusPropertyPageProvider		*provider,
 								 GList					*files);
 
-static gboolean rom_properties_get_file_supported		(NautilusFileInfo *info);
+static RomData *rom_properties_open_romData			(NautilusFileInfo *info);
 
 struct _RomPropertiesProviderClass {
 	GObjectClass __parent__;
@@ -124,15 +124,11 @@ rom_properties_provider_get_pages(NautilusPropertyPageProvider *provider, GList
 		return nullptr;
 
 	info = NAUTILUS_FILE_INFO(file->data);
-	gchar *const uri = nautilus_file_info_get_uri(info);
-	if (G_UNLIKELY(uri == nullptr)) {
-		// No URI...
-		return nullptr;
-	}
 
-	// TODO: Do we have to keep rom_properties_get_file_supported()
+	// TODO: Do we have to keep rom_properties_open_romData()
 	// as a separate function that takes a NautilusFileInfo*?
-	if (G_LIKELY(rom_properties_get_file_supported(info))) {
+	RomData *const romData = rom_properties_open_romData(info);
+	if (G_LIKELY(romData != nullptr)) {
 		// Get the URI.
 		gchar *const uri = nautilus_file_info_get_uri(info);
 
@@ -140,14 +136,18 @@ rom_properties_provider_get_pages(NautilusPropertyPageProvider *provider, GList
 		// NOTE: Unlike the Xfce/Thunar (GTK+ 2.x) version, we don't
 		// need to subclass NautilusPropertyPage. Instead, we create a
 		// NautilusPropertyPage and add a RomDataView widget to it.
+		// The RomData object is passed to the RomDataView so the
+		// file doesn't have to be opened and parsed again.
 		// TODO: Add some extra padding to the top...
-		GtkWidget *romDataView = static_cast<GtkWidget*>(
-			g_object_new(rom_data_view_get_type(), nullptr));
-		rom_data_view_set_desc_format_type(ROM_DATA_VIEW(romDataView), RP_DFT_GNOME);
-		rom_data_view_set_uri(ROM_DATA_VIEW(romDataView), uri);
+		GtkWidget *const romDataView = rom_data_view_new_with_romData(
+			uri, romData, RP_DFT_GNOME);
 		gtk_widget_show(romDataView);
 		g_free(uri);
 
+		// RomDataView takes a reference to the RomData object.
+		// We don't need to hold on to it.
+		romData->unref();
+
 		// tr: Tab title.
 		const char *const tabTitle = C_("RomDataView", "ROM Properties");
 
@@ -163,16 +163,20 @@ rom_properties_provider_get_pages(NautilusPropertyPageProvider *provider, GList
 	return pages;
 }
 
-static gboolean
-rom_properties_get_file_supported(NautilusFileInfo *info)
+/**
+ * Open a file and create a RomData object for it.
+ * @param info NautilusFileInfo
+ * @return RomData object if the file is supported (caller must unref()); nullptr if not.
+ */
+static RomData*
+rom_properties_open_romData(NautilusFileInfo *info)
 {
-	gboolean supported = false;
-	g_return_val_if_fail(info != nullptr || NAUTILUS_IS_FILE_INFO(info), false);
+	g_return_val_if_fail(info != nullptr || NAUTILUS_IS_FILE_INFO(info), nullptr);
 
 	gchar *const uri = nautilus_file_info_get_uri(info);
 	if (G_UNLIKELY(uri == nullptr)) {
 		// No URI...
-		return false;
+		return nullptr;
 	}
 
 	// TODO: Check file extensions and/or MIME types?
@@ -190,18 +194,16 @@ rom_properties_get_file_supported(NautilusFileInfo *info)
 	}
 	g_free(uri);
 
+	RomData *romData = nullptr;
 	if (file->isOpen()) {
 		// Is this ROM file supported?
 		// NOTE: We have to create an instance here in order to
 		// prevent false positives caused by isRomSupported()
 		// saying "yes" while new RomData() says "no".
-		RomData *const romData = RomDataFactory::create(file);
-		if (romData != nullptr) {
-			supported = true;
-			romData->unref();
-		}
+		// The instance is returned so RomDataView can use it.
+		romData = RomDataFactory::create(file);
 	}
-	file->unref();
+	file->unref();	// file is ref()'d by RomData.
 
-	return supported;
+	return romData;
 }
@@ -16,11 +16,14 @@
 
 #include <glib-object.h>
 #include "SpecializedThumbnailer1.h"
+#include "ThumbnailerStats1.h"
 
 // C includes.
+#include <assert.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 // from tumbler-utils.h
 #define g_dbus_async_return_val_if_fail(expr, invocation, val) \
@@ -52,6 +55,8 @@ enum RpThumbnailerProperties {
 	PROP_CONNECTION,
 	PROP_CACHE_DIR,
 	PROP_PFN_RP_CREATE_THUMBNAIL,
+	PROP_PFN_RP_GET_DOWNLOAD_STATS,
+	PROP_MAX_THREADS,
 	PROP_EXPORTED,
 
 	PROP_LAST
@@ -72,7 +77,14 @@ static void	rp_thumbnailer_set_property	(GObject	*object,
 						 GParamSpec	*pspec);
 
 static gboolean	rp_thumbnailer_timeout		(RpThumbnailer	*thumbnailer);
-static gboolean	rp_thumbnailer_process		(RpThumbnailer	*thumbnailer);
+static gint	rp_thumbnailer_compare		(gconstpointer	 a,
+						 gconstpointer	 b,
+						 gpointer	 user_data);
+static void	rp_thumbnailer_process		(gpointer	 data,
+						 gpointer	 user_data);
+static gboolean	rp_thumbnailer_started		(gpointer	 data);
+static gboolean	rp_thumbnailer_finish		(gpointer	 data);
+static void	rp_thumbnailer_update_stats	(RpThumbnailer	*thumbnailer);
 
 // D-Bus methods.
 static gboolean	rp_thumbnailer_queue		(OrgFreedesktopThumbnailsSpecializedThumbnailer1 *skeleton,
@@ -94,26 +106,70 @@ struct _RpThumbnailerClass {
 
 #define SHUTDOWN_TIMEOUT_SECONDS 30
 
+// Thumbnail request state.
+// Only accessed on the main thread.
+enum RequestState {
+	REQUEST_QUEUED,		// Waiting for a worker thread.
+	REQUEST_STARTED,	// Started by a worker thread.
+	REQUEST_CANCELLED,	// All handles were dequeued before the request was started.
+};
+
 // Thumbnail request information.
+// Duplicate requests for the same URI and flavor are merged
+// into a single request, which has one handle per Queue() call.
+// NOTE: Requests are created and freed on the main thread.
+// The result fields are set by the worker thread.
 struct request_info {
+	RpThumbnailer *thumbnailer;	// Owns a reference.
 	gchar *uri;
-	guint handle;
+	gchar *key;		// Coalescing key: flavor + URI
+	GArray *handles;	// element is guint; empty if all handles were dequeued
+	guint64 seq;		// Sequence number, for FIFO ordering
+	gint64 queue_time;	// Time the request was queued, in microseconds
 	bool large;	// False for 'normal' (128x128); true for 'large' (256x256)
 	bool urgent;	// 'urgent' value
+	guint8 state;	// enum RequestState
+	volatile gint cancelled;	// Non-zero if the worker should skip this request. (atomic)
+
+	// Result.
+	gchar *cache_filename;	// Thumbnail filename. (NULL on error)
+	const char *error_msg;	// Error message. (NULL on success)
+	int error_code;		// Error code for the Error signal.
+	bool skipped;		// True if the worker skipped the request because it was cancelled.
 };
 
-static void request_info_free(gpointer data, G_GNUC_UNUSED gpointer user_data)
+static void request_info_free(struct request_info *req)
 {
-	if (data) {
-		struct request_info *const req = (struct request_info*)data;
+	if (req) {
+		g_object_unref(req->thumbnailer);
 		g_free(req->uri);
+		g_free(req->key);
+		g_array_free(req->handles, true);
+		g_free(req->cache_filename);
 		g_free(req);
 	}
 }
 
+/**
+ * Get the current monotonic time.
+ * @return Monotonic time, in microseconds.
+ */
+static inline gint64
+rp_thumbnailer_get_time(void)
+{
+#if GLIB_CHECK_VERSION(2,28,0)
+	return g_get_monotonic_time();
+#else /* !GLIB_CHECK_VERSION(2,28,0) */
+	GTimeVal tv;
+	g_get_current_time(&tv);
+	return ((gint64)tv.tv_sec * G_USEC_PER_SEC) + tv.tv_usec;
+#endif /* GLIB_CHECK_VERSION(2,28,0) */
+}
+
 struct _RpThumbnailer {
 	GObject __parent__;
 	OrgFreedesktopThumbnailsSpecializedThumbnailer1 *skeleton;
+	RpThumbnailerStats1 *stats_skeleton;
 
 	// Has the shutdown signal been emitted?
 	bool shutdown_emitted;
@@ -121,14 +177,33 @@ struct _RpThumbnailer {
 	// Shutdown timeout.
 	guint timeout_id;
 
-	// Idle function for processing.
-	guint idle_process;
-
 	// Last handle value.
 	guint last_handle;
 
-	// Request queue.
-	GQueue *request_queue;	// element is struct request_info*
+	// Worker thread pool.
+	// Thumbnails are created on the worker threads, and the
+	// results are sent back to the main thread for signaling.
+	GThreadPool *thread_pool;	// element is struct request_info*
+
+	// Pending requests.
+	// Only accessed on the main thread.
+	GHashTable *handle_map;	// key is handle; value is struct request_info*
+	GHashTable *uri_map;	// key is request_info::key; value is struct request_info*
+	guint pending;		// Number of requests that haven't finished yet.
+	guint64 last_seq;	// Last request sequence number.
+
+	// Statistics.
+	// Only accessed on the main thread.
+	struct {
+		guint queue_depth;	// Requests that haven't been started or dequeued.
+		guint active_jobs;	// Requests that have been started but not finished.
+		guint64 total_requests;
+		guint64 coalesced_requests;
+		guint64 dequeued_requests;
+		guint64 started_jobs;
+		guint64 total_wait_time;
+		guint64 max_wait_time;
+	} stats;
 
 	/** Properties. **/
 
@@ -141,6 +216,12 @@ struct _RpThumbnailer {
 	// rp_create_thumbnail() function pointer.
 	PFN_RP_CREATE_THUMBNAIL pfn_rp_create_thumbnail;
 
+	// rp_get_download_stats() function pointer. (optional)
+	PFN_RP_GET_DOWNLOAD_STATS pfn_rp_get_download_stats;
+
+	// Maximum number of worker threads. (0 == one per CPU)
+	guint max_threads;
+
 	// Is the D-Bus object exported?
 	bool exported;
 };
@@ -216,6 +297,14 @@ rp_thumbnailer_class_init(gpointer g_class, gpointer class_data)
 		g_param_spec_pointer("pfn_rp_create_thumbnail", "pfn_rp_create_thumbnail",
 			"rp_create_thumbnail() function pointer.",
 			(GParamFlags)(G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY)));
+	g_object_class_install_property(gobject_class, PROP_PFN_RP_GET_DOWNLOAD_STATS,
+		g_param_spec_pointer("pfn_rp_get_download_stats", "pfn_rp_get_download_stats",
+			"rp_get_download_stats() function pointer. (optional)",
+			(GParamFlags)(G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY)));
+	g_object_class_install_property(gobject_class, PROP_MAX_THREADS,
+		g_param_spec_uint("max_threads", "max_threads",
+			"Maximum number of worker threads. (0 == one per CPU)",
+			0, G_MAXUINT, 0, (GParamFlags)(G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY)));
 	g_object_class_install_property(gobject_class, PROP_EXPORTED,
 		g_param_spec_boolean("exported", "exported", "Is the D-Bus object exported?",
 			false, G_PARAM_READABLE));
@@ -228,26 +317,67 @@ rp_thumbnailer_init(GTypeInstance *instance, gpointer g_class)
 	RpThumbnailer *const thumbnailer = (RpThumbnailer*)instance;
 
 	thumbnailer->skeleton = NULL;
+	thumbnailer->stats_skeleton = NULL;
 	thumbnailer->shutdown_emitted = false;
 	thumbnailer->timeout_id = 0;
-	thumbnailer->idle_process = 0;
 	thumbnailer->last_handle = 0;
-	thumbnailer->request_queue = g_queue_new();
+	thumbnailer->thread_pool = NULL;
+	thumbnailer->handle_map = g_hash_table_new(g_direct_hash, g_direct_equal);
+	thumbnailer->uri_map = g_hash_table_new(g_str_hash, g_str_equal);
+	thumbnailer->pending = 0;
+	thumbnailer->last_seq = 0;
+	memset(&thumbnailer->stats, 0, sizeof(thumbnailer->stats));
 
 	/** Properties. **/
 	thumbnailer->connection = NULL;
 	thumbnailer->cache_dir = NULL;
 	thumbnailer->pfn_rp_create_thumbnail = NULL;
+	thumbnailer->pfn_rp_get_download_stats = NULL;
+	thumbnailer->max_threads = 0;
 	thumbnailer->exported = false;
 }
 
+/**
+ * Get the number of CPUs.
+ * @return Number of CPUs.
+ */
+static guint
+rp_thumbnailer_cpu_count(void)
+{
+#if GLIB_CHECK_VERSION(2,36,0)
+	return g_get_num_processors();
+#else /* !GLIB_CHECK_VERSION(2,36,0) */
+	const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return (cpus > 0 ? (guint)cpus : 1);
+#endif /* GLIB_CHECK_VERSION(2,36,0) */
+}
+
 static void
 rp_thumbnailer_constructed(GObject *object)
 {
 	g_return_if_fail(IS_RP_THUMBNAILER(object));
 	RpThumbnailer *const thumbnailer = RP_THUMBNAILER(object);
 
+	// Create the worker thread pool.
+	// NOTE: Threads are started on demand.
+	guint max_threads = thumbnailer->max_threads;
+	if (max_threads == 0) {
+		max_threads = rp_thumbnailer_cpu_count();
+	}
 	GError *error = NULL;
+	thumbnailer->thread_pool = g_thread_pool_new(rp_thumbnailer_process,
+		thumbnailer, (gint)max_threads, false, &error);
+	if (error) {
+		g_critical("Error creating the worker thread pool: %s", error->message);
+		g_clear_error(&error);
+		thumbnailer->exported = false;
+		return;
+	}
+	g_debug("Using up to %u worker threads.", max_threads);
+
+	// Urgent requests are processed first.
+	g_thread_pool_set_sort_function(thumbnailer->thread_pool, rp_thumbnailer_compare, NULL);
+
 	thumbnailer->skeleton = org_freedesktop_thumbnails_specialized_thumbnailer1_skeleton_new();
 	g_dbus_interface_skeleton_export(G_DBUS_INTERFACE_SKELETON(thumbnailer->skeleton),
 		thumbnailer->connection, "/com/gerbilsoft/rom_properties/SpecializedThumbnailer1", &error);
@@ -261,7 +391,17 @@ rp_thumbnailer_constructed(GObject *object)
 			G_CALLBACK(rp_thumbnailer_queue), thumbnailer);
 		g_signal_connect(thumbnailer->skeleton, "handle-dequeue",
 			G_CALLBACK(rp_thumbnailer_dequeue), thumbnailer);
-		
+
+		// Export the statistics interface.
+		// This isn't required for thumbnailing, so errors are ignored.
+		thumbnailer->stats_skeleton = rp_thumbnailer_stats1_skeleton_new();
+		g_dbus_interface_skeleton_export(G_DBUS_INTERFACE_SKELETON(thumbnailer->stats_skeleton),
+			thumbnailer->connection, "/com/gerbilsoft/rom_properties/SpecializedThumbnailer1", &error);
+		if (error) {
+			g_warning("Error exporting RpThumbnailer statistics on session bus: %s", error->message);
+			g_clear_error(&error);
+		}
+
 		// Make sure we shut down after inactivity.
 		thumbnailer->timeout_id = g_timeout_add_seconds(SHUTDOWN_TIMEOUT_SECONDS,
 			(GSourceFunc)rp_thumbnailer_timeout, thumbnailer);
@@ -283,10 +423,12 @@ rp_thumbnailer_dispose(GObject *object)
 		thumbnailer->timeout_id = 0;
 	}
 
-	// Unregister idle_process.
-	if (G_UNLIKELY(thumbnailer->idle_process != 0)) {
-		g_source_remove(thumbnailer->idle_process);
-		thumbnailer->idle_process = 0;
+	// Shut down the worker thread pool.
+	// NOTE: Each request holds a reference to the RpThumbnailer,
+	// so there shouldn't be any requests left at this point.
+	if (thumbnailer->thread_pool) {
+		g_thread_pool_free(thumbnailer->thread_pool, false, true);
+		thumbnailer->thread_pool = NULL;
 	}
 
 	// Call the superclass dispose() function.
@@ -301,10 +443,14 @@ rp_thumbnailer_finalize(GObject *object)
 	if (thumbnailer->skeleton) {
 		g_object_unref(thumbnailer->skeleton);
 	}
+	if (thumbnailer->stats_skeleton) {
+		g_object_unref(thumbnailer->stats_skeleton);
+	}
 
-	// Delete any remaining requests and free the queue.
-	g_queue_foreach(thumbnailer->request_queue, request_info_free, 0);
-	g_queue_free(thumbnailer->request_queue);
+	// NOTE: Each request holds a reference to the RpThumbnailer,
+	// so the request maps should be empty at this point.
+	g_hash_table_destroy(thumbnailer->handle_map);
+	g_hash_table_destroy(thumbnailer->uri_map);
 
 	/** Properties. **/
 	g_free(thumbnailer->cache_dir);
@@ -337,6 +483,12 @@ rp_thumbnailer_get_property(GObject *object,
 		case PROP_PFN_RP_CREATE_THUMBNAIL:
 			g_value_set_pointer(value, (gpointer)thumbnailer->pfn_rp_create_thumbnail);
 			break;
+		case PROP_PFN_RP_GET_DOWNLOAD_STATS:
+			g_value_set_pointer(value, (gpointer)thumbnailer->pfn_rp_get_download_stats);
+			break;
+		case PROP_MAX_THREADS:
+			g_value_set_uint(value, thumbnailer->max_threads);
+			break;
 		case PROP_EXPORTED:
 			g_value_set_boolean(value, thumbnailer->exported);
 			break;
@@ -386,6 +538,15 @@ rp_thumbnailer_set_property(GObject *object,
 				(PFN_RP_CREATE_THUMBNAIL)g_value_get_pointer(value);
 			break;
 
+		case PROP_PFN_RP_GET_DOWNLOAD_STATS:
+			thumbnailer->pfn_rp_get_download_stats =
+				(PFN_RP_GET_DOWNLOAD_STATS)g_value_get_pointer(value);
+			break;
+
+		case PROP_MAX_THREADS:
+			thumbnailer->max_threads = g_value_get_uint(value);
+			break;
+
 		case PROP_EXPORTED:
 			// FIXME: Read-only property.
 			// Need to show some error message...
@@ -441,21 +602,54 @@ rp_thumbnailer_queue(OrgFreedesktopThumbnailsSpecializedThumbnailer1 *skeleton,
 		handle = ++thumbnailer->last_handle;
 	}
 
-	// Add the URI to the queue.
 	// NOTE: Currently handling all flavors that aren't "large" as "normal".
-	struct request_info *req = g_malloc(sizeof(struct request_info));
-	req->uri = g_strdup(uri);
-	req->handle = handle;
-	req->large = flavor && (g_ascii_strcasecmp(flavor, "large") == 0);
-	req->urgent = urgent;
-	// TODO Put 'urgent' requests at the front of the queue?
-	g_queue_push_tail(thumbnailer->request_queue, req);
-
-	// Make sure the idle process is started.
-	// TODO: Make it multi-threaded? (needs atomic compare and/or mutex...)
-	if (thumbnailer->idle_process == 0) {
-		thumbnailer->idle_process = g_idle_add((GSourceFunc)rp_thumbnailer_process, thumbnailer);
+	const bool large = flavor && (g_ascii_strcasecmp(flavor, "large") == 0);
+	gchar *const key = g_strconcat(large ? "large:" : "normal:", uri, NULL);
+	thumbnailer->stats.total_requests++;
+
+	// If this URI and flavor is already queued and hasn't been
+	// started yet, add the handle to the existing request.
+	struct request_info *req = (struct request_info*)g_hash_table_lookup(thumbnailer->uri_map, key);
+	if (req && req->state == REQUEST_QUEUED) {
+		g_free(key);
+		g_array_append_val(req->handles, handle);
+		thumbnailer->stats.coalesced_requests++;
+		if (urgent && !req->urgent) {
+			// Move the request ahead of non-urgent requests.
+			// NOTE: Setting the sort function re-sorts the queue.
+			req->urgent = true;
+			g_thread_pool_set_sort_function(thumbnailer->thread_pool, rp_thumbnailer_compare, NULL);
+		}
+	} else {
+		// Add the URI to the queue.
+		req = g_malloc(sizeof(struct request_info));
+		req->thumbnailer = g_object_ref(thumbnailer);
+		req->uri = g_strdup(uri);
+		req->key = key;
+		req->handles = g_array_sized_new(false, false, sizeof(guint), 1);
+		g_array_append_val(req->handles, handle);
+		req->seq = ++thumbnailer->last_seq;
+		req->queue_time = rp_thumbnailer_get_time();
+		req->large = large;
+		req->urgent = urgent;
+		req->state = REQUEST_QUEUED;
+		req->cancelled = 0;
+		req->cache_filename = NULL;
+		req->error_msg = NULL;
+		req->error_code = 0;
+		req->skipped = false;
+
+		// NOTE: If a started request has the same key,
+		// this request replaces it in uri_map.
+		g_hash_table_insert(thumbnailer->uri_map, req->key, req);
+
+		// Send the request to the worker threads.
+		thumbnailer->pending++;
+		thumbnailer->stats.queue_depth++;
+		g_thread_pool_push(thumbnailer->thread_pool, req, NULL);
 	}
+	g_hash_table_insert(thumbnailer->handle_map, GUINT_TO_POINTER(handle), req);
+	rp_thumbnailer_update_stats(thumbnailer);
 
 	org_freedesktop_thumbnails_specialized_thumbnailer1_complete_queue(skeleton, invocation, handle);
 	return true;
@@ -478,7 +672,38 @@ rp_thumbnailer_dequeue(OrgFreedesktopThumbnailsSpecializedThumbnailer1 *skeleton
 	g_dbus_async_return_val_if_fail(IS_RP_THUMBNAILER(thumbnailer), invocation, false);
 	g_dbus_async_return_val_if_fail(handle != 0, invocation, false);
 
-	// TODO
+	struct request_info *const req = (struct request_info*)g_hash_table_lookup(
+		thumbnailer->handle_map, GUINT_TO_POINTER(handle));
+	if (req) {
+		// Remove the handle from the request.
+		// No signals will be emitted for this handle.
+		g_hash_table_remove(thumbnailer->handle_map, GUINT_TO_POINTER(handle));
+		for (guint i = 0; i < req->handles->len; i++) {
+			if (g_array_index(req->handles, guint, i) == handle) {
+				g_array_remove_index(req->handles, i);
+				break;
+			}
+		}
+		thumbnailer->stats.dequeued_requests++;
+
+		if (req->handles->len == 0) {
+			// No handles are left. Cancel the request.
+			// NOTE: If the worker thread already picked up the request,
+			// the thumbnail will still be created, but no signals will
+			// be emitted for it.
+			g_atomic_int_set(&req->cancelled, 1);
+			if (g_hash_table_lookup(thumbnailer->uri_map, req->key) == req) {
+				g_hash_table_remove(thumbnailer->uri_map, req->key);
+			}
+			if (req->state == REQUEST_QUEUED) {
+				assert(thumbnailer->stats.queue_depth > 0);
+				thumbnailer->stats.queue_depth--;
+				req->state = REQUEST_CANCELLED;
+			}
+		}
+		rp_thumbnailer_update_stats(thumbnailer);
+	}
+
 	org_freedesktop_thumbnails_specialized_thumbnailer1_complete_dequeue(skeleton, invocation);
 	return true;
 }
@@ -491,7 +716,7 @@ static gboolean
 rp_thumbnailer_timeout(RpThumbnailer *thumbnailer)
 {
 	g_return_val_if_fail(IS_RP_THUMBNAILER(thumbnailer), false);
-	if (!g_queue_is_empty(thumbnailer->request_queue)) {
+	if (thumbnailer->pending > 0) {
 		// Still processing stuff.
 		return true;
 	}
@@ -505,44 +730,75 @@ rp_thumbnailer_timeout(RpThumbnailer *thumbnailer)
 	return false;
 }
 
+/**
+ * Compare two requests for the worker thread queue.
+ * Urgent requests are processed first; otherwise, requests
+ * are processed in the order they were queued.
+ * NOTE: This is called with the queue locked, and the request
+ * fields used here are only modified on the main thread while
+ * the request is queued.
+ * @param a		[in] struct request_info
+ * @param b		[in] struct request_info
+ * @param user_data	[in] Unused.
+ * @return Negative if a should be processed before b; positive if after.
+ */
+static gint
+rp_thumbnailer_compare(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	RP_UNUSED(user_data);
+	const struct request_info *const req_a = (const struct request_info*)a;
+	const struct request_info *const req_b = (const struct request_info*)b;
+
+	if (req_a->urgent != req_b->urgent) {
+		return (req_a->urgent ? -1 : 1);
+	}
+	return (req_a->seq < req_b->seq ? -1 : (req_a->seq > req_b->seq ? 1 : 0));
+}
+
 /**
  * Process a thumbnail.
- * @param thumbnailer RpThumbnailer object.
+ * This function runs on a worker thread.
+ * The result is sent to the main thread using rp_thumbnailer_finish().
+ * @param data		[in/out] struct request_info
+ * @param user_data	[in] RpThumbnailer object.
  */
-static gboolean
-rp_thumbnailer_process(RpThumbnailer *thumbnailer)
+static void
+rp_thumbnailer_process(gpointer data, gpointer user_data)
 {
-	g_return_val_if_fail(IS_RP_THUMBNAILER(thumbnailer), FALSE);
+	struct request_info *const req = (struct request_info*)data;
+	RpThumbnailer *const thumbnailer = (RpThumbnailer*)user_data;
 
 	GChecksum *md5 = NULL;
 	const gchar *md5_string;	// owned by md5 object
-	const struct request_info *req;	// request info from the map
 	gchar *cache_filename = NULL;	// cache filename (g_strdup_printf())
 	size_t cache_filename_sz;	// size of cache_filename
 	int pos, pos2;			// snprintf() position
 	int ret;
 
-	// Process one thumbnail.
-	req = (struct request_info*)g_queue_pop_head(thumbnailer->request_queue);
-	if (req == NULL) {
-		// Nothing in the queue.
-		goto cleanup;
+	if (g_atomic_int_get(&req->cancelled)) {
+		// All handles were dequeued.
+		req->skipped = true;
+		goto finished;
 	}
 
+	// Tell the main thread that the request was started.
+	// NOTE: Idle sources with the same priority are run in the
+	// order they were added, so this always runs before the
+	// rp_thumbnailer_finish() call for this request.
+	g_idle_add(rp_thumbnailer_started, req);
+
 	// NOTE: cache_dir and pfn_rp_create_thumbnail should NOT be NULL
 	// at this point, but we're checking it anyway.
+	// NOTE 2: These are construct-only properties, so they
+	// can be read from the worker threads without locking.
 	if (!thumbnailer->cache_dir || thumbnailer->cache_dir[0] == 0) {
 		// No cache directory...
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, "",
-			0, "Thumbnail cache directory is empty.");
+		req->error_msg = "Thumbnail cache directory is empty.";
 		goto finished;
 	}
 	if (!thumbnailer->pfn_rp_create_thumbnail) {
 		// No thumbnailer function.
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, "",
-			0, "No thumbnailer function is available.");
+		req->error_msg = "No thumbnailer function is available.";
 		goto finished;
 	}
 
@@ -563,16 +819,14 @@ rp_thumbnailer_process(RpThumbnailer *thumbnailer)
 	// pos does NOT include the NULL terminator, so check >=.
 	if (pos < 0 || ((size_t)pos + 1 + 32 + 4) > cache_filename_sz) {
 		// Not enough memory.
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, req->uri,
-			0, "Cannot snprintf() the thumbnail cache directory name.");
+		req->error_msg = "Cannot snprintf() the thumbnail cache directory name.";
 		goto finished;
 	}
 
+	// NOTE: g_mkdir_with_parents() succeeds if another
+	// worker thread created the directory first.
 	if (g_mkdir_with_parents(cache_filename, 0777) != 0) {
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, req->uri,
-			0, "Cannot mkdir() the thumbnail cache directory.");
+		req->error_msg = "Cannot mkdir() the thumbnail cache directory.";
 		goto finished;
 	}
 
@@ -582,9 +836,7 @@ rp_thumbnailer_process(RpThumbnailer *thumbnailer)
 	if (!md5) {
 		// Cannot allocate an MD5...
 		// TODO: Test for this early.
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, req->uri,
-			0, "g_checksum_new() does not support MD5.");
+		req->error_msg = "g_checksum_new() does not support MD5.";
 		goto finished;
 	}
 	g_checksum_update(md5, (const guchar*)req->uri, strlen(req->uri));
@@ -595,9 +847,7 @@ rp_thumbnailer_process(RpThumbnailer *thumbnailer)
 	// pos and pos2 do NOT include the NULL terminator, so check >=.
 	if (pos2 < 0 || ((size_t)pos + (size_t)pos2) >= cache_filename_sz) {
 		// Not enough memory.
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, req->uri,
-			0, "Cannot snprintf() the thumbnail filename.");
+		req->error_msg = "Cannot snprintf() the thumbnail filename.";
 		goto finished;
 	}
 
@@ -606,40 +856,178 @@ rp_thumbnailer_process(RpThumbnailer *thumbnailer)
 	if (ret == 0) {
 		// Image thumbnailed successfully.
 		g_debug("rom-properties thumbnail: %s -> %s [OK]", req->uri, cache_filename);
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_ready(
-			thumbnailer->skeleton, req->handle, req->uri);
+		req->cache_filename = cache_filename;
+		cache_filename = NULL;
 	} else {
 		// Error thumbnailing the image...
 		g_debug("rom-properties thumbnail: %s -> %s [ERR=%d]", req->uri, cache_filename, ret);
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, req->uri,
-			2, "Image thumbnailing failed... (TODO: return code)");
+		req->error_code = 2;
+		req->error_msg = "Image thumbnailing failed... (TODO: return code)";
 	}
 
 finished:
-	// Request is finished. Emit the finished signal.
-	org_freedesktop_thumbnails_specialized_thumbnailer1_emit_finished(
-		thumbnailer->skeleton, req->handle);
-
-cleanup:
 	// Free allocated things.
-	g_checksum_free(md5);
+	if (md5) {
+		g_checksum_free(md5);
+	}
 	g_free(cache_filename);
 
-	// Return TRUE if we still have more thumbnails queued.
-	const bool isEmpty = g_queue_is_empty(thumbnailer->request_queue);
-	if (isEmpty) {
-		// Clear the idle process.
-		// FIXME: Atomic compare and/or mutex? (assuming multi-threaded...)
-		thumbnailer->idle_process = 0;
+	// Send the result to the main thread.
+	g_idle_add(rp_thumbnailer_finish, req);
+}
+
+/**
+ * A thumbnail request was started by a worker thread.
+ * This function runs on the main thread.
+ * @param data struct request_info
+ * @return FALSE to remove the idle source.
+ */
+static gboolean
+rp_thumbnailer_started(gpointer data)
+{
+	struct request_info *const req = (struct request_info*)data;
+	RpThumbnailer *const thumbnailer = req->thumbnailer;
+
+	if (req->state != REQUEST_QUEUED) {
+		// Request was cancelled after the worker picked it up.
+		return false;
+	}
+
+	// Update the queue statistics.
+	req->state = REQUEST_STARTED;
+	assert(thumbnailer->stats.queue_depth > 0);
+	thumbnailer->stats.queue_depth--;
+	thumbnailer->stats.active_jobs++;
+
+	const gint64 wait_time = rp_thumbnailer_get_time() - req->queue_time;
+	if (wait_time > 0) {
+		thumbnailer->stats.total_wait_time += (guint64)wait_time;
+		if ((guint64)wait_time > thumbnailer->stats.max_wait_time) {
+			thumbnailer->stats.max_wait_time = (guint64)wait_time;
+		}
+	}
+	thumbnailer->stats.started_jobs++;
+
+	// The request can't be coalesced anymore, so a new
+	// request for the same URI and flavor will be queued
+	// separately in case the file changes.
+	if (g_hash_table_lookup(thumbnailer->uri_map, req->key) == req) {
+		g_hash_table_remove(thumbnailer->uri_map, req->key);
+	}
+
+	for (guint i = 0; i < req->handles->len; i++) {
+		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_started(
+			thumbnailer->skeleton, g_array_index(req->handles, guint, i));
+	}
+
+	rp_thumbnailer_update_stats(thumbnailer);
+	return false;
+}
+
+/**
+ * A thumbnail request has been processed.
+ * This function runs on the main thread.
+ * @param data struct request_info
+ * @return FALSE to remove the idle source.
+ */
+static gboolean
+rp_thumbnailer_finish(gpointer data)
+{
+	struct request_info *const req = (struct request_info*)data;
+	RpThumbnailer *const thumbnailer = req->thumbnailer;
+
+	// Emit signals for each handle that wasn't dequeued.
+	// NOTE: Requests are only skipped if all handles were dequeued.
+	assert(!req->skipped || req->handles->len == 0);
+	for (guint i = 0; i < req->handles->len; i++) {
+		const guint handle = g_array_index(req->handles, guint, i);
+		if (!req->error_msg) {
+			org_freedesktop_thumbnails_specialized_thumbnailer1_emit_ready(
+				thumbnailer->skeleton, handle, req->uri);
+		} else {
+			org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
+				thumbnailer->skeleton, handle, req->uri,
+				req->error_code, req->error_msg);
+		}
+
+		// Request is finished. Emit the finished signal.
+		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_finished(
+			thumbnailer->skeleton, handle);
+		g_hash_table_remove(thumbnailer->handle_map, GUINT_TO_POINTER(handle));
+	}
+
+	// Remove the request from the maps.
+	if (g_hash_table_lookup(thumbnailer->uri_map, req->key) == req) {
+		g_hash_table_remove(thumbnailer->uri_map, req->key);
+	}
+	if (req->state == REQUEST_STARTED) {
+		assert(thumbnailer->stats.active_jobs > 0);
+		thumbnailer->stats.active_jobs--;
+	}
+	rp_thumbnailer_update_stats(thumbnailer);
 
+	assert(thumbnailer->pending > 0);
+	if (--thumbnailer->pending == 0) {
 		// Restart the inactivity timeout.
-		if (G_LIKELY(thumbnailer->timeout_id == 0)) {
+		if (G_LIKELY(thumbnailer->timeout_id == 0 && !thumbnailer->shutdown_emitted)) {
 			thumbnailer->timeout_id = g_timeout_add_seconds(SHUTDOWN_TIMEOUT_SECONDS,
 				(GSourceFunc)rp_thumbnailer_timeout, thumbnailer);
 		}
 	}
-	return !isEmpty;
+
+	// NOTE: This releases the request's RpThumbnailer reference.
+	request_info_free(req);
+	return false;
+}
+
+/**
+ * Update the D-Bus statistics properties.
+ * This function runs on the main thread.
+ * @param thumbnailer RpThumbnailer object.
+ */
+static void
+rp_thumbnailer_update_stats(RpThumbnailer *thumbnailer)
+{
+	RpThumbnailerStats1 *const stats_skeleton = thumbnailer->stats_skeleton;
+	if (!stats_skeleton)
+		return;
+
+	// NOTE: The generated setters only emit PropertiesChanged
+	// if the value actually changed.
+	rp_thumbnailer_stats1_set_queue_depth(stats_skeleton, thumbnailer->stats.queue_depth);
+	rp_thumbnailer_stats1_set_active_jobs(stats_skeleton, thumbnailer->stats.active_jobs);
+	rp_thumbnailer_stats1_set_total_requests(stats_skeleton, thumbnailer->stats.total_requests);
+	rp_thumbnailer_stats1_set_coalesced_requests(stats_skeleton, thumbnailer->stats.coalesced_requests);
+	rp_thumbnailer_stats1_set_dequeued_requests(stats_skeleton, thumbnailer->stats.dequeued_requests);
+	rp_thumbnailer_stats1_set_average_wait_time(stats_skeleton,
+		(thumbnailer->stats.started_jobs > 0
+			? thumbnailer->stats.total_wait_time / thumbnailer->stats.started_jobs
+			: 0));
+	rp_thumbnailer_stats1_set_max_wait_time(stats_skeleton, thumbnailer->stats.max_wait_time);
+
+	// External image download statistics.
+	// These are kept by the ROM Properties Page library.
+	uint32_t buckets[RP_DOWNLOAD_STATS_BUCKET_COUNT];
+	uint32_t dl_count, dl_failed, dl_max_ms;
+	uint64_t dl_total_ms;
+	if (thumbnailer->pfn_rp_get_download_stats &&
+	    thumbnailer->pfn_rp_get_download_stats(buckets, RP_DOWNLOAD_STATS_BUCKET_COUNT,
+		&dl_count, &dl_failed, &dl_total_ms, &dl_max_ms) == 0)
+	{
+		rp_thumbnailer_stats1_set_download_requests(stats_skeleton, dl_count);
+		rp_thumbnailer_stats1_set_failed_downloads(stats_skeleton, dl_failed);
+		rp_thumbnailer_stats1_set_average_download_time(stats_skeleton,
+			(dl_count > 0 ? dl_total_ms * 1000 / dl_count : 0));
+		rp_thumbnailer_stats1_set_max_download_time(stats_skeleton, (guint64)dl_max_ms * 1000);
+
+		GVariantBuilder builder;
+		g_variant_builder_init(&builder, G_VARIANT_TYPE("au"));
+		for (unsigned int i = 0; i < RP_DOWNLOAD_STATS_BUCKET_COUNT; i++) {
+			g_variant_builder_add(&builder, "u", buckets[i]);
+		}
+		rp_thumbnailer_stats1_set_download_latency_histogram(stats_skeleton,
+			g_variant_builder_end(&builder));
+	}
 }
 
 /**
@@ -647,17 +1035,23 @@ cleanup:
  * @param connection			[in] GDBusConnection
  * @param cache_dir			[in] Cache directory.
  * @param pfn_rp_create_thumbnail	[in] rp_create_thumbnail() function pointer.
+ * @param pfn_rp_get_download_stats	[in,opt] rp_get_download_stats() function pointer.
+ * @param max_threads			[in] Maximum number of worker threads. (0 == one per CPU)
  * @return RpThumbnailer object.
  */
 RpThumbnailer*
 rp_thumbnailer_new(GDBusConnection *connection,
 	const gchar *cache_dir,
-	PFN_RP_CREATE_THUMBNAIL pfn_rp_create_thumbnail)
+	PFN_RP_CREATE_THUMBNAIL pfn_rp_create_thumbnail,
+	PFN_RP_GET_DOWNLOAD_STATS pfn_rp_get_download_stats,
+	guint max_threads)
 {
 	return g_object_new(TYPE_RP_THUMBNAILER,
 		"connection", connection,
 		"cache_dir", cache_dir,
 		"pfn_rp_create_thumbnail", pfn_rp_create_thumbnail,
+		"pfn_rp_get_download_stats", pfn_rp_get_download_stats,
+		"max_threads", max_threads,
 		NULL);
 }
 
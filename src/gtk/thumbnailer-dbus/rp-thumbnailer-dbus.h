@@ -12,6 +12,9 @@
 #include <glib.h>
 #include <gio/gio.h>
 
+// C includes.
+#include <stdint.h>
+
 G_BEGIN_DECLS
 
 /**
@@ -23,6 +26,24 @@ G_BEGIN_DECLS
  */
 typedef int (*PFN_RP_CREATE_THUMBNAIL)(const char *source_file, const char *output_file, int maximum_size);
 
+// Number of buckets in the download latency histogram.
+#define RP_DOWNLOAD_STATS_BUCKET_COUNT 16
+
+/**
+ * rp_get_download_stats() function pointer. (optional)
+ * Statistics are combined for all request types.
+ * Only downloads that ran rp-download are counted.
+ * @param buckets	[out] Latency histogram. Bucket i counts downloads that took less than (1 << i) ms.
+ * @param bucket_count	[in] Number of buckets. (must be RP_DOWNLOAD_STATS_BUCKET_COUNT)
+ * @param count		[out] Number of downloads.
+ * @param failed	[out] Number of downloads where no file was downloaded.
+ * @param total_ms	[out] Total time, in milliseconds.
+ * @param max_ms	[out] Slowest download, in milliseconds.
+ * @return 0 on success; non-zero on error.
+ */
+typedef int (*PFN_RP_GET_DOWNLOAD_STATS)(uint32_t *buckets, unsigned int bucket_count,
+	uint32_t *count, uint32_t *failed, uint64_t *total_ms, uint32_t *max_ms);
+
 typedef struct _RpThumbnailerClass	RpThumbnailerClass;
 typedef struct _RpThumbnailer		RpThumbnailer;
 
@@ -37,7 +58,9 @@ GType		rp_thumbnailer_get_type			(void) G_GNUC_CONST G_GNUC_INTERNAL;
 
 RpThumbnailer	*rp_thumbnailer_new			(GDBusConnection *connection,
 							 const gchar *cache_dir,
-							 PFN_RP_CREATE_THUMBNAIL pfn_rp_create_thumbnail)
+							 PFN_RP_CREATE_THUMBNAIL pfn_rp_create_thumbnail,
+							 PFN_RP_GET_DOWNLOAD_STATS pfn_rp_get_download_stats,
+							 guint max_threads)
 							G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
 
 gboolean	rp_thumbnailer_is_exported		(RpThumbnailer *thumbnailer);
@@ -14,9 +14,14 @@
 // OS-specific security options.
 #include "rptsecure.h"
 
+// C includes.
+#include <getopt.h>
+
 // C includes. (C++ namespace)
+#include <cerrno>
 #include <cstdarg>
 #include <cstdio>
+#include <cstdlib>
 
 // C++ includes.
 #include <string>
@@ -113,16 +118,61 @@ on_dbus_name_lost(GDBusConnection *connection, const gchar *name, gpointer user_
 	}
 }
 
-int main(int argc, char *argv[])
+/**
+ * Show command line usage information.
+ * @param argv0 Program name.
+ */
+static void show_help(const char *argv0)
 {
-	RP_UNUSED(argc);
-	RP_UNUSED(argv);
+	printf("Usage: %s [OPTION]...\n"
+		"D-Bus thumbnailer service for ROM Properties Page.\n"
+		"\n"
+		"  -j, --jobs=N       Create up to N thumbnails in parallel. (default is one per CPU)\n"
+		"  -h, --help         Display this help and exit.\n", argv0);
+}
 
+int main(int argc, char *argv[])
+{
 	if (getuid() == 0 || geteuid() == 0) {
 		fprintf(stderr, "*** %s does not support running as root.", argv[0]);
 		return EXIT_FAILURE;
 	}
 
+	static const struct option long_options[] = {
+		{"jobs",	required_argument,	nullptr, 'j'},
+		{"help",	no_argument,		nullptr, 'h'},
+
+		{nullptr, 0, nullptr, 0}
+	};
+
+	// Maximum number of worker threads. (0 == one per CPU)
+	unsigned int max_threads = 0;
+	int c, option_index;
+	while ((c = getopt_long(argc, argv, "j:h", long_options, &option_index)) != -1) {
+		switch (c) {
+			case 'j': {
+				char *endptr = nullptr;
+				errno = 0;
+				const long lTmp = strtol(optarg, &endptr, 10);
+				if (errno == ERANGE || *endptr != 0 || lTmp < 0 || lTmp > 256) {
+					fprintf(stderr, "%s: invalid number of jobs '%s'\n", argv[0], optarg);
+					return EXIT_FAILURE;
+				}
+				max_threads = static_cast<unsigned int>(lTmp);
+				break;
+			}
+
+			case 'h':
+				show_help(argv[0]);
+				return EXIT_SUCCESS;
+
+			case '?':
+			default:
+				fprintf(stderr, "Try '%s --help' for more information.\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
 	// Enable security options.
 	rpt_do_security_options();
 
@@ -152,6 +202,10 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
+	// Download statistics are optional.
+	PFN_RP_GET_DOWNLOAD_STATS pfn_rp_get_download_stats =
+		(PFN_RP_GET_DOWNLOAD_STATS)dlsym(pDll, "rp_get_download_stats");
+
 	GError *error = nullptr;
 	GDBusConnection *const connection = g_bus_get_sync(G_BUS_TYPE_SESSION, nullptr, &error);
 	if (error) {
@@ -165,7 +219,8 @@ int main(int argc, char *argv[])
 
 	// Create the RpThumbnail service object.
 	RpThumbnailer *const thumbnailer = rp_thumbnailer_new(
-		connection, cache_dir.c_str(), pfn_rp_create_thumbnail);
+		connection, cache_dir.c_str(), pfn_rp_create_thumbnail,
+		pfn_rp_get_download_stats, max_threads);
 
 	// Register the D-Bus service.
 	g_bus_own_name_on_connection(connection,
@@ -38,7 +38,13 @@ int rpt_do_security_options(void)
 		// ensures it can only be used to create threads.
 		SCMP_SYS(clone),
 		// Other multi-threading syscalls
+		// (ThreadPool: thumbnailing workers and parallel image decoding)
 		SCMP_SYS(set_robust_list),
+		SCMP_SYS(madvise),		// freeing thread stacks
+		SCMP_SYS(sched_getaffinity),	// sysconf(_SC_NPROCESSORS_ONLN)
+#if defined(__SNR_rseq) || defined(__NR_rseq)
+		SCMP_SYS(rseq),			// glibc-2.35
+#endif /* __SNR_rseq || __NR_rseq */
 
 		SCMP_SYS(access),	// LibUnixCommon::isWritableDirectory()
 		SCMP_SYS(close),
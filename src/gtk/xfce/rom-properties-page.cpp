@@ -16,6 +16,9 @@
 #include "rom-properties-page.hpp"
 #include "../RomDataView.hpp"
 
+// librpbase
+using LibRpBase::RomData;
+
 // C++ STL classes.
 using std::string;
 using std::vector;
@@ -223,6 +226,24 @@ rom_properties_page_get_file(RomPropertiesPage *page)
 void
 rom_properties_page_set_file	(RomPropertiesPage	*page,
 				 ThunarxFileInfo	*file)
+{
+	rom_properties_page_set_file_with_romData(page, file, nullptr);
+}
+
+/**
+ * rom_properties_page_set_file_with_romData:
+ * @page : a #RomPropertiesPage.
+ * @file : a #ThunarxFileInfo
+ * @romData : a RomData object that was already created for @file, or nullptr.
+ *
+ * Sets the #ThunarxFileInfo for this @page.
+ * If @romData is specified, it will be displayed
+ * instead of opening the file again.
+ **/
+void
+rom_properties_page_set_file_with_romData(RomPropertiesPage	*page,
+					  ThunarxFileInfo	*file,
+					  RomData		*romData)
 {
 	g_return_if_fail(IS_ROM_PROPERTIES_PAGE(page));
 	g_return_if_fail(file == nullptr || THUNARX_IS_FILE_INFO(file));
@@ -249,7 +270,14 @@ rom_properties_page_set_file	(RomPropertiesPage	*page,
 		/* Take a reference on the info file */
 		g_object_ref(G_OBJECT(page->file));
 
-		rom_properties_page_file_changed(file, page);
+		if (romData) {
+			// Use the existing RomData object.
+			gchar *const uri = thunarx_file_info_get_uri(page->file);
+			rom_data_view_set_uri_with_romData(ROM_DATA_VIEW(page->romDataView), uri, romData);
+			g_free(uri);
+		} else {
+			rom_properties_page_file_changed(file, page);
+		}
 		page->file_changed_signal_handler_id = g_signal_connect(G_OBJECT(file), "changed",
 			G_CALLBACK(rom_properties_page_file_changed), page);
 	} else {
@@ -11,6 +11,12 @@
 
 #include <glib.h>
 
+#ifdef __cplusplus
+namespace LibRpBase {
+	class RomData;
+}
+#endif /* __cplusplus */
+
 // NOTE: thunarx.h doesn't have extern "C" set up properly everywhere.
 G_BEGIN_DECLS
 
@@ -40,6 +46,11 @@ RomPropertiesPage	*rom_properties_page_new		(void) G_GNUC_INTERNAL G_GNUC_MALLOC
 ThunarxFileInfo		*rom_properties_page_get_file		(RomPropertiesPage	*page) G_GNUC_INTERNAL;
 void			rom_properties_page_set_file		(RomPropertiesPage	*page,
 								 ThunarxFileInfo	*file) G_GNUC_INTERNAL;
+#ifdef __cplusplus
+void			rom_properties_page_set_file_with_romData(RomPropertiesPage *page,
+								 ThunarxFileInfo	*file,
+								 LibRpBase::RomData	*romData) G_GNUC_INTERNAL;
+#endif /* __cplusplus */
 
 G_END_DECLS
 
@@ -23,6 +23,8 @@ static void   rom_properties_provider_page_provider_init	(ThunarxPropertyPagePro
 static GList *rom_properties_provider_get_pages			(ThunarxPropertyPageProvider      *renamer_provider,
 								 GList                            *files);
 
+static RomData *rom_properties_open_romData			(ThunarxFileInfo *info);
+
 struct _RomPropertiesProviderClass {
 	GObjectClass __parent__;
 };
@@ -89,12 +91,19 @@ rom_properties_provider_get_pages(ThunarxPropertyPageProvider *page_provider, GL
 
 	info = THUNARX_FILE_INFO(file->data);
 
-	if (G_LIKELY(rom_properties_get_file_supported(info))) {
+	RomData *const romData = rom_properties_open_romData(info);
+	if (G_LIKELY(romData != nullptr)) {
 		// Create the ROM Properties page.
 		RomPropertiesPage *page = rom_properties_page_new();
 
 		/* Assign supported file info to the page */
-		rom_properties_page_set_file(page, info);
+		// The RomData object is passed to the page so the
+		// file doesn't have to be opened and parsed again.
+		rom_properties_page_set_file_with_romData(page, info, romData);
+
+		// RomDataView takes a reference to the RomData object.
+		// We don't need to hold on to it.
+		romData->unref();
 
 		/* Add the page to the pages provided by this plugin */
 		pages = g_list_prepend(pages, page);
@@ -103,16 +112,20 @@ rom_properties_provider_get_pages(ThunarxPropertyPageProvider *page_provider, GL
 	return pages;
 }
 
-gboolean
-rom_properties_get_file_supported(ThunarxFileInfo *info)
+/**
+ * Open a file and create a RomData object for it.
+ * @param info ThunarxFileInfo
+ * @return RomData object if the file is supported (caller must unref()); nullptr if not.
+ */
+static RomData*
+rom_properties_open_romData(ThunarxFileInfo *info)
 {
-	gboolean supported = false;
-	g_return_val_if_fail(info != nullptr || THUNARX_IS_FILE_INFO (info), false);
+	g_return_val_if_fail(info != nullptr || THUNARX_IS_FILE_INFO (info), nullptr);
 
 	gchar *const uri = thunarx_file_info_get_uri(info);
 	if (G_UNLIKELY(uri == nullptr)) {
 		// No URI...
-		return false;
+		return nullptr;
 	}
 
 	// TODO: Check file extensions and/or MIME types?
@@ -131,18 +144,16 @@ rom_properties_get_file_supported(ThunarxFileInfo *info)
 	g_free(uri);
 
 	// Open the ROM file.
+	RomData *romData = nullptr;
 	if (file->isOpen()) {
 		// Is this ROM file supported?
 		// NOTE: We have to create an instance here in order to
 		// prevent false positives caused by isRomSupported()
 		// saying "yes" while new RomData() says "no".
-		RomData *const romData = RomDataFactory::create(file);
-		if (romData != nullptr) {
-			supported = true;
-			romData->unref();
-		}
+		// The instance is returned so RomDataView can use it.
+		romData = RomDataFactory::create(file);
 	}
-	file->unref();
+	file->unref();	// file is ref()'d by RomData.
 
-	return supported;
+	return romData;
 }
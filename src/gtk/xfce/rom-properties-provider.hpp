@@ -34,8 +34,6 @@ typedef struct _RomPropertiesProvider		RomPropertiesProvider;
 GType		rom_properties_provider_get_type	(void) G_GNUC_CONST G_GNUC_INTERNAL;
 void		rom_properties_provider_register_type	(ThunarxProviderPlugin *plugin) G_GNUC_INTERNAL;
 
-gboolean	rom_properties_get_file_supported	(ThunarxFileInfo *info) G_GNUC_INTERNAL;
-
 G_END_DECLS
 
 #endif /* !__ROMPROPERTIES_XFCE_ROM_PROPERTIES_PROVIDER_HPP__ */
@@ -0,0 +1,59 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (KDE4/KF5)                         *
+ * RomDataLoader.cpp: Background loader for RomDataView.                   *
+ *                                                                         *
+ * Copyright (c) 2020 by David Korth.                                      *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "RomDataLoader.hpp"
+
+// librpbase, librptexture
+using LibRpBase::RomData;
+using LibRpTexture::rp_image;
+
+RomDataLoader::RomDataLoader(RomData *romData, QObject *parent)
+	: super(parent)
+	, m_romData(romData->ref())
+	, m_fields(nullptr)
+{
+	m_timer.start();
+
+	// The loader deletes itself when the thread finishes.
+	connect(this, SIGNAL(finished()), this, SLOT(deleteLater()));
+}
+
+RomDataLoader::~RomDataLoader()
+{
+	m_romData->unref();
+}
+
+/**
+ * Load the fields and images.
+ */
+void RomDataLoader::run(void)
+{
+	// Load the fields.
+	m_fields = m_romData->fields();
+	emit fieldsLoaded();
+
+	// Load the images. RomData caches these, so the
+	// UI thread doesn't have to access the file.
+	const uint32_t imgbf = m_romData->supportedImageTypes();
+	if (imgbf & RomData::IMGBF_INT_BANNER) {
+		m_romData->image(RomData::IMG_INT_BANNER);
+	}
+	if (imgbf & RomData::IMGBF_INT_ICON) {
+		const rp_image *const icon = m_romData->image(RomData::IMG_INT_ICON);
+		if (icon && icon->isValid()) {
+			m_romData->iconAnimData();
+		}
+	}
+
+	// Close the file.
+	// Keeping the file open may prevent the user from
+	// changing the file.
+	m_romData->close();
+	emit imagesLoaded();
+}
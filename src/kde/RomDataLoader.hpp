@@ -0,0 +1,93 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (KDE4/KF5)                         *
+ * RomDataLoader.hpp: Background loader for RomDataView.                   *
+ *                                                                         *
+ * Copyright (c) 2020 by David Korth.                                      *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_KDE_ROMDATALOADER_HPP__
+#define __ROMPROPERTIES_KDE_ROMDATALOADER_HPP__
+
+namespace LibRpBase {
+	class RomData;
+	class RomFields;
+}
+
+// Qt includes.
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QThread>
+
+/**
+ * Loads a RomData object's fields and images on a worker thread.
+ *
+ * fieldsLoaded() is emitted once RomData::fields() has been loaded.
+ * imagesLoaded() is emitted once the internal banner and icon have
+ * been loaded and the file has been closed.
+ *
+ * The RomData object is ref()'d for the lifetime of the loader.
+ * Once fieldsLoaded() has been emitted, the worker thread only
+ * loads images, so the UI thread can read the header information
+ * and the fields returned by fields() while the images are being
+ * loaded. The UI thread must not call RomData::fields() itself.
+ *
+ * NOTE: The loader deletes itself when the thread finishes.
+ * Disconnect its signals if the results are no longer needed.
+ */
+class RomDataLoader : public QThread
+{
+	Q_OBJECT
+
+	public:
+		explicit RomDataLoader(LibRpBase::RomData *romData, QObject *parent = nullptr);
+		virtual ~RomDataLoader();
+
+	private:
+		typedef QThread super;
+		Q_DISABLE_COPY(RomDataLoader)
+
+	protected:
+		/**
+		 * Load the fields and images.
+		 */
+		void run(void) final;
+
+	public:
+		/**
+		 * Get the number of milliseconds since the loader was created.
+		 * @return Elapsed time, in milliseconds.
+		 */
+		qint64 elapsed(void) const
+		{
+			return m_timer.elapsed();
+		}
+
+		/**
+		 * Get the fields that were loaded by the worker thread.
+		 * This is valid once fieldsLoaded() has been emitted.
+		 * The fields are owned by the RomData object.
+		 * @return Fields, or nullptr if they haven't been loaded yet.
+		 */
+		const LibRpBase::RomFields *fields(void) const
+		{
+			return m_fields;
+		}
+
+	signals:
+		/**
+		 * The fields have been loaded.
+		 */
+		void fieldsLoaded(void);
+
+		/**
+		 * The internal images have been loaded.
+		 */
+		void imagesLoaded(void);
+
+	private:
+		LibRpBase::RomData *m_romData;
+		const LibRpBase::RomFields *m_fields;
+		QElapsedTimer m_timer;
+};
+
+#endif /* __ROMPROPERTIES_KDE_ROMDATALOADER_HPP__ */
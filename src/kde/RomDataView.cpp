@@ -8,6 +8,7 @@
 
 #include "stdafx.h"
 #include "RomDataView.hpp"
+#include "RomDataLoader.hpp"
 #include "RpQImageBackend.hpp"
 
 // librpbase, librptexture
@@ -34,6 +35,17 @@ using std::vector;
 #endif /* QT_VERSION >= QT_VERSION_CHECK(5,0,0) */
 
 #include "ui_RomDataView.h"
+
+// Background loader timing messages.
+// These are disabled by default. To enable them, set:
+// QT_LOGGING_RULES="rom-properties.romdataview.debug=true"
+#if QT_VERSION >= QT_VERSION_CHECK(5,4,0)
+# include <QtCore/QLoggingCategory>
+Q_LOGGING_CATEGORY(lcRomDataView, "rom-properties.romdataview", QtInfoMsg)
+# define LOADER_DEBUG(...) qCDebug(lcRomDataView, __VA_ARGS__)
+#else /* QT_VERSION < QT_VERSION_CHECK(5,4,0) */
+# define LOADER_DEBUG(...) do { } while (0)
+#endif /* QT_VERSION >= QT_VERSION_CHECK(5,4,0) */
 class RomDataViewPrivate
 {
 	public:
@@ -74,12 +86,23 @@ class RomDataViewPrivate
 		// RomData object.
 		RomData *romData;
 
+		// Background loader for romData.
+		// NOTE: The loader deletes itself when it's finished.
+		RomDataLoader *loader;
+
 		/**
 		 * Initialize the header row widgets.
 		 * The widgets must have already been created by ui.setupUi().
+		 * The banner and icon are initialized by initHeaderImages().
 		 */
 		void initHeaderRow(void);
 
+		/**
+		 * Initialize the banner and icon in the header row.
+		 * The images must have already been loaded by the loader.
+		 */
+		void initHeaderImages(void);
+
 		/**
 		 * Clear a QLayout.
 		 * @param layout QLayout.
@@ -164,8 +187,24 @@ class RomDataViewPrivate
 		 * Initialize the display widgets.
 		 * If the widgets already exist, they will
 		 * be deleted and recreated.
+		 *
+		 * The fields and images are loaded on a worker thread.
+		 * initFields() and initHeaderImages() are called
+		 * once the loader has finished each stage.
 		 */
 		void initDisplayWidgets(void);
+
+		/**
+		 * Initialize the header row text and the fields.
+		 * @param pFields Fields from romData, loaded by the loader.
+		 */
+		void initFields(const RomFields *pFields);
+
+		/**
+		 * Stop receiving results from the background loader.
+		 * The loader will finish on its own and delete itself.
+		 */
+		void disconnectLoader(void);
 };
 
 /** RomDataViewPrivate **/
@@ -174,7 +213,8 @@ RomDataViewPrivate::RomDataViewPrivate(RomDataView *q, RomData *romData)
 	: q_ptr(q)
 	, def_lc(0)
 	, cboLanguage(nullptr)
-	, romData(romData->ref())
+	, romData(romData ? romData->ref() : nullptr)
+	, loader(nullptr)
 {
 	// Register RpQImageBackend.
 	// TODO: Static initializer somewhere?
@@ -183,6 +223,7 @@ RomDataViewPrivate::RomDataViewPrivate(RomDataView *q, RomData *romData)
 
 RomDataViewPrivate::~RomDataViewPrivate()
 {
+	disconnectLoader();
 	ui.lblIcon->clearRp();
 	ui.lblBanner->clearRp();
 	if (romData) {
@@ -223,6 +264,20 @@ void RomDataViewPrivate::initHeaderRow(void)
 		C_("RomDataView", "%1$s\n%2$s"), systemName, fileType));
 	ui.lblSysInfo->setText(sysInfo);
 	ui.lblSysInfo->show();
+}
+
+/**
+ * Initialize the banner and icon in the header row.
+ * The images must have already been loaded by the loader.
+ */
+void RomDataViewPrivate::initHeaderImages(void)
+{
+	if (!romData) {
+		// No ROM data.
+		ui.lblBanner->hide();
+		ui.lblIcon->hide();
+		return;
+	}
 
 	// Supported image types.
 	const uint32_t imgbf = romData->supportedImageTypes();
@@ -1040,6 +1095,39 @@ void RomDataViewPrivate::initDisplayWidgets(void)
 	ui.tabWidget->clear();
 	ui.tabWidget->hide();
 
+	// Clear the banner and icon.
+	ui.lblIcon->stopAnimTimer();
+	ui.lblIcon->clearRp();
+	ui.lblIcon->hide();
+	ui.lblBanner->clearRp();
+	ui.lblBanner->hide();
+
+	// Discard results from the previous loader, if it's still running.
+	disconnectLoader();
+
+	if (!romData) {
+		// No ROM data to display.
+		initHeaderRow();
+		return;
+	}
+
+	// Load the fields and images on a worker thread.
+	// The header row is initialized once the fields are loaded.
+	Q_Q(RomDataView);
+	loader = new RomDataLoader(romData);
+	QObject::connect(loader, SIGNAL(fieldsLoaded()),
+			 q, SLOT(romDataLoader_fieldsLoaded_slot()));
+	QObject::connect(loader, SIGNAL(imagesLoaded()),
+			 q, SLOT(romDataLoader_imagesLoaded_slot()));
+	loader->start();
+}
+
+/**
+ * Initialize the header row text and the fields.
+ * @param pFields Fields from romData, loaded by the loader.
+ */
+void RomDataViewPrivate::initFields(const RomFields *pFields)
+{
 	// Initialize the header row.
 	initHeaderRow();
 
@@ -1048,8 +1136,8 @@ void RomDataViewPrivate::initDisplayWidgets(void)
 		return;
 	}
 
-	// Get the fields.
-	const RomFields *const pFields = romData->fields();
+	// NOTE: Don't call romData->fields() here, since the
+	// loader may still be loading images on its thread.
 	assert(pFields != nullptr);
 	if (!pFields) {
 		// No fields.
@@ -1189,10 +1277,22 @@ void RomDataViewPrivate::initDisplayWidgets(void)
 		adjustListData(static_cast<int>(tabs.size()-1));
 	}
 
-	// Close the file.
-	// Keeping the file open may prevent the user from
-	// changing the file.
-	romData->close();
+	// NOTE: The file is closed by the loader once
+	// the images have been loaded.
+}
+
+/**
+ * Stop receiving results from the background loader.
+ * The loader will finish on its own and delete itself.
+ */
+void RomDataViewPrivate::disconnectLoader(void)
+{
+	if (!loader)
+		return;
+
+	Q_Q(RomDataView);
+	QObject::disconnect(loader, nullptr, q, nullptr);
+	loader = nullptr;
 }
 
 /** RomDataView **/
@@ -1215,6 +1315,7 @@ RomDataView::RomDataView(RomData *romData, QWidget *parent)
 	d->ui.setupUi(this);
 
 	// Initialize the display widgets.
+	// The fields and images are loaded on a worker thread.
 	d->initDisplayWidgets();
 }
 
@@ -1383,25 +1484,59 @@ void RomDataView::setRomData(RomData *romData)
 	if (d->romData == romData)
 		return;
 
-	bool prevAnimTimerRunning = d->ui.lblIcon->isAnimTimerRunning();
-	if (prevAnimTimerRunning) {
-		// Animation is running.
-		// Stop it temporarily and reset the frame number.
-		d->ui.lblIcon->stopAnimTimer();
-		d->ui.lblIcon->resetAnimFrame();
-	}
-
+	// NOTE: initDisplayWidgets() stops the animation timer.
+	// It will be restarted once the new icon has been loaded.
 	if (d->romData) {
 		d->romData->unref();
 	}
 	d->romData = (romData ? romData->ref() : nullptr);
 	d->initDisplayWidgets();
 
-	if (romData != nullptr && prevAnimTimerRunning) {
-		// Restart the animation timer.
-		// FIXME: Ensure frame 0 is drawn?
+	emit romDataChanged(romData);
+}
+
+/** RomDataLoader slots. **/
+
+/**
+ * The background loader has loaded the fields.
+ */
+void RomDataView::romDataLoader_fieldsLoaded_slot(void)
+{
+	Q_D(RomDataView);
+	RomDataLoader *const loader = qobject_cast<RomDataLoader*>(sender());
+	if (!loader || loader != d->loader) {
+		// Results from an old loader.
+		return;
+	}
+
+	// Create the header row and field widgets.
+	d->initFields(loader->fields());
+	LOADER_DEBUG("RomDataView: fields displayed after %lld ms",
+		static_cast<long long>(loader->elapsed()));
+}
+
+/**
+ * The background loader has loaded the images.
+ */
+void RomDataView::romDataLoader_imagesLoaded_slot(void)
+{
+	Q_D(RomDataView);
+	RomDataLoader *const loader = qobject_cast<RomDataLoader*>(sender());
+	if (!loader || loader != d->loader) {
+		// Results from an old loader.
+		return;
+	}
+
+	// Initialize the banner and icon.
+	d->initHeaderImages();
+	if (isVisible()) {
+		// The page was shown before the icon was loaded,
+		// so showEvent() didn't start the animation timer.
 		d->ui.lblIcon->startAnimTimer();
 	}
+	LOADER_DEBUG("RomDataView: images displayed after %lld ms",
+		static_cast<long long>(loader->elapsed()));
 
-	emit romDataChanged(romData);
+	// The loader is finished with this RomData object.
+	d->loader = nullptr;
 }
@@ -72,6 +72,18 @@ class RomDataView : public QWidget
 		 */
 		void cboLanguage_currentIndexChanged_slot(int index);
 
+		/** RomDataLoader slots. **/
+
+		/**
+		 * The background loader has loaded the fields.
+		 */
+		void romDataLoader_fieldsLoaded_slot(void);
+
+		/**
+		 * The background loader has loaded the images.
+		 */
+		void romDataLoader_imagesLoaded_slot(void);
+
 	public:
 		/** Properties. **/
 
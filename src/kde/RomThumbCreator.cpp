@@ -25,6 +25,7 @@ using LibRomData::RomDataFactory;
 // so we have to #include the .cpp file here.
 #include "libromdata/img/TCreateThumbnail.cpp"
 using LibRomData::TCreateThumbnail;
+using LibRomData::CacheManager;
 
 // C++ STL classes.
 using std::string;
@@ -318,6 +319,11 @@ Q_DECL_EXPORT int rp_create_thumbnail(const char *source_file, const char *outpu
 		return RPCT_OUTPUT_FILE_FAILED;
 	}
 
+	// Thumbnails are encoded often and decoded rarely,
+	// so the fast profile is used by default.
+	pngWriter->setProfile(static_cast<RpPngWriter::Profile>(
+		Config::instance()->thumbnailPngProfile()));
+
 	// Software.
 	static const char sw[] = "ROM Properties Page shell extension (" RP_KDE_UPPER QT_MAJOR_STR ")";
 	kv.emplace_back("Software", sw);
@@ -410,3 +416,35 @@ Q_DECL_EXPORT int rp_create_thumbnail(const char *source_file, const char *outpu
 	romData->unref();
 	return ret;
 }
+
+/**
+ * External image download statistics for wrapper programs.
+ * Statistics are combined for all request types.
+ * Only downloads that ran rp-download are counted.
+ * @param buckets	[out] Latency histogram. Bucket i counts downloads that took less than (1 << i) ms.
+ * @param bucket_count	[in] Number of buckets. (must be 16)
+ * @param count		[out] Number of downloads.
+ * @param failed	[out] Number of downloads where no file was downloaded.
+ * @param total_ms	[out] Total time, in milliseconds.
+ * @param max_ms	[out] Slowest download, in milliseconds.
+ * @return 0 on success; non-zero on error.
+ */
+extern "C"
+Q_DECL_EXPORT int rp_get_download_stats(uint32_t *buckets, unsigned int bucket_count,
+	uint32_t *count, uint32_t *failed, uint64_t *total_ms, uint32_t *max_ms)
+{
+	if (!buckets || bucket_count != CacheManager::LatencyHistogram::BUCKET_COUNT ||
+	    !count || !failed || !total_ms || !max_ms)
+	{
+		return -EINVAL;
+	}
+
+	CacheManager::LatencyHistogram hist;
+	CacheManager::getTotalLatencyHistogram(&hist);
+	memcpy(buckets, hist.buckets, sizeof(hist.buckets));
+	*count = hist.count;
+	*failed = hist.failed;
+	*total_ms = hist.total_ms;
+	*max_ms = hist.max_ms;
+	return 0;
+}
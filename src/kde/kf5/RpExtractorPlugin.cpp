@@ -14,6 +14,7 @@
 #include "RpExtractorPlugin.hpp"
 
 // librpbase, librpfile
+#include "librpbase/RomDataCache.hpp"
 using namespace LibRpBase;
 using LibRpFile::IRpFile;
 
@@ -26,6 +27,7 @@ using std::string;
 using std::vector;
 
 // Qt includes.
+#include <QtCore/QDir>
 #include <QtCore/QStandardPaths>
 
 // KDE includes.
@@ -80,27 +82,61 @@ QStringList RpExtractorPlugin::mimetypes(void) const
 
 void RpExtractorPlugin::extract(ExtractionResult *result)
 {
-	// Attempt to open the ROM file.
-	IRpFile *const file = openQUrl(QUrl(result->inputUrl()), false);
-	if (!file) {
-		// Could not open the file.
-		return;
+	// Check the RomData cache first.
+	// NOTE: Only local files are cached.
+	const QString inputUrl = result->inputUrl();
+	QByteArray localFile;
+	if (QDir::isAbsolutePath(inputUrl)) {
+		localFile = inputUrl.toUtf8();
+	} else {
+		const QUrl url(inputUrl);
+		if (url.isLocalFile()) {
+			localFile = url.toLocalFile().toUtf8();
+		}
 	}
 
-	// Get the appropriate RomData class for this ROM.
-	// file is dup()'d by RomData.
-	RomData *const romData = RomDataFactory::create(file, RomDataFactory::RDA_HAS_METADATA);
-	file->unref();	// file is ref()'d by RomData.
-	if (!romData) {
-		// ROM is not supported.
-		return;
+	RomData *romData = nullptr;
+	RomMetaData cachedMetaData;
+	const RomMetaData *metaData;
+	if (!localFile.isEmpty() &&
+	    RomDataCache::load(localFile.constData(), nullptr, &cachedMetaData) == 0)
+	{
+		// Cached metadata found. The ROM doesn't need to be parsed.
+		metaData = &cachedMetaData;
+	} else {
+		// Attempt to open the ROM file.
+		IRpFile *const file = openQUrl(QUrl(inputUrl), false);
+		if (!file) {
+			// Could not open the file.
+			return;
+		}
+
+		// Get the appropriate RomData class for this ROM.
+		// file is dup()'d by RomData.
+		romData = RomDataFactory::create(file, RomDataFactory::RDA_HAS_METADATA);
+		file->unref();	// file is ref()'d by RomData.
+		if (!romData) {
+			// ROM is not supported.
+			return;
+		}
+
+		// Get the metadata properties.
+		metaData = romData->metaData();
+		if (!localFile.isEmpty()) {
+			// Cache the metadata, even if it's empty.
+			// NOTE: Fields aren't needed here, and they
+			// would have to be parsed separately.
+			RomMetaData emptyMetaData;
+			RomDataCache::store(localFile.constData(), nullptr,
+				metaData ? metaData : &emptyMetaData);
+		}
 	}
 
-	// Get the metadata properties.
-	const RomMetaData *const metaData = romData->metaData();
 	if (!metaData || metaData->empty()) {
 		// No metadata properties.
-		romData->unref();
+		if (romData) {
+			romData->unref();
+		}
 		return;
 	}
 
@@ -162,7 +198,9 @@ void RpExtractorPlugin::extract(ExtractionResult *result)
 	}
 
 	// Finished extracting metadata.
-	romData->unref();
+	if (romData) {
+		romData->unref();
+	}
 }
 
 }
@@ -63,7 +63,14 @@ class Xbox360_XDBF_Private : public RomDataPrivate
 
 		// Entry table.
 		// NOTE: Data is *not* byteswapped on load.
-		ao::uvector<XDBF_Entry> entryTable;
+		// If the file owns its memory mapping, this points
+		// directly into the file data, and entryTableFile holds
+		// a reference to the file to keep the data valid.
+		// Otherwise, this points into entryTableBuf.
+		const XDBF_Entry *entryTable;
+		unsigned int entryCount;
+		ao::uvector<XDBF_Entry> entryTableBuf;
+		IRpFile *entryTableFile;
 
 		// Data start offset within the file.
 		uint32_t data_offset;
@@ -175,6 +182,9 @@ class Xbox360_XDBF_Private : public RomDataPrivate
 Xbox360_XDBF_Private::Xbox360_XDBF_Private(Xbox360_XDBF *q, IRpFile *file, bool xex)
 	: super(q, file)
 	, img_icon(nullptr)
+	, entryTable(nullptr)
+	, entryCount(0)
+	, entryTableFile(nullptr)
 	, data_offset(0)
 	, m_langID(XDBF_LANGUAGE_UNKNOWN)
 	, xex(xex)
@@ -188,6 +198,10 @@ Xbox360_XDBF_Private::Xbox360_XDBF_Private(Xbox360_XDBF *q, IRpFile *file, bool
 
 Xbox360_XDBF_Private::~Xbox360_XDBF_Private()
 {
+	if (entryTableFile) {
+		entryTableFile->unref();
+	}
+
 	// Delete any allocated string tables.
 	std::for_each(strTbls.begin(), strTbls.end(), [](ao::uvector<char>* pStrTbl) { delete pStrTbl; });
 
@@ -207,7 +221,7 @@ Xbox360_XDBF_Private::~Xbox360_XDBF_Private()
  */
 const XDBF_Entry *Xbox360_XDBF_Private::findResource(uint16_t namespace_id, uint64_t resource_id) const
 {
-	if (entryTable.empty()) {
+	if (entryCount == 0) {
 		// Entry table isn't loaded...
 		return nullptr;
 	}
@@ -218,14 +232,15 @@ const XDBF_Entry *Xbox360_XDBF_Private::findResource(uint16_t namespace_id, uint
 	resource_id  = cpu_to_be64(resource_id);
 #endif /* SYS_BYTEORDER == SYS_LIL_ENDIAN */
 
-	auto iter = std::find_if(entryTable.cbegin(), entryTable.cend(),
+	const XDBF_Entry *const pEnd = &entryTable[entryCount];
+	const XDBF_Entry *const iter = std::find_if(entryTable, pEnd,
 		[namespace_id, resource_id](const XDBF_Entry &p) {
 			return (p.namespace_id == namespace_id &&
 				p.resource_id == resource_id);
 		}
 	);
 
-	return (iter != entryTable.cend() ? &(*iter) : nullptr);
+	return (iter != pEnd ? iter : nullptr);
 }
 
 /**
@@ -238,7 +253,7 @@ int Xbox360_XDBF_Private::initStrTblIndexes(void)
 	// Clear the array first.
 	strTblIndexes.fill(-1);
 
-	if (entryTable.empty()) {
+	if (entryCount == 0) {
 		// Entry table isn't loaded...
 		return -EIO;
 	}
@@ -246,8 +261,9 @@ int Xbox360_XDBF_Private::initStrTblIndexes(void)
 	// Go through the entry table.
 	unsigned int total = 0;
 	int16_t idx = 0;
-	for (auto iter = entryTable.cbegin();
-	     iter != entryTable.cend() && total < XDBF_LANGUAGE_MAX; ++iter, idx++)
+	const XDBF_Entry *const pEnd = &entryTable[entryCount];
+	for (const XDBF_Entry *iter = entryTable;
+	     iter != pEnd && total < XDBF_LANGUAGE_MAX; ++iter, idx++)
 	{
 		if (iter->namespace_id != cpu_to_be16(XDBF_SPA_NAMESPACE_STRING_TABLE))
 			continue;
@@ -297,8 +313,8 @@ const ao::uvector<char> *Xbox360_XDBF_Private::loadStringTable(XDBF_Language_e l
 	// String table index should already be loaded.
 	int16_t idx = strTblIndexes[langID];
 	assert(idx >= 0);
-	assert(idx < (uint16_t)entryTable.size());
-	if (idx < 0 || idx >= (uint16_t)entryTable.size()) {
+	assert(idx < (int)entryCount);
+	if (idx < 0 || idx >= (int)entryCount) {
 		// Out of range...
 		return nullptr;
 	}
@@ -529,7 +545,7 @@ rp_image *Xbox360_XDBF_Private::loadImage(uint64_t image_id)
 		return iter->second;
 	}
 
-	if (entryTable.empty()) {
+	if (entryCount == 0) {
 		// Entry table isn't loaded...
 		return nullptr;
 	}
@@ -598,7 +614,7 @@ const rp_image *Xbox360_XDBF_Private::loadIcon(void)
 	}
 
 	// Make sure the entry table is loaded.
-	if (entryTable.empty()) {
+	if (entryCount == 0) {
 		// Not loaded. Cannot load an icon.
 		return nullptr;
 	}
@@ -733,7 +749,7 @@ int Xbox360_XDBF_Private::addFields_strings(RomFields *fields) const
  */
 int Xbox360_XDBF_Private::addFields_achievements(void)
 {
-	if (entryTable.empty()) {
+	if (entryCount == 0) {
 		// Entry table isn't loaded...
 		return 1;
 	}
@@ -933,7 +949,7 @@ int Xbox360_XDBF_Private::addFields_achievements(void)
  */
 int Xbox360_XDBF_Private::addFields_avatarAwards(void)
 {
-	if (entryTable.empty()) {
+	if (entryCount == 0) {
 		// Entry table isn't loaded...
 		return 1;
 	}
@@ -1251,12 +1267,23 @@ void Xbox360_XDBF::init(void)
 	}
 
 	// Read the entry table.
+	// If the file owns its memory mapping, the entry table
+	// is used in place instead of being copied. Otherwise,
+	// e.g. for an RpMemFile whose buffer is owned by the
+	// caller, the entry table must be copied.
 	const size_t entry_table_sz = d->xdbfHeader.entry_table_length * sizeof(XDBF_Entry);
-	d->entryTable.resize(d->xdbfHeader.entry_table_length);
-	size = d->file->read(d->entryTable.data(), entry_table_sz);
+	const void *pEntryTable = nullptr;
+	const bool isMapped = d->file->ownsMapping();
+	if (isMapped) {
+		size = d->file->seekAndMap(sizeof(d->xdbfHeader), &pEntryTable, nullptr, entry_table_sz);
+	} else {
+		d->entryTableBuf.resize(d->xdbfHeader.entry_table_length);
+		pEntryTable = d->entryTableBuf.data();
+		size = d->file->seekAndRead(sizeof(d->xdbfHeader), d->entryTableBuf.data(), entry_table_sz);
+	}
 	if (size != entry_table_sz) {
 		// Read error.
-		d->entryTable.clear();
+		d->entryTableBuf.clear();
 		d->xdbfHeader.magic = 0;
 		d->file->unref();
 		d->file = nullptr;
@@ -1264,6 +1291,14 @@ void Xbox360_XDBF::init(void)
 		return;
 	}
 
+	d->entryTable = static_cast<const XDBF_Entry*>(pEntryTable);
+	d->entryCount = d->xdbfHeader.entry_table_length;
+	if (isMapped) {
+		// Entry table is in the file's mapped memory.
+		// Keep a reference to the file so it stays valid.
+		d->entryTableFile = d->file->ref();
+	}
+
 	// Initialize the string table indexes.
 	d->initStrTblIndexes();
 }
@@ -117,9 +117,9 @@ int RpTextureWrapper::isRomSupported_static(const DetectInfo *info)
 		return -1;
 	}
 
-	// TODO: FileFormatFactory::isTextureSupported()
-	// For now, delegate to FileFormatFactory::create().
-	return 0;
+	// Check the magic numbers.
+	// FileFormatFactory::create() will do the actual validation.
+	return FileFormatFactory::isTextureSupported(info->header.pData, info->header.size);
 }
 
 /**
@@ -345,4 +345,32 @@ int RpTextureWrapper::loadInternalImage(ImageType imageType, const rp_image **pI
 		d->texture->image);	// func
 }
 
+/**
+ * Get an internal image from the ROM for a thumbnail.
+ *
+ * The smallest mipmap that is at least reqSize pixels
+ * in its largest dimension is returned, so large textures
+ * don't have to be decoded at full size.
+ *
+ * @param imageType	[in] Image type to load.
+ * @param reqSize	[in] Requested thumbnail size. (0 for the full image)
+ * @param pFullSize	[out,opt] Dimensions of the full image: [w, h]
+ * @return Internal image, or nullptr if the ROM doesn't have one.
+ */
+const rp_image *RpTextureWrapper::imageForSize(ImageType imageType, int reqSize, int pFullSize[2]) const
+{
+	RP_D(const RpTextureWrapper);
+	if (imageType != IMG_INT_IMAGE || !d->file || !d->isValid) {
+		// Use the default implementation.
+		return super::imageForSize(imageType, reqSize, pFullSize);
+	}
+
+	const rp_image *const img = d->texture->mipmapForSize(reqSize);
+	if (img && pFullSize) {
+		pFullSize[0] = d->texture->width();
+		pFullSize[1] = d->texture->height();
+	}
+	return img;
+}
+
 }
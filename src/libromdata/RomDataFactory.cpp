@@ -176,6 +176,69 @@ class RomDataFactoryPrivate
 		 */
 		static RomData *openDreamcastVMSandVMI(IRpFile *file);
 
+		// Detection index for romDataFns_magic[].
+		// Sorted by address, then magic number, then table index,
+		// so all entries for an (address, magic) pair are adjacent.
+		struct MagicIndex {
+			uint32_t address;
+			uint32_t magic;
+			unsigned int idx;	// Index in romDataFns_magic[]
+
+			inline bool operator<(const MagicIndex &other) const
+			{
+				if (address != other.address)
+					return (address < other.address);
+				if (magic != other.magic)
+					return (magic < other.magic);
+				return (idx < other.idx);
+			}
+		};
+		static vector<MagicIndex> vec_magicIndex;
+		// Distinct magic number addresses, sorted.
+		static vector<uint32_t> vec_magicAddrs;
+
+		// File extension index for romDataFns_header[] entries
+		// with non-zero addresses and for romDataFns_footer[].
+		// Key: Lowercase file extension, including the leading dot.
+		struct ExtCandidates {
+			// True if any romDataFns_header[] entry with a
+			// non-zero address lists this extension.
+			bool header_addr;
+			// romDataFns_footer[] entries that list this extension.
+			vector<const RomDataFns*> footer;
+
+			ExtCandidates() : header_addr(false) { }
+		};
+		static unordered_map<string, ExtCandidates> map_extCandidates;
+
+		// pthread_once() control variable.
+		static pthread_once_t once_detectIndex;
+
+		/**
+		 * Initialize the detection index.
+		 * Used by RomDataFactory::create().
+		 *
+		 * Internal function; must be called using pthread_once().
+		 */
+		static void init_detectIndex(void);
+
+		/**
+		 * Get header data for RomData::DetectInfo.
+		 *
+		 * If the file is memory-backed, this returns a pointer
+		 * directly into the file's data. Otherwise, or if the
+		 * data isn't suitably aligned for header structs, the
+		 * data is copied into buf.
+		 *
+		 * @param file	[in] ROM file.
+		 * @param addr	[in] Header address.
+		 * @param buf	[in] Fallback buffer. (must be at least size bytes)
+		 * @param size	[in] Header size.
+		 * @param ppData [out] Header data.
+		 * @return Number of bytes available at *ppData, or 0 on error.
+		 */
+		static size_t mapHeader(IRpFile *file, off64_t addr, uint8_t *buf, size_t size, const uint8_t **ppData);
+
 		// Vectors for file extensions and MIME types.
 		// We want to collect them once per session instead of
 		// repeatedly collecting them, since the caller might
@@ -224,6 +287,11 @@ vector<const char*> RomDataFactoryPrivate::vec_mimeTypes;
 pthread_once_t RomDataFactoryPrivate::once_exts = PTHREAD_ONCE_INIT;
 pthread_once_t RomDataFactoryPrivate::once_mimeTypes = PTHREAD_ONCE_INIT;
 
+vector<RomDataFactoryPrivate::MagicIndex> RomDataFactoryPrivate::vec_magicIndex;
+vector<uint32_t> RomDataFactoryPrivate::vec_magicAddrs;
+unordered_map<string, RomDataFactoryPrivate::ExtCandidates> RomDataFactoryPrivate::map_extCandidates;
+pthread_once_t RomDataFactoryPrivate::once_detectIndex = PTHREAD_ONCE_INIT;
+
 #define ATTR_NONE		RomDataFactory::RDA_NONE
 #define ATTR_HAS_THUMBNAIL	RomDataFactory::RDA_HAS_THUMBNAIL
 #define ATTR_HAS_DPOVERLAY	RomDataFactory::RDA_HAS_DPOVERLAY
@@ -352,6 +420,66 @@ const RomDataFactoryPrivate::RomDataFns *const RomDataFactoryPrivate::romDataFns
 	nullptr
 };
 
+/**
+ * Initialize the detection index.
+ * Used by RomDataFactory::create().
+ *
+ * Internal function; must be called using pthread_once().
+ */
+void RomDataFactoryPrivate::init_detectIndex(void)
+{
+	// Magic number index.
+	vec_magicIndex.reserve(ARRAY_SIZE(romDataFns_magic));
+	const RomDataFns *fns = &romDataFns_magic[0];
+	for (unsigned int idx = 0; fns->supportedFileExtensions != nullptr; fns++, idx++) {
+		// NOTE: Magic numbers are read from the 4,096+256 header
+		// using 32-bit aligned accesses.
+		assert(fns->address % 4 == 0);
+		assert(fns->address + sizeof(uint32_t) <= 4096+256);
+
+		MagicIndex mi;
+		mi.address = fns->address;
+		mi.magic = fns->size;
+		mi.idx = idx;
+		vec_magicIndex.emplace_back(mi);
+
+		if (std::find(vec_magicAddrs.cbegin(), vec_magicAddrs.cend(), fns->address) == vec_magicAddrs.cend()) {
+			vec_magicAddrs.emplace_back(fns->address);
+		}
+	}
+	std::sort(vec_magicIndex.begin(), vec_magicIndex.end());
+	std::sort(vec_magicAddrs.begin(), vec_magicAddrs.end());
+
+	// File extension index.
+	// Headers with non-zero addresses are at the end of romDataFns_header[].
+	fns = &romDataFns_header[0];
+	for (; fns->supportedFileExtensions != nullptr; fns++) {
+		if (fns->address == 0)
+			continue;
+
+		const char *const *sys_exts = fns->supportedFileExtensions();
+		if (!sys_exts)
+			continue;
+		for (; *sys_exts != nullptr; sys_exts++) {
+			string ext(*sys_exts);
+			std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+			map_extCandidates[ext].header_addr = true;
+		}
+	}
+
+	fns = &romDataFns_footer[0];
+	for (; fns->supportedFileExtensions != nullptr; fns++) {
+		const char *const *sys_exts = fns->supportedFileExtensions();
+		if (!sys_exts)
+			continue;
+		for (; *sys_exts != nullptr; sys_exts++) {
+			string ext(*sys_exts);
+			std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+			map_extCandidates[ext].footer.emplace_back(fns);
+		}
+	}
+}
+
 /**
  * Attempt to open the other file in a Dreamcast .VMI+.VMS pair.
  * @param file One opened file in the .VMI+.VMS pair.
@@ -473,6 +601,43 @@ RomData *RomDataFactoryPrivate::checkISO(IRpFile *file)
 	return new ISO(file);
 }
 
+/**
+ * Get header data for RomData::DetectInfo.
+ *
+ * If the file is memory-backed, this returns a pointer
+ * directly into the file's data. Otherwise, or if the
+ * data isn't suitably aligned for header structs, the
+ * data is copied into buf.
+ *
+ * @param file	[in] ROM file.
+ * @param addr	[in] Header address.
+ * @param buf	[in] Fallback buffer. (must be at least size bytes)
+ * @param size	[in] Header size.
+ * @param ppData [out] Header data.
+ * @return Number of bytes available at *ppData, or 0 on error.
+ */
+size_t RomDataFactoryPrivate::mapHeader(IRpFile *file, off64_t addr, uint8_t *buf, size_t size, const uint8_t **ppData)
+{
+	const void *pData = nullptr;
+	size_t ret = file->seekAndMap(addr, &pData, buf, size);
+	if (ret == 0) {
+		// Seek and/or read error.
+		*ppData = buf;
+		return 0;
+	}
+
+	if (pData != buf && (reinterpret_cast<uintptr_t>(pData) & 7) != 0) {
+		// Mapped data isn't 64-bit aligned.
+		// Copy it to the buffer in case a subclass
+		// accesses header fields directly.
+		memcpy(buf, pData, ret);
+		pData = buf;
+	}
+
+	*ppData = static_cast<const uint8_t*>(pData);
+	return ret;
+}
+
 /** RomDataFactory **/
 
 /**
@@ -499,14 +664,15 @@ RomData *RomDataFactory::create(IRpFile *file, unsigned int attrs)
 
 	// Read 4,096+256 bytes from the ROM header.
 	// This should be enough to detect most systems.
+	// NOTE: If the file is memory-backed, info.header.pData
+	// points directly into the file data instead of header.
 	union {
 		uint8_t u8[4096+256];
 		uint32_t u32[(4096+256)/4];
 	} header;
-	file->rewind();
 	info.header.addr = 0;
-	info.header.pData = header.u8;
-	info.header.size = static_cast<uint32_t>(file->read(header.u8, sizeof(header.u8)));
+	info.header.size = static_cast<uint32_t>(RomDataFactoryPrivate::mapHeader(
+		file, 0, header.u8, sizeof(header.u8), &info.header.pData));
 	if (info.header.size == 0) {
 		// Read error.
 		return nullptr;
@@ -552,40 +718,66 @@ RomData *RomDataFactory::create(IRpFile *file, unsigned int attrs)
 		// Not a .VMI+.VMS pair.
 	}
 
+	// Make sure the detection index is initialized.
+	pthread_once(&RomDataFactoryPrivate::once_detectIndex, RomDataFactoryPrivate::init_detectIndex);
+
 	// Check RomData subclasses that take a header at 0
 	// and definitely have a 32-bit magic number in the header.
-	const RomDataFactoryPrivate::RomDataFns *fns =
-		&RomDataFactoryPrivate::romDataFns_magic[0];
-	for (; fns->supportedFileExtensions != nullptr; fns++) {
+	// The magic number index is used to find candidates, which
+	// are then checked in romDataFns_magic[] order.
+	unsigned int magic_idx[ARRAY_SIZE(RomDataFactoryPrivate::romDataFns_magic)];
+	unsigned int magic_idx_count = 0;
+	for (auto addr_iter = RomDataFactoryPrivate::vec_magicAddrs.cbegin();
+	     addr_iter != RomDataFactoryPrivate::vec_magicAddrs.cend(); ++addr_iter)
+	{
+		const uint32_t address = *addr_iter;
+		if (address + sizeof(uint32_t) > info.header.size) {
+			// Header is too small. Addresses are sorted,
+			// so none of the remaining addresses will fit.
+			break;
+		}
+
+		RomDataFactoryPrivate::MagicIndex key;
+		key.address = address;
+		memcpy(&key.magic, &info.header.pData[address], sizeof(key.magic));
+		key.magic = be32_to_cpu(key.magic);
+		key.idx = 0;
+		auto iter = std::lower_bound(RomDataFactoryPrivate::vec_magicIndex.cbegin(),
+			RomDataFactoryPrivate::vec_magicIndex.cend(), key);
+		for (; iter != RomDataFactoryPrivate::vec_magicIndex.cend() &&
+		       iter->address == key.address && iter->magic == key.magic; ++iter)
+		{
+			magic_idx[magic_idx_count++] = iter->idx;
+		}
+	}
+	if (magic_idx_count > 1) {
+		std::sort(&magic_idx[0], &magic_idx[magic_idx_count]);
+	}
+
+	for (unsigned int i = 0; i < magic_idx_count; i++) {
+		const RomDataFactoryPrivate::RomDataFns *const fns =
+			&RomDataFactoryPrivate::romDataFns_magic[magic_idx[i]];
 		if ((fns->attrs & attrs) != attrs) {
 			// This RomData subclass doesn't have the
 			// required attributes.
 			continue;
 		}
 
-		// Check the magic number.
-		// TODO: Verify alignment restrictions.
-		assert(fns->address % 4 == 0);
-		assert(fns->address + sizeof(uint32_t) <= sizeof(header.u32));
-		uint32_t magic = header.u32[fns->address/4];
-		if (be32_to_cpu(magic) == fns->size) {
-			// Found a matching magic number.
-			if (fns->isRomSupported(&info) >= 0) {
-				RomData *const romData = fns->newRomData(file);
-				if (romData->isValid()) {
-					// RomData subclass obtained.
-					return romData;
-				}
-
-				// Not actually supported.
-				romData->unref();
+		// Found a matching magic number.
+		if (fns->isRomSupported(&info) >= 0) {
+			RomData *const romData = fns->newRomData(file);
+			if (romData->isValid()) {
+				// RomData subclass obtained.
+				return romData;
 			}
+
+			// Not actually supported.
+			romData->unref();
 		}
 	}
 
 	// Check for supported textures.
-	{
-		// TODO: RpTextureWrapper::isRomSupported()?
+	if (RpTextureWrapper::isRomSupported_static(&info) >= 0) {
 		RomData *const romData = new RpTextureWrapper(file);
 		if (romData->isValid()) {
 			// RomData subclass obtained.
@@ -596,10 +788,22 @@ RomData *RomDataFactory::create(IRpFile *file, unsigned int attrs)
 		romData->unref();
 	}
 
+	// Look up the file extension in the extension index.
+	// This is used for headers with non-zero addresses and footers.
+	const RomDataFactoryPrivate::ExtCandidates *extCandidates = nullptr;
+	if (info.ext != nullptr) {
+		string ext_lc(info.ext);
+		std::transform(ext_lc.begin(), ext_lc.end(), ext_lc.begin(), ::tolower);
+		auto iter = RomDataFactoryPrivate::map_extCandidates.find(ext_lc);
+		if (iter != RomDataFactoryPrivate::map_extCandidates.end()) {
+			extCandidates = &iter->second;
+		}
+	}
+
 	// Check other RomData subclasses that take a header,
 	// but don't have a simple 32-bit magic number check.
-	fns = &RomDataFactoryPrivate::romDataFns_header[0];
-	bool checked_exts = false;
+	const RomDataFactoryPrivate::RomDataFns *fns =
+		&RomDataFactoryPrivate::romDataFns_header[0];
 	for (; fns->supportedFileExtensions != nullptr; fns++) {
 		if ((fns->attrs & attrs) != attrs) {
 			// This RomData subclass doesn't have the
@@ -611,42 +815,14 @@ RomData *RomDataFactory::create(IRpFile *file, unsigned int attrs)
 		    fns->size > info.header.size)
 		{
 			// Header address has changed.
-			if (!checked_exts) {
-				// Check the file extension to reduce overhead
-				// for file types that don't use this.
-				// TODO: Don't hard-code this.
-				// Use a pointer to supportedFileExtensions_static() instead?
-				static const char *const exts[] = {
-					".bin",		/* generic .bin */
-					".sms",		/* Sega Master System */
-					".gg",		/* Game Gear */
-					".tgc",		/* game.com */
-					".iso",		/* ISO-9660 */
-					".xiso",	/* Xbox disc image */
-					".min",		/* Pokémon Mini */
-					nullptr
-				};
-
-				if (info.ext == nullptr) {
-					// No file extension...
-					break;
-				}
-
-				// Check for a matching extension.
-				bool found = false;
-				for (const char *const *ext = exts; *ext != nullptr; ext++) {
-					if (!strcasecmp(info.ext, *ext)) {
-						// Found a match!
-						found = true;
-					}
-				}
-				if (!found) {
-					// No match.
-					break;
-				}
-
-				// File extensions have been checked.
-				checked_exts = true;
+			// Check the file extension to reduce overhead
+			// for file types that don't use this.
+			// NOTE: All headers with non-zero addresses are checked
+			// if any of them supports this extension, since e.g.
+			// ".bin" is commonly used for Sega 8-bit ROM images.
+			if (!extCandidates || !extCandidates->header_addr) {
+				// No match.
+				break;
 			}
 
 			// Read the new header data.
@@ -666,10 +842,8 @@ RomData *RomDataFactory::create(IRpFile *file, unsigned int attrs)
 
 			// Read the header data.
 			info.header.addr = fns->address;
-			int ret = file->seek(info.header.addr);
-			if (ret != 0)
-				continue;
-			info.header.size = static_cast<uint32_t>(file->read(header.u8, fns->size));
+			info.header.size = static_cast<uint32_t>(RomDataFactoryPrivate::mapHeader(
+				file, info.header.addr, header.u8, fns->size, &info.header.pData));
 			if (info.header.size != fns->size)
 				continue;
 		}
@@ -696,35 +870,33 @@ RomData *RomDataFactory::create(IRpFile *file, unsigned int attrs)
 	}
 
 	// Check RomData subclasses that take a footer.
-	if (info.szFile > (1LL << 30)) {
+	if (!extCandidates || extCandidates->footer.empty()) {
+		// No subclasses that use footers support this extension.
+		return nullptr;
+	} else if (info.szFile > (1LL << 30)) {
 		// No subclasses that expect footers support
 		// files larger than 1 GB.
 		return nullptr;
 	}
 
 	bool readFooter = false;
-	fns = &RomDataFactoryPrivate::romDataFns_footer[0];
-	for (; fns->supportedFileExtensions != nullptr; fns++) {
+	for (auto iter = extCandidates->footer.cbegin();
+	     iter != extCandidates->footer.cend(); ++iter)
+	{
+		fns = *iter;
 		if ((fns->attrs & attrs) != attrs) {
 			// This RomData subclass doesn't have the
 			// required attributes.
 			continue;
 		}
 
-		// Do we have a matching extension?
-		// FIXME: Instead of hard-coded, check supportedFileExtensions.
-		// Currently only supports VirtualBoy.
-		if (!info.ext || strcasecmp(info.ext, ".vb") != 0) {
-			// Extension doesn't match.
-			continue;
-		}
-
 		// Make sure we've read the footer.
 		if (!readFooter) {
 			static const int footer_size = 1024;
 			if (info.szFile > footer_size) {
 				info.header.addr = static_cast<uint32_t>(info.szFile - footer_size);
-				info.header.size = static_cast<uint32_t>(file->seekAndRead(info.header.addr, header.u8, footer_size));
+				info.header.size = static_cast<uint32_t>(RomDataFactoryPrivate::mapHeader(
+					file, info.header.addr, header.u8, footer_size, &info.header.pData));
 				if (info.header.size == 0) {
 					// Seek and/or read error.
 					return nullptr;
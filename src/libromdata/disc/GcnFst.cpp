@@ -24,7 +24,7 @@ namespace LibRomData {
 class GcnFstPrivate
 {
 	public:
-		GcnFstPrivate(const uint8_t *fstData, uint32_t len, uint8_t offsetShift);
+		GcnFstPrivate(const uint8_t *fstData, uint32_t len, uint8_t offsetShift, bool takeOwnership);
 		~GcnFstPrivate();
 
 	private:
@@ -87,9 +87,9 @@ class GcnFstPrivate
 
 /** GcnFstPrivate **/
 
-GcnFstPrivate::GcnFstPrivate(const uint8_t *fstData, uint32_t len, uint8_t offsetShift)
+GcnFstPrivate::GcnFstPrivate(const uint8_t *fstData, uint32_t len, uint8_t offsetShift, bool takeOwnership)
 	: hasErrors(false)
-	, fstData(nullptr)
+	, fstData(takeOwnership ? reinterpret_cast<GCN_FST_Entry*>(const_cast<uint8_t*>(fstData)) : nullptr)
 	, fstData_sz(len)
 	, string_table_ptr(nullptr)
 	, string_table_sz(0)
@@ -123,17 +123,22 @@ GcnFstPrivate::GcnFstPrivate(const uint8_t *fstData, uint32_t len, uint8_t offse
 		return;
 	}
 
-	// Copy the FST data.
+	// Copy the FST data, unless we own the buffer already.
 	// NOTE: +1 for NULL termination.
-	uint8_t *fst8 = static_cast<uint8_t*>(malloc(fstData_sz + 1));
-	if (!fst8) {
-		// Could not allocate memory for the FST.
-		hasErrors = true;
-		return;
+	uint8_t *fst8;
+	if (takeOwnership) {
+		fst8 = reinterpret_cast<uint8_t*>(this->fstData);
+	} else {
+		fst8 = static_cast<uint8_t*>(malloc(fstData_sz + 1));
+		if (!fst8) {
+			// Could not allocate memory for the FST.
+			hasErrors = true;
+			return;
+		}
+		memcpy(fst8, fstData, fstData_sz);
+		this->fstData = reinterpret_cast<GCN_FST_Entry*>(fst8);
 	}
-	memcpy(fst8, fstData, fstData_sz);
 	fst8[fstData_sz] = 0; // Make sure the string table is NULL-terminated.
-	this->fstData = reinterpret_cast<GCN_FST_Entry*>(fst8);
 
 	// Save a pointer to the string table.
 	string_table_ptr = reinterpret_cast<char*>(&fst8[string_table_offset]);
@@ -361,9 +366,24 @@ const GCN_FST_Entry *GcnFstPrivate::find_path(const char *path) const
  */
 GcnFst::GcnFst(const uint8_t *fstData, uint32_t len, uint8_t offsetShift)
 	: super()
-	, d(new GcnFstPrivate(fstData, len, offsetShift))
+	, d(new GcnFstPrivate(fstData, len, offsetShift, false))
 { }
 
+/**
+ * Parse a GameCube FST.
+ * This version takes ownership of fstData instead of copying it.
+ * @param fstData FST data. (Must be allocated with malloc(), with at least len+1 bytes.)
+ * @param len Length of the FST data, in bytes. (not including the extra byte)
+ * @param offsetShift File offset shift. (0 = GCN, 2 = Wii)
+ * @param takeOwnership Must be true.
+ */
+GcnFst::GcnFst(uint8_t *fstData, uint32_t len, uint8_t offsetShift, bool takeOwnership)
+	: super()
+	, d(new GcnFstPrivate(fstData, len, offsetShift, takeOwnership))
+{
+	assert(takeOwnership);
+}
+
 GcnFst::~GcnFst()
 {
 	delete d;
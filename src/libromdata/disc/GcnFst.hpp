@@ -24,6 +24,17 @@ class GcnFst : public LibRpBase::IFst
 		 * @param offsetShift File offset shift. (0 = GCN, 2 = Wii)
 		 */
 		GcnFst(const uint8_t *fstData, uint32_t len, uint8_t offsetShift);
+
+		/**
+		 * Parse a GameCube FST.
+		 * This version takes ownership of fstData instead of copying it.
+		 * @param fstData FST data. (Must be allocated with malloc(), with at least len+1 bytes.)
+		 * @param len Length of the FST data, in bytes. (not including the extra byte)
+		 * @param offsetShift File offset shift. (0 = GCN, 2 = Wii)
+		 * @param takeOwnership Must be true.
+		 */
+		GcnFst(uint8_t *fstData, uint32_t len, uint8_t offsetShift, bool takeOwnership);
+
 		virtual ~GcnFst();
 
 	private:
@@ -151,9 +151,10 @@ int GcnPartitionPrivate::loadFst(void)
 	}
 
 	// Read the FST.
-	// TODO: Eliminate the extra copy?
+	// NOTE: +1 for NULL termination, since GcnFst
+	// takes ownership of this buffer.
 	uint32_t fstData_len = bootBlock.fst_size << offsetShift;
-	uint8_t *fstData = static_cast<uint8_t*>(malloc(fstData_len));
+	uint8_t *fstData = static_cast<uint8_t*>(malloc(fstData_len + 1));
 	if (!fstData) {
 		// malloc() failed.
 		q->m_lastError = ENOMEM;
@@ -168,8 +169,7 @@ int GcnPartitionPrivate::loadFst(void)
 	}
 
 	// Create the GcnFst.
-	GcnFst *const gcnFst = new GcnFst(fstData, fstData_len, offsetShift);
-	free(fstData);	// TODO: Eliminate the extra copy?
+	GcnFst *const gcnFst = new GcnFst(fstData, fstData_len, offsetShift, true);
 	if (gcnFst->hasErrors()) {
 		// FST has errors.
 		delete gcnFst;
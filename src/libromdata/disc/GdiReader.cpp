@@ -91,7 +91,12 @@ class GdiReaderPrivate : public SparseDiscReaderPrivate {
 GdiReaderPrivate::GdiReaderPrivate(GdiReader *q)
 	: super(q)
 	, blockCount(0)
-{ }
+{
+	// GdiReader overrides readBlock() and doesn't
+	// implement getPhysBlockAddr(), so reads can't
+	// be coalesced by SparseDiscReader.
+	canCoalesce = false;
+}
 
 GdiReaderPrivate::~GdiReaderPrivate()
 {
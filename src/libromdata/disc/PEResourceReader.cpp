@@ -202,18 +202,27 @@ int PEResourceReaderPrivate::loadResDir(uint32_t addr, rsrc_dir_t &dir)
 		// Sanity check; constrain to 64 entries.
 		entryCount = 64;
 	}
+	// If the file is memory-backed, the entries are used in place.
+	// Otherwise, they're read into irdEntries[].
 	uint32_t szToRead = static_cast<uint32_t>(entryCount * sizeof(IMAGE_RESOURCE_DIRECTORY_ENTRY));
-	unique_ptr<IMAGE_RESOURCE_DIRECTORY_ENTRY[]> irdEntries(new IMAGE_RESOURCE_DIRECTORY_ENTRY[entryCount]);
-	size = q->m_file->read(irdEntries.get(), szToRead);
+	IMAGE_RESOURCE_DIRECTORY_ENTRY irdEntries[64];
+	const void *pEntries = nullptr;
+	size = q->m_file->seekAndMap(rsrc_addr + addr + sizeof(root), &pEntries, irdEntries, szToRead);
 	if (size != szToRead) {
 		// Read error.
 		q->m_lastError = q->m_file->lastError();
 		return q->m_lastError;
 	}
+	if (pEntries != irdEntries && (reinterpret_cast<uintptr_t>(pEntries) & 3) != 0) {
+		// Mapped data isn't 32-bit aligned.
+		memcpy(irdEntries, pEntries, szToRead);
+		pEntries = irdEntries;
+	}
 
 	// Read each directory header.
 	dir.resize(entryCount);
-	const IMAGE_RESOURCE_DIRECTORY_ENTRY *irdEntry = irdEntries.get();
+	const IMAGE_RESOURCE_DIRECTORY_ENTRY *irdEntry =
+		static_cast<const IMAGE_RESOURCE_DIRECTORY_ENTRY*>(pEntries);
 	unsigned int entriesRead = 0;
 	for (unsigned int i = 0; i < entryCount; i++, irdEntry++) {
 		// Skipping any root directory entry that isn't an ID.
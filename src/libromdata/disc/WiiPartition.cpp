@@ -70,19 +70,45 @@ class WiiPartitionPrivate : public GcnPartitionPrivate
 		off64_t pos_7C00;
 
 		// Decrypted sector cache.
+		// Used for partial sector reads, e.g. FST and opening.bnr.
 		// NOTE: Actual data starts at 0x400.
 		// Hashes and the sector IV are stored first.
-		uint32_t sector_num;				// Sector number.
-		uint8_t sector_buf[SECTOR_SIZE_ENCRYPTED];	// Decrypted sector data.
+		static const unsigned int SECTOR_CACHE_COUNT = 8;
+		struct SectorCacheEntry {
+			uint32_t sector_num;			// Sector number. (~0 if empty)
+			uint32_t last_used;			// LRU counter value.
+			uint8_t data[SECTOR_SIZE_ENCRYPTED];	// Decrypted sector data.
+		};
+		SectorCacheEntry sectorCache[SECTOR_CACHE_COUNT];
+		uint32_t sectorCacheCounter;
+
+		// Maximum number of sectors to read at once
+		// when reading full sectors.
+		static const unsigned int BATCH_SECTOR_COUNT = 64;
+		// Buffer for batched sector reads.
+		ao::uvector<uint8_t> batch_buf;
 
 		/**
-		 * Read and decrypt a sector.
-		 * The decrypted sector is stored in sector_buf.
+		 * Read and decrypt multiple contiguous sectors.
+		 * All sectors are read with a single read() call,
+		 * then decrypted back-to-back.
 		 *
-		 * @param sector_num Sector number. (address / 0x7C00)
+		 * @param sector_num	[in] First sector number. (address / 0x7C00)
+		 * @param count		[in] Number of sectors.
+		 * @param buf		[out] Output buffer. (must be count * 0x8000 bytes)
 		 * @return 0 on success; negative POSIX error code on error.
 		 */
-		int readSector(uint32_t sector_num);
+		int readSectors(uint32_t sector_num, unsigned int count, uint8_t *buf);
+
+		/**
+		 * Read and decrypt a sector using the sector cache.
+		 * If the sector isn't cached, the least recently used
+		 * sector is replaced.
+		 *
+		 * @param sector_num Sector number. (address / 0x7C00)
+		 * @return Decrypted sector data, or nullptr on error.
+		 */
+		const uint8_t *readSector(uint32_t sector_num);
 
 #ifdef ENABLE_DECRYPTION
 	public:
@@ -164,7 +190,7 @@ WiiPartitionPrivate::WiiPartitionPrivate(WiiPartition *q,
 	, encKeyReal(WiiPartition::ENCKEY_UNKNOWN)
 	, cryptoMethod(cryptoMethod)
 	, pos_7C00(-1)
-	, sector_num(~0)
+	, sectorCacheCounter(0)
 	, aes_title(nullptr)
 #else /* !ENABLE_DECRYPTION */
 	, verifyResult(KeyManager::VERIFY_NO_SUPPORT)
@@ -172,7 +198,7 @@ WiiPartitionPrivate::WiiPartitionPrivate(WiiPartition *q,
 	, encKeyReal(WiiPartition::ENCKEY_UNKNOWN)
 	, cryptoMethod(cryptoMethod)
 	, pos_7C00(-1)
-	, sector_num(~0)
+	, sectorCacheCounter(0)
 #endif /* ENABLE_DECRYPTION */
 {
 	// NOTE: The discReader parameter is needed because
@@ -192,6 +218,12 @@ WiiPartitionPrivate::WiiPartitionPrivate(WiiPartition *q,
 	// Clear the partition header struct.
 	memset(&partitionHeader, 0, sizeof(partitionHeader));
 
+	// Clear the sector cache.
+	for (unsigned int i = 0; i < SECTOR_CACHE_COUNT; i++) {
+		sectorCache[i].sector_num = ~0U;
+		sectorCache[i].last_used = 0;
+	}
+
 	// Partition header will be read in the WiiPartition constructor.
 }
 
@@ -351,7 +383,8 @@ KeyManager::VerifyResult WiiPartitionPrivate::initDecryption(void)
 
 	// Read sector 0, which contains a disc header.
 	// NOTE: readSector() doesn't check verifyResult.
-	if (readSector(0) != 0) {
+	const uint8_t *const sector0 = readSector(0);
+	if (!sector0) {
 		// Error reading sector 0.
 		delete aes_title;
 		aes_title = nullptr;
@@ -362,7 +395,7 @@ KeyManager::VerifyResult WiiPartitionPrivate::initDecryption(void)
 	// Verify that this is a Wii partition.
 	// If it isn't, the key is probably wrong.
 	const GCN_DiscHeader *discHeader =
-		reinterpret_cast<const GCN_DiscHeader*>(&sector_buf[SECTOR_SIZE_DECRYPTED_OFFSET]);
+		reinterpret_cast<const GCN_DiscHeader*>(&sector0[SECTOR_SIZE_DECRYPTED_OFFSET]);
 	if (discHeader->magic_wii != cpu_to_be32(WII_MAGIC)) {
 		// Invalid disc header.
 		verifyResult = KeyManager::VERIFY_WRONG_KEY;
@@ -383,26 +416,24 @@ WiiPartitionPrivate::~WiiPartitionPrivate()
 }
 
 /**
- * Read and decrypt a sector.
- * The decrypted sector is stored in sector_buf.
+ * Read and decrypt multiple contiguous sectors.
+ * All sectors are read with a single read() call,
+ * then decrypted back-to-back.
  *
- * @param sector_num Sector number. (address / 0x7C00)
+ * @param sector_num	[in] First sector number. (address / 0x7C00)
+ * @param count		[in] Number of sectors.
+ * @param buf		[out] Output buffer. (must be count * 0x8000 bytes)
  * @return 0 on success; negative POSIX error code on error.
  */
-int WiiPartitionPrivate::readSector(uint32_t sector_num)
+int WiiPartitionPrivate::readSectors(uint32_t sector_num, unsigned int count, uint8_t *buf)
 {
-	if (this->sector_num == sector_num) {
-		// Sector is already in memory.
-		return 0;
-	}
-
 	RP_Q(WiiPartition);
 	const bool isCrypted = ((cryptoMethod & WiiPartition::CM_MASK_ENCRYPTED) == WiiPartition::CM_ENCRYPTED);
 #ifndef ENABLE_DECRYPTION
 	if (isCrypted) {
 		// Decryption is disabled.
 		q->m_lastError = EIO;
-		return -1;
+		return -EIO;
 	}
 #endif /* !ENABLE_DECRYPTION */
 
@@ -412,39 +443,75 @@ int WiiPartitionPrivate::readSector(uint32_t sector_num)
 	off64_t sector_addr = partition_offset + data_offset;
 	sector_addr += (static_cast<off64_t>(sector_num) * SECTOR_SIZE_ENCRYPTED);
 
-	int ret = q->m_discReader->seek(sector_addr);
-	if (ret != 0) {
+	const size_t sz_total = static_cast<size_t>(count) * SECTOR_SIZE_ENCRYPTED;
+	size_t sz = q->m_discReader->seekAndRead(sector_addr, buf, sz_total);
+	if (sz != sz_total) {
+		// Short read.
 		q->m_lastError = q->m_discReader->lastError();
-		return ret;
-	}
-
-	size_t sz = q->m_discReader->read(sector_buf, sizeof(sector_buf));
-	if (sz != SECTOR_SIZE_ENCRYPTED) {
-		// sector_buf may be invalid.
-		this->sector_num = ~0;
-		q->m_lastError = EIO;
-		return -1;
+		if (q->m_lastError == 0) {
+			q->m_lastError = EIO;
+		}
+		return -q->m_lastError;
 	}
 
 #ifdef ENABLE_DECRYPTION
 	if (isCrypted) {
-		// Decrypt the sector.
-		if (aes_title->decrypt(&sector_buf[SECTOR_SIZE_DECRYPTED_OFFSET], SECTOR_SIZE_DECRYPTED,
-		    &sector_buf[0x3D0], 16) != SECTOR_SIZE_DECRYPTED)
-		{
-			// sector_buf may be invalid.
-			this->sector_num = ~0;
-			q->m_lastError = EIO;
-			return -1;
+		// Decrypt the sectors.
+		// Each sector's IV is stored in its hash area.
+		for (; count > 0; count--, buf += SECTOR_SIZE_ENCRYPTED) {
+			if (aes_title->decrypt(&buf[SECTOR_SIZE_DECRYPTED_OFFSET], SECTOR_SIZE_DECRYPTED,
+			    &buf[0x3D0], 16) != SECTOR_SIZE_DECRYPTED)
+			{
+				// Decryption failed.
+				q->m_lastError = EIO;
+				return -EIO;
+			}
 		}
 	}
 #endif /* ENABLE_DECRYPTION */
 
-	// Sector read and decrypted.
-	this->sector_num = sector_num;
+	// Sectors read and decrypted.
 	return 0;
 }
 
+/**
+ * Read and decrypt a sector using the sector cache.
+ * If the sector isn't cached, the least recently used
+ * sector is replaced.
+ *
+ * @param sector_num Sector number. (address / 0x7C00)
+ * @return Decrypted sector data, or nullptr on error.
+ */
+const uint8_t *WiiPartitionPrivate::readSector(uint32_t sector_num)
+{
+	// Check if the sector is already in memory.
+	SectorCacheEntry *lru = &sectorCache[0];
+	for (unsigned int i = 0; i < SECTOR_CACHE_COUNT; i++) {
+		SectorCacheEntry *const entry = &sectorCache[i];
+		if (entry->sector_num == sector_num) {
+			// Found the sector.
+			entry->last_used = ++sectorCacheCounter;
+			return entry->data;
+		}
+		if (entry->last_used < lru->last_used) {
+			lru = entry;
+		}
+	}
+
+	// Sector isn't cached. Replace the least recently used sector.
+	// NOTE: Invalidate the entry first in case the read fails.
+	lru->sector_num = ~0U;
+	lru->last_used = 0;
+	if (readSectors(sector_num, 1, lru->data) != 0) {
+		// Error reading the sector.
+		return nullptr;
+	}
+
+	lru->sector_num = sector_num;
+	lru->last_used = ++sectorCacheCounter;
+	return lru->data;
+}
+
 /** WiiPartition **/
 
 /**
@@ -530,7 +597,6 @@ size_t WiiPartition::read(void *ptr, size_t size)
 		return 0;
 	}
 
-	// TODO: Consolidate this code and optimize it.
 	size_t ret = 0;
 	uint8_t *ptr8 = static_cast<uint8_t*>(ptr);
 
@@ -544,64 +610,17 @@ size_t WiiPartition::read(void *ptr, size_t size)
 		size = static_cast<size_t>(d->data_size - d->pos_7C00);
 	}
 
+	// Sector layout.
+	unsigned int sectorDataSize, sectorDataOffset;
 	if ((d->cryptoMethod & CM_MASK_SECTOR) == CM_32K) {
 		// Full 32K sectors. (implies no encryption)
-
-		// Check if we're not starting on a block boundary.
-		const uint32_t blockStartOffset = d->pos_7C00 % SECTOR_SIZE_ENCRYPTED;
-		if (blockStartOffset != 0) {
-			// Not a block boundary.
-			// Read the end of the block.
-			uint32_t read_sz = SECTOR_SIZE_ENCRYPTED - blockStartOffset;
-			if (size < static_cast<size_t>(read_sz)) {
-				read_sz = static_cast<uint32_t>(size);
-			}
-
-			// Read and decrypt the sector.
-			const uint32_t blockStart = static_cast<uint32_t>(d->pos_7C00 / SECTOR_SIZE_ENCRYPTED);
-			d->readSector(blockStart);
-
-			// Copy data from the sector.
-			memcpy(ptr8, &d->sector_buf[blockStartOffset], read_sz);
-
-			// Starting block read.
-			size -= read_sz;
-			ptr8 += read_sz;
-			ret += read_sz;
-			d->pos_7C00 += read_sz;
-		}
-
-		// Read entire blocks.
-		for (; size >= SECTOR_SIZE_ENCRYPTED;
-		     size -= SECTOR_SIZE_ENCRYPTED, ptr8 += SECTOR_SIZE_ENCRYPTED,
-		     ret += SECTOR_SIZE_ENCRYPTED, d->pos_7C00 += SECTOR_SIZE_ENCRYPTED)
-		{
-			assert(d->pos_7C00 % SECTOR_SIZE_ENCRYPTED == 0);
-
-			// Read the sector.
-			const uint32_t blockStart = static_cast<uint32_t>(d->pos_7C00 / SECTOR_SIZE_ENCRYPTED);
-			d->readSector(blockStart);
-
-			// Copy data from the sector.
-			memcpy(ptr8, d->sector_buf, SECTOR_SIZE_ENCRYPTED);
-		}
-
-		// Check if we still have data left. (not a full block)
-		if (size > 0) {
-			// Not a full block.
-
-			// Read the sector.
-			assert(d->pos_7C00 % SECTOR_SIZE_ENCRYPTED == 0);
-			const uint32_t blockEnd = static_cast<uint32_t>(d->pos_7C00 / SECTOR_SIZE_ENCRYPTED);
-			d->readSector(blockEnd);
-
-			// Copy data from the sector.
-			memcpy(ptr8, &d->sector_buf[blockStartOffset], size);
-
-			ret += size;
-			d->pos_7C00 += size;
-		}
+		sectorDataSize = SECTOR_SIZE_ENCRYPTED;
+		sectorDataOffset = 0;
 	} else {
+		// 1K hashes, 31K data.
+		sectorDataSize = SECTOR_SIZE_DECRYPTED;
+		sectorDataOffset = SECTOR_SIZE_DECRYPTED_OFFSET;
+
 		if ((d->cryptoMethod & CM_MASK_ENCRYPTED) == CM_ENCRYPTED) {
 #ifdef ENABLE_DECRYPTION
 			// Make sure decryption is initialized.
@@ -629,64 +648,98 @@ size_t WiiPartition::read(void *ptr, size_t size)
 #else /* !ENABLE_DECRYPTION */
 			// Decryption is not enabled.
 			m_lastError = EIO;
-			ret = 0;
+			return 0;
 #endif /* ENABLE_DECRYPTION */
 		}
+	}
 
-		// Check if we're not starting on a block boundary.
-		const uint32_t blockStartOffset = d->pos_7C00 % SECTOR_SIZE_DECRYPTED;
-		if (blockStartOffset != 0) {
-			// Not a block boundary.
-			// Read the end of the block.
-			uint32_t read_sz = SECTOR_SIZE_DECRYPTED - blockStartOffset;
-			if (size < static_cast<size_t>(read_sz)) {
-				read_sz = static_cast<uint32_t>(size);
-			}
-
-			// Read and decrypt the sector.
-			const uint32_t blockStart = static_cast<uint32_t>(d->pos_7C00 / SECTOR_SIZE_DECRYPTED);
-			d->readSector(blockStart);
-
-			// Copy data from the sector.
-			memcpy(ptr8, &d->sector_buf[SECTOR_SIZE_DECRYPTED_OFFSET + blockStartOffset], read_sz);
+	// Check if we're not starting on a block boundary.
+	const uint32_t blockStartOffset = d->pos_7C00 % sectorDataSize;
+	if (blockStartOffset != 0) {
+		// Not a block boundary.
+		// Read the end of the block.
+		uint32_t read_sz = sectorDataSize - blockStartOffset;
+		if (size < static_cast<size_t>(read_sz)) {
+			read_sz = static_cast<uint32_t>(size);
+		}
 
-			// Starting block read.
-			size -= read_sz;
-			ptr8 += read_sz;
-			ret += read_sz;
-			d->pos_7C00 += read_sz;
+		// Read and decrypt the sector.
+		const uint32_t blockStart = static_cast<uint32_t>(d->pos_7C00 / sectorDataSize);
+		const uint8_t *const pSector = d->readSector(blockStart);
+		if (!pSector) {
+			// Error reading the sector.
+			return ret;
 		}
 
-		// Read entire blocks.
-		for (; size >= SECTOR_SIZE_DECRYPTED;
-		size -= SECTOR_SIZE_DECRYPTED, ptr8 += SECTOR_SIZE_DECRYPTED,
-		ret += SECTOR_SIZE_DECRYPTED, d->pos_7C00 += SECTOR_SIZE_DECRYPTED)
-		{
-			assert(d->pos_7C00 % SECTOR_SIZE_DECRYPTED == 0);
+		// Copy data from the sector.
+		memcpy(ptr8, &pSector[sectorDataOffset + blockStartOffset], read_sz);
+
+		// Starting block read.
+		size -= read_sz;
+		ptr8 += read_sz;
+		ret += read_sz;
+		d->pos_7C00 += read_sz;
+	}
+
+	// Read entire blocks.
+	// Contiguous sectors are read and decrypted in batches.
+	// NOTE: Full sectors are not added to the sector cache.
+	while (size >= sectorDataSize) {
+		assert(d->pos_7C00 % sectorDataSize == 0);
+		const uint32_t blockStart = static_cast<uint32_t>(d->pos_7C00 / sectorDataSize);
+		unsigned int count = static_cast<unsigned int>(size / sectorDataSize);
+		if (count > WiiPartitionPrivate::BATCH_SECTOR_COUNT) {
+			count = WiiPartitionPrivate::BATCH_SECTOR_COUNT;
+		}
 
-			// Read and decrypt the sector.
-			const uint32_t blockStart = static_cast<uint32_t>(d->pos_7C00 / SECTOR_SIZE_DECRYPTED);
-			d->readSector(blockStart);
+		if (sectorDataOffset == 0) {
+			// No hashes. Read directly into the output buffer.
+			if (d->readSectors(blockStart, count, ptr8) != 0) {
+				// Error reading the sectors.
+				return ret;
+			}
+		} else {
+			// Read and decrypt the sectors, then copy the data.
+			d->batch_buf.resize(static_cast<size_t>(count) * SECTOR_SIZE_ENCRYPTED);
+			uint8_t *pSector = d->batch_buf.data();
+			if (d->readSectors(blockStart, count, pSector) != 0) {
+				// Error reading the sectors.
+				return ret;
+			}
 
-			// Copy data from the sector.
-			memcpy(ptr8, &d->sector_buf[SECTOR_SIZE_DECRYPTED_OFFSET], SECTOR_SIZE_DECRYPTED);
+			uint8_t *pDest = ptr8;
+			for (unsigned int i = count; i > 0; i--,
+			     pSector += SECTOR_SIZE_ENCRYPTED, pDest += sectorDataSize)
+			{
+				memcpy(pDest, &pSector[sectorDataOffset], sectorDataSize);
+			}
 		}
 
-		// Check if we still have data left. (not a full block)
-		if (size > 0) {
-			// Not a full block.
-
-			// Read and decrypt the sector.
-			assert(d->pos_7C00 % SECTOR_SIZE_DECRYPTED == 0);
-			const uint32_t blockEnd = static_cast<uint32_t>(d->pos_7C00 / SECTOR_SIZE_DECRYPTED);
-			d->readSector(blockEnd);
+		const size_t read_sz = static_cast<size_t>(count) * sectorDataSize;
+		size -= read_sz;
+		ptr8 += read_sz;
+		ret += read_sz;
+		d->pos_7C00 += read_sz;
+	}
 
-			// Copy data from the sector.
-			memcpy(ptr8, &d->sector_buf[SECTOR_SIZE_DECRYPTED_OFFSET], size);
+	// Check if we still have data left. (not a full block)
+	if (size > 0) {
+		// Not a full block.
 
-			ret += size;
-			d->pos_7C00 += size;
+		// Read and decrypt the sector.
+		assert(d->pos_7C00 % sectorDataSize == 0);
+		const uint32_t blockEnd = static_cast<uint32_t>(d->pos_7C00 / sectorDataSize);
+		const uint8_t *const pSector = d->readSector(blockEnd);
+		if (!pSector) {
+			// Error reading the sector.
+			return ret;
 		}
+
+		// Copy data from the sector.
+		memcpy(ptr8, &pSector[sectorDataOffset], size);
+
+		ret += size;
+		d->pos_7C00 += size;
 	}
 
 	// Finished reading the data.
@@ -0,0 +1,652 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * CacheIndex.cpp: Download cache index.                                   *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "CacheIndex.hpp"
+
+// librpfile
+#include "librpfile/RpFile.hpp"
+#include "librpfile/FileSystem.hpp"
+using namespace LibRpFile;
+
+// OS-specific includes.
+#ifdef _WIN32
+# include "libwin32common/RpWin32_sdk.h"
+# include "librpbase/TextFuncs_wchar.hpp"
+#else /* !_WIN32 */
+# include <fcntl.h>
+# include <sys/file.h>
+# include <unistd.h>
+#endif /* _WIN32 */
+
+// C++ includes.
+#include <string>
+#include <unordered_map>
+#include <vector>
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace LibRomData {
+
+// Index file format. (All fields are little-endian.)
+// - Header: CacheIndexHeader
+// - Hash table: bucket_count * CacheIndexEntry
+//
+// The hash table uses open addressing with linear probing.
+// bucket_count is a power of two, and the table is never
+// more than half full. Empty buckets have key_hash == 0.
+#define CACHEINDEX_MAGIC "RPCIDX02"
+#pragma pack(1)
+struct PACKED CacheIndexHeader {
+	char magic[8];		// CACHEINDEX_MAGIC
+	uint32_t entry_size;	// sizeof(CacheIndexEntry)
+	uint32_t bucket_count;	// Number of hash table buckets
+	uint32_t entry_count;	// Number of used buckets
+	uint32_t reserved;
+	int64_t next_purge;	// Time of the next purge()
+};
+ASSERT_STRUCT(CacheIndexHeader, 32);
+struct PACKED CacheIndexEntry {
+	uint64_t key_hash;	// Hash of the filtered cache key (0 == empty)
+	char key[CacheIndex::MAX_KEY_LENGTH];	// Filtered cache key (NULL-terminated)
+	uint32_t status;	// CacheIndex::Status
+	uint32_t size;		// File size
+	int64_t cached_time;	// Time the file was downloaded or found missing
+	int64_t last_modified;	// Last-Modified time from the server
+	int64_t expires;	// Time the negative entry expires
+	int64_t last_access;	// Time the file was last accessed
+};
+ASSERT_STRUCT(CacheIndexEntry, 128);
+#pragma pack()
+
+// Minimum and maximum number of hash table buckets.
+static const uint32_t MIN_BUCKET_COUNT = 64;
+static const uint32_t MAX_BUCKET_COUNT = (1U << 20);
+
+/**
+ * Hash a filtered cache key. (64-bit FNV-1a)
+ * @param key Filtered cache key.
+ * @return Hash. (never 0)
+ */
+static uint64_t hashKey(const char *key)
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (; *key != '\0'; key++) {
+		hash ^= static_cast<uint8_t>(*key);
+		hash *= 0x100000001B3ULL;
+	}
+	// 0 indicates an empty bucket.
+	return (hash != 0 ? hash : 1);
+}
+
+/**
+ * Convert a CacheIndexEntry to a CacheIndex::Entry.
+ * @param dest	[out] CacheIndex::Entry
+ * @param src	[in] CacheIndexEntry
+ */
+static void fromIndexEntry(CacheIndex::Entry *dest, const CacheIndexEntry *src)
+{
+	dest->status = static_cast<CacheIndex::Status>(le32_to_cpu(src->status));
+	dest->size = le32_to_cpu(src->size);
+	dest->cached_time = static_cast<time_t>(le64_to_cpu(src->cached_time));
+	dest->last_modified = static_cast<time_t>(le64_to_cpu(src->last_modified));
+	dest->expires = static_cast<time_t>(le64_to_cpu(src->expires));
+	dest->last_access = static_cast<time_t>(le64_to_cpu(src->last_access));
+}
+
+/**
+ * Insert an entry into a hash table.
+ * The key must not already be present, and the table must not be full.
+ * @param table		[in/out] Hash table.
+ * @param bucketCount	[in] Number of buckets. (power of two)
+ * @param key		[in] Filtered cache key.
+ * @param entry		[in] CacheIndex::Entry
+ */
+static void insertIndexEntry(CacheIndexEntry *table, uint32_t bucketCount,
+	const string &key, const CacheIndex::Entry &entry)
+{
+	const uint64_t hash = hashKey(key.c_str());
+	uint32_t bucket = static_cast<uint32_t>(hash) & (bucketCount - 1);
+	while (table[bucket].key_hash != 0) {
+		bucket = (bucket + 1) & (bucketCount - 1);
+	}
+
+	CacheIndexEntry *const dest = &table[bucket];
+	dest->key_hash = cpu_to_le64(hash);
+	memcpy(dest->key, key.c_str(), key.size() + 1);
+	dest->status = cpu_to_le32(static_cast<uint32_t>(entry.status));
+	dest->size = cpu_to_le32(entry.size);
+	dest->cached_time = cpu_to_le64(static_cast<int64_t>(entry.cached_time));
+	dest->last_modified = cpu_to_le64(static_cast<int64_t>(entry.last_modified));
+	dest->expires = cpu_to_le64(static_cast<int64_t>(entry.expires));
+	dest->last_access = cpu_to_le64(static_cast<int64_t>(entry.last_access));
+}
+
+/**
+ * Advisory lock on "index.lock" in the index file's directory.
+ * Held by commit() so other processes can't replace the index
+ * between reloading it and renaming the new index over it.
+ * The lock is released when the object is destroyed.
+ */
+class CacheIndexLock
+{
+	public:
+		/**
+		 * Lock the index. This blocks until the lock is acquired.
+		 * @param indexFilename Index filename.
+		 */
+		explicit CacheIndexLock(const string &indexFilename);
+		~CacheIndexLock();
+
+	private:
+		RP_DISABLE_COPY(CacheIndexLock)
+
+	private:
+#ifdef _WIN32
+		HANDLE m_hFile;
+#else /* !_WIN32 */
+		int m_fd;
+#endif /* _WIN32 */
+};
+
+/**
+ * Lock the index. This blocks until the lock is acquired.
+ * @param indexFilename Index filename.
+ */
+CacheIndexLock::CacheIndexLock(const string &indexFilename)
+{
+	string lockFilename = indexFilename;
+	const size_t slash_pos = lockFilename.rfind(DIR_SEP_CHR);
+	lockFilename.resize(slash_pos != string::npos ? slash_pos + 1 : 0);
+	lockFilename += "index.lock";
+
+#ifdef _WIN32
+	m_hFile = CreateFileW(U82W_s(lockFilename),
+		GENERIC_READ | GENERIC_WRITE,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+		return;
+
+	OVERLAPPED ov;
+	memset(&ov, 0, sizeof(ov));
+	if (!LockFileEx(m_hFile, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &ov)) {
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+#else /* !_WIN32 */
+	m_fd = open(lockFilename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (m_fd < 0)
+		return;
+
+	int ret;
+	do {
+		ret = flock(m_fd, LOCK_EX);
+	} while (ret != 0 && errno == EINTR);
+	if (ret != 0) {
+		close(m_fd);
+		m_fd = -1;
+	}
+#endif /* _WIN32 */
+}
+
+CacheIndexLock::~CacheIndexLock()
+{
+	// NOTE: Closing the lock file releases the lock.
+#ifdef _WIN32
+	if (m_hFile != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_hFile);
+	}
+#else /* !_WIN32 */
+	if (m_fd >= 0) {
+		close(m_fd);
+	}
+#endif /* _WIN32 */
+}
+
+/**
+ * Open a cache index.
+ * The index is loaded by calling reload().
+ * @param filename Index filename.
+ */
+CacheIndex::CacheIndex(const string &filename)
+	: m_filename(filename)
+	, m_file(nullptr)
+	, m_data(nullptr)
+	, m_bucketCount(0)
+	, m_nextPurge(0)
+{
+	// Cache files are relative to the index file's directory.
+	const size_t slash_pos = filename.find_last_of(
+#ifdef _WIN32
+		"\\/"
+#else /* !_WIN32 */
+		'/'
+#endif /* _WIN32 */
+		);
+	if (slash_pos != string::npos) {
+		m_cacheDir.assign(filename, 0, slash_pos + 1);
+	}
+}
+
+CacheIndex::~CacheIndex()
+{
+	unload();
+}
+
+/**
+ * Get the default cache index filename.
+ * This is "index.bin" in the rom-properties cache directory.
+ * @return Default cache index filename, or empty string on error.
+ */
+string CacheIndex::defaultFilename(void)
+{
+	string filename = FileSystem::getCacheDirectory();
+	if (filename.empty())
+		return filename;
+
+	if (filename.at(filename.size()-1) != DIR_SEP_CHR)
+		filename += DIR_SEP_CHR;
+	filename += "index.bin";
+	return filename;
+}
+
+/**
+ * Unload the index file.
+ */
+void CacheIndex::unload(void)
+{
+	if (m_file) {
+		m_file->unref();
+		m_file = nullptr;
+	}
+	m_buf.clear();
+	m_buf.shrink_to_fit();
+	m_data = nullptr;
+	m_bucketCount = 0;
+	m_nextPurge = 0;
+}
+
+/**
+ * (Re-)load the index file.
+ * Uncommitted changes are kept.
+ * @return 0 on success; -ENOENT if the index doesn't exist; other negative POSIX error code on error.
+ */
+int CacheIndex::reload(void)
+{
+	unload();
+
+	RpFile *const file = new RpFile(m_filename, RpFile::FM_OPEN_READ_MMAP);
+	if (!file->isOpen()) {
+		const int err = file->lastError();
+		file->unref();
+		return (err != 0 ? -err : -EIO);
+	}
+
+	// Check the header.
+	CacheIndexHeader hdr;
+	if (file->seekAndRead(0, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+		file->unref();
+		return -EIO;
+	}
+	const uint32_t bucketCount = le32_to_cpu(hdr.bucket_count);
+	const off64_t expectedSize = static_cast<off64_t>(sizeof(hdr)) +
+		(static_cast<off64_t>(bucketCount) * sizeof(CacheIndexEntry));
+	if (memcmp(hdr.magic, CACHEINDEX_MAGIC, sizeof(hdr.magic)) != 0 ||
+	    le32_to_cpu(hdr.entry_size) != sizeof(CacheIndexEntry) ||
+	    bucketCount < MIN_BUCKET_COUNT || bucketCount > MAX_BUCKET_COUNT ||
+	    (bucketCount & (bucketCount - 1)) != 0 ||
+	    le32_to_cpu(hdr.entry_count) > bucketCount / 2 ||
+	    file->size() != expectedSize)
+	{
+		// Invalid index file. It will be replaced by commit().
+		file->unref();
+		return -EIO;
+	}
+
+	// Map the hash table.
+	// If the file isn't memory-mapped, the hash table is read into m_buf.
+	const size_t tableSize = static_cast<size_t>(bucketCount) * sizeof(CacheIndexEntry);
+	m_buf.resize(tableSize);
+	const void *ptr = nullptr;
+	if (file->seekAndMap(sizeof(hdr), &ptr, m_buf.data(), tableSize) != tableSize) {
+		file->unref();
+		m_buf.clear();
+		return -EIO;
+	}
+	if (ptr == m_buf.data()) {
+		// Not memory-mapped. The file isn't needed anymore.
+		// NOTE: Closing it allows commit() to replace it on Windows.
+		file->unref();
+	} else {
+		// Memory-mapped. Keep the file open.
+		m_buf.clear();
+		m_buf.shrink_to_fit();
+		m_file = file;
+	}
+
+	m_data = static_cast<const uint8_t*>(ptr);
+	m_bucketCount = bucketCount;
+	m_nextPurge = static_cast<time_t>(le64_to_cpu(hdr.next_purge));
+	return 0;
+}
+
+/**
+ * Look up a cache key.
+ * @param key		[in] Filtered cache key.
+ * @param pEntry	[out] Cache index entry.
+ * @return True if the cache key is in the index; false if not.
+ */
+bool CacheIndex::lookup(const char *key, Entry *pEntry) const
+{
+	assert(key != nullptr);
+	assert(pEntry != nullptr);
+
+	// Check for uncommitted changes first.
+	if (!m_pending.empty()) {
+		auto iter = m_pending.find(key);
+		if (iter != m_pending.end()) {
+			if (iter->second.status == CIS_NONE) {
+				// Key was removed.
+				return false;
+			}
+			*pEntry = iter->second;
+			return true;
+		}
+	}
+
+	if (m_bucketCount == 0) {
+		// Index isn't loaded.
+		return false;
+	}
+
+	// Search the hash table.
+	const CacheIndexEntry *const table = reinterpret_cast<const CacheIndexEntry*>(m_data);
+	const uint64_t hash = hashKey(key);
+	const uint64_t hash_le = cpu_to_le64(hash);
+	uint32_t bucket = static_cast<uint32_t>(hash) & (m_bucketCount - 1);
+	for (uint32_t i = 0; i < m_bucketCount; i++) {
+		const CacheIndexEntry *const entry = &table[bucket];
+		if (entry->key_hash == 0) {
+			// Empty bucket. Key isn't in the index.
+			break;
+		} else if (entry->key_hash == hash_le &&
+		           !strncmp(entry->key, key, sizeof(entry->key)))
+		{
+			// Found the key.
+			fromIndexEntry(pEntry, entry);
+			return (pEntry->status == CIS_CACHED || pEntry->status == CIS_NEGATIVE);
+		}
+		bucket = (bucket + 1) & (m_bucketCount - 1);
+	}
+
+	return false;
+}
+
+/**
+ * Add or update a cache key.
+ * The change is written to disk by commit().
+ * @param key	[in] Filtered cache key.
+ * @param entry	[in] Cache index entry. (status must not be CIS_NONE)
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheIndex::set(const string &key, const Entry &entry)
+{
+	assert(entry.status == CIS_CACHED || entry.status == CIS_NEGATIVE);
+	if (entry.status != CIS_CACHED && entry.status != CIS_NEGATIVE)
+		return -EINVAL;
+	if (key.empty() || key.size() >= MAX_KEY_LENGTH)
+		return -ENAMETOOLONG;
+
+	m_pending[key] = entry;
+	return 0;
+}
+
+/**
+ * Remove a cache key.
+ * The change is written to disk by commit().
+ * @param key Filtered cache key.
+ */
+void CacheIndex::remove(const string &key)
+{
+	if (key.empty() || key.size() >= MAX_KEY_LENGTH)
+		return;
+
+	Entry &entry = m_pending[key];
+	memset(&entry, 0, sizeof(entry));
+	entry.status = CIS_NONE;
+}
+
+/**
+ * Update a cached file's access time.
+ * The access time is only updated if the stored access time
+ * is at least ACCESS_TIME_RESOLUTION seconds old.
+ * The change is written to disk by commit().
+ * @param key Filtered cache key.
+ * @param now Current time.
+ * @return True if the access time was updated; false if not.
+ */
+bool CacheIndex::touch(const string &key, time_t now)
+{
+	Entry entry;
+	if (!lookup(key, &entry) || entry.status != CIS_CACHED)
+		return false;
+	if (entry.last_access <= now && now - entry.last_access < ACCESS_TIME_RESOLUTION)
+		return false;
+
+	entry.last_access = now;
+	m_pending[key] = entry;
+	return true;
+}
+
+/**
+ * Get all cache keys in the index, including uncommitted changes.
+ * @return Cache keys.
+ */
+vector<string> CacheIndex::keys(void) const
+{
+	vector<string> ret;
+	ret.reserve(m_bucketCount / 2 + m_pending.size());
+
+	const CacheIndexEntry *const table = reinterpret_cast<const CacheIndexEntry*>(m_data);
+	for (uint32_t i = 0; i < m_bucketCount; i++) {
+		const CacheIndexEntry *const src = &table[i];
+		if (src->key_hash == 0)
+			continue;
+
+		const size_t keyLen = strnlen(src->key, sizeof(src->key));
+		if (keyLen == 0 || keyLen >= sizeof(src->key))
+			continue;
+		string key(src->key, keyLen);
+		if (m_pending.find(key) == m_pending.end()) {
+			ret.push_back(std::move(key));
+		}
+	}
+	for (auto iter = m_pending.cbegin(); iter != m_pending.cend(); ++iter) {
+		if (iter->second.status != CIS_NONE) {
+			ret.push_back(iter->first);
+		}
+	}
+	return ret;
+}
+
+/**
+ * Get the filename of a cache file.
+ * @param key Filtered cache key.
+ * @return Cache filename.
+ */
+string CacheIndex::cacheFilename(const string &key) const
+{
+	string filename = m_cacheDir;
+	filename += key;
+	return filename;
+}
+
+/**
+ * Remove expired negative cache entries, and delete their files.
+ * This is done automatically by commit() every PURGE_INTERVAL seconds.
+ * The change is written to disk by commit().
+ * @return Number of entries removed.
+ */
+unsigned int CacheIndex::purge(void)
+{
+	const time_t now = time(nullptr);
+	vector<string> expired;
+
+	const CacheIndexEntry *const table = reinterpret_cast<const CacheIndexEntry*>(m_data);
+	for (uint32_t i = 0; i < m_bucketCount; i++) {
+		const CacheIndexEntry *const src = &table[i];
+		if (src->key_hash == 0)
+			continue;
+
+		Entry entry;
+		fromIndexEntry(&entry, src);
+		if (entry.status == CIS_NEGATIVE && entry.expires <= now) {
+			const string key(src->key, strnlen(src->key, sizeof(src->key)));
+			if (m_pending.find(key) == m_pending.end()) {
+				expired.push_back(key);
+			}
+		}
+	}
+	for (auto iter = m_pending.cbegin(); iter != m_pending.cend(); ++iter) {
+		if (iter->second.status == CIS_NEGATIVE && iter->second.expires <= now) {
+			expired.push_back(iter->first);
+		}
+	}
+
+	for (auto iter = expired.cbegin(); iter != expired.cend(); ++iter) {
+		// Delete the negative cache file.
+		// If it's already gone, that's fine.
+		FileSystem::delete_file(cacheFilename(*iter));
+		remove(*iter);
+	}
+	return static_cast<unsigned int>(expired.size());
+}
+
+/**
+ * Write the index file, including all uncommitted changes.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheIndex::commit(void)
+{
+	// The index directory must exist for the lock file.
+	int ret = FileSystem::rmkdir(m_filename);
+	if (ret != 0)
+		return ret;
+
+	// Lock the index until the new index is renamed into place,
+	// so concurrent commits from other processes aren't lost.
+	// If the lock can't be acquired, commit anyway. The index is
+	// only a hint, so a lost update is fixed the next time the
+	// cache file is checked.
+	CacheIndexLock lock(m_filename);
+
+	// Reload the index in case another process updated it.
+	// The uncommitted changes are applied to the reloaded index.
+	reload();
+
+	const time_t now = time(nullptr);
+	time_t nextPurge = m_nextPurge;
+	if (nextPurge == 0 || nextPurge > now + PURGE_INTERVAL) {
+		// New index, or the system clock was changed.
+		nextPurge = now + PURGE_INTERVAL;
+	} else if (nextPurge <= now) {
+		// Time to purge expired negative cache entries.
+		purge();
+		nextPurge = now + PURGE_INTERVAL;
+	}
+
+	// Collect the entries that are still valid.
+	unordered_map<string, Entry> entries;
+	const CacheIndexEntry *const table = reinterpret_cast<const CacheIndexEntry*>(m_data);
+	for (uint32_t i = 0; i < m_bucketCount; i++) {
+		const CacheIndexEntry *const src = &table[i];
+		if (src->key_hash == 0)
+			continue;
+
+		const size_t keyLen = strnlen(src->key, sizeof(src->key));
+		if (keyLen == 0 || keyLen >= sizeof(src->key))
+			continue;
+
+		Entry entry;
+		fromIndexEntry(&entry, src);
+		if (entry.status == CIS_CACHED || entry.status == CIS_NEGATIVE) {
+			entries.emplace(string(src->key, keyLen), entry);
+		}
+	}
+	for (auto iter = m_pending.cbegin(); iter != m_pending.cend(); ++iter) {
+		if (iter->second.status == CIS_NONE) {
+			entries.erase(iter->first);
+		} else {
+			entries[iter->first] = iter->second;
+		}
+	}
+
+	// Keep the hash table at most half full.
+	uint32_t bucketCount = MIN_BUCKET_COUNT;
+	while (bucketCount < entries.size() * 2) {
+		if (bucketCount >= MAX_BUCKET_COUNT) {
+			// Too many entries.
+			return -ENOSPC;
+		}
+		bucketCount <<= 1;
+	}
+
+	// Build the index.
+	const size_t dataSize = sizeof(CacheIndexHeader) +
+		(static_cast<size_t>(bucketCount) * sizeof(CacheIndexEntry));
+	ao::uvector<uint8_t> data(dataSize);
+	memset(data.data(), 0, dataSize);
+
+	CacheIndexHeader *const hdr = reinterpret_cast<CacheIndexHeader*>(data.data());
+	memcpy(hdr->magic, CACHEINDEX_MAGIC, sizeof(hdr->magic));
+	hdr->entry_size = cpu_to_le32(static_cast<uint32_t>(sizeof(CacheIndexEntry)));
+	hdr->bucket_count = cpu_to_le32(bucketCount);
+	hdr->entry_count = cpu_to_le32(static_cast<uint32_t>(entries.size()));
+	hdr->next_purge = cpu_to_le64(static_cast<int64_t>(nextPurge));
+
+	CacheIndexEntry *const newTable = reinterpret_cast<CacheIndexEntry*>(&data[sizeof(CacheIndexHeader)]);
+	for (auto iter = entries.cbegin(); iter != entries.cend(); ++iter) {
+		insertIndexEntry(newTable, bucketCount, iter->first, iter->second);
+	}
+
+	// Write the index to a temporary file, then replace the old index.
+	// The temporary filename is unique in case the lock couldn't be
+	// acquired and another process is also writing the index.
+	const string tmpFilename = FileSystem::get_temp_filename(m_filename);
+
+	RpFile *const file = new RpFile(tmpFilename, RpFile::FM_CREATE_WRITE);
+	if (!file->isOpen()) {
+		const int err = file->lastError();
+		file->unref();
+		return (err != 0 ? -err : -EIO);
+	}
+	const size_t size = file->write(data.data(), data.size());
+	file->unref();
+	if (size != data.size()) {
+		// Short write.
+		FileSystem::delete_file(tmpFilename);
+		return -EIO;
+	}
+
+	// Unload the current index before replacing it.
+	// On Windows, a file can't be replaced while it's open.
+	unload();
+	ret = FileSystem::rename_file(tmpFilename, m_filename);
+	if (ret != 0) {
+		FileSystem::delete_file(tmpFilename);
+		reload();
+		return ret;
+	}
+
+	m_pending.clear();
+	return reload();
+}
+
+}
@@ -0,0 +1,235 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * CacheIndex.hpp: Download cache index.                                   *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBROMDATA_IMG_CACHEINDEX_HPP__
+#define __ROMPROPERTIES_LIBROMDATA_IMG_CACHEINDEX_HPP__
+
+#include "common.h"
+
+// C includes.
+#include <stdint.h>
+
+// C includes. (C++ namespace)
+#include <ctime>
+
+// C++ includes.
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Uninitialized vector class.
+// Reference: http://andreoffringa.org/?q=uvector
+#include "uvector.h"
+
+namespace LibRpFile {
+	class RpFile;
+}
+
+namespace LibRomData {
+
+/**
+ * Index of the files in the download cache.
+ *
+ * The index is a hash table of filtered cache keys, stored in a
+ * single file that's memory-mapped if possible. Each entry records
+ * if the file is cached or if it's a negative cache entry, i.e.
+ * the file wasn't found on the server, along with the file size,
+ * the server's Last-Modified time, when negative entries expire, and
+ * when the file was last accessed.
+ *
+ * Changes are kept in memory until commit() is called. commit()
+ * reloads the index file, applies the changes, and writes a new
+ * index file, which then replaces the old one. An advisory lock on
+ * "index.lock" is held while doing this, so concurrent commits from
+ * multiple processes don't lose each other's changes.
+ *
+ * CacheIndex is not thread-safe.
+ */
+class CacheIndex
+{
+	public:
+		/**
+		 * Open a cache index.
+		 * The index is loaded by calling reload().
+		 * @param filename Index filename.
+		 */
+		explicit CacheIndex(const std::string &filename);
+		~CacheIndex();
+
+	private:
+		RP_DISABLE_COPY(CacheIndex)
+
+	public:
+		// Negative cache entries expire after this many seconds.
+		static const time_t NEGATIVE_TTL = 86400*7;
+
+		// Expired negative cache entries are purged at most this often, in seconds.
+		static const time_t PURGE_INTERVAL = 86400;
+
+		// Access times are only updated if the stored access time
+		// is older than this many seconds, so reading cached files
+		// doesn't cause the index to be rewritten every time.
+		static const time_t ACCESS_TIME_RESOLUTION = 3600;
+
+		// Maximum cache key length, including the NULL terminator.
+		// Longer cache keys can't be indexed.
+		static const size_t MAX_KEY_LENGTH = 80;
+
+		/**
+		 * Cache entry status.
+		 */
+		enum Status {
+			CIS_NONE	= 0,	// Not in the index.
+			CIS_CACHED	= 1,	// File is cached.
+			CIS_NEGATIVE	= 2,	// File wasn't found on the server.
+		};
+
+		/**
+		 * Cache index entry.
+		 */
+		struct Entry {
+			Status status;		// Cache entry status
+			uint32_t size;		// File size (CIS_CACHED only)
+			time_t cached_time;	// Time the file was downloaded or found missing
+			time_t last_modified;	// Last-Modified time from the server, if available (CIS_CACHED only)
+			time_t expires;		// Time the negative entry expires (CIS_NEGATIVE only)
+			time_t last_access;	// Time the file was last accessed (CIS_CACHED only)
+		};
+
+	public:
+		/**
+		 * Get the default cache index filename.
+		 * This is "index.bin" in the rom-properties cache directory.
+		 * @return Default cache index filename, or empty string on error.
+		 */
+		static std::string defaultFilename(void);
+
+		/**
+		 * Get the index filename.
+		 * @return Index filename.
+		 */
+		inline const std::string &filename(void) const
+		{
+			return m_filename;
+		}
+
+		/**
+		 * (Re-)load the index file.
+		 * Uncommitted changes are kept.
+		 * @return 0 on success; -ENOENT if the index doesn't exist; other negative POSIX error code on error.
+		 */
+		int reload(void);
+
+		/**
+		 * Look up a cache key.
+		 * @param key		[in] Filtered cache key.
+		 * @param pEntry	[out] Cache index entry.
+		 * @return True if the cache key is in the index; false if not.
+		 */
+		bool lookup(const char *key, Entry *pEntry) const;
+
+		/**
+		 * Look up a cache key.
+		 * @param key		[in] Filtered cache key.
+		 * @param pEntry	[out] Cache index entry.
+		 * @return True if the cache key is in the index; false if not.
+		 */
+		inline bool lookup(const std::string &key, Entry *pEntry) const
+		{
+			return lookup(key.c_str(), pEntry);
+		}
+
+		/**
+		 * Add or update a cache key.
+		 * The change is written to disk by commit().
+		 * @param key	[in] Filtered cache key.
+		 * @param entry	[in] Cache index entry. (status must not be CIS_NONE)
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int set(const std::string &key, const Entry &entry);
+
+		/**
+		 * Remove a cache key.
+		 * The change is written to disk by commit().
+		 * @param key Filtered cache key.
+		 */
+		void remove(const std::string &key);
+
+		/**
+		 * Update a cached file's access time.
+		 * The access time is only updated if the stored access time
+		 * is at least ACCESS_TIME_RESOLUTION seconds old.
+		 * The change is written to disk by commit().
+		 * @param key Filtered cache key.
+		 * @param now Current time.
+		 * @return True if the access time was updated; false if not.
+		 */
+		bool touch(const std::string &key, time_t now);
+
+		/**
+		 * Get all cache keys in the index, including uncommitted changes.
+		 * @return Cache keys.
+		 */
+		std::vector<std::string> keys(void) const;
+
+		/**
+		 * Are there uncommitted changes?
+		 * @return True if there are uncommitted changes.
+		 */
+		inline bool isDirty(void) const
+		{
+			return !m_pending.empty();
+		}
+
+		/**
+		 * Remove expired negative cache entries, and delete their files.
+		 * This is done automatically by commit() every PURGE_INTERVAL seconds.
+		 * The change is written to disk by commit().
+		 * @return Number of entries removed.
+		 */
+		unsigned int purge(void);
+
+		/**
+		 * Write the index file, including all uncommitted changes.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int commit(void);
+
+	private:
+		/**
+		 * Unload the index file.
+		 */
+		void unload(void);
+
+		/**
+		 * Get the filename of a cache file.
+		 * @param key Filtered cache key.
+		 * @return Cache filename.
+		 */
+		std::string cacheFilename(const std::string &key) const;
+
+	private:
+		std::string m_filename;		// Index filename
+		std::string m_cacheDir;		// Cache directory, with trailing separator
+
+		// Index file.
+		// If the file can't be memory-mapped, it's read into m_buf.
+		LibRpFile::RpFile *m_file;
+		ao::uvector<uint8_t> m_buf;
+		const uint8_t *m_data;
+		uint32_t m_bucketCount;
+		time_t m_nextPurge;
+
+		// Uncommitted changes.
+		// Removed keys have status CIS_NONE.
+		std::unordered_map<std::string, Entry> m_pending;
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBROMDATA_IMG_CACHEINDEX_HPP__ */
@@ -0,0 +1,548 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * CacheMaintenance.cpp: Size-bounded cache eviction.                      *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "CacheMaintenance.hpp"
+#include "CacheIndex.hpp"
+
+// librpbase, librpfile
+#include "librpbase/config/Config.hpp"
+#include "librpfile/FileSystem.hpp"
+using LibRpBase::Config;
+using namespace LibRpFile;
+
+// OS-specific includes.
+#ifdef _WIN32
+# include "libwin32common/RpWin32_sdk.h"
+# include "libwin32common/w32time.h"
+# include "librpbase/TextFuncs_wchar.hpp"
+#else /* !_WIN32 */
+# include <dirent.h>
+# include <sys/stat.h>
+#endif /* _WIN32 */
+
+// C++ includes.
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+#include <vector>
+using std::string;
+using std::unordered_set;
+using std::vector;
+
+namespace LibRomData {
+
+class CacheMaintenancePrivate
+{
+	public:
+		explicit CacheMaintenancePrivate(const string &cacheDir);
+
+	private:
+		RP_DISABLE_COPY(CacheMaintenancePrivate)
+
+	public:
+		/**
+		 * Cache file information.
+		 */
+		struct FileInfo {
+			string key;		// Path relative to the cache directory
+			uint64_t size;		// File size
+			time_t atime;		// Last access time
+			time_t ctime;		// Creation or status change time
+		};
+
+		/**
+		 * Get a file's size and timestamps.
+		 * @param filename	[in] Filename.
+		 * @param pInfo		[out] File information. (key is not modified)
+		 * @return 0 if this is a regular file; negative POSIX error code on error.
+		 */
+		static int getFileInfo(const string &filename, FileInfo *pInfo);
+
+		/**
+		 * Scan a directory.
+		 * Files are added to files, and subdirectories are added to dirStack.
+		 * @param relDir Directory, relative to the cache directory. (empty or with a trailing separator)
+		 */
+		void scanDirectory(const string &relDir);
+
+		/**
+		 * Add a file found by scanDirectory().
+		 * @param info File information.
+		 */
+		void addFile(FileInfo &&info);
+
+		/**
+		 * Finish scanning the cache directory.
+		 * The index is updated, and files are sorted by access time.
+		 */
+		void finishScan(void);
+
+		/**
+		 * Remove the next least-recently-used file.
+		 */
+		void evictOne(void);
+
+		/**
+		 * Is the cache over budget?
+		 * @return True if the cache is over budget.
+		 */
+		inline bool overBudget(void) const
+		{
+			return (budget.maxBytes != 0 && curBytes > budget.maxBytes) ||
+			       (budget.maxFiles != 0 && curFiles > budget.maxFiles);
+		}
+
+	public:
+		enum Phase {
+			PHASE_SCAN,	// Scanning the cache directory.
+			PHASE_EVICT,	// Removing least-recently-used files.
+			PHASE_DONE,	// Done.
+		};
+
+		string cacheDir;	// Cache directory, with trailing separator
+		CacheIndex index;
+		bool indexLoaded;
+
+		CacheMaintenance::Budget budget;
+		time_t gracePeriod;
+		CacheMaintenance::Stats stats;
+
+		Phase phase;
+		vector<string> dirStack;	// Directories that haven't been scanned yet
+		vector<FileInfo> files;		// Files, sorted by access time once the scan is done
+		size_t evictPos;		// Next file to check in PHASE_EVICT
+		uint64_t curBytes;		// Current total size
+		uint32_t curFiles;		// Current number of files
+};
+
+/** CacheMaintenancePrivate **/
+
+/**
+ * Add a trailing separator to a directory name, if needed.
+ * @param dir Directory name.
+ * @return Directory name with a trailing separator.
+ */
+static inline string withTrailingSeparator(const string &dir)
+{
+	string ret = dir;
+	if (!ret.empty() && ret[ret.size()-1] != DIR_SEP_CHR) {
+		ret += DIR_SEP_CHR;
+	}
+	return ret;
+}
+
+/**
+ * Get the current time from a monotonic clock.
+ * @return Time, in microseconds.
+ */
+static int64_t getTimeUs(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (count.QuadPart / freq.QuadPart * 1000000) +
+		((count.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart);
+#else /* !_WIN32 */
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (static_cast<int64_t>(ts.tv_sec) * 1000000) + (ts.tv_nsec / 1000);
+#endif /* _WIN32 */
+}
+
+CacheMaintenancePrivate::CacheMaintenancePrivate(const string &cacheDir)
+	: cacheDir(withTrailingSeparator(cacheDir.empty() ? FileSystem::getCacheDirectory() : cacheDir))
+	, index(this->cacheDir + "index.bin")
+	, indexLoaded(false)
+	, gracePeriod(CacheMaintenance::DEFAULT_GRACE_PERIOD)
+	, phase(PHASE_SCAN)
+	, evictPos(0)
+	, curBytes(0)
+	, curFiles(0)
+{
+	memset(&budget, 0, sizeof(budget));
+	memset(&stats, 0, sizeof(stats));
+
+	// Start with the cache directory itself.
+	dirStack.push_back(string());
+}
+
+/**
+ * Get a file's size and timestamps.
+ * @param filename	[in] Filename.
+ * @param pInfo		[out] File information. (key is not modified)
+ * @return 0 if this is a regular file; negative POSIX error code on error.
+ */
+int CacheMaintenancePrivate::getFileInfo(const string &filename, FileInfo *pInfo)
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA fad;
+	if (!GetFileAttributesExW(U82W_s(filename), GetFileExInfoStandard, &fad)) {
+		return -ENOENT;
+	}
+	if (fad.dwFileAttributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_REPARSE_POINT)) {
+		return -EISDIR;
+	}
+	pInfo->size = (static_cast<uint64_t>(fad.nFileSizeHigh) << 32) | fad.nFileSizeLow;
+	pInfo->atime = static_cast<time_t>(FileTimeToUnixTime(&fad.ftLastAccessTime));
+	pInfo->ctime = static_cast<time_t>(FileTimeToUnixTime(&fad.ftCreationTime));
+#else /* !_WIN32 */
+	// NOTE: lstat() is used so symlinks are skipped.
+	struct stat sb;
+	if (lstat(filename.c_str(), &sb) != 0) {
+		return -errno;
+	}
+	if (!S_ISREG(sb.st_mode)) {
+		return (S_ISDIR(sb.st_mode) ? -EISDIR : -EINVAL);
+	}
+	pInfo->size = static_cast<uint64_t>(sb.st_size);
+	pInfo->atime = sb.st_atime;
+	pInfo->ctime = sb.st_ctime;
+#endif /* _WIN32 */
+	return 0;
+}
+
+/**
+ * Add a file found by scanDirectory().
+ * @param info File information.
+ */
+void CacheMaintenancePrivate::addFile(FileInfo &&info)
+{
+	if (info.key == "index.bin" || info.key == "index.lock") {
+		// Download cache index and its lock file.
+		return;
+	}
+
+	if (info.key.size() > 4 && !info.key.compare(info.key.size() - 4, 4, ".tmp")) {
+		// Temporary file. If it's older than the grace period,
+		// it was left behind by an interrupted write.
+		if (time(nullptr) - info.ctime >= gracePeriod) {
+			if (FileSystem::delete_file(cacheDir + info.key) == 0) {
+				stats.removedFiles++;
+				stats.reclaimedBytes += info.size;
+			}
+		}
+		return;
+	}
+
+	// Use the index's access time if the file is indexed.
+	// CacheManager updates it when the file is used, whereas
+	// the file system's access time may not be updated.
+	CacheIndex::Entry entry;
+	if (index.lookup(info.key, &entry) && entry.status == CacheIndex::CIS_CACHED) {
+		info.atime = std::max(entry.last_access, entry.cached_time);
+	}
+
+	stats.totalFiles++;
+	stats.totalBytes += info.size;
+	files.push_back(std::move(info));
+}
+
+/**
+ * Scan a directory.
+ * Files are added to files, and subdirectories are added to dirStack.
+ * @param relDir Directory, relative to the cache directory. (empty or with a trailing separator)
+ */
+void CacheMaintenancePrivate::scanDirectory(const string &relDir)
+{
+#ifdef _WIN32
+	WIN32_FIND_DATAW ffd;
+	HANDLE hFind = FindFirstFileW(U82W_s(cacheDir + relDir + '*'), &ffd);
+	if (hFind == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	do {
+		if (ffd.cFileName[0] == L'.' && (ffd.cFileName[1] == L'\0' ||
+		    (ffd.cFileName[1] == L'.' && ffd.cFileName[2] == L'\0')))
+		{
+			// "." or ".."
+			continue;
+		}
+		if (ffd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) {
+			// Don't follow links.
+			continue;
+		}
+
+		string key = relDir;
+		key += W2U8(ffd.cFileName);
+		if (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+			key += DIR_SEP_CHR;
+			dirStack.push_back(std::move(key));
+			continue;
+		}
+
+		FileInfo info;
+		info.key = std::move(key);
+		info.size = (static_cast<uint64_t>(ffd.nFileSizeHigh) << 32) | ffd.nFileSizeLow;
+		info.atime = static_cast<time_t>(FileTimeToUnixTime(&ffd.ftLastAccessTime));
+		info.ctime = static_cast<time_t>(FileTimeToUnixTime(&ffd.ftCreationTime));
+		addFile(std::move(info));
+	} while (FindNextFileW(hFind, &ffd));
+	FindClose(hFind);
+#else /* !_WIN32 */
+	const string path = cacheDir + relDir;
+	DIR *const dir = opendir(path.c_str());
+	if (!dir) {
+		return;
+	}
+	struct dirent *de;
+	while ((de = readdir(dir)) != nullptr) {
+		if (de->d_name[0] == '.' && (de->d_name[1] == '\0' ||
+		    (de->d_name[1] == '.' && de->d_name[2] == '\0')))
+		{
+			// "." or ".."
+			continue;
+		}
+
+		FileInfo info;
+		info.key = relDir;
+		info.key += de->d_name;
+		const int ret = getFileInfo(path + de->d_name, &info);
+		if (ret == 0) {
+			addFile(std::move(info));
+		} else if (ret == -EISDIR) {
+			info.key += DIR_SEP_CHR;
+			dirStack.push_back(std::move(info.key));
+		}
+	}
+	closedir(dir);
+#endif /* _WIN32 */
+}
+
+/**
+ * Finish scanning the cache directory.
+ * The index is updated, and files are sorted by access time.
+ */
+void CacheMaintenancePrivate::finishScan(void)
+{
+	curBytes = stats.totalBytes;
+	curFiles = stats.totalFiles;
+
+	// Remove index entries for files that no longer exist.
+	unordered_set<string> keys;
+	keys.reserve(files.size());
+	for (auto iter = files.cbegin(); iter != files.cend(); ++iter) {
+		keys.insert(iter->key);
+	}
+	const vector<string> indexKeys = index.keys();
+	for (auto iter = indexKeys.cbegin(); iter != indexKeys.cend(); ++iter) {
+		if (keys.find(*iter) == keys.end()) {
+			index.remove(*iter);
+		}
+	}
+
+	if (!overBudget()) {
+		// Nothing to remove.
+		files.clear();
+		phase = PHASE_DONE;
+		return;
+	}
+
+	// Least-recently-used files first.
+	std::sort(files.begin(), files.end(), [](const FileInfo &a, const FileInfo &b) {
+		return (a.atime < b.atime);
+	});
+	evictPos = 0;
+	phase = PHASE_EVICT;
+}
+
+/**
+ * Remove the next least-recently-used file.
+ */
+void CacheMaintenancePrivate::evictOne(void)
+{
+	FileInfo &info = files[evictPos++];
+	const string filename = cacheDir + info.key;
+	const time_t now = time(nullptr);
+
+	// Check the file again, since it may have been
+	// accessed or rewritten after it was scanned.
+	FileInfo cur;
+	int ret = getFileInfo(filename, &cur);
+	if (ret == -ENOENT) {
+		// File was already removed.
+		curBytes -= info.size;
+		curFiles--;
+		index.remove(info.key);
+		return;
+	} else if (ret != 0) {
+		stats.skippedFiles++;
+		return;
+	}
+
+	CacheIndex::Entry entry;
+	time_t atime;
+	if (index.lookup(info.key, &entry) && entry.status == CacheIndex::CIS_CACHED) {
+		atime = std::max(entry.last_access, entry.cached_time);
+	} else {
+		atime = std::max(info.atime, cur.atime);
+	}
+	if (now - atime < gracePeriod || now - cur.ctime < gracePeriod) {
+		// File was used recently, or it may still be
+		// in the process of being written by rp-download.
+		stats.skippedFiles++;
+		return;
+	}
+
+	ret = FileSystem::delete_file(filename);
+	if (ret != 0 && ret != -ENOENT) {
+		stats.skippedFiles++;
+		return;
+	}
+
+	curBytes -= info.size;
+	curFiles--;
+	if (ret == 0) {
+		stats.removedFiles++;
+		stats.reclaimedBytes += cur.size;
+	}
+	index.remove(info.key);
+	info.key.clear();
+}
+
+/** CacheMaintenance **/
+
+/**
+ * Create a cache maintenance pass.
+ * @param cacheDir Cache directory. (If empty, the rom-properties cache directory is used.)
+ */
+CacheMaintenance::CacheMaintenance(const string &cacheDir)
+	: d_ptr(new CacheMaintenancePrivate(cacheDir))
+{ }
+
+CacheMaintenance::~CacheMaintenance()
+{
+	delete d_ptr;
+}
+
+/**
+ * Get the cache budget from the configuration.
+ * @param budget [out] Cache budget.
+ */
+void CacheMaintenance::getConfigBudget(Budget *budget)
+{
+	const Config *const config = Config::instance();
+	budget->maxBytes = static_cast<uint64_t>(config->maxCacheSize()) * 1024U * 1024U;
+	budget->maxFiles = config->maxCacheFiles();
+}
+
+/**
+ * Set the cache budget.
+ * This must be set before calling step() for the first time.
+ * @param budget Cache budget.
+ */
+void CacheMaintenance::setBudget(const Budget &budget)
+{
+	RP_D(CacheMaintenance);
+	d->budget = budget;
+}
+
+/**
+ * Set the grace period.
+ * Files created or accessed within the grace period are never removed.
+ * @param seconds Grace period, in seconds.
+ */
+void CacheMaintenance::setGracePeriod(time_t seconds)
+{
+	RP_D(CacheMaintenance);
+	d->gracePeriod = seconds;
+}
+
+/**
+ * Run cache maintenance for up to the specified amount of time.
+ *
+ * The cache directory is scanned, and the least-recently-used
+ * files are removed until the cache is within budget. Access
+ * times are taken from the download cache index if available,
+ * or from the file system otherwise.
+ *
+ * Each call does a bounded amount of work, so step() can be
+ * called repeatedly, e.g. between downloads. A single directory
+ * is always scanned completely, so a time slice may be exceeded
+ * for very large directories.
+ *
+ * @param sliceMs Time slice, in milliseconds. (0 to run until done)
+ * @return 1 if more work remains; 0 if done; negative POSIX error code on error.
+ */
+int CacheMaintenance::step(unsigned int sliceMs)
+{
+	RP_D(CacheMaintenance);
+	if (d->phase == CacheMaintenancePrivate::PHASE_DONE)
+		return 0;
+	if (d->cacheDir.size() <= 1) {
+		// No cache directory.
+		return -ENOENT;
+	}
+
+	const int64_t start = getTimeUs();
+	const int64_t deadline = start + (static_cast<int64_t>(sliceMs) * 1000);
+	d->stats.slices++;
+
+	// Reload the index on each step, since CacheManager
+	// may have updated the access times.
+	if (!d->indexLoaded || d->phase == CacheMaintenancePrivate::PHASE_EVICT) {
+		d->index.reload();
+		d->indexLoaded = true;
+	}
+
+	while (d->phase != CacheMaintenancePrivate::PHASE_DONE) {
+		if (d->phase == CacheMaintenancePrivate::PHASE_SCAN) {
+			if (d->dirStack.empty()) {
+				d->finishScan();
+				continue;
+			}
+			const string relDir = std::move(d->dirStack.back());
+			d->dirStack.pop_back();
+			d->scanDirectory(relDir);
+		} else /*if (d->phase == CacheMaintenancePrivate::PHASE_EVICT)*/ {
+			if (d->evictPos >= d->files.size() || !d->overBudget()) {
+				// Within budget, or no more files can be removed.
+				d->files.clear();
+				d->phase = CacheMaintenancePrivate::PHASE_DONE;
+				break;
+			}
+			d->evictOne();
+		}
+
+		if (sliceMs != 0 && getTimeUs() >= deadline) {
+			// Out of time.
+			break;
+		}
+	}
+
+	// Save the index changes.
+	if (d->index.isDirty()) {
+		d->index.commit();
+	}
+
+	d->stats.elapsed_us += (getTimeUs() - start);
+	d->stats.done = (d->phase == CacheMaintenancePrivate::PHASE_DONE);
+	return (d->stats.done ? 0 : 1);
+}
+
+/**
+ * Run cache maintenance until it's done.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheMaintenance::run(void)
+{
+	return step(0);
+}
+
+/**
+ * Get the cache maintenance statistics.
+ * @return Statistics.
+ */
+const CacheMaintenance::Stats &CacheMaintenance::stats(void) const
+{
+	RP_D(const CacheMaintenance);
+	return d->stats;
+}
+
+}
@@ -0,0 +1,122 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * CacheMaintenance.hpp: Size-bounded cache eviction.                      *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBROMDATA_IMG_CACHEMAINTENANCE_HPP__
+#define __ROMPROPERTIES_LIBROMDATA_IMG_CACHEMAINTENANCE_HPP__
+
+#include "common.h"
+
+// C includes.
+#include <stdint.h>
+
+// C includes. (C++ namespace)
+#include <ctime>
+
+// C++ includes.
+#include <string>
+
+namespace LibRomData {
+
+class CacheMaintenancePrivate;
+class CacheMaintenance
+{
+	public:
+		/**
+		 * Create a cache maintenance pass.
+		 * @param cacheDir Cache directory. (If empty, the rom-properties cache directory is used.)
+		 */
+		explicit CacheMaintenance(const std::string &cacheDir = std::string());
+		~CacheMaintenance();
+
+	private:
+		RP_DISABLE_COPY(CacheMaintenance)
+	private:
+		friend class CacheMaintenancePrivate;
+		CacheMaintenancePrivate *const d_ptr;
+
+	public:
+		// Files created or accessed less than this many seconds ago
+		// are never removed, since rp-download may still be writing them.
+		static const time_t DEFAULT_GRACE_PERIOD = 600;
+
+		/**
+		 * Cache budget. 0 means unlimited.
+		 */
+		struct Budget {
+			uint64_t maxBytes;	// Maximum total size, in bytes
+			uint32_t maxFiles;	// Maximum number of files
+		};
+
+		/**
+		 * Cache maintenance statistics.
+		 */
+		struct Stats {
+			uint32_t totalFiles;	// Number of files in the cache before eviction
+			uint64_t totalBytes;	// Total size of the cache before eviction
+			uint32_t removedFiles;	// Number of files removed
+			uint64_t reclaimedBytes;// Number of bytes reclaimed
+			uint32_t skippedFiles;	// Number of files that couldn't be removed
+			uint32_t slices;	// Number of time slices used
+			uint64_t elapsed_us;	// Time spent in step(), in microseconds
+			bool done;		// True if the maintenance pass is complete
+		};
+
+		/**
+		 * Get the cache budget from the configuration.
+		 * @param budget [out] Cache budget.
+		 */
+		static void getConfigBudget(Budget *budget);
+
+		/**
+		 * Set the cache budget.
+		 * This must be set before calling step() for the first time.
+		 * @param budget Cache budget.
+		 */
+		void setBudget(const Budget &budget);
+
+		/**
+		 * Set the grace period.
+		 * Files created or accessed within the grace period are never removed.
+		 * @param seconds Grace period, in seconds.
+		 */
+		void setGracePeriod(time_t seconds);
+
+		/**
+		 * Run cache maintenance for up to the specified amount of time.
+		 *
+		 * The cache directory is scanned, and the least-recently-used
+		 * files are removed until the cache is within budget. Access
+		 * times are taken from the download cache index if available,
+		 * or from the file system otherwise.
+		 *
+		 * Each call does a bounded amount of work, so step() can be
+		 * called repeatedly, e.g. between downloads. A single directory
+		 * is always scanned completely, so a time slice may be exceeded
+		 * for very large directories.
+		 *
+		 * @param sliceMs Time slice, in milliseconds. (0 to run until done)
+		 * @return 1 if more work remains; 0 if done; negative POSIX error code on error.
+		 */
+		int step(unsigned int sliceMs);
+
+		/**
+		 * Run cache maintenance until it's done.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int run(void);
+
+		/**
+		 * Get the cache maintenance statistics.
+		 * @return Statistics.
+		 */
+		const Stats &stats(void) const;
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBROMDATA_IMG_CACHEMAINTENANCE_HPP__ */
@@ -9,6 +9,8 @@
 #include "stdafx.h"
 #include "config.libromdata.h"
 #include "CacheManager.hpp"
+#include "CacheIndex.hpp"
+#include "CacheMaintenance.hpp"
 
 // librpbase, librpfile
 #include "librpbase/TextFuncs.hpp"
@@ -17,6 +19,9 @@
 using namespace LibRpBase;
 using namespace LibRpFile;
 
+// librpthreads
+#include "librpthreads/Mutex.hpp"
+
 // libcachecommon
 #include "libcachecommon/CacheKeys.hpp"
 
@@ -34,11 +39,16 @@ using namespace LibRpFile;
 #endif /* _WIN32 */
 
 // C includes. (C++ namespace)
+#include <cstring>
 #include <ctime>
 
 // C++ includes.
+#include <memory>
 #include <string>
+#include <vector>
 using std::string;
+using std::unique_ptr;
+using std::vector;
 #ifdef _WIN32
 using std::wstring;
 #endif /* _WIN32 */
@@ -50,6 +60,300 @@ namespace LibRomData {
 // TODO: Test this on XP with IEIFLAG_ASYNC.
 Semaphore CacheManager::m_dlsem(2);
 
+// Download latency histograms.
+static CacheManager::LatencyHistogram latencyHistograms[CacheManager::RT_MAX];
+static Mutex latencyMutex;
+
+// Download cache index.
+// Shared by all CacheManager instances.
+static unique_ptr<CacheIndex> cacheIndex;
+static time_t cacheIndexLoadTime = 0;
+static time_t cacheIndexCommitTime = 0;
+static Mutex cacheIndexMutex;
+
+// Download cache maintenance.
+// If the cache has a size budget, a maintenance pass is started
+// at most once per hour, and it's run in short time slices after
+// each download so the caller isn't blocked for long.
+static const time_t MAINTENANCE_INTERVAL = 3600;
+static const unsigned int MAINTENANCE_SLICE_MS = 20;
+static unique_ptr<CacheMaintenance> cacheMaintenance;
+static time_t cacheMaintenanceStartTime = 0;
+static Mutex cacheMaintenanceMutex;
+
+/**
+ * Get the current time from a monotonic clock.
+ * @return Time, in milliseconds.
+ */
+static int64_t getTimeMs(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (count.QuadPart / freq.QuadPart * 1000) +
+		((count.QuadPart % freq.QuadPart) * 1000 / freq.QuadPart);
+#else /* !_WIN32 */
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (static_cast<int64_t>(ts.tv_sec) * 1000) + (ts.tv_nsec / 1000000);
+#endif /* _WIN32 */
+}
+
+/**
+ * Cache file status.
+ */
+enum CacheFileStatus {
+	CFS_UNAVAILABLE,	// Negative cache entry, or error.
+	CFS_MISSING,		// Not in the cache.
+	CFS_CACHED,		// In the cache.
+};
+
+/**
+ * Check the status of a file in the cache.
+ * @param cache_filename	[in] Cache filename.
+ * @param deleteExpired		[in] If true, delete expired negative cache entries.
+ * @param pEntry		[out] Cache index entry for the file. (status is CIS_NONE if the file shouldn't be indexed)
+ * @return CacheFileStatus
+ */
+static CacheFileStatus checkCacheFile(const string &cache_filename, bool deleteExpired, CacheIndex::Entry *pEntry)
+{
+	memset(pEntry, 0, sizeof(*pEntry));
+	pEntry->status = CacheIndex::CIS_NONE;
+
+	off64_t filesize = 0;
+	time_t filemtime = 0;
+	int ret = FileSystem::get_file_size_and_mtime(cache_filename.c_str(), &filesize, &filemtime);
+	if (ret == 0) {
+		// Check if the file is 0 bytes.
+		// TODO: How should we handle errors?
+		if (filesize == 0) {
+			// File is 0 bytes, which indicates it didn't exist
+			// on the server. If the file is older than a week,
+			// try to redownload it.
+			const time_t systime = time(nullptr);
+			if ((systime - filemtime) < CacheIndex::NEGATIVE_TTL || !deleteExpired) {
+				// Less than a week old.
+				pEntry->status = CacheIndex::CIS_NEGATIVE;
+				pEntry->cached_time = filemtime;
+				pEntry->expires = filemtime + CacheIndex::NEGATIVE_TTL;
+				return CFS_UNAVAILABLE;
+			}
+
+			// More than a week old.
+			// Delete the cache file and try to download it again.
+			if (FileSystem::delete_file(cache_filename) != 0) {
+				// Unable to delete the cache file.
+				return CFS_UNAVAILABLE;
+			}
+			return CFS_MISSING;
+		} else if (filesize > 0) {
+			// File is larger than 0 bytes, which indicates
+			// it was cached successfully.
+			// NOTE: rp-download sets the mtime to the server's
+			// Last-Modified time, so the download time isn't known.
+			pEntry->status = CacheIndex::CIS_CACHED;
+			pEntry->size = static_cast<uint32_t>(filesize);
+			pEntry->cached_time = filemtime;
+			pEntry->last_modified = filemtime;
+			pEntry->last_access = time(nullptr);
+			return CFS_CACHED;
+		}
+	} else if (ret == -ENOENT) {
+		// File not found.
+		return CFS_MISSING;
+	}
+
+	// Some error other than "file not found" occurred.
+	return CFS_UNAVAILABLE;
+}
+
+/**
+ * Run a time slice of download cache maintenance.
+ * Nothing is done if the cache doesn't have a size budget.
+ */
+static void runCacheMaintenance(void)
+{
+	MutexLocker locker(cacheMaintenanceMutex);
+	if (!cacheMaintenance) {
+		const time_t now = time(nullptr);
+		if (now - cacheMaintenanceStartTime < MAINTENANCE_INTERVAL)
+			return;
+		cacheMaintenanceStartTime = now;
+
+		CacheMaintenance::Budget budget;
+		CacheMaintenance::getConfigBudget(&budget);
+		if (budget.maxBytes == 0 && budget.maxFiles == 0) {
+			// No budget.
+			return;
+		}
+		cacheMaintenance.reset(new CacheMaintenance());
+		cacheMaintenance->setBudget(budget);
+	}
+
+	// CacheMaintenance commits its own copy of the index, so hold
+	// cacheIndexMutex to keep this thread's commits from racing it.
+	// NOTE: Lock order is cacheMaintenanceMutex, then cacheIndexMutex.
+	MutexLocker indexLocker(cacheIndexMutex);
+	const int ret = cacheMaintenance->step(MAINTENANCE_SLICE_MS);
+
+	// Reload the shared index on next use to pick up the changes.
+	cacheIndexLoadTime = 0;
+
+	if (ret <= 0) {
+		// Maintenance pass is done.
+		cacheMaintenance.reset();
+	}
+}
+
+/**
+ * Get the download cache index.
+ * The index is reloaded at most once per second,
+ * since another process may have updated it.
+ * cacheIndexMutex must be locked by the caller.
+ * @return CacheIndex, or nullptr if the cache directory isn't available.
+ */
+static CacheIndex *getCacheIndex(void)
+{
+	if (!cacheIndex) {
+		const string filename = CacheIndex::defaultFilename();
+		if (filename.empty())
+			return nullptr;
+		cacheIndex.reset(new CacheIndex(filename));
+	}
+
+	const time_t now = time(nullptr);
+	if (now != cacheIndexLoadTime) {
+		cacheIndex->reload();
+		cacheIndexLoadTime = now;
+	}
+	return cacheIndex.get();
+}
+
+/**
+ * Commit changes to the download cache index.
+ * Unless forced, the index is written at most once per second,
+ * since checking a lot of files that aren't in the index yet
+ * would otherwise rewrite it for each file.
+ * cacheIndexMutex must be locked by the caller.
+ * @param index	[in] CacheIndex
+ * @param force	[in] If true, always write the index if it has changes.
+ */
+static void commitCacheIndex(CacheIndex *index, bool force)
+{
+	if (!index || !index->isDirty())
+		return;
+
+	const time_t now = time(nullptr);
+	if (!force && now == cacheIndexCommitTime)
+		return;
+
+	// NOTE: If the commit fails, the changes are kept in memory.
+	index->commit();
+	cacheIndexCommitTime = now;
+	cacheIndexLoadTime = now;
+}
+
+/**
+ * Get the download cache index key for a cache key.
+ * @param cache_key Cache key.
+ * @return Filtered cache key, or empty string on error.
+ */
+static string getIndexKey(const string &cache_key)
+{
+	string index_key = cache_key;
+	if (LibCacheCommon::filterCacheKey(index_key) != 0) {
+		index_key.clear();
+	}
+	return index_key;
+}
+
+/**
+ * Check the status of a file in the cache, using the download cache index.
+ * If the file isn't in the index, the file itself is checked, and it's
+ * added to the index.
+ * cacheIndexMutex must be locked by the caller.
+ * @param index			[in] CacheIndex (may be nullptr)
+ * @param index_key		[in] Index key, from getIndexKey().
+ * @param cache_filename	[in] Cache filename.
+ * @param deleteExpired		[in] If true, delete expired negative cache entries.
+ * @return CacheFileStatus
+ */
+static CacheFileStatus checkCacheIndex(CacheIndex *index, const string &index_key,
+	const string &cache_filename, bool deleteExpired)
+{
+	CacheIndex::Entry entry;
+	if (!index || index_key.empty()) {
+		// Index isn't available.
+		return checkCacheFile(cache_filename, deleteExpired, &entry);
+	}
+
+	if (index->lookup(index_key, &entry)) {
+		if (entry.status == CacheIndex::CIS_CACHED) {
+			// File is cached.
+			// NOTE: The file isn't checked here, since that would
+			// defeat the purpose of the index. If the file was deleted
+			// by another program, CacheMaintenance removes the stale
+			// index entry the next time it scans the cache directory.
+			// Update the access time for cache maintenance.
+			index->touch(index_key, time(nullptr));
+			return CFS_CACHED;
+		}
+
+		// Negative cache entry.
+		if (time(nullptr) < entry.expires || !deleteExpired) {
+			// Not expired yet.
+			return CFS_UNAVAILABLE;
+		}
+
+		// Expired. Delete the cache file and try to download it again.
+		const int ret = FileSystem::delete_file(cache_filename);
+		if (ret != 0 && ret != -ENOENT) {
+			// Unable to delete the cache file.
+			return CFS_UNAVAILABLE;
+		}
+		index->remove(index_key);
+		return CFS_MISSING;
+	}
+
+	// Not in the index. Check the file.
+	const CacheFileStatus cfs = checkCacheFile(cache_filename, deleteExpired, &entry);
+	if (entry.status != CacheIndex::CIS_NONE) {
+		index->set(index_key, entry);
+	}
+	return cfs;
+}
+
+/**
+ * Update the download cache index after running rp-download.
+ * cacheIndexMutex must be locked by the caller.
+ * @param index			[in] CacheIndex (may be nullptr)
+ * @param index_key		[in] Index key, from getIndexKey().
+ * @param cache_filename	[in] Cache filename.
+ */
+static void updateCacheIndex(CacheIndex *index, const string &index_key, const string &cache_filename)
+{
+	if (!index || index_key.empty())
+		return;
+
+	CacheIndex::Entry entry;
+	checkCacheFile(cache_filename, false, &entry);
+	switch (entry.status) {
+		case CacheIndex::CIS_CACHED:
+			// File was just downloaded.
+			entry.cached_time = time(nullptr);
+			index->set(index_key, entry);
+			break;
+		case CacheIndex::CIS_NEGATIVE:
+			index->set(index_key, entry);
+			break;
+		case CacheIndex::CIS_NONE:
+		default:
+			index->remove(index_key);
+			break;
+	}
+}
+
 /** Proxy server functions. **/
 // NOTE: This is only useful for downloaders that
 // can't retrieve the system proxy server normally.
@@ -114,43 +418,28 @@ string CacheManager::download(const string &cache_key)
 		// Error obtaining the cache key filename.
 		return string();
 	}
+	const string index_key = getIndexKey(cache_key);
 
 	// Lock the semaphore to make sure we don't
 	// download too many files at once.
 	SemaphoreLocker locker(m_dlsem);
 
 	// Check if the file already exists.
-	off64_t filesize = 0;
-	time_t filemtime = 0;
-	int ret = FileSystem::get_file_size_and_mtime(cache_filename.c_str(), &filesize, &filemtime);
-	if (ret == 0) {
-		// Check if the file is 0 bytes.
-		// TODO: How should we handle errors?
-		if (filesize == 0) {
-			// File is 0 bytes, which indicates it didn't exist
-			// on the server. If the file is older than a week,
-			// try to redownload it.
-			// TODO: Configurable time.
-			const time_t systime = time(nullptr);
-			if ((systime - filemtime) < (86400*7)) {
-				// Less than a week old.
-				return string();
-			}
-
-			// More than a week old.
-			// Delete the cache file and try to download it again.
-			if (FileSystem::delete_file(cache_filename) != 0) {
-				// Unable to delete the cache file.
-				return string();
-			}
-		} else if (filesize > 0) {
-			// File is larger than 0 bytes, which indicates
-			// it was cached successfully.
+	CacheFileStatus cfs;
+	{
+		MutexLocker indexLocker(cacheIndexMutex);
+		CacheIndex *const index = getCacheIndex();
+		cfs = checkCacheIndex(index, index_key, cache_filename, true);
+		commitCacheIndex(index, false);
+	}
+	switch (cfs) {
+		case CFS_CACHED:
 			return cache_filename;
-		}
-	} else if (ret != -ENOENT) {
-		// Some error other than "file not found" occurred.
-		return string();
+		case CFS_MISSING:
+			break;
+		case CFS_UNAVAILABLE:
+		default:
+			return string();
 	}
 
 	// TODO: Add an option for "offline only".
@@ -165,7 +454,19 @@ string CacheManager::download(const string &cache_key)
 	// NOTE: Using the unfiltered cache key, since filtering it
 	// results in slashes being changed to backslashes on Windows.
 	// rp-download will filter the key itself.
-	ret = execRpDownload(cache_key);
+	const int64_t start_ms = getTimeMs();
+	int ret = execRpDownload(cache_key);
+	recordLatency(RT_DOWNLOAD, static_cast<uint32_t>(getTimeMs() - start_ms), (ret == 0));
+
+	// Update the index with the result.
+	{
+		MutexLocker indexLocker(cacheIndexMutex);
+		CacheIndex *const index = getCacheIndex();
+		updateCacheIndex(index, index_key, cache_filename);
+		commitCacheIndex(index, true);
+	}
+	runCacheMaintenance();
+
 	if (ret != 0) {
 		// rp-download failed for some reason.
 		return string();
@@ -175,6 +476,122 @@ string CacheManager::download(const string &cache_key)
 	return cache_filename;
 }
 
+/**
+ * Download the first available file from a list of cache keys.
+ *
+ * Files that aren't in the cache are downloaded concurrently,
+ * subject to the per-host connection limit. Once the first
+ * available file in priority order is known, the remaining
+ * downloads are cancelled.
+ *
+ * If concurrent downloads aren't supported on this system,
+ * the files are downloaded one at a time.
+ *
+ * @param entries	[in] Download entries, in priority order.
+ * @param pIndex	[out,opt] Index of the entry that was used.
+ * @return Absolute path to the cached file, or empty string if none are available.
+ */
+string CacheManager::downloadFirst(const vector<DownloadEntry> &entries, unsigned int *pIndex)
+{
+	// Get the cache filenames.
+	const unsigned int count = static_cast<unsigned int>(entries.size());
+	vector<string> cache_filenames, index_keys;
+	cache_filenames.reserve(count);
+	index_keys.reserve(count);
+	for (auto iter = entries.cbegin(); iter != entries.cend(); ++iter) {
+		cache_filenames.push_back(LibCacheCommon::getCacheFilename(iter->cache_key));
+		index_keys.push_back(getIndexKey(iter->cache_key));
+	}
+
+	// Lock the semaphore to make sure we don't
+	// download too many files at once.
+	SemaphoreLocker locker(m_dlsem);
+
+	// Check the cache.
+	// Entries after the first one that's already cached aren't needed.
+	int found = -1;
+	vector<string> dl_keys;
+	vector<unsigned int> dl_idx;
+	{
+		MutexLocker indexLocker(cacheIndexMutex);
+		CacheIndex *const index = getCacheIndex();
+		for (unsigned int i = 0; i < count; i++) {
+			if (cache_filenames[i].empty()) {
+				// Error obtaining the cache key filename.
+				continue;
+			}
+
+			const DownloadEntry &entry = entries[i];
+			const CacheFileStatus cfs = checkCacheIndex(index, index_keys[i],
+				cache_filenames[i], !entry.cacheOnly);
+			if (cfs == CFS_CACHED) {
+				// File is already cached.
+				found = static_cast<int>(i);
+				break;
+			} else if (cfs == CFS_MISSING && !entry.cacheOnly) {
+				// File needs to be downloaded.
+				// NOTE: Using the unfiltered cache key. (See download().)
+				dl_keys.push_back(entry.cache_key);
+				dl_idx.push_back(i);
+			}
+		}
+		commitCacheIndex(index, false);
+	}
+
+	if (!dl_keys.empty()) {
+		// Download the files.
+		const int64_t start_ms = getTimeMs();
+		const int cached = found;
+		string results;
+		int ret = execRpDownloadFirst(dl_keys, results);
+		if (ret == 0 && results.size() == dl_keys.size()) {
+			// Find the first file that was downloaded.
+			const size_t pos = results.find('0');
+			if (pos != string::npos) {
+				found = static_cast<int>(dl_idx[pos]);
+			}
+		} else if (ret == -ENOTSUP) {
+			// Concurrent downloads aren't available.
+			// Download the files one at a time.
+			// Files that weren't attempted are marked as cancelled.
+			results.assign(dl_keys.size(), '2');
+			for (size_t j = 0; j < dl_keys.size(); j++) {
+				if (execRpDownload(dl_keys[j]) == 0) {
+					results[j] = '0';
+					found = static_cast<int>(dl_idx[j]);
+					break;
+				}
+				results[j] = '1';
+			}
+		}
+		recordLatency(RT_DOWNLOAD_FIRST, static_cast<uint32_t>(getTimeMs() - start_ms), (found != cached));
+
+		// Update the index with the results.
+		// Cancelled downloads don't have cache files.
+		if (results.size() == dl_keys.size()) {
+			MutexLocker indexLocker(cacheIndexMutex);
+			CacheIndex *const index = getCacheIndex();
+			for (size_t j = 0; j < dl_keys.size(); j++) {
+				if (results[j] != '2') {
+					const unsigned int i = dl_idx[j];
+					updateCacheIndex(index, index_keys[i], cache_filenames[i]);
+				}
+			}
+			commitCacheIndex(index, true);
+		}
+		runCacheMaintenance();
+	}
+
+	if (found < 0) {
+		// No files are available.
+		return string();
+	}
+	if (pIndex) {
+		*pIndex = static_cast<unsigned int>(found);
+	}
+	return cache_filenames[found];
+}
+
 /**
  * Check if a file has already been cached.
  * @param cache_key Cache key.
@@ -190,11 +607,102 @@ string CacheManager::findInCache(const string &cache_key)
 	}
 
 	// Return the filename if the file exists.
-	if (FileSystem::access(cache_filename, R_OK) != 0) {
-		// Unable to read the cache file.
+	MutexLocker indexLocker(cacheIndexMutex);
+	CacheIndex *const index = getCacheIndex();
+	if (checkCacheIndex(index, getIndexKey(cache_key), cache_filename, false) == CFS_MISSING) {
+		// File isn't in the cache.
 		cache_filename.clear();
 	}
+	commitCacheIndex(index, false);
 	return cache_filename;
 }
 
+/** Download statistics **/
+
+/**
+ * Get a download latency histogram.
+ * Statistics are shared by all CacheManager instances.
+ * @param type	[in] Request type.
+ * @param hist	[out] Latency histogram.
+ */
+void CacheManager::getLatencyHistogram(RequestType type, LatencyHistogram *hist)
+{
+	assert(type >= 0 && type < RT_MAX);
+	assert(hist != nullptr);
+	if (type < 0 || type >= RT_MAX || !hist)
+		return;
+
+	MutexLocker locker(latencyMutex);
+	*hist = latencyHistograms[type];
+}
+
+/**
+ * Get the download latency histogram for all request types.
+ * Statistics are shared by all CacheManager instances.
+ * @param hist	[out] Latency histogram.
+ */
+void CacheManager::getTotalLatencyHistogram(LatencyHistogram *hist)
+{
+	assert(hist != nullptr);
+	if (!hist)
+		return;
+
+	memset(hist, 0, sizeof(*hist));
+	MutexLocker locker(latencyMutex);
+	for (const LatencyHistogram &src : latencyHistograms) {
+		for (unsigned int i = 0; i < LatencyHistogram::BUCKET_COUNT; i++) {
+			hist->buckets[i] += src.buckets[i];
+		}
+		hist->count += src.count;
+		hist->failed += src.failed;
+		hist->total_ms += src.total_ms;
+		if (src.max_ms > hist->max_ms) {
+			hist->max_ms = src.max_ms;
+		}
+	}
+}
+
+/**
+ * Reset all download latency histograms.
+ */
+void CacheManager::resetLatencyHistograms(void)
+{
+	MutexLocker locker(latencyMutex);
+	memset(latencyHistograms, 0, sizeof(latencyHistograms));
+}
+
+/**
+ * Record a download request's latency.
+ * @param type	[in] Request type.
+ * @param ms	[in] Latency, in milliseconds.
+ * @param ok	[in] True if a file was downloaded.
+ */
+void CacheManager::recordLatency(RequestType type, uint32_t ms, bool ok)
+{
+	assert(type >= 0 && type < RT_MAX);
+	if (type < 0 || type >= RT_MAX)
+		return;
+
+	// Determine the bucket: floor(log2(ms)) + 1, or 0 if ms == 0.
+	unsigned int bucket = 0;
+	for (uint32_t tmp = ms; tmp != 0; tmp >>= 1) {
+		bucket++;
+	}
+	if (bucket >= LatencyHistogram::BUCKET_COUNT) {
+		bucket = LatencyHistogram::BUCKET_COUNT - 1;
+	}
+
+	MutexLocker locker(latencyMutex);
+	LatencyHistogram &hist = latencyHistograms[type];
+	hist.buckets[bucket]++;
+	hist.count++;
+	if (!ok) {
+		hist.failed++;
+	}
+	hist.total_ms += ms;
+	if (ms > hist.max_ms) {
+		hist.max_ms = ms;
+	}
+}
+
 }
@@ -14,8 +14,12 @@
 // librpthreads
 #include "librpthreads/Semaphore.hpp"
 
+// C includes.
+#include <stdint.h>
+
 // C++ includes.
 #include <string>
+#include <vector>
 
 namespace LibRomData {
 
@@ -70,6 +74,31 @@ class CacheManager
 		 */
 		std::string download(const std::string &cache_key);
 
+		/**
+		 * Entry for downloadFirst().
+		 */
+		struct DownloadEntry {
+			std::string cache_key;	// Cache key
+			bool cacheOnly;		// If true, only check the cache.
+		};
+
+		/**
+		 * Download the first available file from a list of cache keys.
+		 *
+		 * Files that aren't in the cache are downloaded concurrently,
+		 * subject to the per-host connection limit. Once the first
+		 * available file in priority order is known, the remaining
+		 * downloads are cancelled.
+		 *
+		 * If concurrent downloads aren't supported on this system,
+		 * the files are downloaded one at a time.
+		 *
+		 * @param entries	[in] Download entries, in priority order.
+		 * @param pIndex	[out,opt] Index of the entry that was used.
+		 * @return Absolute path to the cached file, or empty string if none are available.
+		 */
+		std::string downloadFirst(const std::vector<DownloadEntry> &entries, unsigned int *pIndex = nullptr);
+
 		/**
 		 * Check if a file has already been cached.
 		 * @param cache_key Cache key.
@@ -77,6 +106,66 @@ class CacheManager
 		 */
 		std::string findInCache(const std::string &cache_key);
 
+	public:
+		/** Download statistics **/
+
+		/**
+		 * Download request types for latency histograms.
+		 */
+		enum RequestType {
+			RT_DOWNLOAD,		// download()
+			RT_DOWNLOAD_FIRST,	// downloadFirst()
+
+			RT_MAX
+		};
+
+		/**
+		 * Download latency histogram.
+		 * Only requests that run rp-download are counted.
+		 */
+		struct LatencyHistogram {
+			// Number of histogram buckets.
+			static const unsigned int BUCKET_COUNT = 16;
+
+			// Bucket i counts requests that took less than (1 << i) ms.
+			// The last bucket counts all slower requests.
+			uint32_t buckets[BUCKET_COUNT];
+
+			uint32_t count;		// Number of requests
+			uint32_t failed;	// Number of requests where no file was downloaded
+			uint64_t total_ms;	// Total time, in milliseconds
+			uint32_t max_ms;	// Slowest request, in milliseconds
+		};
+
+		/**
+		 * Get a download latency histogram.
+		 * Statistics are shared by all CacheManager instances.
+		 * @param type	[in] Request type.
+		 * @param hist	[out] Latency histogram.
+		 */
+		static void getLatencyHistogram(RequestType type, LatencyHistogram *hist);
+
+		/**
+		 * Get the download latency histogram for all request types.
+		 * Statistics are shared by all CacheManager instances.
+		 * @param hist	[out] Latency histogram.
+		 */
+		static void getTotalLatencyHistogram(LatencyHistogram *hist);
+
+		/**
+		 * Reset all download latency histograms.
+		 */
+		static void resetLatencyHistograms(void);
+
+	protected:
+		/**
+		 * Record a download request's latency.
+		 * @param type	[in] Request type.
+		 * @param ms	[in] Latency, in milliseconds.
+		 * @param ok	[in] True if a file was downloaded.
+		 */
+		static void recordLatency(RequestType type, uint32_t ms, bool ok);
+
 	protected:
 		/**
 		 * Execute rp-download.
@@ -85,6 +174,15 @@ class CacheManager
 		 */
 		int execRpDownload(const std::string &filtered_cache_key);
 
+		/**
+		 * Execute rp-download to download the first available file
+		 * from a list of cache keys, using concurrent downloads.
+		 * @param cache_keys	[in] Cache keys, in priority order.
+		 * @param results	[out] Results: One character per cache key. ('0' == downloaded, '1' == failed, '2' == cancelled)
+		 * @return 0 on success; -ENOTSUP if concurrent downloads aren't available; other negative POSIX error code on error.
+		 */
+		int execRpDownloadFirst(const std::vector<std::string> &cache_keys, std::string &results);
+
 	protected:
 		std::string m_proxyUrl;
 
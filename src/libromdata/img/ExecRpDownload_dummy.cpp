@@ -26,4 +26,19 @@ int CacheManager::execRpDownload(const string &filteredCacheKey)
 	return -ENOSYS;
 }
 
+/**
+ * Execute rp-download to download the first available file
+ * from a list of cache keys, using concurrent downloads. (Dummy version)
+ * @param cache_keys	[in] Cache keys, in priority order.
+ * @param results	[out] Results: One character per cache key. ('0' == downloaded, '1' == failed, '2' == cancelled)
+ * @return 0 on success; -ENOTSUP if concurrent downloads aren't available; other negative POSIX error code on error.
+ */
+int CacheManager::execRpDownloadFirst(const std::vector<std::string> &cache_keys, std::string &results)
+{
+	// Not implemented.
+	RP_UNUSED(cache_keys);
+	RP_UNUSED(results);
+	return -ENOTSUP;
+}
+
 }
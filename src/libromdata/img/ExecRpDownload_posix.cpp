@@ -10,8 +10,20 @@
 #include "config.libromdata.h"
 #include "CacheManager.hpp"
 
+// librpbase
+#include "librpbase/config/Config.hpp"
+using LibRpBase::Config;
+
+// librpthreads
+#include "librpthreads/Mutex.hpp"
+using LibRpBase::Mutex;
+using LibRpBase::MutexLocker;
+
 // OS-specific includes.
+#include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -19,36 +31,81 @@
 # include <spawn.h>
 #endif /* HAVE_POSIX_SPAWN */
 
+#ifndef MSG_NOSIGNAL
+// MSG_NOSIGNAL isn't available on some systems, e.g. macOS.
+// SO_NOSIGPIPE is set on the socket instead.
+# define MSG_NOSIGNAL 0
+#endif /* MSG_NOSIGNAL */
+
 // C++ includes.
 #include <string>
+#include <vector>
 using std::string;
+using std::vector;
 
 namespace LibRomData {
 
+#ifdef RP_DOWNLOAD_TEST_HOOKS
+// Test suite: Use rp-download-test from the build directory.
+static const char rp_download_exe[] = RP_DOWNLOAD_TEST_EXE;
+#else /* !RP_DOWNLOAD_TEST_HOOKS */
+// TODO: Mac OS X path. (bundle?)
+static const char rp_download_exe[] = DIR_INSTALL_LIBEXEC "/rp-download";
+#endif /* RP_DOWNLOAD_TEST_HOOKS */
+
+// Maximum number of environment variables for rp-download,
+// including the terminating nullptr.
+#ifdef RP_DOWNLOAD_TEST_HOOKS
+# define RP_DOWNLOAD_ENV_MAX 6
+#else /* !RP_DOWNLOAD_TEST_HOOKS */
+# define RP_DOWNLOAD_ENV_MAX 5
+#endif /* RP_DOWNLOAD_TEST_HOOKS */
+
+// rp-download's own timeouts for a single download, in milliseconds.
+// These must match CURLOPT_CONNECTTIMEOUT and CURLOPT_TIMEOUT
+// in rp-download/CurlDownloader.cpp.
+static const int RP_DOWNLOAD_CURL_CONNECT_TIMEOUT_MS = 2*1000;
+static const int RP_DOWNLOAD_CURL_TIMEOUT_MS = 10*1000;
+
+// Timeout for a single download, in milliseconds.
+// This must be strictly larger than rp-download's own timeouts so
+// a download that times out in curl is reported as a failure by
+// rp-download instead of the process being killed here. An extra
+// second is added for starting rp-download and writing the file.
+// TODO: User-configurable timeout?
+static const int RP_DOWNLOAD_TIMEOUT_MS =
+	RP_DOWNLOAD_CURL_TIMEOUT_MS + RP_DOWNLOAD_CURL_CONNECT_TIMEOUT_MS + 1000;
+
+// Maximum number of cache keys per rp-download server request.
+static const unsigned int RP_DOWNLOAD_SERVER_MAX_KEYS = 16;
+
 /**
- * Execute rp-download. (POSIX version)
- * @param filteredCacheKey Filtered cache key.
- * @return 0 on success; negative POSIX error code on error.
+ * Get the current time from a monotonic clock.
+ * @return Time, in milliseconds.
  */
-int CacheManager::execRpDownload(const string &filteredCacheKey)
+static inline int64_t getTimeMs(void)
 {
-	// TODO: Mac OS X path. (bundle?)
- 	static const char rp_download_exe[] = DIR_INSTALL_LIBEXEC "/rp-download";
-
-	// Parameters.
-	const char *const argv[3] = {
-		rp_download_exe,
-		filteredCacheKey.c_str(),
-		nullptr
-	};
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (static_cast<int64_t>(ts.tv_sec) * 1000) + (ts.tv_nsec / 1000000);
+}
 
+/**
+ * Build a minimal environment for rp-download.
+ * This will include http_proxy and https_proxy if the proxy URL is set.
+ * @param proxyUrl	[in] Proxy URL. (If empty, the proxy variables are copied from our environment.)
+ * @param s_env		[out] Environment variable storage.
+ * @param envp		[out] Environment variable pointers. (null-terminated)
+ */
+static void build_rp_download_env(const string &proxyUrl, string &s_env, const char *envp[RP_DOWNLOAD_ENV_MAX])
+{
 	// Define a minimal environment for cURL.
-	// This will include http_proxy and https_proxy if the proxy URL is set.
 	// TODO: Separate proxies for http and https?
 	// TODO: Only build this once?
-	int pos[5] = {-1, -1, -1, -1, -1};
+	int pos[RP_DOWNLOAD_ENV_MAX];
+	std::fill(pos, pos + RP_DOWNLOAD_ENV_MAX, -1);
 	int count = 0;
-	std::string s_env;
+	s_env.clear();
 	s_env.reserve(1024);
 
 	// We want the HOME and USER variables.
@@ -68,7 +125,7 @@ int CacheManager::execRpDownload(const string &filteredCacheKey)
 		s_env += envtmp;
 		s_env += '\0';
 	}
-	if (m_proxyUrl.empty()) {
+	if (proxyUrl.empty()) {
 		// Proxy URL is empty. Get the URLs from the environment.
 		envtmp = getenv("http_proxy");
 		if (envtmp && envtmp[0] != '\0') {
@@ -87,19 +144,449 @@ int CacheManager::execRpDownload(const string &filteredCacheKey)
 	} else {
 		// Proxy URL is set. Use it.
 		pos[count++] = static_cast<int>(s_env.size());
-		s_env += "http_proxy=" + m_proxyUrl;
+		s_env += "http_proxy=" + proxyUrl;
+		s_env += '\0';
 		pos[count++] = static_cast<int>(s_env.size());
-		s_env += "https_proxy=" + m_proxyUrl;
+		s_env += "https_proxy=" + proxyUrl;
+		s_env += '\0';
 	}
 
+#ifdef RP_DOWNLOAD_TEST_HOOKS
+	// Test suite: Base URL override for a local HTTP server.
+	envtmp = getenv("RP_DOWNLOAD_BASE_URL");
+	if (envtmp && envtmp[0] != '\0') {
+		pos[count++] = static_cast<int>(s_env.size());
+		s_env += "RP_DOWNLOAD_BASE_URL=";
+		s_env += envtmp;
+		s_env += '\0';
+	}
+#endif /* RP_DOWNLOAD_TEST_HOOKS */
+
 	// Build envp.
-	const char *envp[5] = {nullptr, nullptr, nullptr, nullptr, nullptr};
 	unsigned int envp_idx = 0;
-	for (unsigned int i = 0; i < 5; i++) {
+	for (unsigned int i = 0; i < RP_DOWNLOAD_ENV_MAX; i++) {
+		envp[i] = nullptr;
+	}
+	for (unsigned int i = 0; i < RP_DOWNLOAD_ENV_MAX; i++) {
 		if (pos[i] >= 0) {
 			envp[envp_idx++] = &s_env[pos[i]];
 		}
 	}
+}
+
+/**
+ * Persistent rp-download process.
+ *
+ * rp-download is started in server mode, with a socket connected
+ * to its stdin and stdout. Each request is a list of cache keys,
+ * which are downloaded concurrently. rp-download keeps its network
+ * connections open between requests.
+ * The sandbox is the same as for a single download.
+ *
+ * If rp-download exits, e.g. due to its idle timeout,
+ * it will be restarted on the next request.
+ */
+class RpDownloadServer
+{
+	public:
+		RpDownloadServer()
+			: pid(-1)
+			, fd(-1)
+			, maxHostConnections(0)
+			, busy(false)
+		{ }
+
+		~RpDownloadServer()
+		{
+			// Closing the socket will cause rp-download to exit.
+			stop(false);
+		}
+
+	private:
+		RP_DISABLE_COPY(RpDownloadServer)
+
+	public:
+		/**
+		 * Start rp-download in server mode.
+		 * @param proxyUrl Proxy URL.
+		 * @param maxHostConnections Maximum number of connections per host.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int start(const string &proxyUrl, unsigned int maxHostConnections);
+
+		/**
+		 * Stop rp-download.
+		 * @param force If true, terminate it instead of waiting for it to exit.
+		 */
+		void stop(bool force);
+
+		/**
+		 * Download files using rp-download.
+		 * @param cache_keys	[in] Cache keys, in priority order.
+		 * @param results	[out] Results: One character per cache key.
+		 * @return 0 on success; -ECHILD on timeout; -EPIPE if rp-download exited.
+		 */
+		int request(const vector<string> &cache_keys, string &results);
+
+	public:
+		pid_t pid;		// rp-download process ID
+		int fd;			// Socket connected to rp-download
+		string proxyUrl;	// Proxy URL used to start rp-download
+		unsigned int maxHostConnections;	// Maximum number of connections per host
+		bool busy;		// Set while a request is in progress
+};
+
+/**
+ * Start rp-download in server mode.
+ * @param proxyUrl Proxy URL.
+ * @param maxHostConnections Maximum number of connections per host.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RpDownloadServer::start(const string &proxyUrl, unsigned int maxHostConnections)
+{
+	assert(pid < 0);
+	assert(fd < 0);
+
+	// Parameters.
+	char s_maxHostConnections[16];
+	snprintf(s_maxHostConnections, sizeof(s_maxHostConnections), "%u", maxHostConnections);
+	const char *const argv[4] = {
+		rp_download_exe,
+		"--server",
+		s_maxHostConnections,
+		nullptr
+	};
+
+	// Environment.
+	string s_env;
+	const char *envp[RP_DOWNLOAD_ENV_MAX];
+	build_rp_download_env(proxyUrl, s_env, envp);
+
+	// Create a socket pair.
+	// - sv[0]: Our end. (close-on-exec)
+	// - sv[1]: rp-download's stdin and stdout.
+	int sv[2];
+#ifdef SOCK_CLOEXEC
+	int ret = socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv);
+#else /* !SOCK_CLOEXEC */
+	int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+	if (ret == 0) {
+		fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+		fcntl(sv[1], F_SETFD, FD_CLOEXEC);
+	}
+#endif /* SOCK_CLOEXEC */
+	if (ret != 0) {
+		int err = errno;
+		if (err == 0) {
+			err = EIO;
+		}
+		return -err;
+	}
+#ifdef SO_NOSIGPIPE
+	// Don't raise SIGPIPE if rp-download exits.
+	int optval = 1;
+	setsockopt(sv[0], SOL_SOCKET, SO_NOSIGPIPE, &optval, sizeof(optval));
+#endif /* SO_NOSIGPIPE */
+
+	// NOTE: dup2() clears FD_CLOEXEC on the new descriptors.
+#ifdef HAVE_POSIX_SPAWN
+	// posix_spawn()
+	posix_spawn_file_actions_t file_actions;
+	posix_spawn_file_actions_init(&file_actions);
+	posix_spawn_file_actions_adddup2(&file_actions, sv[1], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&file_actions, sv[1], STDOUT_FILENO);
+
+	errno = 0;
+	ret = posix_spawn(&pid, rp_download_exe,
+		&file_actions,	// file_actions
+		nullptr,	// attrp
+		(char *const *)argv, (char *const *)envp);
+	posix_spawn_file_actions_destroy(&file_actions);
+	if (ret != 0) {
+		// Error creating the child process.
+		// NOTE: posix_spawn() returns the error code.
+		pid = -1;
+		close(sv[0]);
+		close(sv[1]);
+		return -ret;
+	}
+#else /* !HAVE_POSIX_SPAWN */
+	// fork()/execve().
+	errno = 0;
+	pid = fork();
+	if (pid == 0) {
+		// Child process.
+		if (dup2(sv[1], STDIN_FILENO) < 0 || dup2(sv[1], STDOUT_FILENO) < 0) {
+			_exit(EXIT_FAILURE);
+		}
+		execve(rp_download_exe, (char *const *)argv, (char *const *)envp);
+		// execve() failed.
+		_exit(EXIT_FAILURE);
+	} else if (pid == -1) {
+		// fork() failed.
+		int err = errno;
+		if (err == 0) {
+			err = EIO;
+		}
+		close(sv[0]);
+		close(sv[1]);
+		return -err;
+	}
+#endif /* HAVE_POSIX_SPAWN */
+
+	// Parent process.
+	close(sv[1]);
+	fd = sv[0];
+	this->proxyUrl = proxyUrl;
+	this->maxHostConnections = maxHostConnections;
+	return 0;
+}
+
+/**
+ * Stop rp-download.
+ * @param force If true, terminate it instead of waiting for it to exit.
+ */
+void RpDownloadServer::stop(bool force)
+{
+	if (fd >= 0) {
+		// rp-download exits when stdin is closed.
+		close(fd);
+		fd = -1;
+	}
+	if (pid > 0) {
+		if (force) {
+			kill(pid, SIGTERM);
+		}
+		// Reap the process.
+		int wstatus;
+		while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR) { }
+		pid = -1;
+	}
+}
+
+/**
+ * Download files using rp-download.
+ * @param cache_keys	[in] Cache keys, in priority order.
+ * @param results	[out] Results: One character per cache key.
+ * @return 0 on success; -ECHILD on timeout; -EPIPE if rp-download exited.
+ */
+int RpDownloadServer::request(const vector<string> &cache_keys, string &results)
+{
+	assert(fd >= 0);
+	assert(!cache_keys.empty());
+
+	// Send the request: Cache keys, separated by tabs.
+	string req;
+	for (auto iter = cache_keys.cbegin(); iter != cache_keys.cend(); ++iter) {
+		if (!req.empty()) {
+			req += '\t';
+		}
+		req += *iter;
+	}
+	req += '\n';
+	const char *p = req.data();
+	size_t len = req.size();
+	while (len > 0) {
+		ssize_t sz = send(fd, p, len, MSG_NOSIGNAL);
+		if (sz < 0) {
+			if (errno == EINTR)
+				continue;
+			// rp-download probably exited.
+			return -EPIPE;
+		}
+		p += sz;
+		len -= sz;
+	}
+
+	// Wait for the response: One character per cache key, then '\n'.
+	// Downloads over the per-host connection limit are queued,
+	// so allow for that when determining the timeout.
+	const unsigned int mhc = (maxHostConnections > 0 ? maxHostConnections : 1);
+	const int64_t deadline = getTimeMs() + (static_cast<int64_t>(RP_DOWNLOAD_TIMEOUT_MS) *
+		static_cast<int64_t>((cache_keys.size() + mhc - 1) / mhc));
+	results.clear();
+	for (;;) {
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		// The timeout covers the whole response, so subtract
+		// the time spent on partial reads and interruptions.
+		const int64_t timeout = deadline - getTimeMs();
+		int ret = (timeout > 0 ? poll(&pfd, 1, static_cast<int>(timeout)) : 0);
+		if (ret == 0) {
+			// Timeout.
+			return -ECHILD;
+		} else if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -EPIPE;
+		}
+
+		char buf[RP_DOWNLOAD_SERVER_MAX_KEYS + 1];
+		ssize_t sz = recv(fd, buf, sizeof(buf), 0);
+		if (sz == 0) {
+			// rp-download exited.
+			return -EPIPE;
+		} else if (sz < 0) {
+			if (errno == EINTR)
+				continue;
+			return -EPIPE;
+		}
+		results.append(buf, sz);
+		if (results[results.size()-1] == '\n') {
+			// End of the response.
+			results.resize(results.size()-1);
+			break;
+		} else if (results.size() > cache_keys.size()) {
+			// Response is too long.
+			return -EPIPE;
+		}
+	}
+
+	if (results.size() != cache_keys.size() ||
+	    results.find_first_not_of("012") != string::npos)
+	{
+		// Invalid response.
+		return -EPIPE;
+	}
+	return 0;
+}
+
+// rp-download servers.
+// One server per simultaneous download. (See CacheManager::m_dlsem.)
+static RpDownloadServer rpDownloadServers[2];
+static Mutex rpDownloadServersMutex;
+
+/**
+ * Download files using a persistent rp-download process.
+ * @param cacheKeys		[in] Cache keys, in priority order.
+ * @param proxyUrl		[in] Proxy URL.
+ * @param maxHostConnections	[in] Maximum number of connections per host.
+ * @param results		[out] Results: One character per cache key.
+ * @return 0 on success; -ENOTCONN if a persistent rp-download process isn't available; other negative POSIX error code on error.
+ */
+static int rpDownloadServerRequest(const vector<string> &cacheKeys,
+	const string &proxyUrl, unsigned int maxHostConnections, string &results)
+{
+	if (cacheKeys.empty() || cacheKeys.size() > RP_DOWNLOAD_SERVER_MAX_KEYS) {
+		// Too many cache keys for a single request.
+		return -ENOTCONN;
+	}
+	for (auto iter = cacheKeys.cbegin(); iter != cacheKeys.cend(); ++iter) {
+		if (iter->empty() || iter->find_first_of("\t\r\n") != string::npos) {
+			// Tabs and newlines aren't allowed in cache keys.
+			return -EINVAL;
+		}
+	}
+
+	// Get an idle server.
+	RpDownloadServer *server = nullptr;
+	{
+		MutexLocker locker(rpDownloadServersMutex);
+		for (RpDownloadServer &s : rpDownloadServers) {
+			if (!s.busy) {
+				server = &s;
+				server->busy = true;
+				break;
+			}
+		}
+	}
+	if (!server) {
+		// No idle servers.
+		return -ENOTCONN;
+	}
+
+	int ret = -ENOTCONN;
+	for (unsigned int attempt = 0; attempt < 2; attempt++) {
+		if (server->pid > 0 && (server->proxyUrl != proxyUrl ||
+		                        server->maxHostConnections != maxHostConnections))
+		{
+			// Settings have changed. Restart rp-download.
+			server->stop(false);
+		}
+		if (server->pid < 0) {
+			if (server->start(proxyUrl, maxHostConnections) != 0) {
+				// Unable to start rp-download in server mode.
+				ret = -ENOTCONN;
+				break;
+			}
+		}
+
+		ret = server->request(cacheKeys, results);
+		if (ret == -EPIPE) {
+			// rp-download exited, probably due to its
+			// idle timeout. Restart it and try again.
+			server->stop(false);
+			ret = -ENOTCONN;
+			continue;
+		} else if (ret == -ECHILD) {
+			// Timeout. rp-download may still send the rest of the
+			// response later, which would be mistaken for the response
+			// to the next request, so terminate it. It will be
+			// restarted on the next request.
+			server->stop(true);
+		}
+		break;
+	}
+
+	MutexLocker locker(rpDownloadServersMutex);
+	server->busy = false;
+	return ret;
+}
+
+/**
+ * Execute rp-download to download the first available file
+ * from a list of cache keys, using concurrent downloads.
+ * @param cache_keys	[in] Cache keys, in priority order.
+ * @param results	[out] Results: One character per cache key. ('0' == downloaded, '1' == failed, '2' == cancelled)
+ * @return 0 on success; -ENOTSUP if concurrent downloads aren't available; other negative POSIX error code on error.
+ */
+int CacheManager::execRpDownloadFirst(const vector<string> &cache_keys, string &results)
+{
+	// Concurrent downloads require a persistent rp-download process.
+	const Config *const config = Config::instance();
+	if (!config->persistentDownloader()) {
+		return -ENOTSUP;
+	}
+
+	int ret = rpDownloadServerRequest(cache_keys, m_proxyUrl, config->maxConnectionsPerHost(), results);
+	return (ret != -ENOTCONN ? ret : -ENOTSUP);
+}
+
+/**
+ * Execute rp-download. (POSIX version)
+ * @param filteredCacheKey Filtered cache key.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheManager::execRpDownload(const string &filteredCacheKey)
+{
+	// Use a persistent rp-download process if enabled.
+	// If it isn't available, run rp-download for this file only.
+	const Config *const config = Config::instance();
+	if (config->persistentDownloader()) {
+		const vector<string> cacheKeys(1, filteredCacheKey);
+		string results;
+		int ret = rpDownloadServerRequest(cacheKeys, m_proxyUrl, config->maxConnectionsPerHost(), results);
+		if (ret == 0) {
+			return (results[0] == '0' ? 0 : -EIO);
+		} else if (ret != -ENOTCONN) {
+			return ret;
+		}
+	}
+
+	// Parameters.
+	const char *const argv[3] = {
+		rp_download_exe,
+		filteredCacheKey.c_str(),
+		nullptr
+	};
+
+	// Environment.
+	string s_env;
+	const char *envp[RP_DOWNLOAD_ENV_MAX];
+	build_rp_download_env(m_proxyUrl, s_env, envp);
 
 	// TODO: Maybe we should close file handles...
 #ifdef HAVE_POSIX_SPAWN
@@ -142,13 +629,12 @@ int CacheManager::execRpDownload(const string &filteredCacheKey)
 #endif /* HAVE_POSIX_SPAWN */
 
 	// Parent process.
-	// Wait up to 10 seconds for the process to exit.
-	// TODO: User-configurable timeout?
+	// Wait up to RP_DOWNLOAD_TIMEOUT_MS for the process to exit.
 	// TODO: Report errors somewhere.
 	bool ok = false;	// rp-download terminated successfully.
 	bool waited = false;	// waitpid() was successful.
 	int wstatus = 0;
-	for (unsigned int i = 10*4; i > 0; i--) {
+	for (unsigned int i = RP_DOWNLOAD_TIMEOUT_MS / 250; i > 0; i--) {
 		pid_t wpid = waitpid(pid, &wstatus, WNOHANG);
 		if (wpid == pid) {
 			// Process has changed state.
@@ -179,6 +665,8 @@ int CacheManager::execRpDownload(const string &filteredCacheKey)
 		// TODO: Prevent race conditions by using waitid() instead of waitpid()?
 		// TODO: Better error code?
 		kill(pid, SIGTERM);
+		// Reap the process so it doesn't become a zombie.
+		while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR) { }
 		return -ECHILD;
 	}
 
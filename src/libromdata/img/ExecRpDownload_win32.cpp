@@ -106,8 +106,11 @@ int CacheManager::execRpDownload(const string &filteredCacheKey)
 		return -ECHILD;
 	}
 
-	// Wait up to 10 seconds for the process to exit.
-	DWORD dwRet = WaitForSingleObject(pi.hProcess, 10*1000);
+	// Wait up to 13 seconds for the process to exit.
+	// This must be strictly larger than rp-download's own
+	// timeouts (10 seconds total, 2 seconds to connect) so
+	// a timeout in rp-download is reported as a failure.
+	DWORD dwRet = WaitForSingleObject(pi.hProcess, 13*1000);
 	DWORD status = 0;
 	bRet = GetExitCodeProcess(pi.hProcess, &status);
 	if (dwRet != WAIT_OBJECT_0 || !bRet || status == STILL_ACTIVE) {
@@ -132,4 +135,19 @@ int CacheManager::execRpDownload(const string &filteredCacheKey)
 	return 0;
 }
 
+/**
+ * Execute rp-download to download the first available file
+ * from a list of cache keys, using concurrent downloads. (Windows version)
+ * @param cache_keys	[in] Cache keys, in priority order.
+ * @param results	[out] Results: One character per cache key. ('0' == downloaded, '1' == failed, '2' == cancelled)
+ * @return 0 on success; -ENOTSUP if concurrent downloads aren't available; other negative POSIX error code on error.
+ */
+int CacheManager::execRpDownloadFirst(const std::vector<std::string> &cache_keys, std::string &results)
+{
+	// TODO: Concurrent downloads using WinInet.
+	RP_UNUSED(cache_keys);
+	RP_UNUSED(results);
+	return -ENOTSUP;
+}
+
 }
@@ -49,9 +49,18 @@ TCreateThumbnail<ImgClass>::~TCreateThumbnail()
 
 /**
  * Get an internal image.
+ *
+ * If req_size is specified, a reduced-size version of the
+ * image may be decoded, e.g. a texture mipmap, and images
+ * larger than req_size will be scaled down. pOutSize is
+ * the size of the returned image; pFullSize is the size
+ * of the full image.
+ *
  * @param romData	[in] RomData object.
  * @param imageType	[in] Image type.
+ * @param req_size	[in] Requested image size. (0 for the full image)
  * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's size.
+ * @param pFullSize	[out,opt] Pointer to ImgSize to store the full image's size.
  * @param sBIT		[out,opt] sBIT metadata.
  * @return Internal image, or null ImgClass on error.
  */
@@ -59,7 +68,9 @@ template<typename ImgClass>
 ImgClass TCreateThumbnail<ImgClass>::getInternalImage(
 	const RomData *romData,
 	RomData::ImageType imageType,
+	int req_size,
 	ImgSize *pOutSize,
+	ImgSize *pFullSize,
 	rp_image::sBIT_t *sBIT)
 {
 	assert(imageType >= RomData::IMG_INT_MIN && imageType <= RomData::IMG_INT_MAX);
@@ -71,7 +82,11 @@ ImgClass TCreateThumbnail<ImgClass>::getInternalImage(
 		return getNullImgClass();
 	}
 
-	const rp_image *image = romData->image(imageType);
+	// NOTE: Only the smallest sufficient mipmap is decoded
+	// for textures, so the image may be smaller than the
+	// full image.
+	int fullSize[2] = {0, 0};
+	const rp_image *image = romData->imageForSize(imageType, req_size, fullSize);
 	if (!image) {
 		// No image.
 		if (sBIT) {
@@ -81,7 +96,7 @@ ImgClass TCreateThumbnail<ImgClass>::getInternalImage(
 	}
 
 	// Convert the rp_image to ImgClass.
-	ImgClass ret_img = rpImageToImgClass(image);
+	ImgClass ret_img = rpImageToImgClass_scaled(image, req_size);
 	if (isImgClassValid(ret_img)) {
 		// Image converted successfully.
 		if (pOutSize) {
@@ -92,6 +107,14 @@ ImgClass TCreateThumbnail<ImgClass>::getInternalImage(
 			// TODO: Check for errors?
 			getImgClassSize(ret_img, pOutSize);
 		}
+		if (pFullSize) {
+			if (fullSize[0] <= 0 || fullSize[1] <= 0) {
+				fullSize[0] = image->width();
+				fullSize[1] = image->height();
+			}
+			pFullSize->width = fullSize[0];
+			pFullSize->height = fullSize[1];
+		}
 		if (sBIT) {
 			// Get the sBIT metadata.
 			if (image->get_sBIT(sBIT) != 0) {
@@ -106,17 +129,23 @@ ImgClass TCreateThumbnail<ImgClass>::getInternalImage(
 
 /**
  * Get an external image.
+ *
+ * If the image is larger than req_size, it will be
+ * scaled down. pOutSize is the size of the returned
+ * image; pFullSize is the size of the full image.
+ *
  * @param romData	[in] RomData object.
  * @param imageType	[in] Image type.
  * @param req_size	[in] Requested image size.
  * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's size.
+ * @param pFullSize	[out,opt] Pointer to ImgSize to store the full image's size.
  * @param sBIT		[out,opt] sBIT metadata.
  * @return External image, or null ImgClass on error.
  */
 template<typename ImgClass>
 ImgClass TCreateThumbnail<ImgClass>::getExternalImage(
 	const RomData *romData, RomData::ImageType imageType,
-	int req_size, ImgSize *pOutSize,
+	int req_size, ImgSize *pOutSize, ImgSize *pFullSize,
 	rp_image::sBIT_t *sBIT)
 {
 	assert(imageType >= RomData::IMG_EXT_MIN && imageType <= RomData::IMG_EXT_MAX);
@@ -145,11 +174,17 @@ ImgClass TCreateThumbnail<ImgClass>::getExternalImage(
 	const bool extImgDownloadEnabled = config->extImgDownloadEnabled();
 	const bool downloadHighResScans = config->downloadHighResScans();
 
+	// Download the first available image.
+	// NOTE: All URLs for an image type are from the same database,
+	// so the first URL's proxy is used for all of them.
 	CacheManager cache;
+	std::string proxy = proxyForUrl(extURLs[0].url);
+	cache.setProxyUrl(!proxy.empty() ? proxy.c_str() : nullptr);
+
+	std::vector<CacheManager::DownloadEntry> entries;
+	entries.reserve(extURLs.size());
 	for (auto iter = extURLs.cbegin(); iter != extURLs.cend(); ++iter) {
 		const RomData::ExtURL &extURL = *iter;
-		std::string proxy = proxyForUrl(extURL.url);
-		cache.setProxyUrl(!proxy.empty() ? proxy.c_str() : nullptr);
 
 		// Should we attempt to download the image,
 		// or just use the local cache?
@@ -161,19 +196,21 @@ ImgClass TCreateThumbnail<ImgClass>::getExternalImage(
 			download = false;
 		}
 
-		// TODO: Have download() return the actual data and/or load the cached file.
-		std::string cache_filename;
-		if (download) {
-			// Attempt to download the image if it isn't already
-			// present in the rom-properties cache.
-			cache_filename = cache.download(extURL.cache_key);
-		} else {
-			// Don't attempt to download the image.
-			// Only check the rom-properties cache.
-			cache_filename = cache.findInCache(extURL.cache_key);
-		}
+		CacheManager::DownloadEntry entry;
+		entry.cache_key = extURL.cache_key;
+		entry.cacheOnly = !download;
+		entries.push_back(std::move(entry));
+	}
+
+	while (!entries.empty()) {
+		// TODO: Have downloadFirst() return the actual data and/or load the cached file.
+		unsigned int index = 0;
+		const std::string cache_filename = cache.downloadFirst(entries, &index);
 		if (cache_filename.empty())
-			continue;
+			break;
+
+		// If the image can't be loaded, try the next entries.
+		entries.erase(entries.begin(), entries.begin() + index + 1);
 
 		// Attempt to load the image.
 		unique_IRpFile<RpFile> file(new RpFile(cache_filename, RpFile::FM_OPEN_READ));
@@ -182,13 +219,17 @@ ImgClass TCreateThumbnail<ImgClass>::getExternalImage(
 			if (dl_img && dl_img->isValid()) {
 				// Image loaded successfully.
 				file->close();
-				ImgClass ret_img = rpImageToImgClass(dl_img.get());
+				ImgClass ret_img = rpImageToImgClass_scaled(dl_img.get(), req_size);
 				if (isImgClassValid(ret_img)) {
 					// Image converted successfully.
 					if (pOutSize) {
 						// Get the image size.
-						pOutSize->width = dl_img->width();
-						pOutSize->height = dl_img->height();
+						getImgClassSize(ret_img, pOutSize);
+					}
+					if (pFullSize) {
+						// Get the full image size.
+						pFullSize->width = dl_img->width();
+						pFullSize->height = dl_img->height();
 					}
 					// Get the sBIT metadata.
 					if (sBIT) {
@@ -240,6 +281,41 @@ inline void TCreateThumbnail<ImgClass>::rescale_aspect(ImgSize &rs_size, const I
 	}
 }
 
+/**
+ * Convert an rp_image to ImgClass.
+ * If the image is larger than req_size, it will be
+ * scaled down using rp_image::scaled() first.
+ * @param img		[in] rp_image
+ * @param req_size	[in] Requested image size. (0 to never scale)
+ * @return ImgClass
+ */
+template<typename ImgClass>
+ImgClass TCreateThumbnail<ImgClass>::rpImageToImgClass_scaled(const rp_image *img, int req_size) const
+{
+	if (req_size <= 0 || (img->width() <= req_size && img->height() <= req_size)) {
+		// No scaling is needed.
+		return rpImageToImgClass(img);
+	}
+
+	// Scale the image down, maintaining the aspect ratio.
+	// This is done here instead of in the UI frontends so
+	// thumbnails are consistent across all frontends.
+	ImgSize sz = {img->width(), img->height()};
+	const ImgSize tgt_sz = {req_size, req_size};
+	rescale_aspect(sz, tgt_sz);
+	if (sz.width <= 0)
+		sz.width = 1;
+	if (sz.height <= 0)
+		sz.height = 1;
+
+	unique_ptr<rp_image> scaled_img(img->scaled(sz.width, sz.height, rp_image::FilterBox));
+	if (!scaled_img) {
+		// Unable to scale the image.
+		return rpImageToImgClass(img);
+	}
+	return rpImageToImgClass(scaled_img.get());
+}
+
 /**
  * Create a thumbnail for the specified ROM file.
  * @param romData	[in] RomData object.
@@ -269,6 +345,11 @@ int TCreateThumbnail<ImgClass>::getThumbnail(const RomData *romData, int reqSize
 	uint32_t imgbf = romData->supportedImageTypes();
 	uint32_t imgpf = 0;
 
+	// Full image size.
+	// This may be larger than the retrieved image
+	// if the image was scaled down.
+	ImgSize origFullSize = {0, 0};
+
 	// Get the image priority.
 	const Config *const config = Config::instance();
 	Config::ImgTypePrio_t imgTypePrio;
@@ -294,7 +375,8 @@ int TCreateThumbnail<ImgClass>::getThumbnail(const RomData *romData, int reqSize
 		// Check for an icon first.
 		// TODO: Define "small sizes" somewhere. (DPI independence?)
 		if (imgbf & RomData::IMGBF_INT_ICON) {
-			pOutParams->retImg = getInternalImage(romData, RomData::IMG_INT_ICON, &pOutParams->fullSize, &pOutParams->sBIT);
+			pOutParams->retImg = getInternalImage(romData, RomData::IMG_INT_ICON, reqSize,
+				&pOutParams->fullSize, &origFullSize, &pOutParams->sBIT);
 			imgpf = romData->imgpf(RomData::IMG_INT_ICON);
 			imgbf &= ~RomData::IMGBF_INT_ICON;
 
@@ -326,11 +408,13 @@ int TCreateThumbnail<ImgClass>::getThumbnail(const RomData *romData, int reqSize
 		// This image may be present.
 		if (imgType <= RomData::IMG_INT_MAX) {
 			// Internal image.
-			pOutParams->retImg = getInternalImage(romData, imgType, &pOutParams->fullSize, &pOutParams->sBIT);
+			pOutParams->retImg = getInternalImage(romData, imgType, reqSize,
+				&pOutParams->fullSize, &origFullSize, &pOutParams->sBIT);
 			imgpf = romData->imgpf(imgType);
 		} else {
 			// External image.
-			pOutParams->retImg = getExternalImage(romData, imgType, reqSize, &pOutParams->fullSize, &pOutParams->sBIT);
+			pOutParams->retImg = getExternalImage(romData, imgType, reqSize,
+				&pOutParams->fullSize, &origFullSize, &pOutParams->sBIT);
 			imgpf = romData->imgpf(imgType);
 		}
 
@@ -358,7 +442,7 @@ skip_image_check:
 		return RPCT_SOURCE_FILE_ERROR;
 	}
 
-	// TODO: If image is larger than req_size, resize down.
+	// NOTE: Images larger than reqSize have already been scaled down.
 	if (imgpf & RomData::IMGPF_RESCALE_NEAREST) {
 		// TODO: User configuration.
 		ResizeNearestUpPolicy resize_up = RESIZE_UP_HALF;
@@ -420,6 +504,14 @@ skip_image_check:
 		pOutParams->thumbSize = pOutParams->fullSize;
 	}
 
+	if (origFullSize.width > pOutParams->fullSize.width ||
+	    origFullSize.height > pOutParams->fullSize.height)
+	{
+		// The image was scaled down.
+		// Report the full image size.
+		pOutParams->fullSize = origFullSize;
+	}
+
 	// Image retrieved successfully.
 	return RPCT_SUCCESS;
 }
@@ -477,7 +569,8 @@ int TCreateThumbnail<ImgClass>::getThumbnail(const char *filename, int reqSize,
 	// Attempt to open the ROM file.
 	// TODO: OS-specific wrappers, e.g. RpQFile or RpGVfsFile.
 	// For now, using RpFile, which is an stdio wrapper.
-	RpFile *const file = new RpFile(filename, RpFile::FM_OPEN_READ_GZ);
+	RpFile *const file = new RpFile(filename,
+		static_cast<RpFile::FileMode>(RpFile::FM_OPEN_READ_GZ | RpFile::FM_GZIP_INDEX));
 	if (!file->isOpen()) {
 		// Could not open the file.
 		file->unref();
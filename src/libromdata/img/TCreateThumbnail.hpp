@@ -104,29 +104,47 @@ class TCreateThumbnail
 
 		/**
 		 * Get an internal image.
+		 *
+		 * If req_size is specified, a reduced-size version of the
+		 * image may be decoded, e.g. a texture mipmap, and images
+		 * larger than req_size will be scaled down. pOutSize is
+		 * the size of the returned image; pFullSize is the size
+		 * of the full image.
+		 *
 		 * @param romData	[in] RomData object.
 		 * @param imageType	[in] Image type.
+		 * @param req_size	[in] Requested image size. (0 for the full image)
 		 * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's size.
+		 * @param pFullSize	[out,opt] Pointer to ImgSize to store the full image's size.
 		 * @param sBIT		[out,opt] sBIT metadata.
 		 * @return Internal image, or null ImgClass on error.
 		 */
 		ImgClass getInternalImage(const LibRpBase::RomData *romData,
 			LibRpBase::RomData::ImageType imageType,
+			int req_size = 0,
 			ImgSize *pOutSize = nullptr,
+			ImgSize *pFullSize = nullptr,
 			LibRpTexture::rp_image::sBIT_t *sBIT = nullptr);
 
 		/**
 		 * Get an external image.
+		 *
+		 * If the image is larger than req_size, it will be
+		 * scaled down. pOutSize is the size of the returned
+		 * image; pFullSize is the size of the full image.
+		 *
 		 * @param romData	[in] RomData object.
 		 * @param imageType	[in] Image type.
 		 * @param req_size	[in] Requested image size.
 		 * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's size.
+		 * @param pFullSize	[out,opt] Pointer to ImgSize to store the full image's size.
 		 * @param sBIT		[out,opt] sBIT metadata.
 		 * @return External image, or null ImgClass on error.
 		 */
 		ImgClass getExternalImage(
 			const LibRpBase::RomData *romData, LibRpBase::RomData::ImageType imageType,
 			int req_size, ImgSize *pOutSize = nullptr,
+			ImgSize *pFullSize = nullptr,
 			LibRpTexture::rp_image::sBIT_t *sBIT = nullptr);
 
 		/**
@@ -175,6 +193,16 @@ class TCreateThumbnail
 		 */
 		static inline void rescale_aspect(ImgSize &rs_size, const ImgSize &tgt_size);
 
+		/**
+		 * Convert an rp_image to ImgClass.
+		 * If the image is larger than req_size, it will be
+		 * scaled down using rp_image::scaled() first.
+		 * @param img		[in] rp_image
+		 * @param req_size	[in] Requested image size. (0 to never scale)
+		 * @return ImgClass
+		 */
+		ImgClass rpImageToImgClass_scaled(const LibRpTexture::rp_image *img, int req_size) const;
+
 	protected:
 		/** Pure virtual functions. **/
 
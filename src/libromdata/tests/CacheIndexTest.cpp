@@ -0,0 +1,413 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * CacheIndexTest.cpp: CacheIndex class test.                              *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpfile
+#include "common.h"
+#include "librpfile/FileSystem.hpp"
+#include "librpfile/RpFile.hpp"
+using namespace LibRpFile;
+
+// CacheIndex
+#include "img/CacheIndex.hpp"
+
+// OS-specific includes.
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/file.h>
+# include <unistd.h>
+#endif /* !_WIN32 */
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+// C++ includes.
+#include <algorithm>
+#include <string>
+#include <vector>
+using std::string;
+
+namespace LibRomData { namespace Tests {
+
+class CacheIndexTest : public ::testing::Test
+{
+	protected:
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+	public:
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 1000;
+
+		// Number of cache keys for the benchmark.
+		static const unsigned int BENCHMARK_KEYS = 1000;
+
+	public:
+		// Index filename.
+		string m_filename;
+
+		// Lock filename.
+		string m_lockFilename;
+
+		/**
+		 * Create a cache index entry.
+		 * @param status	[in] Status.
+		 * @param size		[in] File size.
+		 * @param cached_time	[in] Time the file was cached.
+		 * @return Cache index entry.
+		 */
+		static CacheIndex::Entry makeEntry(CacheIndex::Status status, uint32_t size, time_t cached_time);
+
+		/**
+		 * Get a cache key for the specified number.
+		 * @param i Number.
+		 * @return Cache key.
+		 */
+		static string makeKey(unsigned int i);
+};
+
+/**
+ * SetUp() function.
+ * Run before each test.
+ */
+void CacheIndexTest::SetUp(void)
+{
+	m_filename = "CacheIndexTest_data";
+	m_filename += DIR_SEP_CHR;
+	m_filename += "index.bin";
+	ASSERT_EQ(0, FileSystem::rmkdir(m_filename));
+	FileSystem::delete_file(m_filename);
+
+	m_lockFilename = "CacheIndexTest_data";
+	m_lockFilename += DIR_SEP_CHR;
+	m_lockFilename += "index.lock";
+	FileSystem::delete_file(m_lockFilename);
+}
+
+/**
+ * TearDown() function.
+ * Run after each test.
+ */
+void CacheIndexTest::TearDown(void)
+{
+	if (!m_filename.empty()) {
+		FileSystem::delete_file(m_filename);
+	}
+	if (!m_lockFilename.empty()) {
+		FileSystem::delete_file(m_lockFilename);
+	}
+}
+
+/**
+ * Create a cache index entry.
+ * @param status	[in] Status.
+ * @param size		[in] File size.
+ * @param cached_time	[in] Time the file was cached.
+ * @return Cache index entry.
+ */
+CacheIndex::Entry CacheIndexTest::makeEntry(CacheIndex::Status status, uint32_t size, time_t cached_time)
+{
+	CacheIndex::Entry entry;
+	entry.status = status;
+	entry.size = size;
+	entry.cached_time = cached_time;
+	entry.last_modified = (status == CacheIndex::CIS_CACHED ? cached_time - 3600 : 0);
+	entry.expires = (status == CacheIndex::CIS_NEGATIVE ? cached_time + CacheIndex::NEGATIVE_TTL : 0);
+	entry.last_access = (status == CacheIndex::CIS_CACHED ? cached_time : 0);
+	return entry;
+}
+
+/**
+ * Get a cache key for the specified number.
+ * @param i Number.
+ * @return Cache key.
+ */
+string CacheIndexTest::makeKey(unsigned int i)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "wii%ccover%cUS%cT%05u.png",
+		DIR_SEP_CHR, DIR_SEP_CHR, DIR_SEP_CHR, i);
+	return string(buf);
+}
+
+/**
+ * An index that doesn't exist is empty.
+ */
+TEST_F(CacheIndexTest, emptyIndex)
+{
+	CacheIndex index(m_filename);
+	EXPECT_EQ(-ENOENT, index.reload());
+
+	CacheIndex::Entry entry;
+	EXPECT_FALSE(index.lookup(makeKey(0), &entry));
+	EXPECT_FALSE(index.isDirty());
+}
+
+/**
+ * Entries are visible before and after commit(),
+ * and can be loaded by another CacheIndex.
+ */
+TEST_F(CacheIndexTest, setAndCommit)
+{
+	const time_t now = time(nullptr);
+	CacheIndex index(m_filename);
+	EXPECT_EQ(0, index.set(makeKey(0), makeEntry(CacheIndex::CIS_CACHED, 12345, now)));
+	EXPECT_EQ(0, index.set(makeKey(1), makeEntry(CacheIndex::CIS_NEGATIVE, 0, now)));
+	EXPECT_TRUE(index.isDirty());
+
+	// Uncommitted entries.
+	CacheIndex::Entry entry;
+	ASSERT_TRUE(index.lookup(makeKey(0), &entry));
+	EXPECT_EQ(CacheIndex::CIS_CACHED, entry.status);
+	EXPECT_EQ(12345U, entry.size);
+
+	ASSERT_EQ(0, index.commit());
+	EXPECT_FALSE(index.isDirty());
+
+	// Committed entries.
+	CacheIndex index2(m_filename);
+	ASSERT_EQ(0, index2.reload());
+	ASSERT_TRUE(index2.lookup(makeKey(0), &entry));
+	EXPECT_EQ(CacheIndex::CIS_CACHED, entry.status);
+	EXPECT_EQ(12345U, entry.size);
+	EXPECT_EQ(now, entry.cached_time);
+	EXPECT_EQ(now - 3600, entry.last_modified);
+
+	ASSERT_TRUE(index2.lookup(makeKey(1), &entry));
+	EXPECT_EQ(CacheIndex::CIS_NEGATIVE, entry.status);
+	EXPECT_EQ(now + CacheIndex::NEGATIVE_TTL, entry.expires);
+
+	EXPECT_FALSE(index2.lookup(makeKey(2), &entry));
+}
+
+/**
+ * Removed entries aren't visible, and other entries are kept.
+ */
+TEST_F(CacheIndexTest, remove)
+{
+	const time_t now = time(nullptr);
+	CacheIndex index(m_filename);
+	EXPECT_EQ(0, index.set(makeKey(0), makeEntry(CacheIndex::CIS_CACHED, 100, now)));
+	EXPECT_EQ(0, index.set(makeKey(1), makeEntry(CacheIndex::CIS_CACHED, 200, now)));
+	ASSERT_EQ(0, index.commit());
+
+	index.remove(makeKey(0));
+	CacheIndex::Entry entry;
+	EXPECT_FALSE(index.lookup(makeKey(0), &entry));
+	ASSERT_EQ(0, index.commit());
+
+	CacheIndex index2(m_filename);
+	ASSERT_EQ(0, index2.reload());
+	EXPECT_FALSE(index2.lookup(makeKey(0), &entry));
+	ASSERT_TRUE(index2.lookup(makeKey(1), &entry));
+	EXPECT_EQ(200U, entry.size);
+}
+
+/**
+ * touch() only updates the access time if it's old enough.
+ */
+TEST_F(CacheIndexTest, touch)
+{
+	const time_t now = time(nullptr);
+	CacheIndex index(m_filename);
+	EXPECT_EQ(0, index.set(makeKey(0), makeEntry(CacheIndex::CIS_CACHED, 1, now - 86400)));
+	EXPECT_EQ(0, index.set(makeKey(1), makeEntry(CacheIndex::CIS_NEGATIVE, 0, now - 86400)));
+	ASSERT_EQ(0, index.commit());
+
+	EXPECT_TRUE(index.touch(makeKey(0), now));
+	EXPECT_FALSE(index.touch(makeKey(0), now + 1));
+	EXPECT_FALSE(index.touch(makeKey(1), now));
+	EXPECT_FALSE(index.touch(makeKey(2), now));
+	ASSERT_EQ(0, index.commit());
+
+	CacheIndex index2(m_filename);
+	ASSERT_EQ(0, index2.reload());
+	CacheIndex::Entry entry;
+	ASSERT_TRUE(index2.lookup(makeKey(0), &entry));
+	EXPECT_EQ(now, entry.last_access);
+	EXPECT_EQ(now - 86400, entry.cached_time);
+}
+
+/**
+ * keys() returns committed and uncommitted keys.
+ */
+TEST_F(CacheIndexTest, keys)
+{
+	const time_t now = time(nullptr);
+	CacheIndex index(m_filename);
+	EXPECT_EQ(0, index.set(makeKey(0), makeEntry(CacheIndex::CIS_CACHED, 1, now)));
+	EXPECT_EQ(0, index.set(makeKey(1), makeEntry(CacheIndex::CIS_CACHED, 1, now)));
+	ASSERT_EQ(0, index.commit());
+	EXPECT_EQ(0, index.set(makeKey(2), makeEntry(CacheIndex::CIS_NEGATIVE, 0, now)));
+	index.remove(makeKey(0));
+
+	std::vector<string> keys = index.keys();
+	std::sort(keys.begin(), keys.end());
+	ASSERT_EQ(2U, keys.size());
+	EXPECT_EQ(makeKey(1), keys[0]);
+	EXPECT_EQ(makeKey(2), keys[1]);
+}
+
+/**
+ * The hash table grows as entries are added.
+ */
+TEST_F(CacheIndexTest, manyEntries)
+{
+	const time_t now = time(nullptr);
+	CacheIndex index(m_filename);
+	for (unsigned int i = 0; i < 1000; i++) {
+		ASSERT_EQ(0, index.set(makeKey(i), makeEntry(CacheIndex::CIS_CACHED, i + 1, now)));
+		if (i % 100 == 99) {
+			ASSERT_EQ(0, index.commit());
+		}
+	}
+
+	CacheIndex index2(m_filename);
+	ASSERT_EQ(0, index2.reload());
+	for (unsigned int i = 0; i < 1000; i++) {
+		CacheIndex::Entry entry;
+		ASSERT_TRUE(index2.lookup(makeKey(i), &entry)) << "key " << i;
+		EXPECT_EQ(i + 1, entry.size) << "key " << i;
+	}
+}
+
+/**
+ * Cache keys that are too long can't be indexed.
+ */
+TEST_F(CacheIndexTest, keyTooLong)
+{
+	const string key(CacheIndex::MAX_KEY_LENGTH, 'x');
+	CacheIndex index(m_filename);
+	EXPECT_EQ(-ENAMETOOLONG, index.set(key, makeEntry(CacheIndex::CIS_CACHED, 1, time(nullptr))));
+	EXPECT_FALSE(index.isDirty());
+}
+
+/**
+ * An invalid index file is ignored, and replaced by commit().
+ */
+TEST_F(CacheIndexTest, invalidIndex)
+{
+	static const char garbage[] = "This is not a cache index.";
+	RpFile *const file = new RpFile(m_filename, RpFile::FM_CREATE_WRITE);
+	ASSERT_TRUE(file->isOpen());
+	EXPECT_EQ(sizeof(garbage), file->write(garbage, sizeof(garbage)));
+	file->unref();
+
+	CacheIndex index(m_filename);
+	EXPECT_EQ(-EIO, index.reload());
+	CacheIndex::Entry entry;
+	EXPECT_FALSE(index.lookup(makeKey(0), &entry));
+
+	EXPECT_EQ(0, index.set(makeKey(0), makeEntry(CacheIndex::CIS_CACHED, 1, time(nullptr))));
+	ASSERT_EQ(0, index.commit());
+
+	CacheIndex index2(m_filename);
+	ASSERT_EQ(0, index2.reload());
+	EXPECT_TRUE(index2.lookup(makeKey(0), &entry));
+}
+
+/**
+ * purge() removes expired negative cache entries and their files.
+ */
+TEST_F(CacheIndexTest, purge)
+{
+	// Negative cache file for the expired entry.
+	string negFilename = "CacheIndexTest_data";
+	negFilename += DIR_SEP_CHR;
+	negFilename += makeKey(0);
+	ASSERT_EQ(0, FileSystem::rmkdir(negFilename));
+	RpFile *const file = new RpFile(negFilename, RpFile::FM_CREATE_WRITE);
+	ASSERT_TRUE(file->isOpen());
+	file->unref();
+
+	const time_t now = time(nullptr);
+	CacheIndex index(m_filename);
+	EXPECT_EQ(0, index.set(makeKey(0), makeEntry(CacheIndex::CIS_NEGATIVE, 0, now - CacheIndex::NEGATIVE_TTL - 1)));
+	EXPECT_EQ(0, index.set(makeKey(1), makeEntry(CacheIndex::CIS_NEGATIVE, 0, now)));
+	EXPECT_EQ(0, index.set(makeKey(2), makeEntry(CacheIndex::CIS_CACHED, 1, now - CacheIndex::NEGATIVE_TTL - 1)));
+	ASSERT_EQ(0, index.commit());
+
+	EXPECT_EQ(1U, index.purge());
+	ASSERT_EQ(0, index.commit());
+	EXPECT_NE(0, FileSystem::access(negFilename, R_OK));
+
+	CacheIndex index2(m_filename);
+	ASSERT_EQ(0, index2.reload());
+	CacheIndex::Entry entry;
+	EXPECT_FALSE(index2.lookup(makeKey(0), &entry));
+	EXPECT_TRUE(index2.lookup(makeKey(1), &entry));
+	EXPECT_TRUE(index2.lookup(makeKey(2), &entry));
+}
+
+/**
+ * commit() locks "index.lock" in the index directory,
+ * and releases the lock when it's done.
+ */
+TEST_F(CacheIndexTest, commitLock)
+{
+	CacheIndex index(m_filename);
+	EXPECT_EQ(0, index.set(makeKey(0), makeEntry(CacheIndex::CIS_CACHED, 1, time(nullptr))));
+	ASSERT_EQ(0, index.commit());
+	ASSERT_EQ(0, FileSystem::access(m_lockFilename, R_OK));
+
+#ifndef _WIN32
+	// The lock must not be held after commit() returns.
+	const int fd = open(m_lockFilename.c_str(), O_RDWR | O_CLOEXEC);
+	ASSERT_GE(fd, 0);
+	EXPECT_EQ(0, flock(fd, LOCK_EX | LOCK_NB));
+	close(fd);
+#endif /* !_WIN32 */
+}
+
+/**
+ * Benchmark cache index lookups.
+ */
+TEST_F(CacheIndexTest, lookupBenchmark)
+{
+	const time_t now = time(nullptr);
+	CacheIndex index(m_filename);
+	for (unsigned int i = 0; i < BENCHMARK_KEYS; i++) {
+		ASSERT_EQ(0, index.set(makeKey(i), makeEntry(CacheIndex::CIS_CACHED, i + 1, now)));
+	}
+	ASSERT_EQ(0, index.commit());
+
+	// Look up keys that are present and keys that aren't.
+	unsigned int found = 0;
+	for (unsigned int n = BENCHMARK_ITERATIONS; n > 0; n--) {
+		for (unsigned int i = 0; i < BENCHMARK_KEYS * 2; i++) {
+			CacheIndex::Entry entry;
+			if (index.lookup(makeKey(i), &entry)) {
+				found++;
+			}
+		}
+	}
+	EXPECT_EQ(BENCHMARK_KEYS * BENCHMARK_ITERATIONS, found);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: CacheIndex tests.\n\n");
+	fprintf(stderr, "Benchmark iterations: %u\n",
+		LibRomData::Tests::CacheIndexTest::BENCHMARK_ITERATIONS);
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,341 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * CacheMaintenanceTest.cpp: CacheMaintenance class test.                  *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpfile
+#include "common.h"
+#include "librpfile/FileSystem.hpp"
+#include "librpfile/RpFile.hpp"
+using namespace LibRpFile;
+
+// CacheMaintenance
+#include "img/CacheIndex.hpp"
+#include "img/CacheMaintenance.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibRomData { namespace Tests {
+
+class CacheMaintenanceTest : public ::testing::Test
+{
+	protected:
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+	public:
+		// Number of files in the test cache.
+		static const unsigned int FILE_COUNT = 10;
+
+		// Size of each file in the test cache.
+		static const unsigned int FILE_SIZE = 1000;
+
+	public:
+		// Cache directory, with trailing separator.
+		string m_cacheDir;
+
+		/**
+		 * Get a cache key for the specified number.
+		 * @param i Number.
+		 * @return Cache key.
+		 */
+		static string makeKey(unsigned int i);
+
+		/**
+		 * Create the test cache.
+		 * File i was last accessed before file i+1.
+		 * @param indexed If true, add the files to the cache index.
+		 */
+		void createCache(bool indexed);
+
+		/**
+		 * Check if a cache file exists.
+		 * @param i Number.
+		 * @return True if the file exists.
+		 */
+		bool fileExists(unsigned int i) const;
+};
+
+/**
+ * SetUp() function.
+ * Run before each test.
+ */
+void CacheMaintenanceTest::SetUp(void)
+{
+	m_cacheDir = "CacheMaintenanceTest_data";
+	m_cacheDir += DIR_SEP_CHR;
+	ASSERT_EQ(0, FileSystem::rmkdir(m_cacheDir + makeKey(0)));
+}
+
+/**
+ * TearDown() function.
+ * Run after each test.
+ */
+void CacheMaintenanceTest::TearDown(void)
+{
+	for (unsigned int i = 0; i < FILE_COUNT; i++) {
+		FileSystem::delete_file(m_cacheDir + makeKey(i));
+	}
+	FileSystem::delete_file(m_cacheDir + "index.bin");
+}
+
+/**
+ * Get a cache key for the specified number.
+ * @param i Number.
+ * @return Cache key.
+ */
+string CacheMaintenanceTest::makeKey(unsigned int i)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "wii%ccover%cUS%cT%05u.png",
+		DIR_SEP_CHR, DIR_SEP_CHR, DIR_SEP_CHR, i);
+	return string(buf);
+}
+
+/**
+ * Create the test cache.
+ * File i was last accessed before file i+1.
+ * @param indexed If true, add the files to the cache index.
+ */
+void CacheMaintenanceTest::createCache(bool indexed)
+{
+	const time_t now = time(nullptr);
+	CacheIndex index(m_cacheDir + "index.bin");
+	vector<uint8_t> buf(FILE_SIZE, 0x55);
+
+	for (unsigned int i = 0; i < FILE_COUNT; i++) {
+		const string key = makeKey(i);
+		RpFile *const file = new RpFile(m_cacheDir + key, RpFile::FM_CREATE_WRITE);
+		ASSERT_TRUE(file->isOpen());
+		const size_t size = file->write(buf.data(), buf.size());
+		file->unref();
+		ASSERT_EQ(buf.size(), size);
+
+		if (indexed) {
+			CacheIndex::Entry entry;
+			entry.status = CacheIndex::CIS_CACHED;
+			entry.size = FILE_SIZE;
+			entry.cached_time = now - 86400;
+			entry.last_modified = 0;
+			entry.expires = 0;
+			entry.last_access = now - 86400 + (i * 3600);
+			ASSERT_EQ(0, index.set(key, entry));
+		}
+	}
+
+	if (indexed) {
+		ASSERT_EQ(0, index.commit());
+	}
+}
+
+/**
+ * Check if a cache file exists.
+ * @param i Number.
+ * @return True if the file exists.
+ */
+bool CacheMaintenanceTest::fileExists(unsigned int i) const
+{
+	return (FileSystem::access(m_cacheDir + makeKey(i), R_OK) == 0);
+}
+
+/**
+ * Nothing is removed if the cache is within budget.
+ */
+TEST_F(CacheMaintenanceTest, withinBudget)
+{
+	ASSERT_NO_FATAL_FAILURE(createCache(true));
+
+	CacheMaintenance maint(m_cacheDir);
+	const CacheMaintenance::Budget budget = {FILE_COUNT * FILE_SIZE, FILE_COUNT};
+	maint.setBudget(budget);
+	maint.setGracePeriod(0);
+	EXPECT_EQ(0, maint.run());
+
+	const CacheMaintenance::Stats &stats = maint.stats();
+	EXPECT_TRUE(stats.done);
+	EXPECT_EQ(static_cast<uint32_t>(FILE_COUNT), stats.totalFiles);
+	EXPECT_EQ(static_cast<uint64_t>(FILE_COUNT * FILE_SIZE), stats.totalBytes);
+	EXPECT_EQ(0U, stats.removedFiles);
+	EXPECT_EQ(0U, stats.reclaimedBytes);
+	for (unsigned int i = 0; i < FILE_COUNT; i++) {
+		EXPECT_TRUE(fileExists(i)) << "file " << i;
+	}
+}
+
+/**
+ * The least-recently-used files are removed to meet a byte budget,
+ * and they're removed from the cache index.
+ */
+TEST_F(CacheMaintenanceTest, byteBudget)
+{
+	ASSERT_NO_FATAL_FAILURE(createCache(true));
+
+	CacheMaintenance maint(m_cacheDir);
+	const CacheMaintenance::Budget budget = {FILE_SIZE * 5 + (FILE_SIZE / 2), 0};
+	maint.setBudget(budget);
+	maint.setGracePeriod(0);
+	EXPECT_EQ(0, maint.run());
+
+	const CacheMaintenance::Stats &stats = maint.stats();
+	EXPECT_EQ(5U, stats.removedFiles);
+	EXPECT_EQ(static_cast<uint64_t>(FILE_SIZE * 5), stats.reclaimedBytes);
+	EXPECT_EQ(0U, stats.skippedFiles);
+
+	CacheIndex index(m_cacheDir + "index.bin");
+	ASSERT_EQ(0, index.reload());
+	for (unsigned int i = 0; i < FILE_COUNT; i++) {
+		CacheIndex::Entry entry;
+		EXPECT_EQ(i >= 5, fileExists(i)) << "file " << i;
+		EXPECT_EQ(i >= 5, index.lookup(makeKey(i), &entry)) << "file " << i;
+	}
+}
+
+/**
+ * The least-recently-used files are removed to meet a file budget.
+ */
+TEST_F(CacheMaintenanceTest, fileBudget)
+{
+	ASSERT_NO_FATAL_FAILURE(createCache(true));
+
+	CacheMaintenance maint(m_cacheDir);
+	const CacheMaintenance::Budget budget = {0, 3};
+	maint.setBudget(budget);
+	maint.setGracePeriod(0);
+	EXPECT_EQ(0, maint.run());
+
+	EXPECT_EQ(FILE_COUNT - 3, maint.stats().removedFiles);
+	for (unsigned int i = 0; i < FILE_COUNT; i++) {
+		EXPECT_EQ(i >= FILE_COUNT - 3, fileExists(i)) << "file " << i;
+	}
+}
+
+/**
+ * Files that aren't in the index are removed using
+ * the file system's timestamps.
+ */
+TEST_F(CacheMaintenanceTest, notIndexed)
+{
+	ASSERT_NO_FATAL_FAILURE(createCache(false));
+
+	CacheMaintenance maint(m_cacheDir);
+	const CacheMaintenance::Budget budget = {0, 4};
+	maint.setBudget(budget);
+	maint.setGracePeriod(0);
+	EXPECT_EQ(0, maint.run());
+
+	EXPECT_EQ(FILE_COUNT - 4, maint.stats().removedFiles);
+	unsigned int remaining = 0;
+	for (unsigned int i = 0; i < FILE_COUNT; i++) {
+		if (fileExists(i)) {
+			remaining++;
+		}
+	}
+	EXPECT_EQ(4U, remaining);
+}
+
+/**
+ * Recently-created files are never removed, since
+ * rp-download may still be writing them.
+ */
+TEST_F(CacheMaintenanceTest, gracePeriod)
+{
+	ASSERT_NO_FATAL_FAILURE(createCache(true));
+
+	CacheMaintenance maint(m_cacheDir);
+	const CacheMaintenance::Budget budget = {0, 1};
+	maint.setBudget(budget);
+	EXPECT_EQ(0, maint.run());
+
+	const CacheMaintenance::Stats &stats = maint.stats();
+	EXPECT_EQ(0U, stats.removedFiles);
+	EXPECT_EQ(static_cast<uint32_t>(FILE_COUNT), stats.skippedFiles);
+	for (unsigned int i = 0; i < FILE_COUNT; i++) {
+		EXPECT_TRUE(fileExists(i)) << "file " << i;
+	}
+}
+
+/**
+ * Index entries for files that no longer exist are removed.
+ */
+TEST_F(CacheMaintenanceTest, staleIndexEntries)
+{
+	ASSERT_NO_FATAL_FAILURE(createCache(true));
+	ASSERT_EQ(0, FileSystem::delete_file(m_cacheDir + makeKey(2)));
+
+	CacheMaintenance maint(m_cacheDir);
+	const CacheMaintenance::Budget budget = {0, FILE_COUNT};
+	maint.setBudget(budget);
+	maint.setGracePeriod(0);
+	EXPECT_EQ(0, maint.run());
+	EXPECT_EQ(FILE_COUNT - 1, maint.stats().totalFiles);
+
+	CacheIndex index(m_cacheDir + "index.bin");
+	ASSERT_EQ(0, index.reload());
+	CacheIndex::Entry entry;
+	EXPECT_FALSE(index.lookup(makeKey(2), &entry));
+	EXPECT_TRUE(index.lookup(makeKey(3), &entry));
+}
+
+/**
+ * Temporary files left behind by interrupted writes are removed
+ * once they're older than the grace period.
+ */
+TEST_F(CacheMaintenanceTest, staleTempFiles)
+{
+	ASSERT_NO_FATAL_FAILURE(createCache(true));
+	const string tmpFilename = m_cacheDir + "index.bin.1234.0.tmp";
+	RpFile *const file = new RpFile(tmpFilename, RpFile::FM_CREATE_WRITE);
+	ASSERT_TRUE(file->isOpen());
+	file->unref();
+
+	// Recently-created temporary files are kept.
+	CacheMaintenance maint1(m_cacheDir);
+	const CacheMaintenance::Budget budget = {0, FILE_COUNT};
+	maint1.setBudget(budget);
+	EXPECT_EQ(0, maint1.run());
+	EXPECT_EQ(0, FileSystem::access(tmpFilename, R_OK));
+
+	CacheMaintenance maint2(m_cacheDir);
+	maint2.setBudget(budget);
+	maint2.setGracePeriod(0);
+	EXPECT_EQ(0, maint2.run());
+	EXPECT_NE(0, FileSystem::access(tmpFilename, R_OK));
+	EXPECT_EQ(static_cast<uint32_t>(FILE_COUNT), maint2.stats().totalFiles);
+	for (unsigned int i = 0; i < FILE_COUNT; i++) {
+		EXPECT_TRUE(fileExists(i)) << "file " << i;
+	}
+
+	FileSystem::delete_file(tmpFilename);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: CacheMaintenance tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,626 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * RomDataCacheTest.cpp: RomDataCache class test.                          *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// zlib
+#include <zlib.h>
+
+// gzclose_r() and gzclose_w() were introduced in zlib-1.2.4.
+#if (ZLIB_VER_MAJOR > 1) || \
+    (ZLIB_VER_MAJOR == 1 && ZLIB_VER_MINOR > 2) || \
+    (ZLIB_VER_MAJOR == 1 && ZLIB_VER_MINOR == 2 && ZLIB_VER_REVISION >= 4)
+// zlib-1.2.4 or later
+#else
+#define gzclose_r(file) gzclose(file)
+#endif
+
+// librpbase, librpfile
+#include "common.h"
+#include "librpbase/RomData.hpp"
+#include "librpbase/RomDataCache.hpp"
+#include "librpbase/RomFields.hpp"
+#include "librpbase/RomMetaData.hpp"
+#include "librpfile/FileSystem.hpp"
+#include "librpfile/RpFile.hpp"
+using namespace LibRpBase;
+using namespace LibRpFile;
+
+// RomDataFactory
+#include "RomDataFactory.hpp"
+
+// C includes.
+#ifndef _WIN32
+# include <unistd.h>
+#endif /* !_WIN32 */
+
+// C includes. (C++ namespace)
+#include "ctypex.h"
+#include <cstring>
+
+// C++ includes.
+#include <string>
+using std::string;
+using std::vector;
+
+// Uninitialized vector class.
+// Reference: http://andreoffringa.org/?q=uvector
+#include "uvector.h"
+
+namespace LibRomData { namespace Tests {
+
+class RomDataCacheTest : public ::testing::TestWithParam<const char*>
+{
+	protected:
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+	public:
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 1000;
+
+	public:
+		// ROM filename. (extracted from the .gz test file)
+		string m_filename;
+
+		/**
+		 * Parse the ROM file.
+		 * @param pRomData [out] RomData. (Caller must unref() it.)
+		 */
+		void parse(RomData **pRomData);
+
+		/**
+		 * Store the ROM's fields and metadata in the cache.
+		 * @param pRomData [out] RomData. (Caller must unref() it.)
+		 */
+		void parseAndStore(RomData **pRomData);
+
+		/**
+		 * Overwrite part of the ROM file without changing its size.
+		 * @param pos Position.
+		 * @param byte Byte to write.
+		 */
+		void writeByte(off64_t pos, uint8_t byte);
+
+		/**
+		 * Compare two RomFields objects.
+		 * @param expected Expected RomFields.
+		 * @param actual Actual RomFields.
+		 */
+		static void compareFields(const RomFields *expected, const RomFields *actual);
+
+		/**
+		 * Compare two RomMetaData objects.
+		 * @param expected Expected RomMetaData.
+		 * @param actual Actual RomMetaData.
+		 */
+		static void compareMetaData(const RomMetaData *expected, const RomMetaData *actual);
+
+		/**
+		 * Test case suffix generator.
+		 * @param info Test parameter information.
+		 * @return Test case suffix.
+		 */
+		static string test_case_suffix_generator(const ::testing::TestParamInfo<const char*> &info);
+};
+
+/**
+ * SetUp() function.
+ * Run before each test.
+ */
+void RomDataCacheTest::SetUp(void)
+{
+	// Decompress the test file.
+	// RomDataCache uses the file's size and mtime,
+	// so it has to be an actual file.
+	string path = "ImageDecoder_data";
+	path += DIR_SEP_CHR;
+	path += GetParam();
+#ifdef _WIN32
+	std::for_each(path.begin(), path.end(), [](char &p) {
+		if (p == '/') {
+			p = '\\';
+		}
+	});
+#endif /* _WIN32 */
+
+	gzFile gzf = gzopen(path.c_str(), "rb");
+	ASSERT_TRUE(gzf != nullptr) << "gzopen() failed to open the test file: " << GetParam();
+	ao::uvector<uint8_t> buf;
+	uint8_t gzbuf[4096];
+	while (!gzeof(gzf)) {
+		int sz_read = gzread(gzf, gzbuf, sizeof(gzbuf));
+		if (sz_read <= 0)
+			break;
+		buf.insert(buf.end(), gzbuf, gzbuf + sz_read);
+	}
+	gzclose_r(gzf);
+	ASSERT_FALSE(buf.empty()) << "Error loading test file: " << GetParam();
+
+	// Keep the filename and extension, minus ".gz".
+	const char *const slash_pos = strrchr(GetParam(), '/');
+	m_filename = "RomDataCacheTest_data";
+	m_filename += DIR_SEP_CHR;
+	m_filename += (slash_pos ? slash_pos + 1 : GetParam());
+	m_filename.resize(m_filename.size() - 3);
+
+	ASSERT_EQ(0, FileSystem::rmkdir(m_filename));
+	RpFile *const file = new RpFile(m_filename, RpFile::FM_CREATE_WRITE);
+	ASSERT_TRUE(file->isOpen()) << "Could not create the test file: " << m_filename;
+	EXPECT_EQ(buf.size(), file->write(buf.data(), buf.size()));
+	file->unref();
+
+	// Make sure the file doesn't have a cache entry yet.
+	RomDataCache::remove(m_filename.c_str());
+}
+
+/**
+ * TearDown() function.
+ * Run after each test.
+ */
+void RomDataCacheTest::TearDown(void)
+{
+	if (!m_filename.empty()) {
+		RomDataCache::remove(m_filename.c_str());
+		FileSystem::delete_file(m_filename);
+	}
+}
+
+/**
+ * Parse the ROM file.
+ * @param pRomData [out] RomData. (Caller must unref() it.)
+ */
+void RomDataCacheTest::parse(RomData **pRomData)
+{
+	*pRomData = nullptr;
+	RpFile *const file = new RpFile(m_filename, RpFile::FM_OPEN_READ);
+	ASSERT_TRUE(file->isOpen());
+	*pRomData = RomDataFactory::create(file);
+	file->unref();
+	ASSERT_TRUE(*pRomData != nullptr) << "File was not detected: " << m_filename;
+	ASSERT_TRUE((*pRomData)->fields() != nullptr);
+}
+
+/**
+ * Store the ROM's fields and metadata in the cache.
+ * @param pRomData [out] RomData. (Caller must unref() it.)
+ */
+void RomDataCacheTest::parseAndStore(RomData **pRomData)
+{
+	ASSERT_NO_FATAL_FAILURE(parse(pRomData));
+	const RomData *const romData = *pRomData;
+	ASSERT_EQ(0, RomDataCache::store(m_filename.c_str(), romData->fields(), romData->metaData()));
+}
+
+/**
+ * Overwrite part of the ROM file without changing its size.
+ * @param pos Position.
+ * @param byte Byte to write.
+ */
+void RomDataCacheTest::writeByte(off64_t pos, uint8_t byte)
+{
+	RpFile *const file = new RpFile(m_filename, RpFile::FM_OPEN_WRITE);
+	ASSERT_TRUE(file->isOpen());
+	ASSERT_EQ(0, file->seek(pos));
+	EXPECT_EQ(1U, file->write(&byte, 1));
+	file->unref();
+}
+
+/**
+ * Compare two RomFields objects.
+ * @param expected Expected RomFields.
+ * @param actual Actual RomFields.
+ */
+void RomDataCacheTest::compareFields(const RomFields *expected, const RomFields *actual)
+{
+	EXPECT_EQ(expected->defaultLanguageCode(), actual->defaultLanguageCode());
+	ASSERT_EQ(expected->tabCount(), actual->tabCount());
+	for (int i = 0; i < expected->tabCount(); i++) {
+		const char *const tabExpected = expected->tabName(i);
+		const char *const tabActual = actual->tabName(i);
+		EXPECT_STREQ(tabExpected ? tabExpected : "", tabActual ? tabActual : "") << "tab " << i;
+	}
+
+	// Invalid fields aren't cached.
+	vector<const RomFields::Field*> vExpected;
+	for (auto iter = expected->cbegin(); iter != expected->cend(); ++iter) {
+		if (iter->isValid) {
+			vExpected.push_back(&(*iter));
+		}
+	}
+	ASSERT_EQ(static_cast<int>(vExpected.size()), actual->count());
+
+	for (int i = 0; i < actual->count(); i++) {
+		const RomFields::Field &fe = *vExpected[i];
+		const RomFields::Field &fa = *actual->at(i);
+		ASSERT_EQ(fe.type, fa.type) << "field " << i;
+		EXPECT_EQ(fe.name, fa.name) << "field " << i;
+		EXPECT_EQ(fe.tabIdx, fa.tabIdx) << "field " << i;
+		EXPECT_TRUE(fa.isValid) << "field " << i;
+
+		switch (fe.type) {
+			case RomFields::RFT_STRING:
+				EXPECT_EQ(fe.desc.flags, fa.desc.flags);
+				ASSERT_EQ(fe.data.str != nullptr, fa.data.str != nullptr);
+				if (fe.data.str) {
+					EXPECT_EQ(*fe.data.str, *fa.data.str);
+				}
+				break;
+
+			case RomFields::RFT_BITFIELD:
+				EXPECT_EQ(fe.desc.bitfield.elemsPerRow, fa.desc.bitfield.elemsPerRow);
+				EXPECT_EQ(*fe.desc.bitfield.names, *fa.desc.bitfield.names);
+				EXPECT_EQ(fe.data.bitfield, fa.data.bitfield);
+				break;
+
+			case RomFields::RFT_LISTDATA: {
+				const auto &lde = fe.desc.list_data;
+				const auto &lda = fa.desc.list_data;
+				EXPECT_EQ(lde.flags, lda.flags);
+				EXPECT_EQ(lde.rows_visible, lda.rows_visible);
+				EXPECT_EQ(lde.alignment.headers, lda.alignment.headers);
+				EXPECT_EQ(lde.alignment.data, lda.alignment.data);
+				ASSERT_EQ(lde.names != nullptr, lda.names != nullptr);
+				if (lde.names) {
+					EXPECT_EQ(*lde.names, *lda.names);
+				}
+				if (lde.flags & RomFields::RFT_LISTDATA_MULTI) {
+					ASSERT_EQ(fe.data.list_data.data.multi != nullptr, fa.data.list_data.data.multi != nullptr);
+					if (fe.data.list_data.data.multi) {
+						EXPECT_EQ(*fe.data.list_data.data.multi, *fa.data.list_data.data.multi);
+					}
+				} else {
+					ASSERT_EQ(fe.data.list_data.data.single != nullptr, fa.data.list_data.data.single != nullptr);
+					if (fe.data.list_data.data.single) {
+						EXPECT_EQ(*fe.data.list_data.data.single, *fa.data.list_data.data.single);
+					}
+				}
+				if (lde.flags & RomFields::RFT_LISTDATA_CHECKBOXES) {
+					EXPECT_EQ(fe.data.list_data.mxd.checkboxes, fa.data.list_data.mxd.checkboxes);
+				}
+				break;
+			}
+
+			case RomFields::RFT_DATETIME:
+				EXPECT_EQ(fe.desc.flags, fa.desc.flags);
+				EXPECT_EQ(fe.data.date_time, fa.data.date_time);
+				break;
+
+			case RomFields::RFT_AGE_RATINGS:
+				EXPECT_EQ(*fe.data.age_ratings, *fa.data.age_ratings);
+				break;
+
+			case RomFields::RFT_DIMENSIONS:
+				EXPECT_EQ(0, memcmp(fe.data.dimensions, fa.data.dimensions, sizeof(fe.data.dimensions)));
+				break;
+
+			case RomFields::RFT_STRING_MULTI:
+				EXPECT_EQ(fe.desc.flags, fa.desc.flags);
+				ASSERT_EQ(fe.data.str_multi != nullptr, fa.data.str_multi != nullptr);
+				if (fe.data.str_multi) {
+					EXPECT_EQ(*fe.data.str_multi, *fa.data.str_multi);
+				}
+				break;
+
+			default:
+				ADD_FAILURE() << "Unsupported field type: " << static_cast<int>(fe.type);
+				break;
+		}
+	}
+}
+
+/**
+ * Compare two RomMetaData objects.
+ * @param expected Expected RomMetaData.
+ * @param actual Actual RomMetaData.
+ */
+void RomDataCacheTest::compareMetaData(const RomMetaData *expected, const RomMetaData *actual)
+{
+	ASSERT_EQ(expected->count(), actual->count());
+	for (int i = 0; i < expected->count(); i++) {
+		const RomMetaData::MetaData *const pe = expected->prop(i);
+		const RomMetaData::MetaData *const pa = actual->prop(i);
+		ASSERT_EQ(pe->name, pa->name) << "property " << i;
+		ASSERT_EQ(pe->type, pa->type) << "property " << i;
+		switch (pe->type) {
+			case PropertyType::Integer:
+				EXPECT_EQ(pe->data.ivalue, pa->data.ivalue);
+				break;
+			case PropertyType::UnsignedInteger:
+				EXPECT_EQ(pe->data.uvalue, pa->data.uvalue);
+				break;
+			case PropertyType::String:
+				EXPECT_EQ(pe->data.str ? *pe->data.str : string(),
+					  pa->data.str ? *pa->data.str : string());
+				break;
+			case PropertyType::Timestamp:
+				EXPECT_EQ(pe->data.timestamp, pa->data.timestamp);
+				break;
+			default:
+				ADD_FAILURE() << "Unsupported property type: " << static_cast<int>(pe->type);
+				break;
+		}
+	}
+}
+
+/**
+ * Store and load a cache entry.
+ */
+TEST_P(RomDataCacheTest, storeAndLoadTest)
+{
+	// Nothing should be cached yet.
+	RomFields fields;
+	EXPECT_EQ(-ENOENT, RomDataCache::load(m_filename.c_str(), &fields, nullptr));
+
+	RomData *romData = nullptr;
+	ASSERT_NO_FATAL_FAILURE(parseAndStore(&romData));
+
+	RomFields cachedFields;
+	RomMetaData cachedMetaData;
+	const RomMetaData *const metaData = romData->metaData();
+	EXPECT_EQ(0, RomDataCache::load(m_filename.c_str(), &cachedFields,
+		metaData ? &cachedMetaData : nullptr, RomDataCache::RDC_VERIFY_HEADER));
+	compareFields(romData->fields(), &cachedFields);
+	if (metaData) {
+		compareMetaData(metaData, &cachedMetaData);
+	}
+
+	romData->unref();
+}
+
+/**
+ * Make sure cache entries are invalidated if the ROM file changes.
+ */
+TEST_P(RomDataCacheTest, invalidateTest)
+{
+	RomData *romData = nullptr;
+	ASSERT_NO_FATAL_FAILURE(parseAndStore(&romData));
+	romData->unref();
+
+	off64_t fileSize;
+	time_t mtime;
+	ASSERT_EQ(0, FileSystem::get_file_size_and_mtime(m_filename, &fileSize, &mtime));
+	{
+		RomFields fields;
+		EXPECT_EQ(0, RomDataCache::load(m_filename.c_str(), &fields, nullptr));
+	}
+
+	// Changing the mtime invalidates the entry.
+	ASSERT_EQ(0, FileSystem::set_mtime(m_filename, mtime + 10));
+	{
+		RomFields fields;
+		EXPECT_EQ(-ENOENT, RomDataCache::load(m_filename.c_str(), &fields, nullptr));
+	}
+	ASSERT_EQ(0, FileSystem::set_mtime(m_filename, mtime));
+	{
+		RomFields fields;
+		EXPECT_EQ(0, RomDataCache::load(m_filename.c_str(), &fields, nullptr));
+	}
+
+	// Modify the file without changing its size or mtime.
+	// This is only detected with RDC_VERIFY_HEADER.
+	uint8_t byte;
+	{
+		RpFile *const file = new RpFile(m_filename, RpFile::FM_OPEN_READ);
+		ASSERT_TRUE(file->isOpen());
+		ASSERT_EQ(1U, file->read(&byte, 1));
+		file->unref();
+	}
+	ASSERT_NO_FATAL_FAILURE(writeByte(0, byte ^ 0xFF));
+	ASSERT_EQ(0, FileSystem::set_mtime(m_filename, mtime));
+	{
+		RomFields fields;
+		EXPECT_EQ(0, RomDataCache::load(m_filename.c_str(), &fields, nullptr));
+	}
+	{
+		RomFields fields;
+		EXPECT_EQ(-ENOENT, RomDataCache::load(m_filename.c_str(), &fields, nullptr,
+			RomDataCache::RDC_VERIFY_HEADER));
+	}
+
+	// Changing the size invalidates the entry.
+	{
+		RpFile *const file = new RpFile(m_filename, RpFile::FM_OPEN_WRITE);
+		ASSERT_TRUE(file->isOpen());
+		EXPECT_EQ(0, file->truncate(fileSize + 1));
+		file->unref();
+	}
+	ASSERT_EQ(0, FileSystem::set_mtime(m_filename, mtime));
+	{
+		RomFields fields;
+		EXPECT_EQ(-ENOENT, RomDataCache::load(m_filename.c_str(), &fields, nullptr));
+	}
+}
+
+/**
+ * Make sure prune() removes stale entries and enforces the size budget.
+ */
+TEST_P(RomDataCacheTest, pruneTest)
+{
+	RomData *romData = nullptr;
+	ASSERT_NO_FATAL_FAILURE(parseAndStore(&romData));
+
+	// Store an entry for a copy of the ROM file, then delete the copy.
+	const string orphanFilename = m_filename + ".orphan";
+	{
+		RpFile *const src = new RpFile(m_filename, RpFile::FM_OPEN_READ);
+		ASSERT_TRUE(src->isOpen());
+		ao::uvector<uint8_t> buf(static_cast<size_t>(src->size()));
+		EXPECT_EQ(buf.size(), src->read(buf.data(), buf.size()));
+		src->unref();
+
+		RpFile *const dest = new RpFile(orphanFilename, RpFile::FM_CREATE_WRITE);
+		ASSERT_TRUE(dest->isOpen());
+		EXPECT_EQ(buf.size(), dest->write(buf.data(), buf.size()));
+		dest->unref();
+	}
+	EXPECT_EQ(0, RomDataCache::store(orphanFilename.c_str(), romData->fields(), romData->metaData()));
+	romData->unref();
+	ASSERT_EQ(0, FileSystem::delete_file(orphanFilename));
+	const string orphanCacheFilename = RomDataCache::getCacheFilename(orphanFilename.c_str());
+	ASSERT_EQ(0, FileSystem::access(orphanCacheFilename, R_OK));
+
+	// With no size limit, only the orphaned entry is removed.
+	EXPECT_EQ(1, RomDataCache::prune(0));
+	EXPECT_NE(0, FileSystem::access(orphanCacheFilename, R_OK));
+	{
+		RomFields fields;
+		EXPECT_EQ(0, RomDataCache::load(m_filename.c_str(), &fields, nullptr));
+	}
+
+	// With a tiny size limit, the remaining entry is removed.
+	EXPECT_EQ(1, RomDataCache::prune(1));
+	{
+		RomFields fields;
+		EXPECT_EQ(-ENOENT, RomDataCache::load(m_filename.c_str(), &fields, nullptr));
+	}
+}
+
+/**
+ * Make sure corrupted cache entries are rejected.
+ */
+TEST_P(RomDataCacheTest, corruptEntryTest)
+{
+	RomData *romData = nullptr;
+	ASSERT_NO_FATAL_FAILURE(parseAndStore(&romData));
+	romData->unref();
+
+	// Read the cache entry.
+	const string cacheFilename = RomDataCache::getCacheFilename(m_filename.c_str());
+	ASSERT_FALSE(cacheFilename.empty());
+	ao::uvector<uint8_t> entry;
+	{
+		RpFile *const file = new RpFile(cacheFilename, RpFile::FM_OPEN_READ);
+		ASSERT_TRUE(file->isOpen());
+		entry.resize(static_cast<size_t>(file->size()));
+		ASSERT_EQ(entry.size(), file->read(entry.data(), entry.size()));
+		file->unref();
+	}
+	ASSERT_GT(entry.size(), 40U);
+
+	// Truncated entry. (e.g. another process is still writing it)
+	// Corrupted entry. (flip a bit in the payload)
+	for (int i = 0; i < 2; i++) {
+		RpFile *const file = new RpFile(cacheFilename, RpFile::FM_CREATE_WRITE);
+		ASSERT_TRUE(file->isOpen());
+		if (i == 0) {
+			file->write(entry.data(), entry.size() - 1);
+		} else {
+			ao::uvector<uint8_t> corrupt(entry);
+			corrupt[entry.size() - 1] ^= 0x01;
+			file->write(corrupt.data(), corrupt.size());
+		}
+		file->unref();
+
+		RomFields fields;
+		EXPECT_EQ(-ENOENT, RomDataCache::load(m_filename.c_str(), &fields, nullptr)) << "case " << i;
+	}
+
+	// Deleted entry.
+	EXPECT_EQ(0, RomDataCache::remove(m_filename.c_str()));
+	RomFields fields;
+	EXPECT_EQ(-ENOENT, RomDataCache::load(m_filename.c_str(), &fields, nullptr));
+}
+
+/**
+ * Benchmark parsing the ROM file. (cold)
+ */
+TEST_P(RomDataCacheTest, coldBenchmark)
+{
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		RomData *romData = nullptr;
+		ASSERT_NO_FATAL_FAILURE(parse(&romData));
+		romData->metaData();
+		romData->unref();
+	}
+}
+
+/**
+ * Benchmark loading the cache entry. (warm)
+ */
+TEST_P(RomDataCacheTest, warmBenchmark)
+{
+	RomData *romData = nullptr;
+	ASSERT_NO_FATAL_FAILURE(parseAndStore(&romData));
+	const bool hasMetaData = (romData->metaData() != nullptr);
+	romData->unref();
+
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		RomFields fields;
+		RomMetaData metaData;
+		ASSERT_EQ(0, RomDataCache::load(m_filename.c_str(), &fields,
+			hasMetaData ? &metaData : nullptr));
+	}
+}
+
+/**
+ * Test case suffix generator.
+ * @param info Test parameter information.
+ * @return Test case suffix.
+ */
+string RomDataCacheTest::test_case_suffix_generator(const ::testing::TestParamInfo<const char*> &info)
+{
+	string suffix = info.param;
+
+	// Replace all non-alphanumeric characters with '_'.
+	// See gtest-param-util.h::IsValidParamName().
+	for (auto iter = suffix.begin(); iter != suffix.end(); ++iter) {
+		// NOTE: Not checking for '_' because that
+		// wastes a branch.
+		if (!ISALNUM(*iter)) {
+			*iter = '_';
+		}
+	}
+
+	// TODO: Convert to ASCII?
+	return suffix;
+}
+
+// Test cases.
+// NOTE: Uses the ImageDecoderTest data files.
+INSTANTIATE_TEST_CASE_P(RomDataCache, RomDataCacheTest,
+	::testing::Values(
+		"S3TC/dxt1-rgb.dds.gz",
+		"KTX2/cubemap_yokohama_bc3_unorm.ktx2.gz",
+		"NDS/A2DE01.header-icon.nds.gz",
+		"SMDH/0004001000020000.smdh.gz",
+		"GCI/01-D43E-ZELDA.gci.gz",
+		"Misc/BASCUS-94228535059524F.PSV.gz",
+		"Misc/MroKrt8.cab.gz")
+	, RomDataCacheTest::test_case_suffix_generator);
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: RomDataCache tests.\n\n");
+	fprintf(stderr, "Benchmark iterations: %u\n",
+		LibRomData::Tests::RomDataCacheTest::BENCHMARK_ITERATIONS);
+	fflush(nullptr);
+
+#ifndef _WIN32
+	// Use a cache directory within the current directory.
+	// NOTE: XDG_CACHE_HOME must be an absolute path.
+	char cwd[4096];
+	if (getcwd(cwd, sizeof(cwd))) {
+		string cache_home = cwd;
+		cache_home += "/RomDataCacheTest_cache";
+		setenv("XDG_CACHE_HOME", cache_home.c_str(), 1);
+	}
+#endif /* !_WIN32 */
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
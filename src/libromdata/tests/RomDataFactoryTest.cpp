@@ -0,0 +1,454 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * RomDataFactoryTest.cpp: RomDataFactory class test.                      *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// zlib
+#include <zlib.h>
+
+// gzclose_r() and gzclose_w() were introduced in zlib-1.2.4.
+#if (ZLIB_VER_MAJOR > 1) || \
+    (ZLIB_VER_MAJOR == 1 && ZLIB_VER_MINOR > 2) || \
+    (ZLIB_VER_MAJOR == 1 && ZLIB_VER_MINOR == 2 && ZLIB_VER_REVISION >= 4)
+// zlib-1.2.4 or later
+#else
+#define gzclose_r(file) gzclose(file)
+#define gzclose_w(file) gzclose(file)
+#endif
+
+// librpbase, librpcpu, librpfile
+#include "common.h"
+#include "librpbase/RomData.hpp"
+#include "librpcpu/byteswap.h"
+#include "librpfile/RpMemFile.hpp"
+#include "librpfile/FileSystem.hpp"
+using namespace LibRpBase;
+using namespace LibRpFile;
+
+// RomDataFactory
+#include "RomDataFactory.hpp"
+
+// RomData subclasses.
+#include "Console/DreamcastSave.hpp"
+#include "Console/GameCubeSave.hpp"
+#include "Console/PlayStationSave.hpp"
+#include "Console/Sega8Bit.hpp"
+#include "Handheld/NintendoDS.hpp"
+#include "Handheld/Nintendo3DS_SMDH.hpp"
+#include "Handheld/PokemonMini.hpp"
+#include "Handheld/VirtualBoy.hpp"
+#include "Other/ISO.hpp"
+#include "Other/NintendoBadge.hpp"
+#include "Other/RpTextureWrapper.hpp"
+
+// Structs for synthetic headers.
+#include "iso_structs.h"
+#include "Console/sega8_structs.h"
+#include "Handheld/pkmnmini_structs.h"
+#include "Handheld/vb_structs.h"
+
+// C includes. (C++ namespace)
+#include "ctypex.h"
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <typeinfo>
+using std::string;
+
+// Uninitialized vector class.
+// Reference: http://andreoffringa.org/?q=uvector
+#include "uvector.h"
+
+namespace LibRomData { namespace Tests {
+
+/**
+ * Synthetic file generator function.
+ * @param buf Output buffer.
+ */
+typedef void (*pfnGenFile_t)(ao::uvector<uint8_t> &buf);
+
+struct RomDataFactoryTest_mode
+{
+	string filename;		// Filename. (.gz is removed for the extension check.)
+	pfnGenFile_t pfnGenFile;	// If not nullptr, generate the file instead of loading it.
+	const std::type_info *type;	// Expected RomData subclass. (nullptr if not supported)
+
+	RomDataFactoryTest_mode(
+		const char *filename,
+		const std::type_info *type,
+		pfnGenFile_t pfnGenFile = nullptr)
+		: filename(filename)
+		, pfnGenFile(pfnGenFile)
+		, type(type)
+	{ }
+};
+
+// Maximum file size for test files.
+static const size_t MAX_TEST_FILESIZE = 12*1024*1024;
+
+class RomDataFactoryTest : public ::testing::TestWithParam<RomDataFactoryTest_mode>
+{
+	protected:
+		RomDataFactoryTest()
+			: ::testing::TestWithParam<RomDataFactoryTest_mode>()
+			, m_file(nullptr)
+		{ }
+
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+	public:
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 10000;
+
+	public:
+		// File buffer.
+		ao::uvector<uint8_t> m_buf;
+
+		// RpMemFile for the file buffer.
+		// Placed here so it can be freed by TearDown() if necessary.
+		RpMemFile *m_file;
+
+	public:
+		/** Test case parameters. **/
+
+		/**
+		 * Test case suffix generator.
+		 * @param info Test parameter information.
+		 * @return Test case suffix.
+		 */
+		static string test_case_suffix_generator(const ::testing::TestParamInfo<RomDataFactoryTest_mode> &info);
+
+	public:
+		/** Synthetic file generators. **/
+
+		/**
+		 * Sega 8-bit ROM image: "TMR SEGA" at 0x7FF0.
+		 * @param buf Output buffer.
+		 */
+		static void gen_Sega8Bit(ao::uvector<uint8_t> &buf);
+
+		/**
+		 * Pokémon Mini ROM image: "MN" + "NINTENDO" at 0x2100.
+		 * @param buf Output buffer.
+		 */
+		static void gen_PokemonMini(ao::uvector<uint8_t> &buf);
+
+		/**
+		 * Virtual Boy ROM image: Header at 0x220 before the end of the file.
+		 * @param buf Output buffer.
+		 */
+		static void gen_VirtualBoy(ao::uvector<uint8_t> &buf);
+
+		/**
+		 * ISO-9660 disc image: Primary volume descriptor at 0x8000.
+		 * @param buf Output buffer.
+		 */
+		static void gen_ISO(ao::uvector<uint8_t> &buf);
+
+		/**
+		 * Blank file. (64 KB of zeroes)
+		 * @param buf Output buffer.
+		 */
+		static void gen_Blank(ao::uvector<uint8_t> &buf);
+};
+
+/**
+ * Formatting function for RomDataFactoryTest.
+ */
+inline ::std::ostream& operator<<(::std::ostream& os, const RomDataFactoryTest_mode& mode)
+{
+	return os << mode.filename;
+};
+
+/**
+ * SetUp() function.
+ * Run before each test.
+ */
+void RomDataFactoryTest::SetUp(void)
+{
+	// Parameterized test.
+	const RomDataFactoryTest_mode &mode = GetParam();
+
+	string filename = mode.filename;
+	if (mode.pfnGenFile) {
+		// Generate the file.
+		mode.pfnGenFile(m_buf);
+		ASSERT_FALSE(m_buf.empty()) << "Synthetic file is empty.";
+	} else {
+		// Open the gzipped test file.
+		string path = "ImageDecoder_data";
+		path += DIR_SEP_CHR;
+		path += filename;
+#ifdef _WIN32
+		std::for_each(path.begin(), path.end(), [](char &p) {
+			if (p == '/') {
+				p = '\\';
+			}
+		});
+#endif /* _WIN32 */
+
+		gzFile gzf = gzopen(path.c_str(), "rb");
+		ASSERT_TRUE(gzf != nullptr) << "gzopen() failed to open the test file: "
+			<< mode.filename;
+
+		// Read through the file until we hit an EOF.
+		uint8_t buf[4096];
+		while (!gzeof(gzf)) {
+			int sz_read = gzread(gzf, buf, sizeof(buf));
+			if (sz_read <= 0)
+				break;
+			m_buf.insert(m_buf.end(), buf, buf + sz_read);
+			if (m_buf.size() > MAX_TEST_FILESIZE)
+				break;
+		}
+		gzclose_r(gzf);
+
+		ASSERT_FALSE(m_buf.empty()) << "Error loading test file: " << mode.filename;
+		ASSERT_LE(m_buf.size(), MAX_TEST_FILESIZE) << "Test file is too big.";
+
+		// Remove the ".gz" extension.
+		if (filename.size() > 3 &&
+		    !filename.compare(filename.size()-3, 3, ".gz"))
+		{
+			filename.resize(filename.size()-3);
+		}
+
+		// Use the full path so related files can be found.
+		filename = path.substr(0, path.size() - (mode.filename.size() - filename.size()));
+	}
+
+	m_file = new RpMemFile(m_buf.data(), m_buf.size());
+	ASSERT_TRUE(m_file->isOpen()) << "Could not create RpMemFile for the test file.";
+	m_file->setFilename(filename);
+}
+
+/**
+ * TearDown() function.
+ * Run after each test.
+ */
+void RomDataFactoryTest::TearDown(void)
+{
+	if (m_file) {
+		m_file->unref();
+		m_file = nullptr;
+	}
+}
+
+/** Synthetic file generators. **/
+
+/**
+ * Sega 8-bit ROM image: "TMR SEGA" at 0x7FF0.
+ * @param buf Output buffer.
+ */
+void RomDataFactoryTest::gen_Sega8Bit(ao::uvector<uint8_t> &buf)
+{
+	buf.resize(32*1024);
+	memset(buf.data(), 0, buf.size());
+	memcpy(&buf[0x7FF0], SEGA8_MAGIC, 8);
+}
+
+/**
+ * Pokémon Mini ROM image: "MN" + "NINTENDO" at 0x2100.
+ * @param buf Output buffer.
+ */
+void RomDataFactoryTest::gen_PokemonMini(ao::uvector<uint8_t> &buf)
+{
+	buf.resize(64*1024);
+	memset(buf.data(), 0, buf.size());
+	PokemonMini_RomHeader *const romHeader =
+		reinterpret_cast<PokemonMini_RomHeader*>(&buf[POKEMONMINI_HEADER_ADDRESS]);
+	romHeader->pm_magic = cpu_to_be16(POKEMONMINI_MN_MAGIC);
+	memcpy(romHeader->nintendo, "NINTENDO", sizeof(romHeader->nintendo));
+	memcpy(romHeader->game_id, "MTST", sizeof(romHeader->game_id));
+	memcpy(romHeader->title, "TEST", 4);
+}
+
+/**
+ * Virtual Boy ROM image: Header at 0x220 before the end of the file.
+ * @param buf Output buffer.
+ */
+void RomDataFactoryTest::gen_VirtualBoy(ao::uvector<uint8_t> &buf)
+{
+	buf.resize(64*1024);
+	memset(buf.data(), 0, buf.size());
+	VB_RomHeader *const romHeader =
+		reinterpret_cast<VB_RomHeader*>(&buf[buf.size() - 0x220]);
+	memset(romHeader->title, ' ', sizeof(romHeader->title)-1);
+	memcpy(romHeader->title, "TEST", 4);
+	romHeader->title[20] = 0;
+	memcpy(romHeader->publisher, "01", sizeof(romHeader->publisher));
+	memcpy(romHeader->gameid, "VTSE", sizeof(romHeader->gameid));
+}
+
+/**
+ * ISO-9660 disc image: Primary volume descriptor at 0x8000.
+ * @param buf Output buffer.
+ */
+void RomDataFactoryTest::gen_ISO(ao::uvector<uint8_t> &buf)
+{
+	// NOTE: RomDataFactory requires ISOs to be at least 256 KB.
+	buf.resize(512*1024);
+	memset(buf.data(), 0, buf.size());
+	ISO_Primary_Volume_Descriptor *const pvd =
+		reinterpret_cast<ISO_Primary_Volume_Descriptor*>(&buf[ISO_PVD_ADDRESS_2048]);
+	pvd->header.type = ISO_VDT_PRIMARY;
+	memcpy(pvd->header.identifier, ISO_VD_MAGIC, sizeof(pvd->header.identifier));
+	pvd->header.version = ISO_VD_VERSION;
+
+	// Volume descriptor set terminator.
+	ISO_Volume_Descriptor_Header *const term =
+		reinterpret_cast<ISO_Volume_Descriptor_Header*>(&buf[ISO_PVD_ADDRESS_2048 + ISO_SECTOR_SIZE_MODE1_COOKED]);
+	term->type = ISO_VDT_TERMINATOR;
+	memcpy(term->identifier, ISO_VD_MAGIC, sizeof(term->identifier));
+	term->version = ISO_VD_VERSION;
+}
+
+/**
+ * Blank file. (64 KB of zeroes)
+ * @param buf Output buffer.
+ */
+void RomDataFactoryTest::gen_Blank(ao::uvector<uint8_t> &buf)
+{
+	buf.resize(64*1024);
+	memset(buf.data(), 0, buf.size());
+}
+
+/**
+ * Run a RomDataFactory test.
+ */
+TEST_P(RomDataFactoryTest, createTest)
+{
+	// Parameterized test.
+	const RomDataFactoryTest_mode &mode = GetParam();
+
+	RomData *const romData = RomDataFactory::create(m_file);
+	if (!mode.type) {
+		// File should not be supported.
+		EXPECT_TRUE(romData == nullptr) << "File was detected as " << typeid(*romData).name()
+			<< ", but it should not be supported.";
+	} else {
+		ASSERT_TRUE(romData != nullptr) << "File was not detected; expected " << mode.type->name();
+		EXPECT_TRUE(typeid(*romData) == *mode.type) << "File was detected as " << typeid(*romData).name()
+			<< "; expected " << mode.type->name();
+		EXPECT_TRUE(romData->isValid());
+	}
+
+	if (romData) {
+		romData->unref();
+	}
+}
+
+/**
+ * Benchmark RomDataFactory::create().
+ */
+TEST_P(RomDataFactoryTest, createBenchmark)
+{
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		RomData *const romData = RomDataFactory::create(m_file);
+		if (romData) {
+			romData->unref();
+		}
+	}
+}
+
+/**
+ * Test case suffix generator.
+ * @param info Test parameter information.
+ * @return Test case suffix.
+ */
+string RomDataFactoryTest::test_case_suffix_generator(const ::testing::TestParamInfo<RomDataFactoryTest_mode> &info)
+{
+	string suffix = info.param.filename;
+
+	// Replace all non-alphanumeric characters with '_'.
+	// See gtest-param-util.h::IsValidParamName().
+	for (auto iter = suffix.begin(); iter != suffix.end(); ++iter) {
+		// NOTE: Not checking for '_' because that
+		// wastes a branch.
+		if (!ISALNUM(*iter)) {
+			*iter = '_';
+		}
+	}
+
+	// TODO: Convert to ASCII?
+	return suffix;
+}
+
+// Test cases.
+
+// Textures. (RpTextureWrapper)
+INSTANTIATE_TEST_CASE_P(Textures, RomDataFactoryTest,
+	::testing::Values(
+		RomDataFactoryTest_mode("S3TC/dxt1-rgb.dds.gz", &typeid(RpTextureWrapper)),
+		RomDataFactoryTest_mode("S3TC/bc5.dds.gz", &typeid(RpTextureWrapper)),
+		RomDataFactoryTest_mode("BC7/w5_grass200_abd_a.dds.gz", &typeid(RpTextureWrapper)),
+		RomDataFactoryTest_mode("PVR/bg_00.pvr.gz", &typeid(RpTextureWrapper)),
+		RomDataFactoryTest_mode("GVR/paldam_off.gvr.gz", &typeid(RpTextureWrapper)),
+		RomDataFactoryTest_mode("KTX/etc1.ktx.gz", &typeid(RpTextureWrapper)),
+		RomDataFactoryTest_mode("KTX2/cubemap_yokohama_bc3_unorm.ktx2.gz", &typeid(RpTextureWrapper)),
+		RomDataFactoryTest_mode("VTF/ABGR8888.vtf.gz", &typeid(RpTextureWrapper)),
+		RomDataFactoryTest_mode("VTF3/elevator_screen_broken_normal.ps3.vtf.gz", &typeid(RpTextureWrapper)),
+		RomDataFactoryTest_mode("PowerVR3/Navigation3D-font.pvr.gz", &typeid(RpTextureWrapper)))
+	, RomDataFactoryTest::test_case_suffix_generator);
+
+// ROM images and save files.
+INSTANTIATE_TEST_CASE_P(RomImages, RomDataFactoryTest,
+	::testing::Values(
+		RomDataFactoryTest_mode("NDS/A2DE01.header-icon.nds.gz", &typeid(NintendoDS)),
+		RomDataFactoryTest_mode("NDS/BFUE41.header-icon.nds.gz", &typeid(NintendoDS)),
+		RomDataFactoryTest_mode("SMDH/0004001000020000.smdh.gz", &typeid(Nintendo3DS_SMDH)),
+		RomDataFactoryTest_mode("GCI/01-D43E-ZELDA.gci.gz", &typeid(GameCubeSave)),
+		RomDataFactoryTest_mode("GCI/01-GALE-SuperSmashBros0110290334.gci.gz", &typeid(GameCubeSave)),
+		RomDataFactoryTest_mode("Misc/BIOS002.VMS.gz", &typeid(DreamcastSave)),
+		RomDataFactoryTest_mode("Misc/BASCUS-94228535059524F.PSV.gz", &typeid(PlayStationSave)),
+		RomDataFactoryTest_mode("Misc/MroKrt8.cab.gz", &typeid(NintendoBadge)),
+		RomDataFactoryTest_mode("Misc/MroKrt8_Chara_Luigi000.prb.gz", &typeid(NintendoBadge)))
+	, RomDataFactoryTest::test_case_suffix_generator);
+
+// Synthetic files with headers at non-zero addresses,
+// footers, and files that shouldn't be detected at all.
+INSTANTIATE_TEST_CASE_P(Synthetic, RomDataFactoryTest,
+	::testing::Values(
+		RomDataFactoryTest_mode("test.sms", &typeid(Sega8Bit), RomDataFactoryTest::gen_Sega8Bit),
+		RomDataFactoryTest_mode("test.gg", &typeid(Sega8Bit), RomDataFactoryTest::gen_Sega8Bit),
+		RomDataFactoryTest_mode("sms.bin", &typeid(Sega8Bit), RomDataFactoryTest::gen_Sega8Bit),
+		RomDataFactoryTest_mode("sms.txt", nullptr, RomDataFactoryTest::gen_Sega8Bit),
+		RomDataFactoryTest_mode("sms_noext", nullptr, RomDataFactoryTest::gen_Sega8Bit),
+		RomDataFactoryTest_mode("test.min", &typeid(PokemonMini), RomDataFactoryTest::gen_PokemonMini),
+		RomDataFactoryTest_mode("min.txt", nullptr, RomDataFactoryTest::gen_PokemonMini),
+		RomDataFactoryTest_mode("test.vb", &typeid(VirtualBoy), RomDataFactoryTest::gen_VirtualBoy),
+		RomDataFactoryTest_mode("vb.bin", nullptr, RomDataFactoryTest::gen_VirtualBoy),
+		RomDataFactoryTest_mode("test.iso", &typeid(ISO), RomDataFactoryTest::gen_ISO),
+		RomDataFactoryTest_mode("iso.bin", &typeid(ISO), RomDataFactoryTest::gen_ISO),
+		RomDataFactoryTest_mode("iso.txt", nullptr, RomDataFactoryTest::gen_ISO),
+		RomDataFactoryTest_mode("blank.bin", nullptr, RomDataFactoryTest::gen_Blank),
+		RomDataFactoryTest_mode("blank.iso", nullptr, RomDataFactoryTest::gen_Blank),
+		RomDataFactoryTest_mode("blank.dat", nullptr, RomDataFactoryTest::gen_Blank))
+	, RomDataFactoryTest::test_case_suffix_generator);
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: RomDataFactory tests.\n\n");
+	fprintf(stderr, "Benchmark iterations: %u\n",
+		LibRomData::Tests::RomDataFactoryTest::BENCHMARK_ITERATIONS);
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
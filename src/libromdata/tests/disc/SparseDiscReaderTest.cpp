@@ -0,0 +1,239 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * SparseDiscReaderTest.cpp: SparseDiscReader block cache test.            *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpbase, librpfile
+#include "librpcpu/byteswap.h"
+#include "librpfile/RpMemFile.hpp"
+using LibRpFile::RpMemFile;
+
+// libromdata
+#include "disc/CisoGcnReader.hpp"
+#include "disc/ciso_gcn.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+namespace LibRomData { namespace Tests {
+
+class SparseDiscReaderTest : public ::testing::Test
+{
+	protected:
+		SparseDiscReaderTest()
+			: memFile(nullptr)
+			, reader(nullptr)
+		{ }
+
+	public:
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+	public:
+		// CISO block size. (minimum allowed size)
+		static const unsigned int BLOCK_SIZE = CISO_BLOCK_SIZE_MIN;
+
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 100;
+
+		/**
+		 * Check data at a given position.
+		 * @param pos Position.
+		 * @param size Size.
+		 */
+		void checkData(off64_t pos, size_t size);
+
+	public:
+		vector<uint8_t> ciso;	// CISO image.
+		vector<uint8_t> data;	// Expected disc image data.
+		RpMemFile *memFile;
+		CisoGcnReader *reader;
+};
+
+/**
+ * SetUp() function.
+ * Run before each test.
+ */
+void SparseDiscReaderTest::SetUp(void)
+{
+	// Block map: 1 == used, 0 == empty.
+	// Runs of used blocks are physically contiguous.
+	static const uint8_t blockMap[] = {
+		1,1,1,0,1,0,0,1,
+		1,1,1,1,0,1,1,1,
+	};
+
+	ciso.assign(CISO_HEADER_SIZE, 0);
+	CISOHeader *const cisoHeader = reinterpret_cast<CISOHeader*>(ciso.data());
+	cisoHeader->magic = cpu_to_be32(CISO_MAGIC);
+	cisoHeader->block_size = cpu_to_le32(BLOCK_SIZE);
+	memcpy(cisoHeader->map, blockMap, sizeof(blockMap));
+
+	data.assign(ARRAY_SIZE(blockMap) * BLOCK_SIZE, 0);
+	uint32_t lcg = 0x12345678;
+	for (size_t i = 0; i < ARRAY_SIZE(blockMap); i++) {
+		if (!blockMap[i])
+			continue;
+
+		uint8_t *const pBlock = &data[i * BLOCK_SIZE];
+		for (unsigned int j = 0; j < BLOCK_SIZE; j++) {
+			lcg = lcg * 1103515245 + 12345;
+			pBlock[j] = static_cast<uint8_t>(lcg >> 16);
+		}
+		ciso.insert(ciso.end(), pBlock, pBlock + BLOCK_SIZE);
+	}
+
+	memFile = new RpMemFile(ciso.data(), ciso.size());
+	reader = new CisoGcnReader(memFile);
+}
+
+/**
+ * TearDown() function.
+ * Run after each test.
+ */
+void SparseDiscReaderTest::TearDown(void)
+{
+	delete reader;
+	reader = nullptr;
+	if (memFile) {
+		memFile->unref();
+		memFile = nullptr;
+	}
+}
+
+/**
+ * Check data at a given position.
+ * @param pos Position.
+ * @param size Size.
+ */
+void SparseDiscReaderTest::checkData(off64_t pos, size_t size)
+{
+	vector<uint8_t> buf(size);
+	ASSERT_EQ(size, reader->seekAndRead(pos, buf.data(), size));
+	EXPECT_EQ(0, memcmp(&data[static_cast<size_t>(pos)], buf.data(), size));
+}
+
+/**
+ * Read the entire disc image at once.
+ * Contiguous blocks are coalesced into single reads.
+ */
+TEST_F(SparseDiscReaderTest, fullReadTest)
+{
+	ASSERT_TRUE(reader->isOpen());
+	ASSERT_EQ(static_cast<off64_t>(data.size()), reader->size());
+	checkData(0, data.size());
+
+	// Unaligned read spanning multiple blocks.
+	checkData(BLOCK_SIZE / 2, data.size() - BLOCK_SIZE);
+}
+
+/**
+ * Partial block reads use the block cache.
+ */
+TEST_F(SparseDiscReaderTest, blockCacheTest)
+{
+	ASSERT_TRUE(reader->isOpen());
+	EXPECT_EQ(0U, reader->blockCacheHits());
+	EXPECT_EQ(0U, reader->blockCacheMisses());
+
+	// First read of block 1: cache miss.
+	checkData(BLOCK_SIZE + 16, 256);
+	EXPECT_EQ(0U, reader->blockCacheHits());
+	EXPECT_EQ(1U, reader->blockCacheMisses());
+
+	// Second read of block 1: cache hit.
+	checkData(BLOCK_SIZE + 1024, 2048);
+	EXPECT_EQ(1U, reader->blockCacheHits());
+	EXPECT_EQ(1U, reader->blockCacheMisses());
+
+	// Full block read of block 1 also uses the cached block.
+	checkData(BLOCK_SIZE, BLOCK_SIZE);
+	EXPECT_EQ(2U, reader->blockCacheHits());
+
+	// Empty blocks are cached as well.
+	checkData(BLOCK_SIZE * 5 + 3, 100);
+	checkData(BLOCK_SIZE * 5 + 7, 100);
+	EXPECT_EQ(3U, reader->blockCacheHits());
+	EXPECT_EQ(2U, reader->blockCacheMisses());
+}
+
+/**
+ * The least recently used block is evicted when the cache is full.
+ */
+TEST_F(SparseDiscReaderTest, blockCacheEvictionTest)
+{
+	ASSERT_TRUE(reader->isOpen());
+	reader->setBlockCacheSize(BLOCK_SIZE * 2);
+	EXPECT_EQ(static_cast<size_t>(BLOCK_SIZE * 2), reader->blockCacheSize());
+
+	checkData(BLOCK_SIZE * 0 + 1, 1);	// miss: [0]
+	checkData(BLOCK_SIZE * 1 + 1, 1);	// miss: [1,0]
+	checkData(BLOCK_SIZE * 0 + 2, 1);	// hit:  [0,1]
+	checkData(BLOCK_SIZE * 2 + 1, 1);	// miss: [2,0]; 1 evicted
+	checkData(BLOCK_SIZE * 0 + 3, 1);	// hit:  [0,2]
+	checkData(BLOCK_SIZE * 1 + 2, 1);	// miss: [1,0]; 2 evicted
+	EXPECT_EQ(2U, reader->blockCacheHits());
+	EXPECT_EQ(4U, reader->blockCacheMisses());
+
+	// Disabling the cache evicts everything.
+	reader->setBlockCacheSize(0);
+	checkData(BLOCK_SIZE * 1 + 3, 1);
+	checkData(BLOCK_SIZE * 1 + 4, 1);
+	EXPECT_EQ(2U, reader->blockCacheHits());
+	EXPECT_EQ(6U, reader->blockCacheMisses());
+}
+
+/**
+ * Benchmark small reads, as done by FST parsers.
+ */
+TEST_F(SparseDiscReaderTest, smallRead_benchmark)
+{
+	uint8_t buf[64];
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		for (size_t pos = 0; pos < data.size(); pos += sizeof(buf)) {
+			reader->seekAndRead(pos, buf, sizeof(buf));
+		}
+	}
+}
+
+/**
+ * Benchmark small reads with the block cache disabled.
+ */
+TEST_F(SparseDiscReaderTest, smallReadNoCache_benchmark)
+{
+	reader->setBlockCacheSize(0);
+	uint8_t buf[64];
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		for (size_t pos = 0; pos < data.size(); pos += sizeof(buf)) {
+			reader->seekAndRead(pos, buf, sizeof(buf));
+		}
+	}
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: SparseDiscReader tests.\n\n");
+	fprintf(stderr, "Benchmark iterations: %u\n", LibRomData::Tests::SparseDiscReaderTest::BENCHMARK_ITERATIONS);
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
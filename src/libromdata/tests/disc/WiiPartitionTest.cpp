@@ -0,0 +1,246 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * WiiPartitionTest.cpp: WiiPartition sector reading test.                 *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpbase, librpfile
+#include "librpcpu/byteswap.h"
+#include "librpbase/disc/DiscReader.hpp"
+#include "librpfile/RpMemFile.hpp"
+using LibRpBase::DiscReader;
+using LibRpFile::RpMemFile;
+
+// libromdata
+#include "disc/WiiPartition.hpp"
+#include "Console/wii_structs.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+namespace LibRomData { namespace Tests {
+
+struct WiiPartitionTest_mode {
+	WiiPartition::CryptoMethod cryptoMethod;
+	const char *name;
+};
+
+class WiiPartitionTest : public ::testing::TestWithParam<WiiPartitionTest_mode>
+{
+	protected:
+		WiiPartitionTest()
+			: memFile(nullptr)
+			, discReader(nullptr)
+			, partition(nullptr)
+		{ }
+
+	public:
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+	public:
+		// Number of sectors in the test partition.
+		static const unsigned int SECTOR_COUNT = 160;
+		// Partition data offset.
+		static const unsigned int DATA_OFFSET = 0x20000;
+
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 100;
+
+		/**
+		 * Check data at a given position.
+		 * @param pos Position.
+		 * @param size Size.
+		 */
+		void checkData(off64_t pos, size_t size);
+
+		/**
+		 * Test case suffix generator.
+		 * @param info Test parameter information.
+		 * @return Test case suffix.
+		 */
+		static std::string test_case_suffix_generator(const ::testing::TestParamInfo<WiiPartitionTest_mode> &info);
+
+	public:
+		vector<uint8_t> disc;	// Disc image.
+		vector<uint8_t> data;	// Expected partition data.
+		RpMemFile *memFile;
+		DiscReader *discReader;
+		WiiPartition *partition;
+};
+
+/**
+ * SetUp() function.
+ * Run before each test.
+ */
+void WiiPartitionTest::SetUp(void)
+{
+	const WiiPartitionTest_mode &mode = GetParam();
+	const bool is32K = ((mode.cryptoMethod & WiiPartition::CM_MASK_SECTOR) == WiiPartition::CM_32K);
+	const unsigned int sectorDataOffset = (is32K ? 0 : 0x400);
+
+	// Partition header.
+	disc.assign(DATA_OFFSET + (SECTOR_COUNT * 0x8000), 0);
+	RVL_PartitionHeader *const partitionHeader = reinterpret_cast<RVL_PartitionHeader*>(disc.data());
+	partitionHeader->ticket.signature_type = cpu_to_be32(RVL_SIGNATURE_TYPE_RSA2048);
+	partitionHeader->data_offset = cpu_to_be32(DATA_OFFSET >> 2);
+	partitionHeader->data_size = cpu_to_be32((SECTOR_COUNT * 0x8000) >> 2);
+
+	// Sector data. (Hashes are filled in too, but should be skipped.)
+	data.clear();
+	uint32_t lcg = 0x12345678;
+	uint8_t *pSector = &disc[DATA_OFFSET];
+	for (unsigned int i = 0; i < SECTOR_COUNT; i++, pSector += 0x8000) {
+		for (unsigned int j = 0; j < 0x8000; j++) {
+			lcg = lcg * 1103515245 + 12345;
+			pSector[j] = static_cast<uint8_t>(lcg >> 16);
+		}
+		data.insert(data.end(), &pSector[sectorDataOffset], &pSector[0x8000]);
+	}
+
+	memFile = new RpMemFile(disc.data(), disc.size());
+	discReader = new DiscReader(memFile);
+	partition = new WiiPartition(discReader, 0, disc.size(), mode.cryptoMethod);
+}
+
+/**
+ * TearDown() function.
+ * Run after each test.
+ */
+void WiiPartitionTest::TearDown(void)
+{
+	delete partition;
+	partition = nullptr;
+	delete discReader;
+	discReader = nullptr;
+	if (memFile) {
+		memFile->unref();
+		memFile = nullptr;
+	}
+}
+
+/**
+ * Check data at a given position.
+ * @param pos Position.
+ * @param size Size.
+ */
+void WiiPartitionTest::checkData(off64_t pos, size_t size)
+{
+	vector<uint8_t> buf(size);
+	ASSERT_EQ(size, partition->seekAndRead(pos, buf.data(), size));
+	EXPECT_EQ(0, memcmp(&data[static_cast<size_t>(pos)], buf.data(), size));
+	EXPECT_EQ(pos + static_cast<off64_t>(size), partition->tell());
+}
+
+/**
+ * Test case suffix generator.
+ * @param info Test parameter information.
+ * @return Test case suffix.
+ */
+std::string WiiPartitionTest::test_case_suffix_generator(const ::testing::TestParamInfo<WiiPartitionTest_mode> &info)
+{
+	return info.param.name;
+}
+
+/**
+ * Small reads within and across sectors.
+ */
+TEST_P(WiiPartitionTest, smallReadTest)
+{
+	ASSERT_TRUE(partition->isOpen());
+
+	static const struct {
+		off64_t pos;
+		size_t size;
+	} reads[] = {
+		{0, 0x440},		// Disc header
+		{0x7B00, 0x200},	// Crosses a 31K boundary
+		{0x7F00, 0x200},	// Crosses a 32K boundary
+		{0x2440, 0x20},		// Same sector as the disc header
+		{0x40000, 0x1234},
+		{3, 5},
+		{0x40010, 0x10},
+	};
+	for (size_t i = 0; i < ARRAY_SIZE(reads); i++) {
+		checkData(reads[i].pos, reads[i].size);
+	}
+}
+
+/**
+ * Large reads spanning multiple batches.
+ */
+TEST_P(WiiPartitionTest, largeReadTest)
+{
+	ASSERT_TRUE(partition->isOpen());
+
+	// Entire partition.
+	checkData(0, data.size());
+
+	// Unaligned start and end.
+	checkData(0x1234, data.size() - 0x5678);
+
+	// Exactly one sector.
+	checkData(0x7C00 * 3, 0x7C00);
+	checkData(0x8000 * 3, 0x8000);
+}
+
+/**
+ * Benchmark reading the entire partition.
+ */
+TEST_P(WiiPartitionTest, largeRead_benchmark)
+{
+	vector<uint8_t> buf(data.size());
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		partition->seekAndRead(0, buf.data(), buf.size());
+	}
+}
+
+/**
+ * Benchmark small reads, as done when walking the FST.
+ */
+TEST_P(WiiPartitionTest, smallRead_benchmark)
+{
+	uint8_t buf[12];
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		for (off64_t pos = 0; pos < 0x40000; pos += 0x800) {
+			partition->seekAndRead(pos, buf, sizeof(buf));
+			partition->seekAndRead(0x440, buf, sizeof(buf));
+		}
+	}
+}
+
+static const WiiPartitionTest_mode modes[] = {
+	{WiiPartition::CM_NASOS, "NASOS"},
+	{WiiPartition::CM_RVTH, "RVTH"},
+};
+
+INSTANTIATE_TEST_CASE_P(WiiPartition, WiiPartitionTest,
+	::testing::ValuesIn(modes),
+	WiiPartitionTest::test_case_suffix_generator);
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: WiiPartition tests.\n\n");
+	fprintf(stderr, "Benchmark iterations: %u\n", LibRomData::Tests::WiiPartitionTest::BENCHMARK_ITERATIONS);
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -31,6 +31,7 @@
 
 // librpbase, librpfile
 #include "common.h"
+#include "librpcpu/byteswap.h"
 #include "librpbase/img/RpImageLoader.hpp"
 #include "librpfile/RpFile.hpp"
 #include "librpfile/RpMemFile.hpp"
@@ -193,6 +194,40 @@ inline ::std::ostream& operator<<(::std::ostream& os, const ImageDecoderTest_mod
 	return os << mode.dds_gz_filename;
 };
 
+/**
+ * Force multithreaded decoding for the current scope.
+ * The minimum image size is set to 0, since the test
+ * images are too small to be decoded in parallel.
+ */
+class ScopedDecoderThreads
+{
+	public:
+		/**
+		 * Force multithreaded decoding.
+		 * @param threads Maximum number of threads. (0 == one per CPU)
+		 */
+		explicit ScopedDecoderThreads(unsigned int threads)
+			: m_oldThreads(ImageDecoder::maxThreads())
+			, m_oldThreshold(ImageDecoder::mtPixelThreshold())
+		{
+			ImageDecoder::setMaxThreads(threads);
+			ImageDecoder::setMTPixelThreshold(0);
+		}
+
+		~ScopedDecoderThreads()
+		{
+			ImageDecoder::setMaxThreads(m_oldThreads);
+			ImageDecoder::setMTPixelThreshold(m_oldThreshold);
+		}
+
+	private:
+		RP_DISABLE_COPY(ScopedDecoderThreads)
+
+	private:
+		unsigned int m_oldThreads;
+		unsigned int m_oldThreshold;
+};
+
 /**
  * Replace slashes with backslashes on Windows.
  * @param path Pathname.
@@ -505,6 +540,16 @@ TEST_P(ImageDecoderTest, decodeTest)
 	ASSERT_NO_FATAL_FAILURE(decodeTest_internal());
 }
 
+/**
+ * Run an ImageDecoder test using multithreaded decoding.
+ * The decoded image must be identical to the single-threaded version.
+ */
+TEST_P(ImageDecoderTest, decodeMTTest)
+{
+	ScopedDecoderThreads threads(0);
+	ASSERT_NO_FATAL_FAILURE(decodeTest_internal());
+}
+
 /**
  * Internal benchmark function.
  */
@@ -634,6 +679,285 @@ TEST_P(ImageDecoderTest, decodeBenchmark)
 	ASSERT_NO_FATAL_FAILURE(decodeBenchmark_internal());
 }
 
+/**
+ * Benchmark an ImageDecoder test using multithreaded decoding.
+ */
+TEST_P(ImageDecoderTest, decodeMTBenchmark)
+{
+	ScopedDecoderThreads threads(0);
+	ASSERT_NO_FATAL_FAILURE(decodeBenchmark_internal());
+}
+
+/**
+ * BC7 decoder variant tests.
+ * Each CPU-specific decoder is tested directly, regardless
+ * of which one is selected by the dispatch function.
+ */
+class ImageDecoderBC7Test : public ImageDecoderTest
+{
+	public:
+		// Offset of the BC7 image data in the test DDS files.
+		// (DDS magic + DDS_HEADER + DDS_HEADER_DXT10)
+		static const unsigned int DDS_BC7_DATA_OFFSET = 4 + 124 + 20;
+
+		typedef rp_image *(*fromBC7_fn)(int width, int height, const uint8_t *img_buf, int img_siz);
+
+		/**
+		 * Decode the DDS image using the specified BC7 decoder.
+		 * @param fn BC7 decoder function.
+		 * @return rp_image, or nullptr on error.
+		 */
+		rp_image *decodeBC7(fromBC7_fn fn);
+
+		/**
+		 * Benchmark the specified BC7 decoder.
+		 * @param fn BC7 decoder function.
+		 */
+		void benchmarkBC7(fromBC7_fn fn);
+
+		/**
+		 * Benchmark the default BC7 decoder using multithreaded decoding.
+		 * @param threads Maximum number of threads.
+		 */
+		void benchmarkBC7_MT(unsigned int threads);
+};
+
+/**
+ * Decode the DDS image using the specified BC7 decoder.
+ * @param fn BC7 decoder function.
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *ImageDecoderBC7Test::decodeBC7(fromBC7_fn fn)
+{
+	if (m_dds_buf.size() <= DDS_BC7_DATA_OFFSET)
+		return nullptr;
+
+	// DDS_HEADER: dwHeight is at 0x0C; dwWidth is at 0x10.
+	const uint32_t *const pHeader32 = reinterpret_cast<const uint32_t*>(m_dds_buf.data());
+	const int height = static_cast<int>(le32_to_cpu(pHeader32[3]));
+	const int width = static_cast<int>(le32_to_cpu(pHeader32[4]));
+	return fn(width, height, &m_dds_buf[DDS_BC7_DATA_OFFSET],
+		static_cast<int>(m_dds_buf.size() - DDS_BC7_DATA_OFFSET));
+}
+
+/**
+ * Benchmark the specified BC7 decoder.
+ * @param fn BC7 decoder function.
+ */
+void ImageDecoderBC7Test::benchmarkBC7(fromBC7_fn fn)
+{
+	for (unsigned int i = BENCHMARK_ITERATIONS_BC7; i > 0; i--) {
+		unique_ptr<rp_image> img(decodeBC7(fn));
+		ASSERT_TRUE(img != nullptr);
+	}
+}
+
+/**
+ * Benchmark the default BC7 decoder using multithreaded decoding.
+ * @param threads Maximum number of threads.
+ */
+void ImageDecoderBC7Test::benchmarkBC7_MT(unsigned int threads)
+{
+	ScopedDecoderThreads mt(threads);
+	ASSERT_NO_FATAL_FAILURE(benchmarkBC7(ImageDecoder::fromBC7));
+}
+
+/**
+ * Compare all BC7 decoder variants against the PNG image.
+ * All variants must be bit-exact.
+ */
+TEST_P(ImageDecoderBC7Test, decodeVariantsTest)
+{
+	// Load the PNG image.
+	unique_IRpFile<RpMemFile> f_png(new RpMemFile(m_png_buf.data(), m_png_buf.size()));
+	ASSERT_TRUE(f_png->isOpen()) << "Could not create RpMemFile for the PNG image.";
+	unique_ptr<rp_image> img_png(RpImageLoader::load(f_png.get()));
+	ASSERT_TRUE(img_png != nullptr) << "Could not load the PNG image as rp_image.";
+
+	unique_ptr<rp_image> img(decodeBC7(ImageDecoder::fromBC7_cpp));
+	ASSERT_TRUE(img != nullptr) << "fromBC7_cpp() failed.";
+	ASSERT_NO_FATAL_FAILURE(Compare_RpImage(img_png.get(), img.get()));
+
+#ifdef IMAGEDECODER_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		img.reset(decodeBC7(ImageDecoder::fromBC7_sse2));
+		ASSERT_TRUE(img != nullptr) << "fromBC7_sse2() failed.";
+		ASSERT_NO_FATAL_FAILURE(Compare_RpImage(img_png.get(), img.get()));
+	}
+#endif /* IMAGEDECODER_HAS_SSE2 */
+
+#ifdef IMAGEDECODER_HAS_SSSE3
+	if (RP_CPU_HasSSSE3()) {
+		img.reset(decodeBC7(ImageDecoder::fromBC7_ssse3));
+		ASSERT_TRUE(img != nullptr) << "fromBC7_ssse3() failed.";
+		ASSERT_NO_FATAL_FAILURE(Compare_RpImage(img_png.get(), img.get()));
+	}
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+}
+
+/**
+ * Benchmark the standard BC7 decoder.
+ */
+TEST_P(ImageDecoderBC7Test, decodeCppBenchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(benchmarkBC7(ImageDecoder::fromBC7_cpp));
+}
+
+#ifdef IMAGEDECODER_HAS_SSE2
+/**
+ * Benchmark the SSE2-optimized BC7 decoder.
+ */
+TEST_P(ImageDecoderBC7Test, decodeSSE2Benchmark)
+{
+	if (!RP_CPU_HasSSE2()) {
+		fprintf(stderr, "*** SSE2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+	ASSERT_NO_FATAL_FAILURE(benchmarkBC7(ImageDecoder::fromBC7_sse2));
+}
+#endif /* IMAGEDECODER_HAS_SSE2 */
+
+#ifdef IMAGEDECODER_HAS_SSSE3
+/**
+ * Benchmark the SSSE3-optimized BC7 decoder.
+ */
+TEST_P(ImageDecoderBC7Test, decodeSSSE3Benchmark)
+{
+	if (!RP_CPU_HasSSSE3()) {
+		fprintf(stderr, "*** SSSE3 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+	ASSERT_NO_FATAL_FAILURE(benchmarkBC7(ImageDecoder::fromBC7_ssse3));
+}
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+
+/**
+ * Benchmark the default BC7 decoder with 1 thread.
+ * This includes the thread pool overhead, so it can be
+ * compared to the other multithreaded benchmarks.
+ */
+TEST_P(ImageDecoderBC7Test, decodeMT1Benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(benchmarkBC7_MT(1));
+}
+
+/**
+ * Benchmark the default BC7 decoder with 2 threads.
+ */
+TEST_P(ImageDecoderBC7Test, decodeMT2Benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(benchmarkBC7_MT(2));
+}
+
+/**
+ * Benchmark the default BC7 decoder with 4 threads.
+ */
+TEST_P(ImageDecoderBC7Test, decodeMT4Benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(benchmarkBC7_MT(4));
+}
+
+/**
+ * Benchmark the default BC7 decoder with one thread per CPU.
+ */
+TEST_P(ImageDecoderBC7Test, decodeMTAllBenchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(benchmarkBC7_MT(0));
+}
+
+/**
+ * Mipmap selection tests for thumbnailing.
+ * The test file must be a 64x64 texture with a full mipmap chain.
+ */
+class ImageDecoderMipmapTest : public ImageDecoderTest
+{ };
+
+/**
+ * Check that imageForSize() decodes the smallest sufficient mipmap.
+ */
+TEST_P(ImageDecoderMipmapTest, imageForSizeTest)
+{
+	m_f_dds = new RpMemFile(m_dds_buf.data(), m_dds_buf.size());
+	ASSERT_TRUE(m_f_dds->isOpen()) << "Could not create RpMemFile for the texture.";
+	m_romData = new RpTextureWrapper(m_f_dds);
+	ASSERT_TRUE(m_romData->isValid()) << "Could not load the texture.";
+
+	// Requested size, and the expected mipmap size.
+	static const struct {
+		int reqSize;
+		int mipSize;
+	} sizes[] = {
+		{256, 64}, {64, 64}, {63, 64}, {32, 32},
+		{20, 32}, {16, 16}, {2, 2}, {1, 1},
+	};
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(sizes); i++) {
+		int fullSize[2] = {0, 0};
+		const rp_image *const img = m_romData->imageForSize(
+			RomData::IMG_INT_IMAGE, sizes[i].reqSize, fullSize);
+		ASSERT_TRUE(img != nullptr) << "reqSize == " << sizes[i].reqSize;
+		EXPECT_EQ(sizes[i].mipSize, img->width()) << "reqSize == " << sizes[i].reqSize;
+		EXPECT_EQ(sizes[i].mipSize, img->height()) << "reqSize == " << sizes[i].reqSize;
+		EXPECT_EQ(64, fullSize[0]) << "reqSize == " << sizes[i].reqSize;
+		EXPECT_EQ(64, fullSize[1]) << "reqSize == " << sizes[i].reqSize;
+	}
+
+	// The full image must still match the reference image.
+	unique_IRpFile<RpMemFile> f_png(new RpMemFile(m_png_buf.data(), m_png_buf.size()));
+	ASSERT_TRUE(f_png->isOpen()) << "Could not create RpMemFile for the PNG image.";
+	unique_ptr<rp_image> img_png(RpImageLoader::load(f_png.get()));
+	ASSERT_TRUE(img_png != nullptr) << "Could not load the PNG image as rp_image.";
+	const rp_image *const img_full = m_romData->image(RomData::IMG_INT_IMAGE);
+	ASSERT_TRUE(img_full != nullptr) << "Could not load the full image.";
+	ASSERT_NO_FATAL_FAILURE(Compare_RpImage(img_png.get(), img_full));
+}
+
+/**
+ * Mipmap pixel tests for thumbnailing.
+ * The test file must be a 64x64 ARGB8888 texture with a full mipmap chain,
+ * where pixel (x, y) of mipmap n is ARGB(0xFF, (x*4) << n, (y*4) << n, n*0x20 + 0x10).
+ */
+class ImageDecoderMipmapPixelTest : public ImageDecoderMipmapTest
+{ };
+
+/**
+ * Check that imageForSize() decodes the correct mipmap data.
+ */
+TEST_P(ImageDecoderMipmapPixelTest, imageForSizePixelTest)
+{
+	m_f_dds = new RpMemFile(m_dds_buf.data(), m_dds_buf.size());
+	ASSERT_TRUE(m_f_dds->isOpen()) << "Could not create RpMemFile for the texture.";
+	m_romData = new RpTextureWrapper(m_f_dds);
+	ASSERT_TRUE(m_romData->isValid()) << "Could not load the texture.";
+
+	// Request the smallest mipmaps first so the
+	// larger mipmaps haven't been decoded yet.
+	for (int mip = 6; mip >= 0; mip--) {
+		const int mipSize = (64 >> mip);
+		int fullSize[2] = {0, 0};
+		const rp_image *const img = m_romData->imageForSize(
+			RomData::IMG_INT_IMAGE, mipSize, fullSize);
+		ASSERT_TRUE(img != nullptr) << "mip == " << mip;
+		ASSERT_EQ(rp_image::FORMAT_ARGB32, img->format()) << "mip == " << mip;
+		ASSERT_EQ(mipSize, img->width()) << "mip == " << mip;
+		ASSERT_EQ(mipSize, img->height()) << "mip == " << mip;
+		EXPECT_EQ(64, fullSize[0]) << "mip == " << mip;
+		EXPECT_EQ(64, fullSize[1]) << "mip == " << mip;
+
+		for (int y = 0; y < mipSize; y++) {
+			const uint32_t *const px = static_cast<const uint32_t*>(img->scanLine(y));
+			for (int x = 0; x < mipSize; x++) {
+				const uint32_t expected = 0xFF000000U |
+					(static_cast<uint32_t>((x * 4) << mip) << 16) |
+					(static_cast<uint32_t>((y * 4) << mip) << 8) |
+					static_cast<uint32_t>(mip * 0x20 + 0x10);
+				ASSERT_EQ(expected, px[x]) << "mip == " << mip <<
+					", x == " << x << ", y == " << y;
+			}
+		}
+	}
+}
+
 /**
  * Test case suffix generator.
  * @param info Test parameter information.
@@ -914,6 +1238,28 @@ INSTANTIATE_TEST_CASE_P(KTX, ImageDecoderTest,
 
 	, ImageDecoderTest::test_case_suffix_generator);
 
+// KTX mipmap tests.
+INSTANTIATE_TEST_CASE_P(KTX, ImageDecoderMipmapTest,
+	::testing::Values(
+		ImageDecoderTest_mode(
+			"KTX/rgb-mipmap-reference.ktx.gz",
+			"KTX2/rgb-mipmap-reference-u.png"))
+	, ImageDecoderTest::test_case_suffix_generator);
+
+// DDS mipmap tests.
+INSTANTIATE_TEST_CASE_P(DDS, ImageDecoderMipmapTest,
+	::testing::Values(
+		ImageDecoderTest_mode(
+			"ARGB/ARGB8888-mipmap.dds.gz",
+			"ARGB/ARGB8888-mipmap.png"))
+	, ImageDecoderTest::test_case_suffix_generator);
+INSTANTIATE_TEST_CASE_P(DDS, ImageDecoderMipmapPixelTest,
+	::testing::Values(
+		ImageDecoderTest_mode(
+			"ARGB/ARGB8888-mipmap.dds.gz",
+			"ARGB/ARGB8888-mipmap.png"))
+	, ImageDecoderTest::test_case_suffix_generator);
+
 // KTX2 tests.
 #define KTX2_IMAGE_TEST(file) ImageDecoderTest_mode( \
 			"KTX2/" file ".ktx2.gz", \
@@ -1079,33 +1425,40 @@ INSTANTIATE_TEST_CASE_P(TCtest_PVRTC, ImageDecoderTest,
 
 
 // BC7 tests.
+static const ImageDecoderTest_mode bc7_modes[] = {
+	ImageDecoderTest_mode(
+		"BC7/w5_grass200_abd_a.dds.gz",
+		"BC7/w5_grass200_abd_a.png"),
+	ImageDecoderTest_mode(
+		"BC7/w5_grass201_abd.dds.gz",
+		"BC7/w5_grass201_abd.png"),
+	ImageDecoderTest_mode(
+		"BC7/w5_grass206_abd.dds.gz",
+		"BC7/w5_grass206_abd.png"),
+	ImageDecoderTest_mode(
+		"BC7/w5_rock805_abd.dds.gz",
+		"BC7/w5_rock805_abd.png"),
+	ImageDecoderTest_mode(
+		"BC7/w5_rock805_nrm.dds.gz",
+		"BC7/w5_rock805_nrm.png"),
+	ImageDecoderTest_mode(
+		"BC7/w5_rope801_prm.dds",
+		"BC7/w5_rope801_prm.png"),
+	ImageDecoderTest_mode(
+		"BC7/w5_sand504_abd_a.dds.gz",
+		"BC7/w5_sand504_abd_a.png"),
+	ImageDecoderTest_mode(
+		"BC7/w5_wood503_prm.dds.gz",
+		"BC7/w5_wood503_prm.png"),
+};
+
 INSTANTIATE_TEST_CASE_P(BC7, ImageDecoderTest,
-	::testing::Values(
-		ImageDecoderTest_mode(
-			"BC7/w5_grass200_abd_a.dds.gz",
-			"BC7/w5_grass200_abd_a.png"),
-		ImageDecoderTest_mode(
-			"BC7/w5_grass201_abd.dds.gz",
-			"BC7/w5_grass201_abd.png"),
-		ImageDecoderTest_mode(
-			"BC7/w5_grass206_abd.dds.gz",
-			"BC7/w5_grass206_abd.png"),
-		ImageDecoderTest_mode(
-			"BC7/w5_rock805_abd.dds.gz",
-			"BC7/w5_rock805_abd.png"),
-		ImageDecoderTest_mode(
-			"BC7/w5_rock805_nrm.dds.gz",
-			"BC7/w5_rock805_nrm.png"),
-		ImageDecoderTest_mode(
-			"BC7/w5_rope801_prm.dds",
-			"BC7/w5_rope801_prm.png"),
-		ImageDecoderTest_mode(
-			"BC7/w5_sand504_abd_a.dds.gz",
-			"BC7/w5_sand504_abd_a.png"),
-		ImageDecoderTest_mode(
-			"BC7/w5_wood503_prm.dds.gz",
-			"BC7/w5_wood503_prm.png"))
-	, ImageDecoderTest::test_case_suffix_generator);
+	::testing::ValuesIn(bc7_modes),
+	ImageDecoderTest::test_case_suffix_generator);
+
+INSTANTIATE_TEST_CASE_P(BC7, ImageDecoderBC7Test,
+	::testing::ValuesIn(bc7_modes),
+	ImageDecoderTest::test_case_suffix_generator);
 
 // SMDH tests.
 // From *New* Nintendo 3DS 9.2.0-20J.
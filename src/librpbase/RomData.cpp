@@ -20,6 +20,7 @@ using std::string;
 using std::vector;
 
 // librpfile, librptexture
+#include "librptexture/img/rp_image.hpp"
 using LibRpFile::IRpFile;
 using LibRpTexture::rp_image;
 
@@ -787,6 +788,34 @@ const rp_image *RomData::image(ImageType imageType) const
 	return (ret == 0 ? img : nullptr);
 }
 
+/**
+ * Get an internal image from the ROM for a thumbnail.
+ *
+ * Subclasses that can decode a reduced-size version
+ * of an image, e.g. a texture mipmap, may return an
+ * image smaller than image(), as long as its largest
+ * dimension is at least reqSize. The default
+ * implementation returns image().
+ *
+ * NOTE: The rp_image is owned by this object.
+ * Do NOT delete this object until you're done using this rp_image.
+ *
+ * @param imageType	[in] Image type to load.
+ * @param reqSize	[in] Requested thumbnail size. (0 for the full image)
+ * @param pFullSize	[out,opt] Dimensions of the full image: [w, h]
+ * @return Internal image, or nullptr if the ROM doesn't have one.
+ */
+const rp_image *RomData::imageForSize(ImageType imageType, int reqSize, int pFullSize[2]) const
+{
+	RP_UNUSED(reqSize);
+	const rp_image *const img = image(imageType);
+	if (img && pFullSize) {
+		pFullSize[0] = img->width();
+		pFullSize[1] = img->height();
+	}
+	return img;
+}
+
 /**
  * Get a list of URLs for an external image type.
  *
@@ -448,6 +448,25 @@ class RomData
 		 */
 		const LibRpTexture::rp_image *image(ImageType imageType) const;
 
+		/**
+		 * Get an internal image from the ROM for a thumbnail.
+		 *
+		 * Subclasses that can decode a reduced-size version
+		 * of an image, e.g. a texture mipmap, may return an
+		 * image smaller than image(), as long as its largest
+		 * dimension is at least reqSize. The default
+		 * implementation returns image().
+		 *
+		 * NOTE: The rp_image is owned by this object.
+		 * Do NOT delete this object until you're done using this rp_image.
+		 *
+		 * @param imageType	[in] Image type to load.
+		 * @param reqSize	[in] Requested thumbnail size. (0 for the full image)
+		 * @param pFullSize	[out,opt] Dimensions of the full image: [w, h]
+		 * @return Internal image, or nullptr if the ROM doesn't have one.
+		 */
+		virtual const LibRpTexture::rp_image *imageForSize(ImageType imageType, int reqSize, int pFullSize[2]) const;
+
 		/**
 		 * External URLs for a media type.
 		 * Includes URL and "cache key" for local caching,
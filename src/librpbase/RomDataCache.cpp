@@ -0,0 +1,1323 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * RomDataCache.cpp: On-disk cache for RomFields and RomMetaData.          *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "config.librpbase.h"
+#include "config.version.h"
+
+#include "RomDataCache.hpp"
+#include "RomFields.hpp"
+#include "RomMetaData.hpp"
+#include "SystemRegion.hpp"
+#ifdef ENABLE_DECRYPTION
+# include "crypto/KeyManager.hpp"
+#endif /* ENABLE_DECRYPTION */
+
+// libcachecommon
+#include "libcachecommon/CacheKeys.hpp"
+
+// librpfile
+#include "librpfile/FileSystem.hpp"
+using namespace LibRpFile;
+
+// zlib
+#include <zlib.h>
+
+// OS-specific includes.
+#ifdef _WIN32
+# include "libwin32common/RpWin32_sdk.h"
+# include "libwin32common/w32time.h"
+# include "TextFuncs_wchar.hpp"
+#else /* !_WIN32 */
+# include <dirent.h>
+# include <locale.h>
+# include <sys/stat.h>
+#endif /* _WIN32 */
+
+// C++ STL classes.
+using std::string;
+using std::vector;
+
+namespace LibRpBase {
+
+/** Cache entry format **/
+// All values are little-endian.
+// Strings are stored as a uint32_t length, followed by the
+// UTF-8 string data. (not NULL-terminated)
+//
+// Header: (40 bytes)
+// - 0x00: char[4]  magic ("RPDC")
+// - 0x04: uint32_t format version (RDC_VERSION)
+// - 0x08: uint64_t ROM file size
+// - 0x10: int64_t  ROM file mtime
+// - 0x18: uint32_t CRC32 of the first HEADER_HASH_SIZE bytes of the ROM file
+// - 0x1C: uint32_t sections (RDC_SECTION_*)
+// - 0x20: uint32_t payload size
+// - 0x24: uint32_t CRC32 of the payload
+//
+// Payload:
+// - string:  ROM filename (checked to handle cache key collisions)
+// - string:  rom-properties version
+// - string:  locale tag (see RomDataCachePrivate::localeTag())
+// - int64_t: keys.conf mtime (0 if not available)
+// - RomFields, if RDC_SECTION_FIELDS is set.
+// - RomMetaData, if RDC_SECTION_METADATA is set.
+
+class RomDataCachePrivate
+{
+	private:
+		// RomDataCachePrivate is a static class.
+		RomDataCachePrivate();
+		~RomDataCachePrivate();
+		RP_DISABLE_COPY(RomDataCachePrivate)
+
+	public:
+		// Cache entry magic and format version.
+		// Increment RDC_VERSION if the format changes.
+		static const char RDC_MAGIC[4];
+		static const uint32_t RDC_VERSION = 1;
+		static const unsigned int HEADER_SIZE = 40;
+
+		// Number of bytes of the ROM file to hash for RDC_VERIFY_HEADER.
+		static const unsigned int HEADER_HASH_SIZE = 4096;
+
+		// Sections.
+		enum Sections {
+			RDC_SECTION_FIELDS	= (1U << 0),
+			RDC_SECTION_METADATA	= (1U << 1),
+		};
+
+		/**
+		 * Cache entry writer.
+		 */
+		class Writer {
+			public:
+				explicit Writer(ao::uvector<uint8_t> &buf)
+					: buf(buf) { }
+
+			private:
+				ao::uvector<uint8_t> &buf;
+
+			public:
+				inline void u8(uint8_t val)
+				{
+					buf.push_back(val);
+				}
+
+				inline void u16(uint16_t val)
+				{
+					buf.push_back(val & 0xFF);
+					buf.push_back(val >> 8);
+				}
+
+				inline void u32(uint32_t val)
+				{
+					for (unsigned int i = 0; i < 4; i++, val >>= 8) {
+						buf.push_back(val & 0xFF);
+					}
+				}
+
+				inline void u64(uint64_t val)
+				{
+					for (unsigned int i = 0; i < 8; i++, val >>= 8) {
+						buf.push_back(val & 0xFF);
+					}
+				}
+
+				inline void str(const string &str)
+				{
+					u32(static_cast<uint32_t>(str.size()));
+					const uint8_t *const p = reinterpret_cast<const uint8_t*>(str.data());
+					buf.push_back(p, p + str.size());
+				}
+
+				void strVec(const vector<string> &vec)
+				{
+					u32(static_cast<uint32_t>(vec.size()));
+					for (const string &s : vec) {
+						str(s);
+					}
+				}
+
+				void listData(const RomFields::ListData_t &list_data)
+				{
+					u32(static_cast<uint32_t>(list_data.size()));
+					for (const vector<string> &row : list_data) {
+						strVec(row);
+					}
+				}
+		};
+
+		/**
+		 * Cache entry reader.
+		 * If the buffer is overrun, ok is set to false,
+		 * and all subsequent reads return 0 or empty.
+		 */
+		class Reader {
+			public:
+				Reader(const uint8_t *p, size_t size)
+					: p(p), end(p + size), ok(true) { }
+
+			private:
+				const uint8_t *p;
+				const uint8_t *const end;
+			public:
+				bool ok;
+
+			private:
+				/**
+				 * Check if the specified number of bytes can be read.
+				 * @param size Number of bytes.
+				 * @return True if the bytes can be read; false if not.
+				 */
+				inline bool check(size_t size)
+				{
+					if (!ok || static_cast<size_t>(end - p) < size) {
+						ok = false;
+						return false;
+					}
+					return true;
+				}
+
+			public:
+				inline uint8_t u8(void)
+				{
+					if (!check(1))
+						return 0;
+					return *p++;
+				}
+
+				inline uint16_t u16(void)
+				{
+					if (!check(2))
+						return 0;
+					const uint16_t val = p[0] | (p[1] << 8);
+					p += 2;
+					return val;
+				}
+
+				inline uint32_t u32(void)
+				{
+					if (!check(4))
+						return 0;
+					const uint32_t val = p[0] | (p[1] << 8) | (p[2] << 16) |
+						(static_cast<uint32_t>(p[3]) << 24);
+					p += 4;
+					return val;
+				}
+
+				inline uint64_t u64(void)
+				{
+					const uint64_t lo = u32();
+					const uint64_t hi = u32();
+					return lo | (hi << 32);
+				}
+
+				/**
+				 * Read an element count.
+				 * Each element takes up at least minSize bytes,
+				 * so counts that can't possibly fit in the remaining
+				 * data are rejected before anything is allocated.
+				 * @param minSize Minimum size of each element.
+				 * @return Element count.
+				 */
+				inline uint32_t count(size_t minSize)
+				{
+					const uint32_t n = u32();
+					if (!ok || static_cast<size_t>(end - p) / minSize < n) {
+						ok = false;
+						return 0;
+					}
+					return n;
+				}
+
+				string str(void)
+				{
+					const uint32_t len = u32();
+					if (!check(len))
+						return string();
+					string s(reinterpret_cast<const char*>(p), len);
+					p += len;
+					return s;
+				}
+
+				vector<string> *strVec(void)
+				{
+					const uint32_t n = count(4);
+					vector<string> *const vec = new vector<string>();
+					vec->reserve(n);
+					for (uint32_t i = 0; i < n && ok; i++) {
+						vec->emplace_back(str());
+					}
+					return vec;
+				}
+
+				RomFields::ListData_t *listData(void)
+				{
+					const uint32_t n = count(4);
+					RomFields::ListData_t *const list_data = new RomFields::ListData_t();
+					list_data->resize(n);
+					for (uint32_t i = 0; i < n && ok; i++) {
+						vector<string> *const row = strVec();
+						(*list_data)[i].swap(*row);
+						delete row;
+					}
+					return list_data;
+				}
+		};
+
+	public:
+		/**
+		 * Get the locale tag.
+		 * Field names and some field values are localized
+		 * when the ROM is parsed, so entries stored using
+		 * a different language must not be used.
+		 * @return Locale tag.
+		 */
+		static string localeTag(void);
+
+		/**
+		 * Get the keys.conf mtime.
+		 * Adding keys may change the fields, e.g. for encrypted
+		 * disc images, so entries stored with an older keys.conf
+		 * must not be used.
+		 * @return keys.conf mtime, or 0 if not available.
+		 */
+		static int64_t keysMtime(void);
+
+		/**
+		 * Calculate the CRC32 of the beginning of a ROM file.
+		 * @param filename	[in] ROM filename.
+		 * @param pCrc		[out] CRC32.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int headerCrc(const char *filename, uint32_t *pCrc);
+
+		/**
+		 * Does a RomFields object have any fields that can't be cached?
+		 * @param fields RomFields.
+		 * @return True if the RomFields can be cached; false if not.
+		 */
+		static bool canCacheFields(const RomFields *fields);
+
+		/**
+		 * Serialize a RomFields object.
+		 * @param w Writer.
+		 * @param fields RomFields.
+		 */
+		static void writeFields(Writer &w, const RomFields *fields);
+
+		/**
+		 * Deserialize a RomFields object.
+		 * @param r Reader.
+		 * @param fields RomFields.
+		 * @return True on success; false if the data is invalid.
+		 */
+		static bool readFields(Reader &r, RomFields *fields);
+
+		/**
+		 * Serialize a RomMetaData object.
+		 * @param w Writer.
+		 * @param metaData RomMetaData.
+		 */
+		static void writeMetaData(Writer &w, const RomMetaData *metaData);
+
+		/**
+		 * Deserialize a RomMetaData object.
+		 * @param r Reader.
+		 * @param metaData RomMetaData.
+		 * @return True on success; false if the data is invalid.
+		 */
+		static bool readMetaData(Reader &r, RomMetaData *metaData);
+
+	public:
+		// Minimum time between automatic prune() calls, in seconds.
+		static const time_t PRUNE_INTERVAL = 24*60*60;
+
+		// Temporary files older than this are left over from
+		// interrupted writes and can be removed, in seconds.
+		static const time_t TMP_FILE_AGE = 60*60;
+
+		/**
+		 * Cache directory entry.
+		 */
+		struct DirEntry {
+			string filename;	// Full path
+			uint64_t size;		// File size
+			time_t mtime;		// Modification time
+		};
+
+		/**
+		 * Get the romdata/ cache directory.
+		 * @return Cache directory, with a trailing separator, or empty string on error.
+		 */
+		static string cacheDirectory(void);
+
+		/**
+		 * List the regular files in a directory.
+		 * @param dir		[in] Directory, with a trailing separator.
+		 * @param entries	[out] Directory entries.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int listFiles(const string &dir, vector<DirEntry> &entries);
+
+		/**
+		 * Is a cache entry stale?
+		 * An entry is stale if its ROM file no longer exists,
+		 * if the ROM file has changed, or if the entry is invalid.
+		 * @param cacheFilename Cache entry filename.
+		 * @return True if the entry is stale; false if not.
+		 */
+		static bool isStale(const string &cacheFilename);
+
+		/**
+		 * Prune the cache if it hasn't been pruned recently.
+		 * A stamp file in the cache directory records the last prune.
+		 */
+		static void autoPrune(void);
+};
+
+/** RomDataCachePrivate **/
+
+const char RomDataCachePrivate::RDC_MAGIC[4] = {'R','P','D','C'};
+
+/**
+ * Get the locale tag.
+ * Field names and some field values are localized
+ * when the ROM is parsed, so entries stored using
+ * a different language must not be used.
+ * @return Locale tag.
+ */
+string RomDataCachePrivate::localeTag(void)
+{
+	// SystemRegion handles user overrides, e.g. rpcli's "-l" option.
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%08X:%08X",
+		SystemRegion::getLanguageCode(), SystemRegion::getCountryCode());
+	string tag(buf);
+
+#ifndef _WIN32
+	// gettext also checks $LANGUAGE before LC_MESSAGES.
+	const char *const language = getenv("LANGUAGE");
+	if (language) {
+		tag += ':';
+		tag += language;
+	}
+	const char *const lc_messages = setlocale(LC_MESSAGES, nullptr);
+	if (lc_messages) {
+		tag += ':';
+		tag += lc_messages;
+	}
+#endif /* !_WIN32 */
+	return tag;
+}
+
+/**
+ * Get the keys.conf mtime.
+ * Adding keys may change the fields, e.g. for encrypted
+ * disc images, so entries stored with an older keys.conf
+ * must not be used.
+ * @return keys.conf mtime, or 0 if not available.
+ */
+int64_t RomDataCachePrivate::keysMtime(void)
+{
+#ifdef ENABLE_DECRYPTION
+	const char *const keys_filename = KeyManager::instance()->filename();
+	if (!keys_filename)
+		return 0;
+
+	time_t mtime;
+	if (FileSystem::get_mtime(keys_filename, &mtime) != 0)
+		return 0;
+	return static_cast<int64_t>(mtime);
+#else /* !ENABLE_DECRYPTION */
+	return 0;
+#endif /* ENABLE_DECRYPTION */
+}
+
+/**
+ * Calculate the CRC32 of the beginning of a ROM file.
+ * @param filename	[in] ROM filename.
+ * @param pCrc		[out] CRC32.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomDataCachePrivate::headerCrc(const char *filename, uint32_t *pCrc)
+{
+	unique_IRpFile<RpFile> file(new RpFile(filename, RpFile::FM_OPEN_READ));
+	if (!file->isOpen()) {
+		const int err = file->lastError();
+		return (err != 0 ? -err : -EIO);
+	}
+
+	uint8_t buf[HEADER_HASH_SIZE];
+	const size_t size = file->read(buf, sizeof(buf));
+	*pCrc = crc32(0, buf, static_cast<uInt>(size));
+	return 0;
+}
+
+/**
+ * Does a RomFields object have any fields that can't be cached?
+ * @param fields RomFields.
+ * @return True if the RomFields can be cached; false if not.
+ */
+bool RomDataCachePrivate::canCacheFields(const RomFields *fields)
+{
+	// Icons are rp_image objects, which aren't serialized.
+	return std::none_of(fields->cbegin(), fields->cend(),
+		[](const RomFields::Field &field) {
+			return field.isValid && field.type == RomFields::RFT_LISTDATA &&
+				(field.desc.list_data.flags & RomFields::RFT_LISTDATA_ICONS);
+		}
+	);
+}
+
+/**
+ * Serialize a RomFields object.
+ * @param w Writer.
+ * @param fields RomFields.
+ */
+void RomDataCachePrivate::writeFields(Writer &w, const RomFields *fields)
+{
+	w.u32(fields->defaultLanguageCode());
+
+	// Tab names.
+	const int tabCount = fields->tabCount();
+	w.u32(static_cast<uint32_t>(tabCount));
+	for (int i = 0; i < tabCount; i++) {
+		const char *const name = fields->tabName(i);
+		w.str(name ? name : "");
+	}
+
+	// Fields.
+	// NOTE: Invalid fields are skipped.
+	const uint32_t count = static_cast<uint32_t>(
+		std::count_if(fields->cbegin(), fields->cend(),
+			[](const RomFields::Field &field) { return field.isValid; }));
+	w.u32(count);
+
+	for (auto iter = fields->cbegin(); iter != fields->cend(); ++iter) {
+		const RomFields::Field &field = *iter;
+		if (!field.isValid)
+			continue;
+
+		w.u8(field.type);
+		w.u8(field.tabIdx);
+		w.str(field.name);
+
+		switch (field.type) {
+			case RomFields::RFT_STRING:
+				w.u32(field.desc.flags);
+				w.u8(field.data.str != nullptr);
+				if (field.data.str) {
+					w.str(*field.data.str);
+				}
+				break;
+
+			case RomFields::RFT_BITFIELD:
+				w.u32(static_cast<uint32_t>(field.desc.bitfield.elemsPerRow));
+				w.u32(field.data.bitfield);
+				w.strVec(*field.desc.bitfield.names);
+				break;
+
+			case RomFields::RFT_LISTDATA: {
+				const auto &list_data = field.desc.list_data;
+				w.u32(list_data.flags);
+				w.u32(static_cast<uint32_t>(list_data.rows_visible));
+				w.u32(list_data.alignment.headers);
+				w.u32(list_data.alignment.data);
+				w.u8(list_data.names != nullptr);
+				if (list_data.names) {
+					w.strVec(*list_data.names);
+				}
+
+				if (list_data.flags & RomFields::RFT_LISTDATA_MULTI) {
+					const RomFields::ListDataMultiMap_t *const multi = field.data.list_data.data.multi;
+					w.u8(multi != nullptr);
+					if (multi) {
+						w.u32(static_cast<uint32_t>(multi->size()));
+						for (const auto &p : *multi) {
+							w.u32(p.first);
+							w.listData(p.second);
+						}
+					}
+				} else {
+					const RomFields::ListData_t *const single = field.data.list_data.data.single;
+					w.u8(single != nullptr);
+					if (single) {
+						w.listData(*single);
+					}
+				}
+
+				if (list_data.flags & RomFields::RFT_LISTDATA_CHECKBOXES) {
+					w.u32(field.data.list_data.mxd.checkboxes);
+				}
+				break;
+			}
+
+			case RomFields::RFT_DATETIME:
+				w.u32(field.desc.flags);
+				w.u64(static_cast<uint64_t>(static_cast<int64_t>(field.data.date_time)));
+				break;
+
+			case RomFields::RFT_AGE_RATINGS:
+				for (uint16_t rating : *field.data.age_ratings) {
+					w.u16(rating);
+				}
+				break;
+
+			case RomFields::RFT_DIMENSIONS:
+				for (int dim : field.data.dimensions) {
+					w.u32(static_cast<uint32_t>(dim));
+				}
+				break;
+
+			case RomFields::RFT_STRING_MULTI: {
+				const RomFields::StringMultiMap_t *const str_multi = field.data.str_multi;
+				w.u32(field.desc.flags);
+				w.u8(str_multi != nullptr);
+				if (str_multi) {
+					w.u32(static_cast<uint32_t>(str_multi->size()));
+					for (const auto &p : *str_multi) {
+						w.u32(p.first);
+						w.str(p.second);
+					}
+				}
+				break;
+			}
+
+			default:
+				// ERROR!
+				assert(!"Unsupported RomFields::RomFieldsType.");
+				break;
+		}
+	}
+}
+
+/**
+ * Deserialize a RomFields object.
+ * @param r Reader.
+ * @param fields RomFields.
+ * @return True on success; false if the data is invalid.
+ */
+bool RomDataCachePrivate::readFields(Reader &r, RomFields *fields)
+{
+	const uint32_t def_lc = r.u32();
+
+	// Tab names.
+	// NOTE: Tab indexes are uint8_t.
+	const uint32_t tabCount = r.count(4);
+	if (!r.ok || tabCount > 256)
+		return false;
+	if (tabCount > 1) {
+		fields->reserveTabs(static_cast<int>(tabCount));
+	}
+	for (uint32_t i = 0; i < tabCount; i++) {
+		const string name = r.str();
+		if (!name.empty()) {
+			fields->setTabName(static_cast<int>(i), name.c_str());
+		}
+	}
+
+	// Fields.
+	const uint32_t count = r.count(6);
+	if (!r.ok)
+		return false;
+	fields->reserve(static_cast<int>(count));
+
+	for (uint32_t i = 0; i < count && r.ok; i++) {
+		const uint8_t type = r.u8();
+		const uint8_t tabIdx = r.u8();
+		const string name = r.str();
+		if (!r.ok || tabIdx >= tabCount)
+			return false;
+		fields->setTabIndex(tabIdx);
+
+		switch (type) {
+			case RomFields::RFT_STRING: {
+				const unsigned int flags = r.u32();
+				if (r.u8()) {
+					fields->addField_string(name.c_str(), r.str(), flags);
+				} else {
+					fields->addField_string(name.c_str(), nullptr, flags);
+				}
+				break;
+			}
+
+			case RomFields::RFT_BITFIELD: {
+				const int elemsPerRow = static_cast<int>(r.u32());
+				const uint32_t bitfield = r.u32();
+				fields->addField_bitfield(name.c_str(), r.strVec(), elemsPerRow, bitfield);
+				break;
+			}
+
+			case RomFields::RFT_LISTDATA: {
+				RomFields::AFLD_PARAMS params(r.u32(), 0);
+				params.rows_visible = static_cast<int>(r.u32());
+				params.alignment.headers = r.u32();
+				params.alignment.data = r.u32();
+				if (r.u8()) {
+					params.headers = r.strVec();
+				}
+
+				if (params.flags & RomFields::RFT_LISTDATA_ICONS) {
+					// Icons aren't cached.
+					r.ok = false;
+				} else if (params.flags & RomFields::RFT_LISTDATA_MULTI) {
+					params.def_lc = def_lc;
+					if (r.u8()) {
+						RomFields::ListDataMultiMap_t *const multi = new RomFields::ListDataMultiMap_t();
+						const uint32_t n = r.count(8);
+						for (uint32_t j = 0; j < n && r.ok; j++) {
+							const uint32_t lc = r.u32();
+							RomFields::ListData_t *const list_data = r.listData();
+							(*multi)[lc].swap(*list_data);
+							delete list_data;
+						}
+						params.data.multi = multi;
+					}
+				} else {
+					if (r.u8()) {
+						params.data.single = r.listData();
+					}
+				}
+
+				if (params.flags & RomFields::RFT_LISTDATA_CHECKBOXES) {
+					params.mxd.checkboxes = r.u32();
+				}
+
+				// NOTE: The field is added even if the data is invalid
+				// so RomFields takes ownership of the allocated data.
+				fields->addField_listData(name.c_str(), &params);
+				break;
+			}
+
+			case RomFields::RFT_DATETIME: {
+				const unsigned int flags = r.u32();
+				const time_t date_time = static_cast<time_t>(static_cast<int64_t>(r.u64()));
+				fields->addField_dateTime(name.c_str(), date_time, flags);
+				break;
+			}
+
+			case RomFields::RFT_AGE_RATINGS: {
+				RomFields::age_ratings_t age_ratings;
+				for (uint16_t &rating : age_ratings) {
+					rating = r.u16();
+				}
+				fields->addField_ageRatings(name.c_str(), age_ratings);
+				break;
+			}
+
+			case RomFields::RFT_DIMENSIONS: {
+				int dimensions[3];
+				for (int &dim : dimensions) {
+					dim = static_cast<int>(r.u32());
+				}
+				fields->addField_dimensions(name.c_str(),
+					dimensions[0], dimensions[1], dimensions[2]);
+				break;
+			}
+
+			case RomFields::RFT_STRING_MULTI: {
+				const unsigned int flags = r.u32();
+				RomFields::StringMultiMap_t *str_multi = nullptr;
+				if (r.u8()) {
+					str_multi = new RomFields::StringMultiMap_t();
+					const uint32_t n = r.count(8);
+					for (uint32_t j = 0; j < n && r.ok; j++) {
+						const uint32_t lc = r.u32();
+						(*str_multi)[lc] = r.str();
+					}
+				}
+				fields->addField_string_multi(name.c_str(), str_multi, def_lc, flags);
+				break;
+			}
+
+			default:
+				// Unsupported field type.
+				return false;
+		}
+	}
+
+	return r.ok;
+}
+
+/**
+ * Serialize a RomMetaData object.
+ * @param w Writer.
+ * @param metaData RomMetaData.
+ */
+void RomDataCachePrivate::writeMetaData(Writer &w, const RomMetaData *metaData)
+{
+	const int count = metaData->count();
+	w.u32(static_cast<uint32_t>(count));
+	for (int i = 0; i < count; i++) {
+		const RomMetaData::MetaData *const prop = metaData->prop(i);
+		w.u8(static_cast<uint8_t>(prop->name));
+		w.u8(static_cast<uint8_t>(prop->type));
+
+		switch (prop->type) {
+			case PropertyType::Integer:
+				w.u32(static_cast<uint32_t>(prop->data.ivalue));
+				break;
+			case PropertyType::UnsignedInteger:
+				w.u32(prop->data.uvalue);
+				break;
+			case PropertyType::String:
+				w.str(prop->data.str ? *prop->data.str : string());
+				break;
+			case PropertyType::Timestamp:
+				w.u64(static_cast<uint64_t>(static_cast<int64_t>(prop->data.timestamp)));
+				break;
+			default:
+				// ERROR!
+				assert(!"Unsupported RomMetaData PropertyType.");
+				w.u32(0);
+				break;
+		}
+	}
+}
+
+/**
+ * Deserialize a RomMetaData object.
+ * @param r Reader.
+ * @param metaData RomMetaData.
+ * @return True on success; false if the data is invalid.
+ */
+bool RomDataCachePrivate::readMetaData(Reader &r, RomMetaData *metaData)
+{
+	const uint32_t count = r.count(6);
+	if (!r.ok)
+		return false;
+	metaData->reserve(static_cast<int>(count));
+
+	for (uint32_t i = 0; i < count && r.ok; i++) {
+		const uint8_t name = r.u8();
+		const uint8_t type = r.u8();
+		if (name > Property::LastProperty)
+			return false;
+		const Property::Property prop = static_cast<Property::Property>(name);
+
+		switch (type) {
+			case PropertyType::Integer:
+				metaData->addMetaData_integer(prop, static_cast<int>(r.u32()));
+				break;
+			case PropertyType::UnsignedInteger:
+				metaData->addMetaData_uint(prop, r.u32());
+				break;
+			case PropertyType::String:
+				metaData->addMetaData_string(prop, r.str());
+				break;
+			case PropertyType::Timestamp:
+				metaData->addMetaData_timestamp(prop,
+					static_cast<time_t>(static_cast<int64_t>(r.u64())));
+				break;
+			default:
+				// Unsupported property type.
+				return false;
+		}
+	}
+
+	return r.ok;
+}
+
+/**
+ * Get the romdata/ cache directory.
+ * @return Cache directory, with a trailing separator, or empty string on error.
+ */
+string RomDataCachePrivate::cacheDirectory(void)
+{
+	string dir = FileSystem::getCacheDirectory();
+	if (dir.empty())
+		return dir;
+	if (dir[dir.size()-1] != DIR_SEP_CHR) {
+		dir += DIR_SEP_CHR;
+	}
+	dir += "romdata";
+	dir += DIR_SEP_CHR;
+	return dir;
+}
+
+/**
+ * List the regular files in a directory.
+ * @param dir		[in] Directory, with a trailing separator.
+ * @param entries	[out] Directory entries.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomDataCachePrivate::listFiles(const string &dir, vector<DirEntry> &entries)
+{
+#ifdef _WIN32
+	WIN32_FIND_DATAW ffd;
+	HANDLE hFind = FindFirstFileW(U82W_s(dir + '*'), &ffd);
+	if (hFind == INVALID_HANDLE_VALUE) {
+		return -ENOENT;
+	}
+	do {
+		if (ffd.dwFileAttributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_REPARSE_POINT)) {
+			// Not a regular file.
+			continue;
+		}
+
+		DirEntry entry;
+		entry.filename = dir + W2U8(ffd.cFileName);
+		entry.size = (static_cast<uint64_t>(ffd.nFileSizeHigh) << 32) | ffd.nFileSizeLow;
+		entry.mtime = static_cast<time_t>(FileTimeToUnixTime(&ffd.ftLastWriteTime));
+		entries.push_back(std::move(entry));
+	} while (FindNextFileW(hFind, &ffd));
+	FindClose(hFind);
+#else /* !_WIN32 */
+	DIR *const pdir = opendir(dir.c_str());
+	if (!pdir) {
+		return -errno;
+	}
+	struct dirent *de;
+	while ((de = readdir(pdir)) != nullptr) {
+		DirEntry entry;
+		entry.filename = dir + de->d_name;
+
+		// NOTE: lstat() is used so symlinks are skipped.
+		struct stat sb;
+		if (lstat(entry.filename.c_str(), &sb) != 0 || !S_ISREG(sb.st_mode)) {
+			// Not a regular file.
+			continue;
+		}
+		entry.size = static_cast<uint64_t>(sb.st_size);
+		entry.mtime = sb.st_mtime;
+		entries.push_back(std::move(entry));
+	}
+	closedir(pdir);
+#endif /* _WIN32 */
+	return 0;
+}
+
+/**
+ * Is a cache entry stale?
+ * An entry is stale if its ROM file no longer exists,
+ * if the ROM file has changed, or if the entry is invalid.
+ * @param cacheFilename Cache entry filename.
+ * @return True if the entry is stale; false if not.
+ */
+bool RomDataCachePrivate::isStale(const string &cacheFilename)
+{
+	// Read the header and the ROM filename length.
+	unique_IRpFile<RpFile> file(new RpFile(cacheFilename, RpFile::FM_OPEN_READ));
+	if (!file->isOpen())
+		return true;
+	uint8_t hdrBuf[HEADER_SIZE + 4];
+	if (file->read(hdrBuf, sizeof(hdrBuf)) != sizeof(hdrBuf) ||
+	    memcmp(hdrBuf, RDC_MAGIC, sizeof(RDC_MAGIC)) != 0)
+	{
+		return true;
+	}
+
+	Reader hdr(hdrBuf, sizeof(hdrBuf));
+	hdr.u32();	// magic
+	if (hdr.u32() != RDC_VERSION)
+		return true;
+	const uint64_t romSize = hdr.u64();
+	const int64_t romMtime = static_cast<int64_t>(hdr.u64());
+	hdr.u32();	// header CRC32
+	hdr.u32();	// sections
+	hdr.u32();	// payload size
+	hdr.u32();	// payload CRC32
+	const uint32_t len = hdr.u32();
+	if (len == 0 || len > 4096)
+		return true;
+
+	// Read the ROM filename.
+	string filename(len, '\0');
+	if (file->read(&filename[0], len) != len)
+		return true;
+
+	// Check the ROM file.
+	off64_t fileSize;
+	time_t mtime;
+	if (FileSystem::get_file_size_and_mtime(filename, &fileSize, &mtime) != 0)
+		return true;
+	return (static_cast<uint64_t>(fileSize) != romSize ||
+	        static_cast<int64_t>(mtime) != romMtime);
+}
+
+/**
+ * Prune the cache if it hasn't been pruned recently.
+ * A stamp file in the cache directory records the last prune.
+ */
+void RomDataCachePrivate::autoPrune(void)
+{
+	const string dir = cacheDirectory();
+	if (dir.empty())
+		return;
+
+	const string stampFilename = dir + "prune.stamp";
+	const time_t now = time(nullptr);
+	time_t lastPrune;
+	if (FileSystem::get_mtime(stampFilename, &lastPrune) == 0 &&
+	    lastPrune <= now && now - lastPrune < PRUNE_INTERVAL)
+	{
+		// Pruned recently.
+		return;
+	}
+
+	// Update the stamp first so other processes
+	// don't start pruning at the same time.
+	RpFile *const file = new RpFile(stampFilename, RpFile::FM_CREATE_WRITE);
+	const bool isOpen = file->isOpen();
+	file->unref();
+	if (!isOpen)
+		return;
+	FileSystem::set_mtime(stampFilename, now);
+
+	RomDataCache::prune();
+}
+
+/** RomDataCache **/
+
+/**
+ * Get the cache filename for a ROM file.
+ * @param filename ROM filename. (UTF-8; should be an absolute path)
+ * @return Cache filename, or empty string on error.
+ */
+string RomDataCache::getCacheFilename(const char *filename)
+{
+	assert(filename != nullptr);
+	assert(filename[0] != '\0');
+	if (!filename || filename[0] == '\0')
+		return string();
+
+	// Cache key: "romdata/" + 64-bit FNV-1a hash of the filename.
+	// The filename is stored in the entry to handle collisions.
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (const uint8_t *p = reinterpret_cast<const uint8_t*>(filename); *p != 0; p++) {
+		hash ^= *p;
+		hash *= 0x100000001B3ULL;
+	}
+
+	char cacheKey[48];
+	snprintf(cacheKey, sizeof(cacheKey), "romdata/%08X%08X.bin",
+		static_cast<unsigned int>(hash >> 32),
+		static_cast<unsigned int>(hash & 0xFFFFFFFFU));
+	return LibCacheCommon::getCacheFilename(cacheKey);
+}
+
+/**
+ * Load cached RomFields and/or RomMetaData for a ROM file.
+ *
+ * Cached data is appended to the specified objects,
+ * which should be empty.
+ *
+ * @param filename	[in] ROM filename. (UTF-8; should be an absolute path)
+ * @param fields	[out,opt] RomFields to load.
+ * @param metaData	[out,opt] RomMetaData to load.
+ * @param flags		[in,opt] LoadFlags.
+ * @return 0 on success; -ENOENT if not cached or stale; other negative POSIX error code on error.
+ */
+int RomDataCache::load(const char *filename, RomFields *fields, RomMetaData *metaData, unsigned int flags)
+{
+	assert(fields != nullptr || metaData != nullptr);
+	if (!fields && !metaData)
+		return -EINVAL;
+
+	const string cacheFilename = getCacheFilename(filename);
+	if (cacheFilename.empty())
+		return -EINVAL;
+
+	// Get the ROM file's size and mtime.
+	off64_t fileSize;
+	time_t mtime;
+	int ret = FileSystem::get_file_size_and_mtime(filename, &fileSize, &mtime);
+	if (ret != 0)
+		return ret;
+
+	// Read the cache entry.
+	ao::uvector<uint8_t> buf;
+	{
+		unique_IRpFile<RpFile> file(new RpFile(cacheFilename, RpFile::FM_OPEN_READ));
+		if (!file->isOpen()) {
+			const int err = file->lastError();
+			return (err != 0 ? -err : -EIO);
+		}
+		const off64_t size = file->size();
+		if (size < RomDataCachePrivate::HEADER_SIZE || size > MAX_ENTRY_SIZE)
+			return -ENOENT;
+		buf.resize(static_cast<size_t>(size));
+		if (file->read(buf.data(), buf.size()) != buf.size())
+			return -EIO;
+	}
+
+	// Check the header.
+	RomDataCachePrivate::Reader hdr(buf.data(), RomDataCachePrivate::HEADER_SIZE);
+	if (memcmp(buf.data(), RomDataCachePrivate::RDC_MAGIC, sizeof(RomDataCachePrivate::RDC_MAGIC)) != 0)
+		return -ENOENT;
+	hdr.u32();	// magic
+	if (hdr.u32() != RomDataCachePrivate::RDC_VERSION ||
+	    hdr.u64() != static_cast<uint64_t>(fileSize) ||
+	    static_cast<int64_t>(hdr.u64()) != static_cast<int64_t>(mtime))
+	{
+		// Wrong format version, or the ROM file has changed.
+		return -ENOENT;
+	}
+	const uint32_t head_crc = hdr.u32();
+	const uint32_t sections = hdr.u32();
+	const uint32_t data_size = hdr.u32();
+	const uint32_t data_crc = hdr.u32();
+
+	// Make sure the requested sections are present.
+	if ((fields && !(sections & RomDataCachePrivate::RDC_SECTION_FIELDS)) ||
+	    (metaData && !(sections & RomDataCachePrivate::RDC_SECTION_METADATA)))
+	{
+		return -ENOENT;
+	}
+
+	// Verify the payload.
+	// This also catches entries that are still being written.
+	const uint8_t *const data = buf.data() + RomDataCachePrivate::HEADER_SIZE;
+	if (data_size != buf.size() - RomDataCachePrivate::HEADER_SIZE ||
+	    crc32(0, data, data_size) != data_crc)
+	{
+		return -ENOENT;
+	}
+
+	if (flags & RDC_VERIFY_HEADER) {
+		uint32_t crc;
+		ret = RomDataCachePrivate::headerCrc(filename, &crc);
+		if (ret != 0)
+			return ret;
+		if (crc != head_crc)
+			return -ENOENT;
+	}
+
+	// Check the entry's environment.
+	RomDataCachePrivate::Reader r(data, data_size);
+	if (r.str() != filename ||
+	    r.str() != RP_VERSION_STRING ||
+	    r.str() != RomDataCachePrivate::localeTag() ||
+	    static_cast<int64_t>(r.u64()) != RomDataCachePrivate::keysMtime())
+	{
+		return -ENOENT;
+	}
+
+	// Load the sections.
+	// NOTE: The fields section has to be parsed in order
+	// to reach the metadata section.
+	if (sections & RomDataCachePrivate::RDC_SECTION_FIELDS) {
+		if (fields) {
+			if (!RomDataCachePrivate::readFields(r, fields))
+				return -EIO;
+		} else {
+			RomFields tmpFields;
+			if (!RomDataCachePrivate::readFields(r, &tmpFields))
+				return -EIO;
+		}
+	}
+	if (metaData) {
+		if (!RomDataCachePrivate::readMetaData(r, metaData))
+			return -EIO;
+	}
+
+	return 0;
+}
+
+/**
+ * Store RomFields and/or RomMetaData for a ROM file.
+ * @param filename	[in] ROM filename. (UTF-8; should be an absolute path)
+ * @param fields	[in,opt] RomFields to store.
+ * @param metaData	[in,opt] RomMetaData to store.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomDataCache::store(const char *filename, const RomFields *fields, const RomMetaData *metaData)
+{
+	if (fields && !RomDataCachePrivate::canCacheFields(fields)) {
+		// Fields can't be cached. Store the metadata only.
+		fields = nullptr;
+	}
+	if (!fields && !metaData)
+		return -ENOTSUP;
+
+	const string cacheFilename = getCacheFilename(filename);
+	if (cacheFilename.empty())
+		return -EINVAL;
+
+	// Get the ROM file's size, mtime, and header CRC32.
+	off64_t fileSize;
+	time_t mtime;
+	int ret = FileSystem::get_file_size_and_mtime(filename, &fileSize, &mtime);
+	if (ret != 0)
+		return ret;
+	uint32_t head_crc;
+	ret = RomDataCachePrivate::headerCrc(filename, &head_crc);
+	if (ret != 0)
+		return ret;
+
+	// Serialize the payload.
+	ao::uvector<uint8_t> buf;
+	buf.reserve(4096);
+	buf.resize(RomDataCachePrivate::HEADER_SIZE);
+	RomDataCachePrivate::Writer w(buf);
+	w.str(filename);
+	w.str(RP_VERSION_STRING);
+	w.str(RomDataCachePrivate::localeTag());
+	w.u64(static_cast<uint64_t>(RomDataCachePrivate::keysMtime()));
+
+	uint32_t sections = 0;
+	if (fields) {
+		RomDataCachePrivate::writeFields(w, fields);
+		sections |= RomDataCachePrivate::RDC_SECTION_FIELDS;
+	}
+	if (metaData) {
+		RomDataCachePrivate::writeMetaData(w, metaData);
+		sections |= RomDataCachePrivate::RDC_SECTION_METADATA;
+	}
+	if (buf.size() > MAX_ENTRY_SIZE) {
+		// Entry is too big.
+		return -EFBIG;
+	}
+
+	// Write the header.
+	const uint32_t data_size = static_cast<uint32_t>(buf.size() - RomDataCachePrivate::HEADER_SIZE);
+	ao::uvector<uint8_t> hdrBuf;
+	hdrBuf.reserve(RomDataCachePrivate::HEADER_SIZE);
+	RomDataCachePrivate::Writer hdr(hdrBuf);
+	for (char c : RomDataCachePrivate::RDC_MAGIC) {
+		hdr.u8(static_cast<uint8_t>(c));
+	}
+	hdr.u32(RomDataCachePrivate::RDC_VERSION);
+	hdr.u64(static_cast<uint64_t>(fileSize));
+	hdr.u64(static_cast<uint64_t>(static_cast<int64_t>(mtime)));
+	hdr.u32(head_crc);
+	hdr.u32(sections);
+	hdr.u32(data_size);
+	hdr.u32(crc32(0, &buf[RomDataCachePrivate::HEADER_SIZE], data_size));
+	assert(hdrBuf.size() == RomDataCachePrivate::HEADER_SIZE);
+	memcpy(buf.data(), hdrBuf.data(), RomDataCachePrivate::HEADER_SIZE);
+
+	// Make sure the cache directory exists.
+	ret = FileSystem::rmkdir(cacheFilename);
+	if (ret != 0)
+		return ret;
+
+	// Write the cache entry to a temporary file, then replace the
+	// old entry, so other processes never see a partial entry.
+	const string tmpFilename = FileSystem::get_temp_filename(cacheFilename);
+	unique_IRpFile<RpFile> file(new RpFile(tmpFilename, RpFile::FM_CREATE_WRITE));
+	if (!file->isOpen()) {
+		const int err = file->lastError();
+		return (err != 0 ? -err : -EIO);
+	}
+	if (file->write(buf.data(), buf.size()) != buf.size()) {
+		const int err = file->lastError();
+		file->close();
+		FileSystem::delete_file(tmpFilename);
+		return (err != 0 ? -err : -EIO);
+	}
+	file->close();
+
+	ret = FileSystem::rename_file(tmpFilename, cacheFilename);
+	if (ret != 0) {
+		FileSystem::delete_file(tmpFilename);
+		return ret;
+	}
+
+	// Keep the cache within its size budget.
+	RomDataCachePrivate::autoPrune();
+	return 0;
+}
+
+/**
+ * Remove the cache entry for a ROM file.
+ * @param filename ROM filename. (UTF-8; should be an absolute path)
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomDataCache::remove(const char *filename)
+{
+	const string cacheFilename = getCacheFilename(filename);
+	if (cacheFilename.empty())
+		return -EINVAL;
+	return FileSystem::delete_file(cacheFilename);
+}
+
+/**
+ * Prune the cache.
+ *
+ * Stale entries are removed first. An entry is stale if its
+ * ROM file no longer exists or has changed, or if the entry
+ * is invalid. Temporary files left over from interrupted
+ * writes are also removed.
+ *
+ * If the remaining entries are larger than maxBytes in total,
+ * the oldest entries are removed until they fit.
+ *
+ * store() calls this automatically at most once a day.
+ *
+ * @param maxBytes Maximum total size of the cache entries, in bytes. (0 for no limit)
+ * @return Number of files removed on success; negative POSIX error code on error.
+ */
+int RomDataCache::prune(uint64_t maxBytes)
+{
+	const string dir = RomDataCachePrivate::cacheDirectory();
+	if (dir.empty())
+		return -ENOENT;
+
+	vector<RomDataCachePrivate::DirEntry> entries;
+	int ret = RomDataCachePrivate::listFiles(dir, entries);
+	if (ret != 0)
+		return (ret == -ENOENT ? 0 : ret);
+
+	// Remove stale entries and old temporary files.
+	const time_t now = time(nullptr);
+	int removed = 0;
+	uint64_t totalBytes = 0;
+	vector<RomDataCachePrivate::DirEntry> valid;
+	valid.reserve(entries.size());
+	for (auto iter = entries.begin(); iter != entries.end(); ++iter) {
+		const string &filename = iter->filename;
+		const size_t len = filename.size();
+		if (len > 4 && !filename.compare(len - 4, 4, ".tmp")) {
+			// Temporary file. Only remove it if it's old,
+			// since it might still be being written.
+			if (now - iter->mtime >= RomDataCachePrivate::TMP_FILE_AGE &&
+			    FileSystem::delete_file(filename) == 0)
+			{
+				removed++;
+			}
+			continue;
+		} else if (len <= 4 || filename.compare(len - 4, 4, ".bin") != 0) {
+			// Not a cache entry.
+			continue;
+		}
+
+		if (RomDataCachePrivate::isStale(filename)) {
+			if (FileSystem::delete_file(filename) == 0) {
+				removed++;
+			}
+			continue;
+		}
+
+		totalBytes += iter->size;
+		valid.push_back(std::move(*iter));
+	}
+
+	if (maxBytes == 0 || totalBytes <= maxBytes) {
+		// Within budget.
+		return removed;
+	}
+
+	// Remove the oldest entries until the cache is within budget.
+	std::sort(valid.begin(), valid.end(),
+		[](const RomDataCachePrivate::DirEntry &a, const RomDataCachePrivate::DirEntry &b) {
+			return (a.mtime < b.mtime);
+		});
+	for (auto iter = valid.cbegin(); iter != valid.cend() && totalBytes > maxBytes; ++iter) {
+		if (FileSystem::delete_file(iter->filename) == 0) {
+			removed++;
+			totalBytes -= iter->size;
+		}
+	}
+
+	return removed;
+}
+
+}
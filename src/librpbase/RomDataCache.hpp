@@ -0,0 +1,125 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * RomDataCache.hpp: On-disk cache for RomFields and RomMetaData.          *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPBASE_ROMDATACACHE_HPP__
+#define __ROMPROPERTIES_LIBRPBASE_ROMDATACACHE_HPP__
+
+#include "common.h"
+
+// C++ includes.
+#include <string>
+
+namespace LibRpBase {
+
+class RomFields;
+class RomMetaData;
+
+/**
+ * On-disk cache for parsed RomFields and RomMetaData.
+ *
+ * Entries are stored in the rom-properties cache directory,
+ * keyed by the ROM's filename. An entry is only used if the
+ * ROM's size and mtime match the values recorded when it was
+ * stored, and if it was stored by the same rom-properties
+ * version using the same language settings.
+ *
+ * RFT_LISTDATA fields with icons can't be cached. If any
+ * are present, only the metadata is stored.
+ *
+ * Entries for ROM files that were removed or changed, and the
+ * oldest entries if the cache is too large, are removed by prune().
+ */
+class RomDataCache
+{
+	private:
+		// RomDataCache is a static class.
+		RomDataCache();
+		~RomDataCache();
+	private:
+		RP_DISABLE_COPY(RomDataCache)
+
+	public:
+		/**
+		 * load() flags.
+		 */
+		enum LoadFlags {
+			// Verify a CRC32 of the beginning of the ROM file.
+			// This detects changes that preserve both the
+			// file size and mtime, at the cost of a read.
+			RDC_VERIFY_HEADER	= (1U << 0),
+		};
+
+		// Maximum size of a cache entry.
+		// Larger entries are not stored.
+		static const unsigned int MAX_ENTRY_SIZE = 1024*1024;
+
+		// Default maximum total size of all cache entries.
+		// See prune().
+		static const unsigned int MAX_TOTAL_SIZE = 32*1024*1024;
+
+	public:
+		/**
+		 * Get the cache filename for a ROM file.
+		 * @param filename ROM filename. (UTF-8; should be an absolute path)
+		 * @return Cache filename, or empty string on error.
+		 */
+		static std::string getCacheFilename(const char *filename);
+
+		/**
+		 * Load cached RomFields and/or RomMetaData for a ROM file.
+		 *
+		 * Cached data is appended to the specified objects,
+		 * which should be empty. On error, the objects may
+		 * contain partial data and should be discarded.
+		 *
+		 * @param filename	[in] ROM filename. (UTF-8; should be an absolute path)
+		 * @param fields	[out,opt] RomFields to load.
+		 * @param metaData	[out,opt] RomMetaData to load.
+		 * @param flags		[in,opt] LoadFlags.
+		 * @return 0 on success; -ENOENT if not cached or stale; other negative POSIX error code on error.
+		 */
+		static int load(const char *filename, RomFields *fields, RomMetaData *metaData, unsigned int flags = 0);
+
+		/**
+		 * Store RomFields and/or RomMetaData for a ROM file.
+		 * @param filename	[in] ROM filename. (UTF-8; should be an absolute path)
+		 * @param fields	[in,opt] RomFields to store.
+		 * @param metaData	[in,opt] RomMetaData to store.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int store(const char *filename, const RomFields *fields, const RomMetaData *metaData);
+
+		/**
+		 * Remove the cache entry for a ROM file.
+		 * @param filename ROM filename. (UTF-8; should be an absolute path)
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int remove(const char *filename);
+
+		/**
+		 * Prune the cache.
+		 *
+		 * Stale entries are removed first. An entry is stale if its
+		 * ROM file no longer exists or has changed, or if the entry
+		 * is invalid. Temporary files left over from interrupted
+		 * writes are also removed.
+		 *
+		 * If the remaining entries are larger than maxBytes in total,
+		 * the oldest entries are removed until they fit.
+		 *
+		 * store() calls this automatically at most once a day.
+		 *
+		 * @param maxBytes Maximum total size of the cache entries, in bytes. (0 for no limit)
+		 * @return Number of files removed on success; negative POSIX error code on error.
+		 */
+		static int prune(uint64_t maxBytes = MAX_TOTAL_SIZE);
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBRPBASE_ROMDATACACHE_HPP__ */
@@ -204,6 +204,25 @@ class klass : public LibRpBase::RomData { \
 		 */ \
 		int loadInternalImage(ImageType imageType, const LibRpTexture::rp_image **pImage) final;
 
+/**
+ * RomData subclass function declaration for loading
+ * reduced-size internal images for thumbnails.
+ */
+#define ROMDATA_DECL_IMGINT_SIZE() \
+	public: \
+		/** \
+		 * Get an internal image from the ROM for a thumbnail. \
+		 * \
+		 * This may return an image smaller than image(), \
+		 * as long as its largest dimension is at least reqSize. \
+		 * \
+		 * @param imageType	[in] Image type to load. \
+		 * @param reqSize	[in] Requested thumbnail size. (0 for the full image) \
+		 * @param pFullSize	[out,opt] Dimensions of the full image: [w, h] \
+		 * @return Internal image, or nullptr if the ROM doesn't have one. \
+		 */ \
+		const LibRpTexture::rp_image *imageForSize(ImageType imageType, int reqSize, int pFullSize[2]) const final;
+
 /**
  * RomData subclass function declaration for obtaining URLs for external images.
  */
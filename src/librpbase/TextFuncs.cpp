@@ -56,13 +56,10 @@ u16string utf16_bswap(const char16_t *str, int len)
 		}
 	}
 
-	// TODO: Optimize this?
-	u16string ret;
-	ret.reserve(len);
-	for (; len > 0; len--, str++) {
-		ret += __swab16(*str);
-	}
-
+	// Copy the string, then byteswap it in place.
+	// __byte_swap_16_array() uses SSE2/SSSE3 if available.
+	u16string ret(str, len);
+	__byte_swap_16_array(reinterpret_cast<uint16_t*>(&ret[0]), len * sizeof(char16_t));
 	return ret;
 }
 
@@ -10,6 +10,8 @@
 #include "config.librpbase.h"
 #include "TextFuncs.hpp"
 #include "TextFuncs_NULL.hpp"
+#include "TextFuncs_tbl.hpp"
+#include "TextFuncs_utf8.hpp"
 
 #if defined(_WIN32)
 # error TextFuncs_iconv.cpp is not supported on Windows.
@@ -202,53 +204,53 @@ static inline void codePageToEncName(char *enc_name, size_t len, unsigned int cp
 string cpN_to_utf8(unsigned int cp, const char *str, int len, unsigned int flags)
 {
 	len = check_NULL_terminator(str, len);
-
-	// Get the encoding name for the primary code page.
-	char cp_name[20];
-	codePageToEncName(cp_name, sizeof(cp_name), cp);
-
-	// If we *want* to fall back to cp1252 on error,
-	// then the first conversion should fail on errors.
-	const bool ignoreErr = !(flags & TEXTCONV_FLAG_CP1252_FALLBACK);
+	string ret;
+	if (len <= 0) {
+		return ret;
+	}
 
 	// Attempt to convert the text to UTF-8.
-	// NOTE: "//IGNORE" sometimes doesn't work, so we won't
-	// check for TEXTCONV_FLAG_CP1252_FALLBACK here.
-	string ret;
-	char *mbs = reinterpret_cast<char*>(rp_iconv((char*)str, len*sizeof(*str), cp_name, "UTF-8", ignoreErr));
-	if (!mbs /*&& (flags & TEXTCONV_FLAG_CP1252_FALLBACK)*/) {
-		// Try cp1252 fallback.
-		// NOTE: Sometimes cp1252 fails, even with ignore set.
-		if (cp != 1252) {
-			mbs = reinterpret_cast<char*>(rp_iconv((char*)str, len*sizeof(*str), "CP1252", "UTF-8", true));
-		}
-		if (!mbs) {
-			// Try Latin-1 fallback.
-			if (cp != CP_LATIN1) {
-				mbs = reinterpret_cast<char*>(rp_iconv((char*)str, len*sizeof(*str), "LATIN1", "UTF-8", true));
+	// Shift-JIS, cp1252, and Latin-1 use lookup tables.
+	bool ok;
+	switch (cp) {
+		case CP_SJIS:
+			ok = cp932_tbl_to_utf8(ret, str, len);
+			break;
+		case CP_ACP:
+		case 1252:
+			ok = cp1252_tbl_to_utf8(ret, str, len);
+			break;
+		case CP_LATIN1:
+			latin1_tbl_to_utf8(ret, str, len);
+			ok = true;
+			break;
+		default: {
+			// Get the encoding name for the primary code page.
+			char cp_name[20];
+			codePageToEncName(cp_name, sizeof(cp_name), cp);
+
+			// If we *want* to fall back to cp1252 on error,
+			// then the first conversion should fail on errors.
+			const bool ignoreErr = !(flags & TEXTCONV_FLAG_CP1252_FALLBACK);
+
+			// NOTE: "//IGNORE" sometimes doesn't work, so we won't
+			// check for TEXTCONV_FLAG_CP1252_FALLBACK here.
+			char *mbs = reinterpret_cast<char*>(rp_iconv((char*)str, len*sizeof(*str), cp_name, "UTF-8", ignoreErr));
+			ok = (mbs != nullptr);
+			if (mbs) {
+				ret.assign(mbs);
+				free(mbs);
 			}
+			break;
 		}
 	}
 
-	if (mbs) {
-		ret.assign(mbs);
-		free(mbs);
-
-#ifdef HAVE_ICONV_LIBICONV
-		if (cp == CP_SJIS) {
-			// libiconv's cp932 maps Shift-JIS 8160 to U+301C. This is expected
-			// behavior for Shift-JIS, but cp932 should map it to U+FF5E.
-			for (auto p = ret.begin(); p != ret.end(); ++p) {
-				if ((uint8_t)p[0] == 0xE3 && (uint8_t)p[1] == 0x80 && (uint8_t)p[2] == 0x9C) {
-					// Found a wave dash.
-					p[0] = (uint8_t)0xEF;
-					p[1] = (uint8_t)0xBD;
-					p[2] = (uint8_t)0x9E;
-					p += 2;
-				}
-			}
+	if (!ok) {
+		// Try cp1252 fallback.
+		// If that fails, use Latin-1, which always succeeds.
+		if (!cp1252_tbl_to_utf8(ret, str, len)) {
+			latin1_tbl_to_utf8(ret, str, len);
 		}
-#endif /* HAVE_ICONV_LIBICONV */
 	}
 	return ret;
 }
@@ -268,50 +270,53 @@ string cpN_to_utf8(unsigned int cp, const char *str, int len, unsigned int flags
 u16string cpN_to_utf16(unsigned int cp, const char *str, int len, unsigned int flags)
 {
 	len = check_NULL_terminator(str, len);
-
-	// Get the encoding name for the primary code page.
-	char cp_name[20];
-	codePageToEncName(cp_name, sizeof(cp_name), cp);
-
-	// If we *want* to fall back to cp1252 on error,
-	// then the first conversion should fail on errors.
-	const bool ignoreErr = !(flags & TEXTCONV_FLAG_CP1252_FALLBACK);
+	u16string ret;
+	if (len <= 0) {
+		return ret;
+	}
 
 	// Attempt to convert the text to UTF-16.
-	// NOTE: "//IGNORE" sometimes doesn't work, so we won't
-	// check for TEXTCONV_FLAG_CP1252_FALLBACK here.
-	u16string ret;
-	char16_t *wcs = reinterpret_cast<char16_t*>(rp_iconv((char*)str, len*sizeof(*str), cp_name, RP_ICONV_UTF16_ENCODING, ignoreErr));
-	if (!wcs /*&& (flags & TEXTCONV_FLAG_CP1252_FALLBACK)*/) {
-		// Try cp1252 fallback.
-		// NOTE: Sometimes cp1252 fails, even with ignore set.
-		if (cp != 1252) {
-			wcs = reinterpret_cast<char16_t*>(rp_iconv((char*)str, len*sizeof(*str), "CP1252", RP_ICONV_UTF16_ENCODING, true));
-		}
-		if (!wcs) {
-			// Try Latin-1 fallback.
-			if (cp != CP_LATIN1) {
-				wcs = reinterpret_cast<char16_t*>(rp_iconv((char*)str, len*sizeof(*str), "LATIN1//IGNORE", RP_ICONV_UTF16_ENCODING, true));
+	// Shift-JIS, cp1252, and Latin-1 use lookup tables.
+	bool ok;
+	switch (cp) {
+		case CP_SJIS:
+			ok = cp932_tbl_to_utf16(ret, str, len);
+			break;
+		case CP_ACP:
+		case 1252:
+			ok = cp1252_tbl_to_utf16(ret, str, len);
+			break;
+		case CP_LATIN1:
+			latin1_tbl_to_utf16(ret, str, len);
+			ok = true;
+			break;
+		default: {
+			// Get the encoding name for the primary code page.
+			char cp_name[20];
+			codePageToEncName(cp_name, sizeof(cp_name), cp);
+
+			// If we *want* to fall back to cp1252 on error,
+			// then the first conversion should fail on errors.
+			const bool ignoreErr = !(flags & TEXTCONV_FLAG_CP1252_FALLBACK);
+
+			// NOTE: "//IGNORE" sometimes doesn't work, so we won't
+			// check for TEXTCONV_FLAG_CP1252_FALLBACK here.
+			char16_t *wcs = reinterpret_cast<char16_t*>(rp_iconv((char*)str, len*sizeof(*str), cp_name, RP_ICONV_UTF16_ENCODING, ignoreErr));
+			ok = (wcs != nullptr);
+			if (wcs) {
+				ret.assign(wcs);
+				free(wcs);
 			}
+			break;
 		}
 	}
 
-	if (wcs) {
-		ret.assign(wcs);
-		free(wcs);
-
-#ifdef HAVE_ICONV_LIBICONV
-		if (cp == CP_SJIS) {
-			// libiconv's cp932 maps Shift-JIS 8160 to U+301C. This is expected
-			// behavior for Shift-JIS, but cp932 should map it to U+FF5E.
-			std::for_each(ret.begin(), ret.end(), [](char16_t &p) {
-				if (p == 0x301C) {
-					// Found a wave dash.
-					p = (char16_t)0xFF5E;
-				}
-			});
+	if (!ok) {
+		// Try cp1252 fallback.
+		// If that fails, use Latin-1, which always succeeds.
+		if (!cp1252_tbl_to_utf16(ret, str, len)) {
+			latin1_tbl_to_utf16(ret, str, len);
 		}
-#endif /* HAVE_ICONV_LIBICONV */
 	}
 	return ret;
 }
@@ -392,12 +397,21 @@ string utf16le_to_utf8(const char16_t *wcs, int len)
 {
 	len = check_NULL_terminator(wcs, len);
 
-	// Attempt to convert the text from UTF-16LE to UTF-8.
 	string ret;
-	char *mbs = reinterpret_cast<char*>(rp_iconv((char*)wcs, len*sizeof(*wcs), "UTF-16LE", "UTF-8"));
-	if (mbs) {
-		ret.assign(mbs);
-		free(mbs);
+	if (len <= 0) {
+		return ret;
+	}
+
+	// Convert the text from UTF-16LE to UTF-8.
+	// Each code unit is encoded as at most three bytes.
+	// (Surrogate pairs are encoded as four bytes.)
+	ret.resize(static_cast<size_t>(len) * 3);
+	const int mbs_len = utf16le_to_utf8_buf(&ret[0], wcs, len);
+	if (mbs_len < 0) {
+		// Invalid UTF-16LE.
+		ret.clear();
+	} else {
+		ret.resize(mbs_len);
 	}
 	return ret;
 }
@@ -413,12 +427,21 @@ string utf16be_to_utf8(const char16_t *wcs, int len)
 {
 	len = check_NULL_terminator(wcs, len);
 
-	// Attempt to convert the text from UTF-16BE to UTF-8.
 	string ret;
-	char *mbs = reinterpret_cast<char*>(rp_iconv((char*)wcs, len*sizeof(*wcs), "UTF-16BE", "UTF-8"));
-	if (mbs) {
-		ret.assign(mbs);
-		free(mbs);
+	if (len <= 0) {
+		return ret;
+	}
+
+	// Convert the text from UTF-16BE to UTF-8.
+	// Each code unit is encoded as at most three bytes.
+	// (Surrogate pairs are encoded as four bytes.)
+	ret.resize(static_cast<size_t>(len) * 3);
+	const int mbs_len = utf16be_to_utf8_buf(&ret[0], wcs, len);
+	if (mbs_len < 0) {
+		// Invalid UTF-16BE.
+		ret.clear();
+	} else {
+		ret.resize(mbs_len);
 	}
 	return ret;
 }
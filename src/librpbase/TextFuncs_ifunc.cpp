@@ -0,0 +1,107 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * TextFuncs_ifunc.cpp: Text encoding functions. (IFUNC)                   *
+ *                                                                         *
+ * Copyright (c) 2009-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "librpcpu/cpu_dispatch.h"
+
+#ifdef RP_HAS_IFUNC
+
+#include "TextFuncs_utf8.hpp"
+using namespace LibRpBase;
+
+// IFUNC attribute doesn't support C++ name mangling.
+extern "C" {
+
+/**
+ * IFUNC resolver function for utf16le_to_utf8_buf().
+ * @return Function pointer.
+ */
+static __typeof__(&utf16le_to_utf8_buf_cpp) utf16le_to_utf8_buf_resolve(void)
+{
+#ifdef TEXTFUNCS_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return &utf16le_to_utf8_buf_avx2;
+	} else
+#endif /* TEXTFUNCS_HAS_AVX2 */
+#ifdef TEXTFUNCS_ALWAYS_HAS_SSE2
+	{
+		return &utf16le_to_utf8_buf_sse2;
+	}
+#else /* !TEXTFUNCS_ALWAYS_HAS_SSE2 */
+# ifdef TEXTFUNCS_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		return &utf16le_to_utf8_buf_sse2;
+	} else
+# endif /* TEXTFUNCS_HAS_SSE2 */
+	{
+		return &utf16le_to_utf8_buf_cpp;
+	}
+#endif /* TEXTFUNCS_ALWAYS_HAS_SSE2 */
+}
+
+/**
+ * IFUNC resolver function for utf16be_to_utf8_buf().
+ * @return Function pointer.
+ */
+static __typeof__(&utf16be_to_utf8_buf_cpp) utf16be_to_utf8_buf_resolve(void)
+{
+#ifdef TEXTFUNCS_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return &utf16be_to_utf8_buf_avx2;
+	} else
+#endif /* TEXTFUNCS_HAS_AVX2 */
+#ifdef TEXTFUNCS_ALWAYS_HAS_SSE2
+	{
+		return &utf16be_to_utf8_buf_sse2;
+	}
+#else /* !TEXTFUNCS_ALWAYS_HAS_SSE2 */
+# ifdef TEXTFUNCS_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		return &utf16be_to_utf8_buf_sse2;
+	} else
+# endif /* TEXTFUNCS_HAS_SSE2 */
+	{
+		return &utf16be_to_utf8_buf_cpp;
+	}
+#endif /* TEXTFUNCS_ALWAYS_HAS_SSE2 */
+}
+
+/**
+ * IFUNC resolver function for latin1_to_utf8_buf().
+ * @return Function pointer.
+ */
+static __typeof__(&latin1_to_utf8_buf_cpp) latin1_to_utf8_buf_resolve(void)
+{
+#ifdef TEXTFUNCS_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return &latin1_to_utf8_buf_avx2;
+	} else
+#endif /* TEXTFUNCS_HAS_AVX2 */
+#ifdef TEXTFUNCS_ALWAYS_HAS_SSE2
+	{
+		return &latin1_to_utf8_buf_sse2;
+	}
+#else /* !TEXTFUNCS_ALWAYS_HAS_SSE2 */
+# ifdef TEXTFUNCS_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		return &latin1_to_utf8_buf_sse2;
+	} else
+# endif /* TEXTFUNCS_HAS_SSE2 */
+	{
+		return &latin1_to_utf8_buf_cpp;
+	}
+#endif /* TEXTFUNCS_ALWAYS_HAS_SSE2 */
+}
+
+}
+
+int LibRpBase::utf16le_to_utf8_buf(char *mbs, const char16_t *wcs, int len) IFUNC_ATTR(utf16le_to_utf8_buf_resolve);
+int LibRpBase::utf16be_to_utf8_buf(char *mbs, const char16_t *wcs, int len) IFUNC_ATTR(utf16be_to_utf8_buf_resolve);
+int LibRpBase::latin1_to_utf8_buf(char *mbs, const char *str, int len) IFUNC_ATTR(latin1_to_utf8_buf_resolve);
+
+#endif /* RP_HAS_IFUNC */
@@ -0,0 +1,330 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * TextFuncs_tbl.cpp: Text encoding functions. (table-driven decoders)     *
+ *                                                                         *
+ * Copyright (c) 2009-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "TextFuncs_tbl.hpp"
+#include "TextFuncs_utf8.hpp"
+
+// Shift-JIS (cp932) decoding table.
+#include "TextFuncs_cp932_data.hpp"
+
+// C++ STL classes.
+using std::basic_string;
+using std::string;
+using std::u16string;
+
+// Shift-JIS, cp1252, and Latin-1 are used by a lot of ROM headers,
+// so they're decoded using lookup tables instead of iconv(). This
+// avoids opening an iconv descriptor and allocating a temporary
+// buffer for every string.
+
+namespace LibRpBase {
+
+/**
+ * cp1252 lookup table for 0x80-0x9F.
+ * 0xA0-0xFF are identical to Latin-1.
+ * - Index: 8-bit character, minus 0x80.
+ * - Value: UTF-16 code point, or 0 if the code point is unassigned.
+ */
+static const char16_t cp1252_lkup[32] = {
+	// 0x80
+	0x20AC, 0x0000, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x0000, 0x017D, 0x0000,
+	// 0x90
+	0x0000, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x0000, 0x017E, 0x0178,
+};
+
+/**
+ * Maximum number of output code units per input byte.
+ * UTF-8: 3 (BMP only); UTF-16: 1
+ */
+template<typename CharT>
+struct max_units_per_byte {
+	static const int value = (sizeof(CharT) == 1 ? 3 : 1);
+};
+
+/**
+ * Write a BMP code point as UTF-8.
+ * @param p	[in] Output pointer.
+ * @param ch16	[in] BMP code point.
+ * @return Updated output pointer.
+ */
+static FORCEINLINE char *put_ch16(char *p, char16_t ch16)
+{
+	if (ch16 < 0x0080) {
+		*p++ = (char)ch16;
+	} else if (ch16 < 0x0800) {
+		*p++ = (char)(0xC0 | (ch16 >> 6));
+		*p++ = (char)(0x80 | (ch16 & 0x3F));
+	} else {
+		*p++ = (char)(0xE0 | (ch16 >> 12));
+		*p++ = (char)(0x80 | ((ch16 >> 6) & 0x3F));
+		*p++ = (char)(0x80 | (ch16 & 0x3F));
+	}
+	return p;
+}
+
+/**
+ * Write a BMP code point as UTF-16.
+ * @param p	[in] Output pointer.
+ * @param ch16	[in] BMP code point.
+ * @return Updated output pointer.
+ */
+static FORCEINLINE char16_t *put_ch16(char16_t *p, char16_t ch16)
+{
+	*p++ = ch16;
+	return p;
+}
+
+/**
+ * Copy runs of ASCII characters.
+ * ASCII is identical in all of the supported encodings,
+ * so it's copied eight bytes at a time.
+ * @param p	[in/out] Output pointer.
+ * @param s	[in/out] Input pointer.
+ * @param end	[in] End of input.
+ */
+static FORCEINLINE void copy_ascii(char *&p, const uint8_t *&s, const uint8_t *end)
+{
+	for (; end - s >= 8; s += 8, p += 8) {
+		uint64_t qword;
+		memcpy(&qword, s, 8);
+		if (qword & 0x8080808080808080ULL)
+			break;
+		memcpy(p, &qword, 8);
+	}
+}
+
+/**
+ * Copy runs of ASCII characters.
+ * ASCII is identical in all of the supported encodings,
+ * so it's copied eight bytes at a time.
+ * @param p	[in/out] Output pointer.
+ * @param s	[in/out] Input pointer.
+ * @param end	[in] End of input.
+ */
+static FORCEINLINE void copy_ascii(char16_t *&p, const uint8_t *&s, const uint8_t *end)
+{
+	for (; end - s >= 8; s += 8, p += 8) {
+		uint64_t qword;
+		memcpy(&qword, s, 8);
+		if (qword & 0x8080808080808080ULL)
+			break;
+		for (unsigned int i = 0; i < 8; i++) {
+			p[i] = s[i];
+		}
+	}
+}
+
+/**
+ * Decode Shift-JIS (cp932) text.
+ * @param ret	[out] Output string.
+ * @param str	[in] Shift-JIS text.
+ * @param len	[in] Length of str, in bytes.
+ * @return True on success; false if str contains an invalid sequence.
+ */
+template<typename CharT>
+static bool cp932_tbl_decode(basic_string<CharT> &ret, const char *str, int len)
+{
+	ret.resize(static_cast<size_t>(len) * max_units_per_byte<CharT>::value);
+	CharT *p = &ret[0];
+	const uint8_t *s = reinterpret_cast<const uint8_t*>(str);
+	const uint8_t *const end = s + len;
+
+	while (s < end) {
+		copy_ascii(p, s, end);
+		if (s >= end)
+			break;
+
+		const uint8_t lead = *s;
+		if (lead < 0x80) {
+			// ASCII
+			*p++ = lead;
+			s++;
+			continue;
+		} else if (lead >= 0xA1 && lead <= 0xDF) {
+			// Half-width katakana
+			p = put_ch16(p, 0xFF61 + (lead - 0xA1));
+			s++;
+			continue;
+		}
+
+		// Double-byte character.
+		unsigned int row;
+		if (lead >= 0x81 && lead <= 0x9F) {
+			row = lead - 0x81;
+		} else if (lead >= 0xE0 && lead <= 0xFC) {
+			row = lead - 0xE0 + (0xA0 - 0x81);
+		} else {
+			// Invalid lead byte. (0x80, 0xA0, 0xFD-0xFF)
+			return false;
+		}
+		if (unlikely(end - s < 2)) {
+			// Incomplete sequence.
+			return false;
+		}
+		const uint8_t trail = s[1];
+		if (trail < 0x40 || trail > 0xFC) {
+			// Invalid trail byte.
+			return false;
+		}
+		const char16_t ch16 = cp932_dbcs_lkup[row][trail - 0x40];
+		if (ch16 == 0) {
+			// Unassigned code point.
+			return false;
+		}
+		p = put_ch16(p, ch16);
+		s += 2;
+	}
+
+	ret.resize(p - &ret[0]);
+	return true;
+}
+
+/**
+ * Decode cp1252 text.
+ * @param ret	[out] Output string.
+ * @param str	[in] cp1252 text.
+ * @param len	[in] Length of str, in bytes.
+ * @return True on success; false if str contains an unassigned code point.
+ */
+template<typename CharT>
+static bool cp1252_tbl_decode(basic_string<CharT> &ret, const char *str, int len)
+{
+	ret.resize(static_cast<size_t>(len) * max_units_per_byte<CharT>::value);
+	CharT *p = &ret[0];
+	const uint8_t *s = reinterpret_cast<const uint8_t*>(str);
+	const uint8_t *const end = s + len;
+
+	while (s < end) {
+		copy_ascii(p, s, end);
+		if (s >= end)
+			break;
+
+		const uint8_t ch = *s++;
+		if (ch >= 0x80 && ch < 0xA0) {
+			const char16_t ch16 = cp1252_lkup[ch - 0x80];
+			if (ch16 == 0) {
+				// Unassigned code point.
+				return false;
+			}
+			p = put_ch16(p, ch16);
+		} else {
+			// ASCII or Latin-1
+			p = put_ch16(p, ch);
+		}
+	}
+
+	ret.resize(p - &ret[0]);
+	return true;
+}
+
+/**
+ * Decode Latin-1 (ISO-8859-1) text.
+ * @param ret	[out] Output string.
+ * @param str	[in] Latin-1 text.
+ * @param len	[in] Length of str, in bytes.
+ */
+template<typename CharT>
+static void latin1_tbl_decode(basic_string<CharT> &ret, const char *str, int len)
+{
+	// Latin-1 code points are identical to Unicode,
+	// so the "table" is the identity function.
+	ret.resize(static_cast<size_t>(len) * max_units_per_byte<CharT>::value);
+	CharT *p = &ret[0];
+	const uint8_t *s = reinterpret_cast<const uint8_t*>(str);
+	const uint8_t *const end = s + len;
+
+	while (s < end) {
+		copy_ascii(p, s, end);
+		if (s >= end)
+			break;
+		p = put_ch16(p, *s++);
+	}
+
+	ret.resize(p - &ret[0]);
+}
+
+/**
+ * Decode Shift-JIS (cp932) text to UTF-8 using a lookup table.
+ * Output is identical to glibc's CP932 converter.
+ * @param ret	[out] UTF-8 string.
+ * @param str	[in] Shift-JIS text. (must not contain NULL bytes)
+ * @param len	[in] Length of str, in bytes.
+ * @return True on success; false if str contains an invalid sequence.
+ */
+bool cp932_tbl_to_utf8(string &ret, const char *str, int len)
+{
+	return cp932_tbl_decode(ret, str, len);
+}
+
+/**
+ * Decode Shift-JIS (cp932) text to UTF-16 using a lookup table.
+ * Output is identical to glibc's CP932 converter.
+ * @param ret	[out] UTF-16 string.
+ * @param str	[in] Shift-JIS text. (must not contain NULL bytes)
+ * @param len	[in] Length of str, in bytes.
+ * @return True on success; false if str contains an invalid sequence.
+ */
+bool cp932_tbl_to_utf16(u16string &ret, const char *str, int len)
+{
+	return cp932_tbl_decode(ret, str, len);
+}
+
+/**
+ * Decode cp1252 text to UTF-8 using a lookup table.
+ * @param ret	[out] UTF-8 string.
+ * @param str	[in] cp1252 text. (must not contain NULL bytes)
+ * @param len	[in] Length of str, in bytes.
+ * @return True on success; false if str contains an unassigned code point.
+ */
+bool cp1252_tbl_to_utf8(string &ret, const char *str, int len)
+{
+	return cp1252_tbl_decode(ret, str, len);
+}
+
+/**
+ * Decode cp1252 text to UTF-16 using a lookup table.
+ * @param ret	[out] UTF-16 string.
+ * @param str	[in] cp1252 text. (must not contain NULL bytes)
+ * @param len	[in] Length of str, in bytes.
+ * @return True on success; false if str contains an unassigned code point.
+ */
+bool cp1252_tbl_to_utf16(u16string &ret, const char *str, int len)
+{
+	return cp1252_tbl_decode(ret, str, len);
+}
+
+/**
+ * Decode Latin-1 (ISO-8859-1) text to UTF-8.
+ * This never fails, since all Latin-1 code points are assigned.
+ * @param ret	[out] UTF-8 string.
+ * @param str	[in] Latin-1 text. (must not contain NULL bytes)
+ * @param len	[in] Length of str, in bytes.
+ */
+void latin1_tbl_to_utf8(string &ret, const char *str, int len)
+{
+	// Each Latin-1 character is encoded as at most two bytes.
+	ret.resize(static_cast<size_t>(len) * 2);
+	ret.resize(latin1_to_utf8_buf(&ret[0], str, len));
+}
+
+/**
+ * Decode Latin-1 (ISO-8859-1) text to UTF-16.
+ * This never fails, since all Latin-1 code points are assigned.
+ * @param ret	[out] UTF-16 string.
+ * @param str	[in] Latin-1 text. (must not contain NULL bytes)
+ * @param len	[in] Length of str, in bytes.
+ */
+void latin1_tbl_to_utf16(u16string &ret, const char *str, int len)
+{
+	latin1_tbl_decode(ret, str, len);
+}
+
+}
@@ -0,0 +1,78 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * TextFuncs_tbl.hpp: Text encoding functions. (table-driven decoders)     *
+ *                                                                         *
+ * Copyright (c) 2009-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPBASE_TEXTFUNCS_TBL_HPP__
+#define __ROMPROPERTIES_LIBRPBASE_TEXTFUNCS_TBL_HPP__
+
+// NOTE: These functions are used internally by the OS-specific
+// text conversion functions. Use the functions in TextFuncs.hpp.
+
+// C++ includes.
+#include <string>
+
+namespace LibRpBase {
+
+/**
+ * Decode Shift-JIS (cp932) text to UTF-8 using a lookup table.
+ * Output is identical to glibc's CP932 converter.
+ * @param ret	[out] UTF-8 string.
+ * @param str	[in] Shift-JIS text. (must not contain NULL bytes)
+ * @param len	[in] Length of str, in bytes.
+ * @return True on success; false if str contains an invalid sequence.
+ */
+bool cp932_tbl_to_utf8(std::string &ret, const char *str, int len);
+
+/**
+ * Decode Shift-JIS (cp932) text to UTF-16 using a lookup table.
+ * Output is identical to glibc's CP932 converter.
+ * @param ret	[out] UTF-16 string.
+ * @param str	[in] Shift-JIS text. (must not contain NULL bytes)
+ * @param len	[in] Length of str, in bytes.
+ * @return True on success; false if str contains an invalid sequence.
+ */
+bool cp932_tbl_to_utf16(std::u16string &ret, const char *str, int len);
+
+/**
+ * Decode cp1252 text to UTF-8 using a lookup table.
+ * @param ret	[out] UTF-8 string.
+ * @param str	[in] cp1252 text. (must not contain NULL bytes)
+ * @param len	[in] Length of str, in bytes.
+ * @return True on success; false if str contains an unassigned code point.
+ */
+bool cp1252_tbl_to_utf8(std::string &ret, const char *str, int len);
+
+/**
+ * Decode cp1252 text to UTF-16 using a lookup table.
+ * @param ret	[out] UTF-16 string.
+ * @param str	[in] cp1252 text. (must not contain NULL bytes)
+ * @param len	[in] Length of str, in bytes.
+ * @return True on success; false if str contains an unassigned code point.
+ */
+bool cp1252_tbl_to_utf16(std::u16string &ret, const char *str, int len);
+
+/**
+ * Decode Latin-1 (ISO-8859-1) text to UTF-8.
+ * This never fails, since all Latin-1 code points are assigned.
+ * @param ret	[out] UTF-8 string.
+ * @param str	[in] Latin-1 text. (must not contain NULL bytes)
+ * @param len	[in] Length of str, in bytes.
+ */
+void latin1_tbl_to_utf8(std::string &ret, const char *str, int len);
+
+/**
+ * Decode Latin-1 (ISO-8859-1) text to UTF-16.
+ * This never fails, since all Latin-1 code points are assigned.
+ * @param ret	[out] UTF-16 string.
+ * @param str	[in] Latin-1 text. (must not contain NULL bytes)
+ * @param len	[in] Length of str, in bytes.
+ */
+void latin1_tbl_to_utf16(std::u16string &ret, const char *str, int len);
+
+}
+
+#endif /* __ROMPROPERTIES_LIBRPBASE_TEXTFUNCS_TBL_HPP__ */
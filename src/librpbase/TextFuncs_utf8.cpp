@@ -0,0 +1,91 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * TextFuncs_utf8.cpp: Text encoding functions. (UTF-8 encoding kernels)   *
+ * Standard version. (C++ code only)                                       *
+ *                                                                         *
+ * Copyright (c) 2009-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "TextFuncs_utf8.hpp"
+
+namespace LibRpBase {
+
+/**
+ * Convert UTF-16 text to UTF-8.
+ * @tparam BE	[in] If true, the input is UTF-16BE; otherwise, UTF-16LE.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16 text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+template<bool BE>
+static inline int T_utf16_to_utf8_buf_cpp(char *mbs, const char16_t *wcs, int len)
+{
+	char *p = mbs;
+	const char16_t *const end = wcs + len;
+	while (wcs < end) {
+		if (!utf16_to_utf8_char<BE>(p, wcs, end)) {
+			return -1;
+		}
+	}
+	return static_cast<int>(p - mbs);
+}
+
+/**
+ * Convert UTF-16LE text to UTF-8.
+ * Standard version using regular C++ code.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16LE text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+int utf16le_to_utf8_buf_cpp(char *mbs, const char16_t *wcs, int len)
+{
+	return T_utf16_to_utf8_buf_cpp<false>(mbs, wcs, len);
+}
+
+/**
+ * Convert UTF-16BE text to UTF-8.
+ * Standard version using regular C++ code.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16BE text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+int utf16be_to_utf8_buf_cpp(char *mbs, const char16_t *wcs, int len)
+{
+	return T_utf16_to_utf8_buf_cpp<true>(mbs, wcs, len);
+}
+
+/**
+ * Convert Latin-1 text to UTF-8.
+ * Standard version using regular C++ code.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*2 bytes)
+ * @param str	[in] Latin-1 text.
+ * @param len	[in] Length of str, in bytes.
+ * @return Number of bytes written to mbs.
+ */
+int latin1_to_utf8_buf_cpp(char *mbs, const char *str, int len)
+{
+	char *p = mbs;
+	const char *const end = str + len;
+
+	// Copy runs of ASCII characters eight bytes at a time.
+	while (str < end) {
+		for (; end - str >= 8; str += 8, p += 8) {
+			uint64_t qword;
+			memcpy(&qword, str, 8);
+			if (qword & 0x8080808080808080ULL)
+				break;
+			memcpy(p, &qword, 8);
+		}
+		if (str >= end)
+			break;
+		latin1_to_utf8_char(p, str);
+	}
+	return static_cast<int>(p - mbs);
+}
+
+}
@@ -0,0 +1,304 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * TextFuncs_utf8.hpp: Text encoding functions. (UTF-8 encoding kernels)   *
+ *                                                                         *
+ * Copyright (c) 2009-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPBASE_TEXTFUNCS_UTF8_HPP__
+#define __ROMPROPERTIES_LIBRPBASE_TEXTFUNCS_UTF8_HPP__
+
+// NOTE: These functions are used internally by the OS-specific
+// text conversion functions. Use the functions in TextFuncs.hpp.
+
+#include "common.h"
+#include "librpcpu/byteswap.h"
+#include "librpcpu/cpu_dispatch.h"
+
+#if defined(RP_CPU_I386) || defined(RP_CPU_AMD64)
+# include "librpcpu/cpuflags_x86.h"
+# define TEXTFUNCS_HAS_SSE2 1
+# define TEXTFUNCS_HAS_AVX2 1
+#endif
+#ifdef RP_CPU_AMD64
+# define TEXTFUNCS_ALWAYS_HAS_SSE2 1
+#endif
+
+// C includes.
+#include <stdint.h>
+
+namespace LibRpBase {
+
+/**
+ * Convert one UTF-16 code point to UTF-8.
+ * Surrogate pairs are combined. Unpaired surrogates are invalid.
+ * @tparam BE		[in] If true, the input is UTF-16BE; otherwise, UTF-16LE.
+ * @param mbs		[in/out] UTF-8 output pointer. (advanced by 1-4 bytes)
+ * @param wcs		[in/out] UTF-16 input pointer. (advanced by 1-2 code units)
+ * @param end		[in] End of the UTF-16 input.
+ * @return True on success; false if the input is invalid.
+ */
+template<bool BE>
+static FORCEINLINE bool utf16_to_utf8_char(char *&mbs, const char16_t *&wcs, const char16_t *end)
+{
+	const uint16_t wc = (BE ? be16_to_cpu(wcs[0]) : le16_to_cpu(wcs[0]));
+	if (wc < 0x0080) {
+		*mbs++ = (char)wc;
+	} else if (wc < 0x0800) {
+		*mbs++ = (char)(0xC0 | (wc >> 6));
+		*mbs++ = (char)(0x80 | (wc & 0x3F));
+	} else if (wc < 0xD800 || wc >= 0xE000) {
+		*mbs++ = (char)(0xE0 | (wc >> 12));
+		*mbs++ = (char)(0x80 | ((wc >> 6) & 0x3F));
+		*mbs++ = (char)(0x80 | (wc & 0x3F));
+	} else {
+		// Surrogate pair.
+		if (wc >= 0xDC00 || end - wcs < 2) {
+			// Unpaired low surrogate, or truncated pair.
+			return false;
+		}
+		const uint16_t wc2 = (BE ? be16_to_cpu(wcs[1]) : le16_to_cpu(wcs[1]));
+		if (wc2 < 0xDC00 || wc2 >= 0xE000) {
+			// High surrogate isn't followed by a low surrogate.
+			return false;
+		}
+		const uint32_t cp = 0x10000 + (((wc & 0x3FF) << 10) | (wc2 & 0x3FF));
+		*mbs++ = (char)(0xF0 | (cp >> 18));
+		*mbs++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+		*mbs++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+		*mbs++ = (char)(0x80 | (cp & 0x3F));
+		wcs++;
+	}
+	wcs++;
+	return true;
+}
+
+/**
+ * Convert one Latin-1 character to UTF-8.
+ * @param mbs		[in/out] UTF-8 output pointer. (advanced by 1-2 bytes)
+ * @param str		[in/out] Latin-1 input pointer. (advanced by 1 byte)
+ */
+static FORCEINLINE void latin1_to_utf8_char(char *&mbs, const char *&str)
+{
+	const uint8_t ch = (uint8_t)*str++;
+	if (ch < 0x80) {
+		*mbs++ = (char)ch;
+	} else {
+		*mbs++ = (char)(0xC0 | (ch >> 6));
+		*mbs++ = (char)(0x80 | (ch & 0x3F));
+	}
+}
+
+/** UTF-16LE **/
+
+/**
+ * Convert UTF-16LE text to UTF-8.
+ * Standard version using regular C++ code.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16LE text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+int utf16le_to_utf8_buf_cpp(char *mbs, const char16_t *wcs, int len);
+
+#ifdef TEXTFUNCS_HAS_SSE2
+/**
+ * Convert UTF-16LE text to UTF-8.
+ * SSE2-optimized version.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16LE text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+int utf16le_to_utf8_buf_sse2(char *mbs, const char16_t *wcs, int len);
+#endif /* TEXTFUNCS_HAS_SSE2 */
+
+#ifdef TEXTFUNCS_HAS_AVX2
+/**
+ * Convert UTF-16LE text to UTF-8.
+ * AVX2-optimized version.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16LE text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+int utf16le_to_utf8_buf_avx2(char *mbs, const char16_t *wcs, int len);
+#endif /* TEXTFUNCS_HAS_AVX2 */
+
+/**
+ * Convert UTF-16LE text to UTF-8.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16LE text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+IFUNC_INLINE int utf16le_to_utf8_buf(char *mbs, const char16_t *wcs, int len);
+
+/** UTF-16BE **/
+
+/**
+ * Convert UTF-16BE text to UTF-8.
+ * Standard version using regular C++ code.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16BE text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+int utf16be_to_utf8_buf_cpp(char *mbs, const char16_t *wcs, int len);
+
+#ifdef TEXTFUNCS_HAS_SSE2
+/**
+ * Convert UTF-16BE text to UTF-8.
+ * SSE2-optimized version.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16BE text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+int utf16be_to_utf8_buf_sse2(char *mbs, const char16_t *wcs, int len);
+#endif /* TEXTFUNCS_HAS_SSE2 */
+
+#ifdef TEXTFUNCS_HAS_AVX2
+/**
+ * Convert UTF-16BE text to UTF-8.
+ * AVX2-optimized version.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16BE text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+int utf16be_to_utf8_buf_avx2(char *mbs, const char16_t *wcs, int len);
+#endif /* TEXTFUNCS_HAS_AVX2 */
+
+/**
+ * Convert UTF-16BE text to UTF-8.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16BE text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+IFUNC_INLINE int utf16be_to_utf8_buf(char *mbs, const char16_t *wcs, int len);
+
+/** Latin-1 **/
+
+/**
+ * Convert Latin-1 text to UTF-8.
+ * Standard version using regular C++ code.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*2 bytes)
+ * @param str	[in] Latin-1 text.
+ * @param len	[in] Length of str, in bytes.
+ * @return Number of bytes written to mbs.
+ */
+int latin1_to_utf8_buf_cpp(char *mbs, const char *str, int len);
+
+#ifdef TEXTFUNCS_HAS_SSE2
+/**
+ * Convert Latin-1 text to UTF-8.
+ * SSE2-optimized version.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*2 bytes)
+ * @param str	[in] Latin-1 text.
+ * @param len	[in] Length of str, in bytes.
+ * @return Number of bytes written to mbs.
+ */
+int latin1_to_utf8_buf_sse2(char *mbs, const char *str, int len);
+#endif /* TEXTFUNCS_HAS_SSE2 */
+
+#ifdef TEXTFUNCS_HAS_AVX2
+/**
+ * Convert Latin-1 text to UTF-8.
+ * AVX2-optimized version.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*2 bytes)
+ * @param str	[in] Latin-1 text.
+ * @param len	[in] Length of str, in bytes.
+ * @return Number of bytes written to mbs.
+ */
+int latin1_to_utf8_buf_avx2(char *mbs, const char *str, int len);
+#endif /* TEXTFUNCS_HAS_AVX2 */
+
+/**
+ * Convert Latin-1 text to UTF-8.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*2 bytes)
+ * @param str	[in] Latin-1 text.
+ * @param len	[in] Length of str, in bytes.
+ * @return Number of bytes written to mbs.
+ */
+IFUNC_INLINE int latin1_to_utf8_buf(char *mbs, const char *str, int len);
+
+#if !defined(RP_HAS_IFUNC)
+/* System does not have IFUNC. Use inline dispatch functions. */
+
+inline int utf16le_to_utf8_buf(char *mbs, const char16_t *wcs, int len)
+{
+#ifdef TEXTFUNCS_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return utf16le_to_utf8_buf_avx2(mbs, wcs, len);
+	} else
+#endif /* TEXTFUNCS_HAS_AVX2 */
+#ifdef TEXTFUNCS_ALWAYS_HAS_SSE2
+	{
+		return utf16le_to_utf8_buf_sse2(mbs, wcs, len);
+	}
+#else /* !TEXTFUNCS_ALWAYS_HAS_SSE2 */
+# ifdef TEXTFUNCS_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		return utf16le_to_utf8_buf_sse2(mbs, wcs, len);
+	} else
+# endif /* TEXTFUNCS_HAS_SSE2 */
+	{
+		return utf16le_to_utf8_buf_cpp(mbs, wcs, len);
+	}
+#endif /* TEXTFUNCS_ALWAYS_HAS_SSE2 */
+}
+
+inline int utf16be_to_utf8_buf(char *mbs, const char16_t *wcs, int len)
+{
+#ifdef TEXTFUNCS_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return utf16be_to_utf8_buf_avx2(mbs, wcs, len);
+	} else
+#endif /* TEXTFUNCS_HAS_AVX2 */
+#ifdef TEXTFUNCS_ALWAYS_HAS_SSE2
+	{
+		return utf16be_to_utf8_buf_sse2(mbs, wcs, len);
+	}
+#else /* !TEXTFUNCS_ALWAYS_HAS_SSE2 */
+# ifdef TEXTFUNCS_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		return utf16be_to_utf8_buf_sse2(mbs, wcs, len);
+	} else
+# endif /* TEXTFUNCS_HAS_SSE2 */
+	{
+		return utf16be_to_utf8_buf_cpp(mbs, wcs, len);
+	}
+#endif /* TEXTFUNCS_ALWAYS_HAS_SSE2 */
+}
+
+inline int latin1_to_utf8_buf(char *mbs, const char *str, int len)
+{
+#ifdef TEXTFUNCS_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return latin1_to_utf8_buf_avx2(mbs, str, len);
+	} else
+#endif /* TEXTFUNCS_HAS_AVX2 */
+#ifdef TEXTFUNCS_ALWAYS_HAS_SSE2
+	{
+		return latin1_to_utf8_buf_sse2(mbs, str, len);
+	}
+#else /* !TEXTFUNCS_ALWAYS_HAS_SSE2 */
+# ifdef TEXTFUNCS_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		return latin1_to_utf8_buf_sse2(mbs, str, len);
+	} else
+# endif /* TEXTFUNCS_HAS_SSE2 */
+	{
+		return latin1_to_utf8_buf_cpp(mbs, str, len);
+	}
+#endif /* TEXTFUNCS_ALWAYS_HAS_SSE2 */
+}
+
+#endif /* !defined(RP_HAS_IFUNC) */
+
+}
+
+#endif /* __ROMPROPERTIES_LIBRPBASE_TEXTFUNCS_UTF8_HPP__ */
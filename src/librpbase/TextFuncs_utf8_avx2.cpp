@@ -0,0 +1,165 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * TextFuncs_utf8.cpp: Text encoding functions. (UTF-8 encoding kernels)   *
+ * AVX2-optimized version.                                                 *
+ *                                                                         *
+ * Copyright (c) 2009-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "TextFuncs_utf8.hpp"
+#include "librpcpu/bitstuff.h"
+
+// AVX2 intrinsics.
+#include <immintrin.h>
+
+// MSVC complains when the high bit is set in hex values
+// when setting SSE2 registers.
+#ifdef _MSC_VER
+# pragma warning(push)
+# pragma warning(disable: 4309)
+#endif
+
+namespace LibRpBase {
+
+/**
+ * Convert UTF-16 text to UTF-8.
+ * AVX2-optimized version.
+ *
+ * Same algorithm as the SSE2 version, but using blocks of 32 code units.
+ * VPACKUSWB operates on each 128-bit lane separately, so the packed
+ * qwords need to be reordered using VPERMQ.
+ *
+ * @tparam BE	[in] If true, the input is UTF-16BE; otherwise, UTF-16LE.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16 text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+template<bool BE>
+static inline int T_utf16_to_utf8_buf_avx2(char *mbs, const char16_t *wcs, int len)
+{
+	char *p = mbs;
+	const char16_t *const end = wcs + len;
+	const __m256i nonAscii_mask = _mm256_set1_epi16(0xFF80);
+	const __m256i zero = _mm256_setzero_si256();
+
+	while (end - wcs >= 32) {
+		__m256i ymm0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&wcs[0]));
+		__m256i ymm1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&wcs[16]));
+		if (BE) {
+			ymm0 = _mm256_or_si256(_mm256_slli_epi16(ymm0, 8), _mm256_srli_epi16(ymm0, 8));
+			ymm1 = _mm256_or_si256(_mm256_slli_epi16(ymm1, 8), _mm256_srli_epi16(ymm1, 8));
+		}
+
+		// One bit per code unit: 1 if ASCII; 0 if not.
+		const __m256i isAscii = _mm256_permute4x64_epi64(_mm256_packs_epi16(
+			_mm256_cmpeq_epi16(_mm256_and_si256(ymm0, nonAscii_mask), zero),
+			_mm256_cmpeq_epi16(_mm256_and_si256(ymm1, nonAscii_mask), zero)), 0xD8);
+		const unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(isAscii));
+
+		// Store all 32 characters. If the block isn't entirely ASCII,
+		// the non-ASCII bytes will be overwritten below.
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p),
+			_mm256_permute4x64_epi64(_mm256_packus_epi16(ymm0, ymm1), 0xD8));
+		if (mask == 0xFFFFFFFFU) {
+			wcs += 32;
+			p += 32;
+			continue;
+		}
+
+		// Skip the ASCII prefix and convert the rest of the block.
+		const unsigned int n = ctz(~mask);
+		const char16_t *const blockEnd = wcs + 32;
+		wcs += n;
+		p += n;
+		while (wcs < blockEnd) {
+			if (!utf16_to_utf8_char<BE>(p, wcs, end)) {
+				return -1;
+			}
+		}
+	}
+
+	// Remaining code units.
+	while (wcs < end) {
+		if (!utf16_to_utf8_char<BE>(p, wcs, end)) {
+			return -1;
+		}
+	}
+	return static_cast<int>(p - mbs);
+}
+
+/**
+ * Convert UTF-16LE text to UTF-8.
+ * AVX2-optimized version.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16LE text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+int utf16le_to_utf8_buf_avx2(char *mbs, const char16_t *wcs, int len)
+{
+	return T_utf16_to_utf8_buf_avx2<false>(mbs, wcs, len);
+}
+
+/**
+ * Convert UTF-16BE text to UTF-8.
+ * AVX2-optimized version.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16BE text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+int utf16be_to_utf8_buf_avx2(char *mbs, const char16_t *wcs, int len)
+{
+	return T_utf16_to_utf8_buf_avx2<true>(mbs, wcs, len);
+}
+
+/**
+ * Convert Latin-1 text to UTF-8.
+ * AVX2-optimized version.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*2 bytes)
+ * @param str	[in] Latin-1 text.
+ * @param len	[in] Length of str, in bytes.
+ * @return Number of bytes written to mbs.
+ */
+int latin1_to_utf8_buf_avx2(char *mbs, const char *str, int len)
+{
+	char *p = mbs;
+	const char *const end = str + len;
+
+	while (end - str >= 32) {
+		const __m256i ymm0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), ymm0);
+
+		// One bit per byte: 1 if non-ASCII; 0 if ASCII.
+		const unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(ymm0));
+		if (mask == 0) {
+			str += 32;
+			p += 32;
+			continue;
+		}
+
+		// Skip the ASCII prefix and convert the rest of the block.
+		const unsigned int n = ctz(mask);
+		const char *const blockEnd = str + 32;
+		str += n;
+		p += n;
+		while (str < blockEnd) {
+			latin1_to_utf8_char(p, str);
+		}
+	}
+
+	// Remaining bytes.
+	while (str < end) {
+		latin1_to_utf8_char(p, str);
+	}
+	return static_cast<int>(p - mbs);
+}
+
+}
+
+#ifdef _MSC_VER
+# pragma warning(pop)
+#endif
@@ -0,0 +1,165 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * TextFuncs_utf8.cpp: Text encoding functions. (UTF-8 encoding kernels)   *
+ * SSE2-optimized version.                                                 *
+ *                                                                         *
+ * Copyright (c) 2009-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "TextFuncs_utf8.hpp"
+#include "librpcpu/bitstuff.h"
+
+// SSE2 intrinsics.
+#include <emmintrin.h>
+
+// MSVC complains when the high bit is set in hex values
+// when setting SSE2 registers.
+#ifdef _MSC_VER
+# pragma warning(push)
+# pragma warning(disable: 4309)
+#endif
+
+namespace LibRpBase {
+
+/**
+ * Convert UTF-16 text to UTF-8.
+ * SSE2-optimized version.
+ *
+ * Blocks of 16 code units that are entirely ASCII are narrowed
+ * using PACKUSWB. If a block has non-ASCII characters, the ASCII
+ * prefix is written using the same store, and the rest of the
+ * block is converted using the standard code.
+ *
+ * @tparam BE	[in] If true, the input is UTF-16BE; otherwise, UTF-16LE.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16 text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+template<bool BE>
+static inline int T_utf16_to_utf8_buf_sse2(char *mbs, const char16_t *wcs, int len)
+{
+	char *p = mbs;
+	const char16_t *const end = wcs + len;
+	const __m128i nonAscii_mask = _mm_set1_epi16(0xFF80);
+	const __m128i zero = _mm_setzero_si128();
+
+	while (end - wcs >= 16) {
+		__m128i xmm0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&wcs[0]));
+		__m128i xmm1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&wcs[8]));
+		if (BE) {
+			xmm0 = _mm_or_si128(_mm_slli_epi16(xmm0, 8), _mm_srli_epi16(xmm0, 8));
+			xmm1 = _mm_or_si128(_mm_slli_epi16(xmm1, 8), _mm_srli_epi16(xmm1, 8));
+		}
+
+		// One bit per code unit: 1 if ASCII; 0 if not.
+		const __m128i isAscii = _mm_packs_epi16(
+			_mm_cmpeq_epi16(_mm_and_si128(xmm0, nonAscii_mask), zero),
+			_mm_cmpeq_epi16(_mm_and_si128(xmm1, nonAscii_mask), zero));
+		const unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(isAscii));
+
+		// Store all 16 characters. If the block isn't entirely ASCII,
+		// the non-ASCII bytes will be overwritten below.
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_packus_epi16(xmm0, xmm1));
+		if (mask == 0xFFFF) {
+			wcs += 16;
+			p += 16;
+			continue;
+		}
+
+		// Skip the ASCII prefix and convert the rest of the block.
+		const unsigned int n = ctz(~mask);
+		const char16_t *const blockEnd = wcs + 16;
+		wcs += n;
+		p += n;
+		while (wcs < blockEnd) {
+			if (!utf16_to_utf8_char<BE>(p, wcs, end)) {
+				return -1;
+			}
+		}
+	}
+
+	// Remaining code units.
+	while (wcs < end) {
+		if (!utf16_to_utf8_char<BE>(p, wcs, end)) {
+			return -1;
+		}
+	}
+	return static_cast<int>(p - mbs);
+}
+
+/**
+ * Convert UTF-16LE text to UTF-8.
+ * SSE2-optimized version.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16LE text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+int utf16le_to_utf8_buf_sse2(char *mbs, const char16_t *wcs, int len)
+{
+	return T_utf16_to_utf8_buf_sse2<false>(mbs, wcs, len);
+}
+
+/**
+ * Convert UTF-16BE text to UTF-8.
+ * SSE2-optimized version.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*3 bytes)
+ * @param wcs	[in] UTF-16BE text.
+ * @param len	[in] Length of wcs, in code units.
+ * @return Number of bytes written to mbs, or -1 if wcs is invalid.
+ */
+int utf16be_to_utf8_buf_sse2(char *mbs, const char16_t *wcs, int len)
+{
+	return T_utf16_to_utf8_buf_sse2<true>(mbs, wcs, len);
+}
+
+/**
+ * Convert Latin-1 text to UTF-8.
+ * SSE2-optimized version.
+ * @param mbs	[out] UTF-8 buffer. (must have room for len*2 bytes)
+ * @param str	[in] Latin-1 text.
+ * @param len	[in] Length of str, in bytes.
+ * @return Number of bytes written to mbs.
+ */
+int latin1_to_utf8_buf_sse2(char *mbs, const char *str, int len)
+{
+	char *p = mbs;
+	const char *const end = str + len;
+
+	while (end - str >= 16) {
+		const __m128i xmm0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p), xmm0);
+
+		// One bit per byte: 1 if non-ASCII; 0 if ASCII.
+		const unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(xmm0));
+		if (mask == 0) {
+			str += 16;
+			p += 16;
+			continue;
+		}
+
+		// Skip the ASCII prefix and convert the rest of the block.
+		const unsigned int n = ctz(mask);
+		const char *const blockEnd = str + 16;
+		str += n;
+		p += n;
+		while (str < blockEnd) {
+			latin1_to_utf8_char(p, str);
+		}
+	}
+
+	// Remaining bytes.
+	while (str < end) {
+		latin1_to_utf8_char(p, str);
+	}
+	return static_cast<int>(p - mbs);
+}
+
+}
+
+#ifdef _MSC_VER
+# pragma warning(pop)
+#endif
@@ -12,6 +12,9 @@
 #include "Config.hpp"
 #include "ConfReader_p.hpp"
 
+// C includes.
+#include <limits.h>
+
 // C++ STL classes.
 using std::string;
 using std::unique_ptr;
@@ -82,6 +85,10 @@ class ConfigPrivate : public ConfReaderPrivate
 		bool useIntIconForSmallSizes;
 		bool downloadHighResScans;
 		bool storeFileOriginInfo;
+		bool persistentDownloader;
+		unsigned int maxCacheSize;	// MiB; 0 == unlimited
+		unsigned int maxCacheFiles;	// 0 == unlimited
+		unsigned int maxConnectionsPerHost;	// 1-16
 
 		// DMG title screen mode. [index is ROM type]
 		Config::DMG_TitleScreen_Mode dmgTSMode[Config::DMG_TitleScreen_Mode::DMG_TS_MAX];
@@ -89,6 +96,7 @@ class ConfigPrivate : public ConfReaderPrivate
 		// Other options.
 		bool showDangerousPermissionsOverlayIcon;
 		bool enableThumbnailOnNetworkFS;
+		Config::ThumbnailPngProfile thumbnailPngProfile;
 };
 
 /** ConfigPrivate **/
@@ -123,10 +131,13 @@ ConfigPrivate::ConfigPrivate()
 	, useIntIconForSmallSizes(true)
 	, downloadHighResScans(true)
 	, storeFileOriginInfo(true)
+	, persistentDownloader(true)
 	/* Overlay icon */
 	, showDangerousPermissionsOverlayIcon(true)
 	/* Enable thumbnailing and metadata on network FS */
 	, enableThumbnailOnNetworkFS(false)
+	/* PNG compression profile for thumbnails */
+	, thumbnailPngProfile(Config::ThumbnailPngProfile::TPP_FAST)
 {
 	// NOTE: Configuration is also initialized in the reset() function.
 	memset(dmgTSMode, 0, sizeof(dmgTSMode));
@@ -153,6 +164,10 @@ void ConfigPrivate::reset(void)
 	useIntIconForSmallSizes = true;
 	downloadHighResScans = true;
 	storeFileOriginInfo = true;
+	persistentDownloader = true;
+	maxCacheSize = 0;
+	maxCacheFiles = 0;
+	maxConnectionsPerHost = Config::DEFAULT_MAX_CONNECTIONS_PER_HOST;
 
 	// DMG title screen mode.
 	dmgTSMode[Config::DMG_TitleScreen_Mode::DMG_TS_DMG] = Config::DMG_TitleScreen_Mode::DMG_TS_DMG;
@@ -163,6 +178,8 @@ void ConfigPrivate::reset(void)
 	showDangerousPermissionsOverlayIcon = true;
 	// Enable thumbnail and metadata on network FS
 	enableThumbnailOnNetworkFS = false;
+	// PNG compression profile for thumbnails
+	thumbnailPngProfile = Config::ThumbnailPngProfile::TPP_FAST;
 }
 
 /**
@@ -189,7 +206,34 @@ int ConfigPrivate::processConfigLine(const char *section, const char *name, cons
 
 	// Which section are we in?
 	if (!strcasecmp(section, "Downloads")) {
-		// Downloads. Check for one of the three boolean options.
+		// Downloads. Check for the numeric options first.
+		unsigned int *uparam = nullptr;
+		if (!strcasecmp(name, "MaxCacheSize")) {
+			uparam = &maxCacheSize;
+		} else if (!strcasecmp(name, "MaxCacheFiles")) {
+			uparam = &maxCacheFiles;
+		} else if (!strcasecmp(name, "MaxConnectionsPerHost")) {
+			uparam = &maxConnectionsPerHost;
+		}
+		if (uparam) {
+			// Parse the value.
+			// Negative or invalid values are ignored.
+			char *endptr = nullptr;
+			const unsigned long lval = strtoul(value, &endptr, 10);
+			if (endptr && *endptr == '\0' && value[0] != '-' && lval <= UINT_MAX) {
+				*uparam = static_cast<unsigned int>(lval);
+			}
+
+			// Connections per host must be between 1 and 16.
+			if (maxConnectionsPerHost < 1) {
+				maxConnectionsPerHost = 1;
+			} else if (maxConnectionsPerHost > Config::MAX_CONNECTIONS_PER_HOST) {
+				maxConnectionsPerHost = Config::MAX_CONNECTIONS_PER_HOST;
+			}
+			return 1;
+		}
+
+		// Check for one of the boolean options.
 		bool *param;
 		if (!strcasecmp(name, "ExtImageDownload")) {
 			param = &extImgDownloadEnabled;
@@ -199,6 +243,8 @@ int ConfigPrivate::processConfigLine(const char *section, const char *name, cons
 			param = &downloadHighResScans;
 		} else if (!strcasecmp(name, "StoreFileOriginInfo")) {
 			param = &storeFileOriginInfo;
+		} else if (!strcasecmp(name, "PersistentDownloader")) {
+			param = &persistentDownloader;
 		} else {
 			// Invalid option.
 			return 1;
@@ -243,7 +289,20 @@ int ConfigPrivate::processConfigLine(const char *section, const char *name, cons
 
 		dmgTSMode[dmg_key] = dmg_value;
 	} else if (!strcasecmp(section, "Options")) {
-		// Options.
+		// Options. Check for the non-boolean options first.
+		if (!strcasecmp(name, "ThumbnailPngProfile")) {
+			if (!strcasecmp(value, "Fast")) {
+				thumbnailPngProfile = Config::ThumbnailPngProfile::TPP_FAST;
+			} else if (!strcasecmp(value, "Balanced")) {
+				thumbnailPngProfile = Config::ThumbnailPngProfile::TPP_BALANCED;
+			} else if (!strcasecmp(value, "Small")) {
+				thumbnailPngProfile = Config::ThumbnailPngProfile::TPP_SMALL;
+			} else {
+				// TODO: Show a warning or something?
+			}
+			return 1;
+		}
+
 		bool *param;
 		if (!strcasecmp(name, "ShowDangerousPermissionsOverlayIcon")) {
 			param = &showDangerousPermissionsOverlayIcon;
@@ -555,6 +614,50 @@ bool Config::storeFileOriginInfo(void) const
 	return d->storeFileOriginInfo;
 }
 
+/**
+ * Keep rp-download running between downloads?
+ * NOTE: Call load() before using this function.
+ * @return True if we should; false if not.
+ */
+bool Config::persistentDownloader(void) const
+{
+	RP_D(const Config);
+	return d->persistentDownloader;
+}
+
+/**
+ * Maximum size of the download cache.
+ * NOTE: Call load() before using this function.
+ * @return Maximum size, in MiB. (0 == unlimited)
+ */
+unsigned int Config::maxCacheSize(void) const
+{
+	RP_D(const Config);
+	return d->maxCacheSize;
+}
+
+/**
+ * Maximum number of files in the download cache.
+ * NOTE: Call load() before using this function.
+ * @return Maximum number of files. (0 == unlimited)
+ */
+unsigned int Config::maxCacheFiles(void) const
+{
+	RP_D(const Config);
+	return d->maxCacheFiles;
+}
+
+/**
+ * Maximum number of concurrent connections per host for rp-download.
+ * NOTE: Call load() before using this function.
+ * @return Maximum number of connections per host. (1-16)
+ */
+unsigned int Config::maxConnectionsPerHost(void) const
+{
+	RP_D(const Config);
+	return d->maxConnectionsPerHost;
+}
+
 /** DMG title screen mode **/
 
 /**
@@ -601,4 +704,15 @@ bool Config::enableThumbnailOnNetworkFS(void) const
 	return d->enableThumbnailOnNetworkFS;
 }
 
+/**
+ * PNG compression profile for thumbnails.
+ * NOTE: Call load() before using this function.
+ * @return PNG compression profile.
+ */
+Config::ThumbnailPngProfile Config::thumbnailPngProfile(void) const
+{
+	RP_D(const Config);
+	return d->thumbnailPngProfile;
+}
+
 }
@@ -115,6 +115,41 @@ class Config : public ConfReader
 		 */
 		bool storeFileOriginInfo(void) const;
 
+		/**
+		 * Keep rp-download running between downloads?
+		 * This allows connections to be reused.
+		 * NOTE: Call load() before using this function.
+		 * @return True if we should; false if not.
+		 */
+		bool persistentDownloader(void) const;
+
+		/**
+		 * Maximum size of the download cache.
+		 * Least-recently-used files are removed if the cache is larger.
+		 * NOTE: Call load() before using this function.
+		 * @return Maximum size, in MiB. (0 == unlimited)
+		 */
+		unsigned int maxCacheSize(void) const;
+
+		/**
+		 * Maximum number of files in the download cache.
+		 * Least-recently-used files are removed if the cache has more files.
+		 * NOTE: Call load() before using this function.
+		 * @return Maximum number of files. (0 == unlimited)
+		 */
+		unsigned int maxCacheFiles(void) const;
+
+		// Maximum number of concurrent connections per host.
+		static const unsigned int DEFAULT_MAX_CONNECTIONS_PER_HOST = 2;
+		static const unsigned int MAX_CONNECTIONS_PER_HOST = 16;
+
+		/**
+		 * Maximum number of concurrent connections per host for rp-download.
+		 * NOTE: Call load() before using this function.
+		 * @return Maximum number of connections per host. (1-16)
+		 */
+		unsigned int maxConnectionsPerHost(void) const;
+
 		/** DMG title screen mode **/
 
 		enum DMG_TitleScreen_Mode : uint8_t {
@@ -147,6 +182,22 @@ class Config : public ConfReader
 		 * @return True if we should enable; false if not.
 		 */
 		bool enableThumbnailOnNetworkFS(void) const;
+
+		enum ThumbnailPngProfile : uint8_t {
+			TPP_FAST,	// Fastest encoding; larger files.
+			TPP_BALANCED,	// Default zlib settings.
+			TPP_SMALL,	// Smallest files; much slower.
+
+			TPP_MAX
+		};
+
+		/**
+		 * PNG compression profile for thumbnails.
+		 * Values match RpPngWriter::Profile.
+		 * NOTE: Call load() before using this function.
+		 * @return PNG compression profile.
+		 */
+		ThumbnailPngProfile thumbnailPngProfile(void) const;
 };
 
 }
@@ -0,0 +1,732 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * AesNI.cpp: AES decryption class using AES-NI instructions.              *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// References:
+// - Intel Advanced Encryption Standard (AES) New Instructions Set
+//   https://www.intel.com/content/dam/doc/white-paper/advanced-encryption-standard-new-instructions-set-paper.pdf
+
+#include "stdafx.h"
+#include "config.librpbase.h"
+
+#include "AesNI.hpp"
+#include "librpcpu/cpuflags_x86.h"
+
+// AES-NI intrinsics.
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+// Number of blocks to process at once.
+// AES-NI instructions have a latency of 4-7 cycles,
+// but can be issued every 1-2 cycles.
+#define AESNI_PIPELINE_BLOCKS 8
+
+namespace LibRpBase {
+
+class AesNIPrivate
+{
+	public:
+		AesNIPrivate();
+		~AesNIPrivate();
+
+	private:
+		RP_DISABLE_COPY(AesNIPrivate)
+
+	public:
+		// Number of rounds. (10, 12, or 14; 0 if no key is set.)
+		int rounds;
+
+		// Round keys.
+		// Stored unaligned, since the private class
+		// might not be 16-byte aligned on 32-bit systems.
+		// The keys are loaded into registers for each operation.
+		uint8_t enc_keys[15][16];	// Encryption (CTR)
+		uint8_t dec_keys[15][16];	// Decryption (ECB, CBC)
+
+		// CBC: Initialization vector.
+		// CTR: Counter.
+		uint8_t iv[16];
+
+		IAesCipher::ChainingMode chainingMode;
+
+	public:
+		/**
+		 * Expand an AES key into encryption and decryption round keys.
+		 * @param pKey	[in] Key data.
+		 * @param size	[in] Size of pKey, in bytes. (16, 24, or 32)
+		 */
+		void expandKey(const uint8_t *RESTRICT pKey, size_t size);
+
+		/**
+		 * Decrypt data using ECB.
+		 * @param pData	[in/out] Data.
+		 * @param blocks	[in] Number of 16-byte blocks.
+		 */
+		void decryptECB(uint8_t *RESTRICT pData, size_t blocks) const;
+
+		/**
+		 * Decrypt data using CBC.
+		 * The IV is updated for the next block.
+		 * @param pData	[in/out] Data.
+		 * @param blocks	[in] Number of 16-byte blocks.
+		 */
+		void decryptCBC(uint8_t *RESTRICT pData, size_t blocks);
+
+		/**
+		 * Decrypt data using CTR.
+		 * The counter is updated for the next block.
+		 * @param pData	[in/out] Data.
+		 * @param blocks	[in] Number of 16-byte blocks.
+		 */
+		void decryptCTR(uint8_t *RESTRICT pData, size_t blocks);
+};
+
+/** Key expansion helpers **/
+
+/**
+ * AES-128 key expansion helper.
+ * @param t1 Previous round key.
+ * @param t2 Result of aeskeygenassist.
+ * @return Next round key.
+ */
+static FORCEINLINE __m128i aes128_assist(__m128i t1, __m128i t2)
+{
+	t2 = _mm_shuffle_epi32(t2, 0xFF);
+	__m128i t3 = _mm_slli_si128(t1, 4);
+	t1 = _mm_xor_si128(t1, t3);
+	t3 = _mm_slli_si128(t3, 4);
+	t1 = _mm_xor_si128(t1, t3);
+	t3 = _mm_slli_si128(t3, 4);
+	t1 = _mm_xor_si128(t1, t3);
+	return _mm_xor_si128(t1, t2);
+}
+
+/**
+ * AES-192 key expansion helper.
+ * @param t1 [in/out] First 128 bits of the key state.
+ * @param t2 [in] Result of aeskeygenassist.
+ * @param t3 [in/out] Last 64 bits of the key state.
+ */
+static FORCEINLINE void aes192_assist(__m128i &t1, __m128i t2, __m128i &t3)
+{
+	t2 = _mm_shuffle_epi32(t2, 0x55);
+	__m128i t4 = _mm_slli_si128(t1, 4);
+	t1 = _mm_xor_si128(t1, t4);
+	t4 = _mm_slli_si128(t4, 4);
+	t1 = _mm_xor_si128(t1, t4);
+	t4 = _mm_slli_si128(t4, 4);
+	t1 = _mm_xor_si128(t1, t4);
+	t1 = _mm_xor_si128(t1, t2);
+	t2 = _mm_shuffle_epi32(t1, 0xFF);
+	t4 = _mm_slli_si128(t3, 4);
+	t3 = _mm_xor_si128(t3, t4);
+	t3 = _mm_xor_si128(t3, t2);
+}
+
+/**
+ * Combine the low 64 bits of a and the low 64 bits of b.
+ * @param a
+ * @param b
+ * @return { a.lo, b.lo }
+ */
+static FORCEINLINE __m128i shuffle_lo_lo(__m128i a, __m128i b)
+{
+	return _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b), 0));
+}
+
+/**
+ * Combine the high 64 bits of a and the low 64 bits of b.
+ * @param a
+ * @param b
+ * @return { a.hi, b.lo }
+ */
+static FORCEINLINE __m128i shuffle_hi_lo(__m128i a, __m128i b)
+{
+	return _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b), 1));
+}
+
+/**
+ * AES-256 key expansion helper. (even round keys)
+ * @param t1 Previous even round key.
+ * @param t2 Result of aeskeygenassist.
+ * @return Next even round key.
+ */
+static FORCEINLINE __m128i aes256_assist_1(__m128i t1, __m128i t2)
+{
+	// Same as AES-128.
+	return aes128_assist(t1, t2);
+}
+
+/**
+ * AES-256 key expansion helper. (odd round keys)
+ * @param t1 Current even round key.
+ * @param t3 Previous odd round key.
+ * @return Next odd round key.
+ */
+static FORCEINLINE __m128i aes256_assist_2(__m128i t1, __m128i t3)
+{
+	const __m128i t2 = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(t1, 0x00), 0xAA);
+	__m128i t4 = _mm_slli_si128(t3, 4);
+	t3 = _mm_xor_si128(t3, t4);
+	t4 = _mm_slli_si128(t4, 4);
+	t3 = _mm_xor_si128(t3, t4);
+	t4 = _mm_slli_si128(t4, 4);
+	t3 = _mm_xor_si128(t3, t4);
+	return _mm_xor_si128(t3, t2);
+}
+
+/** AesNIPrivate **/
+
+AesNIPrivate::AesNIPrivate()
+	: rounds(0)
+	, chainingMode(IAesCipher::CM_ECB)
+{
+	// Clear the keys.
+	memset(enc_keys, 0, sizeof(enc_keys));
+	memset(dec_keys, 0, sizeof(dec_keys));
+	memset(iv, 0, sizeof(iv));
+}
+
+AesNIPrivate::~AesNIPrivate()
+{
+	// Clear the keys.
+	memset(enc_keys, 0, sizeof(enc_keys));
+	memset(dec_keys, 0, sizeof(dec_keys));
+}
+
+/**
+ * Expand an AES key into encryption and decryption round keys.
+ * @param pKey	[in] Key data.
+ * @param size	[in] Size of pKey, in bytes. (16, 24, or 32)
+ */
+void AesNIPrivate::expandKey(const uint8_t *RESTRICT pKey, size_t size)
+{
+	__m128i ek[15];
+
+	// Copy the key to a 32-byte buffer so the AES-192
+	// key can be loaded with 128-bit loads.
+	uint8_t key_buf[32];
+	memset(key_buf, 0, sizeof(key_buf));
+	memcpy(key_buf, pKey, size);
+	__m128i t1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&key_buf[0]));
+	__m128i t3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&key_buf[16]));
+	memset(key_buf, 0, sizeof(key_buf));
+
+	switch (size) {
+		case 16:
+			rounds = 10;
+			ek[0] = t1;
+#define AES128_ROUND(n, rcon) \
+			ek[n] = aes128_assist(ek[n-1], _mm_aeskeygenassist_si128(ek[n-1], rcon))
+			AES128_ROUND( 1, 0x01);
+			AES128_ROUND( 2, 0x02);
+			AES128_ROUND( 3, 0x04);
+			AES128_ROUND( 4, 0x08);
+			AES128_ROUND( 5, 0x10);
+			AES128_ROUND( 6, 0x20);
+			AES128_ROUND( 7, 0x40);
+			AES128_ROUND( 8, 0x80);
+			AES128_ROUND( 9, 0x1B);
+			AES128_ROUND(10, 0x36);
+#undef AES128_ROUND
+			break;
+
+		case 24:
+			// Each aeskeygenassist produces 192 bits of round keys,
+			// so they have to be split across 128-bit round keys.
+			rounds = 12;
+			ek[0] = t1;
+			ek[1] = t3;
+#define AES192_ASSIST(rcon) \
+			aes192_assist(t1, _mm_aeskeygenassist_si128(t3, rcon), t3)
+			AES192_ASSIST(0x01);
+			ek[1] = shuffle_lo_lo(ek[1], t1);
+			ek[2] = shuffle_hi_lo(t1, t3);
+			AES192_ASSIST(0x02);
+			ek[3] = t1;
+			ek[4] = t3;
+			AES192_ASSIST(0x04);
+			ek[4] = shuffle_lo_lo(ek[4], t1);
+			ek[5] = shuffle_hi_lo(t1, t3);
+			AES192_ASSIST(0x08);
+			ek[6] = t1;
+			ek[7] = t3;
+			AES192_ASSIST(0x10);
+			ek[7] = shuffle_lo_lo(ek[7], t1);
+			ek[8] = shuffle_hi_lo(t1, t3);
+			AES192_ASSIST(0x20);
+			ek[9] = t1;
+			ek[10] = t3;
+			AES192_ASSIST(0x40);
+			ek[10] = shuffle_lo_lo(ek[10], t1);
+			ek[11] = shuffle_hi_lo(t1, t3);
+			AES192_ASSIST(0x80);
+			ek[12] = t1;
+#undef AES192_ASSIST
+			break;
+
+		case 32:
+			rounds = 14;
+			ek[0] = t1;
+			ek[1] = t3;
+#define AES256_ROUND(n, rcon) do { \
+				t1 = aes256_assist_1(t1, _mm_aeskeygenassist_si128(t3, rcon)); \
+				ek[n] = t1; \
+				if ((n) < 14) { \
+					t3 = aes256_assist_2(t1, t3); \
+					ek[(n)+1] = t3; \
+				} \
+			} while (0)
+			AES256_ROUND( 2, 0x01);
+			AES256_ROUND( 4, 0x02);
+			AES256_ROUND( 6, 0x04);
+			AES256_ROUND( 8, 0x08);
+			AES256_ROUND(10, 0x10);
+			AES256_ROUND(12, 0x20);
+			AES256_ROUND(14, 0x40);
+#undef AES256_ROUND
+			break;
+
+		default:
+			assert(!"Invalid AES key size.");
+			rounds = 0;
+			return;
+	}
+
+	// Decryption keys are the encryption keys in reverse order,
+	// with InvMixColumns applied to the middle round keys.
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dec_keys[0]), ek[rounds]);
+	for (int i = 1; i < rounds; i++) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dec_keys[i]), _mm_aesimc_si128(ek[rounds - i]));
+	}
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dec_keys[rounds]), ek[0]);
+
+	for (int i = 0; i <= rounds; i++) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(enc_keys[i]), ek[i]);
+	}
+}
+
+/**
+ * Load round keys into registers.
+ * @tparam ROUNDS Number of rounds.
+ * @param rk	[out] Round keys.
+ * @param keys	[in] Stored round keys.
+ */
+template<int ROUNDS>
+static FORCEINLINE void loadRoundKeys(__m128i rk[ROUNDS+1], const uint8_t keys[15][16])
+{
+	for (int i = 0; i <= ROUNDS; i++) {
+		rk[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys[i]));
+	}
+}
+
+// Apply an operation to all pipelined blocks.
+// The blocks are unrolled explicitly so they stay in registers.
+#define AESNI_X8(op) do { \
+		op(0); op(1); op(2); op(3); \
+		op(4); op(5); op(6); op(7); \
+	} while (0)
+
+/**
+ * Run AES decryption rounds on AESNI_PIPELINE_BLOCKS blocks.
+ * @tparam ROUNDS Number of rounds.
+ * @param b	[in/out] Blocks.
+ * @param rk	[in] Decryption round keys.
+ */
+template<int ROUNDS>
+static FORCEINLINE void aesdec_x8(__m128i b[AESNI_PIPELINE_BLOCKS], const __m128i rk[ROUNDS+1])
+{
+	#define OP_XOR(j) b[j] = _mm_xor_si128(b[j], rk[0])
+	#define OP_DEC(j) b[j] = _mm_aesdec_si128(b[j], k)
+	#define OP_DECLAST(j) b[j] = _mm_aesdeclast_si128(b[j], rk[ROUNDS])
+	AESNI_X8(OP_XOR);
+	for (int i = 1; i < ROUNDS; i++) {
+		const __m128i k = rk[i];
+		AESNI_X8(OP_DEC);
+	}
+	AESNI_X8(OP_DECLAST);
+	#undef OP_XOR
+	#undef OP_DEC
+	#undef OP_DECLAST
+}
+
+/**
+ * Run AES encryption rounds on AESNI_PIPELINE_BLOCKS blocks.
+ * @tparam ROUNDS Number of rounds.
+ * @param b	[in/out] Blocks.
+ * @param rk	[in] Encryption round keys.
+ */
+template<int ROUNDS>
+static FORCEINLINE void aesenc_x8(__m128i b[AESNI_PIPELINE_BLOCKS], const __m128i rk[ROUNDS+1])
+{
+	#define OP_XOR(j) b[j] = _mm_xor_si128(b[j], rk[0])
+	#define OP_ENC(j) b[j] = _mm_aesenc_si128(b[j], k)
+	#define OP_ENCLAST(j) b[j] = _mm_aesenclast_si128(b[j], rk[ROUNDS])
+	AESNI_X8(OP_XOR);
+	for (int i = 1; i < ROUNDS; i++) {
+		const __m128i k = rk[i];
+		AESNI_X8(OP_ENC);
+	}
+	AESNI_X8(OP_ENCLAST);
+	#undef OP_XOR
+	#undef OP_ENC
+	#undef OP_ENCLAST
+}
+
+/**
+ * Run AES decryption rounds on a single block.
+ * @tparam ROUNDS Number of rounds.
+ * @param b	[in] Block.
+ * @param rk	[in] Decryption round keys.
+ * @return Decrypted block.
+ */
+template<int ROUNDS>
+static FORCEINLINE __m128i aesdec_x1(__m128i b, const __m128i rk[ROUNDS+1])
+{
+	b = _mm_xor_si128(b, rk[0]);
+	for (int i = 1; i < ROUNDS; i++) {
+		b = _mm_aesdec_si128(b, rk[i]);
+	}
+	return _mm_aesdeclast_si128(b, rk[ROUNDS]);
+}
+
+/**
+ * Run AES encryption rounds on a single block.
+ * @tparam ROUNDS Number of rounds.
+ * @param b	[in] Block.
+ * @param rk	[in] Encryption round keys.
+ * @return Encrypted block.
+ */
+template<int ROUNDS>
+static FORCEINLINE __m128i aesenc_x1(__m128i b, const __m128i rk[ROUNDS+1])
+{
+	b = _mm_xor_si128(b, rk[0]);
+	for (int i = 1; i < ROUNDS; i++) {
+		b = _mm_aesenc_si128(b, rk[i]);
+	}
+	return _mm_aesenclast_si128(b, rk[ROUNDS]);
+}
+
+/**
+ * Decrypt data using ECB.
+ * @tparam ROUNDS Number of rounds.
+ * @param keys	[in] Decryption round keys.
+ * @param pData	[in/out] Data.
+ * @param blocks	[in] Number of 16-byte blocks.
+ */
+template<int ROUNDS>
+static void T_decryptECB(const uint8_t keys[15][16], uint8_t *RESTRICT pData, size_t blocks)
+{
+	__m128i rk[ROUNDS+1];
+	loadRoundKeys<ROUNDS>(rk, keys);
+	__m128i *p = reinterpret_cast<__m128i*>(pData);
+
+	// Decrypt multiple blocks at once.
+	for (; blocks >= AESNI_PIPELINE_BLOCKS; blocks -= AESNI_PIPELINE_BLOCKS, p += AESNI_PIPELINE_BLOCKS) {
+		__m128i b[AESNI_PIPELINE_BLOCKS];
+		for (int j = 0; j < AESNI_PIPELINE_BLOCKS; j++) {
+			b[j] = _mm_loadu_si128(&p[j]);
+		}
+		aesdec_x8<ROUNDS>(b, rk);
+		for (int j = 0; j < AESNI_PIPELINE_BLOCKS; j++) {
+			_mm_storeu_si128(&p[j], b[j]);
+		}
+	}
+
+	// Remaining blocks.
+	for (; blocks > 0; blocks--, p++) {
+		_mm_storeu_si128(p, aesdec_x1<ROUNDS>(_mm_loadu_si128(p), rk));
+	}
+}
+
+/**
+ * Decrypt data using CBC.
+ * @tparam ROUNDS Number of rounds.
+ * @param keys	[in] Decryption round keys.
+ * @param iv	[in/out] IV. (Updated for the next block.)
+ * @param pData	[in/out] Data.
+ * @param blocks	[in] Number of 16-byte blocks.
+ */
+template<int ROUNDS>
+static void T_decryptCBC(const uint8_t keys[15][16], uint8_t iv[16], uint8_t *RESTRICT pData, size_t blocks)
+{
+	__m128i rk[ROUNDS+1];
+	loadRoundKeys<ROUNDS>(rk, keys);
+	__m128i *p = reinterpret_cast<__m128i*>(pData);
+	__m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+
+	// CBC decryption can be parallelized, since each block only
+	// depends on the previous block's ciphertext.
+	for (; blocks >= AESNI_PIPELINE_BLOCKS; blocks -= AESNI_PIPELINE_BLOCKS, p += AESNI_PIPELINE_BLOCKS) {
+		__m128i c[AESNI_PIPELINE_BLOCKS], b[AESNI_PIPELINE_BLOCKS];
+		for (int j = 0; j < AESNI_PIPELINE_BLOCKS; j++) {
+			c[j] = _mm_loadu_si128(&p[j]);
+			b[j] = c[j];
+		}
+		aesdec_x8<ROUNDS>(b, rk);
+		_mm_storeu_si128(&p[0], _mm_xor_si128(b[0], prev));
+		for (int j = 1; j < AESNI_PIPELINE_BLOCKS; j++) {
+			_mm_storeu_si128(&p[j], _mm_xor_si128(b[j], c[j-1]));
+		}
+		prev = c[AESNI_PIPELINE_BLOCKS-1];
+	}
+
+	// Remaining blocks.
+	for (; blocks > 0; blocks--, p++) {
+		const __m128i c = _mm_loadu_si128(p);
+		_mm_storeu_si128(p, _mm_xor_si128(aesdec_x1<ROUNDS>(c, rk), prev));
+		prev = c;
+	}
+
+	// Save the IV for the next block.
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(iv), prev);
+}
+
+/**
+ * Decrypt data using CTR.
+ * @tparam ROUNDS Number of rounds.
+ * @param keys	[in] Encryption round keys.
+ * @param ctr	[in/out] Counter. (Updated for the next block.)
+ * @param pData	[in/out] Data.
+ * @param blocks	[in] Number of 16-byte blocks.
+ */
+template<int ROUNDS>
+static void T_decryptCTR(const uint8_t keys[15][16], uint8_t ctr[16], uint8_t *RESTRICT pData, size_t blocks)
+{
+	__m128i rk[ROUNDS+1];
+	loadRoundKeys<ROUNDS>(rk, keys);
+	__m128i *p = reinterpret_cast<__m128i*>(pData);
+
+	// The counter is a 128-bit big-endian value.
+	uint64_t ctr_hi, ctr_lo;
+	memcpy(&ctr_hi, &ctr[0], sizeof(ctr_hi));
+	memcpy(&ctr_lo, &ctr[8], sizeof(ctr_lo));
+	ctr_hi = be64_to_cpu(ctr_hi);
+	ctr_lo = be64_to_cpu(ctr_lo);
+
+	// Get the current counter block and increment the counter.
+	#define CTR_NEXT() \
+		_mm_set_epi64x(static_cast<int64_t>(cpu_to_be64(ctr_lo)), \
+			       static_cast<int64_t>(cpu_to_be64(ctr_hi))); \
+		if (++ctr_lo == 0) ctr_hi++;
+
+	for (; blocks >= AESNI_PIPELINE_BLOCKS; blocks -= AESNI_PIPELINE_BLOCKS, p += AESNI_PIPELINE_BLOCKS) {
+		__m128i b[AESNI_PIPELINE_BLOCKS];
+		for (int j = 0; j < AESNI_PIPELINE_BLOCKS; j++) {
+			b[j] = CTR_NEXT();
+		}
+		aesenc_x8<ROUNDS>(b, rk);
+		for (int j = 0; j < AESNI_PIPELINE_BLOCKS; j++) {
+			_mm_storeu_si128(&p[j], _mm_xor_si128(b[j], _mm_loadu_si128(&p[j])));
+		}
+	}
+
+	// Remaining blocks.
+	for (; blocks > 0; blocks--, p++) {
+		__m128i b = CTR_NEXT();
+		b = aesenc_x1<ROUNDS>(b, rk);
+		_mm_storeu_si128(p, _mm_xor_si128(b, _mm_loadu_si128(p)));
+	}
+	#undef CTR_NEXT
+
+	// Save the counter for the next block.
+	ctr_hi = cpu_to_be64(ctr_hi);
+	ctr_lo = cpu_to_be64(ctr_lo);
+	memcpy(&ctr[0], &ctr_hi, sizeof(ctr_hi));
+	memcpy(&ctr[8], &ctr_lo, sizeof(ctr_lo));
+}
+
+/**
+ * Decrypt data using ECB.
+ * @param pData	[in/out] Data.
+ * @param blocks	[in] Number of 16-byte blocks.
+ */
+void AesNIPrivate::decryptECB(uint8_t *RESTRICT pData, size_t blocks) const
+{
+	// The round count is a template parameter so the
+	// round loops can be fully unrolled.
+	switch (rounds) {
+		case 10:	T_decryptECB<10>(dec_keys, pData, blocks); break;
+		case 12:	T_decryptECB<12>(dec_keys, pData, blocks); break;
+		case 14:	T_decryptECB<14>(dec_keys, pData, blocks); break;
+		default:	assert(!"Invalid number of rounds."); break;
+	}
+}
+
+/**
+ * Decrypt data using CBC.
+ * The IV is updated for the next block.
+ * @param pData	[in/out] Data.
+ * @param blocks	[in] Number of 16-byte blocks.
+ */
+void AesNIPrivate::decryptCBC(uint8_t *RESTRICT pData, size_t blocks)
+{
+	switch (rounds) {
+		case 10:	T_decryptCBC<10>(dec_keys, iv, pData, blocks); break;
+		case 12:	T_decryptCBC<12>(dec_keys, iv, pData, blocks); break;
+		case 14:	T_decryptCBC<14>(dec_keys, iv, pData, blocks); break;
+		default:	assert(!"Invalid number of rounds."); break;
+	}
+}
+
+/**
+ * Decrypt data using CTR.
+ * The counter is updated for the next block.
+ * @param pData	[in/out] Data.
+ * @param blocks	[in] Number of 16-byte blocks.
+ */
+void AesNIPrivate::decryptCTR(uint8_t *RESTRICT pData, size_t blocks)
+{
+	switch (rounds) {
+		case 10:	T_decryptCTR<10>(enc_keys, iv, pData, blocks); break;
+		case 12:	T_decryptCTR<12>(enc_keys, iv, pData, blocks); break;
+		case 14:	T_decryptCTR<14>(enc_keys, iv, pData, blocks); break;
+		default:	assert(!"Invalid number of rounds."); break;
+	}
+}
+
+/** AesNI **/
+
+AesNI::AesNI()
+	: d_ptr(new AesNIPrivate())
+{ }
+
+AesNI::~AesNI()
+{
+	delete d_ptr;
+}
+
+/**
+ * Is AES-NI usable on this CPU?
+ * @return True if AES-NI is usable; false if not.
+ */
+bool AesNI::isUsable(void)
+{
+	return !!RP_CPU_HasAES();
+}
+
+/**
+ * Get the name of the AesCipher implementation.
+ * @return Name.
+ */
+const char *AesNI::name(void) const
+{
+	return "AES-NI";
+}
+
+/**
+ * Has the cipher been initialized properly?
+ * @return True if initialized; false if not.
+ */
+bool AesNI::isInit(void) const
+{
+	// AES-NI must be supported by the CPU.
+	return isUsable();
+}
+
+/**
+ * Set the encryption key.
+ * @param pKey	[in] Key data.
+ * @param size	[in] Size of pKey, in bytes.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int AesNI::setKey(const uint8_t *RESTRICT pKey, size_t size)
+{
+	// Acceptable key lengths:
+	// - 16 (AES-128)
+	// - 24 (AES-192)
+	// - 32 (AES-256)
+	if (!pKey || !(size == 16 || size == 24 || size == 32)) {
+		return -EINVAL;
+	} else if (!isUsable()) {
+		// AES-NI is not supported.
+		return -ENOTSUP;
+	}
+
+	RP_D(AesNI);
+	d->expandKey(pKey, size);
+	return 0;
+}
+
+/**
+ * Set the cipher chaining mode.
+ *
+ * Note that the IV/counter must be set *after* setting
+ * the chaining mode; otherwise, setIV() will fail.
+ *
+ * @param mode Cipher chaining mode.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int AesNI::setChainingMode(ChainingMode mode)
+{
+	if (mode < CM_ECB || mode > CM_CTR) {
+		return -EINVAL;
+	}
+
+	RP_D(AesNI);
+	d->chainingMode = mode;
+	return 0;
+}
+
+/**
+ * Set the IV (CBC mode) or counter (CTR mode).
+ * @param pIV	[in] IV/counter data.
+ * @param size	[in] Size of pIV, in bytes.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int AesNI::setIV(const uint8_t *RESTRICT pIV, size_t size)
+{
+	RP_D(AesNI);
+	if (!pIV || size != sizeof(d->iv) ||
+	    d->chainingMode < CM_CBC || d->chainingMode > CM_CTR)
+	{
+		// Invalid parameters and/or chaining mode.
+		return -EINVAL;
+	}
+
+	// Set the IV/counter.
+	memcpy(d->iv, pIV, sizeof(d->iv));
+	return 0;
+}
+
+/**
+ * Decrypt a block of data.
+ * @param pData	[in/out] Data block.
+ * @param size	[in] Length of data block. (Must be a multiple of 16.)
+ * @return Number of bytes decrypted on success; 0 on error.
+ */
+size_t AesNI::decrypt(uint8_t *RESTRICT pData, size_t size)
+{
+	RP_D(AesNI);
+	if (!pData || size == 0 || (size % 16 != 0)) {
+		// Invalid parameters.
+		return 0;
+	} else if (d->rounds == 0) {
+		// No key has been set.
+		return 0;
+	}
+
+	// Decrypt the data.
+	const size_t blocks = size / 16;
+	switch (d->chainingMode) {
+		case CM_ECB:
+			d->decryptECB(pData, blocks);
+			break;
+		case CM_CBC:
+			d->decryptCBC(pData, blocks);
+			break;
+		case CM_CTR:
+			d->decryptCTR(pData, blocks);
+			break;
+		default:
+			return 0;
+	}
+
+	return size;
+}
+
+}
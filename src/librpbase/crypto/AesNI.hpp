@@ -0,0 +1,89 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * AesNI.hpp: AES decryption class using AES-NI instructions.              *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPBASE_CRYPTO_AESNI_HPP__
+#define __ROMPROPERTIES_LIBRPBASE_CRYPTO_AESNI_HPP__
+
+#include "IAesCipher.hpp"
+
+namespace LibRpBase {
+
+class AesNIPrivate;
+class AesNI : public IAesCipher
+{
+	public:
+		AesNI();
+		virtual ~AesNI();
+
+		/**
+		 * Is AES-NI usable on this CPU?
+		 * @return True if AES-NI is usable; false if not.
+		 */
+		static bool isUsable(void);
+
+	private:
+		typedef IAesCipher super;
+		RP_DISABLE_COPY(AesNI)
+	private:
+		friend class AesNIPrivate;
+		AesNIPrivate *const d_ptr;
+
+	public:
+		/**
+		 * Get the name of the AesCipher implementation.
+		 * @return Name.
+		 */
+		const char *name(void) const final;
+
+		/**
+		 * Has the cipher been initialized properly?
+		 * @return True if initialized; false if not.
+		 */
+		bool isInit(void) const final;
+
+		/**
+		 * Set the encryption key.
+		 * @param pKey	[in] Key data.
+		 * @param size	[in] Size of pKey, in bytes.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int setKey(const uint8_t *RESTRICT pKey, size_t size) final;
+
+		/**
+		 * Set the cipher chaining mode.
+		 *
+		 * Note that the IV/counter must be set *after* setting
+		 * the chaining mode; otherwise, setIV() will fail.
+		 *
+		 * @param mode Cipher chaining mode.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int setChainingMode(ChainingMode mode) final;
+
+		/**
+		 * Set the IV (CBC mode) or counter (CTR mode).
+		 * @param pIV	[in] IV/counter data.
+		 * @param size	[in] Size of pIV, in bytes.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int setIV(const uint8_t *RESTRICT pIV, size_t size) final;
+
+		/**
+		 * Decrypt a block of data.
+		 * Key and IV/counter must be set before calling this function.
+		 *
+		 * @param pData	[in/out] Data block.
+		 * @param size	[in] Length of data block. (Must be a multiple of 16.)
+		 * @return Number of bytes decrypted on success; 0 on error.
+		 */
+		size_t decrypt(uint8_t *RESTRICT pData, size_t size) final;
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBRPBASE_CRYPTO_AESNI_HPP__ */
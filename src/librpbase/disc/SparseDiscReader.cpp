@@ -23,6 +23,10 @@ SparseDiscReaderPrivate::SparseDiscReaderPrivate(SparseDiscReader *q)
 	, disc_size(0)
 	, pos(-1)
 	, block_size(0)
+	, canCoalesce(true)
+	, blockCacheSize(BLOCK_CACHE_SIZE_DEFAULT)
+	, blockCacheHits(0)
+	, blockCacheMisses(0)
 {
 	// NOTE: Can't check q->m_file here.
 
@@ -30,6 +34,126 @@ SparseDiscReaderPrivate::SparseDiscReaderPrivate(SparseDiscReader *q)
 	// set by the subclass.
 }
 
+/**
+ * Look up a block in the block cache.
+ * If found, the block is moved to the front of the LRU list.
+ * @param blockIdx Block index.
+ * @return Block data, or nullptr if not cached.
+ */
+const uint8_t *SparseDiscReaderPrivate::blockCacheLookup(uint32_t blockIdx)
+{
+	auto iter = blockCacheMap.find(blockIdx);
+	if (iter == blockCacheMap.end()) {
+		// Not cached.
+		blockCacheMisses++;
+		return nullptr;
+	}
+
+	// Move the block to the front of the LRU list.
+	if (iter->second != blockCacheLRU.begin()) {
+		blockCacheLRU.splice(blockCacheLRU.begin(), blockCacheLRU, iter->second);
+	}
+	blockCacheHits++;
+	return iter->second->data.data();
+}
+
+/**
+ * Get a buffer for a new block cache entry.
+ * The least recently used block is evicted if the cache is full.
+ *
+ * NOTE: The entry is inserted at the front of the LRU list.
+ * If the block can't be read, call blockCacheRemove().
+ *
+ * @param blockIdx Block index. (must not already be cached)
+ * @return Buffer of block_size bytes, or nullptr if the cache is disabled.
+ */
+uint8_t *SparseDiscReaderPrivate::blockCacheInsert(uint32_t blockIdx)
+{
+	assert(blockCacheMap.find(blockIdx) == blockCacheMap.end());
+	const size_t maxBlocks = blockCacheMaxBlocks();
+	if (maxBlocks == 0) {
+		// Block cache is disabled.
+		return nullptr;
+	}
+
+	if (blockCacheLRU.size() >= maxBlocks) {
+		// Cache is full. Reuse the least recently used entry.
+		auto lruIter = std::prev(blockCacheLRU.end());
+		blockCacheMap.erase(lruIter->blockIdx);
+		blockCacheLRU.splice(blockCacheLRU.begin(), blockCacheLRU, lruIter);
+	} else {
+		// Allocate a new entry.
+		blockCacheLRU.emplace_front();
+	}
+
+	BlockCacheEntry &entry = blockCacheLRU.front();
+	entry.blockIdx = blockIdx;
+	entry.data.resize(block_size);
+	blockCacheMap.emplace(blockIdx, blockCacheLRU.begin());
+	return entry.data.data();
+}
+
+/**
+ * Remove a block from the block cache.
+ * @param blockIdx Block index.
+ */
+void SparseDiscReaderPrivate::blockCacheRemove(uint32_t blockIdx)
+{
+	auto iter = blockCacheMap.find(blockIdx);
+	if (iter != blockCacheMap.end()) {
+		blockCacheLRU.erase(iter->second);
+		blockCacheMap.erase(iter);
+	}
+}
+
+/**
+ * Clear the block cache.
+ */
+void SparseDiscReaderPrivate::blockCacheClear(void)
+{
+	blockCacheMap.clear();
+	blockCacheLRU.clear();
+}
+
+/**
+ * Read part of a block using the block cache.
+ *
+ * If the block isn't cached, the entire block is read into
+ * the cache. If that fails, or if the cache is disabled,
+ * the requested part of the block is read directly.
+ *
+ * @param blockIdx	[in] Block index.
+ * @param ptr		[out] Output data buffer.
+ * @param pos		[in] Starting position within the block.
+ * @param size		[in] Amount of data to read, in bytes.
+ * @return Number of bytes read, or -1 if the block index is invalid.
+ */
+int SparseDiscReaderPrivate::readBlockCached(uint32_t blockIdx, uint8_t *ptr, int pos, size_t size)
+{
+	RP_Q(SparseDiscReader);
+	const uint8_t *pBlock = blockCacheLookup(blockIdx);
+	if (!pBlock) {
+		uint8_t *const pNewBlock = blockCacheInsert(blockIdx);
+		if (!pNewBlock) {
+			// Block cache is disabled.
+			return q->readBlock(blockIdx, ptr, pos, size);
+		}
+
+		int rd = q->readBlock(blockIdx, pNewBlock, 0, block_size);
+		if (rd != static_cast<int>(block_size)) {
+			// Unable to read the entire block.
+			// This might be the last block of the disc,
+			// so read the requested part directly.
+			blockCacheRemove(blockIdx);
+			return q->readBlock(blockIdx, ptr, pos, size);
+		}
+		pBlock = pNewBlock;
+	}
+
+	memcpy(ptr, &pBlock[pos], size);
+	return static_cast<int>(size);
+}
+
 /** SparseDiscReader **/
 
 SparseDiscReader::SparseDiscReader(SparseDiscReaderPrivate *d, IRpFile *file)
@@ -90,7 +214,7 @@ size_t SparseDiscReader::read(void *ptr, size_t size)
 		}
 
 		const unsigned int blockIdx = static_cast<unsigned int>(d->pos / block_size);
-		int rd = this->readBlock(blockIdx, ptr8, blockStartOffset, read_sz);
+		int rd = d->readBlockCached(blockIdx, ptr8, blockStartOffset, read_sz);
 		if (rd < 0 || rd != static_cast<int>(read_sz)) {
 			// Error reading the data.
 			return (rd > 0 ? rd : 0);
@@ -104,17 +228,62 @@ size_t SparseDiscReader::read(void *ptr, size_t size)
 	}
 
 	// Read entire blocks.
-	for (; size >= block_size;
-	    size -= block_size, ptr8 += block_size,
-	    ret += block_size, d->pos += block_size)
-	{
+	while (size >= block_size) {
 		assert(d->pos % block_size == 0);
 		const unsigned int blockIdx = static_cast<unsigned int>(d->pos / block_size);
-		int rd = this->readBlock(blockIdx, ptr8, 0, block_size);
-		if (rd < 0 || rd != static_cast<int>(block_size)) {
-			// Error reading the data.
-			return ret + (rd > 0 ? rd : 0);
+
+		// Check the block cache first.
+		// NOTE: Full blocks are not added to the cache on a miss,
+		// since large sequential reads would evict everything else.
+		size_t blocksRead = 1;
+		const uint8_t *const pBlock = d->blockCacheLookup(blockIdx);
+		if (pBlock) {
+			// Cache hit.
+			memcpy(ptr8, pBlock, block_size);
+		} else if (d->canCoalesce) {
+			const off64_t physBlockAddr = getPhysBlockAddr(blockIdx);
+			assert(physBlockAddr >= 0);
+			if (physBlockAddr < 0) {
+				// Out of range.
+				return ret;
+			} else if (physBlockAddr == 0) {
+				// Empty block.
+				memset(ptr8, 0, block_size);
+			} else {
+				// Coalesce physically contiguous blocks into a single read.
+				// Blocks that are already cached end the run.
+				size_t blocksMax = size / block_size;
+				off64_t nextAddr = physBlockAddr + block_size;
+				for (; blocksRead < blocksMax; blocksRead++, nextAddr += block_size) {
+					const uint32_t nextIdx = blockIdx + static_cast<uint32_t>(blocksRead);
+					if (d->blockCacheMap.find(nextIdx) != d->blockCacheMap.end() ||
+					    getPhysBlockAddr(nextIdx) != nextAddr)
+					{
+						break;
+					}
+				}
+
+				const size_t run_sz = blocksRead * block_size;
+				size_t sz_read = m_file->seekAndRead(physBlockAddr, ptr8, run_sz);
+				m_lastError = m_file->lastError();
+				if (sz_read != run_sz) {
+					// Error reading the data.
+					return ret + sz_read;
+				}
+			}
+		} else {
+			int rd = this->readBlock(blockIdx, ptr8, 0, block_size);
+			if (rd < 0 || rd != static_cast<int>(block_size)) {
+				// Error reading the data.
+				return ret + (rd > 0 ? rd : 0);
+			}
 		}
+
+		const size_t run_sz = blocksRead * block_size;
+		size -= run_sz;
+		ptr8 += run_sz;
+		ret += run_sz;
+		d->pos += run_sz;
 	}
 
 	// Check if we still have data left. (not a full block)
@@ -124,7 +293,7 @@ size_t SparseDiscReader::read(void *ptr, size_t size)
 
 		// Read the start of the block.
 		const unsigned int blockIdx = static_cast<unsigned int>(d->pos / block_size);
-		int rd = this->readBlock(blockIdx, ptr8, 0, size);
+		int rd = d->readBlockCached(blockIdx, ptr8, 0, size);
 		if (rd < 0 || rd != static_cast<int>(size)) {
 			// Error reading the data.
 			return ret + (rd > 0 ? rd : 0);
@@ -209,6 +378,60 @@ off64_t SparseDiscReader::size(void)
 	return d->disc_size;
 }
 
+/** Block cache **/
+
+/**
+ * Get the maximum size of the block cache.
+ * @return Maximum block cache size, in bytes.
+ */
+size_t SparseDiscReader::blockCacheSize(void) const
+{
+	RP_D(const SparseDiscReader);
+	return d->blockCacheSize;
+}
+
+/**
+ * Set the maximum size of the block cache.
+ *
+ * Partial block reads are cached using an LRU policy.
+ * If the block size is larger than the cache size,
+ * the cache is disabled.
+ *
+ * @param size Maximum block cache size, in bytes. (0 to disable)
+ */
+void SparseDiscReader::setBlockCacheSize(size_t size)
+{
+	RP_D(SparseDiscReader);
+	d->blockCacheSize = size;
+
+	// Evict blocks that no longer fit.
+	const size_t maxBlocks = d->blockCacheMaxBlocks();
+	while (d->blockCacheLRU.size() > maxBlocks) {
+		d->blockCacheMap.erase(d->blockCacheLRU.back().blockIdx);
+		d->blockCacheLRU.pop_back();
+	}
+}
+
+/**
+ * Get the number of block cache hits.
+ * @return Block cache hits.
+ */
+uint64_t SparseDiscReader::blockCacheHits(void) const
+{
+	RP_D(const SparseDiscReader);
+	return d->blockCacheHits;
+}
+
+/**
+ * Get the number of block cache misses.
+ * @return Block cache misses.
+ */
+uint64_t SparseDiscReader::blockCacheMisses(void) const
+{
+	RP_D(const SparseDiscReader);
+	return d->blockCacheMisses;
+}
+
 /** SparseDiscReader **/
 
 /**
@@ -59,6 +59,38 @@ class SparseDiscReader : public IDiscReader
 		 */
 		off64_t size(void) final;
 
+	public:
+		/** Block cache **/
+
+		/**
+		 * Get the maximum size of the block cache.
+		 * @return Maximum block cache size, in bytes.
+		 */
+		size_t blockCacheSize(void) const;
+
+		/**
+		 * Set the maximum size of the block cache.
+		 *
+		 * Partial block reads are cached using an LRU policy.
+		 * If the block size is larger than the cache size,
+		 * the cache is disabled.
+		 *
+		 * @param size Maximum block cache size, in bytes. (0 to disable)
+		 */
+		void setBlockCacheSize(size_t size);
+
+		/**
+		 * Get the number of block cache hits.
+		 * @return Block cache hits.
+		 */
+		uint64_t blockCacheHits(void) const;
+
+		/**
+		 * Get the number of block cache misses.
+		 * @return Block cache misses.
+		 */
+		uint64_t blockCacheMisses(void) const;
+
 	protected:
 		/** Virtual functions for SparseDiscReader subclasses. **/
 
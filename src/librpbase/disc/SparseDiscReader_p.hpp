@@ -13,6 +13,11 @@
 
 #include <stdint.h>
 #include "common.h"
+#include "uvector.h"
+
+// C++ includes.
+#include <list>
+#include <unordered_map>
 
 namespace LibRpBase {
 
@@ -34,6 +39,89 @@ class SparseDiscReaderPrivate
 		off64_t disc_size;		// Virtual disc image size.
 		off64_t pos;			// Read position.
 		unsigned int block_size;	// Block size.
+
+		// Set to false by subclasses that override readBlock()
+		// and don't implement getPhysBlockAddr(), e.g. GdiReader.
+		// If true, full-block reads from physically contiguous
+		// blocks will be coalesced into a single read.
+		bool canCoalesce;
+
+	public:
+		/** Block cache **/
+
+		// Default block cache size, in bytes.
+		static const size_t BLOCK_CACHE_SIZE_DEFAULT = 1024*1024;
+
+		// Block cache entry.
+		struct BlockCacheEntry {
+			uint32_t blockIdx;
+			ao::uvector<uint8_t> data;
+		};
+
+		// LRU list. The most recently used block is at the front.
+		typedef std::list<BlockCacheEntry> BlockCacheList;
+		BlockCacheList blockCacheLRU;
+		// Block index -> LRU list entry.
+		std::unordered_map<uint32_t, BlockCacheList::iterator> blockCacheMap;
+
+		size_t blockCacheSize;		// Maximum cache size, in bytes.
+		uint64_t blockCacheHits;	// Number of cache hits.
+		uint64_t blockCacheMisses;	// Number of cache misses.
+
+		/**
+		 * Get the maximum number of blocks that can be cached.
+		 * @return Maximum number of cached blocks. (0 if the cache is disabled)
+		 */
+		inline size_t blockCacheMaxBlocks(void) const
+		{
+			return (block_size != 0 ? blockCacheSize / block_size : 0);
+		}
+
+		/**
+		 * Look up a block in the block cache.
+		 * If found, the block is moved to the front of the LRU list.
+		 * @param blockIdx Block index.
+		 * @return Block data, or nullptr if not cached.
+		 */
+		const uint8_t *blockCacheLookup(uint32_t blockIdx);
+
+		/**
+		 * Get a buffer for a new block cache entry.
+		 * The least recently used block is evicted if the cache is full.
+		 *
+		 * NOTE: The entry is inserted at the front of the LRU list.
+		 * If the block can't be read, call blockCacheRemove().
+		 *
+		 * @param blockIdx Block index. (must not already be cached)
+		 * @return Buffer of block_size bytes, or nullptr if the cache is disabled.
+		 */
+		uint8_t *blockCacheInsert(uint32_t blockIdx);
+
+		/**
+		 * Remove a block from the block cache.
+		 * @param blockIdx Block index.
+		 */
+		void blockCacheRemove(uint32_t blockIdx);
+
+		/**
+		 * Clear the block cache.
+		 */
+		void blockCacheClear(void);
+
+		/**
+		 * Read part of a block using the block cache.
+		 *
+		 * If the block isn't cached, the entire block is read into
+		 * the cache. If that fails, or if the cache is disabled,
+		 * the requested part of the block is read directly.
+		 *
+		 * @param blockIdx	[in] Block index.
+		 * @param ptr		[out] Output data buffer.
+		 * @param pos		[in] Starting position within the block.
+		 * @param size		[in] Amount of data to read, in bytes.
+		 * @return Number of bytes read, or -1 if the block index is invalid.
+		 */
+		int readBlockCached(uint32_t blockIdx, uint8_t *ptr, int pos, size_t size);
 };
 
 }
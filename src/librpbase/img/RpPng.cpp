@@ -53,9 +53,6 @@ using std::unique_ptr;
 # endif
 #endif /* !PNGCAPI */
 
-// pngcheck()
-#include "pngcheck/pngcheck.hpp"
-
 #if defined(_MSC_VER) && (defined(ZLIB_IS_DLL) || defined(PNG_IS_DLL))
 // Need zlib for delay-load checks.
 #include <zlib.h>
@@ -103,6 +100,15 @@ class RpPngPrivate
 		 */
 		static void PNGCAPI png_io_IRpFile_read(png_structp png_ptr, png_bytep data, png_size_t length);
 
+		/**
+		 * libpng I/O read handler for IRpFile.
+		 * Short reads are treated as errors.
+		 * @param png_ptr	[in]  PNG pointer.
+		 * @param data		[out] Buffer for the data to read.
+		 * @param length	[in]  Size of data.
+		 */
+		static void PNGCAPI png_io_IRpFile_read_checked(png_structp png_ptr, png_bytep data, png_size_t length);
+
 		/**
 		 * libpng I/O write handler for IRpFile.
 		 * @param png_ptr	[in] PNG pointer.
@@ -152,6 +158,27 @@ class RpPngPrivate
 		 * @return rp_image*, or nullptr on error.
 		 */
 		static rp_image *loadPng(png_structp png_ptr, png_infop info_ptr);
+
+		/**
+		 * Load a PNG image from an IRpFile.
+		 *
+		 * If checked is true, libpng's limits are tightened, CRC
+		 * errors in critical chunks are fatal, and truncated files
+		 * are rejected. Together with libpng's own chunk and zlib
+		 * stream validation, this is used instead of a separate
+		 * validation pass over the file.
+		 *
+		 * @param file IRpFile to load from.
+		 * @param checked If true, use the hardened settings.
+		 * @return rp_image*, or nullptr on error.
+		 */
+		static rp_image *loadFile(IRpFile *file, bool checked);
+
+		// Limits for checked images.
+		// Image dimensions are also limited to 32768x32768 by loadPng().
+		static const png_uint_32 MAX_DIMENSION = 32768;
+		static const png_uint_32 MAX_CHUNK_CACHE = 128;		// Ancillary chunks
+		static const png_alloc_size_t MAX_CHUNK_MALLOC = 8*1024*1024;	// Size of a single ancillary chunk
 };
 
 /** RpPngPrivate **/
@@ -184,6 +211,30 @@ void PNGCAPI RpPngPrivate::png_io_IRpFile_read(png_structp png_ptr, png_bytep da
 	}
 }
 
+/**
+ * libpng I/O read handler for IRpFile.
+ * Short reads are treated as errors.
+ * @param png_ptr	[in]  PNG pointer.
+ * @param data		[out] Buffer for the data to read.
+ * @param length	[in]  Size of data.
+ */
+void PNGCAPI RpPngPrivate::png_io_IRpFile_read_checked(png_structp png_ptr, png_bytep data, png_size_t length)
+{
+	// Assuming io_ptr is an IRpFile*.
+	IRpFile *file = static_cast<IRpFile*>(png_get_io_ptr(png_ptr));
+	if (!file) {
+		png_error(png_ptr, "No file");
+		return;
+	}
+
+	// Read data from the IRpFile.
+	size_t sz = file->read(data, length);
+	if (sz != length) {
+		// Short read. The file is truncated.
+		png_error(png_ptr, "Read error");
+	}
+}
+
 /**
  * libpng I/O write handler for IRpFile.
  * @param png_ptr	[in] PNG pointer.
@@ -499,18 +550,20 @@ rp_image *RpPngPrivate::loadPng(png_structp png_ptr, png_infop info_ptr)
 	return img;
 }
 
-/** RpPng **/
-
 /**
  * Load a PNG image from an IRpFile.
  *
- * This image is NOT checked for issues; do not use
- * with untrusted images!
+ * If checked is true, libpng's limits are tightened, CRC
+ * errors in critical chunks are fatal, and truncated files
+ * are rejected. Together with libpng's own chunk and zlib
+ * stream validation, this is used instead of a separate
+ * validation pass over the file.
  *
  * @param file IRpFile to load from.
+ * @param checked If true, use the hardened settings.
  * @return rp_image*, or nullptr on error.
  */
-rp_image *RpPng::loadUnchecked(IRpFile *file)
+rp_image *RpPngPrivate::loadFile(IRpFile *file, bool checked)
 {
 	if (!file)
 		return nullptr;
@@ -543,47 +596,75 @@ rp_image *RpPng::loadUnchecked(IRpFile *file)
 
 #ifdef PNG_WARNINGS_SUPPORTED
 	// Initialize the custom warning handler.
-	png_set_error_fn(png_ptr, nullptr, nullptr, RpPngPrivate::png_warning_fn);
+	png_set_error_fn(png_ptr, nullptr, nullptr, png_warning_fn);
 #endif /* PNG_WARNINGS_SUPPORTED */
 
-	// Initialize the custom I/O handler for IRpFile.
-	png_set_read_fn(png_ptr, file, RpPngPrivate::png_io_IRpFile_read);
+	if (checked) {
+		// Initialize the custom I/O handler for IRpFile.
+		// Short reads are errors.
+		png_set_read_fn(png_ptr, file, png_io_IRpFile_read_checked);
+
+		// CRC errors in critical chunks are fatal.
+		// Ancillary chunks with CRC errors are discarded.
+		png_set_crc_action(png_ptr, PNG_CRC_ERROR_QUIT, PNG_CRC_WARN_DISCARD);
+
+#ifdef PNG_SET_USER_LIMITS_SUPPORTED
+		// Reject oversized images before allocating anything.
+		png_set_user_limits(png_ptr, MAX_DIMENSION, MAX_DIMENSION);
+# if PNG_LIBPNG_VER >= 10400
+		// Limit the number and size of ancillary chunks,
+		// e.g. sPLT, tEXt, zTXt, iTXt, and unknown chunks.
+		png_set_chunk_cache_max(png_ptr, MAX_CHUNK_CACHE);
+		png_set_chunk_malloc_max(png_ptr, MAX_CHUNK_MALLOC);
+# endif /* PNG_LIBPNG_VER >= 10400 */
+#endif /* PNG_SET_USER_LIMITS_SUPPORTED */
+	} else {
+		// Initialize the custom I/O handler for IRpFile.
+		png_set_read_fn(png_ptr, file, png_io_IRpFile_read);
+	}
 
 	// Call the actual PNG image reading function.
-	rp_image *img = RpPngPrivate::loadPng(png_ptr, info_ptr);
+	rp_image *img = loadPng(png_ptr, info_ptr);
 
 	// Free the PNG structs.
 	png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
 	return img;
 }
 
+/** RpPng **/
+
 /**
  * Load a PNG image from an IRpFile.
  *
- * This image is verified with various tools to ensure
- * it doesn't have any errors.
+ * This image is NOT checked for issues; do not use
+ * with untrusted images!
  *
  * @param file IRpFile to load from.
  * @return rp_image*, or nullptr on error.
  */
-rp_image *RpPng::load(IRpFile *file)
+rp_image *RpPng::loadUnchecked(IRpFile *file)
 {
-	if (!file)
-		return nullptr;
-
-	// Check the image with pngcheck() first.
-	file->rewind();
-	int ret = pngcheck(file);
-	// NOTE: BK Pocket Bike Racer's icon is missing the IEND chunk.
-	// pngcheck returns kMinorError in that case.
-	// TODO: Make it a special exception?
-	if (ret != kOK && ret != kMinorError) {
-		// PNG image has major errors.
-		return nullptr;
-	}
+	return RpPngPrivate::loadFile(file, false);
+}
 
-	// PNG image has been validated.
-	return loadUnchecked(file);
+/**
+ * Load a PNG image from an IRpFile.
+ *
+ * The image is validated while it's being decoded:
+ * - Chunk lengths, names, ordering, and CRCs are checked by libpng.
+ * - The zlib stream is checked by zlib.
+ * - Image dimensions and ancillary chunks are limited.
+ * - Truncated files are rejected.
+ *
+ * This is done in the same pass as decoding, so the
+ * file is only read and inflated once.
+ *
+ * @param file IRpFile to load from.
+ * @return rp_image*, or nullptr on error.
+ */
+rp_image *RpPng::load(IRpFile *file)
+{
+	return RpPngPrivate::loadFile(file, true);
 }
 
 /**
@@ -45,8 +45,8 @@ class RpPng
 		/**
 		 * Load a PNG image from an IRpFile.
 		 *
-		 * This image is verified with various tools to ensure
-		 * it doesn't have any errors.
+		 * This image is validated while it's being decoded,
+		 * so malformed images are rejected.
 		 *
 		 * @param file IRpFile to load from.
 		 * @return rp_image*, or nullptr on error.
@@ -12,6 +12,7 @@
 
 #include "byteorder.h"
 #include "TextFuncs.hpp"
+#include "config/Config.hpp"
 
 // librpfile
 #include "librpfile/RpFile.hpp"
@@ -27,8 +28,9 @@ using LibRpTexture::argb32_t;
 #include "img/IconAnimData.hpp"
 #include "APNG_dlopen.h"
 
-// libpng
+// libpng, zlib
 #include <png.h>
+#include <zlib.h>
 
 #if PNG_LIBPNG_VER < 10209 || \
     (PNG_LIBPNG_VER == 10209 && \
@@ -83,14 +85,18 @@ using std::unique_ptr;
 using std::vector;
 
 #if defined(_MSC_VER) && (defined(ZLIB_IS_DLL) || defined(PNG_IS_DLL))
-// Need zlib for delay-load checks.
-#include <zlib.h>
 // MSVC: Exception handling for /DELAYLOAD.
 #include "libwin32common/DelayLoadHelper.h"
 #endif /* defined(_MSC_VER) && (defined(ZLIB_IS_DLL) || defined(PNG_IS_DLL)) */
 
 namespace LibRpBase {
 
+// Config::ThumbnailPngProfile is cast to RpPngWriter::Profile.
+static_assert(static_cast<int>(Config::ThumbnailPngProfile::TPP_FAST) == RpPngWriter::PROFILE_FAST, "TPP_FAST != PROFILE_FAST");
+static_assert(static_cast<int>(Config::ThumbnailPngProfile::TPP_BALANCED) == RpPngWriter::PROFILE_BALANCED, "TPP_BALANCED != PROFILE_BALANCED");
+static_assert(static_cast<int>(Config::ThumbnailPngProfile::TPP_SMALL) == RpPngWriter::PROFILE_SMALL, "TPP_SMALL != PROFILE_SMALL");
+static_assert(static_cast<int>(Config::ThumbnailPngProfile::TPP_MAX) == RpPngWriter::PROFILE_MAX, "TPP_MAX != PROFILE_MAX");
+
 #if defined(_MSC_VER) && (defined(ZLIB_IS_DLL) || defined(PNG_IS_DLL))
 // DelayLoad test implementation.
 DELAYLOAD_FILTER_FUNCTION_IMPL(zlib_and_png)
@@ -117,26 +123,30 @@ class RpPngWriterPrivate
 		// ref() is done here if needed.
 		RpPngWriterPrivate(IRpFile *file, int width, int height, rp_image::Format format)
 			: lastError(0), file(nullptr), imageTag(IMGT_INVALID)
-			, png_ptr(nullptr), info_ptr(nullptr), IHDR_written(false)
+			, png_ptr(nullptr), info_ptr(nullptr)
+			, profile(RpPngWriter::PROFILE_BALANCED), IHDR_written(false)
 		{
 			init(file, width, height, format);
 		}
 		RpPngWriterPrivate(IRpFile *file, const rp_image *img)
 			: lastError(0), file(nullptr), imageTag(IMGT_INVALID)
-			, png_ptr(nullptr), info_ptr(nullptr), IHDR_written(false)
+			, png_ptr(nullptr), info_ptr(nullptr)
+			, profile(RpPngWriter::PROFILE_BALANCED), IHDR_written(false)
 		{
 			init(file, img);
 		}
 		RpPngWriterPrivate(IRpFile *file, const IconAnimData *iconAnimData)
 			: lastError(0), file(nullptr), imageTag(IMGT_INVALID)
-			, png_ptr(nullptr), info_ptr(nullptr), IHDR_written(false)
+			, png_ptr(nullptr), info_ptr(nullptr)
+			, profile(RpPngWriter::PROFILE_BALANCED), IHDR_written(false)
 		{
 			init(file, iconAnimData);
 		}
 
 		RpPngWriterPrivate(const char *filename, int width, int height, rp_image::Format format)
 			: lastError(0), file(nullptr), imageTag(IMGT_INVALID)
-			, png_ptr(nullptr), info_ptr(nullptr), IHDR_written(false)
+			, png_ptr(nullptr), info_ptr(nullptr)
+			, profile(RpPngWriter::PROFILE_BALANCED), IHDR_written(false)
 		{
 			RpFile *const file = (filename ? new RpFile(filename, RpFile::FM_CREATE_WRITE) : nullptr);
 			init(file, width, height, format);
@@ -146,7 +156,8 @@ class RpPngWriterPrivate
 		}
 		RpPngWriterPrivate(const char *filename, const rp_image *img)
 			: lastError(0), file(nullptr), imageTag(IMGT_INVALID)
-			, png_ptr(nullptr), info_ptr(nullptr), IHDR_written(false)
+			, png_ptr(nullptr), info_ptr(nullptr)
+			, profile(RpPngWriter::PROFILE_BALANCED), IHDR_written(false)
 		{
 			RpFile *const file = (filename ? new RpFile(filename, RpFile::FM_CREATE_WRITE) : nullptr);
 			init(file, img);
@@ -156,7 +167,8 @@ class RpPngWriterPrivate
 		}
 		RpPngWriterPrivate(const char *filename, const IconAnimData *iconAnimData)
 			: lastError(0), file(nullptr), imageTag(IMGT_INVALID)
-			, png_ptr(nullptr), info_ptr(nullptr), IHDR_written(false)
+			, png_ptr(nullptr), info_ptr(nullptr)
+			, profile(RpPngWriter::PROFILE_BALANCED), IHDR_written(false)
 		{
 			RpFile *const file = (filename ? new RpFile(filename, RpFile::FM_CREATE_WRITE) : nullptr);
 			init(file, iconAnimData);
@@ -278,6 +290,9 @@ class RpPngWriterPrivate
 		png_structp png_ptr;
 		png_infop info_ptr;
 
+		// Compression profile.
+		RpPngWriter::Profile profile;
+
 		// Current state.
 		bool IHDR_written;
 
@@ -1091,6 +1106,22 @@ void RpPngWriter::close(void)
 	d->close();
 }
 
+/**
+ * Set the compression profile.
+ * This must be called before write_IHDR().
+ * @param profile Compression profile.
+ */
+void RpPngWriter::setProfile(Profile profile)
+{
+	RP_D(RpPngWriter);
+	assert(profile >= 0 && profile < PROFILE_MAX);
+	assert(!d->IHDR_written);
+	if (profile >= PROFILE_MAX) {
+		profile = PROFILE_BALANCED;
+	}
+	d->profile = profile;
+}
+
 /**
  * Write the PNG IHDR.
  * This must be called before writing any other image data.
@@ -1126,9 +1157,37 @@ int RpPngWriter::write_IHDR(void)
 #endif /* PNG_SETJMP_SUPPORTED */
 
 	// Initialize compression parameters.
-	// TODO: Customizable?
-	png_set_filter(d->png_ptr, 0, PNG_FILTER_NONE);
-	png_set_compression_level(d->png_ptr, PNG_Z_DEFAULT_COMPRESSION);
+	int filters, level, strategy;
+	switch (d->profile) {
+		case PROFILE_FAST:
+			// Fastest compression.
+			// Z_RLE is much faster than the default strategy, but it only
+			// finds runs of identical bytes, so the Up filter is needed to
+			// turn vertical redundancy into runs of zeroes.
+			filters = PNG_FILTER_UP;
+			level = 1;
+			strategy = Z_RLE;
+			break;
+		case PROFILE_BALANCED:
+		default:
+			filters = PNG_FILTER_NONE;
+			level = PNG_Z_DEFAULT_COMPRESSION;
+			strategy = Z_DEFAULT_STRATEGY;
+			break;
+		case PROFILE_SMALL:
+			// Smallest output. Adaptive filtering is *very* slow.
+			filters = PNG_ALL_FILTERS;
+			level = Z_BEST_COMPRESSION;
+			strategy = Z_DEFAULT_STRATEGY;
+			break;
+	}
+	if (d->cache.format == rp_image::FORMAT_CI8) {
+		// Filtering doesn't help with palette indexes.
+		filters = PNG_FILTER_NONE;
+	}
+	png_set_filter(d->png_ptr, 0, filters);
+	png_set_compression_level(d->png_ptr, level);
+	png_set_compression_strategy(d->png_ptr, strategy);
 
 	// Write the PNG header.
 	switch (d->cache.format) {
@@ -172,6 +172,24 @@ class RpPngWriter
 		 */
 		void close(void);
 
+		/**
+		 * Compression profile.
+		 */
+		enum Profile : uint8_t {
+			PROFILE_FAST,		// Fastest encoding; larger files. (zlib level 1, RLE)
+			PROFILE_BALANCED,	// Default zlib settings. (default)
+			PROFILE_SMALL,		// Smallest files; much slower. (zlib level 9, adaptive filtering)
+
+			PROFILE_MAX
+		};
+
+		/**
+		 * Set the compression profile.
+		 * This must be called before write_IHDR().
+		 * @param profile Compression profile.
+		 */
+		void setProfile(Profile profile);
+
 		/**
 		 * Write the PNG IHDR.
 		 * This must be called before writing any other image data.
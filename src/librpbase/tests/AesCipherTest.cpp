@@ -18,9 +18,14 @@
 #else /* !_WIN32 */
 # include "../crypto/AesNettle.hpp"
 #endif /* _WIN32 */
+#include "config.librpbase.h"
+#ifdef HAVE_AESNI
+# include "../crypto/AesNI.hpp"
+#endif /* HAVE_AESNI */
 
 // C includes. (C++ namespace)
 #include <cstdio>
+#include <ctime>
 
 // C++ includes.
 #include <iostream>
@@ -110,6 +115,23 @@ class AesCipherTest : public ::testing::TestWithParam<AesCipherTest_mode>
 		// Test string.
 		static const char test_string[64];
 
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 64;
+		// Buffer size for benchmarks.
+		static const size_t BENCHMARK_BUFFER_SIZE = 4*1024*1024;
+
+		/**
+		 * Create a reference cipher for comparisons.
+		 * @return Reference IAesCipher.
+		 */
+		static IAesCipher *createReferenceCipher(void);
+
+		/**
+		 * Initialize a cipher using the current test mode.
+		 * @param cipher IAesCipher.
+		 */
+		void initCipher(IAesCipher *cipher);
+
 		/**
 		 * Compare two byte arrays.
 		 * The byte arrays are converted to hexdumps and then
@@ -216,6 +238,33 @@ void AesCipherTest::CompareByteArrays(
 		"Actual " << data_type << ":" << '\n' << s_actual << '\n';
 }
 
+/**
+ * Create a reference cipher for comparisons.
+ * @return Reference IAesCipher.
+ */
+IAesCipher *AesCipherTest::createReferenceCipher(void)
+{
+#ifdef _WIN32
+	return new AesCAPI();
+#else /* !_WIN32 */
+	return new AesNettle();
+#endif /* _WIN32 */
+}
+
+/**
+ * Initialize a cipher using the current test mode.
+ * @param cipher IAesCipher.
+ */
+void AesCipherTest::initCipher(IAesCipher *cipher)
+{
+	const AesCipherTest_mode &mode = GetParam();
+	ASSERT_EQ(0, cipher->setKey(aes_key, mode.key_len));
+	ASSERT_EQ(0, cipher->setChainingMode(mode.chainingMode));
+	if (mode.chainingMode != IAesCipher::CM_ECB) {
+		ASSERT_EQ(0, cipher->setIV(aes_iv, sizeof(aes_iv)));
+	}
+}
+
 /**
  * SetUp() function.
  * Run before each test.
@@ -384,6 +433,76 @@ TEST_P(AesCipherTest, decryptTest_blockAtATime)
 		buf.data(), buf.size(), "plaintext data");
 }
 
+/**
+ * Decrypt a large buffer in uneven chunks and compare
+ * the result to the reference implementation.
+ * This tests multi-block processing and IV/counter chaining.
+ */
+TEST_P(AesCipherTest, decryptTest_largeBuffer)
+{
+	const AesCipherTest_mode &mode = GetParam();
+	if (!mode.isRequired && !m_cipher->isInit()) {
+		return;
+	}
+
+	// Pseudo-random data.
+	vector<uint8_t> data(16 * 1021);
+	uint32_t lcg = 0x12345678;
+	for (size_t i = 0; i < data.size(); i++) {
+		lcg = lcg * 1103515245 + 12345;
+		data[i] = static_cast<uint8_t>(lcg >> 16);
+	}
+
+	// Reference decryption.
+	IAesCipher *const refCipher = createReferenceCipher();
+	ASSERT_TRUE(refCipher->isInit());
+	initCipher(refCipher);
+	vector<uint8_t> expected(data);
+	EXPECT_EQ(expected.size(), refCipher->decrypt(expected.data(), expected.size()));
+	delete refCipher;
+
+	// Decrypt using uneven chunk sizes. (in blocks)
+	initCipher(m_cipher);
+	static const unsigned int chunks[] = {1, 3, 8, 9, 16, 7, 31, 2, 64, 5};
+	size_t pos = 0;
+	for (size_t i = 0; pos < data.size(); i = (i + 1) % ARRAY_SIZE(chunks)) {
+		size_t sz = chunks[i] * 16;
+		if (pos + sz > data.size()) {
+			sz = data.size() - pos;
+		}
+		EXPECT_EQ(sz, m_cipher->decrypt(&data[pos], sz));
+		pos += sz;
+	}
+
+	CompareByteArrays(expected.data(), data.data(), data.size(), "plaintext data");
+}
+
+/**
+ * Decryption benchmark.
+ * Decrypts a large buffer multiple times and prints the throughput.
+ */
+TEST_P(AesCipherTest, decrypt_benchmark)
+{
+	const AesCipherTest_mode &mode = GetParam();
+	if (!mode.isRequired && !m_cipher->isInit()) {
+		return;
+	}
+
+	initCipher(m_cipher);
+	vector<uint8_t> buf(BENCHMARK_BUFFER_SIZE, 0x55);
+
+	const clock_t start = clock();
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		m_cipher->decrypt(buf.data(), buf.size());
+	}
+	const double secs = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+
+	if (secs > 0) {
+		const double bytes = static_cast<double>(BENCHMARK_BUFFER_SIZE) * BENCHMARK_ITERATIONS;
+		printf("%s: %.3f GB/s\n", m_cipher->name(), bytes / secs / (1024.0*1024.0*1024.0));
+	}
+}
+
 /** Decryption tests. **/
 
 /**
@@ -572,6 +691,9 @@ AesDecryptTestSet(CAPI_NG, false)
 #else /* !_WIN32 */
 AesDecryptTestSet(Nettle, true)
 #endif /* _WIN32 */
+#ifdef HAVE_AESNI
+AesDecryptTestSet(NI, false)
+#endif /* HAVE_AESNI */
 
 } }
 
@@ -581,6 +703,7 @@ AesDecryptTestSet(Nettle, true)
 extern "C" int gtest_main(int argc, TCHAR *argv[])
 {
 	fprintf(stderr, "LibRpBase test suite: AesCipher tests.\n\n");
+	fprintf(stderr, "Benchmark iterations: %u\n", LibRpBase::Tests::AesCipherTest::BENCHMARK_ITERATIONS);
 	fflush(nullptr);
 
 	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
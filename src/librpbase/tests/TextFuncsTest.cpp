@@ -11,10 +11,32 @@
 #include "tcharx.h"
 
 // TextFuncs
+#include "librpbase/config.librpbase.h"
 #include "../TextFuncs.hpp"
-#include "librpcpu/byteorder.h"
+#include "librpcpu/byteswap.h"
+#ifndef _WIN32
+// UTF-8 encoding kernels. (Windows uses WideCharToMultiByte().)
+# include "../TextFuncs_utf8.hpp"
+#endif /* !_WIN32 */
+
+#ifdef HAVE_ICONV
+// Table-driven decoders. These are checked against iconv().
+# include "../TextFuncs_tbl.hpp"
+# if (defined(__FreeBSD__) || defined(__DragonFly__)) && !defined(HAVE_ICONV_LIBICONV)
+// Use the system iconv.h. (See TextFuncs_iconv.cpp.)
+#  include </usr/include/iconv.h>
+# else
+#  include <iconv.h>
+# endif
+# if SYS_BYTEORDER == SYS_BIG_ENDIAN
+#  define RP_ICONV_UTF16_ENCODING "UTF-16BE"
+# else
+#  define RP_ICONV_UTF16_ENCODING "UTF-16LE"
+# endif
+#endif /* HAVE_ICONV */
 
 // C includes. (C++ namespace)
+#include <cassert>
 #include <cstdio>
 #include <cstring>
 
@@ -98,6 +120,9 @@ class TextFuncsTest : public ::testing::Test
 		 */
 		static const char16_t sjis_utf16_data[19];
 
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 1000000;
+
 		/**
 		 * Shift-JIS test string with a cp1252 copyright symbol. (0xA9)
 		 * This string is incorrectly detected as Shift-JIS because
@@ -473,6 +498,49 @@ TEST_F(TextFuncsTest, cp1252_sjis_to_utf16_japanese)
 	EXPECT_EQ(sjis_utf16_data, str);
 }
 
+/**
+ * Test cp1252_sjis_to_utf8() with invalid Shift-JIS sequences.
+ * These should fall back to cp1252, or Latin-1 if the
+ * string also has unassigned cp1252 code points.
+ */
+TEST_F(TextFuncsTest, cp1252_sjis_to_utf8_invalid)
+{
+	// Truncated double-byte character.
+	// cp1252 0x82 is a single low-9 quotation mark. (U+201A)
+	EXPECT_EQ("ABC\xE2\x80\x9A", cp1252_sjis_to_utf8("ABC\x82", -1));
+
+	// Lead byte with no assigned code points.
+	// cp1252 0x85 is a horizontal ellipsis. (U+2026)
+	EXPECT_EQ("\xE2\x80\xA6@", cp1252_sjis_to_utf8("\x85\x40", -1));
+
+	// Invalid trail byte.
+	EXPECT_EQ("\xE2\x80\x9A\x7F", cp1252_sjis_to_utf8("\x82\x7F", -1));
+
+	// Invalid single byte. (0xA0 is a non-breaking space in cp1252.)
+	EXPECT_EQ("\xC2\xA0\xC2\xA0", cp1252_sjis_to_utf8("\xA0\xA0", -1));
+
+	// 0x81 is unassigned in cp1252, so this falls back to Latin-1.
+	EXPECT_EQ("\xC2\x81 ", cp1252_sjis_to_utf8("\x81 ", -1));
+	EXPECT_EQ("\xC2\x81", cp1252_sjis_to_utf8("\x81", -1));
+}
+
+/**
+ * Test cp1252_sjis_to_utf16() with invalid Shift-JIS sequences.
+ * These should fall back to cp1252, or Latin-1 if the
+ * string also has unassigned cp1252 code points.
+ */
+TEST_F(TextFuncsTest, cp1252_sjis_to_utf16_invalid)
+{
+	// Truncated double-byte character.
+	EXPECT_EQ(u"ABC\u201A", cp1252_sjis_to_utf16("ABC\x82", -1));
+
+	// Lead byte with no assigned code points.
+	EXPECT_EQ(u"\u2026@", cp1252_sjis_to_utf16("\x85\x40", -1));
+
+	// 0x81 is unassigned in cp1252, so this falls back to Latin-1.
+	EXPECT_EQ(u"\u0081", cp1252_sjis_to_utf16("\x81", -1));
+}
+
 /** UTF-8 to UTF-16 and vice-versa **/
 
 /**
@@ -640,6 +708,291 @@ TEST_F(TextFuncsTest, utf16_bswap_LEtoBE)
 	EXPECT_EQ((const char16_t*)utf16be_data, str);
 }
 
+/**
+ * Test utf16le_to_utf8() and utf16be_to_utf8() with invalid surrogates.
+ * Invalid UTF-16 results in an empty string.
+ */
+TEST_F(TextFuncsTest, utf16_to_utf8_invalid)
+{
+	// Unpaired low surrogate.
+	static const uint8_t lowSurrogate_le[] = {'A',0, 0x00,0xDC, 'B',0};
+	static const uint8_t lowSurrogate_be[] = {0,'A', 0xDC,0x00, 0,'B'};
+	EXPECT_EQ(string(), utf16le_to_utf8((const char16_t*)lowSurrogate_le, 3));
+	EXPECT_EQ(string(), utf16be_to_utf8((const char16_t*)lowSurrogate_be, 3));
+
+	// High surrogate followed by a non-surrogate.
+	static const uint8_t highSurrogate_le[] = {'A',0, 0x3C,0xD8, 'B',0};
+	static const uint8_t highSurrogate_be[] = {0,'A', 0xD8,0x3C, 0,'B'};
+	EXPECT_EQ(string(), utf16le_to_utf8((const char16_t*)highSurrogate_le, 3));
+	EXPECT_EQ(string(), utf16be_to_utf8((const char16_t*)highSurrogate_be, 3));
+
+	// High surrogate at the end of the string.
+	EXPECT_EQ(string(), utf16le_to_utf8((const char16_t*)highSurrogate_le, 2));
+	EXPECT_EQ(string(), utf16be_to_utf8((const char16_t*)highSurrogate_be, 2));
+}
+
+#ifndef _WIN32
+/**
+ * Check a UTF-16 to UTF-8 encoding kernel.
+ * @param pfn		[in] Encoding kernel.
+ * @param utf16_str	[in] UTF-16 string, in the kernel's byte order.
+ * @param utf8_str	[in] Expected UTF-8 string.
+ */
+static void checkUtf16Kernel(int (*pfn)(char*, const char16_t*, int),
+	const u16string &utf16_str, const string &utf8_str)
+{
+	// Test every prefix length in order to cover
+	// the SIMD block boundaries.
+	string buf(utf16_str.size() * 3, '\0');
+	for (size_t len = 0; len <= utf16_str.size(); len++) {
+		const int ret = pfn(&buf[0], utf16_str.data(), static_cast<int>(len));
+		if (len > 0) {
+			const char16_t ch = utf16_str[len-1];
+			if ((ch & 0xFC00) == 0xD800 || (ch & 0x00FC) == 0x00D8) {
+				// Possible split surrogate pair. (either byte order)
+				continue;
+			}
+		}
+		ASSERT_GE(ret, 0) << "len == " << len;
+		ASSERT_EQ(0, utf8_str.compare(0, ret, buf, 0, ret)) << "len == " << len;
+	}
+	const int ret = pfn(&buf[0], utf16_str.data(), static_cast<int>(utf16_str.size()));
+	ASSERT_EQ(utf8_str, string(buf.data(), ret));
+}
+
+/**
+ * Test the UTF-16 to UTF-8 encoding kernels.
+ * All available kernels must return identical results.
+ */
+TEST_F(TextFuncsTest, utf16_to_utf8_kernels)
+{
+	// NOTE: The UTF-16 test strings are stored as
+	// uint8_t arrays in order to prevent byteswapping
+	// by the compiler.
+	const u16string utf16le_str((const char16_t*)utf16le_data, (sizeof(utf16le_data)/sizeof(char16_t))-1);
+	const u16string utf16be_str((const char16_t*)utf16be_data, (sizeof(utf16be_data)/sizeof(char16_t))-1);
+	const string utf8_str((const char*)utf8_data, ARRAY_SIZE(utf8_data)-1);
+
+	ASSERT_NO_FATAL_FAILURE(checkUtf16Kernel(utf16le_to_utf8_buf_cpp, utf16le_str, utf8_str));
+	ASSERT_NO_FATAL_FAILURE(checkUtf16Kernel(utf16be_to_utf8_buf_cpp, utf16be_str, utf8_str));
+#ifdef TEXTFUNCS_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		ASSERT_NO_FATAL_FAILURE(checkUtf16Kernel(utf16le_to_utf8_buf_sse2, utf16le_str, utf8_str));
+		ASSERT_NO_FATAL_FAILURE(checkUtf16Kernel(utf16be_to_utf8_buf_sse2, utf16be_str, utf8_str));
+	}
+#endif /* TEXTFUNCS_HAS_SSE2 */
+#ifdef TEXTFUNCS_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		ASSERT_NO_FATAL_FAILURE(checkUtf16Kernel(utf16le_to_utf8_buf_avx2, utf16le_str, utf8_str));
+		ASSERT_NO_FATAL_FAILURE(checkUtf16Kernel(utf16be_to_utf8_buf_avx2, utf16be_str, utf8_str));
+	}
+#endif /* TEXTFUNCS_HAS_AVX2 */
+}
+
+/**
+ * Check a Latin-1 to UTF-8 encoding kernel.
+ * @param pfn		[in] Encoding kernel.
+ * @param latin1_str	[in] Latin-1 string.
+ * @param utf8_str	[in] Expected UTF-8 string.
+ */
+static void checkLatin1Kernel(int (*pfn)(char*, const char*, int),
+	const string &latin1_str, const string &utf8_str)
+{
+	// Test every prefix length in order to cover
+	// the SIMD block boundaries.
+	string buf(latin1_str.size() * 2, '\0');
+	for (size_t len = 0; len <= latin1_str.size(); len++) {
+		const int ret = pfn(&buf[0], latin1_str.data(), static_cast<int>(len));
+		ASSERT_EQ(0, utf8_str.compare(0, ret, buf, 0, ret)) << "len == " << len;
+	}
+	const int ret = pfn(&buf[0], latin1_str.data(), static_cast<int>(latin1_str.size()));
+	ASSERT_EQ(utf8_str, string(buf.data(), ret));
+}
+
+/**
+ * Test the Latin-1 to UTF-8 encoding kernels.
+ * All available kernels must return identical results.
+ */
+TEST_F(TextFuncsTest, latin1_to_utf8_kernels)
+{
+	const string latin1_str((const char*)cp1252_data, ARRAY_SIZE(cp1252_data)-1);
+	const string utf8_str((const char*)latin1_utf8_data, ARRAY_SIZE(latin1_utf8_data)-1);
+
+	ASSERT_NO_FATAL_FAILURE(checkLatin1Kernel(latin1_to_utf8_buf_cpp, latin1_str, utf8_str));
+#ifdef TEXTFUNCS_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		ASSERT_NO_FATAL_FAILURE(checkLatin1Kernel(latin1_to_utf8_buf_sse2, latin1_str, utf8_str));
+	}
+#endif /* TEXTFUNCS_HAS_SSE2 */
+#ifdef TEXTFUNCS_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		ASSERT_NO_FATAL_FAILURE(checkLatin1Kernel(latin1_to_utf8_buf_avx2, latin1_str, utf8_str));
+	}
+#endif /* TEXTFUNCS_HAS_AVX2 */
+}
+#endif /* !_WIN32 */
+
+#ifdef HAVE_ICONV
+/** Table-driven decoders **/
+
+/**
+ * Convert text using iconv(). Errors are *not* ignored.
+ * @param cd	[in] iconv descriptor.
+ * @param str	[in] Input text.
+ * @param len	[in] Length of str, in bytes.
+ * @param out	[out] Output text.
+ * @return True on success; false on error.
+ */
+template<typename T>
+static bool iconv_strict(iconv_t cd, const char *str, size_t len, std::basic_string<T> &out)
+{
+	// Reset the conversion state.
+	iconv(cd, nullptr, nullptr, nullptr, nullptr);
+
+	char buf[256];
+	assert(len * 4 < sizeof(buf));
+	char *inptr = const_cast<char*>(str);
+	size_t in_bytes_remaining = len;
+	char *outptr = buf;
+	size_t out_bytes_remaining = sizeof(buf);
+	size_t size = iconv(cd, &inptr, &in_bytes_remaining, &outptr, &out_bytes_remaining);
+	if (size == (size_t)-1 || in_bytes_remaining != 0) {
+		return false;
+	}
+	// Flush the shift state.
+	size = iconv(cd, nullptr, nullptr, &outptr, &out_bytes_remaining);
+	if (size == (size_t)-1) {
+		return false;
+	}
+
+	out.assign(reinterpret_cast<const T*>(buf), (sizeof(buf) - out_bytes_remaining) / sizeof(T));
+	return true;
+}
+
+/**
+ * Check a table-driven decoder against iconv() for one input string.
+ * @param cd	[in] iconv descriptor.
+ * @param pfn	[in] Table-driven decoder.
+ * @param str	[in] Input text.
+ * @param waveDash [in] Wave dash that libiconv uses instead of U+FF5E in cp932.
+ */
+template<typename T>
+static void checkTblDecoderStr(iconv_t cd, bool (*pfn)(std::basic_string<T>&, const char*, int),
+	const string &str, const std::basic_string<T> &waveDash)
+{
+	std::basic_string<T> expected, actual;
+	const bool expected_ok = iconv_strict(cd, str.data(), str.size(), expected);
+	const bool actual_ok = pfn(actual, str.data(), static_cast<int>(str.size()));
+
+	char hex[128];
+	char *p = hex;
+	for (auto iter = str.cbegin(); iter != str.cend() && p < &hex[sizeof(hex)-4]; ++iter) {
+		p += snprintf(p, 4, "%02X ", static_cast<uint8_t>(*iter));
+	}
+	*p = '\0';
+
+	ASSERT_EQ(expected_ok, actual_ok) << "input: " << hex;
+	if (!expected_ok) {
+		return;
+	}
+
+#ifdef HAVE_ICONV_LIBICONV
+	// libiconv's cp932 maps Shift-JIS 8160 to U+301C instead of U+FF5E.
+	// The table matches glibc, which uses U+FF5E.
+	if (!waveDash.empty()) {
+		static const T fullwidthTilde_utf8[] = {(T)0xEF, (T)0xBD, (T)0x9E, 0};
+		static const T fullwidthTilde_utf16[] = {(T)0xFF5E, 0};
+		const T *const fullwidthTilde = (sizeof(T) == 1 ? fullwidthTilde_utf8 : fullwidthTilde_utf16);
+		size_t pos;
+		while ((pos = expected.find(waveDash)) != std::basic_string<T>::npos) {
+			expected.replace(pos, waveDash.size(), fullwidthTilde);
+		}
+	}
+#else /* !HAVE_ICONV_LIBICONV */
+	((void)waveDash);
+#endif /* HAVE_ICONV_LIBICONV */
+
+	ASSERT_EQ(expected, actual) << "input: " << hex;
+}
+
+/**
+ * Check a table-driven decoder against iconv() using
+ * every 1-byte and 2-byte input. The 2-byte inputs are
+ * also checked with surrounding ASCII text, which uses
+ * the decoder's ASCII fast path.
+ * @param cd	[in] iconv descriptor.
+ * @param pfn	[in] Table-driven decoder.
+ * @param waveDash [in] Wave dash that libiconv uses instead of U+FF5E in cp932.
+ */
+template<typename T>
+static void checkTblDecoder(iconv_t cd, bool (*pfn)(std::basic_string<T>&, const char*, int),
+	const std::basic_string<T> &waveDash)
+{
+	string str;
+	for (unsigned int c0 = 0x01; c0 <= 0xFF; c0++) {
+		str.assign(1, static_cast<char>(c0));
+		ASSERT_NO_FATAL_FAILURE(checkTblDecoderStr(cd, pfn, str, waveDash));
+
+		for (unsigned int c1 = 0x01; c1 <= 0xFF; c1++) {
+			str.assign(1, static_cast<char>(c0));
+			str += static_cast<char>(c1);
+			ASSERT_NO_FATAL_FAILURE(checkTblDecoderStr(cd, pfn, str, waveDash));
+
+			str.insert(0, "ABCDEFGH");
+			str += "abcdefgh";
+			ASSERT_NO_FATAL_FAILURE(checkTblDecoderStr(cd, pfn, str, waveDash));
+		}
+	}
+}
+
+/**
+ * Check a pair of table-driven decoders against iconv().
+ * The test is skipped if iconv() doesn't support the character set.
+ * @param charset	[in] iconv() character set.
+ * @param pfn_utf8	[in] Table-driven decoder. (UTF-8)
+ * @param pfn_utf16	[in] Table-driven decoder. (UTF-16)
+ * @param waveDash	[in] If true, handle libiconv's cp932 wave dash mapping.
+ */
+static void checkTblDecoders(const char *charset,
+	bool (*pfn_utf8)(string&, const char*, int),
+	bool (*pfn_utf16)(u16string&, const char*, int),
+	bool waveDash)
+{
+	iconv_t cd = iconv_open("UTF-8", charset);
+	if (cd == (iconv_t)(-1)) {
+		fprintf(stderr, "*** iconv() doesn't support %s. Skipping test.\n", charset);
+		return;
+	}
+	static const char waveDash_utf8[] = "\xE3\x80\x9C";
+	checkTblDecoder(cd, pfn_utf8, (waveDash ? string(waveDash_utf8) : string()));
+	iconv_close(cd);
+	if (::testing::Test::HasFatalFailure()) {
+		return;
+	}
+
+	cd = iconv_open(RP_ICONV_UTF16_ENCODING, charset);
+	ASSERT_NE((iconv_t)(-1), cd);
+	checkTblDecoder(cd, pfn_utf16, (waveDash ? u16string(1, 0x301C) : u16string()));
+	iconv_close(cd);
+}
+
+/**
+ * The Shift-JIS (cp932) table decoder must match iconv().
+ */
+TEST_F(TextFuncsTest, cp932_tbl_vs_iconv)
+{
+	ASSERT_NO_FATAL_FAILURE(checkTblDecoders("CP932", cp932_tbl_to_utf8, cp932_tbl_to_utf16, true));
+}
+
+/**
+ * The cp1252 table decoder must match iconv().
+ */
+TEST_F(TextFuncsTest, cp1252_tbl_vs_iconv)
+{
+	ASSERT_NO_FATAL_FAILURE(checkTblDecoders("CP1252", cp1252_tbl_to_utf8, cp1252_tbl_to_utf16, false));
+}
+#endif /* HAVE_ICONV */
+
 /** Latin-1 (ISO-8859-1) **/
 
 /**
@@ -917,6 +1270,104 @@ TEST_F(TextFuncsTest, atascii_to_utf8)
 	EXPECT_EQ(atascii_utf16_data, u16str);
 }
 
+/** Benchmarks **/
+
+/**
+ * Benchmark cp1252_sjis_to_utf8() with Japanese text.
+ */
+TEST_F(TextFuncsTest, cp1252_sjis_to_utf8_japanese_benchmark)
+{
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		string str = cp1252_sjis_to_utf8((const char*)sjis_data, ARRAY_SIZE(sjis_data));
+		ASSERT_EQ(ARRAY_SIZE(sjis_utf8_data)-1, str.size());
+	}
+}
+
+/**
+ * Benchmark cp1252_sjis_to_utf8() with ASCII text.
+ * Most ROM headers only contain ASCII text.
+ */
+TEST_F(TextFuncsTest, cp1252_sjis_to_utf8_ascii_benchmark)
+{
+	static const char ascii_in[] = "THE LEGEND OF ZELDA: A LINK TO THE PAST";
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		string str = cp1252_sjis_to_utf8(ascii_in, ARRAY_SIZE(ascii_in));
+		ASSERT_EQ(ARRAY_SIZE(ascii_in)-1, str.size());
+	}
+}
+
+/**
+ * Benchmark cp1252_sjis_to_utf8() with cp1252 text.
+ * Shift-JIS decoding fails, so this falls back to cp1252.
+ */
+TEST_F(TextFuncsTest, cp1252_sjis_to_utf8_fallback_benchmark)
+{
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		string str = cp1252_sjis_to_utf8((const char*)cp1252_data, ARRAY_SIZE(cp1252_data));
+		ASSERT_EQ(ARRAY_SIZE(cp1252_utf8_data)-1, str.size());
+	}
+}
+
+/**
+ * Benchmark cp1252_sjis_to_utf16() with Japanese text.
+ */
+TEST_F(TextFuncsTest, cp1252_sjis_to_utf16_japanese_benchmark)
+{
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		u16string str = cp1252_sjis_to_utf16((const char*)sjis_data, ARRAY_SIZE(sjis_data));
+		ASSERT_EQ(ARRAY_SIZE(sjis_utf16_data)-1, str.size());
+	}
+}
+
+/**
+ * Benchmark utf16le_to_utf8() with ASCII text.
+ */
+TEST_F(TextFuncsTest, utf16le_to_utf8_ascii_benchmark)
+{
+	static const char16_t ascii_in[] = u"THE LEGEND OF ZELDA: A LINK TO THE PAST";
+	u16string ascii_le(ascii_in, ARRAY_SIZE(ascii_in)-1);
+	for (auto &ch : ascii_le) {
+		ch = cpu_to_le16(ch);
+	}
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		string str = utf16le_to_utf8(ascii_le.data(), static_cast<int>(ascii_le.size()));
+		ASSERT_EQ(ascii_le.size(), str.size());
+	}
+}
+
+/**
+ * Benchmark utf16be_to_utf8() with regular text and special characters.
+ */
+TEST_F(TextFuncsTest, utf16be_to_utf8_benchmark)
+{
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		string str = utf16be_to_utf8((const char16_t*)utf16be_data, (sizeof(utf16be_data)/sizeof(char16_t))-1);
+		ASSERT_EQ(ARRAY_SIZE(utf8_data)-1, str.size());
+	}
+}
+
+/**
+ * Benchmark utf16_bswap().
+ */
+TEST_F(TextFuncsTest, utf16_bswap_benchmark)
+{
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		u16string str = utf16_bswap((const char16_t*)utf16be_data, (sizeof(utf16be_data)/sizeof(char16_t))-1);
+		ASSERT_EQ((sizeof(utf16le_data)/sizeof(char16_t))-1, str.size());
+	}
+}
+
+/**
+ * Benchmark latin1_to_utf8().
+ */
+TEST_F(TextFuncsTest, latin1_to_utf8_benchmark)
+{
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		string str = latin1_to_utf8((const char*)cp1252_data, ARRAY_SIZE(cp1252_data));
+		ASSERT_EQ(ARRAY_SIZE(latin1_utf8_data)-1, str.size());
+	}
+}
+
 } }
 
 /**
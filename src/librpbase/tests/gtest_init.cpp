@@ -43,6 +43,19 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 		// TODO: Add more syscalls.
 		// FIXME: glibc-2.31 uses 64-bit time syscalls that may not be
 		// defined in earlier versions, including Ubuntu 14.04.
+#ifdef RP_TEST_THREADS
+		// NOTE: Special case for clone(). If it's the first syscall
+		// in the list, it has a parameter restriction added that
+		// ensures it can only be used to create threads.
+		SCMP_SYS(clone),
+		// Other multi-threading syscalls (ThreadPool)
+		SCMP_SYS(set_robust_list),
+		SCMP_SYS(madvise),		// freeing thread stacks
+		SCMP_SYS(sched_getaffinity),	// sysconf(_SC_NPROCESSORS_ONLN)
+#if defined(__SNR_rseq) || defined(__NR_rseq)
+		SCMP_SYS(rseq),			// glibc-2.35
+#endif /* __SNR_rseq || __NR_rseq */
+#endif /* RP_TEST_THREADS */
 		SCMP_SYS(fstat),     SCMP_SYS(fstat64),		// __GI___fxstat() [printf()]
 		SCMP_SYS(fstatat64), SCMP_SYS(newfstatat),	// Ubuntu 19.10 (32-bit)
 		SCMP_SYS(futex),	// iconv_open()
@@ -76,6 +89,23 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 		SCMP_SYS(statx),
 #endif /* __SNR_statx || __NR_statx */
 
+#ifdef RP_TEST_WRITABLE
+		// Tests that create, modify, and delete files. (librptest_rw)
+		SCMP_SYS(access), SCMP_SYS(faccessat),	// FileSystem::rmkdir()
+		SCMP_SYS(mkdir), SCMP_SYS(mkdirat),	// FileSystem::rmkdir()
+		SCMP_SYS(unlink), SCMP_SYS(unlinkat),	// FileSystem::delete_file()
+		SCMP_SYS(rename), SCMP_SYS(renameat),	// FileSystem::rename_file()
+#if defined(__SNR_renameat2) || defined(__NR_renameat2)
+		SCMP_SYS(renameat2),			// FileSystem::rename_file() [glibc-2.28+]
+#endif /* __SNR_renameat2 || __NR_renameat2 */
+		SCMP_SYS(utime), SCMP_SYS(utimes),	// FileSystem::set_mtime()
+		SCMP_SYS(utimensat),			// FileSystem::set_mtime() [glibc]
+		SCMP_SYS(ftruncate), SCMP_SYS(ftruncate64),	// RpFile::truncate()
+		SCMP_SYS(getdents), SCMP_SYS(getdents64),	// readdir() [cache pruning]
+		SCMP_SYS(lstat), SCMP_SYS(lstat64),	// cache pruning
+		SCMP_SYS(flock),			// CacheIndex::commit()
+#endif /* RP_TEST_WRITABLE */
+
 		-1	// End of whitelist
 	};
 	param.syscall_wl = syscall_wl;
@@ -83,9 +113,18 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 	// Promises:
 	// - stdio: General stdio functionality.
 	// - rpath: Read test cases.
+#ifdef RP_TEST_WRITABLE
+	// - wpath, cpath, fattr: Create, modify, and delete files.
+	param.promises = "stdio rpath wpath cpath fattr";
+#else /* !RP_TEST_WRITABLE */
 	param.promises = "stdio rpath";
+#endif /* RP_TEST_WRITABLE */
 #elif defined(HAVE_TAME)
+#ifdef RP_TEST_WRITABLE
+	param.tame_flags = TAME_STDIO | TAME_RPATH | TAME_WPATH | TAME_CPATH;
+#else /* !RP_TEST_WRITABLE */
 	param.tame_flags = TAME_STDIO | TAME_RPATH;
+#endif /* RP_TEST_WRITABLE */
 #else
 	param.dummy = 0;
 #endif
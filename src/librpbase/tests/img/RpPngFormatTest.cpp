@@ -33,10 +33,14 @@
 #include "byteswap.h"
 #include "uvector.h"
 #include "img/RpImageLoader.hpp"
+#include "img/RpPng.hpp"
+#include "img/RpPngWriter.hpp"
+#include "img/pngcheck/pngcheck.hpp"
 
 // librpfile
 #include "librpfile/RpFile.hpp"
 #include "librpfile/RpMemFile.hpp"
+#include "librpfile/RpVectorFile.hpp"
 #include "librpfile/FileSystem.hpp"
 using namespace LibRpFile;
 
@@ -265,6 +269,46 @@ class RpPngFormatTest : public ::testing::TestWithParam<RpPngFormatTest_mode>
 			const tRNS_CI8_t *pBmpAlpha = nullptr,
 			int biClrUsed = -1);
 
+		/**
+		 * Load a PNG image from the png_data directory.
+		 * @param png_filename	[in] PNG image filename.
+		 * @param png_buf	[out] PNG image data.
+		 */
+		static void Load_PNG_File(const char *png_filename, ao::uvector<uint8_t> &png_buf);
+
+		/**
+		 * Find a chunk in a PNG image.
+		 * @param png_buf PNG image data.
+		 * @param name Chunk name.
+		 * @return Offset of the chunk, or 0 if not found.
+		 */
+		static size_t Find_PNG_Chunk(const ao::uvector<uint8_t> &png_buf, const char *name);
+
+		/**
+		 * Recalculate a PNG chunk's CRC32.
+		 * @param png_buf PNG image data.
+		 * @param pos Offset of the chunk.
+		 */
+		static void Fix_PNG_Chunk_CRC(ao::uvector<uint8_t> &png_buf, size_t pos);
+
+		/**
+		 * Encode an image using RpPngWriter.
+		 * @param file		[in] IRpFile open for writing.
+		 * @param img		[in] rp_image.
+		 * @param profile	[in] Compression profile.
+		 */
+		static void Write_PNG_Image(IRpFile *file, const rp_image *img, RpPngWriter::Profile profile);
+
+		/**
+		 * Benchmark encoding a PNG image using the specified profile.
+		 * @param profile Compression profile.
+		 */
+		void Write_Benchmark(RpPngWriter::Profile profile);
+
+	public:
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 1000;
+
 	public:
 		// Image buffers.
 		ao::uvector<uint8_t> m_png_buf;
@@ -979,6 +1023,332 @@ TEST_P(RpPngFormatTest, loadTest)
 	}
 }
 
+/**
+ * Load a PNG image from the png_data directory.
+ * @param png_filename	[in] PNG image filename.
+ * @param png_buf	[out] PNG image data.
+ */
+void RpPngFormatTest::Load_PNG_File(const char *png_filename, ao::uvector<uint8_t> &png_buf)
+{
+	string path = "png_data";
+	path += DIR_SEP_CHR;
+	path += png_filename;
+	unique_IRpFile<RpFile> file(new RpFile(path, RpFile::FM_OPEN_READ));
+	ASSERT_TRUE(file->isOpen());
+	ASSERT_LE(file->size(), MAX_PNG_IMAGE_FILESIZE) << "PNG test image is too big.";
+
+	const size_t pngSize = static_cast<size_t>(file->size());
+	png_buf.resize(pngSize);
+	ASSERT_EQ(pngSize, file->read(png_buf.data(), pngSize));
+}
+
+/**
+ * Find a chunk in a PNG image.
+ * @param png_buf PNG image data.
+ * @param name Chunk name.
+ * @return Offset of the chunk, or 0 if not found.
+ */
+size_t RpPngFormatTest::Find_PNG_Chunk(const ao::uvector<uint8_t> &png_buf, const char *name)
+{
+	size_t pos = sizeof(PNG_magic);
+	while (pos + 12 <= png_buf.size()) {
+		const uint32_t len = be32_to_cpu(*reinterpret_cast<const uint32_t*>(&png_buf[pos]));
+		if (!memcmp(&png_buf[pos+4], name, 4)) {
+			return pos;
+		}
+		pos += 12 + len;
+	}
+	return 0;
+}
+
+/**
+ * Recalculate a PNG chunk's CRC32.
+ * @param png_buf PNG image data.
+ * @param pos Offset of the chunk.
+ */
+void RpPngFormatTest::Fix_PNG_Chunk_CRC(ao::uvector<uint8_t> &png_buf, size_t pos)
+{
+	const uint32_t len = be32_to_cpu(*reinterpret_cast<const uint32_t*>(&png_buf[pos]));
+	ASSERT_LE(pos + 12 + len, png_buf.size());
+	const uint32_t crc = crc32(0, &png_buf[pos+4], 4 + len);
+	*reinterpret_cast<uint32_t*>(&png_buf[pos + 8 + len]) = cpu_to_be32(crc);
+}
+
+/**
+ * Malformed PNG images must be rejected by RpPng::load().
+ */
+TEST_F(RpPngFormatTest, malformedImages)
+{
+	ao::uvector<uint8_t> orig_buf;
+	ASSERT_NO_FATAL_FAILURE(Load_PNG_File("gl_triangle.ARGB32.png", orig_buf));
+	const size_t ihdr_pos = Find_PNG_Chunk(orig_buf, "IHDR");
+	const size_t idat_pos = Find_PNG_Chunk(orig_buf, "IDAT");
+	const size_t iend_pos = Find_PNG_Chunk(orig_buf, "IEND");
+	ASSERT_EQ(sizeof(PNG_magic), ihdr_pos);
+	ASSERT_NE(0U, idat_pos);
+	ASSERT_NE(0U, iend_pos);
+	const uint32_t idat_len = be32_to_cpu(*reinterpret_cast<const uint32_t*>(&orig_buf[idat_pos]));
+
+	// Offsets within the IHDR chunk.
+	const size_t ihdr_width = ihdr_pos + 8;
+	const size_t ihdr_bit_depth = ihdr_pos + 8 + 8;
+
+	enum Corruption {
+		BadMagic,
+		BadIHDR_CRC,
+		BadIDAT_CRC,
+		BadZlibHeader,
+		Truncated,
+		TruncatedHeader,
+		ZeroWidth,
+		HugeWidth,
+		BadBitDepth,
+		HugeChunkLength,
+		BadChunkName,
+		UnknownCriticalChunk,
+
+		CorruptionMax
+	};
+	static const char *const corruption_names[] = {
+		"bad magic number",
+		"bad IHDR CRC",
+		"bad IDAT CRC",
+		"bad zlib header",
+		"truncated IDAT",
+		"truncated after IHDR",
+		"zero width",
+		"width larger than 32768",
+		"invalid bit depth",
+		"chunk length larger than 2^31-1",
+		"invalid chunk name",
+		"unknown critical chunk",
+	};
+	static_assert(ARRAY_SIZE(corruption_names) == CorruptionMax, "corruption_names[] is the wrong size");
+
+	for (int i = 0; i < CorruptionMax; i++) {
+		ao::uvector<uint8_t> png_buf(orig_buf);
+		switch (static_cast<Corruption>(i)) {
+			case BadMagic:
+				png_buf[1] = 'X';
+				break;
+			case BadIHDR_CRC:
+				png_buf[ihdr_pos + 8 + PNG_IHDR_t_SIZE] ^= 0xFF;
+				break;
+			case BadIDAT_CRC:
+				png_buf[idat_pos + 8 + idat_len] ^= 0xFF;
+				break;
+			case BadZlibHeader:
+				// Invalid FCHECK value.
+				png_buf[idat_pos + 8 + 1] ^= 0x01;
+				Fix_PNG_Chunk_CRC(png_buf, idat_pos);
+				break;
+			case Truncated:
+				png_buf.resize(idat_pos + 8 + (idat_len / 2));
+				break;
+			case TruncatedHeader:
+				png_buf.resize(ihdr_pos + PNG_IHDR_full_t_SIZE);
+				break;
+			case ZeroWidth:
+				memset(&png_buf[ihdr_width], 0, 4);
+				Fix_PNG_Chunk_CRC(png_buf, ihdr_pos);
+				break;
+			case HugeWidth:
+				*reinterpret_cast<uint32_t*>(&png_buf[ihdr_width]) = cpu_to_be32(65536);
+				Fix_PNG_Chunk_CRC(png_buf, ihdr_pos);
+				break;
+			case BadBitDepth:
+				png_buf[ihdr_bit_depth] = 3;
+				Fix_PNG_Chunk_CRC(png_buf, ihdr_pos);
+				break;
+			case HugeChunkLength:
+				memset(&png_buf[idat_pos], 0xFF, 4);
+				break;
+			case BadChunkName:
+				png_buf[idat_pos + 4 + 2] = '@';
+				Fix_PNG_Chunk_CRC(png_buf, idat_pos);
+				break;
+			case UnknownCriticalChunk: {
+				// Insert an empty "ABCD" chunk before IDAT.
+				static const uint8_t abcd[12] = {0,0,0,0, 'A','B','C','D', 0,0,0,0};
+				png_buf.insert(png_buf.begin() + idat_pos, abcd, abcd + sizeof(abcd));
+				Fix_PNG_Chunk_CRC(png_buf, idat_pos);
+				break;
+			}
+			default:
+				assert(!"Invalid corruption.");
+				break;
+		}
+
+		unique_IRpFile<RpMemFile> png_mem_file(new RpMemFile(png_buf.data(), png_buf.size()));
+		ASSERT_TRUE(png_mem_file->isOpen());
+		unique_ptr<rp_image> img(RpPng::load(png_mem_file.get()));
+		EXPECT_TRUE(img.get() == nullptr) << "Malformed PNG image was loaded: " << corruption_names[i];
+	}
+}
+
+/**
+ * PNG images that are only missing the IEND chunk are still loaded.
+ * (BK Pocket Bike Racer's Xbox 360 icon is missing IEND.)
+ */
+TEST_F(RpPngFormatTest, missingIEND)
+{
+	ao::uvector<uint8_t> png_buf;
+	ASSERT_NO_FATAL_FAILURE(Load_PNG_File("gl_triangle.ARGB32.png", png_buf));
+	const size_t iend_pos = Find_PNG_Chunk(png_buf, "IEND");
+	ASSERT_NE(0U, iend_pos);
+	png_buf.resize(iend_pos);
+
+	unique_IRpFile<RpMemFile> png_mem_file(new RpMemFile(png_buf.data(), png_buf.size()));
+	ASSERT_TRUE(png_mem_file->isOpen());
+	unique_ptr<rp_image> img(RpPng::load(png_mem_file.get()));
+	ASSERT_TRUE(img.get() != nullptr);
+	EXPECT_EQ(400, img->width());
+	EXPECT_EQ(352, img->height());
+}
+
+/**
+ * Benchmark loading a PNG image using RpPng::load().
+ */
+TEST_F(RpPngFormatTest, loadBenchmark)
+{
+	ao::uvector<uint8_t> png_buf;
+	ASSERT_NO_FATAL_FAILURE(Load_PNG_File("gl_triangle.ARGB32.png", png_buf));
+	unique_IRpFile<RpMemFile> png_mem_file(new RpMemFile(png_buf.data(), png_buf.size()));
+	ASSERT_TRUE(png_mem_file->isOpen());
+
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		unique_ptr<rp_image> img(RpPng::load(png_mem_file.get()));
+		ASSERT_TRUE(img.get() != nullptr);
+	}
+}
+
+/**
+ * Benchmark loading a PNG image using pngcheck() and RpPng::loadUnchecked().
+ * This is how RpPng::load() used to validate images.
+ */
+TEST_F(RpPngFormatTest, pngcheckLoadBenchmark)
+{
+	ao::uvector<uint8_t> png_buf;
+	ASSERT_NO_FATAL_FAILURE(Load_PNG_File("gl_triangle.ARGB32.png", png_buf));
+	unique_IRpFile<RpMemFile> png_mem_file(new RpMemFile(png_buf.data(), png_buf.size()));
+	ASSERT_TRUE(png_mem_file->isOpen());
+
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		png_mem_file->rewind();
+		ASSERT_EQ(kOK, pngcheck(png_mem_file.get()));
+		unique_ptr<rp_image> img(RpPng::loadUnchecked(png_mem_file.get()));
+		ASSERT_TRUE(img.get() != nullptr);
+	}
+}
+
+/**
+ * Encode an image using RpPngWriter.
+ * @param file		[in] IRpFile open for writing.
+ * @param img		[in] rp_image.
+ * @param profile	[in] Compression profile.
+ */
+void RpPngFormatTest::Write_PNG_Image(IRpFile *file, const rp_image *img, RpPngWriter::Profile profile)
+{
+	RpPngWriter pngWriter(file, img);
+	ASSERT_TRUE(pngWriter.isOpen());
+	pngWriter.setProfile(profile);
+	ASSERT_EQ(0, pngWriter.write_IHDR());
+	ASSERT_EQ(0, pngWriter.write_IDAT());
+}
+
+/**
+ * Images encoded with each compression profile must decode
+ * to the original image.
+ */
+TEST_F(RpPngFormatTest, writeProfiles)
+{
+	static const char *const png_filenames[] = {
+		"gl_triangle.ARGB32.png",
+		"gl_quad.gray.png",
+		"xterm-256color.CI8.tRNS.png",
+	};
+
+	for (const char *png_filename : png_filenames) {
+		ao::uvector<uint8_t> png_buf;
+		ASSERT_NO_FATAL_FAILURE(Load_PNG_File(png_filename, png_buf));
+		unique_IRpFile<RpMemFile> png_mem_file(new RpMemFile(png_buf.data(), png_buf.size()));
+		ASSERT_TRUE(png_mem_file->isOpen());
+		unique_ptr<rp_image> img(RpPng::load(png_mem_file.get()));
+		ASSERT_TRUE(img.get() != nullptr) << png_filename;
+
+		for (int profile = 0; profile < RpPngWriter::PROFILE_MAX; profile++) {
+			unique_IRpFile<RpVectorFile> out_file(new RpVectorFile());
+			ASSERT_NO_FATAL_FAILURE(Write_PNG_Image(out_file.get(), img.get(),
+				static_cast<RpPngWriter::Profile>(profile)));
+
+			out_file->rewind();
+			unique_ptr<rp_image> img2(RpPng::load(out_file.get()));
+			ASSERT_TRUE(img2.get() != nullptr) << png_filename << ", profile " << profile;
+			ASSERT_EQ(img->format(), img2->format());
+			ASSERT_EQ(img->width(), img2->width());
+			ASSERT_EQ(img->height(), img2->height());
+			ASSERT_EQ(img->palette_len(), img2->palette_len());
+			if (img->palette_len() > 0) {
+				EXPECT_EQ(0, memcmp(img->palette(), img2->palette(),
+					img->palette_len() * sizeof(uint32_t)))
+					<< png_filename << ", profile " << profile;
+			}
+
+			const size_t row_bytes = static_cast<size_t>(img->row_bytes());
+			for (int y = 0; y < img->height(); y++) {
+				ASSERT_EQ(0, memcmp(img->scanLine(y), img2->scanLine(y), row_bytes))
+					<< png_filename << ", profile " << profile << ", row " << y;
+			}
+		}
+	}
+}
+
+/**
+ * Benchmark encoding a PNG image using the specified profile.
+ * @param profile Compression profile.
+ */
+void RpPngFormatTest::Write_Benchmark(RpPngWriter::Profile profile)
+{
+	ao::uvector<uint8_t> png_buf;
+	ASSERT_NO_FATAL_FAILURE(Load_PNG_File("gl_triangle.ARGB32.png", png_buf));
+	unique_IRpFile<RpMemFile> png_mem_file(new RpMemFile(png_buf.data(), png_buf.size()));
+	ASSERT_TRUE(png_mem_file->isOpen());
+	unique_ptr<rp_image> img(RpPng::load(png_mem_file.get()));
+	ASSERT_TRUE(img.get() != nullptr);
+
+	// The small profile is much slower, so use fewer iterations.
+	const unsigned int iterations = (profile == RpPngWriter::PROFILE_SMALL
+		? BENCHMARK_ITERATIONS / 10 : BENCHMARK_ITERATIONS);
+	for (unsigned int i = iterations; i > 0; i--) {
+		unique_IRpFile<RpVectorFile> out_file(new RpVectorFile());
+		ASSERT_NO_FATAL_FAILURE(Write_PNG_Image(out_file.get(), img.get(), profile));
+	}
+}
+
+/**
+ * Benchmark encoding a PNG image using the fast profile.
+ */
+TEST_F(RpPngFormatTest, writeFastBenchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(Write_Benchmark(RpPngWriter::PROFILE_FAST));
+}
+
+/**
+ * Benchmark encoding a PNG image using the balanced profile.
+ */
+TEST_F(RpPngFormatTest, writeBalancedBenchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(Write_Benchmark(RpPngWriter::PROFILE_BALANCED));
+}
+
+/**
+ * Benchmark encoding a PNG image using the small profile.
+ */
+TEST_F(RpPngFormatTest, writeSmallBenchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(Write_Benchmark(RpPngWriter::PROFILE_SMALL));
+}
+
 /**
  * Test case suffix generator.
  * @param info Test parameter information.
@@ -45,6 +45,27 @@ static inline unsigned int uilog2(unsigned int n)
 #endif
 }
 
+/**
+ * Count trailing zero bits.
+ * @param n Value (must be non-zero)
+ * @return Index of the lowest set bit.
+ */
+static inline unsigned int ctz(unsigned int n)
+{
+#if defined(__GNUC__)
+	return __builtin_ctz(n);
+#elif defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, n);
+	return index;
+#else
+	unsigned int ret = 0;
+	for (; !(n & 1); n >>= 1)
+		ret++;
+	return ret;
+#endif
+}
+
 /**
  * Population count function.
  * @param x Value.
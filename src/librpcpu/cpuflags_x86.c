@@ -46,6 +46,7 @@
 #define CPUFLAG_IA32_ECX_SSSE3		((uint32_t)(1U << 9))
 #define CPUFLAG_IA32_ECX_SSE41		((uint32_t)(1U << 19))
 #define CPUFLAG_IA32_ECX_SSE42		((uint32_t)(1U << 20))
+#define CPUFLAG_IA32_ECX_AES		((uint32_t)(1U << 25))
 #define CPUFLAG_IA32_ECX_XSAVE		((uint32_t)(1U << 26))
 #define CPUFLAG_IA32_ECX_OSXSAVE	((uint32_t)(1U << 27))
 #define CPUFLAG_IA32_ECX_AVX		((uint32_t)(1U << 28))
@@ -79,6 +80,10 @@
 #define CPUID_EXT_PROC_BRAND_STRING_2		((uint32_t)(0x80000003U))
 #define CPUID_EXT_PROC_BRAND_STRING_3		((uint32_t)(0x80000004U))
 
+// XCR0: OS-enabled register state.
+#define XCR0_SSE_STATE		((uint32_t)(1U << 1))
+#define XCR0_AVX_STATE		((uint32_t)(1U << 2))
+
 /**
  * Check if CPUID is supported on this CPU.
  * @return 0 if not supported; non-zero if supported.
@@ -185,6 +190,68 @@ static FORCEINLINE void cpuid(unsigned int level, unsigned int regs[4])
 #endif
 }
 
+/**
+ * Run the `cpuid` instruction with a subleaf.
+ * @param level
+ * @param subleaf
+ * @param regs Registers. (%eax, %ebx, %ecx, %edx)
+ */
+static FORCEINLINE void cpuid_count(unsigned int level, unsigned int subleaf, unsigned int regs[4])
+{
+#if defined(__GNUC__)
+# ifdef ASM_RESERVE_EBX
+	__asm__ (
+		"xchgl	%%ebx, %1\n"
+		"cpuid\n"
+		"xchgl	%%ebx, %1\n"
+		: "=a" (regs[0]), "=r" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+		: "0" (level), "2" (subleaf)
+		);
+# else /* !ASM_RESERVE_EBX */
+	__asm__ (
+		"cpuid\n"
+		: "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+		: "0" (level), "2" (subleaf)
+		);
+# endif
+#elif defined(_MSC_VER) && _MSC_VER >= 1500
+	// __cpuidex() was added in MSVC 2008 SP1.
+	__cpuidex((int*)regs, level, subleaf);
+#else
+	// Subleafs aren't supported.
+	RP_UNUSED(subleaf);
+	regs[0] = regs[1] = regs[2] = regs[3] = 0;
+#endif
+}
+
+/**
+ * Run the `xgetbv` instruction.
+ * Only use this if CPUID reports OSXSAVE.
+ * @param xcr Extended control register.
+ * @return Low 32 bits of the register.
+ */
+static FORCEINLINE uint32_t xgetbv(unsigned int xcr)
+{
+#if defined(__GNUC__)
+	// Using the opcode bytes, since older assemblers
+	// don't support the `xgetbv` mnemonic.
+	uint32_t __eax, __edx;
+	__asm__ (
+		".byte 0x0f, 0x01, 0xd0\n"
+		: "=a" (__eax), "=d" (__edx)
+		: "c" (xcr)
+		);
+	return __eax;
+#elif defined(_MSC_VER) && _MSC_VER >= 1600
+	// _xgetbv() was added in MSVC 2010 SP1.
+	return (uint32_t)_xgetbv(xcr);
+#else
+	// Not supported.
+	RP_UNUSED(xcr);
+	return 0;
+#endif
+}
+
 // Register indexes.
 #define REG_EAX 0
 #define REG_EBX 1
@@ -295,6 +362,8 @@ static void RP_CPU_InitCPUFlags_int(void)
 				RP_CPU_Flags |= RP_CPUFLAG_X86_SSE41;
 			if (regs[REG_ECX] & CPUFLAG_IA32_ECX_SSE42)
 				RP_CPU_Flags |= RP_CPUFLAG_X86_SSE42;
+			if (regs[REG_ECX] & CPUFLAG_IA32_ECX_AES)
+				RP_CPU_Flags |= RP_CPUFLAG_X86_AES;
 		}
 #else /* !(defined(__i386__) || defined(_M_IX86)) */
 		// AMD64: SSE2 and lower are always supported.
@@ -307,7 +376,23 @@ static void RP_CPU_InitCPUFlags_int(void)
 			RP_CPU_Flags |= RP_CPUFLAG_X86_SSE41;
 		if (regs[REG_ECX] & CPUFLAG_IA32_ECX_SSE42)
 			RP_CPU_Flags |= RP_CPUFLAG_X86_SSE42;
+		if (regs[REG_ECX] & CPUFLAG_IA32_ECX_AES)
+			RP_CPU_Flags |= RP_CPUFLAG_X86_AES;
 #endif /* defined(__i386__) || defined(_M_IX86) */
+
+		// AVX2 requires OS support for saving the YMM registers.
+		if ((RP_CPU_Flags & RP_CPUFLAG_X86_SSE2) &&
+		    (regs[REG_ECX] & CPUFLAG_IA32_ECX_OSXSAVE) &&
+		    (regs[REG_ECX] & CPUFLAG_IA32_ECX_AVX) &&
+		    maxFunc >= CPUID_EXT_FEATURES)
+		{
+			const uint32_t xcr0 = xgetbv(0);
+			if ((xcr0 & (XCR0_SSE_STATE | XCR0_AVX_STATE)) == (XCR0_SSE_STATE | XCR0_AVX_STATE)) {
+				cpuid_count(CPUID_EXT_FEATURES, 0, regs);
+				if (regs[REG_EBX] & CPUFLAG_IA32_FN7_EBX_AVX2)
+					RP_CPU_Flags |= RP_CPUFLAG_X86_AVX2;
+			}
+		}
 	}
 
 	// CPU flags initialized.
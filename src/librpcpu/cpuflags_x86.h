@@ -29,6 +29,8 @@ extern "C" {
 #define RP_CPUFLAG_X86_SSSE3		((uint32_t)(1U << 4))
 #define RP_CPUFLAG_X86_SSE41		((uint32_t)(1U << 5))
 #define RP_CPUFLAG_X86_SSE42		((uint32_t)(1U << 6))
+#define RP_CPUFLAG_X86_AES		((uint32_t)(1U << 7))
+#define RP_CPUFLAG_X86_AVX2		((uint32_t)(1U << 8))
 
 #endif /* defined(__i386__) || defined(__amd64__) || defined(__x86_64__) */
 
@@ -99,6 +101,30 @@ static FORCEINLINE int RP_CPU_HasSSE41(void)
 	return (RP_CPU_Flags & RP_CPUFLAG_X86_SSE41);
 }
 
+/**
+ * Check if the CPU supports AES-NI.
+ * @return Non-zero if AES-NI is supported; 0 if not.
+ */
+static FORCEINLINE int RP_CPU_HasAES(void)
+{
+	if (unlikely(!RP_CPU_Flags_Init)) {
+		RP_CPU_InitCPUFlags();
+	}
+	return (RP_CPU_Flags & RP_CPUFLAG_X86_AES);
+}
+
+/**
+ * Check if the CPU and OS support AVX2.
+ * @return Non-zero if AVX2 is supported; 0 if not.
+ */
+static FORCEINLINE int RP_CPU_HasAVX2(void)
+{
+	if (unlikely(!RP_CPU_Flags_Init)) {
+		RP_CPU_InitCPUFlags();
+	}
+	return (RP_CPU_Flags & RP_CPUFLAG_X86_AVX2);
+}
+
 #ifdef __cplusplus
 }
 #endif
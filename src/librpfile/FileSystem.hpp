@@ -125,6 +125,42 @@ static inline int delete_file(const std::string &filename)
 	return delete_file(filename.c_str());
 }
 
+/**
+ * Rename a file.
+ * If the new filename already exists, it will be replaced.
+ * On POSIX systems, the replacement is atomic.
+ * @param oldFilename Old filename.
+ * @param newFilename New filename.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int rename_file(const char *oldFilename, const char *newFilename);
+
+/**
+ * Rename a file.
+ * If the new filename already exists, it will be replaced.
+ * On POSIX systems, the replacement is atomic.
+ * @param oldFilename Old filename.
+ * @param newFilename New filename.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+static inline int rename_file(const std::string &oldFilename, const std::string &newFilename)
+{
+	return rename_file(oldFilename.c_str(), newFilename.c_str());
+}
+
+/**
+ * Get a temporary filename for atomically replacing a file.
+ *
+ * The temporary file is in the same directory as the original
+ * file, so it can be renamed over the original file. The process
+ * ID and a per-process counter are included so concurrent writers
+ * never use the same temporary file.
+ *
+ * @param filename Filename.
+ * @return Temporary filename: "[filename].[pid].[n].tmp"
+ */
+std::string get_temp_filename(const std::string &filename);
+
 /**
  * Get the file extension from a filename or pathname.
  * @param filename Filename.
@@ -19,8 +19,17 @@
 #endif
 
 // librpthreads
+#include "librpthreads/Atomics.h"
 #include "librpthreads/pthread_once.h"
 
+// getpid()
+#ifdef _WIN32
+# include <process.h>	// _getpid()
+# define getpid() _getpid()
+#else
+# include <unistd.h>	// getpid()
+#endif
+
 // libcachecommon
 #include "libcachecommon/CacheDir.hpp"
 
@@ -107,4 +116,26 @@ const char *file_ext(const string &filename)
 	return &filename[dotpos];
 }
 
+/**
+ * Get a temporary filename for atomically replacing a file.
+ *
+ * The temporary file is in the same directory as the original
+ * file, so it can be renamed over the original file. The process
+ * ID and a per-process counter are included so concurrent writers
+ * never use the same temporary file.
+ *
+ * @param filename Filename.
+ * @return Temporary filename: "[filename].[pid].[n].tmp"
+ */
+string get_temp_filename(const string &filename)
+{
+	static volatile int tmp_counter = 0;
+	const int n = ATOMIC_INC_FETCH(&tmp_counter);
+
+	char buf[32];
+	snprintf(buf, sizeof(buf), ".%u.%u.tmp",
+		static_cast<unsigned int>(getpid()), static_cast<unsigned int>(n));
+	return filename + buf;
+}
+
 } }
@@ -216,6 +216,29 @@ int delete_file(const char *filename)
 	return ret;
 }
 
+/**
+ * Rename a file.
+ * If the new filename already exists, it will be replaced.
+ * On POSIX systems, the replacement is atomic.
+ * @param oldFilename Old filename.
+ * @param newFilename New filename.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int rename_file(const char *oldFilename, const char *newFilename)
+{
+	if (unlikely(!oldFilename || oldFilename[0] == 0 ||
+	             !newFilename || newFilename[0] == 0))
+		return -EINVAL;
+
+	int ret = rename(oldFilename, newFilename);
+	if (ret != 0) {
+		// Error renaming the file.
+		ret = -errno;
+	}
+
+	return ret;
+}
+
 /**
  * Check if the specified file is a symbolic link.
  * @return True if the file is a symbolic link; false if not.
@@ -0,0 +1,755 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpfile)                        *
+ * GzIndexedReader.cpp: Random-access gzip reader with a checkpoint index. *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "GzIndexedReader.hpp"
+
+#include "IRpFile.hpp"
+#include "RpFile.hpp"
+#include "FileSystem.hpp"
+
+// zlib
+#include <zlib.h>
+
+// C includes. (C++ namespace)
+#include <cstdio>
+
+// C++ includes.
+#include <memory>
+#include <string>
+#include <vector>
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace LibRpFile {
+
+// Save indexes to the cache directory?
+static bool indexCacheWritable = true;
+
+class GzIndexedReaderPrivate
+{
+	public:
+		explicit GzIndexedReaderPrivate(IRpFile *file);
+		~GzIndexedReaderPrivate();
+
+	private:
+		RP_DISABLE_COPY(GzIndexedReaderPrivate)
+
+	public:
+		IRpFile *file;		// Compressed file.
+		int lastError;
+
+		z_stream strm;		// Inflate state.
+		bool strm_init;		// True if inflateInit2() succeeded.
+		bool raw_mode;		// True if inflating raw deflate data. (restored from a checkpoint)
+		bool eof;		// End of the compressed stream was reached.
+
+		// Input buffer.
+		static const unsigned int INBUF_SIZE = 32768;
+		unique_ptr<uint8_t[]> inbuf;
+		off64_t raw_pos;	// Compressed file offset after the end of inbuf's data.
+
+		// Output window.
+		// Contains the last WINDOW_SIZE bytes of output,
+		// stored as a circular buffer starting at wpos.
+		unique_ptr<uint8_t[]> window;
+		unsigned int wpos;
+
+		off64_t out_pos;	// Decompressed position.
+
+		// Checkpoint.
+		struct Checkpoint {
+			off64_t out;		// Decompressed offset.
+			off64_t in;		// Compressed offset of the first full byte.
+			uint8_t bits;		// Number of bits (1-7) from the byte at in-1, or 0.
+			vector<uint8_t> window;	// Inflate dictionary. (WINDOW_SIZE bytes)
+		};
+		vector<Checkpoint> checkpoints;	// Sorted by out.
+		unsigned int interval;		// Distance between checkpoints.
+		bool dirty;			// True if checkpoints were added.
+
+		// Index cache.
+		string idxFilename;
+		string idxKey;
+
+	public:
+		/**
+		 * Read more compressed data into the input buffer.
+		 * Any unused input is moved to the start of the buffer.
+		 * @return Number of bytes read.
+		 */
+		size_t fillInput(void);
+
+		/**
+		 * Restart decompression at the beginning of the file.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int resetToStart(void);
+
+		/**
+		 * Restart decompression at a checkpoint.
+		 * @param cp Checkpoint.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int restoreCheckpoint(const Checkpoint &cp);
+
+		/**
+		 * Add a checkpoint at the current position.
+		 * The current position must be at a deflate block boundary.
+		 */
+		void addCheckpoint(void);
+
+		/**
+		 * Handle the end of a gzip member.
+		 * If another member follows, decompression continues with it.
+		 */
+		void endOfMember(void);
+
+		/**
+		 * Decompress data.
+		 * @param dest Output buffer, or nullptr to discard the data.
+		 * @param size Number of bytes to decompress.
+		 * @return Number of bytes decompressed.
+		 */
+		size_t inflateData(uint8_t *dest, size_t size);
+};
+
+/** GzIndexedReaderPrivate **/
+
+GzIndexedReaderPrivate::GzIndexedReaderPrivate(IRpFile *file)
+	: file(file ? file->ref() : nullptr)
+	, lastError(0)
+	, strm_init(false)
+	, raw_mode(false)
+	, eof(false)
+	, inbuf(new uint8_t[INBUF_SIZE])
+	, raw_pos(0)
+	, window(new uint8_t[GzIndexedReader::WINDOW_SIZE])
+	, wpos(0)
+	, out_pos(0)
+	, interval(GzIndexedReader::DEFAULT_INTERVAL)
+	, dirty(false)
+{
+	memset(&strm, 0, sizeof(strm));
+	if (!this->file) {
+		lastError = EBADF;
+		return;
+	}
+
+	// Make sure the CRC32 table is initialized.
+	get_crc_table();
+
+	// windowBits == 15+32: Automatic gzip/zlib header detection.
+	if (inflateInit2(&strm, 15+32) != Z_OK) {
+		lastError = ENOMEM;
+		return;
+	}
+	strm_init = true;
+}
+
+GzIndexedReaderPrivate::~GzIndexedReaderPrivate()
+{
+	if (strm_init) {
+		inflateEnd(&strm);
+	}
+	if (file) {
+		file->unref();
+	}
+}
+
+/**
+ * Read more compressed data into the input buffer.
+ * Any unused input is moved to the start of the buffer.
+ * @return Number of bytes read.
+ */
+size_t GzIndexedReaderPrivate::fillInput(void)
+{
+	if (strm.avail_in > 0 && strm.next_in != inbuf.get()) {
+		memmove(inbuf.get(), strm.next_in, strm.avail_in);
+	}
+	strm.next_in = inbuf.get();
+
+	const size_t size = file->seekAndRead(raw_pos, &inbuf[strm.avail_in], INBUF_SIZE - strm.avail_in);
+	raw_pos += size;
+	strm.avail_in += static_cast<uInt>(size);
+	return size;
+}
+
+/**
+ * Restart decompression at the beginning of the file.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GzIndexedReaderPrivate::resetToStart(void)
+{
+	if (inflateReset2(&strm, 15+32) != Z_OK) {
+		lastError = EIO;
+		return -EIO;
+	}
+
+	strm.next_in = inbuf.get();
+	strm.avail_in = 0;
+	raw_pos = 0;
+	raw_mode = false;
+	eof = false;
+	wpos = 0;
+	out_pos = 0;
+	return 0;
+}
+
+/**
+ * Restart decompression at a checkpoint.
+ * @param cp Checkpoint.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GzIndexedReaderPrivate::restoreCheckpoint(const Checkpoint &cp)
+{
+	// Checkpoints are always within a deflate stream,
+	// so the gzip header is not present.
+	if (inflateReset2(&strm, -15) != Z_OK) {
+		lastError = EIO;
+		return -EIO;
+	}
+
+	strm.next_in = inbuf.get();
+	strm.avail_in = 0;
+	raw_pos = cp.in;
+	if (cp.bits != 0) {
+		// The checkpoint starts in the middle of a byte.
+		uint8_t b;
+		if (file->seekAndRead(cp.in - 1, &b, 1) != 1) {
+			lastError = EIO;
+			return -EIO;
+		}
+		inflatePrime(&strm, cp.bits, b >> (8 - cp.bits));
+	}
+	inflateSetDictionary(&strm, cp.window.data(), GzIndexedReader::WINDOW_SIZE);
+
+	memcpy(window.get(), cp.window.data(), GzIndexedReader::WINDOW_SIZE);
+	wpos = 0;
+	raw_mode = true;
+	eof = false;
+	out_pos = cp.out;
+	return 0;
+}
+
+/**
+ * Add a checkpoint at the current position.
+ * The current position must be at a deflate block boundary.
+ */
+void GzIndexedReaderPrivate::addCheckpoint(void)
+{
+	if (checkpoints.size() >= GzIndexedReader::MAX_CHECKPOINTS) {
+		// Too many checkpoints. Keep every other one
+		// and double the interval.
+		auto iter_dest = checkpoints.begin();
+		for (size_t i = 1; i < checkpoints.size(); i += 2, ++iter_dest) {
+			*iter_dest = std::move(checkpoints[i]);
+		}
+		checkpoints.erase(iter_dest, checkpoints.end());
+		interval *= 2;
+
+		if (!checkpoints.empty() && out_pos - checkpoints.back().out < interval) {
+			// Too close to the previous checkpoint now.
+			dirty = true;
+			return;
+		}
+	}
+
+	Checkpoint cp;
+	cp.out = out_pos;
+	cp.in = raw_pos - strm.avail_in;
+	cp.bits = static_cast<uint8_t>(strm.data_type & 7);
+
+	// Save the window in order, starting with the oldest byte.
+	cp.window.resize(GzIndexedReader::WINDOW_SIZE);
+	const unsigned int left = GzIndexedReader::WINDOW_SIZE - wpos;
+	memcpy(cp.window.data(), &window[wpos], left);
+	memcpy(&cp.window[left], window.get(), wpos);
+
+	checkpoints.emplace_back(std::move(cp));
+	dirty = true;
+}
+
+/**
+ * Handle the end of a gzip member.
+ * If another member follows, decompression continues with it.
+ */
+void GzIndexedReaderPrivate::endOfMember(void)
+{
+	if (raw_mode) {
+		// Raw inflate doesn't process the gzip trailer.
+		// Skip the CRC32 and ISIZE fields.
+		unsigned int skip = 8;
+		while (skip > 0) {
+			if (strm.avail_in == 0 && fillInput() == 0) {
+				eof = true;
+				return;
+			}
+			const unsigned int n = (skip < strm.avail_in ? skip : strm.avail_in);
+			strm.next_in += n;
+			strm.avail_in -= n;
+			skip -= n;
+		}
+	}
+
+	// Check for another gzip member.
+	while (strm.avail_in < 2) {
+		if (fillInput() == 0)
+			break;
+	}
+	if (strm.avail_in < 2 || strm.next_in[0] != 0x1F || strm.next_in[1] != 0x8B) {
+		// No more members.
+		// NOTE: Trailing garbage is ignored, same as gzread().
+		eof = true;
+		return;
+	}
+
+	if (inflateReset2(&strm, 15+32) != Z_OK) {
+		lastError = EIO;
+		eof = true;
+		return;
+	}
+	raw_mode = false;
+}
+
+/**
+ * Decompress data.
+ * @param dest Output buffer, or nullptr to discard the data.
+ * @param size Number of bytes to decompress.
+ * @return Number of bytes decompressed.
+ */
+size_t GzIndexedReaderPrivate::inflateData(uint8_t *dest, size_t size)
+{
+	size_t total = 0;
+	while (total < size && !eof) {
+		if (strm.avail_in == 0) {
+			if (fillInput() == 0) {
+				// Unexpected end of file.
+				lastError = EIO;
+				eof = true;
+				break;
+			}
+		}
+
+		// Decompress into the output window.
+		// NOTE: Output is limited to the requested size so
+		// the decompressed position always matches out_pos.
+		unsigned int chunk = GzIndexedReader::WINDOW_SIZE - wpos;
+		if (chunk > size - total) {
+			chunk = static_cast<unsigned int>(size - total);
+		}
+		strm.next_out = &window[wpos];
+		strm.avail_out = chunk;
+
+		// Z_BLOCK stops at deflate block boundaries,
+		// which is where checkpoints can be added.
+		const int ret = inflate(&strm, Z_BLOCK);
+		const unsigned int produced = chunk - strm.avail_out;
+		if (dest && produced > 0) {
+			memcpy(&dest[total], &window[wpos], produced);
+		}
+		total += produced;
+		out_pos += produced;
+		wpos += produced;
+		if (wpos >= GzIndexedReader::WINDOW_SIZE) {
+			wpos = 0;
+		}
+
+		if (ret == Z_STREAM_END) {
+			endOfMember();
+			continue;
+		} else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+			// Data error.
+			lastError = EIO;
+			eof = true;
+			break;
+		}
+
+		// Add a checkpoint if this is the end of a block
+		// that isn't the last block in the stream, and
+		// this is far enough past the last checkpoint.
+		if ((strm.data_type & 128) && !(strm.data_type & 64)) {
+			const off64_t last_out = (checkpoints.empty() ? 0 : checkpoints.back().out);
+			if (out_pos > last_out && out_pos - last_out >= interval) {
+				addCheckpoint();
+			}
+		}
+	}
+
+	return total;
+}
+
+/** GzIndexedReader **/
+
+/**
+ * Create a random-access reader for a gzipped file.
+ * @param file Compressed file. (A reference is taken.)
+ */
+GzIndexedReader::GzIndexedReader(IRpFile *file)
+	: d(new GzIndexedReaderPrivate(file))
+{ }
+
+GzIndexedReader::~GzIndexedReader()
+{
+	if (d->dirty && !d->idxFilename.empty() && indexCacheWritable) {
+		// Save the index to the cache directory.
+		// Errors are ignored, since the cache is optional.
+		if (FileSystem::rmkdir(d->idxFilename) == 0) {
+			saveIndex(d->idxFilename, d->idxKey);
+		}
+	}
+	delete d;
+}
+
+/**
+ * Is the reader open?
+ * @return True if open; false if not.
+ */
+bool GzIndexedReader::isOpen(void) const
+{
+	return d->strm_init;
+}
+
+/**
+ * Get the last error.
+ * @return Last POSIX error, or 0 if no error.
+ */
+int GzIndexedReader::lastError(void) const
+{
+	return d->lastError;
+}
+
+/**
+ * Read decompressed data.
+ * @param ptr Output data buffer.
+ * @param size Amount of data to read, in bytes.
+ * @return Number of bytes read.
+ */
+size_t GzIndexedReader::read(void *ptr, size_t size)
+{
+	if (!d->strm_init) {
+		d->lastError = EBADF;
+		return 0;
+	}
+	return d->inflateData(static_cast<uint8_t*>(ptr), size);
+}
+
+/**
+ * Set the decompressed position.
+ * @param pos Decompressed position.
+ * @return 0 on success; -1 on error.
+ */
+int GzIndexedReader::seek(off64_t pos)
+{
+	if (!d->strm_init) {
+		d->lastError = EBADF;
+		return -1;
+	} else if (pos < 0) {
+		d->lastError = EINVAL;
+		return -1;
+	} else if (pos == d->out_pos) {
+		// Already at the requested position.
+		return 0;
+	}
+
+	// Find the last checkpoint at or before pos.
+	auto iter = std::upper_bound(d->checkpoints.cbegin(), d->checkpoints.cend(), pos,
+		[](off64_t pos, const GzIndexedReaderPrivate::Checkpoint &cp) {
+			return (pos < cp.out);
+		});
+	const GzIndexedReaderPrivate::Checkpoint *const cp =
+		(iter != d->checkpoints.cbegin() ? &(*(iter - 1)) : nullptr);
+
+	int ret = 0;
+	if (pos < d->out_pos || d->eof) {
+		// Seeking backwards.
+		// NOTE: Also done if EOF was reached, since the
+		// inflate state might not be usable anymore.
+		ret = (cp ? d->restoreCheckpoint(*cp) : d->resetToStart());
+	} else if (cp && cp->out > d->out_pos) {
+		// Seeking forwards past a checkpoint.
+		ret = d->restoreCheckpoint(*cp);
+	}
+	if (ret != 0) {
+		return -1;
+	}
+
+	// Decompress up to the requested position.
+	// NOTE: Seeking past the end of the data is allowed,
+	// same as gzseek(); read() will return 0.
+	d->inflateData(nullptr, static_cast<size_t>(pos - d->out_pos));
+	return 0;
+}
+
+/**
+ * Get the decompressed position.
+ * @return Decompressed position.
+ */
+off64_t GzIndexedReader::tell(void) const
+{
+	return d->out_pos;
+}
+
+/** Index functions **/
+
+/**
+ * Get the number of checkpoints in the index.
+ * @return Number of checkpoints.
+ */
+unsigned int GzIndexedReader::checkpointCount(void) const
+{
+	return static_cast<unsigned int>(d->checkpoints.size());
+}
+
+/**
+ * Get the current distance between checkpoints.
+ * @return Checkpoint interval, in uncompressed bytes.
+ */
+unsigned int GzIndexedReader::checkpointInterval(void) const
+{
+	return d->interval;
+}
+
+// Index file format. (All fields are little-endian.)
+// - Header: GzIndexHeader
+// - Key: key_len bytes
+// - Checkpoints: count * (GzIndexCheckpoint + compressed window)
+#define GZINDEX_MAGIC "RPGZIDX1"
+#pragma pack(1)
+struct PACKED GzIndexHeader {
+	char magic[8];		// GZINDEX_MAGIC
+	uint32_t interval;	// Checkpoint interval
+	uint32_t count;		// Number of checkpoints
+	uint32_t key_len;	// Key length
+};
+struct PACKED GzIndexCheckpoint {
+	uint64_t out;		// Decompressed offset
+	uint64_t in;		// Compressed offset
+	uint32_t bits;		// Bit offset
+	uint32_t window_len;	// Compressed window length
+};
+#pragma pack()
+
+/**
+ * Load an index from a file.
+ * The current index is replaced if the file is valid.
+ * @param idxFilename	[in] Index filename.
+ * @param key		[in] Index key. (must match the saved key)
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GzIndexedReader::loadIndex(const string &idxFilename, const string &key)
+{
+	RpFile *const f = new RpFile(idxFilename, RpFile::FM_OPEN_READ);
+	if (!f->isOpen()) {
+		const int err = f->lastError();
+		f->unref();
+		return (err != 0 ? -err : -EIO);
+	}
+
+	// Maximum index size: MAX_CHECKPOINTS uncompressed windows, plus overhead.
+	const off64_t fileSize = f->size();
+	static const off64_t maxSize = (off64_t)MAX_CHECKPOINTS * (WINDOW_SIZE + 1024) + 65536;
+	if (fileSize < (off64_t)sizeof(GzIndexHeader) || fileSize > maxSize) {
+		f->unref();
+		return -EIO;
+	}
+	vector<uint8_t> data(static_cast<size_t>(fileSize));
+	const size_t size = f->read(data.data(), data.size());
+	f->unref();
+	if (size != data.size()) {
+		return -EIO;
+	}
+
+	// Check the header.
+	GzIndexHeader hdr;
+	memcpy(&hdr, data.data(), sizeof(hdr));
+	const unsigned int interval = le32_to_cpu(hdr.interval);
+	const unsigned int count = le32_to_cpu(hdr.count);
+	const unsigned int key_len = le32_to_cpu(hdr.key_len);
+	if (memcmp(hdr.magic, GZINDEX_MAGIC, sizeof(hdr.magic)) != 0 ||
+	    interval < DEFAULT_INTERVAL || count > MAX_CHECKPOINTS ||
+	    key_len != key.size() ||
+	    sizeof(hdr) + key_len > data.size() ||
+	    memcmp(&data[sizeof(hdr)], key.data(), key_len) != 0)
+	{
+		// Invalid header, or the key doesn't match.
+		return -EIO;
+	}
+
+	// Load the checkpoints.
+	vector<GzIndexedReaderPrivate::Checkpoint> checkpoints;
+	checkpoints.reserve(count);
+	size_t pos = sizeof(hdr) + key_len;
+	for (unsigned int i = 0; i < count; i++) {
+		GzIndexCheckpoint icp;
+		if (pos + sizeof(icp) > data.size()) {
+			return -EIO;
+		}
+		memcpy(&icp, &data[pos], sizeof(icp));
+		pos += sizeof(icp);
+
+		GzIndexedReaderPrivate::Checkpoint cp;
+		cp.out = static_cast<off64_t>(le64_to_cpu(icp.out));
+		cp.in = static_cast<off64_t>(le64_to_cpu(icp.in));
+		cp.bits = static_cast<uint8_t>(le32_to_cpu(icp.bits));
+		const unsigned int window_len = le32_to_cpu(icp.window_len);
+		if (cp.bits > 7 || cp.in <= 0 || cp.out <= 0 ||
+		    (!checkpoints.empty() && cp.out <= checkpoints.back().out) ||
+		    window_len > data.size() - pos)
+		{
+			return -EIO;
+		}
+
+		cp.window.resize(WINDOW_SIZE);
+		uLongf destLen = WINDOW_SIZE;
+		if (uncompress(cp.window.data(), &destLen, &data[pos], window_len) != Z_OK ||
+		    destLen != WINDOW_SIZE)
+		{
+			return -EIO;
+		}
+		pos += window_len;
+		checkpoints.emplace_back(std::move(cp));
+	}
+
+	// Index loaded.
+	d->checkpoints = std::move(checkpoints);
+	d->interval = interval;
+	d->dirty = false;
+	return 0;
+}
+
+/**
+ * Save the index to a file.
+ * @param idxFilename	[in] Index filename.
+ * @param key		[in] Index key.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GzIndexedReader::saveIndex(const string &idxFilename, const string &key)
+{
+	// Serialize the index.
+	vector<uint8_t> data(sizeof(GzIndexHeader) + key.size());
+	GzIndexHeader hdr;
+	memcpy(hdr.magic, GZINDEX_MAGIC, sizeof(hdr.magic));
+	hdr.interval = cpu_to_le32(d->interval);
+	hdr.count = cpu_to_le32(static_cast<uint32_t>(d->checkpoints.size()));
+	hdr.key_len = cpu_to_le32(static_cast<uint32_t>(key.size()));
+	memcpy(data.data(), &hdr, sizeof(hdr));
+	memcpy(&data[sizeof(hdr)], key.data(), key.size());
+
+	// Windows are compressed, since they usually compress well.
+	unique_ptr<uint8_t[]> zbuf(new uint8_t[compressBound(WINDOW_SIZE)]);
+	for (auto iter = d->checkpoints.cbegin(); iter != d->checkpoints.cend(); ++iter) {
+		uLongf zlen = compressBound(WINDOW_SIZE);
+		if (compress2(zbuf.get(), &zlen, iter->window.data(), WINDOW_SIZE, 1) != Z_OK) {
+			return -EIO;
+		}
+
+		GzIndexCheckpoint icp;
+		icp.out = cpu_to_le64(static_cast<uint64_t>(iter->out));
+		icp.in = cpu_to_le64(static_cast<uint64_t>(iter->in));
+		icp.bits = cpu_to_le32(iter->bits);
+		icp.window_len = cpu_to_le32(static_cast<uint32_t>(zlen));
+
+		const size_t pos = data.size();
+		data.resize(pos + sizeof(icp) + zlen);
+		memcpy(&data[pos], &icp, sizeof(icp));
+		memcpy(&data[pos + sizeof(icp)], zbuf.get(), zlen);
+	}
+
+	// Write the index to a temporary file, then replace the old index.
+	// This ensures other readers never see a partially-written index.
+	const string tmpFilename = FileSystem::get_temp_filename(idxFilename);
+	RpFile *const f = new RpFile(tmpFilename, RpFile::FM_CREATE_WRITE);
+	if (!f->isOpen()) {
+		const int err = f->lastError();
+		f->unref();
+		return (err != 0 ? -err : -EIO);
+	}
+	const size_t size = f->write(data.data(), data.size());
+	f->unref();
+	if (size != data.size()) {
+		// Short write.
+		FileSystem::delete_file(tmpFilename);
+		return -EIO;
+	}
+
+	const int ret = FileSystem::rename_file(tmpFilename, idxFilename);
+	if (ret != 0) {
+		FileSystem::delete_file(tmpFilename);
+		return ret;
+	}
+
+	d->dirty = false;
+	return 0;
+}
+
+/**
+ * Use the rom-properties cache directory for the index.
+ *
+ * An existing index for the file is loaded, and the index
+ * is saved when the reader is deleted if new checkpoints
+ * were added.
+ *
+ * @param filename Filename of the gzipped file.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GzIndexedReader::enableIndexCache(const string &filename)
+{
+	off64_t fileSize;
+	time_t mtime;
+	int ret = FileSystem::get_file_size_and_mtime(filename, &fileSize, &mtime);
+	if (ret != 0) {
+		return ret;
+	}
+
+	const string &cacheDir = FileSystem::getCacheDirectory();
+	if (cacheDir.empty()) {
+		return -ENOENT;
+	}
+
+	// Key: Filename, file size, and mtime.
+	// The key is stored in the index file to prevent collisions.
+	char buf[64];
+	snprintf(buf, sizeof(buf), "\n%lld\n%lld",
+		static_cast<long long>(fileSize), static_cast<long long>(mtime));
+	d->idxKey = filename;
+	d->idxKey += buf;
+
+	// Index filename: gzidx/[CRC32 of key].idx
+	const uLong crc = crc32(0, reinterpret_cast<const Bytef*>(d->idxKey.data()),
+		static_cast<uInt>(d->idxKey.size()));
+	snprintf(buf, sizeof(buf), "gzidx%c%08lX.idx", DIR_SEP_CHR, static_cast<unsigned long>(crc));
+	d->idxFilename = cacheDir;
+	if (d->idxFilename.at(d->idxFilename.size()-1) != DIR_SEP_CHR) {
+		d->idxFilename += DIR_SEP_CHR;
+	}
+	d->idxFilename += buf;
+
+	// Load the existing index, if any.
+	if (d->checkpoints.empty()) {
+		loadIndex(d->idxFilename, d->idxKey);
+	}
+	return 0;
+}
+
+/**
+ * Allow saving indexes to the cache directory.
+ *
+ * This is enabled by default. Programs running in a sandbox
+ * that doesn't allow renaming or deleting files should
+ * disable it. Existing indexes are still loaded.
+ *
+ * @param writable True to save indexes; false to only load them.
+ */
+void GzIndexedReader::setIndexCacheWritable(bool writable)
+{
+	indexCacheWritable = writable;
+}
+
+}
@@ -0,0 +1,159 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpfile)                        *
+ * GzIndexedReader.hpp: Random-access gzip reader with a checkpoint index. *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPFILE_GZINDEXEDREADER_HPP__
+#define __ROMPROPERTIES_LIBRPFILE_GZINDEXEDREADER_HPP__
+
+// C includes.
+#include <stdint.h>
+
+// C includes. (C++ namespace)
+#include <cstddef>	/* for size_t */
+
+// C++ includes.
+#include <string>
+
+// common macros
+#include "common.h"
+
+namespace LibRpFile {
+
+class IRpFile;
+
+/**
+ * Random-access reader for gzipped files.
+ *
+ * zlib's gzseek() has to re-inflate the stream from the beginning
+ * for every backwards seek. This class records inflate checkpoints
+ * (compressed offset + 32 KB dictionary) at deflate block boundaries
+ * while the stream is being read, based on zlib's zran.c example.
+ * Seeking only has to decompress from the nearest checkpoint.
+ *
+ * The index can optionally be saved to the rom-properties cache
+ * directory, keyed by the filename, file size, and mtime.
+ */
+class GzIndexedReaderPrivate;
+class GzIndexedReader
+{
+	public:
+		/**
+		 * Create a random-access reader for a gzipped file.
+		 * @param file Compressed file. (A reference is taken.)
+		 */
+		explicit GzIndexedReader(IRpFile *file);
+		~GzIndexedReader();
+
+	private:
+		RP_DISABLE_COPY(GzIndexedReader)
+	private:
+		friend class GzIndexedReaderPrivate;
+		GzIndexedReaderPrivate *const d;
+
+	public:
+		// Inflate dictionary size.
+		static const unsigned int WINDOW_SIZE = 32768;
+		// Initial distance between checkpoints, in uncompressed bytes.
+		static const unsigned int DEFAULT_INTERVAL = 1048576;
+		// Maximum number of checkpoints. If this is reached,
+		// every other checkpoint is discarded and the interval
+		// is doubled in order to limit memory usage.
+		static const unsigned int MAX_CHECKPOINTS = 256;
+
+	public:
+		/**
+		 * Is the reader open?
+		 * @return True if open; false if not.
+		 */
+		bool isOpen(void) const;
+
+		/**
+		 * Get the last error.
+		 * @return Last POSIX error, or 0 if no error.
+		 */
+		int lastError(void) const;
+
+		/**
+		 * Read decompressed data.
+		 * @param ptr Output data buffer.
+		 * @param size Amount of data to read, in bytes.
+		 * @return Number of bytes read.
+		 */
+		size_t read(void *ptr, size_t size);
+
+		/**
+		 * Set the decompressed position.
+		 * @param pos Decompressed position.
+		 * @return 0 on success; -1 on error.
+		 */
+		int seek(off64_t pos);
+
+		/**
+		 * Get the decompressed position.
+		 * @return Decompressed position.
+		 */
+		off64_t tell(void) const;
+
+	public:
+		/** Index functions **/
+
+		/**
+		 * Get the number of checkpoints in the index.
+		 * @return Number of checkpoints.
+		 */
+		unsigned int checkpointCount(void) const;
+
+		/**
+		 * Get the current distance between checkpoints.
+		 * @return Checkpoint interval, in uncompressed bytes.
+		 */
+		unsigned int checkpointInterval(void) const;
+
+		/**
+		 * Load an index from a file.
+		 * The current index is replaced if the file is valid.
+		 * @param idxFilename	[in] Index filename.
+		 * @param key		[in] Index key. (must match the saved key)
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int loadIndex(const std::string &idxFilename, const std::string &key);
+
+		/**
+		 * Save the index to a file.
+		 * @param idxFilename	[in] Index filename.
+		 * @param key		[in] Index key.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int saveIndex(const std::string &idxFilename, const std::string &key);
+
+		/**
+		 * Use the rom-properties cache directory for the index.
+		 *
+		 * An existing index for the file is loaded, and the index
+		 * is saved when the reader is deleted if new checkpoints
+		 * were added.
+		 *
+		 * @param filename Filename of the gzipped file.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int enableIndexCache(const std::string &filename);
+
+		/**
+		 * Allow saving indexes to the cache directory.
+		 *
+		 * This is enabled by default. Programs running in a sandbox
+		 * that doesn't allow renaming or deleting files should
+		 * disable it. Existing indexes are still loaded.
+		 *
+		 * @param writable True to save indexes; false to only load them.
+		 */
+		static void setIndexCacheWritable(bool writable);
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBRPFILE_GZINDEXEDREADER_HPP__ */
@@ -105,4 +105,23 @@ size_t IRpFile::seekAndRead(off64_t pos, void *ptr, size_t size)
 	return this->read(ptr, size);
 }
 
+/**
+ * Seek to the specified address, then get a read-only pointer to the data.
+ *
+ * Default implementation: Read the data into buf.
+ *
+ * @param pos	[in] Requested seek address.
+ * @param pptr	[out] Pointer to the data.
+ * @param buf	[in] Fallback buffer. (must be at least size bytes)
+ * @param size	[in] Amount of data to read, in bytes.
+ * @return Number of bytes available at *pptr on success; 0 on seek or read error.
+ */
+size_t IRpFile::seekAndMap(off64_t pos, const void **pptr, void *buf, size_t size)
+{
+	assert(pptr != nullptr);
+	assert(buf != nullptr);
+	*pptr = buf;
+	return seekAndRead(pos, buf, size);
+}
+
 }
@@ -178,6 +178,43 @@ class IRpFile
 		 */
 		size_t seekAndRead(off64_t pos, void *ptr, size_t size);
 
+		/**
+		 * Seek to the specified address, then get a read-only pointer to the data.
+		 *
+		 * If the file is backed by memory (e.g. RpMemFile, or RpFile
+		 * opened with FM_MMAP), *pptr will point directly into the
+		 * file's memory and buf will not be touched. Otherwise, the
+		 * data is read into buf, and *pptr is set to buf.
+		 *
+		 * The returned pointer is valid until the file is closed or
+		 * the next call to seekAndMap() that uses the same buffer.
+		 * It might not be aligned; use memcpy() or unaligned-safe
+		 * accessors for multi-byte fields.
+		 *
+		 * @param pos	[in] Requested seek address.
+		 * @param pptr	[out] Pointer to the data.
+		 * @param buf	[in] Fallback buffer. (must be at least size bytes)
+		 * @param size	[in] Amount of data to read, in bytes.
+		 * @return Number of bytes available at *pptr on success; 0 on seek or read error.
+		 */
+		virtual size_t seekAndMap(off64_t pos, const void **pptr, void *buf, size_t size);
+
+		/**
+		 * Does this file own the memory that seekAndMap() points into?
+		 *
+		 * If true, pointers returned by seekAndMap() remain valid while
+		 * a reference to this file is held and it isn't closed. If false, the
+		 * data might be in buf, or in memory owned by someone else
+		 * (e.g. RpMemFile), so it must be copied if it's kept around.
+		 *
+		 * @return True if the file owns its mapped memory; false if not.
+		 */
+		virtual bool ownsMapping(void) const
+		{
+			// Default is no mapping.
+			return false;
+		}
+
 	protected:
 		int m_lastError;
 	private:
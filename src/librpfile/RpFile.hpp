@@ -44,6 +44,20 @@ class RpFile : public IRpFile
 			// Extras.
 			FM_GZIP_DECOMPRESS = 4,	// Transparent gzip decompression. (read-only!)
 			FM_OPEN_READ_GZ = FM_READ | FM_GZIP_DECOMPRESS,
+
+			// Memory-map the file if possible. (read-only!)
+			// Ignored for gzipped files, device files, and
+			// on systems that don't support mmap().
+			// NOTE: If another process truncates the file while
+			// it's mapped, accessing the mapping may crash.
+			FM_MMAP = 8,
+			FM_OPEN_READ_MMAP = FM_READ | FM_MMAP,
+			FM_OPEN_READ_GZ_MMAP = FM_READ | FM_GZIP_DECOMPRESS | FM_MMAP,
+
+			// Save the gzip seek index in the rom-properties
+			// cache directory, and load it when the same file
+			// is opened again. (FM_GZIP_DECOMPRESS only)
+			FM_GZIP_INDEX = 16,
 		};
 
 		/**
@@ -115,6 +129,25 @@ class RpFile : public IRpFile
 		 */
 		int truncate(off64_t size = 0) final;
 
+		/**
+		 * Seek to the specified address, then get a read-only pointer to the data.
+		 * If the file is memory-mapped, this returns a pointer into the mapping.
+		 * Otherwise, the data is read into buf.
+		 * @param pos	[in] Requested seek address.
+		 * @param pptr	[out] Pointer to the data.
+		 * @param buf	[in] Fallback buffer. (must be at least size bytes)
+		 * @param size	[in] Amount of data to read, in bytes.
+		 * @return Number of bytes available at *pptr on success; 0 on seek or read error.
+		 */
+		size_t seekAndMap(off64_t pos, const void **pptr, void *buf, size_t size) final;
+
+		/**
+		 * Does this file own the memory that seekAndMap() points into?
+		 * This is true if the file was opened with FM_MMAP and mapped successfully.
+		 * @return True if the file owns its mapped memory; false if not.
+		 */
+		bool ownsMapping(void) const final;
+
 	public:
 		/** File properties **/
 
@@ -23,15 +23,7 @@ using std::vector;
 
 // zlib for transparent gzip decompression.
 #include <zlib.h>
-// gzclose_r() and gzclose_w() were introduced in zlib-1.2.4.
-#if (ZLIB_VER_MAJOR > 1) || \
-    (ZLIB_VER_MAJOR == 1 && ZLIB_VER_MINOR > 2) || \
-    (ZLIB_VER_MAJOR == 1 && ZLIB_VER_MINOR == 2 && ZLIB_VER_REVISION >= 4)
-// zlib-1.2.4 or later
-#else
-# define gzclose_r(file) gzclose(file)
-# define gzclose_w(file) gzclose(file)
-#endif
+#include "GzIndexedReader.hpp"
 
 #ifdef _WIN32
 // Windows SDK
@@ -75,10 +67,14 @@ class RpFilePrivate
 
 		RpFilePrivate(RpFile *q, const char *filename, RpFile::FileMode mode)
 			: q_ptr(q), file(FILE_INIT), filename(filename)
-			, mode(mode), gzfd(nullptr), gzsz(-1), devInfo(nullptr) { }
+			, mode(mode), gzReader(nullptr), gzsz(-1)
+			, map(nullptr), map_size(0), map_pos(0)
+			, devInfo(nullptr) { }
 		RpFilePrivate(RpFile *q, const string &filename, RpFile::FileMode mode)
 			: q_ptr(q), file(FILE_INIT), filename(filename)
-			, mode(mode), gzfd(nullptr), gzsz(-1), devInfo(nullptr) { }
+			, mode(mode), gzReader(nullptr), gzsz(-1)
+			, map(nullptr), map_size(0), map_pos(0)
+			, devInfo(nullptr) { }
 		~RpFilePrivate();
 
 	private:
@@ -90,9 +86,16 @@ class RpFilePrivate
 		string filename;	// Filename.
 		RpFile::FileMode mode;	// File mode.
 
-		gzFile gzfd;		// Used for transparent gzip decompression.
+		GzIndexedReader *gzReader;	// Used for transparent gzip decompression.
 		off64_t gzsz;		// Uncompressed file size.
 
+		// Memory-mapped file. (FM_MMAP)
+		// If map is not nullptr, all reads are served
+		// from the mapping instead of the FILE_TYPE.
+		const uint8_t *map;	// Mapped file data.
+		size_t map_size;	// Mapped size.
+		size_t map_pos;		// Current position within the mapping.
+
 		// Device information struct.
 		// Only used if the underlying file
 		// is a device node.
@@ -195,7 +198,7 @@ class RpFilePrivate
 		/**
 		 * (Re-)Open the main file.
 		 *
-		 * INTERNAL FUNCTION. This does NOT affect gzfd.
+		 * INTERNAL FUNCTION. This does NOT affect gzReader.
 		 * NOTE: This function sets q->m_lastError.
 		 *
 		 * Uses parameters stored in this->filename and this->mode.
@@ -203,6 +206,31 @@ class RpFilePrivate
 		 */
 		int reOpenFile(void);
 
+		/**
+		 * Open the gzip reader for FM_GZIP_DECOMPRESS.
+		 *
+		 * INTERNAL FUNCTION. The compressed file is opened
+		 * again as a separate RpFile, since this RpFile
+		 * returns decompressed data.
+		 */
+		void openGzReader(void);
+
+#ifndef _WIN32
+		/**
+		 * Memory-map the file for FM_MMAP.
+		 *
+		 * INTERNAL FUNCTION. Must be called after the file
+		 * was opened and gzip/device handling was set up.
+		 * If the file can't be mapped, regular reads are used.
+		 */
+		void mapFile(void);
+
+		/**
+		 * Unmap the file if it's memory-mapped.
+		 */
+		void unmapFile(void);
+#endif /* !_WIN32 */
+
 	public:
 		/**
 		 * Read one sector into the sector cache.
@@ -18,6 +18,7 @@
 
 // C includes.
 #include <fcntl.h>	// AT_EMPTY_PATH
+#include <sys/mman.h>	// mmap(), munmap()
 #include <sys/stat.h>	// stat(), statx()
 #include <unistd.h>	// ftruncate()
 
@@ -27,9 +28,8 @@ namespace LibRpFile {
 
 RpFilePrivate::~RpFilePrivate()
 {
-	if (gzfd) {
-		gzclose_r(gzfd);
-	}
+	unmapFile();
+	delete gzReader;
 	if (file) {
 		fclose(file);
 	}
@@ -60,7 +60,7 @@ inline const char *RpFilePrivate::mode_to_str(RpFile::FileMode mode)
 /**
  * (Re-)Open the main file.
  *
- * INTERNAL FUNCTION. This does NOT affect gzfd.
+ * INTERNAL FUNCTION. This does NOT affect gzReader.
  * NOTE: This function sets q->m_lastError.
  *
  * Uses parameters stored in this->filename and this->mode.
@@ -196,6 +196,83 @@ int RpFilePrivate::reOpenFile(void)
 	return 0;
 }
 
+/**
+ * Open the gzip reader for FM_GZIP_DECOMPRESS.
+ *
+ * INTERNAL FUNCTION. The compressed file is opened
+ * again as a separate RpFile, since this RpFile
+ * returns decompressed data.
+ */
+void RpFilePrivate::openGzReader(void)
+{
+	assert(gzReader == nullptr);
+	RpFile *const gzFile = new RpFile(filename, RpFile::FM_OPEN_READ);
+	if (gzFile->isOpen()) {
+		gzReader = new GzIndexedReader(gzFile);
+		if (!gzReader->isOpen()) {
+			delete gzReader;
+			gzReader = nullptr;
+		} else if (mode & RpFile::FM_GZIP_INDEX) {
+			// Use the cached seek index.
+			gzReader->enableIndexCache(filename);
+		}
+	}
+	gzFile->unref();
+}
+
+/**
+ * Memory-map the file for FM_MMAP.
+ *
+ * INTERNAL FUNCTION. Must be called after the file
+ * was opened and gzip/device handling was set up.
+ * If the file can't be mapped, regular reads are used.
+ */
+void RpFilePrivate::mapFile(void)
+{
+	assert(file != nullptr);
+	assert(map == nullptr);
+	if (!file || map || gzReader || devInfo) {
+		// Can't map this file.
+		return;
+	} else if ((mode & RpFile::FM_MODE_MASK) != RpFile::FM_OPEN_READ) {
+		// Only read-only files can be mapped.
+		return;
+	}
+
+	struct stat sb;
+	if (fstat(fileno(file), &sb) != 0 || !S_ISREG(sb.st_mode)) {
+		// Not a regular file.
+		return;
+	}
+	if (sb.st_size <= 0 || static_cast<uint64_t>(sb.st_size) > static_cast<uint64_t>(SIZE_MAX)) {
+		// Empty file, or too big to map on this system.
+		return;
+	}
+
+	void *const p = mmap(nullptr, static_cast<size_t>(sb.st_size), PROT_READ, MAP_PRIVATE, fileno(file), 0);
+	if (p == MAP_FAILED) {
+		// mmap() failed. Use regular reads.
+		return;
+	}
+
+	map = static_cast<const uint8_t*>(p);
+	map_size = static_cast<size_t>(sb.st_size);
+	map_pos = 0;
+}
+
+/**
+ * Unmap the file if it's memory-mapped.
+ */
+void RpFilePrivate::unmapFile(void)
+{
+	if (map) {
+		munmap(const_cast<uint8_t*>(map), map_size);
+		map = nullptr;
+		map_size = 0;
+		map_pos = 0;
+	}
+}
+
 /** RpFile **/
 
 /**
@@ -248,7 +325,7 @@ void RpFile::init(void)
 	// Check if this is a gzipped file.
 	// If it is, use transparent decompression.
 	// Reference: https://www.forensicswiki.org/wiki/Gzip
-	if (d->mode == FM_OPEN_READ_GZ) {
+	if ((d->mode & (FM_MODE_MASK | FM_GZIP_DECOMPRESS)) == FM_OPEN_READ_GZ) {
 		uint16_t gzmagic;
 		size_t size = fread(&gzmagic, 1, sizeof(gzmagic), d->file);
 		if (size == sizeof(gzmagic) && gzmagic == be16_to_cpu(0x1F8B)) {
@@ -268,32 +345,21 @@ void RpFile::init(void)
 						// TODO: Add better verification heuristics?
 						d->gzsz = (off64_t)uncomp_sz;
 
-						// Make sure the CRC32 table is initialized.
-						get_crc_table();
-
-						// Open the file with gzdopen().
-						::rewind(d->file);
-						::fflush(d->file);
-						int gzfd_dup = ::dup(fileno(d->file));
-						if (gzfd_dup >= 0) {
-							d->gzfd = gzdopen(gzfd_dup, "r");
-							if (!d->gzfd) {
-								// gzdopen() failed.
-								// Close the dup()'d handle to prevent a leak.
-								::close(gzfd_dup);
-							}
-						}
+						// Open the gzip reader.
+						d->openGzReader();
 					}
 				}
 			}
 		}
 
-		if (!d->gzfd) {
-			// Not a gzipped file.
-			// Rewind and flush the file.
-			::rewind(d->file);
-			::fflush(d->file);
-		}
+		// Rewind and flush the file.
+		::rewind(d->file);
+		::fflush(d->file);
+	}
+
+	// Memory-map the file if requested.
+	if (d->mode & FM_MMAP) {
+		d->mapFile();
 	}
 }
 
@@ -328,10 +394,9 @@ void RpFile::close(void)
 		d->devInfo->close();
 	}
 
-	if (d->gzfd) {
-		gzclose_r(d->gzfd);
-		d->gzfd = nullptr;
-	}
+	d->unmapFile();
+	delete d->gzReader;
+	d->gzReader = nullptr;
 	if (d->file) {
 		fclose(d->file);
 		d->file = nullptr;
@@ -357,15 +422,22 @@ size_t RpFile::read(void *ptr, size_t size)
 		return d->readUsingBlocks(ptr, size);
 	}
 
+	if (d->map) {
+		// Memory-mapped file.
+		if (size > d->map_size - d->map_pos) {
+			size = d->map_size - d->map_pos;
+		}
+		memcpy(ptr, &d->map[d->map_pos], size);
+		d->map_pos += size;
+		return size;
+	}
+
 	size_t ret;
-	if (d->gzfd) {
-		int iret = gzread(d->gzfd, ptr, size);
-		if (iret >= 0) {
-			ret = (size_t)iret;
-		} else {
+	if (d->gzReader) {
+		ret = d->gzReader->read(ptr, size);
+		if (d->gzReader->lastError() != 0) {
 			// An error occurred.
-			ret = 0;
-			m_lastError = errno;
+			m_lastError = d->gzReader->lastError();
 		}
 	} else {
 		ret = fread(ptr, 1, size, d->file);
@@ -428,15 +500,23 @@ int RpFile::seek(off64_t pos)
 		return 0;
 	}
 
-	int ret;
-	if (d->gzfd) {
-		z_off_t zret = gzseek(d->gzfd, pos, SEEK_SET);
-		if (zret >= 0) {
-			ret = 0;
+	if (d->map) {
+		// Memory-mapped file.
+		if (pos <= 0) {
+			d->map_pos = 0;
+		} else if (static_cast<uint64_t>(pos) >= d->map_size) {
+			d->map_pos = d->map_size;
 		} else {
-			// TODO: Does gzseek() set errno?
-			ret = -1;
-			m_lastError = -EIO;
+			d->map_pos = static_cast<size_t>(pos);
+		}
+		return 0;
+	}
+
+	int ret;
+	if (d->gzReader) {
+		ret = d->gzReader->seek(pos);
+		if (ret != 0) {
+			m_lastError = d->gzReader->lastError();
 		}
 	} else {
 		ret = fseeko(d->file, pos, SEEK_SET);
@@ -460,12 +540,53 @@ off64_t RpFile::tell(void)
 		return -1;
 	}
 
-	if (d->gzfd) {
-		return (off64_t)gztell(d->gzfd);
+	if (d->map) {
+		return static_cast<off64_t>(d->map_pos);
+	} else if (d->gzReader) {
+		return d->gzReader->tell();
 	}
 	return ftello(d->file);
 }
 
+/**
+ * Seek to the specified address, then get a read-only pointer to the data.
+ * If the file is memory-mapped, this returns a pointer into the mapping.
+ * Otherwise, the data is read into buf.
+ * @param pos	[in] Requested seek address.
+ * @param pptr	[out] Pointer to the data.
+ * @param buf	[in] Fallback buffer. (must be at least size bytes)
+ * @param size	[in] Amount of data to read, in bytes.
+ * @return Number of bytes available at *pptr on success; 0 on seek or read error.
+ */
+size_t RpFile::seekAndMap(off64_t pos, const void **pptr, void *buf, size_t size)
+{
+	RP_D(RpFile);
+	if (!d->map) {
+		// Not memory-mapped.
+		return super::seekAndMap(pos, pptr, buf, size);
+	}
+
+	assert(pptr != nullptr);
+	seek(pos);
+	if (size > d->map_size - d->map_pos) {
+		size = d->map_size - d->map_pos;
+	}
+	*pptr = &d->map[d->map_pos];
+	d->map_pos += size;
+	return size;
+}
+
+/**
+ * Does this file own the memory that seekAndMap() points into?
+ * This is true if the file was opened with FM_MMAP and mapped successfully.
+ * @return True if the file owns its mapped memory; false if not.
+ */
+bool RpFile::ownsMapping(void) const
+{
+	RP_D(const RpFile);
+	return (d->map != nullptr);
+}
+
 /**
  * Truncate the file.
  * @param size New size. (default is 0)
@@ -532,7 +653,10 @@ off64_t RpFile::size(void)
 	if (d->devInfo) {
 		// Block device. Use the cached device size.
 		return d->devInfo->device_size;
-	} else if (d->gzfd) {
+	} else if (d->map) {
+		// Memory-mapped file. Use the mapped size.
+		return static_cast<off64_t>(d->map_size);
+	} else if (d->gzReader) {
 		// gzipped files have the uncompressed size stored
 		// at the end of the stream.
 		return d->gzsz;
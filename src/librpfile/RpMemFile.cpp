@@ -172,6 +172,34 @@ int RpMemFile::truncate(off64_t size)
 	return -1;
 }
 
+/**
+ * Seek to the specified address, then get a read-only pointer to the data.
+ * RpMemFile returns a pointer into the memory buffer; buf is not used.
+ * @param pos	[in] Requested seek address.
+ * @param pptr	[out] Pointer to the data.
+ * @param buf	[in] Fallback buffer. (ignored)
+ * @param size	[in] Amount of data to read, in bytes.
+ * @return Number of bytes available at *pptr on success; 0 on seek or read error.
+ */
+size_t RpMemFile::seekAndMap(off64_t pos, const void **pptr, void *buf, size_t size)
+{
+	RP_UNUSED(buf);
+	assert(pptr != nullptr);
+	if (seek(pos) != 0) {
+		// Seek error.
+		return 0;
+	}
+
+	// Clamp the size to the end of the buffer.
+	if (size > m_size - m_pos) {
+		size = m_size - m_pos;
+	}
+
+	*pptr = static_cast<const uint8_t*>(m_buf) + m_pos;
+	m_pos += size;
+	return size;
+}
+
 /** File properties **/
 
 /**
@@ -194,8 +222,7 @@ off64_t RpMemFile::size(void)
  */
 string RpMemFile::filename(void) const
 {
-	// TODO: Implement this?
-	return string();
+	return m_filename;
 }
 
 }
@@ -91,6 +91,17 @@ class RpMemFile : public IRpFile
 		 */
 		int truncate(off64_t size = 0) final;
 
+		/**
+		 * Seek to the specified address, then get a read-only pointer to the data.
+		 * RpMemFile returns a pointer into the memory buffer; buf is not used.
+		 * @param pos	[in] Requested seek address.
+		 * @param pptr	[out] Pointer to the data.
+		 * @param buf	[in] Fallback buffer. (ignored)
+		 * @param size	[in] Amount of data to read, in bytes.
+		 * @return Number of bytes available at *pptr on success; 0 on seek or read error.
+		 */
+		size_t seekAndMap(off64_t pos, const void **pptr, void *buf, size_t size) final;
+
 	public:
 		/** File properties **/
 
@@ -106,10 +117,22 @@ class RpMemFile : public IRpFile
 		 */
 		std::string filename(void) const final;
 
+		/**
+		 * Set the filename.
+		 * This is used for file extension checks,
+		 * e.g. in RomDataFactory::create().
+		 * @param filename Filename.
+		 */
+		void setFilename(const std::string &filename)
+		{
+			m_filename = filename;
+		}
+
 	protected:
 		const void *m_buf;	// Memory buffer.
 		size_t m_size;		// Size of memory buffer.
 		size_t m_pos;		// Current position.
+		std::string m_filename;	// Filename. (optional)
 };
 
 }
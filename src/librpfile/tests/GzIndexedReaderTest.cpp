@@ -0,0 +1,348 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpfile/tests)                  *
+ * GzIndexedReaderTest.cpp: GzIndexedReader test.                          *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// zlib
+#include <zlib.h>
+
+// librpfile
+#include "librpfile/GzIndexedReader.hpp"
+#include "librpfile/RpMemFile.hpp"
+#include "librpfile/FileSystem.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibRpFile { namespace Tests {
+
+class GzIndexedReaderTest : public ::testing::Test
+{
+	protected:
+		GzIndexedReaderTest()
+			: memFile(nullptr)
+		{ }
+
+	public:
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+	public:
+		// Uncompressed test data size.
+		// Large enough for several checkpoints.
+		static const unsigned int TEST_DATA_SIZE = 6*1024*1024 + 12345;
+
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 100;
+
+		/**
+		 * Generate compressible test data.
+		 * @param data Output vector.
+		 * @param size Data size.
+		 * @param seed LCG seed.
+		 */
+		static void genData(vector<uint8_t> &data, size_t size, uint32_t seed);
+
+		/**
+		 * Compress data as a single gzip member.
+		 * @param gzData Output vector. (data is appended)
+		 * @param data Uncompressed data.
+		 */
+		static void gzipData(vector<uint8_t> &gzData, const vector<uint8_t> &data);
+
+		/**
+		 * Check data at a given position.
+		 * @param reader GzIndexedReader.
+		 * @param pos Position.
+		 * @param size Size.
+		 */
+		void checkData(GzIndexedReader &reader, off64_t pos, size_t size);
+
+	public:
+		vector<uint8_t> data;	// Uncompressed data.
+		vector<uint8_t> gzData;	// Compressed data.
+		RpMemFile *memFile;	// Compressed data file.
+};
+
+/**
+ * Generate compressible test data.
+ * @param data Output vector.
+ * @param size Data size.
+ * @param seed LCG seed.
+ */
+void GzIndexedReaderTest::genData(vector<uint8_t> &data, size_t size, uint32_t seed)
+{
+	static const char *const words[] = {
+		"rom ", "properties ", "page ", "shell ", "extension ",
+		"GameCube ", "Wii ", "Nintendo DS ", "Sega ", "\n",
+		"checkpoint ", "inflate ", "deflate ", "0123456789 ",
+	};
+
+	data.resize(size);
+	uint32_t lcg = seed;
+	size_t pos = 0;
+	while (pos < size) {
+		lcg = lcg * 1103515245 + 12345;
+		const char *const word = words[(lcg >> 16) % ARRAY_SIZE(words)];
+		for (const char *p = word; *p != '\0' && pos < size; p++, pos++) {
+			data[pos] = static_cast<uint8_t>(*p);
+		}
+		if ((lcg & 0x3F) == 0 && pos < size) {
+			// Occasional binary byte.
+			data[pos++] = static_cast<uint8_t>(lcg >> 24);
+		}
+	}
+}
+
+/**
+ * Compress data as a single gzip member.
+ * @param gzData Output vector. (data is appended)
+ * @param data Uncompressed data.
+ */
+void GzIndexedReaderTest::gzipData(vector<uint8_t> &gzData, const vector<uint8_t> &data)
+{
+	z_stream strm;
+	memset(&strm, 0, sizeof(strm));
+	ASSERT_EQ(Z_OK, deflateInit2(&strm, 6, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY));
+
+	const size_t start = gzData.size();
+	gzData.resize(start + deflateBound(&strm, static_cast<uLong>(data.size())));
+	strm.next_in = const_cast<Bytef*>(data.data());
+	strm.avail_in = static_cast<uInt>(data.size());
+	strm.next_out = &gzData[start];
+	strm.avail_out = static_cast<uInt>(gzData.size() - start);
+	ASSERT_EQ(Z_STREAM_END, deflate(&strm, Z_FINISH));
+	gzData.resize(start + strm.total_out);
+	deflateEnd(&strm);
+}
+
+/**
+ * SetUp() function.
+ * Run before each test.
+ */
+void GzIndexedReaderTest::SetUp(void)
+{
+	genData(data, TEST_DATA_SIZE, 0x12345678);
+	gzData.clear();
+	gzipData(gzData, data);
+	memFile = new RpMemFile(gzData.data(), gzData.size());
+}
+
+/**
+ * TearDown() function.
+ * Run after each test.
+ */
+void GzIndexedReaderTest::TearDown(void)
+{
+	if (memFile) {
+		memFile->unref();
+		memFile = nullptr;
+	}
+}
+
+/**
+ * Check data at a given position.
+ * @param reader GzIndexedReader.
+ * @param pos Position.
+ * @param size Size.
+ */
+void GzIndexedReaderTest::checkData(GzIndexedReader &reader, off64_t pos, size_t size)
+{
+	vector<uint8_t> buf(size);
+	ASSERT_EQ(0, reader.seek(pos));
+	ASSERT_EQ(pos, reader.tell());
+
+	size_t expected = size;
+	if (static_cast<size_t>(pos) + size > data.size()) {
+		expected = data.size() - static_cast<size_t>(pos);
+	}
+	ASSERT_EQ(expected, reader.read(buf.data(), size));
+	EXPECT_EQ(0, memcmp(&data[static_cast<size_t>(pos)], buf.data(), expected));
+	EXPECT_EQ(pos + static_cast<off64_t>(expected), reader.tell());
+}
+
+/**
+ * Read the entire file sequentially.
+ */
+TEST_F(GzIndexedReaderTest, sequentialReadTest)
+{
+	GzIndexedReader reader(memFile);
+	ASSERT_TRUE(reader.isOpen());
+
+	vector<uint8_t> buf(data.size() + 1024);
+	size_t total = 0;
+	while (total < buf.size()) {
+		// Odd-sized reads to test partial window handling.
+		size_t size = 12345;
+		if (total + size > buf.size()) {
+			size = buf.size() - total;
+		}
+		const size_t ret = reader.read(&buf[total], size);
+		total += ret;
+		if (ret < size)
+			break;
+	}
+
+	ASSERT_EQ(data.size(), total);
+	EXPECT_EQ(0, memcmp(data.data(), buf.data(), data.size()));
+	EXPECT_EQ(0, reader.lastError());
+
+	// Checkpoints should have been added.
+	EXPECT_GE(reader.checkpointCount(), TEST_DATA_SIZE / GzIndexedReader::DEFAULT_INTERVAL - 1);
+}
+
+/**
+ * Seek backwards and forwards after the index was built.
+ */
+TEST_F(GzIndexedReaderTest, randomSeekTest)
+{
+	GzIndexedReader reader(memFile);
+	ASSERT_TRUE(reader.isOpen());
+
+	// Read a footer first. This builds the index.
+	checkData(reader, data.size() - 1024, 1024);
+	EXPECT_GT(reader.checkpointCount(), 0U);
+
+	// Seek to various locations.
+	static const off64_t positions[] = {
+		0, 5*1024*1024, 1, 3*1024*1024 + 17, 1024*1024 - 1,
+		1024*1024, 1024*1024 + 1, 6*1024*1024, 2*1024*1024 - 7,
+		TEST_DATA_SIZE - 1, 4096,
+	};
+	for (size_t i = 0; i < ARRAY_SIZE(positions); i++) {
+		checkData(reader, positions[i], 65536);
+	}
+
+	// Seeking past the end of the data is allowed,
+	// but nothing can be read.
+	uint8_t b;
+	EXPECT_EQ(0, reader.seek(TEST_DATA_SIZE + 100));
+	EXPECT_EQ(0U, reader.read(&b, 1));
+
+	// Seeking to a negative position is not allowed.
+	EXPECT_EQ(-1, reader.seek(-1));
+}
+
+/**
+ * Concatenated gzip members.
+ */
+TEST_F(GzIndexedReaderTest, multiMemberTest)
+{
+	// Append a second member.
+	vector<uint8_t> data2;
+	genData(data2, 3*1024*1024 + 99, 0x87654321);
+	memFile->unref();
+	gzipData(gzData, data2);
+	memFile = new RpMemFile(gzData.data(), gzData.size());
+	data.insert(data.end(), data2.begin(), data2.end());
+
+	GzIndexedReader reader(memFile);
+	ASSERT_TRUE(reader.isOpen());
+
+	// Read the end of the second member, then seek
+	// back into both members.
+	checkData(reader, data.size() - 4096, 4096);
+	checkData(reader, TEST_DATA_SIZE - 100, 200);
+	checkData(reader, TEST_DATA_SIZE + 1024*1024 + 5, 4096);
+	checkData(reader, 0, 4096);
+	checkData(reader, TEST_DATA_SIZE - 3000, 70000);
+}
+
+/**
+ * Save the index and load it in a new reader.
+ */
+TEST_F(GzIndexedReaderTest, saveLoadIndexTest)
+{
+	const string idxFilename = "GzIndexedReaderTest.idx";
+	const string key = "GzIndexedReaderTest";
+	unsigned int cpCount;
+	{
+		GzIndexedReader reader(memFile);
+		checkData(reader, data.size() - 1024, 1024);
+		cpCount = reader.checkpointCount();
+		ASSERT_GT(cpCount, 0U);
+		ASSERT_EQ(0, reader.saveIndex(idxFilename, key));
+	}
+
+	GzIndexedReader reader(memFile);
+	EXPECT_NE(0, reader.loadIndex(idxFilename, "wrong key"));
+	EXPECT_EQ(0U, reader.checkpointCount());
+	ASSERT_EQ(0, reader.loadIndex(idxFilename, key));
+	EXPECT_EQ(cpCount, reader.checkpointCount());
+	FileSystem::delete_file(idxFilename);
+
+	// Seeks should use the loaded checkpoints.
+	checkData(reader, 5*1024*1024 + 3, 65536);
+	checkData(reader, 1024*1024 + 3, 65536);
+	checkData(reader, data.size() - 100, 100);
+}
+
+/**
+ * Benchmark seeking backwards to the beginning and
+ * forwards to the footer, as done by RomDataFactory.
+ */
+TEST_F(GzIndexedReaderTest, seek_benchmark)
+{
+	GzIndexedReader reader(memFile);
+	uint8_t buf[1024];
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		reader.seek(0);
+		reader.read(buf, sizeof(buf));
+		reader.seek(data.size() - sizeof(buf));
+		reader.read(buf, sizeof(buf));
+	}
+}
+
+/**
+ * Benchmark the same access pattern with gzseek().
+ */
+TEST_F(GzIndexedReaderTest, gzseek_benchmark)
+{
+	const char *const filename = "GzIndexedReaderTest.gz";
+	FILE *f = fopen(filename, "wb");
+	ASSERT_TRUE(f != nullptr);
+	fwrite(gzData.data(), 1, gzData.size(), f);
+	fclose(f);
+
+	gzFile gzf = gzopen(filename, "rb");
+	ASSERT_TRUE(gzf != nullptr);
+	uint8_t buf[1024];
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		gzseek(gzf, 0, SEEK_SET);
+		gzread(gzf, buf, sizeof(buf));
+		gzseek(gzf, static_cast<z_off_t>(data.size() - sizeof(buf)), SEEK_SET);
+		gzread(gzf, buf, sizeof(buf));
+	}
+	gzclose(gzf);
+	FileSystem::delete_file(filename);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpFile test suite: GzIndexedReader tests.\n\n");
+	fprintf(stderr, "Benchmark iterations: %u\n", LibRpFile::Tests::GzIndexedReaderTest::BENCHMARK_ITERATIONS);
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -312,6 +312,35 @@ int delete_file(const char *filename)
 	return ret;
 }
 
+/**
+ * Rename a file.
+ * If the new filename already exists, it will be replaced.
+ * On POSIX systems, the replacement is atomic.
+ * @param oldFilename Old filename.
+ * @param newFilename New filename.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int rename_file(const char *oldFilename, const char *newFilename)
+{
+	assert(oldFilename != nullptr);
+	assert(newFilename != nullptr);
+	if (unlikely(!oldFilename || oldFilename[0] == 0 ||
+	             !newFilename || newFilename[0] == 0))
+	{
+		return -EINVAL;
+	}
+
+	int ret = 0;
+	const tstring toldFilename = makeWinPath(oldFilename);
+	const tstring tnewFilename = makeWinPath(newFilename);
+	if (!MoveFileEx(toldFilename.c_str(), tnewFilename.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+		// Error renaming file.
+		ret = -w32err_to_posix(GetLastError());
+	}
+
+	return ret;
+}
+
 /**
  * Check if the specified file is a symbolic link.
  * @return True if the file is a symbolic link; false if not.
@@ -40,9 +40,7 @@ DELAYLOAD_TEST_FUNCTION_IMPL0(zlibVersion);
 
 RpFilePrivate::~RpFilePrivate()
 {
-	if (gzfd) {
-		gzclose_r(gzfd);
-	}
+	delete gzReader;
 	if (file && file != INVALID_HANDLE_VALUE) {
 		CloseHandle(file);
 	}
@@ -91,7 +89,7 @@ inline int RpFilePrivate::mode_to_win32(RpFile::FileMode mode,
 /**
  * (Re-)Open the main file.
  *
- * INTERNAL FUNCTION. This does NOT affect gzfd.
+ * INTERNAL FUNCTION. This does NOT affect gzReader.
  * NOTE: This function sets q->m_lastError.
  *
  * Uses parameters stored in this->filename and this->mode.
@@ -263,6 +261,30 @@ int RpFilePrivate::reOpenFile(void)
 	return (!file || file == INVALID_HANDLE_VALUE);
 }
 
+/**
+ * Open the gzip reader for FM_GZIP_DECOMPRESS.
+ *
+ * INTERNAL FUNCTION. The compressed file is opened
+ * again as a separate RpFile, since this RpFile
+ * returns decompressed data.
+ */
+void RpFilePrivate::openGzReader(void)
+{
+	assert(gzReader == nullptr);
+	RpFile *const gzFile = new RpFile(filename, RpFile::FM_OPEN_READ);
+	if (gzFile->isOpen()) {
+		gzReader = new GzIndexedReader(gzFile);
+		if (!gzReader->isOpen()) {
+			delete gzReader;
+			gzReader = nullptr;
+		} else if (mode & RpFile::FM_GZIP_INDEX) {
+			// Use the cached seek index.
+			gzReader->enableIndexCache(filename);
+		}
+	}
+	gzFile->unref();
+}
+
 /** RpFile **/
 
 /**
@@ -315,7 +337,7 @@ void RpFile::init(void)
 	// Check if this is a gzipped file.
 	// If it is, use transparent decompression.
 	// Reference: https://www.forensicswiki.org/wiki/Gzip
-	if (!d->devInfo && d->mode == FM_OPEN_READ_GZ) {
+	if (!d->devInfo && (d->mode & (FM_MODE_MASK | FM_GZIP_DECOMPRESS)) == FM_OPEN_READ_GZ) {
 #if defined(_MSC_VER) && defined(ZLIB_IS_DLL)
 		// Delay load verification.
 		// TODO: Only if linked with /DELAYLOAD?
@@ -350,54 +372,19 @@ void RpFile::init(void)
 						// TODO: Add better verification heuristics?
 						d->gzsz = (off64_t)uncomp_sz;
 
-						liSeekPos.QuadPart = 0;
-						SetFilePointerEx(d->file, liSeekPos, nullptr, FILE_BEGIN);
-						// NOTE: Not sure if this is needed on Windows.
-						FlushFileBuffers(d->file);
-
-						// Open the file with gzdopen().
-						HANDLE hGzDup;
-						BOOL bRet = DuplicateHandle(
-							GetCurrentProcess(),	// hSourceProcessHandle
-							d->file,		// hSourceHandle
-							GetCurrentProcess(),	// hTargetProcessHandle
-							&hGzDup,		// lpTargetHandle
-							0,			// dwDesiredAccess
-							FALSE,			// bInheritHandle
-							DUPLICATE_SAME_ACCESS);	// dwOptions
-						if (bRet) {
-							// NOTE: close() on gzfd_dup() will close the
-							// underlying Windows handle.
-							int gzfd_dup = _open_osfhandle((intptr_t)hGzDup, _O_RDONLY);
-							if (gzfd_dup >= 0) {
-								// Make sure the CRC32 table is initialized.
-								get_crc_table();
-
-								d->gzfd = gzdopen(gzfd_dup, "r");
-								if (!d->gzfd) {
-									// gzdopen() failed.
-									// Close the dup()'d handle to prevent a leak.
-									_close(gzfd_dup);
-								}
-							} else {
-								// Unable to open an fd.
-								CloseHandle(hGzDup);
-							}
-						}
+						// Open the gzip reader.
+						d->openGzReader();
 					}
 				}
 			}
 		}
 
-		if (!d->gzfd) {
-			// Not a gzipped file.
-			// Rewind and flush the file.
-			LARGE_INTEGER liSeekPos;
-			liSeekPos.QuadPart = 0;
-			SetFilePointerEx(d->file, liSeekPos, nullptr, FILE_BEGIN);
-			// NOTE: Not sure if this is needed on Windows.
-			FlushFileBuffers(d->file);
-		}
+		// Rewind and flush the file.
+		LARGE_INTEGER liSeekPos;
+		liSeekPos.QuadPart = 0;
+		SetFilePointerEx(d->file, liSeekPos, nullptr, FILE_BEGIN);
+		// NOTE: Not sure if this is needed on Windows.
+		FlushFileBuffers(d->file);
 	}
 }
 
@@ -432,10 +419,8 @@ void RpFile::close(void)
 		d->devInfo->close();
 	}
 
-	if (d->gzfd) {
-		gzclose_r(d->gzfd);
-		d->gzfd = nullptr;
-	}
+	delete d->gzReader;
+	d->gzReader = nullptr;
 	if (d->file && d->file != INVALID_HANDLE_VALUE) {
 		CloseHandle(d->file);
 		d->file = INVALID_HANDLE_VALUE;
@@ -465,14 +450,11 @@ size_t RpFile::read(void *ptr, size_t size)
 	}
 
 	DWORD bytesRead;
-	if (d->gzfd) {
-		int iret = gzread(d->gzfd, ptr, (unsigned int)size);
-		if (iret >= 0) {
-			bytesRead = (DWORD)iret;
-		} else {
+	if (d->gzReader) {
+		bytesRead = (DWORD)d->gzReader->read(ptr, size);
+		if (d->gzReader->lastError() != 0) {
 			// An error occurred.
-			bytesRead = 0;
-			m_lastError = errno;
+			m_lastError = d->gzReader->lastError();
 		}
 	} else {
 		BOOL bRet = ReadFile(d->file, ptr, static_cast<DWORD>(size), &bytesRead, nullptr);
@@ -547,15 +529,10 @@ int RpFile::seek(off64_t pos)
 	}
 
 	int ret;
-	if (d->gzfd) {
-		// FIXME: Might not work with >2GB files...
-		z_off_t zret = gzseek(d->gzfd, (long)pos, SEEK_SET);
-		if (zret >= 0) {
-			ret = 0;
-		} else {
-			// TODO: Does gzseek() set errno?
-			ret = -1;
-			m_lastError = -EIO;
+	if (d->gzReader) {
+		ret = d->gzReader->seek(pos);
+		if (ret != 0) {
+			m_lastError = d->gzReader->lastError();
 		}
 	} else {
 		LARGE_INTEGER liSeekPos;
@@ -591,8 +568,8 @@ off64_t RpFile::tell(void)
 		return d->devInfo->device_pos;
 	}
 
-	if (d->gzfd) {
-		return (off64_t)gztell(d->gzfd);
+	if (d->gzReader) {
+		return d->gzReader->tell();
 	}
 
 	LARGE_INTEGER liSeekPos, liSeekRet;
@@ -606,6 +583,31 @@ off64_t RpFile::tell(void)
 	return liSeekRet.QuadPart;
 }
 
+/**
+ * Seek to the specified address, then get a read-only pointer to the data.
+ * FM_MMAP is not currently implemented on Windows,
+ * so the data is always read into buf.
+ * @param pos	[in] Requested seek address.
+ * @param pptr	[out] Pointer to the data.
+ * @param buf	[in] Fallback buffer. (must be at least size bytes)
+ * @param size	[in] Amount of data to read, in bytes.
+ * @return Number of bytes available at *pptr on success; 0 on seek or read error.
+ */
+size_t RpFile::seekAndMap(off64_t pos, const void **pptr, void *buf, size_t size)
+{
+	return super::seekAndMap(pos, pptr, buf, size);
+}
+
+/**
+ * Does this file own the memory that seekAndMap() points into?
+ * FM_MMAP is not currently implemented on Windows.
+ * @return False.
+ */
+bool RpFile::ownsMapping(void) const
+{
+	return false;
+}
+
 /**
  * Truncate the file.
  * @param size New size. (default is 0)
@@ -680,7 +682,7 @@ off64_t RpFile::size(void)
 	if (d->devInfo) {
 		// Block device. Use the cached device size.
 		return d->devInfo->device_size;
-	} else if (d->gzfd) {
+	} else if (d->gzReader) {
 		// gzipped files have the uncompressed size stored
 		// at the end of the stream.
 		return d->gzsz;
@@ -197,6 +197,56 @@ FileFormat *FileFormatFactory::create(IRpFile *file)
 	return nullptr;
 }
 
+/**
+ * Check if a texture file's header might be supported.
+ *
+ * This only checks the magic numbers, so it's much
+ * cheaper than calling create() for unsupported files.
+ * A return value of 0 doesn't guarantee that create()
+ * will succeed.
+ *
+ * @param pHeader File header, starting at address 0.
+ * @param size Size of pHeader. (Must be at least 8 bytes.)
+ * @return 0 if the header might be supported; -1 if not.
+ */
+int FileFormatFactory::isTextureSupported(const uint8_t *pHeader, size_t size)
+{
+	assert(pHeader != nullptr);
+	if (!pHeader || size < sizeof(uint32_t)*2) {
+		// create() reads 8 bytes for the magic number.
+		return -1;
+	}
+
+	uint32_t magic[2];
+	memcpy(magic, pHeader, sizeof(magic));
+
+	// Special check for Khronos KTX, which has the same
+	// 32-bit magic number for two completely different versions.
+	if (magic[0] == cpu_to_be32('\xABKTX')) {
+		if (magic[1] == cpu_to_be32(' 11\xBB') ||
+		    magic[1] == cpu_to_be32(' 20\xBB'))
+		{
+			// KTX 1.1 or KTX 2.0
+			return 0;
+		}
+	}
+
+	// Magic number needs to be in host-endian.
+	magic[0] = be32_to_cpu(magic[0]);
+
+	const FileFormatFactoryPrivate::FileFormatFns *fns =
+		&FileFormatFactoryPrivate::FileFormatFns_magic[0];
+	for (; fns->supportedFileExtensions != nullptr; fns++) {
+		if (magic[0] == fns->magic) {
+			// Found a matching magic number.
+			return 0;
+		}
+	}
+
+	// Not supported.
+	return -1;
+}
+
 /**
  * Get all supported file extensions.
  * Used for Win32 COM registration.
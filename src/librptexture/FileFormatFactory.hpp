@@ -11,6 +11,9 @@
 
 #include "common.h"
 
+// C includes.
+#include <stdint.h>
+
 // C++ includes.
 #include <utility>
 #include <vector>
@@ -47,6 +50,20 @@ class FileFormatFactory
 		 */
 		static LibRpTexture::FileFormat *create(LibRpFile::IRpFile *file);
 
+		/**
+		 * Check if a texture file's header might be supported.
+		 *
+		 * This only checks the magic numbers, so it's much
+		 * cheaper than calling create() for unsupported files.
+		 * A return value of 0 doesn't guarantee that create()
+		 * will succeed.
+		 *
+		 * @param pHeader File header, starting at address 0.
+		 * @param size Size of pHeader. (Must be at least 8 bytes.)
+		 * @return 0 if the header might be supported; -1 if not.
+		 */
+		static int isTextureSupported(const uint8_t *pHeader, size_t size);
+
 		/**
 		 * Get all supported file extensions.
 		 * Used for Win32 COM registration.
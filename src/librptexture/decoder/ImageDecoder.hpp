@@ -134,6 +134,38 @@ enum PixelFormat {
 #endif
 };
 
+/** Multithreaded decoding **/
+
+/**
+ * Set the maximum number of threads used to decode large
+ * block-compressed and tiled images.
+ * The decoded image is identical regardless of thread count.
+ * @param threads Maximum number of threads. (0 == one per CPU; 1 == single-threaded)
+ */
+void setMaxThreads(unsigned int threads);
+
+/**
+ * Get the maximum number of threads used to decode large
+ * block-compressed and tiled images.
+ * @return Maximum number of threads. (0 == one per CPU; 1 == single-threaded)
+ */
+unsigned int maxThreads(void);
+
+/**
+ * Set the minimum image size for multithreaded decoding.
+ * Smaller images are always decoded on the calling thread,
+ * since the thread synchronization overhead would be larger
+ * than the decoding time.
+ * @param pixels Minimum image size, in pixels.
+ */
+void setMTPixelThreshold(unsigned int pixels);
+
+/**
+ * Get the minimum image size for multithreaded decoding.
+ * @return Minimum image size, in pixels.
+ */
+unsigned int mtPixelThreshold(void);
+
 /**
  * Convert a linear CI4 image to rp_image with a little-endian 16-bit palette.
  * @param px_format Palette pixel format.
@@ -713,6 +745,46 @@ rp_image *fromPVRTCII(int width, int height,
 
 /* BC7 */
 
+/**
+ * Convert a BC7 image to rp_image.
+ * Standard version using regular C++ code.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromBC7_cpp(int width, int height,
+	const uint8_t *img_buf, int img_siz);
+
+#ifdef IMAGEDECODER_HAS_SSE2
+/**
+ * Convert a BC7 image to rp_image.
+ * SSE2-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromBC7_sse2(int width, int height,
+	const uint8_t *img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSE2 */
+
+#ifdef IMAGEDECODER_HAS_SSSE3
+/**
+ * Convert a BC7 image to rp_image.
+ * SSSE3-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromBC7_ssse3(int width, int height,
+	const uint8_t *img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+
 /**
  * Convert a BC7 image to rp_image.
  * @param width Image width.
@@ -721,7 +793,7 @@ rp_image *fromPVRTCII(int width, int height,
  * @param img_siz Size of image data. [must be >= (w*h)]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromBC7(int width, int height,
+IFUNC_STATIC_INLINE rp_image *fromBC7(int width, int height,
 	const uint8_t *img_buf, int img_siz);
 
 /*************************
@@ -835,6 +907,39 @@ static rp_image *fromLinear32(PixelFormat px_format,
 	}
 }
 
+/**
+ * Convert a BC7 image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+static inline rp_image *fromBC7(int width, int height,
+	const uint8_t *img_buf, int img_siz)
+{
+#ifdef IMAGEDECODER_HAS_SSSE3
+	if (RP_CPU_HasSSSE3()) {
+		return fromBC7_ssse3(width, height, img_buf, img_siz);
+	} else
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+#ifdef IMAGEDECODER_ALWAYS_HAS_SSE2
+	{
+		// amd64 always has SSE2.
+		return fromBC7_sse2(width, height, img_buf, img_siz);
+	}
+#else /* !IMAGEDECODER_ALWAYS_HAS_SSE2 */
+# ifdef IMAGEDECODER_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		return fromBC7_sse2(width, height, img_buf, img_siz);
+	} else
+# endif /* IMAGEDECODER_HAS_SSE2 */
+	{
+		return fromBC7_cpp(width, height, img_buf, img_siz);
+	}
+#endif /* IMAGEDECODER_ALWAYS_HAS_SSE2 */
+}
+
 #endif /* !defined(RP_HAS_IFUNC) || (!defined(RP_CPU_I386) && !defined(RP_CPU_AMD64)) */
 
 } }
@@ -10,6 +10,7 @@
 
 #include "ImageDecoder.hpp"
 #include "ImageDecoder_p.hpp"
+#include "ImageDecoder_BC7_p.hpp"
 
 // References:
 // - https://msdn.microsoft.com/en-us/library/windows/desktop/hh308953(v=vs.85).aspx
@@ -21,6 +22,8 @@ namespace LibRpTexture { namespace ImageDecoder {
 static const uint8_t aWeight2[] = {0, 21, 43, 64};
 static const uint8_t aWeight3[] = {0, 9, 18, 27, 37, 46, 55, 64};
 static const uint8_t aWeight4[] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+// Interpolation values, indexed by index precision.
+static const uint8_t *const aWeights[5] = {nullptr, nullptr, aWeight2, aWeight3, aWeight4};
 
 /** Partition definitions. **/
 
@@ -74,47 +77,6 @@ static const uint32_t bc7_3sub[64] = {
 	0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254
 };
 
-/**
- * Interpolate a color component.
- * @tparam bits Index precision, in number of bits.
- * @param index Color/alpha index.
- * @param e0 Endpoint 0 component.
- * @param e1 Endpoint 1 component.
- * @return Interpolated color component.
- */
-static uint8_t interpolate_component(unsigned int bits, unsigned int index, uint8_t e0, uint8_t e1)
-{
-	assert(bits >= 2 && bits <= 4);
-	assert(index < (1U << bits));
-
-	// Shortcut for no-interpolation cases.
-	// TODO: Does this actually improve performance?
-	if (index == 0) {
-		return e0;
-	} else if (index == (1U<<bits)-1) {
-		return e1;
-	}
-
-	uint8_t weight;
-	switch (bits) {
-		case 2:
-			weight = aWeight2[index];
-			break;
-		case 3:
-			weight = aWeight3[index];
-			break;
-		case 4:
-			weight = aWeight4[index];
-			break;
-		default:
-			// Should not happen...
-			return 0;
-	}
-
-	return (uint8_t)((((64 - weight) * (unsigned int)e0) +
-			       ((weight  * (unsigned int)e1) + 32)) >> 6);
-}
-
 /**
  * Get the mode number.
  * @param dword0 LSB DWORD.
@@ -237,15 +199,437 @@ static FORCEINLINE void rshift128(uint64_t &msb, uint64_t &lsb, unsigned int sha
 	msb >>= shamt;
 }
 
+/**
+ * Swap the alpha channel with another channel.
+ * @param px ARGB32 pixel.
+ * @param rotation_mode Rotation mode.
+ * @return Rotated pixel.
+ */
+static inline uint32_t rotate_argb32(uint32_t px, uint8_t rotation_mode)
+{
+	switch (rotation_mode & 3) {
+		default:
+		case 0:
+			// ARGB: No rotation.
+			return px;
+		case 1:
+			// RAGB: Swap A and R.
+			return (px & 0x0000FFFF) | ((px >> 8) & 0x00FF0000) | ((px << 8) & 0xFF000000);
+		case 2:
+			// GRAB: Swap A and G.
+			return (px & 0x00FF00FF) | ((px >> 16) & 0x0000FF00) | ((px << 16) & 0xFF000000);
+		case 3:
+			// BRGA: Swap A and B.
+			return (px & 0x00FFFF00) | (px >> 24) | (px << 24);
+	}
+}
+
+/**
+ * Decode a BC7 block into tile parameters.
+ * This handles everything except for the actual interpolation.
+ * @param params	[out] Tile parameters.
+ * @param bc7_src	[in] BC7 block. (128-bit little-endian)
+ * @return 0 on success; non-zero on error.
+ */
+static int decodeBC7Block(BC7_TileParams *RESTRICT params, const uint64_t *RESTRICT bc7_src)
+{
+	/** BEGIN: Temporary values. **/
+
+	// Endpoints.
+	// - [8]: Individual endpoints.
+	// - [4]: RGBx components. (idx3 is unused)
+	// NOTE: Endpoints 6 and 7 are never used.
+	// They're kept here because the subset index is 2-bit.
+	union {
+		uint8_t   u8[8][4];
+		uint32_t u32[8];
+	} endpoints;
+
+	// Alpha components.
+	// If no alpha is present, this will be 255.
+	// For modes with alpha components, there is always
+	// one alpha channel per endpoint.
+	uint8_t alpha[4];
+
+	/** END: Temporary values. **/
+
+	// TODO: Make sure this is correct on big-endian.
+	uint64_t lsb = le64_to_cpu(bc7_src[0]);
+	uint64_t msb = le64_to_cpu(bc7_src[1]);
+
+	// Check the block mode.
+	const int mode = get_mode(static_cast<uint32_t>(lsb));
+	if (mode < 0) {
+		// Invalid mode.
+		return -1;
+	}
+	rshift128(msb, lsb, mode+1);
+
+	// Rotation mode.
+	// Only present in modes 4 and 5.
+	// For all other modes, this is assumed to be 00.
+	// - 00: ARGB - no swapping
+	// - 01: RAGB - swap A and R
+	// - 10: GRAB - swap A and G
+	// - 11: BRGA - swap A and B
+	uint8_t rotation_mode;
+	if (mode == 4 || mode == 5) {
+		rotation_mode = lsb & 3;
+		rshift128(msb, lsb, 2);
+	} else {
+		// No rotation.
+		rotation_mode = 0;
+	}
+
+	// Index mode selector. (Mode 4 only)
+	uint8_t idxMode_m4 = 0;
+	if (mode == 4) {
+		// Mode 4 has both 2-bit and 3-bit selectors.
+		// The index selection bit determines which is used for
+		// color data and which is used for alpha data:
+		// - idxMode_m4 == 0: Color == 2-bit, Alpha == 3-bit
+		// - idxMode_m4 == 1: Color == 3-bit, Alpha == 2-bit
+		idxMode_m4 = lsb & 1;
+		rshift128(msb, lsb, 1);
+	}
+
+	// Subset/partition.
+	static const uint8_t SubsetCount[8] = {3, 2, 3, 2, 1, 1, 1, 2};
+	static const uint8_t PartitionBits[8] = {4, 6, 6, 6, 0, 0, 0, 6};
+	uint32_t subset = 0;
+	uint8_t partition = 0;
+	if (PartitionBits[mode] != 0) {
+		partition = lsb & ((1U << PartitionBits[mode]) - 1);
+		rshift128(msb, lsb, PartitionBits[mode]);
+
+		// Determine the subset to use.
+		switch (SubsetCount[mode]) {
+			default:
+			case 1:
+				// One subset.
+				subset = 0;
+				break;
+			case 2:
+				// Two subsets.
+				subset = bc7_2sub[partition];
+				break;
+			case 3:
+				// Three subsets.
+				subset = bc7_3sub[partition];
+				break;
+		}
+	} else {
+		// No subsets/partitions.
+		subset = 0;
+	}
+
+	// Number of endpoints.
+	static const uint8_t EndpointCount[8] = {6, 4, 6, 4, 2, 2, 2, 4};
+	// Bits per endpoint component.
+	static const uint8_t EndpointBits[8] = {4, 6, 5, 7, 5, 7, 7, 5};
+
+	// Extract and extend the components.
+	// NOTE: Components are stored in RRRR/GGGG/BBBB/AAAA order.
+	// Needs to be shuffled for RGBA.
+	uint8_t endpoint_bits = EndpointBits[mode];
+	const uint8_t endpoint_count = EndpointCount[mode];
+	const uint8_t endpoint_mask = (1U << endpoint_bits) - 1;
+	const uint8_t endpoint_shamt = 8U - endpoint_bits;
+	const unsigned int component_count = endpoint_count * 3;
+	uint8_t ep_idx = 0, comp_idx = 0;
+	for (unsigned int i = 0; i < component_count; i++) {
+		endpoints.u8[ep_idx][comp_idx] = (lsb & endpoint_mask) << endpoint_shamt;
+		ep_idx++;
+		if (ep_idx == endpoint_count) {
+			// Next component.
+			comp_idx++;
+			ep_idx = 0;
+		}
+
+		// Shift the data over.
+		rshift128(msb, lsb, endpoint_bits);
+	}
+
+	// Do we have alpha components?
+	static const uint8_t AlphaBits[8] = {0, 0, 0, 0, 6, 8, 7, 5};
+	uint8_t alpha_bits = AlphaBits[mode];
+	if (alpha_bits != 0) {
+		// We have alpha components.
+		// TODO: Might not actually be alpha if rotation is enabled...
+		// TODO: Or, rotation might enable alpha...
+		const uint8_t alpha_mask = (1U << alpha_bits) - 1;
+		const uint8_t alpha_shamt = 8U - alpha_bits;
+		for (unsigned int i = 0; i < endpoint_count; i++) {
+			alpha[i] = (lsb & alpha_mask) << alpha_shamt;
+			rshift128(msb, lsb, alpha_bits);
+		}
+	} else {
+		// No alpha. Use 255.
+		alpha[0] = 255;
+		alpha[1] = 255;
+		alpha[2] = 255;
+		alpha[3] = 255;
+	}
+
+	// P-bits.
+	// NOTE: These are applied per subset.
+	// The P-bit count is needed here in order to determine the
+	// shift amount for the endpoints and alpha values.
+	static const uint8_t PBitCount[8] = {1, 1, 0, 1, 0, 0, 1, 1};
+	if (PBitCount[mode] != 0) {
+		// Optimization to avoid having to shift the
+		// whole 64-bit and/or 128-bit value multiple times.
+		unsigned int lsb8 = (lsb & 0xFF);
+		if (mode == 1) {
+			// Mode 1: Two P-bits for four endpoints.
+
+			// Subset 0
+			if (lsb & 1) {
+				endpoints.u32[0] |= 0x02020202;
+				endpoints.u32[1] |= 0x02020202;
+			}
+
+			// Subset 1
+			if (lsb & 2) {
+				endpoints.u32[2] |= 0x02020202;
+				endpoints.u32[3] |= 0x02020202;
+			}
+
+			rshift128(msb, lsb, 2);
+		} else {
+			// Other modes: Unique P-bit for each endpoint.
+			const uint8_t p_ep_shamt = 7 - endpoint_bits;
+			for (unsigned int i = 0; i < endpoint_count; i++, lsb8 >>= 1) {
+				if (lsb8 & 1) {
+					endpoints.u32[i] |= (0x01010101 << p_ep_shamt);
+				}
+			}
+
+			if (alpha_bits > 0) {
+				// Apply P-bits to the alpha components.
+				assert(endpoint_count <= ARRAY_SIZE(alpha));
+				const uint8_t p_a_shamt = 7 - alpha_bits;
+				lsb8 = (lsb & 0xFF);
+				for (unsigned int i = 0; i < endpoint_count; i++, lsb8 >>= 1) {
+					alpha[i] |= (lsb8 & 1) << p_a_shamt;
+				}
+
+				// Increment the alpha bits to indicate how many bits
+				// need to be copied when expanding the color value.
+				alpha_bits++;
+			}
+
+			rshift128(msb, lsb, endpoint_count);
+		}
+
+		// Increment the endpoint bits to indicate how many bits
+		// need to be copied when expanding the color value.
+		endpoint_bits++;
+	}
+
+	// Expand the endpoints and alpha components.
+	if (endpoint_bits < 8) {
+		for (unsigned int i = 0; i < endpoint_count; i++) {
+			endpoints.u8[i][0] = endpoints.u8[i][0] | (endpoints.u8[i][0] >> endpoint_bits);
+			endpoints.u8[i][1] = endpoints.u8[i][1] | (endpoints.u8[i][1] >> endpoint_bits);
+			endpoints.u8[i][2] = endpoints.u8[i][2] | (endpoints.u8[i][2] >> endpoint_bits);
+		}
+	}
+	if (alpha_bits != 0 && alpha_bits < 8) {
+		for (unsigned int i = 0; i < endpoint_count; i++) {
+			alpha[i] = alpha[i] | (alpha[i] >> alpha_bits);
+		}
+	}
+
+	// Bits per index. (either 2 or 3)
+	// NOTE: Most modes don't have the full 32-bit or 48-bit
+	// index table. Missing bits are assumed to be 0.
+	static const uint8_t IndexBits[8] = {3, 3, 2, 2, 0, 2, 4, 2};
+	unsigned int index_bits = IndexBits[mode];
+
+	// At this point, the only remaining data is indexes,
+	// which fits entirely into LSB. Hence, we can stop
+	// using rshift128().
+
+	// EXCEPTION: Mode 4 has both 2-bit *and* 3-bit indexes.
+	// Depending on idxMode_m4, we have to use one or the other.
+	uint64_t idxData;
+	uint8_t index_mask;
+	if (mode == 4) {
+		// Load the color indexes.
+		if (idxMode_m4) {
+			// idxMode is set: Color data uses the 3-bit indexes.
+			// NOTE: We've already shifted by 50 bits by now, so the
+			// MSB contains the high 14 bits of the index data, and
+			// the LSB contains the low 33 bits of the index data.
+			idxData = (msb << 33) | (lsb >> 31);
+			index_bits = 3;
+			index_mask = (1U << 3) - 1;
+		} else {
+			// idxMode is not set: Color data uses the 2-bit indexes.
+			idxData = lsb & ((1U << 31) - 1);
+			index_bits = 2;
+			index_mask = (1U << 2) - 1;
+		}
+	} else {
+		// Use the LSB indexes as-is.
+		idxData = lsb;
+		index_mask = (1U << index_bits) - 1;
+	}
+
+	// Get the anchor indexes.
+	// Subset 0 is always anchored at 0.
+	// Other subsets depend on subset count and partition number.
+	// NOTE: Index 3 is invalid. It's present here for alignment
+	// and because the subset index is 2-bit.
+	uint8_t anchor_index[4];
+	anchor_index[0] = 0;
+	const uint8_t subset_count = SubsetCount[mode];
+	for (unsigned int i = 1; i < subset_count; i++) {
+		anchor_index[i] = getAnchorIndex(partition, i, subset_count);
+	}
+
+	// Process the index data for the color components.
+	// NOTE: Interpolation is done by the caller.
+	const uint8_t *const pWeightColor = aWeights[index_bits];
+	uint8_t subset_idx_px[16];
+	uint8_t weight_color[16];
+	uint8_t weight_alpha[16];
+	uint32_t subsetData = subset;
+	for (unsigned int i = 0; i < 16; i++, subsetData >>= 2) {
+		const uint8_t subset_idx = subsetData & 3;
+		assert(subset_idx != 3);
+
+		// Anchor indexes have an implied high bit of 0.
+		// This is done without branching, since the anchor
+		// positions are effectively random.
+		const unsigned int is_anchor = (i == anchor_index[subset_idx]);
+		const uint8_t data_idx = idxData & (index_mask >> is_anchor);
+		idxData >>= (index_bits - is_anchor);
+
+		subset_idx_px[i] = subset_idx;
+		weight_color[i] = pWeightColor[data_idx];
+	}
+
+	// Alpha handling.
+	if (mode == 4) {
+		// Mode 4: Alpha indexes are present.
+		// Load the appropriate indexes based on idxMode.
+		uint8_t index_bits, index_mask;
+		if (idxMode_m4) {
+			// idxMode is set: Alpha data uses the 2-bit indexes.
+			idxData = lsb & ((1U << 31) - 1);
+			index_bits = 2;
+			index_mask = (1U << 2) - 1;
+		} else {
+			// idxMode is not set: Alpha data uses the 3-bit indexes.
+			// NOTE: We've already shifted by 50 bits by now, so the
+			// MSB contains the high 14 bits of the index data, and
+			// the LSB contains the low 33 bits of the index data.
+			idxData = (msb << 33) | (lsb >> 31);
+			index_bits = 3;
+			index_mask = (1U << 3) - 1;
+		}
+
+		// Mode 4 only has one subset, so only index 0 is an anchor.
+		const uint8_t *const pWeightAlpha = aWeights[index_bits];
+		weight_alpha[0] = pWeightAlpha[idxData & (index_mask >> 1)];
+		idxData >>= (index_bits - 1);
+		for (unsigned int i = 1; i < 16; i++) {
+			weight_alpha[i] = pWeightAlpha[idxData & index_mask];
+			idxData >>= index_bits;
+		}
+	} else if (alpha_bits == 0) {
+		// No alpha. Both alpha endpoints are 255,
+		// so the weight doesn't matter.
+		memset(weight_alpha, 0, sizeof(weight_alpha));
+	} else if (mode == 5) {
+		// Mode 5: Separate alpha indexes, stored after the color indexes.
+		// Mode 5 only has one subset, so only index 0 is an anchor.
+		idxData = lsb >> 31;
+		weight_alpha[0] = pWeightColor[idxData & (index_mask >> 1)];
+		idxData >>= (index_bits - 1);
+		for (unsigned int i = 1; i < 16; i++) {
+			weight_alpha[i] = pWeightColor[idxData & index_mask];
+			idxData >>= index_bits;
+		}
+	} else {
+		// Other modes: Same indexes as color data.
+		memcpy(weight_alpha, weight_color, sizeof(weight_alpha));
+	}
+
+	// Combine the endpoints and alpha components for each subset.
+	// NOTE: Index 3 is never used, since the subset index is 2-bit.
+	uint32_t subset_ep0[3], subset_ep1[3];
+	for (unsigned int i = 0; i < subset_count; i++) {
+		const unsigned int ep_idx = i * 2;
+		const uint32_t a0 = (alpha_bits != 0 ? alpha[ep_idx] : 255);
+		const uint32_t a1 = (alpha_bits != 0 ? alpha[ep_idx+1] : 255);
+		subset_ep0[i] = (a0 << 24) |
+				(endpoints.u8[ep_idx][0] << 16) |
+				(endpoints.u8[ep_idx][1] << 8) |
+				 endpoints.u8[ep_idx][2];
+		subset_ep1[i] = (a1 << 24) |
+				(endpoints.u8[ep_idx+1][0] << 16) |
+				(endpoints.u8[ep_idx+1][1] << 8) |
+				 endpoints.u8[ep_idx+1][2];
+
+		// Component rotation.
+		subset_ep0[i] = rotate_argb32(subset_ep0[i], rotation_mode);
+		subset_ep1[i] = rotate_argb32(subset_ep1[i], rotation_mode);
+	}
+
+	// Component rotation for weights.
+	// Color and alpha weights are at most 64,
+	// so they can be expanded using multiplication.
+	static const uint32_t weight_mul_color[4] = {0x00010101, 0x01000101, 0x01010001, 0x01010100};
+	static const uint32_t weight_mul_alpha[4] = {0x01000000, 0x00010000, 0x00000100, 0x00000001};
+	const uint32_t mul_color = weight_mul_color[rotation_mode & 3];
+	const uint32_t mul_alpha = weight_mul_alpha[rotation_mode & 3];
+
+	// Set the per-pixel parameters.
+	for (unsigned int i = 0; i < 16; i++) {
+		const uint8_t subset_idx = subset_idx_px[i];
+		params->ep0[i].u32 = subset_ep0[subset_idx];
+		params->ep1[i].u32 = subset_ep1[subset_idx];
+		params->w[i].u32 = (weight_color[i] * mul_color) | (weight_alpha[i] * mul_alpha);
+	}
+
+	return 0;
+}
+
+/**
+ * Interpolate a BC7 tile.
+ * Standard version using regular C++ code.
+ * @param tileBuf	[out] Tile buffer.
+ * @param params	[in] Tile parameters.
+ */
+static inline void BC7_interpolateTile_cpp(argb32_t *RESTRICT tileBuf, const BC7_TileParams *RESTRICT params)
+{
+	const uint8_t *const ep0 = reinterpret_cast<const uint8_t*>(params->ep0);
+	const uint8_t *const ep1 = reinterpret_cast<const uint8_t*>(params->ep1);
+	const uint8_t *const w = reinterpret_cast<const uint8_t*>(params->w);
+	uint8_t *const dest = reinterpret_cast<uint8_t*>(tileBuf);
+
+	for (unsigned int i = 0; i < 16*4; i++) {
+		dest[i] = (uint8_t)((((64 - w[i]) * (unsigned int)ep0[i]) +
+				     ((w[i] * (unsigned int)ep1[i]) + 32)) >> 6);
+	}
+}
+
+typedef void (*BC7_interpolateTile_fn)(argb32_t *RESTRICT tileBuf, const BC7_TileParams *RESTRICT params);
+
 /**
  * Convert a BC7 image to rp_image.
+ * @tparam interpolateTile Tile interpolation function.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf BC7 image buffer.
  * @param img_siz Size of image data. [must be >= (w*h)]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromBC7(int width, int height,
+template<BC7_interpolateTile_fn interpolateTile>
+static inline rp_image *T_fromBC7(int width, int height,
 	const uint8_t *img_buf, int img_siz)
 {
 	// Verify parameters.
@@ -288,397 +672,42 @@ rp_image *fromBC7(int width, int height,
 	// block format we have is 128-bit little-endian, which will be
 	// represented as two uint64_t values, which will be shifted
 	// as each component is processed.
-	// TODO: Optimize by using fewer shifts?
-	const uint64_t *bc7_src = reinterpret_cast<const uint64_t*>(img_buf);
-
-	// Temporary tile buffer.
-	ALIGNED_VAR(16, argb32_t tileBuf[4*4]);
-
-	// Anchor indexes.
-	// Subset 0 is always anchored at 0.
-	// Other subsets depend on subset count and partition number.
-	// NOTE: Index 3 is invalid. It's present here for alignment
-	// and because the subset index is 2-bit.
-	uint8_t anchor_index[4];
-	anchor_index[0] = 0;
-
-	for (unsigned int y = 0; y < tilesY; y++) {
-	for (unsigned int x = 0; x < tilesX; x++, bc7_src += 2) {
-		/** BEGIN: Temporary values. **/
-
-		// Endpoints.
-		// - [8]: Individual endpoints.
-		// - [4]: RGBx components. (idx3 is unused)
-		// NOTE: Endpoints 6 and 7 are never used.
-		// They're kept here because the subset index is 2-bit.
-		union {
-			uint8_t   u8[8][4];
-			uint32_t u32[8];
-		} endpoints;
-
-		// Alpha components.
-		// If no alpha is present, this will be 255.
-		// For modes with alpha components, there is always
-		// one alpha channel per endpoint.
-		uint8_t alpha[4];
-
-		/** END: Temporary values. **/
-
-		// TODO: Make sure this is correct on big-endian.
-		uint64_t lsb = le64_to_cpu(bc7_src[0]);
-		uint64_t msb = le64_to_cpu(bc7_src[1]);
-
-		// Check the block mode.
-		const int mode = get_mode(static_cast<uint32_t>(lsb));
-		if (mode < 0) {
-			// Invalid mode.
-			delete img;
-			return nullptr;
-		}
-		rshift128(msb, lsb, mode+1);
-
-		// Rotation mode.
-		// Only present in modes 4 and 5.
-		// For all other modes, this is assumed to be 00.
-		// - 00: ARGB - no swapping
-		// - 01: RAGB - swap A and R
-		// - 10: GRAB - swap A and G
-		// - 11: BRGA - swap A and B
-		uint8_t rotation_mode;
-		if (mode == 4 || mode == 5) {
-			rotation_mode = lsb & 3;
-			rshift128(msb, lsb, 2);
-		} else {
-			// No rotation.
-			rotation_mode = 0;
-		}
-
-		// Index mode selector. (Mode 4 only)
-		uint8_t idxMode_m4 = 0;
-		if (mode == 4) {
-			// Mode 4 has both 2-bit and 3-bit selectors.
-			// The index selection bit determines which is used for
-			// color data and which is used for alpha data:
-			// - idxMode_m4 == 0: Color == 2-bit, Alpha == 3-bit
-			// - idxMode_m4 == 1: Color == 3-bit, Alpha == 2-bit
-			idxMode_m4 = lsb & 1;
-			rshift128(msb, lsb, 1);
-		}
-
-		// Subset/partition.
-		static const uint8_t SubsetCount[8] = {3, 2, 3, 2, 1, 1, 1, 2};
-		static const uint8_t PartitionBits[8] = {4, 6, 6, 6, 0, 0, 0, 6};
-		uint32_t subset = 0;
-		uint8_t partition = 0;
-		if (PartitionBits[mode] != 0) {
-			partition = lsb & ((1U << PartitionBits[mode]) - 1);
-			rshift128(msb, lsb, PartitionBits[mode]);
-
-			// Determine the subset to use.
-			switch (SubsetCount[mode]) {
-				default:
-				case 1:
-					// One subset.
-					subset = 0;
-					break;
-				case 2:
-					// Two subsets.
-					subset = bc7_2sub[partition];
-					break;
-				case 3:
-					// Three subsets.
-					subset = bc7_3sub[partition];
-					break;
-			}
-		} else {
-			// No subsets/partitions.
-			subset = 0;
-		}
-
-		// Number of endpoints.
-		static const uint8_t EndpointCount[8] = {6, 4, 6, 4, 2, 2, 2, 4};
-		// Bits per endpoint component.
-		static const uint8_t EndpointBits[8] = {4, 6, 5, 7, 5, 7, 7, 5};
-
-		// Extract and extend the components.
-		// NOTE: Components are stored in RRRR/GGGG/BBBB/AAAA order.
-		// Needs to be shuffled for RGBA.
-		uint8_t endpoint_bits = EndpointBits[mode];
-		const uint8_t endpoint_count = EndpointCount[mode];
-		const uint8_t endpoint_mask = (1U << endpoint_bits) - 1;
-		const uint8_t endpoint_shamt = 8U - endpoint_bits;
-		const unsigned int component_count = endpoint_count * 3;
-		uint8_t ep_idx = 0, comp_idx = 0;
-		for (unsigned int i = 0; i < component_count; i++) {
-			endpoints.u8[ep_idx][comp_idx] = (lsb & endpoint_mask) << endpoint_shamt;
-			ep_idx++;
-			if (ep_idx == endpoint_count) {
-				// Next component.
-				comp_idx++;
-				ep_idx = 0;
+	const uint64_t *const bc7_src_start = reinterpret_cast<const uint64_t*>(img_buf);
+
+	// Set if any block has an invalid mode.
+	// Other rows may still be decoding when this is set,
+	// so the error is handled after all rows are done.
+	volatile bool invalidMode = false;
+
+	// Decode one row of tiles at a time.
+	// Large images are decoded in parallel.
+	ImageDecoderPrivate::ForEachTileRow(tilesY, tilesX * tilesY * 16, [&](unsigned int y) {
+		// Temporary tile buffer.
+		ALIGNED_VAR(16, argb32_t tileBuf[4*4]);
+
+		// Decoded tile parameters.
+		ALIGNED_VAR(16, BC7_TileParams params);
+
+		const uint64_t *bc7_src = bc7_src_start + (y * tilesX * 2);
+		for (unsigned int x = 0; x < tilesX; x++, bc7_src += 2) {
+			if (invalidMode || decodeBC7Block(&params, bc7_src) != 0) {
+				// Invalid mode.
+				invalidMode = true;
+				return;
 			}
+			interpolateTile(tileBuf, &params);
 
-			// Shift the data over.
-			rshift128(msb, lsb, endpoint_bits);
+			// Blit the tile to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img,
+				reinterpret_cast<const uint32_t*>(&tileBuf[0]), x, y);
 		}
+	});
 
-		// Do we have alpha components?
-		static const uint8_t AlphaBits[8] = {0, 0, 0, 0, 6, 8, 7, 5};
-		uint8_t alpha_bits = AlphaBits[mode];
-		if (alpha_bits != 0) {
-			// We have alpha components.
-			// TODO: Might not actually be alpha if rotation is enabled...
-			// TODO: Or, rotation might enable alpha...
-			const uint8_t alpha_mask = (1U << alpha_bits) - 1;
-			const uint8_t alpha_shamt = 8U - alpha_bits;
-			for (unsigned int i = 0; i < endpoint_count; i++) {
-				alpha[i] = (lsb & alpha_mask) << alpha_shamt;
-				rshift128(msb, lsb, alpha_bits);
-			}
-		} else {
-			// No alpha. Use 255.
-			alpha[0] = 255;
-			alpha[1] = 255;
-			alpha[2] = 255;
-			alpha[3] = 255;
-		}
-
-		// P-bits.
-		// NOTE: These are applied per subset.
-		// The P-bit count is needed here in order to determine the
-		// shift amount for the endpoints and alpha values.
-		static const uint8_t PBitCount[8] = {1, 1, 0, 1, 0, 0, 1, 1};
-		if (PBitCount[mode] != 0) {
-			// Optimization to avoid having to shift the
-			// whole 64-bit and/or 128-bit value multiple times.
-			unsigned int lsb8 = (lsb & 0xFF);
-			if (mode == 1) {
-				// Mode 1: Two P-bits for four endpoints.
-
-				// Subset 0
-				if (lsb & 1) {
-					endpoints.u32[0] |= 0x02020202;
-					endpoints.u32[1] |= 0x02020202;
-				}
-
-				// Subset 1
-				if (lsb & 2) {
-					endpoints.u32[2] |= 0x02020202;
-					endpoints.u32[3] |= 0x02020202;
-				}
-
-				rshift128(msb, lsb, 2);
-			} else {
-				// Other modes: Unique P-bit for each endpoint.
-				const uint8_t p_ep_shamt = 7 - endpoint_bits;
-				for (unsigned int i = 0; i < endpoint_count; i++, lsb8 >>= 1) {
-					if (lsb8 & 1) {
-						endpoints.u32[i] |= (0x01010101 << p_ep_shamt);
-					}
-				}
-
-				if (alpha_bits > 0) {
-					// Apply P-bits to the alpha components.
-					assert(endpoint_count <= ARRAY_SIZE(alpha));
-					const uint8_t p_a_shamt = 7 - alpha_bits;
-					lsb8 = (lsb & 0xFF);
-					for (unsigned int i = 0; i < endpoint_count; i++, lsb8 >>= 1) {
-						alpha[i] |= (lsb8 & 1) << p_a_shamt;
-					}
-
-					// Increment the alpha bits to indicate how many bits
-					// need to be copied when expanding the color value.
-					alpha_bits++;
-				}
-
-				rshift128(msb, lsb, endpoint_count);
-			}
-
-			// Increment the endpoint bits to indicate how many bits
-			// need to be copied when expanding the color value.
-			endpoint_bits++;
-		}
-
-		// Expand the endpoints and alpha components.
-		if (endpoint_bits < 8) {
-			for (unsigned int i = 0; i < endpoint_count; i++) {
-				endpoints.u8[i][0] = endpoints.u8[i][0] | (endpoints.u8[i][0] >> endpoint_bits);
-				endpoints.u8[i][1] = endpoints.u8[i][1] | (endpoints.u8[i][1] >> endpoint_bits);
-				endpoints.u8[i][2] = endpoints.u8[i][2] | (endpoints.u8[i][2] >> endpoint_bits);
-			}
-		}
-		if (alpha_bits != 0 && alpha_bits < 8) {
-			for (unsigned int i = 0; i < endpoint_count; i++) {
-				alpha[i] = alpha[i] | (alpha[i] >> alpha_bits);
-			}
-		}
-
-		// Bits per index. (either 2 or 3)
-		// NOTE: Most modes don't have the full 32-bit or 48-bit
-		// index table. Missing bits are assumed to be 0.
-		static const uint8_t IndexBits[8] = {3, 3, 2, 2, 0, 2, 4, 2};
-		unsigned int index_bits = IndexBits[mode];
-
-		// At this point, the only remaining data is indexes,
-		// which fits entirely into LSB. Hence, we can stop
-		// using rshift128().
-
-		// EXCEPTION: Mode 4 has both 2-bit *and* 3-bit indexes.
-		// Depending on idxMode_m4, we have to use one or the other.
-		uint64_t idxData;
-		uint8_t index_mask;
-		if (mode == 4) {
-			// Load the color indexes.
-			if (idxMode_m4) {
-				// idxMode is set: Color data uses the 3-bit indexes.
-				// NOTE: We've already shifted by 50 bits by now, so the
-				// MSB contains the high 14 bits of the index data, and
-				// the LSB contains the low 33 bits of the index data.
-				idxData = (msb << 33) | (lsb >> 31);
-				index_bits = 3;
-				index_mask = (1U << 3) - 1;
-			} else {
-				// idxMode is not set: Color data uses the 2-bit indexes.
-				idxData = lsb & ((1U << 31) - 1);
-				index_bits = 2;
-				index_mask = (1U << 2) - 1;
-			}
-		} else {
-			// Use the LSB indexes as-is.
-			idxData = lsb;
-			index_mask = (1U << index_bits) - 1;
-		}
-
-		// Get the anchor indexes.
-		const uint8_t subset_count = SubsetCount[mode];
-		for (unsigned int i = 1; i < subset_count; i++) {
-			anchor_index[i] = getAnchorIndex(partition, i, subset_count);
-		}
-
-		// Process the index data for the color components.
-		uint32_t subsetData = subset;
-		for (unsigned int i = 0; i < 16; i++, subsetData >>= 2) {
-			const uint8_t subset_idx = subsetData & 3;
-			assert(subset_idx != 3);
-			uint8_t data_idx;
-			if (i == anchor_index[subset_idx]) {
-				// This is an anchor index.
-				// Highest bit is 0.
-				data_idx = idxData & (index_mask >> 1);
-				idxData >>= (index_bits - 1);
-			} else {
-				// Regular index.
-				data_idx = idxData & index_mask;
-				idxData >>= index_bits;
-			}
-
-			const uint8_t ep_idx = subset_idx * 2;
-			tileBuf[i].r = interpolate_component(index_bits, data_idx, endpoints.u8[ep_idx][0], endpoints.u8[ep_idx+1][0]);
-			tileBuf[i].g = interpolate_component(index_bits, data_idx, endpoints.u8[ep_idx][1], endpoints.u8[ep_idx+1][1]);
-			tileBuf[i].b = interpolate_component(index_bits, data_idx, endpoints.u8[ep_idx][2], endpoints.u8[ep_idx+1][2]);
-		}
-
-		// Alpha handling.
-		if (mode == 4) {
-			// Mode 4: Alpha indexes are present.
-			// Load the appropriate indexes based on idxMode.
-			uint8_t index_bits, index_mask;
-			if (idxMode_m4) {
-				// idxMode is set: Alpha data uses the 2-bit indexes.
-				idxData = lsb & ((1U << 31) - 1);
-				index_bits = 2;
-				index_mask = (1U << 2) - 1;
-			} else {
-				// idxMode is not set: Alpha data uses the 3-bit indexes.
-				// NOTE: We've already shifted by 50 bits by now, so the
-				// MSB contains the high 14 bits of the index data, and
-				// the LSB contains the low 33 bits of the index data.
-				idxData = (msb << 33) | (lsb >> 31);
-				index_bits = 3;
-				index_mask = (1U << 3) - 1;
-			}
-
-			subsetData = subset;
-			for (unsigned int i = 0; i < 16; i++, subsetData >>= 2) {
-				const uint8_t subset_idx = subsetData & 3;
-				uint8_t data_idx;
-				if (i == anchor_index[subset_idx]) {
-					// This is an anchor index.
-					// Highest bit is 0.
-					data_idx = idxData & (index_mask >> 1);
-					idxData >>= (index_bits - 1);
-				}
-				else {
-					// Regular index.
-					data_idx = idxData & index_mask;
-					idxData >>= index_bits;
-				}
-
-				tileBuf[i].a = interpolate_component(index_bits, data_idx, alpha[0], alpha[1]);
-			}
-		} else if (alpha_bits == 0) {
-			// No alpha. Assume 255.
-			for (unsigned int i = 0; i < 16; i++) {
-				tileBuf[i].a = 255;
-			}
-		} else {
-			// Process alpha using the index data.
-			if (mode == 5) {
-				// Mode 5: Separate alpha indexes, stored after the color indexes.
-				idxData = lsb >> 31;
-			} else {
-				// Other modes: Same indexes as color data.
-				idxData = lsb;
-			}
-			subsetData = subset;
-			for (unsigned int i = 0; i < 16; i++, subsetData >>= 2) {
-				const uint8_t subset_idx = subsetData & 3;
-				uint8_t data_idx;
-				if (i == anchor_index[subset_idx]) {
-					// This is an anchor index.
-					// Highest bit is 0.
-					data_idx = idxData & (index_mask >> 1);
-					idxData >>= (index_bits - 1);
-				} else {
-					// Regular index.
-					data_idx = idxData & index_mask;
-					idxData >>= index_bits;
-				}
-
-				const uint8_t ep_idx = subset_idx * 2;
-				tileBuf[i].a = interpolate_component(index_bits, data_idx, alpha[ep_idx], alpha[ep_idx+1]);
-			}
-		}
-
-		// Component rotation.
-		switch (rotation_mode & 3) {
-			case 0:
-				// ARGB: No rotation.
-				break;
-			case 1:
-				// RAGB: Swap A and R.
-				for (unsigned int i = 0; i < 16; i++) {
-					std::swap(tileBuf[i].a, tileBuf[i].r);
-				}
-				break;
-			case 2:
-				// GRAB: Swap A and G.
-				for (unsigned int i = 0; i < 16; i++) {
-					std::swap(tileBuf[i].a, tileBuf[i].g);
-				}
-				break;
-			case 3:
-				// BRGA: Swap A and B.
-				for (unsigned int i = 0; i < 16; i++) {
-					std::swap(tileBuf[i].a, tileBuf[i].b);
-				}
-				break;
-		}
-
-		// Blit the tile to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img,
-			reinterpret_cast<const uint32_t*>(&tileBuf[0]), x, y);
-	} }
+	if (invalidMode) {
+		// At least one block has an invalid mode.
+		delete img;
+		return nullptr;
+	}
 
 	if (width < physWidth || height < physHeight) {
 		// Shrink the image.
@@ -692,4 +721,53 @@ rp_image *fromBC7(int width, int height,
 	return img;
 }
 
+/**
+ * Convert a BC7 image to rp_image.
+ * Standard version using regular C++ code.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromBC7_cpp(int width, int height,
+	const uint8_t *img_buf, int img_siz)
+{
+	return T_fromBC7<BC7_interpolateTile_cpp>(width, height, img_buf, img_siz);
+}
+
+#ifdef IMAGEDECODER_HAS_SSE2
+/**
+ * Convert a BC7 image to rp_image.
+ * SSE2-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromBC7_sse2(int width, int height,
+	const uint8_t *img_buf, int img_siz)
+{
+	return T_fromBC7<BC7_interpolateTile_sse2>(width, height, img_buf, img_siz);
+}
+#endif /* IMAGEDECODER_HAS_SSE2 */
+
+#ifdef IMAGEDECODER_HAS_SSSE3
+/**
+ * Convert a BC7 image to rp_image.
+ * SSSE3-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromBC7_ssse3(int width, int height,
+	const uint8_t *img_buf, int img_siz)
+{
+	return T_fromBC7<BC7_interpolateTile_ssse3>(width, height, img_buf, img_siz);
+}
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+
 } }
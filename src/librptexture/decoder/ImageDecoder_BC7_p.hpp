@@ -0,0 +1,59 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_BC7_p.hpp: Image decoding functions. (BC7) (PRIVATE)       *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_BC7_P_HPP__
+#define __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_BC7_P_HPP__
+
+#include "ImageDecoder.hpp"
+#include "../img/rp_image.hpp"
+
+namespace LibRpTexture { namespace ImageDecoder {
+
+/**
+ * Decoded BC7 tile parameters.
+ *
+ * The block header, endpoints, and indexes are decoded by
+ * common code. The remaining work is interpolating each pixel:
+ *
+ *   px = ((64 - w) * ep0 + w * ep1 + 32) >> 6
+ *
+ * which is done separately for each byte, so it can be
+ * vectorized without any knowledge of the BC7 block modes.
+ *
+ * Component rotation has already been applied to all
+ * three arrays, so the result is in ARGB32 order.
+ */
+struct BC7_TileParams {
+	argb32_t ep0[16];	// Endpoint 0 for each pixel.
+	argb32_t ep1[16];	// Endpoint 1 for each pixel.
+	argb32_t w[16];		// Weights for each pixel. (0-64)
+};
+
+#ifdef IMAGEDECODER_HAS_SSE2
+/**
+ * Interpolate a BC7 tile.
+ * SSE2-optimized version.
+ * @param tileBuf	[out] Tile buffer. (must be 16-byte aligned)
+ * @param params	[in] Tile parameters. (must be 16-byte aligned)
+ */
+void BC7_interpolateTile_sse2(argb32_t *RESTRICT tileBuf, const BC7_TileParams *RESTRICT params);
+#endif /* IMAGEDECODER_HAS_SSE2 */
+
+#ifdef IMAGEDECODER_HAS_SSSE3
+/**
+ * Interpolate a BC7 tile.
+ * SSSE3-optimized version.
+ * @param tileBuf	[out] Tile buffer. (must be 16-byte aligned)
+ * @param params	[in] Tile parameters. (must be 16-byte aligned)
+ */
+void BC7_interpolateTile_ssse3(argb32_t *RESTRICT tileBuf, const BC7_TileParams *RESTRICT params);
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+
+} }
+
+#endif /* __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_BC7_P_HPP__ */
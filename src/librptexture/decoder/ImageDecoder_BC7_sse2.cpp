@@ -0,0 +1,62 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_BC7_sse2.cpp: Image decoding functions. (BC7)              *
+ * SSE2-optimized version.                                                 *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "ImageDecoder_BC7_p.hpp"
+
+// SSE2 headers.
+#include <emmintrin.h>
+
+namespace LibRpTexture { namespace ImageDecoder {
+
+/**
+ * Interpolate a BC7 tile.
+ * SSE2-optimized version.
+ * @param tileBuf	[out] Tile buffer. (must be 16-byte aligned)
+ * @param params	[in] Tile parameters. (must be 16-byte aligned)
+ */
+void BC7_interpolateTile_sse2(argb32_t *RESTRICT tileBuf, const BC7_TileParams *RESTRICT params)
+{
+	ASSERT_ALIGNMENT(16, tileBuf);
+	ASSERT_ALIGNMENT(16, params);
+
+	const __m128i *ep0 = reinterpret_cast<const __m128i*>(params->ep0);
+	const __m128i *ep1 = reinterpret_cast<const __m128i*>(params->ep1);
+	const __m128i *w = reinterpret_cast<const __m128i*>(params->w);
+	__m128i *dest = reinterpret_cast<__m128i*>(tileBuf);
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i w64 = _mm_set1_epi16(64);
+	const __m128i round = _mm_set1_epi16(32);
+
+	// Four pixels per iteration, processed as 16-bit words.
+	for (unsigned int i = 0; i < 4; i++) {
+		const __m128i e0 = _mm_load_si128(&ep0[i]);
+		const __m128i e1 = _mm_load_si128(&ep1[i]);
+		const __m128i wt = _mm_load_si128(&w[i]);
+
+		// Low two pixels.
+		__m128i w_lo = _mm_unpacklo_epi8(wt, zero);
+		__m128i px_lo = _mm_add_epi16(
+			_mm_mullo_epi16(_mm_unpacklo_epi8(e0, zero), _mm_sub_epi16(w64, w_lo)),
+			_mm_mullo_epi16(_mm_unpacklo_epi8(e1, zero), w_lo));
+		px_lo = _mm_srli_epi16(_mm_add_epi16(px_lo, round), 6);
+
+		// High two pixels.
+		__m128i w_hi = _mm_unpackhi_epi8(wt, zero);
+		__m128i px_hi = _mm_add_epi16(
+			_mm_mullo_epi16(_mm_unpackhi_epi8(e0, zero), _mm_sub_epi16(w64, w_hi)),
+			_mm_mullo_epi16(_mm_unpackhi_epi8(e1, zero), w_hi));
+		px_hi = _mm_srli_epi16(_mm_add_epi16(px_hi, round), 6);
+
+		_mm_store_si128(&dest[i], _mm_packus_epi16(px_lo, px_hi));
+	}
+}
+
+} }
@@ -0,0 +1,58 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_BC7_ssse3.cpp: Image decoding functions. (BC7)             *
+ * SSSE3-optimized version.                                                *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "ImageDecoder_BC7_p.hpp"
+
+// SSSE3 headers.
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+namespace LibRpTexture { namespace ImageDecoder {
+
+/**
+ * Interpolate a BC7 tile.
+ * SSSE3-optimized version.
+ * @param tileBuf	[out] Tile buffer. (must be 16-byte aligned)
+ * @param params	[in] Tile parameters. (must be 16-byte aligned)
+ */
+void BC7_interpolateTile_ssse3(argb32_t *RESTRICT tileBuf, const BC7_TileParams *RESTRICT params)
+{
+	ASSERT_ALIGNMENT(16, tileBuf);
+	ASSERT_ALIGNMENT(16, params);
+
+	const __m128i *ep0 = reinterpret_cast<const __m128i*>(params->ep0);
+	const __m128i *ep1 = reinterpret_cast<const __m128i*>(params->ep1);
+	const __m128i *w = reinterpret_cast<const __m128i*>(params->w);
+	__m128i *dest = reinterpret_cast<__m128i*>(tileBuf);
+
+	const __m128i w64 = _mm_set1_epi8(64);
+	const __m128i round = _mm_set1_epi16(32);
+
+	// Four pixels per iteration.
+	// Endpoints are interleaved as (e0, e1) byte pairs, and weights
+	// as (64-w, w) byte pairs, so PMADDUBSW does both multiplications
+	// and the addition in one instruction. The maximum intermediate
+	// value is 255*64, which fits in a signed 16-bit word.
+	for (unsigned int i = 0; i < 4; i++) {
+		const __m128i e0 = _mm_load_si128(&ep0[i]);
+		const __m128i e1 = _mm_load_si128(&ep1[i]);
+		const __m128i wt = _mm_load_si128(&w[i]);
+		const __m128i wt_inv = _mm_sub_epi8(w64, wt);
+
+		__m128i px_lo = _mm_maddubs_epi16(_mm_unpacklo_epi8(e0, e1), _mm_unpacklo_epi8(wt_inv, wt));
+		__m128i px_hi = _mm_maddubs_epi16(_mm_unpackhi_epi8(e0, e1), _mm_unpackhi_epi8(wt_inv, wt));
+		px_lo = _mm_srli_epi16(_mm_add_epi16(px_lo, round), 6);
+		px_hi = _mm_srli_epi16(_mm_add_epi16(px_hi, round), 6);
+
+		_mm_store_si128(&dest[i], _mm_packus_epi16(px_lo, px_hi));
+	}
+}
+
+} }
@@ -636,23 +636,27 @@ rp_image *fromETC1(int width, int height,
 		return nullptr;
 	}
 
-	const etc1_block *etc1_src = reinterpret_cast<const etc1_block*>(img_buf);
+	const etc1_block *const etc1_src_start = reinterpret_cast<const etc1_block*>(img_buf);
 
 	// Calculate the total number of tiles.
 	const unsigned int tilesX = static_cast<unsigned int>(width / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(height / 4);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
+	// Decode one row of tiles at a time.
+	// Large images are decoded in parallel.
+	ImageDecoderPrivate::ForEachTileRow(tilesY, tilesX * tilesY * 16, [&](unsigned int y) {
+		// Temporary tile buffer.
+		uint32_t tileBuf[4*4];
 
-	for (unsigned int y = 0; y < tilesY; y++) {
-	for (unsigned int x = 0; x < tilesX; x++, etc1_src++) {
-		// Decode the ETC1 RGB block.
-		decodeBlock_ETC_RGB<ETC_DM_ETC1>(tileBuf, etc1_src);
+		const etc1_block *etc1_src = etc1_src_start + (y * tilesX);
+		for (unsigned int x = 0; x < tilesX; x++, etc1_src++) {
+			// Decode the ETC1 RGB block.
+			decodeBlock_ETC_RGB<ETC_DM_ETC1>(tileBuf, etc1_src);
 
-		// Blit the tile to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-	} }
+			// Blit the tile to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+		}
+	});
 
 	// Set the sBIT metadata.
 	static const rp_image::sBIT_t sBIT = {8,8,8,0,0};
@@ -698,23 +702,27 @@ rp_image *fromETC2_RGB(int width, int height,
 		return nullptr;
 	}
 
-	const etc1_block *etc1_src = reinterpret_cast<const etc1_block*>(img_buf);
+	const etc1_block *const etc1_src_start = reinterpret_cast<const etc1_block*>(img_buf);
 
 	// Calculate the total number of tiles.
 	const unsigned int tilesX = static_cast<unsigned int>(width / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(height / 4);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
+	// Decode one row of tiles at a time.
+	// Large images are decoded in parallel.
+	ImageDecoderPrivate::ForEachTileRow(tilesY, tilesX * tilesY * 16, [&](unsigned int y) {
+		// Temporary tile buffer.
+		uint32_t tileBuf[4*4];
 
-	for (unsigned int y = 0; y < tilesY; y++) {
-	for (unsigned int x = 0; x < tilesX; x++, etc1_src++) {
-		// Decode the ETC2 RGB block.
-		decodeBlock_ETC_RGB<ETC_DM_ETC2>(tileBuf, etc1_src);
+		const etc1_block *etc1_src = etc1_src_start + (y * tilesX);
+		for (unsigned int x = 0; x < tilesX; x++, etc1_src++) {
+			// Decode the ETC2 RGB block.
+			decodeBlock_ETC_RGB<ETC_DM_ETC2>(tileBuf, etc1_src);
 
-		// Blit the tile to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-	} }
+			// Blit the tile to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+		}
+	});
 
 	// Set the sBIT metadata.
 	static const rp_image::sBIT_t sBIT = {8,8,8,0,0};
@@ -800,27 +808,31 @@ rp_image *fromETC2_RGBA(int width, int height,
 		return nullptr;
 	}
 
-	const etc2_rgba_block *etc2_src = reinterpret_cast<const etc2_rgba_block*>(img_buf);
+	const etc2_rgba_block *const etc2_src_start = reinterpret_cast<const etc2_rgba_block*>(img_buf);
 
 	// Calculate the total number of tiles.
 	const unsigned int tilesX = static_cast<unsigned int>(width / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(height / 4);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
+	// Decode one row of tiles at a time.
+	// Large images are decoded in parallel.
+	ImageDecoderPrivate::ForEachTileRow(tilesY, tilesX * tilesY * 16, [&](unsigned int y) {
+		// Temporary tile buffer.
+		uint32_t tileBuf[4*4];
 
-	for (unsigned int y = 0; y < tilesY; y++) {
-	for (unsigned int x = 0; x < tilesX; x++, etc2_src++) {
-		// Decode the ETC2 RGB block.
-		decodeBlock_ETC_RGB<ETC_DM_ETC2>(tileBuf, &etc2_src->etc1);
+		const etc2_rgba_block *etc2_src = etc2_src_start + (y * tilesX);
+		for (unsigned int x = 0; x < tilesX; x++, etc2_src++) {
+			// Decode the ETC2 RGB block.
+			decodeBlock_ETC_RGB<ETC_DM_ETC2>(tileBuf, &etc2_src->etc1);
 
-		// Decode the ETC2 alpha block.
-		// TODO: Don't fill in the alpha channel in decodeBlock_ETC2_RGB()?
-		decodeBlock_ETC2_alpha(tileBuf, &etc2_src->alpha);
+			// Decode the ETC2 alpha block.
+			// TODO: Don't fill in the alpha channel in decodeBlock_ETC2_RGB()?
+			decodeBlock_ETC2_alpha(tileBuf, &etc2_src->alpha);
 
-		// Blit the tile to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-	} }
+			// Blit the tile to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+		}
+	});
 
 	// Set the sBIT metadata.
 	static const rp_image::sBIT_t sBIT = {8,8,8,0,8};
@@ -866,23 +878,27 @@ rp_image *fromETC2_RGB_A1(int width, int height,
 		return nullptr;
 	}
 
-	const etc1_block *etc1_src = reinterpret_cast<const etc1_block*>(img_buf);
+	const etc1_block *const etc1_src_start = reinterpret_cast<const etc1_block*>(img_buf);
 
 	// Calculate the total number of tiles.
 	const unsigned int tilesX = static_cast<unsigned int>(width / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(height / 4);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
+	// Decode one row of tiles at a time.
+	// Large images are decoded in parallel.
+	ImageDecoderPrivate::ForEachTileRow(tilesY, tilesX * tilesY * 16, [&](unsigned int y) {
+		// Temporary tile buffer.
+		uint32_t tileBuf[4*4];
 
-	for (unsigned int y = 0; y < tilesY; y++) {
-	for (unsigned int x = 0; x < tilesX; x++, etc1_src++) {
-		// Decode the ETC2 RGB block.
-		decodeBlock_ETC_RGB<ETC_DM_ETC2 | ETC2_DM_A1>(tileBuf, etc1_src);
+		const etc1_block *etc1_src = etc1_src_start + (y * tilesX);
+		for (unsigned int x = 0; x < tilesX; x++, etc1_src++) {
+			// Decode the ETC2 RGB block.
+			decodeBlock_ETC_RGB<ETC_DM_ETC2 | ETC2_DM_A1>(tileBuf, etc1_src);
 
-		// Blit the tile to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-	} }
+			// Blit the tile to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+		}
+	});
 
 	// Set the sBIT metadata.
 	static const rp_image::sBIT_t sBIT = {8,8,8,0,1};
@@ -0,0 +1,109 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_Parallel.cpp: Image decoding functions. (Multithreading)   *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "ImageDecoder.hpp"
+#include "ImageDecoder_p.hpp"
+
+// librpthreads
+#include "librpthreads/ThreadPool.hpp"
+using LibRpBase::ThreadPool;
+
+namespace LibRpTexture {
+
+namespace ImageDecoder {
+
+// Maximum number of decoding threads. (0 == one per CPU)
+static volatile unsigned int max_threads = 0;
+
+// Minimum image size for multithreaded decoding, in pixels.
+// 512x512 DXT1 takes less than a millisecond to decode,
+// so anything smaller isn't worth waking up the workers.
+static volatile unsigned int mt_pixel_threshold = 512*512;
+
+/**
+ * Set the maximum number of threads used to decode large
+ * block-compressed and tiled images.
+ * The decoded image is identical regardless of thread count.
+ * @param threads Maximum number of threads. (0 == one per CPU; 1 == single-threaded)
+ */
+void setMaxThreads(unsigned int threads)
+{
+	max_threads = threads;
+}
+
+/**
+ * Get the maximum number of threads used to decode large
+ * block-compressed and tiled images.
+ * @return Maximum number of threads. (0 == one per CPU; 1 == single-threaded)
+ */
+unsigned int maxThreads(void)
+{
+	return max_threads;
+}
+
+/**
+ * Set the minimum image size for multithreaded decoding.
+ * Smaller images are always decoded on the calling thread,
+ * since the thread synchronization overhead would be larger
+ * than the decoding time.
+ * @param pixels Minimum image size, in pixels.
+ */
+void setMTPixelThreshold(unsigned int pixels)
+{
+	mt_pixel_threshold = pixels;
+}
+
+/**
+ * Get the minimum image size for multithreaded decoding.
+ * @return Minimum image size, in pixels.
+ */
+unsigned int mtPixelThreshold(void)
+{
+	return mt_pixel_threshold;
+}
+
+}
+
+/** ImageDecoderPrivate **/
+
+/**
+ * Get the number of threads to use for decoding an image.
+ * @param tilesY	[in] Number of rows of tiles.
+ * @param pixels	[in] Total number of pixels in the image.
+ * @return Number of threads. (1 == decode on the calling thread)
+ */
+unsigned int ImageDecoderPrivate::decodeThreadCount(unsigned int tilesY, unsigned int pixels)
+{
+	const unsigned int threads = ImageDecoder::max_threads;
+	if (threads == 1 || tilesY < 2 || pixels < ImageDecoder::mt_pixel_threshold) {
+		// Single-threaded decoding.
+		return 1;
+	}
+
+	const unsigned int poolThreads = ThreadPool::instance()->threadCount();
+	if (threads == 0 || threads > poolThreads) {
+		return poolThreads;
+	}
+	return threads;
+}
+
+/**
+ * Run a function for each band using the decoder thread pool.
+ * @param fn		[in] Band function: void fn(void *param, unsigned int band)
+ * @param param		[in] Band function parameter.
+ * @param bands		[in] Number of bands.
+ * @param threads	[in] Number of threads.
+ */
+void ImageDecoderPrivate::runBands(void (*fn)(void *param, unsigned int band),
+	void *param, unsigned int bands, unsigned int threads)
+{
+	ThreadPool::instance()->run(fn, param, bands, threads);
+}
+
+}
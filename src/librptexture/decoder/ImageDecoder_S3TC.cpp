@@ -305,30 +305,34 @@ static rp_image *T_fromDXT1(int width, int height,
 		return nullptr;
 	}
 
-	const dxt1_block *dxt1_src = reinterpret_cast<const dxt1_block*>(img_buf);
+	const dxt1_block *const dxt1_src_start = reinterpret_cast<const dxt1_block*>(img_buf);
 
 	// Calculate the total number of tiles.
 	const unsigned int tilesX = static_cast<unsigned int>(physWidth / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(physHeight / 4);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
+	// Decode one row of tiles at a time.
+	// Large images are decoded in parallel.
+	ImageDecoderPrivate::ForEachTileRow(tilesY, tilesX * tilesY * 16, [&](unsigned int y) {
+		// Temporary tile buffer.
+		uint32_t tileBuf[4*4];
 
-	for (unsigned int y = 0; y < tilesY; y++) {
-	for (unsigned int x = 0; x < tilesX; x++, dxt1_src++) {
-		// Decode the DXT1 tile palette.
-		argb32_t pal[4];
-		decode_DXTn_tile_color_palette_S3TC<palflags>(pal, dxt1_src);
+		const dxt1_block *dxt1_src = dxt1_src_start + (y * tilesX);
+		for (unsigned int x = 0; x < tilesX; x++, dxt1_src++) {
+			// Decode the DXT1 tile palette.
+			argb32_t pal[4];
+			decode_DXTn_tile_color_palette_S3TC<palflags>(pal, dxt1_src);
 
-		// Process the 16 color indexes.
-		uint32_t indexes = le32_to_cpu(dxt1_src->indexes);
-		for (unsigned int i = 0; i < 16; i++, indexes >>= 2) {
-			tileBuf[i] = pal[indexes & 3].u32;
-		}
+			// Process the 16 color indexes.
+			uint32_t indexes = le32_to_cpu(dxt1_src->indexes);
+			for (unsigned int i = 0; i < 16; i++, indexes >>= 2) {
+				tileBuf[i] = pal[indexes & 3].u32;
+			}
 
-		// Blit the tile to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-	} }
+			// Blit the tile to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+		}
+	});
 
 	if (width < physWidth || height < physHeight) {
 		// Shrink the image.
@@ -447,37 +451,41 @@ rp_image *fromDXT3(int width, int height,
 		dxt1_block colors;	// DXT1-style color block.
 	};
 	ASSERT_STRUCT(dxt3_block, 16);
-	const dxt3_block *dxt3_src = reinterpret_cast<const dxt3_block*>(img_buf);
+	const dxt3_block *const dxt3_src_start = reinterpret_cast<const dxt3_block*>(img_buf);
 
 	// Calculate the total number of tiles.
 	const unsigned int tilesX = static_cast<unsigned int>(physWidth / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(physHeight / 4);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
-
-	for (unsigned int y = 0; y < tilesY; y++) {
-	for (unsigned int x = 0; x < tilesX; x++, dxt3_src++) {
-		// Decode the DXT3 tile palette.
-		argb32_t pal[4];
-		// FIXME: DXTn_PALETTE_COLOR0_LE_COLOR1 seems to result in garbage pixels.
-		// https://github.com/kchapelier/decode-dxt/tree/master/lib has similar code
-		// but handles DXT3 like both DXT1 and DXT5, so disable this for now.
-		decode_DXTn_tile_color_palette_S3TC<0/*DXTn_PALETTE_COLOR0_LE_COLOR1*/>(pal, &dxt3_src->colors);
-
-		// Process the 16 color indexes and apply alpha.
-		uint32_t indexes = le32_to_cpu(dxt3_src->colors.indexes);
-		uint64_t alpha = le64_to_cpu(dxt3_src->alpha);
-		for (unsigned int i = 0; i < 16; i++, indexes >>= 2, alpha >>= 4) {
-			argb32_t color = pal[indexes & 3];
-			// TODO: Verify alpha value handling for DXT3.
-			color.a = (alpha & 0xF) | ((alpha & 0xF) << 4);
-			tileBuf[i] = color.u32;
-		}
+	// Decode one row of tiles at a time.
+	// Large images are decoded in parallel.
+	ImageDecoderPrivate::ForEachTileRow(tilesY, tilesX * tilesY * 16, [&](unsigned int y) {
+		// Temporary tile buffer.
+		uint32_t tileBuf[4*4];
 
-		// Blit the tile to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-	} }
+		const dxt3_block *dxt3_src = dxt3_src_start + (y * tilesX);
+		for (unsigned int x = 0; x < tilesX; x++, dxt3_src++) {
+			// Decode the DXT3 tile palette.
+			argb32_t pal[4];
+			// FIXME: DXTn_PALETTE_COLOR0_LE_COLOR1 seems to result in garbage pixels.
+			// https://github.com/kchapelier/decode-dxt/tree/master/lib has similar code
+			// but handles DXT3 like both DXT1 and DXT5, so disable this for now.
+			decode_DXTn_tile_color_palette_S3TC<0/*DXTn_PALETTE_COLOR0_LE_COLOR1*/>(pal, &dxt3_src->colors);
+
+			// Process the 16 color indexes and apply alpha.
+			uint32_t indexes = le32_to_cpu(dxt3_src->colors.indexes);
+			uint64_t alpha = le64_to_cpu(dxt3_src->alpha);
+			for (unsigned int i = 0; i < 16; i++, indexes >>= 2, alpha >>= 4) {
+				argb32_t color = pal[indexes & 3];
+				// TODO: Verify alpha value handling for DXT3.
+				color.a = (alpha & 0xF) | ((alpha & 0xF) << 4);
+				tileBuf[i] = color.u32;
+			}
+
+			// Blit the tile to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+		}
+	});
 
 	if (width < physWidth || height < physHeight) {
 		// Shrink the image.
@@ -564,36 +572,40 @@ rp_image *fromDXT5(int width, int height,
 		dxt1_block colors;	// DXT1-style color block.
 	};
 	ASSERT_STRUCT(dxt5_block, 16);
-	const dxt5_block *dxt5_src = reinterpret_cast<const dxt5_block*>(img_buf);
+	const dxt5_block *const dxt5_src_start = reinterpret_cast<const dxt5_block*>(img_buf);
 
 	// Calculate the total number of tiles.
 	const unsigned int tilesX = static_cast<unsigned int>(physWidth / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(physHeight / 4);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
-
-	for (unsigned int y = 0; y < tilesY; y++) {
-	for (unsigned int x = 0; x < tilesX; x++, dxt5_src++) {
-		// Decode the DXT5 tile palette.
-		argb32_t pal[4];
-		decode_DXTn_tile_color_palette_S3TC<0>(pal, &dxt5_src->colors);
-
-		// Get the DXT5 alpha codes.
-		uint64_t alpha48 = extract48(&dxt5_src->alpha);
-
-		// Process the 16 color and alpha indexes.
-		uint32_t indexes = le32_to_cpu(dxt5_src->colors.indexes);
-		for (unsigned int i = 0; i < 16; i++, indexes >>= 2, alpha48 >>= 3) {
-			argb32_t color = pal[indexes & 3];
-			// Decode the alpha channel value.
-			color.a = decode_DXT5_alpha_S3TC(alpha48 & 7, dxt5_src->alpha.values);
-			tileBuf[i] = color.u32;
-		}
+	// Decode one row of tiles at a time.
+	// Large images are decoded in parallel.
+	ImageDecoderPrivate::ForEachTileRow(tilesY, tilesX * tilesY * 16, [&](unsigned int y) {
+		// Temporary tile buffer.
+		uint32_t tileBuf[4*4];
 
-		// Blit the tile to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-	} }
+		const dxt5_block *dxt5_src = dxt5_src_start + (y * tilesX);
+		for (unsigned int x = 0; x < tilesX; x++, dxt5_src++) {
+			// Decode the DXT5 tile palette.
+			argb32_t pal[4];
+			decode_DXTn_tile_color_palette_S3TC<0>(pal, &dxt5_src->colors);
+
+			// Get the DXT5 alpha codes.
+			uint64_t alpha48 = extract48(&dxt5_src->alpha);
+
+			// Process the 16 color and alpha indexes.
+			uint32_t indexes = le32_to_cpu(dxt5_src->colors.indexes);
+			for (unsigned int i = 0; i < 16; i++, indexes >>= 2, alpha48 >>= 3) {
+				argb32_t color = pal[indexes & 3];
+				// Decode the alpha channel value.
+				color.a = decode_DXT5_alpha_S3TC(alpha48 & 7, dxt5_src->alpha.values);
+				tileBuf[i] = color.u32;
+			}
+
+			// Blit the tile to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+		}
+	});
 
 	if (width < physWidth || height < physHeight) {
 		// Shrink the image.
@@ -650,36 +662,40 @@ rp_image *fromBC4(int width, int height,
 		dxt5_alpha red;
 	};
 	ASSERT_STRUCT(bc4_block, 8);
-	const bc4_block *bc4_src = reinterpret_cast<const bc4_block*>(img_buf);
+	const bc4_block *const bc4_src_start = reinterpret_cast<const bc4_block*>(img_buf);
 
 	// Calculate the total number of tiles.
 	const unsigned int tilesX = static_cast<unsigned int>(physWidth / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(physHeight / 4);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
-
 	// S3TC version.
-	for (unsigned int y = 0; y < tilesY; y++) {
-	for (unsigned int x = 0; x < tilesX; x++, bc4_src++) {
-		// BC4 colors are determined using DXT5-style alpha interpolation.
-
-		// Get the BC4 color codes.
-		uint64_t red48 = extract48(&bc4_src->red);
-
-		// Process the 16 color indexes.
-		// NOTE: Using red instead of grayscale here.
-		argb32_t color;
-		color.u32 = 0xFF000000;	// opaque black
-		for (unsigned int i = 0; i < 16; i++, red48 >>= 3) {
-			// Decode the red channel value.
-			color.r = decode_DXT5_alpha_S3TC(red48 & 7, bc4_src->red.values);
-			tileBuf[i] = color.u32;
-		}
+	// Decode one row of tiles at a time.
+	// Large images are decoded in parallel.
+	ImageDecoderPrivate::ForEachTileRow(tilesY, tilesX * tilesY * 16, [&](unsigned int y) {
+		// Temporary tile buffer.
+		uint32_t tileBuf[4*4];
 
-		// Blit the tile to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-	} }
+		const bc4_block *bc4_src = bc4_src_start + (y * tilesX);
+		for (unsigned int x = 0; x < tilesX; x++, bc4_src++) {
+			// BC4 colors are determined using DXT5-style alpha interpolation.
+
+			// Get the BC4 color codes.
+			uint64_t red48 = extract48(&bc4_src->red);
+
+			// Process the 16 color indexes.
+			// NOTE: Using red instead of grayscale here.
+			argb32_t color;
+			color.u32 = 0xFF000000;	// opaque black
+			for (unsigned int i = 0; i < 16; i++, red48 >>= 3) {
+				// Decode the red channel value.
+				color.r = decode_DXT5_alpha_S3TC(red48 & 7, bc4_src->red.values);
+				tileBuf[i] = color.u32;
+			}
+
+			// Blit the tile to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+		}
+	});
 
 	if (width < physWidth || height < physHeight) {
 		// Shrink the image.
@@ -739,37 +755,41 @@ rp_image *fromBC5(int width, int height,
 		dxt5_alpha green;
 	};
 	ASSERT_STRUCT(bc5_block, 16);
-	const bc5_block *bc5_src = reinterpret_cast<const bc5_block*>(img_buf);
+	const bc5_block *const bc5_src_start = reinterpret_cast<const bc5_block*>(img_buf);
 
 	// Calculate the total number of tiles.
 	const unsigned int tilesX = static_cast<unsigned int>(width / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(height / 4);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
-
 	// S3TC version.
-	for (unsigned int y = 0; y < tilesY; y++) {
-	for (unsigned int x = 0; x < tilesX; x++, bc5_src++) {
-		// BC5 colors are determined using DXT5-style alpha interpolation.
-
-		// Get the BC5 color codes.
-		uint64_t red48   = extract48(&bc5_src->red);
-		uint64_t green48 = extract48(&bc5_src->green);
-
-		// Process the 16 color indexes.
-		argb32_t color;
-		color.u32 = 0xFF000000;	// opaque black
-		for (unsigned int i = 0; i < 16; i++, red48 >>= 3, green48 >>= 3) {
-			// Decode the red and green channel values.
-			color.r = decode_DXT5_alpha_S3TC(red48   & 7, bc5_src->red.values);
-			color.g = decode_DXT5_alpha_S3TC(green48 & 7, bc5_src->green.values);
-			tileBuf[i] = color.u32;
-		}
+	// Decode one row of tiles at a time.
+	// Large images are decoded in parallel.
+	ImageDecoderPrivate::ForEachTileRow(tilesY, tilesX * tilesY * 16, [&](unsigned int y) {
+		// Temporary tile buffer.
+		uint32_t tileBuf[4*4];
 
-		// Blit the tile to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-	} }
+		const bc5_block *bc5_src = bc5_src_start + (y * tilesX);
+		for (unsigned int x = 0; x < tilesX; x++, bc5_src++) {
+			// BC5 colors are determined using DXT5-style alpha interpolation.
+
+			// Get the BC5 color codes.
+			uint64_t red48   = extract48(&bc5_src->red);
+			uint64_t green48 = extract48(&bc5_src->green);
+
+			// Process the 16 color indexes.
+			argb32_t color;
+			color.u32 = 0xFF000000;	// opaque black
+			for (unsigned int i = 0; i < 16; i++, red48 >>= 3, green48 >>= 3) {
+				// Decode the red and green channel values.
+				color.r = decode_DXT5_alpha_S3TC(red48   & 7, bc5_src->red.values);
+				color.g = decode_DXT5_alpha_S3TC(green48 & 7, bc5_src->green.values);
+				tileBuf[i] = color.u32;
+			}
+
+			// Blit the tile to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+		}
+	});
 
 	if (width < physWidth || height < physHeight) {
 		// Shrink the image.
@@ -67,6 +67,33 @@ static __typeof__(&ImageDecoder::fromLinear32_cpp) fromLinear32_resolve(void)
 	}
 }
 
+/**
+ * IFUNC resolver function for fromBC7().
+ * @return Function pointer.
+ */
+static __typeof__(&ImageDecoder::fromBC7_cpp) fromBC7_resolve(void)
+{
+#ifdef IMAGEDECODER_HAS_SSSE3
+	if (RP_CPU_HasSSSE3()) {
+		return &ImageDecoder::fromBC7_ssse3;
+	} else
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+#ifdef IMAGEDECODER_ALWAYS_HAS_SSE2
+	{
+		return &ImageDecoder::fromBC7_sse2;
+	}
+#else /* !IMAGEDECODER_ALWAYS_HAS_SSE2 */
+# ifdef IMAGEDECODER_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		return &ImageDecoder::fromBC7_sse2;
+	} else
+# endif /* IMAGEDECODER_HAS_SSE2 */
+	{
+		return &ImageDecoder::fromBC7_cpp;
+	}
+#endif /* IMAGEDECODER_ALWAYS_HAS_SSE2 */
+}
+
 }
 
 #ifndef IMAGEDECODER_ALWAYS_HAS_SSE2
@@ -86,4 +113,8 @@ rp_image *ImageDecoder::fromLinear32(PixelFormat px_format,
 	const uint32_t *img_buf, int img_siz, int stride)
 	IFUNC_ATTR(fromLinear32_resolve);
 
+rp_image *ImageDecoder::fromBC7(int width, int height,
+	const uint8_t *img_buf, int img_siz)
+	IFUNC_ATTR(fromBC7_resolve);
+
 #endif /* RP_HAS_IFUNC */
@@ -59,6 +59,60 @@ class ImageDecoderPrivate
 		static inline void BlitTile_CI4_LeftLSN(
 			rp_image *RESTRICT img, const uint8_t *RESTRICT tileBuf,
 			unsigned int tileX, unsigned int tileY);
+
+		/**
+		 * Decode each row of tiles in an image.
+		 *
+		 * Large images are split into bands of tile rows,
+		 * which are decoded in parallel. Each row must be
+		 * independent of all other rows.
+		 *
+		 * @tparam F		[in] Function type: void fn(unsigned int tileY)
+		 * @param tilesY	[in] Number of rows of tiles.
+		 * @param pixels	[in] Total number of pixels in the image.
+		 * @param fn		[in] Function to decode one row of tiles.
+		 */
+		template<typename F>
+		static inline void ForEachTileRow(unsigned int tilesY, unsigned int pixels, const F &fn);
+
+	private:
+		/**
+		 * Get the number of threads to use for decoding an image.
+		 * @param tilesY	[in] Number of rows of tiles.
+		 * @param pixels	[in] Total number of pixels in the image.
+		 * @return Number of threads. (1 == decode on the calling thread)
+		 */
+		static unsigned int decodeThreadCount(unsigned int tilesY, unsigned int pixels);
+
+		/**
+		 * Run a function for each band using the decoder thread pool.
+		 * @param fn		[in] Band function: void fn(void *param, unsigned int band)
+		 * @param param		[in] Band function parameter.
+		 * @param bands		[in] Number of bands.
+		 * @param threads	[in] Number of threads.
+		 */
+		static void runBands(void (*fn)(void *param, unsigned int band),
+			void *param, unsigned int bands, unsigned int threads);
+
+		/**
+		 * Tile row band parameters.
+		 * @tparam F Function type: void fn(unsigned int tileY)
+		 */
+		template<typename F>
+		struct TileBands {
+			const F *fn;
+			unsigned int tilesY;
+			unsigned int bands;
+		};
+
+		/**
+		 * Decode one band of tile rows.
+		 * @tparam F Function type: void fn(unsigned int tileY)
+		 * @param param	[in] TileBands<F>
+		 * @param band	[in] Band number.
+		 */
+		template<typename F>
+		static void decodeTileBand(void *param, unsigned int band);
 };
 
 /**
@@ -143,6 +197,56 @@ inline void ImageDecoderPrivate::BlitTile_CI4_LeftLSN(
 	}
 }
 
+/**
+ * Decode each row of tiles in an image.
+ *
+ * Large images are split into bands of tile rows,
+ * which are decoded in parallel. Each row must be
+ * independent of all other rows.
+ *
+ * @tparam F		[in] Function type: void fn(unsigned int tileY)
+ * @param tilesY	[in] Number of rows of tiles.
+ * @param pixels	[in] Total number of pixels in the image.
+ * @param fn		[in] Function to decode one row of tiles.
+ */
+template<typename F>
+inline void ImageDecoderPrivate::ForEachTileRow(unsigned int tilesY, unsigned int pixels, const F &fn)
+{
+	const unsigned int threads = decodeThreadCount(tilesY, pixels);
+	if (threads <= 1) {
+		// Single-threaded decoding.
+		for (unsigned int y = 0; y < tilesY; y++) {
+			fn(y);
+		}
+		return;
+	}
+
+	// Use a few bands per thread so a slow band
+	// doesn't leave the other threads idle.
+	TileBands<F> tb;
+	tb.fn = &fn;
+	tb.tilesY = tilesY;
+	tb.bands = (threads * 4 < tilesY ? threads * 4 : tilesY);
+	runBands(decodeTileBand<F>, &tb, tb.bands, threads);
+}
+
+/**
+ * Decode one band of tile rows.
+ * @tparam F Function type: void fn(unsigned int tileY)
+ * @param param	[in] TileBands<F>
+ * @param band	[in] Band number.
+ */
+template<typename F>
+void ImageDecoderPrivate::decodeTileBand(void *param, unsigned int band)
+{
+	const TileBands<F> *const tb = static_cast<const TileBands<F>*>(param);
+	const unsigned int y_start = (band * tb->tilesY) / tb->bands;
+	const unsigned int y_end = ((band + 1) * tb->tilesY) / tb->bands;
+	for (unsigned int y = y_start; y < y_end; y++) {
+		(*tb->fn)(y);
+	}
+}
+
 }
 
 #endif /* __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_P_HPP__ */
@@ -51,19 +51,30 @@ class DirectDrawSurfacePrivate : public FileFormatPrivate
 		// Texture data start address.
 		unsigned int texDataStartAddr;
 
-		// Decoded image.
-		rp_image *img;
+		// Decoded mipmaps.
+		// Mipmap 0 is the full image.
+		vector<rp_image*> mipmaps;
 
 		// Pixel format message.
 		// NOTE: Used for both valid and invalid pixel formats
 		// due to various bit specifications.
 		char pixel_format[32];
 
+		/**
+		 * Get the size of a mipmap's texture data.
+		 * This does not read any texture data.
+		 * @param mip		[in] Mipmap number. (0 == full image)
+		 * @param pStride	[out,opt] Row stride, in bytes. (0 for compressed formats)
+		 * @return Texture data size, in bytes, or 0 if not supported.
+		 */
+		unsigned int mipmapDataSize(int mip, unsigned int *pStride = nullptr) const;
+
 		/**
 		 * Load the image.
+		 * @param mip Mipmap number. (0 == full image)
 		 * @return Image, or nullptr on error.
 		 */
-		const rp_image *loadImage(void);
+		const rp_image *loadImage(int mip);
 
 	public:
 		// Supported uncompressed RGB formats.
@@ -472,7 +483,6 @@ int DirectDrawSurfacePrivate::updatePixelFormat(void)
 DirectDrawSurfacePrivate::DirectDrawSurfacePrivate(DirectDrawSurface *q, IRpFile *file)
 	: super(q, file)
 	, texDataStartAddr(0)
-	, img(nullptr)
 	, pxf_uncomp(0)
 	, bytespp(0)
 	, dxgi_format(0)
@@ -487,81 +497,51 @@ DirectDrawSurfacePrivate::DirectDrawSurfacePrivate(DirectDrawSurface *q, IRpFile
 
 DirectDrawSurfacePrivate::~DirectDrawSurfacePrivate()
 {
-	delete img;
+	std::for_each(mipmaps.begin(), mipmaps.end(), [](rp_image *img) { delete img; });
 }
 
 /**
- * Load the image.
- * @return Image, or nullptr on error.
+ * Get the size of a mipmap's texture data.
+ * This does not read any texture data.
+ * @param mip		[in] Mipmap number. (0 == full image)
+ * @param pStride	[out,opt] Row stride, in bytes. (0 for compressed formats)
+ * @return Texture data size, in bytes, or 0 if not supported.
  */
-const rp_image *DirectDrawSurfacePrivate::loadImage(void)
+unsigned int DirectDrawSurfacePrivate::mipmapDataSize(int mip, unsigned int *pStride) const
 {
-	if (img) {
-		// Image has already been loaded.
-		return img;
-	} else if (!this->file || !this->isValid) {
-		// Can't load the image.
-		return nullptr;
-	}
-
-	// Sanity check: Maximum image dimensions of 32768x32768.
-	assert(ddsHeader.dwWidth > 0);
-	assert(ddsHeader.dwWidth <= 32768);
-	assert(ddsHeader.dwHeight > 0);
-	assert(ddsHeader.dwHeight <= 32768);
-	if (ddsHeader.dwWidth == 0 || ddsHeader.dwWidth > 32768 ||
-	    ddsHeader.dwHeight == 0 || ddsHeader.dwHeight > 32768)
-	{
-		// Invalid image dimensions.
-		return nullptr;
-	}
-
-	// Texture cannot start inside of the DDS header.
-	// TODO: Also dxt10Header for DX10?
-	// TODO: ...and xb1Header for XBOX?
-	assert(texDataStartAddr >= sizeof(ddsHeader));
-	if (texDataStartAddr < sizeof(ddsHeader)) {
-		// Invalid texture data start address.
-		return nullptr;
+	assert(mip >= 0);
+	if (mip < 0 || mip >= 16) {
+		// Invalid mipmap number.
+		// NOTE: 32768x32768 has a maximum of 16 mipmaps.
+		return 0;
 	}
 
-	if (file->size() > 128*1024*1024) {
-		// Sanity check: DDS files shouldn't be more than 128 MB.
-		return nullptr;
-	}
-	const uint32_t file_sz = static_cast<uint32_t>(file->size());
+	// Adjust width/height for the mipmap level.
+	unsigned int width = ddsHeader.dwWidth >> mip;
+	unsigned int height = ddsHeader.dwHeight >> mip;
+	if (width == 0) width = 1;
+	if (height == 0) height = 1;
 
-	// Seek to the start of the texture data.
-	int ret = file->seek(texDataStartAddr);
-	if (ret != 0) {
-		// Seek error.
-		return nullptr;
+	if (pStride) {
+		*pStride = 0;
 	}
 
-	// TODO: Handle DX10 alpha processing.
-	// Currently, we're assuming straight alpha for formats
-	// that have an alpha channel, except for DXT2 and DXT4,
-	// which use premultiplied alpha.
-
-	// NOTE: Mipmaps are stored *after* the main image.
-	// Hence, no mipmap processing is necessary.
 	if (dxgi_format != 0) {
 		// Compressed RGB data.
 
 		// NOTE: dwPitchOrLinearSize is not necessarily correct.
 		// Calculate the expected size.
-		uint32_t expected_size;
 		switch (dxgi_format) {
 #ifdef ENABLE_PVRTC
 			case DXGI_FORMAT_FAKE_PVRTC_2bpp:
 				// 32 pixels compressed into 64 bits. (2bpp)
-				expected_size = (ddsHeader.dwWidth * ddsHeader.dwHeight) / 4;
-				break;
+				// TODO: PVRTC mipmaps have a minimum block size.
+				return (mip == 0 ? (width * height) / 4 : 0);
 
 			case DXGI_FORMAT_FAKE_PVRTC_4bpp:
 				// 16 pixels compressed into 64 bits. (4bpp)
-				expected_size = (ddsHeader.dwWidth * ddsHeader.dwHeight) / 2;
-				break;
+				// TODO: PVRTC mipmaps have a minimum block size.
+				return (mip == 0 ? (width * height) / 2 : 0);
 #endif /* ENABLE_PVRTC */
 
 			case DXGI_FORMAT_BC1_TYPELESS:
@@ -572,9 +552,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 			case DXGI_FORMAT_BC4_SNORM:
 				// 16 pixels compressed into 64 bits. (4bpp)
 				// NOTE: Width and height must be rounded to the nearest tile. (4x4)
-				expected_size = ALIGN_BYTES(4, ddsHeader.dwWidth) *
-				                ALIGN_BYTES(4, ddsHeader.dwHeight) / 2;
-				break;
+				return ALIGN_BYTES(4, width) * ALIGN_BYTES(4, height) / 2;
 
 			case DXGI_FORMAT_BC2_TYPELESS:
 			case DXGI_FORMAT_BC2_UNORM:
@@ -590,34 +568,159 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 			case DXGI_FORMAT_BC7_UNORM_SRGB:
 				// 16 pixels compressed into 128 bits. (8bpp)
 				// NOTE: Width and height must be rounded to the nearest tile. (4x4)
-				expected_size = ALIGN_BYTES(4, ddsHeader.dwWidth) *
-				                ALIGN_BYTES(4, ddsHeader.dwHeight);
-				break;
+				return ALIGN_BYTES(4, width) * ALIGN_BYTES(4, height);
 
 			case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
 				// Uncompressed "special" 32bpp formats.
-				expected_size = ddsHeader.dwWidth * ddsHeader.dwHeight * 4;
-				break;
+				return width * height * 4;
 
 			default:
 				// Not supported.
-				return nullptr;
+				return 0;
 		}
+	}
 
-		// Verify file size.
-		if (expected_size >= file_sz + texDataStartAddr) {
-			// File is too small.
-			return nullptr;
+	// Uncompressed linear image data.
+	assert(pxf_uncomp != 0);
+	assert(bytespp != 0);
+	if (pxf_uncomp == 0 || bytespp == 0) {
+		// Pixel format wasn't updated...
+		return 0;
+	}
+
+	unsigned int stride = 0;
+	if (mip == 0) {
+		// If DDSD_LINEARSIZE is set, the field is linear size,
+		// so it needs to be divided by the image height.
+		if (ddsHeader.dwFlags & DDSD_LINEARSIZE) {
+			if (ddsHeader.dwHeight != 0) {
+				stride = ddsHeader.dwPitchOrLinearSize / ddsHeader.dwHeight;
+			}
+		} else {
+			stride = ddsHeader.dwPitchOrLinearSize;
 		}
+	}
+	if (stride == 0) {
+		// Invalid stride, or this is a mipmap.
+		// Assume stride == width * bytespp.
+		// TODO: Check for stride is too small but non-zero?
+		stride = width * bytespp;
+	} else if (stride > (width * 16)) {
+		// Stride is too large.
+		return 0;
+	}
+
+	if (pStride) {
+		*pStride = stride;
+	}
+	return height * stride;
+}
+
+/**
+ * Load the image.
+ * @param mip Mipmap number. (0 == full image)
+ * @return Image, or nullptr on error.
+ */
+const rp_image *DirectDrawSurfacePrivate::loadImage(int mip)
+{
+	assert(mip >= 0);
+	assert(mip < (int)mipmaps.size());
+	if (mip < 0 || mip >= (int)mipmaps.size()) {
+		// Invalid mipmap number.
+		return nullptr;
+	}
 
-		// Read the texture data.
-		auto buf = aligned_uptr<uint8_t>(16, expected_size);
-		size_t size = file->read(buf.get(), expected_size);
-		if (size != expected_size) {
-			// Read error.
+	if (mipmaps[mip] != nullptr) {
+		// Image has already been loaded.
+		return mipmaps[mip];
+	} else if (!this->file || !this->isValid) {
+		// Can't load the image.
+		return nullptr;
+	}
+
+	// Sanity check: Maximum image dimensions of 32768x32768.
+	assert(ddsHeader.dwWidth > 0);
+	assert(ddsHeader.dwWidth <= 32768);
+	assert(ddsHeader.dwHeight > 0);
+	assert(ddsHeader.dwHeight <= 32768);
+	if (ddsHeader.dwWidth == 0 || ddsHeader.dwWidth > 32768 ||
+	    ddsHeader.dwHeight == 0 || ddsHeader.dwHeight > 32768)
+	{
+		// Invalid image dimensions.
+		return nullptr;
+	}
+
+	// Texture cannot start inside of the DDS header.
+	// TODO: Also dxt10Header for DX10?
+	// TODO: ...and xb1Header for XBOX?
+	assert(texDataStartAddr >= sizeof(ddsHeader));
+	if (texDataStartAddr < sizeof(ddsHeader)) {
+		// Invalid texture data start address.
+		return nullptr;
+	}
+
+	if (file->size() > 128*1024*1024) {
+		// Sanity check: DDS files shouldn't be more than 128 MB.
+		return nullptr;
+	}
+	const uint32_t file_sz = static_cast<uint32_t>(file->size());
+
+	// Mipmaps are stored after the main image, from largest
+	// to smallest, so the mipmap's address is calculated
+	// from the sizes of the larger mipmaps.
+	// NOTE: For cubemaps and texture arrays, each surface has its
+	// own mipmap chain, but the first one is always first.
+	// Volume textures store all slices for each level, so only
+	// the full image is supported for those.
+	uint32_t addr = texDataStartAddr;
+	if (mip > 0 && (ddsHeader.dwCaps2 & DDSCAPS2_VOLUME)) {
+		// TODO: Volume texture mipmaps.
+		return nullptr;
+	}
+	for (int i = 0; i < mip; i++) {
+		const unsigned int mip_size = mipmapDataSize(i);
+		if (mip_size == 0) {
+			// Not supported.
 			return nullptr;
 		}
+		addr += mip_size;
+	}
+
+	// Get the size of this mipmap.
+	unsigned int stride;
+	const unsigned int expected_size = mipmapDataSize(mip, &stride);
+	if (expected_size == 0) {
+		// Not supported.
+		return nullptr;
+	}
 
+	// Verify file size.
+	if (addr >= file_sz || expected_size > file_sz - addr) {
+		// File is too small.
+		return nullptr;
+	}
+
+	// Adjust width/height for the mipmap level.
+	int width = static_cast<int>(ddsHeader.dwWidth >> mip);
+	int height = static_cast<int>(ddsHeader.dwHeight >> mip);
+	if (width <= 0) width = 1;
+	if (height <= 0) height = 1;
+
+	// Read the texture data.
+	auto buf = aligned_uptr<uint8_t>(16, expected_size);
+	size_t size = file->seekAndRead(addr, buf.get(), expected_size);
+	if (size != expected_size) {
+		// Read error.
+		return nullptr;
+	}
+
+	// TODO: Handle DX10 alpha processing.
+	// Currently, we're assuming straight alpha for formats
+	// that have an alpha channel, except for DXT2 and DXT4,
+	// which use premultiplied alpha.
+	rp_image *img = nullptr;
+	if (dxgi_format != 0) {
+		// Compressed RGB data.
 		// TODO: Handle typeless, signed, sRGB, float.
 		switch (dxgi_format) {
 			case DXGI_FORMAT_BC1_TYPELESS:
@@ -626,12 +729,12 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 				if (likely(dxgi_alpha != DDS_ALPHA_MODE_OPAQUE)) {
 					// 1-bit alpha.
 					img = ImageDecoder::fromDXT1_A1(
-						ddsHeader.dwWidth, ddsHeader.dwHeight,
+						width, height,
 						buf.get(), expected_size);
 				} else {
 					// No alpha channel.
 					img = ImageDecoder::fromDXT1(
-						ddsHeader.dwWidth, ddsHeader.dwHeight,
+						width, height,
 						buf.get(), expected_size);
 				}
 				break;
@@ -642,12 +745,12 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 				if (likely(dxgi_alpha != DDS_ALPHA_MODE_PREMULTIPLIED)) {
 					// Standard alpha: DXT3
 					img = ImageDecoder::fromDXT3(
-						ddsHeader.dwWidth, ddsHeader.dwHeight,
+						width, height,
 						buf.get(), expected_size);
 				} else {
 					// Premultiplied alpha: DXT2
 					img = ImageDecoder::fromDXT2(
-						ddsHeader.dwWidth, ddsHeader.dwHeight,
+						width, height,
 						buf.get(), expected_size);
 				}
 				break;
@@ -658,12 +761,12 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 				if (likely(dxgi_alpha != DDS_ALPHA_MODE_PREMULTIPLIED)) {
 					// Standard alpha: DXT5
 					img = ImageDecoder::fromDXT5(
-						ddsHeader.dwWidth, ddsHeader.dwHeight,
+						width, height,
 						buf.get(), expected_size);
 				} else {
 					// Premultiplied alpha: DXT4
 					img = ImageDecoder::fromDXT4(
-						ddsHeader.dwWidth, ddsHeader.dwHeight,
+						width, height,
 						buf.get(), expected_size);
 				}
 				break;
@@ -672,7 +775,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 			case DXGI_FORMAT_BC4_UNORM:
 			case DXGI_FORMAT_BC4_SNORM:
 				img = ImageDecoder::fromBC4(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size);
 				break;
 
@@ -680,7 +783,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 			case DXGI_FORMAT_BC5_UNORM:
 			case DXGI_FORMAT_BC5_SNORM:
 				img = ImageDecoder::fromBC5(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size);
 				break;
 
@@ -688,7 +791,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 			case DXGI_FORMAT_BC7_UNORM:
 			case DXGI_FORMAT_BC7_UNORM_SRGB:
 				img = ImageDecoder::fromBC7(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size);
 				break;
 
@@ -696,7 +799,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 			case DXGI_FORMAT_FAKE_PVRTC_2bpp:
 				// PVRTC, 2bpp, has alpha.
 				img = ImageDecoder::fromPVRTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size,
 					ImageDecoder::PVRTC_2BPP | ImageDecoder::PVRTC_ALPHA_YES);
 				break;
@@ -704,7 +807,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 			case DXGI_FORMAT_FAKE_PVRTC_4bpp:
 				// PVRTC, 4bpp, has alpha.
 				img = ImageDecoder::fromPVRTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size,
 					ImageDecoder::PVRTC_4BPP | ImageDecoder::PVRTC_ALPHA_YES);
 				break;
@@ -714,7 +817,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 				// RGB9_E5 (technically uncompressed...)
 				img = ImageDecoder::fromLinear32(
 					ImageDecoder::PXF_RGB9_E5,
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					reinterpret_cast<const uint32_t*>(buf.get()),
 					expected_size);
 				break;
@@ -725,53 +828,12 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 		}
 	} else {
 		// Uncompressed linear image data.
-		assert(pxf_uncomp != 0);
-		assert(bytespp != 0);
-		if (pxf_uncomp == 0 || bytespp == 0) {
-			// Pixel format wasn't updated...
-			return nullptr;
-		}
-
-		// If DDSD_LINEARSIZE is set, the field is linear size,
-		// so it needs to be divided by the image height.
-		unsigned int stride = 0;
-		if (ddsHeader.dwFlags & DDSD_LINEARSIZE) {
-			if (ddsHeader.dwHeight != 0) {
-				stride = ddsHeader.dwPitchOrLinearSize / ddsHeader.dwHeight;
-			}
-		} else {
-			stride = ddsHeader.dwPitchOrLinearSize;
-		}
-		if (stride == 0) {
-			// Invalid stride. Assume stride == width * bytespp.
-			// TODO: Check for stride is too small but non-zero?
-			stride = ddsHeader.dwWidth * bytespp;
-		} else if (stride > (ddsHeader.dwWidth * 16)) {
-			// Stride is too large.
-			return nullptr;
-		}
-		const unsigned int expected_size = ddsHeader.dwHeight * stride;
-
-		// Verify file size.
-		if (expected_size >= file_sz + texDataStartAddr) {
-			// File is too small.
-			return nullptr;
-		}
-
-		// Read the texture data.
-		auto buf = aligned_uptr<uint8_t>(16, expected_size);
-		size_t size = file->read(buf.get(), expected_size);
-		if (size != expected_size) {
-			// Read error.
-			return nullptr;
-		}
-
 		switch (bytespp) {
 			case sizeof(uint8_t):
 				// 8-bit image. (Usually luminance or alpha.)
 				img = ImageDecoder::fromLinear8(
 					(ImageDecoder::PixelFormat)pxf_uncomp,
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, stride);
 				break;
 
@@ -779,7 +841,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 				// 16-bit RGB image.
 				img = ImageDecoder::fromLinear16(
 					(ImageDecoder::PixelFormat)pxf_uncomp,
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					reinterpret_cast<const uint16_t*>(buf.get()),
 					expected_size, stride);
 				break;
@@ -788,7 +850,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 				// 24-bit RGB image.
 				img = ImageDecoder::fromLinear24(
 					(ImageDecoder::PixelFormat)pxf_uncomp,
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, stride);
 				break;
 
@@ -796,7 +858,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 				// 32-bit RGB image.
 				img = ImageDecoder::fromLinear32(
 					(ImageDecoder::PixelFormat)pxf_uncomp,
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					reinterpret_cast<const uint32_t*>(buf.get()),
 					expected_size, stride);
 				break;
@@ -809,6 +871,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 	}
 
 	// TODO: Untile textures for XBOX format.
+	mipmaps[mip] = img;
 	return img;
 }
 
@@ -965,6 +1028,18 @@ DirectDrawSurface::DirectDrawSurface(IRpFile *file)
 	// Update the pixel format.
 	d->updatePixelFormat();
 
+	// Allocate the mipmap vector.
+	// NOTE: 32768x32768 has a maximum of 16 mipmaps.
+	unsigned int mipmapCount = d->ddsHeader.dwMipMapCount;
+	if (mipmapCount == 0) {
+		// No mipmaps == one image.
+		mipmapCount = 1;
+	} else if (mipmapCount > 16) {
+		// Too many mipmaps...
+		mipmapCount = 16;
+	}
+	d->mipmaps.resize(mipmapCount);
+
 	// Cache the dimensions for the FileFormat base class.
 	d->dimensions[0] = d->ddsHeader.dwWidth;
 	d->dimensions[1] = d->ddsHeader.dwHeight;
@@ -1340,11 +1415,8 @@ const rp_image *DirectDrawSurface::mipmap(int mip) const
 		return nullptr;
 	}
 
-	// FIXME: Support decoding mipmaps.
-	if (mip == 0) {
-		return const_cast<DirectDrawSurfacePrivate*>(d)->loadImage();
-	}
-	return nullptr;
+	// Load the image.
+	return const_cast<DirectDrawSurfacePrivate*>(d)->loadImage(mip);
 }
 
 }
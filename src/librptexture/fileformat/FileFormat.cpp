@@ -169,4 +169,58 @@ int FileFormat::getDimensions(int pBuf[3]) const
 	return 0;
 }
 
+/** Image accessors **/
+
+/**
+ * Get the smallest mipmap that is at least reqSize
+ * pixels in its largest dimension.
+ *
+ * This is intended for thumbnailing: only the selected
+ * mipmap is decoded, so large textures with mipmaps
+ * don't have to be decoded at full size.
+ *
+ * If the texture doesn't have mipmaps, or if the selected
+ * mipmap can't be decoded, the full image is returned.
+ *
+ * @param reqSize Requested size. (0 for the full image)
+ * @return Image, or nullptr on error.
+ */
+const rp_image *FileFormat::mipmapForSize(int reqSize) const
+{
+	RP_D(const FileFormat);
+	if (!d->isValid) {
+		// Not supported.
+		return nullptr;
+	}
+
+	const int count = this->mipmapCount();
+	if (reqSize <= 0 || count <= 1) {
+		// No mipmaps.
+		return this->image();
+	}
+
+	// Find the smallest mipmap that's still large enough.
+	// NOTE: Mipmap dimensions are rounded down, with a minimum of 1.
+	const int w = d->dimensions[0];
+	const int h = d->dimensions[1];
+	int mip = 0;
+	for (int i = 1; i < count && i < 16; i++) {
+		int mw = (w >> i), mh = (h >> i);
+		if (mw <= 0) mw = 1;
+		if (mh <= 0) mh = 1;
+		if (std::max(mw, mh) < reqSize)
+			break;
+		mip = i;
+	}
+
+	if (mip > 0) {
+		const rp_image *const img = this->mipmap(mip);
+		if (img) {
+			return img;
+		}
+		// Mipmap couldn't be decoded. Use the full image.
+	}
+	return this->image();
+}
+
 }
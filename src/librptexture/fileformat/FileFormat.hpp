@@ -200,6 +200,22 @@ class FileFormat
 		 * @return Image, or nullptr on error.
 		 */
 		virtual const rp_image *mipmap(int mip) const = 0;
+
+		/**
+		 * Get the smallest mipmap that is at least reqSize
+		 * pixels in its largest dimension.
+		 *
+		 * This is intended for thumbnailing: only the selected
+		 * mipmap is decoded, so large textures with mipmaps
+		 * don't have to be decoded at full size.
+		 *
+		 * If the texture doesn't have mipmaps, or if the selected
+		 * mipmap can't be decoded, the full image is returned.
+		 *
+		 * @param reqSize Requested size. (0 for the full image)
+		 * @return Image, or nullptr on error.
+		 */
+		const rp_image *mipmapForSize(int reqSize) const;
 };
 
 }
@@ -71,8 +71,9 @@ class KhronosKTXPrivate : public FileFormatPrivate
 		// Texture data start address.
 		unsigned int texDataStartAddr;
 
-		// Decoded image.
-		rp_image *img;
+		// Decoded mipmaps.
+		// Mipmap 0 is the full image.
+		vector<rp_image*> mipmaps;
 
 		// Invalid pixel format message.
 		char invalid_pixel_format[24];
@@ -83,11 +84,21 @@ class KhronosKTXPrivate : public FileFormatPrivate
 		// RFT_LISTDATA.
 		vector<vector<string> > kv_data;
 
+		/**
+		 * Get the address of a mipmap's imageSize field.
+		 * Only the imageSize fields of the larger mipmaps
+		 * are read; no texture data is read.
+		 * @param mip Mipmap number. (0 == full image)
+		 * @return Address, or 0 on error.
+		 */
+		uint32_t getMipmapAddress(int mip);
+
 		/**
 		 * Load the image.
+		 * @param mip Mipmap number. (0 == full image)
 		 * @return Image, or nullptr on error.
 		 */
-		const rp_image *loadImage(void);
+		const rp_image *loadImage(int mip);
 
 		/**
 		 * Load key/value data.
@@ -102,7 +113,6 @@ KhronosKTXPrivate::KhronosKTXPrivate(KhronosKTX *q, IRpFile *file)
 	, isByteswapNeeded(false)
 	, isFlipNeeded(FLIP_V)
 	, texDataStartAddr(0)
-	, img(nullptr)
 {
 	// Clear the KTX header struct.
 	memset(&ktxHeader, 0, sizeof(ktxHeader));
@@ -111,18 +121,66 @@ KhronosKTXPrivate::KhronosKTXPrivate(KhronosKTX *q, IRpFile *file)
 
 KhronosKTXPrivate::~KhronosKTXPrivate()
 {
-	delete img;
+	std::for_each(mipmaps.begin(), mipmaps.end(), [](rp_image *img) { delete img; });
+}
+
+/**
+ * Get the address of a mipmap's imageSize field.
+ * Only the imageSize fields of the larger mipmaps
+ * are read; no texture data is read.
+ * @param mip Mipmap number. (0 == full image)
+ * @return Address, or 0 on error.
+ */
+uint32_t KhronosKTXPrivate::getMipmapAddress(int mip)
+{
+	// Non-array cubemaps have six faces per mipmap level,
+	// and imageSize is the size of one face. Otherwise,
+	// imageSize is the size of the entire mipmap level.
+	// Each face and mipmap level is padded to 4 bytes.
+	const unsigned int faces = (ktxHeader.numberOfFaces == 6 &&
+		ktxHeader.numberOfArrayElements == 0) ? 6 : 1;
+	const uint32_t file_sz = static_cast<uint32_t>(file->size());
+
+	uint32_t addr = texDataStartAddr;
+	for (int i = 0; i < mip; i++) {
+		uint32_t imageSize;
+		size_t size = file->seekAndRead(addr, &imageSize, sizeof(imageSize));
+		if (size != sizeof(imageSize)) {
+			// Unable to read the image size field.
+			return 0;
+		}
+		if (isByteswapNeeded) {
+			imageSize = __swab32(imageSize);
+		}
+
+		const uint64_t next_addr = static_cast<uint64_t>(addr) + sizeof(imageSize) +
+			(static_cast<uint64_t>(ALIGN_BYTES(4, imageSize)) * faces);
+		if (next_addr >= file_sz) {
+			// Mipmap is past the end of the file.
+			return 0;
+		}
+		addr = static_cast<uint32_t>(next_addr);
+	}
+	return addr;
 }
 
 /**
  * Load the image.
+ * @param mip Mipmap number. (0 == full image)
  * @return Image, or nullptr on error.
  */
-const rp_image *KhronosKTXPrivate::loadImage(void)
+const rp_image *KhronosKTXPrivate::loadImage(int mip)
 {
-	if (img) {
+	assert(mip >= 0);
+	assert(mip < (int)mipmaps.size());
+	if (mip < 0 || mip >= (int)mipmaps.size()) {
+		// Invalid mipmap number.
+		return nullptr;
+	}
+
+	if (mipmaps[mip] != nullptr) {
 		// Image has already been loaded.
-		return img;
+		return mipmaps[mip];
 	} else if (!this->file || !this->isValid) {
 		// Can't load the image.
 		return nullptr;
@@ -153,19 +211,27 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 	}
 	const uint32_t file_sz = static_cast<uint32_t>(file->size());
 
+	// Mipmaps are stored after the main image, from largest to smallest.
+	const uint32_t mipAddr = getMipmapAddress(mip);
+	if (mipAddr == 0) {
+		// Unable to get the mipmap address.
+		return nullptr;
+	}
+
 	// Seek to the start of the texture data.
-	int ret = file->seek(texDataStartAddr);
+	int ret = file->seek(mipAddr);
 	if (ret != 0) {
 		// Seek error.
 		return nullptr;
 	}
 
-	// NOTE: Mipmaps are stored *after* the main image.
-	// Hence, no mipmap processing is necessary.
-
+	// Adjust width/height for the mipmap level.
 	// Handle a 1D texture as a "width x 1" 2D texture.
 	// NOTE: Handling a 3D texture as a single 2D texture.
-	const int height = (ktxHeader.pixelHeight > 0 ? ktxHeader.pixelHeight : 1);
+	int width = static_cast<int>(ktxHeader.pixelWidth >> mip);
+	int height = static_cast<int>(ktxHeader.pixelHeight >> mip);
+	if (width <= 0) width = 1;
+	if (height <= 0) height = 1;
 
 	// Calculate the expected size.
 	// NOTE: Scanlines are 4-byte aligned.
@@ -174,26 +240,26 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 	switch (ktxHeader.glFormat) {
 		case GL_RGB:
 			// 24-bit RGB.
-			stride = ALIGN_BYTES(4, ktxHeader.pixelWidth * 3);
+			stride = ALIGN_BYTES(4, width * 3);
 			expected_size = static_cast<unsigned int>(stride * height);
 			break;
 
 		case GL_RGBA:
 			// 32-bit RGBA.
-			stride = ktxHeader.pixelWidth * 4;
+			stride = width * 4;
 			expected_size = static_cast<unsigned int>(stride * height);
 			break;
 
 		case GL_LUMINANCE:
 			// 8-bit luminance.
-			stride = ALIGN_BYTES(4, ktxHeader.pixelWidth);
+			stride = ALIGN_BYTES(4, width);
 			expected_size = static_cast<unsigned int>(stride * height);
 			break;
 
 		case GL_RGB9_E5:
 			// Uncompressed "special" 32bpp formats.
 			// TODO: Does KTX handle GL_RGB9_E5 as compressed?
-			stride = ktxHeader.pixelWidth * 4;
+			stride = width * 4;
 			expected_size = static_cast<unsigned int>(stride * height);
 			break;
 
@@ -206,25 +272,25 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG:
 				case GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG:
 					// 32 pixels compressed into 64 bits. (2bpp)
-					expected_size = (ktxHeader.pixelWidth * height) / 4;
+					expected_size = (width * height) / 4;
 					break;
 
 				case GL_COMPRESSED_RGBA_PVRTC_2BPPV2_IMG:
 					// 32 pixels compressed into 64 bits. (2bpp)
 					// NOTE: Width and height must be rounded to the nearest tile. (8x4)
-					expected_size = ALIGN_BYTES(8, ktxHeader.pixelWidth) *
+					expected_size = ALIGN_BYTES(8, width) *
 					                ALIGN_BYTES(4, (int)height) / 4;
 					break;
 
 				case GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG:
 				case GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG:
 					// 16 pixels compressed into 64 bits. (4bpp)
-					expected_size = (ktxHeader.pixelWidth * height) / 2;
+					expected_size = (width * height) / 2;
 					break;
 
 				case GL_COMPRESSED_RGBA_PVRTC_4BPPV2_IMG:
 					// NOTE: Width and height must be rounded to the nearest tile. (4x4)
-					expected_size = ALIGN_BYTES(4, ktxHeader.pixelWidth) *
+					expected_size = ALIGN_BYTES(4, width) *
 					                ALIGN_BYTES(4, (int)height) / 2;
 					break;
 #endif /* ENABLE_PVRTC */
@@ -246,7 +312,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_SIGNED_LUMINANCE_LATC1_EXT:
 					// 16 pixels compressed into 64 bits. (4bpp)
 					// NOTE: Width and height must be rounded to the nearest tile. (4x4)
-					expected_size = ALIGN_BYTES(4, ktxHeader.pixelWidth) *
+					expected_size = ALIGN_BYTES(4, width) *
 					                ALIGN_BYTES(4, (int)height) / 2;
 					break;
 
@@ -268,14 +334,14 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
 					// 16 pixels compressed into 128 bits. (8bpp)
 					// NOTE: Width and height must be rounded to the nearest tile. (4x4)
-					expected_size = ALIGN_BYTES(4, ktxHeader.pixelWidth) *
+					expected_size = ALIGN_BYTES(4, width) *
 					                ALIGN_BYTES(4, (int)height);
 					break;
 
 				case GL_RGB9_E5:
 					// Uncompressed "special" 32bpp formats.
 					// TODO: Does KTX handle GL_RGB9_E5 as compressed?
-					expected_size = ktxHeader.pixelWidth * height * 4;
+					expected_size = width * height * 4;
 					break;
 
 				default:
@@ -286,7 +352,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 	}
 
 	// Verify file size.
-	if (texDataStartAddr + expected_size > file_sz) {
+	if (mipAddr + expected_size > file_sz) {
 		// File is too small.
 		return nullptr;
 	}
@@ -317,25 +383,26 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 	// TODO: Byteswapping.
 	// TODO: Handle variants. Check for channel sizes in glInternalFormat?
 	// TODO: Handle sRGB post-processing? (for e.g. GL_SRGB8)
+	rp_image *img = nullptr;
 	switch (ktxHeader.glFormat) {
 		case GL_RGB:
 			// 24-bit RGB.
 			img = ImageDecoder::fromLinear24(ImageDecoder::PXF_BGR888,
-				ktxHeader.pixelWidth, height,
+				width, height,
 				buf.get(), expected_size, stride);
 			break;
 
 		case GL_RGBA:
 			// 32-bit RGBA.
 			img = ImageDecoder::fromLinear32(ImageDecoder::PXF_ABGR8888,
-				ktxHeader.pixelWidth, height,
+				width, height,
 				reinterpret_cast<const uint32_t*>(buf.get()), expected_size, stride);
 			break;
 
 		case GL_LUMINANCE:
 			// 8-bit Luminance.
 			img = ImageDecoder::fromLinear8(ImageDecoder::PXF_L8,
-				ktxHeader.pixelWidth, height,
+				width, height,
 				buf.get(), expected_size, stride);
 			break;
 
@@ -343,7 +410,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 			// Uncompressed "special" 32bpp formats.
 			// TODO: Does KTX handle GL_RGB9_E5 as compressed?
 			img = ImageDecoder::fromLinear32(ImageDecoder::PXF_RGB9_E5,
-				ktxHeader.pixelWidth, height,
+				width, height,
 				reinterpret_cast<const uint32_t*>(buf.get()), expected_size, stride);
 			break;
 
@@ -357,21 +424,21 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
 					// DXT1-compressed texture.
 					img = ImageDecoder::fromDXT1(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
 				case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
 					// DXT1-compressed texture with 1-bit alpha.
 					img = ImageDecoder::fromDXT1_A1(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
 				case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
 					// DXT3-compressed texture.
 					img = ImageDecoder::fromDXT3(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -380,14 +447,14 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
 					// DXT5-compressed texture.
 					img = ImageDecoder::fromDXT5(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
 				case GL_ETC1_RGB8_OES:
 					// ETC1-compressed texture.
 					img = ImageDecoder::fromETC1(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -396,7 +463,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// ETC2-compressed RGB texture.
 					// TODO: Handle sRGB.
 					img = ImageDecoder::fromETC2_RGB(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -406,7 +473,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// with punchthrough alpha.
 					// TODO: Handle sRGB.
 					img = ImageDecoder::fromETC2_RGB_A1(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -416,7 +483,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// with EAC-compressed alpha channel.
 					// TODO: Handle sRGB.
 					img = ImageDecoder::fromETC2_RGBA(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -425,7 +492,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// RGTC, one component. (BC4)
 					// TODO: Handle signed properly.
 					img = ImageDecoder::fromBC4(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -434,7 +501,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// RGTC, two components. (BC5)
 					// TODO: Handle signed properly.
 					img = ImageDecoder::fromBC5(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -443,7 +510,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// LATC, one component. (BC4)
 					// TODO: Handle signed properly.
 					img = ImageDecoder::fromBC4(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					// TODO: If this fails, return it anyway or return nullptr?
 					ImageDecoder::fromRed8ToL8(img);
@@ -454,7 +521,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// LATC, two components. (BC5)
 					// TODO: Handle signed properly.
 					img = ImageDecoder::fromBC5(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					// TODO: If this fails, return it anyway or return nullptr?
 					ImageDecoder::fromRG8ToLA8(img);
@@ -464,35 +531,35 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
 					// BPTC-compressed RGBA texture. (BC7)
 					img = ImageDecoder::fromBC7(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
 #ifdef ENABLE_PVRTC
 				case GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG:
 					// PVRTC, 2bpp, no alpha.
-					img = ImageDecoder::fromPVRTC(ktxHeader.pixelWidth, height,
+					img = ImageDecoder::fromPVRTC(width, height,
 						buf.get(), expected_size,
 						ImageDecoder::PVRTC_2BPP | ImageDecoder::PVRTC_ALPHA_NONE);
 					break;
 
 				case GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG:
 					// PVRTC, 2bpp, has alpha.
-					img = ImageDecoder::fromPVRTC(ktxHeader.pixelWidth, height,
+					img = ImageDecoder::fromPVRTC(width, height,
 						buf.get(), expected_size,
 						ImageDecoder::PVRTC_2BPP | ImageDecoder::PVRTC_ALPHA_YES);
 					break;
 
 				case GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG:
 					// PVRTC, 4bpp, no alpha.
-					img = ImageDecoder::fromPVRTC(ktxHeader.pixelWidth, height,
+					img = ImageDecoder::fromPVRTC(width, height,
 						buf.get(), expected_size,
 						ImageDecoder::PVRTC_4BPP | ImageDecoder::PVRTC_ALPHA_NONE);
 					break;
 
 				case GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG:
 					// PVRTC, 4bpp, has alpha.
-					img = ImageDecoder::fromPVRTC(ktxHeader.pixelWidth, height,
+					img = ImageDecoder::fromPVRTC(width, height,
 						buf.get(), expected_size,
 						ImageDecoder::PVRTC_4BPP | ImageDecoder::PVRTC_ALPHA_YES);
 					break;
@@ -500,7 +567,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_RGBA_PVRTC_2BPPV2_IMG:
 					// PVRTC-II, 2bpp.
 					// NOTE: Assuming this has alpha.
-					img = ImageDecoder::fromPVRTCII(ktxHeader.pixelWidth, height,
+					img = ImageDecoder::fromPVRTCII(width, height,
 						buf.get(), expected_size,
 						ImageDecoder::PVRTC_2BPP | ImageDecoder::PVRTC_ALPHA_YES);
 					break;
@@ -508,7 +575,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_RGBA_PVRTC_4BPPV2_IMG:
 					// PVRTC-II, 4bpp.
 					// NOTE: Assuming this has alpha.
-					img = ImageDecoder::fromPVRTCII(ktxHeader.pixelWidth, height,
+					img = ImageDecoder::fromPVRTCII(width, height,
 						buf.get(), expected_size,
 						ImageDecoder::PVRTC_4BPP | ImageDecoder::PVRTC_ALPHA_YES);
 					break;
@@ -518,7 +585,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// Uncompressed "special" 32bpp formats.
 					// TODO: Does KTX handle GL_RGB9_E5 as compressed?
 					img = ImageDecoder::fromLinear32(ImageDecoder::PXF_RGB9_E5,
-						ktxHeader.pixelWidth, height,
+						width, height,
 						reinterpret_cast<const uint32_t*>(buf.get()), expected_size);
 					break;
 
@@ -542,6 +609,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 		}
 	}
 
+	mipmaps[mip] = img;
 	return img;
 }
 
@@ -744,6 +812,18 @@ KhronosKTX::KhronosKTX(IRpFile *file)
 	// and sets the HFlip/VFlip values as necessary.
 	d->loadKeyValueData();
 
+	// Allocate the mipmap vector.
+	// NOTE: 32768x32768 has a maximum of 16 mipmaps.
+	unsigned int mipmapCount = d->ktxHeader.numberOfMipmapLevels;
+	if (mipmapCount == 0) {
+		// No mipmaps == one image.
+		mipmapCount = 1;
+	} else if (mipmapCount > 16) {
+		// Too many mipmaps...
+		mipmapCount = 16;
+	}
+	d->mipmaps.resize(mipmapCount);
+
 	// Cache the dimensions for the FileFormat base class.
 	d->dimensions[0] = d->ktxHeader.pixelWidth;
 	d->dimensions[1] = d->ktxHeader.pixelHeight;
@@ -1040,11 +1120,8 @@ const rp_image *KhronosKTX::mipmap(int mip) const
 		return nullptr;
 	}
 
-	// FIXME: Support decoding mipmaps.
-	if (mip == 0) {
-		return const_cast<KhronosKTXPrivate*>(d)->loadImage();
-	}
-	return nullptr;
+	// Load the image.
+	return const_cast<KhronosKTXPrivate*>(d)->loadImage(mip);
 }
 
 }
@@ -359,6 +359,66 @@ class rp_image
 			Alignment alignment = AlignDefault,
 			uint32_t bgColor = 0x00000000) const;
 
+		/**
+		 * Resampling filters for scaled().
+		 */
+		enum ScaleFilter {
+			FilterBox,		// Box filter. (area average when downscaling)
+			FilterBilinear,		// Bilinear (triangle) filter.
+			FilterLanczos,		// Lanczos3 filter.
+
+			FilterMax
+		};
+
+		/**
+		 * Scale the rp_image using a resampling filter.
+		 * Standard version using regular C++ code.
+		 *
+		 * A new ARGB32 rp_image will be created with the specified
+		 * dimensions. CI8 images are converted to ARGB32 first.
+		 * Filtering is done using premultiplied alpha, so fully
+		 * transparent pixels don't bleed into their neighbors.
+		 *
+		 * @param width New width.
+		 * @param height New height.
+		 * @param filter Resampling filter.
+		 * @return New ARGB32 rp_image with a scaled version of the original, or nullptr on error.
+		 */
+		rp_image *scaled_cpp(int width, int height, ScaleFilter filter = FilterBox) const;
+
+#ifdef RP_IMAGE_HAS_SSE2
+		/**
+		 * Scale the rp_image using a resampling filter.
+		 * SSE2-optimized version.
+		 *
+		 * A new ARGB32 rp_image will be created with the specified
+		 * dimensions. CI8 images are converted to ARGB32 first.
+		 * Filtering is done using premultiplied alpha, so fully
+		 * transparent pixels don't bleed into their neighbors.
+		 *
+		 * @param width New width.
+		 * @param height New height.
+		 * @param filter Resampling filter.
+		 * @return New ARGB32 rp_image with a scaled version of the original, or nullptr on error.
+		 */
+		rp_image *scaled_sse2(int width, int height, ScaleFilter filter = FilterBox) const;
+#endif /* RP_IMAGE_HAS_SSE2 */
+
+		/**
+		 * Scale the rp_image using a resampling filter.
+		 *
+		 * A new ARGB32 rp_image will be created with the specified
+		 * dimensions. CI8 images are converted to ARGB32 first.
+		 * Filtering is done using premultiplied alpha, so fully
+		 * transparent pixels don't bleed into their neighbors.
+		 *
+		 * @param width New width.
+		 * @param height New height.
+		 * @param filter Resampling filter.
+		 * @return New ARGB32 rp_image with a scaled version of the original, or nullptr on error.
+		 */
+		inline rp_image *scaled(int width, int height, ScaleFilter filter = FilterBox) const;
+
 		/**
 		 * Un-premultiply this image.
 		 * Standard version using regular C++ code.
@@ -488,6 +548,37 @@ inline int rp_image::un_premultiply(void)
 	}
 }
 
+/**
+ * Scale the rp_image using a resampling filter.
+ *
+ * A new ARGB32 rp_image will be created with the specified
+ * dimensions. CI8 images are converted to ARGB32 first.
+ * Filtering is done using premultiplied alpha, so fully
+ * transparent pixels don't bleed into their neighbors.
+ *
+ * @param width New width.
+ * @param height New height.
+ * @param filter Resampling filter.
+ * @return New ARGB32 rp_image with a scaled version of the original, or nullptr on error.
+ */
+inline rp_image *rp_image::scaled(int width, int height, ScaleFilter filter) const
+{
+	// FIXME: Figure out how to get IFUNC working with  C++ member functions.
+#if defined(RP_IMAGE_ALWAYS_HAS_SSE2)
+	// amd64 always has SSE2.
+	return scaled_sse2(width, height, filter);
+#else
+# if defined(RP_IMAGE_HAS_SSE2)
+	if (RP_CPU_HasSSE2()) {
+		return scaled_sse2(width, height, filter);
+	} else
+# endif /* RP_IMAGE_HAS_SSE2 */
+	{
+		return scaled_cpp(width, height, filter);
+	}
+#endif /* RP_IMAGE_ALWAYS_HAS_SSE2 */
+}
+
 /**
  * Convert a chroma-keyed image to standard ARGB32.
  *
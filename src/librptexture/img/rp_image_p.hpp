@@ -10,9 +10,30 @@
 #define __ROMPROPERTIES_LIBRPTEXTURE_IMG_RP_IMAGE_P_HPP__
 
 #include "rp_image.hpp"
+#include "librpbase/uvector.h"
 
 namespace LibRpTexture {
 
+/**
+ * Resampling coefficients for one dimension.
+ * Used by rp_image::scaled().
+ */
+struct ScaleCoeffs {
+	int taps;			// Maximum number of taps per output pixel.
+	ao::uvector<int> first;		// First input pixel for each output pixel.
+	ao::uvector<int> count;		// Number of input pixels for each output pixel.
+	ao::uvector<float> weights;	// `taps` weights for each output pixel.
+
+	/**
+	 * Calculate the resampling coefficients.
+	 * @param inSize	[in] Input size.
+	 * @param outSize	[in] Output size.
+	 * @param filter	[in] Resampling filter.
+	 * @return 0 on success; negative POSIX error code on error.
+	 */
+	int init(int inSize, int outSize, rp_image::ScaleFilter filter);
+};
+
 class rp_image_backend;
 class rp_image_private
 {
@@ -0,0 +1,295 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * rp_image_scale.cpp: Image class. (scaling)                              *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "rp_image.hpp"
+#include "rp_image_p.hpp"
+#include "rp_image_backend.hpp"
+
+// C includes. (C++ namespace)
+#include <cmath>
+
+// C++ STL classes.
+using std::unique_ptr;
+
+// Workaround for RP_D() expecting the no-underscore, UpperCamelCase naming convention.
+#define rp_imagePrivate rp_image_private
+
+namespace LibRpTexture {
+
+/** Resampling filters **/
+
+/**
+ * Box filter.
+ * @param x Distance from the sample point.
+ * @return Weight.
+ */
+static float filter_box(float x)
+{
+	return (x > -0.5f && x <= 0.5f) ? 1.0f : 0.0f;
+}
+
+/**
+ * Bilinear (triangle) filter.
+ * @param x Distance from the sample point.
+ * @return Weight.
+ */
+static float filter_bilinear(float x)
+{
+	if (x < 0.0f)
+		x = -x;
+	return (x < 1.0f) ? (1.0f - x) : 0.0f;
+}
+
+/**
+ * Normalized sinc function.
+ * @param x Value.
+ * @return sinc(x)
+ */
+static inline float sinc(float x)
+{
+	if (x == 0.0f)
+		return 1.0f;
+	x *= static_cast<float>(M_PI);
+	return sinf(x) / x;
+}
+
+/**
+ * Lanczos3 filter.
+ * @param x Distance from the sample point.
+ * @return Weight.
+ */
+static float filter_lanczos(float x)
+{
+	return (x > -3.0f && x < 3.0f) ? (sinc(x) * sinc(x / 3.0f)) : 0.0f;
+}
+
+/**
+ * Calculate the resampling coefficients.
+ * @param inSize	[in] Input size.
+ * @param outSize	[in] Output size.
+ * @param filter	[in] Resampling filter.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int ScaleCoeffs::init(int inSize, int outSize, rp_image::ScaleFilter filter)
+{
+	assert(inSize > 0);
+	assert(outSize > 0);
+	if (inSize <= 0 || outSize <= 0) {
+		return -EINVAL;
+	}
+
+	float (*fn)(float);
+	float support;
+	switch (filter) {
+		case rp_image::FilterBox:
+			fn = filter_box;
+			support = 0.5f;
+			break;
+		case rp_image::FilterBilinear:
+			fn = filter_bilinear;
+			support = 1.0f;
+			break;
+		case rp_image::FilterLanczos:
+			fn = filter_lanczos;
+			support = 3.0f;
+			break;
+		default:
+			assert(!"Invalid scale filter.");
+			return -EINVAL;
+	}
+
+	// When downscaling, the filter is stretched to cover
+	// all of the input pixels for each output pixel.
+	const float scale = static_cast<float>(inSize) / static_cast<float>(outSize);
+	const float filterScale = (scale > 1.0f ? scale : 1.0f);
+	support *= filterScale;
+	const float invFilterScale = 1.0f / filterScale;
+
+	taps = static_cast<int>(ceilf(support)) * 2 + 1;
+	first.resize(outSize);
+	count.resize(outSize);
+	weights.resize(static_cast<size_t>(outSize) * taps);
+
+	for (int i = 0; i < outSize; i++) {
+		const float center = (i + 0.5f) * scale;
+		int xmin = static_cast<int>(center - support + 0.5f);
+		if (xmin < 0)
+			xmin = 0;
+		int xmax = static_cast<int>(center + support + 0.5f);
+		if (xmax > inSize)
+			xmax = inSize;
+		int n = xmax - xmin;
+		if (n > taps)
+			n = taps;
+
+		float *const w = &weights[static_cast<size_t>(i) * taps];
+		float total = 0.0f;
+		for (int x = 0; x < n; x++) {
+			w[x] = fn((x + xmin - center + 0.5f) * invFilterScale);
+			total += w[x];
+		}
+		if (total != 0.0f) {
+			const float invTotal = 1.0f / total;
+			for (int x = 0; x < n; x++) {
+				w[x] *= invTotal;
+			}
+		} else {
+			// No input pixels are in range.
+			// Use the nearest input pixel.
+			xmin = static_cast<int>(center);
+			if (xmin >= inSize)
+				xmin = inSize - 1;
+			n = 1;
+			w[0] = 1.0f;
+		}
+		for (int x = n; x < taps; x++) {
+			w[x] = 0.0f;
+		}
+
+		first[i] = xmin;
+		count[i] = n;
+	}
+
+	return 0;
+}
+
+/** Image operations. **/
+
+/**
+ * Scale the rp_image using a resampling filter.
+ * Standard version using regular C++ code.
+ *
+ * A new ARGB32 rp_image will be created with the specified
+ * dimensions. CI8 images are converted to ARGB32 first.
+ * Filtering is done using premultiplied alpha, so fully
+ * transparent pixels don't bleed into their neighbors.
+ *
+ * @param width New width.
+ * @param height New height.
+ * @param filter Resampling filter.
+ * @return New ARGB32 rp_image with a scaled version of the original, or nullptr on error.
+ */
+rp_image *rp_image::scaled_cpp(int width, int height, ScaleFilter filter) const
+{
+	RP_D(const rp_image);
+	const rp_image_backend *const backend = d->backend;
+	assert(width > 0 && height > 0);
+	if (!backend->isValid() || width <= 0 || height <= 0) {
+		return nullptr;
+	}
+
+	// CI8 images are converted to ARGB32 first.
+	const rp_image *src = this;
+	unique_ptr<rp_image> tmp_ARGB32;
+	if (backend->format != FORMAT_ARGB32) {
+		tmp_ARGB32.reset(this->dup_ARGB32());
+		if (!tmp_ARGB32 || !tmp_ARGB32->isValid()) {
+			return nullptr;
+		}
+		src = tmp_ARGB32.get();
+	}
+	const int srcWidth = src->width();
+	const int srcHeight = src->height();
+
+	ScaleCoeffs hc, vc;
+	if (hc.init(srcWidth, width, filter) != 0 ||
+	    vc.init(srcHeight, height, filter) != 0)
+	{
+		return nullptr;
+	}
+
+	rp_image *const img = new rp_image(width, height, FORMAT_ARGB32);
+	if (!img->isValid()) {
+		// Could not allocate the image.
+		delete img;
+		return nullptr;
+	}
+
+	// Horizontal pass: Source rows are converted to
+	// premultiplied floating-point, then filtered.
+	// Channel order is B, G, R, A.
+	static const float inv255 = 1.0f / 255.0f;
+	ao::uvector<float> srcRow(static_cast<size_t>(srcWidth) * 4);
+	ao::uvector<float> hbuf(static_cast<size_t>(width) * srcHeight * 4);
+	for (int y = 0; y < srcHeight; y++) {
+		const argb32_t *px = static_cast<const argb32_t*>(src->scanLine(y));
+		float *p = srcRow.data();
+		for (int x = srcWidth; x > 0; x--, px++, p += 4) {
+			const float a = px->a * inv255;
+			p[0] = px->b * a;
+			p[1] = px->g * a;
+			p[2] = px->r * a;
+			p[3] = px->a;
+		}
+
+		float *dest = &hbuf[static_cast<size_t>(y) * width * 4];
+		for (int x = 0; x < width; x++, dest += 4) {
+			const float *s = &srcRow[static_cast<size_t>(hc.first[x]) * 4];
+			const float *w = &hc.weights[static_cast<size_t>(x) * hc.taps];
+			float b = 0.0f, g = 0.0f, r = 0.0f, a = 0.0f;
+			for (int k = hc.count[x]; k > 0; k--, s += 4, w++) {
+				b += s[0] * *w;
+				g += s[1] * *w;
+				r += s[2] * *w;
+				a += s[3] * *w;
+			}
+			dest[0] = b; dest[1] = g; dest[2] = r; dest[3] = a;
+		}
+	}
+
+	// Vertical pass: Rows are accumulated, then un-premultiplied.
+	ao::uvector<float> acc(static_cast<size_t>(width) * 4);
+	for (int y = 0; y < height; y++) {
+		memset(acc.data(), 0, acc.size() * sizeof(float));
+		const float *w = &vc.weights[static_cast<size_t>(y) * vc.taps];
+		const float *s = &hbuf[static_cast<size_t>(vc.first[y]) * width * 4];
+		for (int k = vc.count[y]; k > 0; k--, w++) {
+			float *p = acc.data();
+			for (int x = width * 4; x > 0; x--, s++, p++) {
+				*p += *s * *w;
+			}
+		}
+
+		argb32_t *dest = static_cast<argb32_t*>(img->scanLine(y));
+		const float *p = acc.data();
+		for (int x = width; x > 0; x--, p += 4, dest++) {
+			const float a = p[3];
+			if (a < 0.5f) {
+				// Transparent pixel.
+				dest->u32 = 0;
+				continue;
+			}
+
+			const float unpremul = 255.0f / a;
+			const float px[4] = {p[0] * unpremul, p[1] * unpremul, p[2] * unpremul, a};
+			int c[4];
+			for (int i = 0; i < 4; i++) {
+				c[i] = static_cast<int>(lrintf(px[i]));
+				if (c[i] < 0) {
+					c[i] = 0;
+				} else if (c[i] > 255) {
+					c[i] = 255;
+				}
+			}
+			dest->b = c[0];
+			dest->g = c[1];
+			dest->r = c[2];
+			dest->a = c[3];
+		}
+	}
+
+	// Copy sBIT.
+	if (d->has_sBIT) {
+		img->set_sBIT(&d->sBIT);
+	}
+
+	return img;
+}
+
+}
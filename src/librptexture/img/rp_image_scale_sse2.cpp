@@ -0,0 +1,170 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * rp_image_scale_sse2.cpp: Image class. (scaling)                         *
+ * SSE2-optimized version.                                                 *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "rp_image.hpp"
+#include "rp_image_p.hpp"
+#include "rp_image_backend.hpp"
+
+// SSE2 intrinsics.
+#include <emmintrin.h>
+
+// C++ STL classes.
+using std::unique_ptr;
+
+// Workaround for RP_D() expecting the no-underscore, UpperCamelCase naming convention.
+#define rp_imagePrivate rp_image_private
+
+namespace LibRpTexture {
+
+/** Image operations. **/
+
+/**
+ * Scale the rp_image using a resampling filter.
+ * SSE2-optimized version.
+ *
+ * A new ARGB32 rp_image will be created with the specified
+ * dimensions. CI8 images are converted to ARGB32 first.
+ * Filtering is done using premultiplied alpha, so fully
+ * transparent pixels don't bleed into their neighbors.
+ *
+ * @param width New width.
+ * @param height New height.
+ * @param filter Resampling filter.
+ * @return New ARGB32 rp_image with a scaled version of the original, or nullptr on error.
+ */
+rp_image *rp_image::scaled_sse2(int width, int height, ScaleFilter filter) const
+{
+	RP_D(const rp_image);
+	const rp_image_backend *const backend = d->backend;
+	assert(width > 0 && height > 0);
+	if (!backend->isValid() || width <= 0 || height <= 0) {
+		return nullptr;
+	}
+
+	// CI8 images are converted to ARGB32 first.
+	const rp_image *src = this;
+	unique_ptr<rp_image> tmp_ARGB32;
+	if (backend->format != FORMAT_ARGB32) {
+		tmp_ARGB32.reset(this->dup_ARGB32());
+		if (!tmp_ARGB32 || !tmp_ARGB32->isValid()) {
+			return nullptr;
+		}
+		src = tmp_ARGB32.get();
+	}
+	const int srcWidth = src->width();
+	const int srcHeight = src->height();
+
+	ScaleCoeffs hc, vc;
+	if (hc.init(srcWidth, width, filter) != 0 ||
+	    vc.init(srcHeight, height, filter) != 0)
+	{
+		return nullptr;
+	}
+
+	rp_image *const img = new rp_image(width, height, FORMAT_ARGB32);
+	if (!img->isValid()) {
+		// Could not allocate the image.
+		delete img;
+		return nullptr;
+	}
+
+	// SSE2 constants.
+	const __m128i xmm_zero = _mm_setzero_si128();
+	const __m128 xmm_inv255 = _mm_set1_ps(1.0f / 255.0f);
+	const __m128 xmm_255 = _mm_set1_ps(255.0f);
+	const __m128 xmm_zero_ps = _mm_setzero_ps();
+	// Mask for the color channels; the alpha channel is
+	// replaced with 1.0 when (un)premultiplying.
+	const __m128 xmm_mask_rgb = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	const __m128 xmm_one_a = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+	// Horizontal pass: Source rows are converted to
+	// premultiplied floating-point, then filtered.
+	// Each pixel is one vector: B, G, R, A.
+	auto srcRow = aligned_uptr<__m128>(16, srcWidth);
+	auto hbuf = aligned_uptr<__m128>(16, static_cast<size_t>(width) * srcHeight);
+	for (int y = 0; y < srcHeight; y++) {
+		const uint32_t *px = static_cast<const uint32_t*>(src->scanLine(y));
+		__m128 *p = srcRow.get();
+		for (int x = srcWidth; x > 0; x--, px++, p++) {
+			__m128i xmm_px = _mm_cvtsi32_si128(static_cast<int>(*px));
+			xmm_px = _mm_unpacklo_epi8(xmm_px, xmm_zero);
+			xmm_px = _mm_unpacklo_epi16(xmm_px, xmm_zero);
+			const __m128 v = _mm_cvtepi32_ps(xmm_px);
+
+			// Premultiply the color channels.
+			__m128 a = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3,3,3,3));
+			a = _mm_mul_ps(a, xmm_inv255);
+			a = _mm_or_ps(_mm_and_ps(a, xmm_mask_rgb), xmm_one_a);
+			*p = _mm_mul_ps(v, a);
+		}
+
+		__m128 *dest = &hbuf.get()[static_cast<size_t>(y) * width];
+		for (int x = 0; x < width; x++, dest++) {
+			const __m128 *s = &srcRow.get()[hc.first[x]];
+			const float *w = &hc.weights[static_cast<size_t>(x) * hc.taps];
+			__m128 acc = _mm_setzero_ps();
+			for (int k = hc.count[x]; k > 0; k--, s++, w++) {
+				acc = _mm_add_ps(acc, _mm_mul_ps(*s, _mm_set1_ps(*w)));
+			}
+			*dest = acc;
+		}
+	}
+
+	// Vertical pass: Rows are accumulated, then un-premultiplied.
+	auto acc = aligned_uptr<__m128>(16, width);
+	for (int y = 0; y < height; y++) {
+		const float *w = &vc.weights[static_cast<size_t>(y) * vc.taps];
+		const __m128 *s = &hbuf.get()[static_cast<size_t>(vc.first[y]) * width];
+		for (int x = 0; x < width; x++) {
+			acc.get()[x] = _mm_setzero_ps();
+		}
+		for (int k = vc.count[y]; k > 0; k--, w++) {
+			const __m128 xmm_w = _mm_set1_ps(*w);
+			__m128 *p = acc.get();
+			for (int x = width; x > 0; x--, s++, p++) {
+				*p = _mm_add_ps(*p, _mm_mul_ps(*s, xmm_w));
+			}
+		}
+
+		uint32_t *dest = static_cast<uint32_t*>(img->scanLine(y));
+		const __m128 *p = acc.get();
+		for (int x = width; x > 0; x--, p++, dest++) {
+			const __m128 v = *p;
+			const float a = _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3,3,3,3)));
+			if (a < 0.5f) {
+				// Transparent pixel.
+				*dest = 0;
+				continue;
+			}
+
+			// Un-premultiply the color channels.
+			__m128 unpremul = _mm_div_ps(xmm_255, _mm_set1_ps(a));
+			unpremul = _mm_or_ps(_mm_and_ps(unpremul, xmm_mask_rgb), xmm_one_a);
+			__m128 c = _mm_mul_ps(v, unpremul);
+			c = _mm_min_ps(_mm_max_ps(c, xmm_zero_ps), xmm_255);
+
+			// Pack to ARGB32.
+			__m128i xmm_px = _mm_cvtps_epi32(c);
+			xmm_px = _mm_packs_epi32(xmm_px, xmm_px);
+			xmm_px = _mm_packus_epi16(xmm_px, xmm_px);
+			*dest = static_cast<uint32_t>(_mm_cvtsi128_si32(xmm_px));
+		}
+	}
+
+	// Copy sBIT.
+	if (d->has_sBIT) {
+		img->set_sBIT(&d->sBIT);
+	}
+
+	return img;
+}
+
+}
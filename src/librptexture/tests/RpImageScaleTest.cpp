@@ -0,0 +1,342 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture/tests)               *
+ * RpImageScaleTest.cpp: Test rp_image::scaled().                          *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+#include "common.h"
+
+// librptexture
+#include "librptexture/img/rp_image.hpp"
+
+// C includes.
+#include <stdint.h>
+#include <stdlib.h>
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+// C++ includes.
+#include <memory>
+#include <string>
+using std::unique_ptr;
+using std::string;
+
+namespace LibRpTexture { namespace Tests {
+
+class RpImageScaleTest : public ::testing::Test
+{
+	protected:
+		RpImageScaleTest()
+			: m_img(new rp_image(1024, 1024, rp_image::FORMAT_ARGB32))
+		{
+			// Initialize the image with pseudo-random data.
+			// Alpha is biased towards the extremes, like most textures.
+			uint32_t seed = 0x12345678;
+			for (int y = 0; y < m_img->height(); y++) {
+				uint32_t *px = static_cast<uint32_t*>(m_img->scanLine(y));
+				for (int x = m_img->width(); x > 0; x--, px++) {
+					seed = seed * 1103515245 + 12345;
+					uint32_t val = seed >> 8;
+					switch (seed >> 30) {
+						case 0:
+							// Transparent.
+							val &= 0x00FFFFFF;
+							break;
+						case 1:
+							// Translucent.
+							break;
+						default:
+							// Opaque.
+							val |= 0xFF000000;
+							break;
+					}
+					*px = val;
+				}
+			}
+		}
+
+		~RpImageScaleTest()
+		{
+			delete m_img;
+		}
+
+	public:
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 20;
+
+		// Source image.
+		rp_image *m_img;
+
+		typedef rp_image *(rp_image::*scaled_fn)(int width, int height, rp_image::ScaleFilter filter) const;
+
+		/**
+		 * Check that all pixels in an image have the specified value.
+		 * @param img	[in] ARGB32 image.
+		 * @param argb	[in] Expected pixel value.
+		 */
+		static void checkSolid(const rp_image *img, uint32_t argb);
+
+		/**
+		 * Compare two ARGB32 images, allowing a difference of 1 per channel.
+		 * @param pImgExpected	[in] Expected image data.
+		 * @param pImgActual	[in] Actual image data.
+		 */
+		static void compareImages(const rp_image *pImgExpected, const rp_image *pImgActual);
+
+		/**
+		 * Basic scaling tests for the specified scaling function.
+		 * @param fn Scaling function.
+		 */
+		void scaleTest(scaled_fn fn);
+
+		/**
+		 * Benchmark the specified scaling function.
+		 * @param fn Scaling function.
+		 * @param filter Resampling filter.
+		 */
+		void scaleBenchmark(scaled_fn fn, rp_image::ScaleFilter filter);
+};
+
+/**
+ * Check that all pixels in an image have the specified value.
+ * @param img	[in] ARGB32 image.
+ * @param argb	[in] Expected pixel value.
+ */
+void RpImageScaleTest::checkSolid(const rp_image *img, uint32_t argb)
+{
+	ASSERT_EQ(rp_image::FORMAT_ARGB32, img->format());
+	for (int y = 0; y < img->height(); y++) {
+		const uint32_t *px = static_cast<const uint32_t*>(img->scanLine(y));
+		for (int x = 0; x < img->width(); x++) {
+			ASSERT_EQ(argb, px[x]) << "pixel (" << x << "," << y << ")";
+		}
+	}
+}
+
+/**
+ * Compare two ARGB32 images, allowing a difference of 1 per channel.
+ * @param pImgExpected	[in] Expected image data.
+ * @param pImgActual	[in] Actual image data.
+ */
+void RpImageScaleTest::compareImages(const rp_image *pImgExpected, const rp_image *pImgActual)
+{
+	ASSERT_EQ(pImgExpected->width(), pImgActual->width());
+	ASSERT_EQ(pImgExpected->height(), pImgActual->height());
+	ASSERT_EQ(rp_image::FORMAT_ARGB32, pImgExpected->format());
+	ASSERT_EQ(rp_image::FORMAT_ARGB32, pImgActual->format());
+
+	for (int y = 0; y < pImgExpected->height(); y++) {
+		const argb32_t *pExp = static_cast<const argb32_t*>(pImgExpected->scanLine(y));
+		const argb32_t *pAct = static_cast<const argb32_t*>(pImgActual->scanLine(y));
+		for (int x = 0; x < pImgExpected->width(); x++, pExp++, pAct++) {
+			ASSERT_LE(abs(pExp->a - pAct->a), 1) << "pixel (" << x << "," << y << ")";
+			ASSERT_LE(abs(pExp->r - pAct->r), 1) << "pixel (" << x << "," << y << ")";
+			ASSERT_LE(abs(pExp->g - pAct->g), 1) << "pixel (" << x << "," << y << ")";
+			ASSERT_LE(abs(pExp->b - pAct->b), 1) << "pixel (" << x << "," << y << ")";
+		}
+	}
+}
+
+/**
+ * Basic scaling tests for the specified scaling function.
+ * @param fn Scaling function.
+ */
+void RpImageScaleTest::scaleTest(scaled_fn fn)
+{
+	static const rp_image::ScaleFilter filters[] = {
+		rp_image::FilterBox, rp_image::FilterBilinear, rp_image::FilterLanczos
+	};
+
+	// A solid color must stay the same with all filters,
+	// both when downscaling and when upscaling.
+	rp_image src_solid(64, 48, rp_image::FORMAT_ARGB32);
+	for (int y = 0; y < src_solid.height(); y++) {
+		uint32_t *px = static_cast<uint32_t*>(src_solid.scanLine(y));
+		for (int x = src_solid.width(); x > 0; x--, px++) {
+			*px = 0x80FF8040;
+		}
+	}
+	for (unsigned int i = 0; i < ARRAY_SIZE(filters); i++) {
+		unique_ptr<rp_image> img((src_solid.*fn)(16, 12, filters[i]));
+		ASSERT_TRUE(img != nullptr);
+		EXPECT_EQ(16, img->width());
+		EXPECT_EQ(12, img->height());
+		ASSERT_NO_FATAL_FAILURE(checkSolid(img.get(), 0x80FF8040));
+
+		img.reset((src_solid.*fn)(100, 75, filters[i]));
+		ASSERT_TRUE(img != nullptr);
+		EXPECT_EQ(100, img->width());
+		EXPECT_EQ(75, img->height());
+		ASSERT_NO_FATAL_FAILURE(checkSolid(img.get(), 0x80FF8040));
+	}
+
+	// Box filter: 2x2 checkerboard averages to gray.
+	rp_image src_checker(64, 64, rp_image::FORMAT_ARGB32);
+	for (int y = 0; y < src_checker.height(); y++) {
+		uint32_t *px = static_cast<uint32_t*>(src_checker.scanLine(y));
+		for (int x = 0; x < src_checker.width(); x++) {
+			px[x] = ((x ^ y) & 1) ? 0xFFFFFFFF : 0xFF000000;
+		}
+	}
+	unique_ptr<rp_image> img((src_checker.*fn)(32, 32, rp_image::FilterBox));
+	ASSERT_TRUE(img != nullptr);
+	ASSERT_NO_FATAL_FAILURE(checkSolid(img.get(), 0xFF808080));
+
+	// Premultiplied alpha: The color of a fully transparent
+	// pixel must not affect the result.
+	rp_image src_alpha(2, 1, rp_image::FORMAT_ARGB32);
+	uint32_t *px = static_cast<uint32_t*>(src_alpha.bits());
+	px[0] = 0x00FF0000;	// transparent red
+	px[1] = 0xFF0000FF;	// opaque blue
+	img.reset((src_alpha.*fn)(1, 1, rp_image::FilterBox));
+	ASSERT_TRUE(img != nullptr);
+	ASSERT_NO_FATAL_FAILURE(checkSolid(img.get(), 0x800000FF));
+
+	// CI8 images are converted to ARGB32.
+	rp_image src_ci8(16, 16, rp_image::FORMAT_CI8);
+	uint32_t *const palette = src_ci8.palette();
+	ASSERT_TRUE(palette != nullptr);
+	palette[1] = 0xFF00FF00;
+	memset(src_ci8.bits(), 1, src_ci8.data_len());
+	img.reset((src_ci8.*fn)(4, 4, rp_image::FilterBilinear));
+	ASSERT_TRUE(img != nullptr);
+	ASSERT_NO_FATAL_FAILURE(checkSolid(img.get(), 0xFF00FF00));
+
+	// Invalid sizes.
+	img.reset((src_solid.*fn)(0, 16, rp_image::FilterBox));
+	EXPECT_TRUE(img == nullptr);
+}
+
+/**
+ * Benchmark the specified scaling function.
+ * @param fn Scaling function.
+ * @param filter Resampling filter.
+ */
+void RpImageScaleTest::scaleBenchmark(scaled_fn fn, rp_image::ScaleFilter filter)
+{
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		unique_ptr<rp_image> img((m_img->*fn)(256, 256, filter));
+		ASSERT_TRUE(img != nullptr);
+	}
+}
+
+/**
+ * Test rp_image::scaled_cpp().
+ */
+TEST_F(RpImageScaleTest, scaled_cpp_test)
+{
+	ASSERT_NO_FATAL_FAILURE(scaleTest(&rp_image::scaled_cpp));
+}
+
+#ifdef RP_IMAGE_HAS_SSE2
+/**
+ * Test rp_image::scaled_sse2().
+ */
+TEST_F(RpImageScaleTest, scaled_sse2_test)
+{
+	if (!RP_CPU_HasSSE2()) {
+		fprintf(stderr, "*** SSE2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_NO_FATAL_FAILURE(scaleTest(&rp_image::scaled_sse2));
+
+	// The SSE2 version must match the standard version.
+	static const rp_image::ScaleFilter filters[] = {
+		rp_image::FilterBox, rp_image::FilterBilinear, rp_image::FilterLanczos
+	};
+	for (unsigned int i = 0; i < ARRAY_SIZE(filters); i++) {
+		unique_ptr<rp_image> img_cpp(m_img->scaled_cpp(200, 150, filters[i]));
+		unique_ptr<rp_image> img_sse2(m_img->scaled_sse2(200, 150, filters[i]));
+		ASSERT_TRUE(img_cpp != nullptr);
+		ASSERT_TRUE(img_sse2 != nullptr);
+		ASSERT_NO_FATAL_FAILURE(compareImages(img_cpp.get(), img_sse2.get()));
+	}
+}
+#endif /* RP_IMAGE_HAS_SSE2 */
+
+/**
+ * Benchmark rp_image::scaled_cpp(). (box filter)
+ */
+TEST_F(RpImageScaleTest, scaled_cpp_box_benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(scaleBenchmark(&rp_image::scaled_cpp, rp_image::FilterBox));
+}
+
+/**
+ * Benchmark rp_image::scaled_cpp(). (bilinear filter)
+ */
+TEST_F(RpImageScaleTest, scaled_cpp_bilinear_benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(scaleBenchmark(&rp_image::scaled_cpp, rp_image::FilterBilinear));
+}
+
+/**
+ * Benchmark rp_image::scaled_cpp(). (Lanczos filter)
+ */
+TEST_F(RpImageScaleTest, scaled_cpp_lanczos_benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(scaleBenchmark(&rp_image::scaled_cpp, rp_image::FilterLanczos));
+}
+
+#ifdef RP_IMAGE_HAS_SSE2
+/**
+ * Benchmark rp_image::scaled_sse2(). (box filter)
+ */
+TEST_F(RpImageScaleTest, scaled_sse2_box_benchmark)
+{
+	if (!RP_CPU_HasSSE2()) {
+		fprintf(stderr, "*** SSE2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+	ASSERT_NO_FATAL_FAILURE(scaleBenchmark(&rp_image::scaled_sse2, rp_image::FilterBox));
+}
+
+/**
+ * Benchmark rp_image::scaled_sse2(). (bilinear filter)
+ */
+TEST_F(RpImageScaleTest, scaled_sse2_bilinear_benchmark)
+{
+	if (!RP_CPU_HasSSE2()) {
+		fprintf(stderr, "*** SSE2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+	ASSERT_NO_FATAL_FAILURE(scaleBenchmark(&rp_image::scaled_sse2, rp_image::FilterBilinear));
+}
+
+/**
+ * Benchmark rp_image::scaled_sse2(). (Lanczos filter)
+ */
+TEST_F(RpImageScaleTest, scaled_sse2_lanczos_benchmark)
+{
+	if (!RP_CPU_HasSSE2()) {
+		fprintf(stderr, "*** SSE2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+	ASSERT_NO_FATAL_FAILURE(scaleBenchmark(&rp_image::scaled_sse2, rp_image::FilterLanczos));
+}
+#endif /* RP_IMAGE_HAS_SSE2 */
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpTexture test suite: rp_image::scaled() tests.\n\n");
+	fprintf(stderr, "Benchmark iterations: %u\n",
+		LibRpTexture::Tests::RpImageScaleTest::BENCHMARK_ITERATIONS);
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,696 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpthreads)                     *
+ * ThreadPool.cpp: Worker thread pool.                                     *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "config.librpthreads.h"
+#include "ThreadPool.hpp"
+#include "Atomics.h"
+#include "pthread_once.h"
+
+#ifdef _WIN32
+# include <windows.h>
+# include <process.h>
+#else /* !_WIN32 */
+# include <pthread.h>
+# include <unistd.h>
+#endif /* _WIN32 */
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cstddef>
+
+namespace LibRpBase {
+
+/**
+ * Submitted job.
+ * Jobs are kept in a singly-linked FIFO queue until they're started.
+ */
+struct ThreadPool::Future {
+	enum State {
+		STATE_QUEUED,
+		STATE_RUNNING,
+		STATE_DONE,
+	};
+
+	ThreadPool::JobFn fn;
+	void *param;
+	Future *next;		// Next job in the queue.
+	State state;		// Protected by the mutex.
+};
+
+class ThreadPoolPrivate
+{
+	public:
+		explicit ThreadPoolPrivate(unsigned int workerCount);
+		~ThreadPoolPrivate();
+
+	private:
+#if __cplusplus >= 201103L
+		ThreadPoolPrivate(const ThreadPoolPrivate &) = delete;
+		ThreadPoolPrivate &operator=(const ThreadPoolPrivate &) = delete;
+#else /* __cplusplus < 201103L */
+		ThreadPoolPrivate(const ThreadPoolPrivate &);
+		ThreadPoolPrivate &operator=(const ThreadPoolPrivate &);
+#endif /* __cplusplus */
+
+	public:
+		// Shared thread pool.
+		static ThreadPool *instance;
+		static pthread_once_t instance_once_control;
+
+		/**
+		 * Create the shared thread pool.
+		 * Called by pthread_once().
+		 */
+		static void initInstance(void);
+
+		/**
+		 * Get the number of CPUs.
+		 * @return Number of CPUs.
+		 */
+		static unsigned int cpuCount(void);
+
+	public:
+		/** Synchronization primitives **/
+		// NOTE: Win32 condition variables require Windows Vista.
+#ifdef _WIN32
+		CRITICAL_SECTION mutex;
+		CONDITION_VARIABLE condStart;	// Signaled when a task or job is started.
+		CONDITION_VARIABLE condDone;	// Signaled when the last worker is done.
+		CONDITION_VARIABLE condJobDone;	// Signaled when a job is done.
+		inline void lock(void) { EnterCriticalSection(&mutex); }
+		inline void unlock(void) { LeaveCriticalSection(&mutex); }
+		inline void wait(CONDITION_VARIABLE *cond) { SleepConditionVariableCS(cond, &mutex, INFINITE); }
+		inline void broadcast(CONDITION_VARIABLE *cond) { WakeAllConditionVariable(cond); }
+		inline void signal(CONDITION_VARIABLE *cond) { WakeConditionVariable(cond); }
+#else /* !_WIN32 */
+		pthread_mutex_t mutex;
+		pthread_cond_t condStart;	// Signaled when a task or job is started.
+		pthread_cond_t condDone;	// Signaled when the last worker is done.
+		pthread_cond_t condJobDone;	// Signaled when a job is done.
+		inline void lock(void) { pthread_mutex_lock(&mutex); }
+		inline void unlock(void) { pthread_mutex_unlock(&mutex); }
+		inline void wait(pthread_cond_t *cond) { pthread_cond_wait(cond, &mutex); }
+		inline void broadcast(pthread_cond_t *cond) { pthread_cond_broadcast(cond); }
+		inline void signal(pthread_cond_t *cond) { pthread_cond_signal(cond); }
+#endif /* _WIN32 */
+
+		/** Worker threads **/
+
+		struct Worker {
+			ThreadPoolPrivate *d;
+			unsigned int idx;
+#ifdef _WIN32
+			HANDLE hThread;
+#else /* !_WIN32 */
+			pthread_t thread;
+#endif /* _WIN32 */
+		};
+		Worker workers[ThreadPool::MAX_THREADS];
+		unsigned int workerCount;
+
+		/**
+		 * Worker thread function.
+		 * @param param Worker.
+		 */
+#ifdef _WIN32
+		static unsigned int __stdcall workerThread(void *param);
+#else /* !_WIN32 */
+		static void *workerThread(void *param);
+#endif /* _WIN32 */
+
+		/** Current task **/
+		// These fields are protected by the mutex,
+		// except for nextIndex, which is atomic.
+		// NOTE: Idle workers join the current task instead of
+		// being assigned to it, since a worker might be running
+		// a job when the task is started.
+
+		bool busy;		// True if a task is running.
+		bool quit;		// True if the workers should exit.
+		unsigned int freeSlots;		// Number of workers that can still join this task.
+		unsigned int pendingWorkers;	// Number of workers that joined and haven't finished yet.
+
+		ThreadPool::TaskFn fn;
+		void *param;
+		int count;
+		volatile int nextIndex;
+
+		/**
+		 * Run task indexes until there are none left.
+		 * Called by both the workers and the calling thread.
+		 */
+		inline void runIndexes(void)
+		{
+			int i;
+			while ((i = ATOMIC_INC_FETCH(&nextIndex) - 1) < count) {
+				fn(param, static_cast<unsigned int>(i));
+			}
+		}
+
+		/** Job queue **/
+		// Protected by the mutex.
+		ThreadPool::Future *jobHead;
+		ThreadPool::Future *jobTail;
+
+		/**
+		 * Remove a job from the queue.
+		 * Mutex must be locked by the caller.
+		 * @param future Job to remove.
+		 */
+		void unlinkJob(ThreadPool::Future *future);
+
+		/**
+		 * Run a job and mark it as done.
+		 * Mutex must be locked by the caller, and the job
+		 * must have already been removed from the queue.
+		 * The mutex is unlocked while the job is running.
+		 * @param future Job to run.
+		 */
+		void runJob(ThreadPool::Future *future);
+};
+
+/** ThreadPoolPrivate **/
+
+ThreadPool *ThreadPoolPrivate::instance = nullptr;
+pthread_once_t ThreadPoolPrivate::instance_once_control = PTHREAD_ONCE_INIT;
+
+ThreadPoolPrivate::ThreadPoolPrivate(unsigned int workerCount)
+	: workerCount(0)
+	, busy(false)
+	, quit(false)
+	, freeSlots(0)
+	, pendingWorkers(0)
+	, fn(nullptr)
+	, param(nullptr)
+	, count(0)
+	, nextIndex(0)
+	, jobHead(nullptr)
+	, jobTail(nullptr)
+{
+	assert(workerCount < ThreadPool::MAX_THREADS);
+	if (workerCount >= ThreadPool::MAX_THREADS) {
+		workerCount = ThreadPool::MAX_THREADS - 1;
+	}
+
+#ifdef _WIN32
+	InitializeCriticalSection(&mutex);
+	InitializeConditionVariable(&condStart);
+	InitializeConditionVariable(&condDone);
+	InitializeConditionVariable(&condJobDone);
+#else /* !_WIN32 */
+	pthread_mutex_init(&mutex, nullptr);
+	pthread_cond_init(&condStart, nullptr);
+	pthread_cond_init(&condDone, nullptr);
+	pthread_cond_init(&condJobDone, nullptr);
+#endif /* _WIN32 */
+
+	// Start the worker threads.
+	// If a thread can't be created, fewer workers are used.
+	// NOTE: A seccomp sandbox that doesn't allow clone() kills
+	// the process here instead of returning an error.
+	for (unsigned int i = 0; i < workerCount; i++) {
+		Worker *const worker = &workers[this->workerCount];
+		worker->d = this;
+		worker->idx = this->workerCount;
+#ifdef _WIN32
+		worker->hThread = reinterpret_cast<HANDLE>(
+			_beginthreadex(nullptr, 0, workerThread, worker, 0, nullptr));
+		if (!worker->hThread)
+			break;
+#else /* !_WIN32 */
+		if (pthread_create(&worker->thread, nullptr, workerThread, worker) != 0)
+			break;
+#endif /* _WIN32 */
+		this->workerCount++;
+	}
+}
+
+ThreadPoolPrivate::~ThreadPoolPrivate()
+{
+	// Tell the workers to exit.
+	// NOTE: Workers only exit once the job queue is empty.
+	lock();
+	quit = true;
+	broadcast(&condStart);
+	unlock();
+
+	for (unsigned int i = 0; i < workerCount; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(workers[i].hThread, INFINITE);
+		CloseHandle(workers[i].hThread);
+#else /* !_WIN32 */
+		pthread_join(workers[i].thread, nullptr);
+#endif /* _WIN32 */
+	}
+
+	// All futures should have been released by wait(),
+	// so the queue should be empty.
+	assert(jobHead == nullptr);
+
+#ifdef _WIN32
+	DeleteCriticalSection(&mutex);
+#else /* !_WIN32 */
+	pthread_cond_destroy(&condJobDone);
+	pthread_cond_destroy(&condDone);
+	pthread_cond_destroy(&condStart);
+	pthread_mutex_destroy(&mutex);
+#endif /* _WIN32 */
+}
+
+/**
+ * Create the shared thread pool.
+ * Called by pthread_once().
+ */
+void ThreadPoolPrivate::initInstance(void)
+{
+	unsigned int threads = cpuCount();
+	if (threads > ThreadPool::MAX_THREADS) {
+		threads = ThreadPool::MAX_THREADS;
+	} else if (threads == 0) {
+		threads = 1;
+	}
+
+	// The calling thread is used as well,
+	// so we need one less worker thread.
+	instance = new ThreadPool(threads - 1);
+}
+
+/**
+ * Get the number of CPUs.
+ * @return Number of CPUs.
+ */
+unsigned int ThreadPoolPrivate::cpuCount(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return static_cast<unsigned int>(si.dwNumberOfProcessors);
+#else /* !_WIN32 */
+	const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return (cpus > 0 ? static_cast<unsigned int>(cpus) : 1);
+#endif /* _WIN32 */
+}
+
+/**
+ * Worker thread function.
+ * @param param Worker.
+ */
+#ifdef _WIN32
+unsigned int __stdcall ThreadPoolPrivate::workerThread(void *param)
+#else /* !_WIN32 */
+void *ThreadPoolPrivate::workerThread(void *param)
+#endif /* _WIN32 */
+{
+	const Worker *const worker = static_cast<const Worker*>(param);
+	ThreadPoolPrivate *const d = worker->d;
+
+	d->lock();
+	for (;;) {
+		if (d->freeSlots > 0) {
+			// Help with the current task first,
+			// since the calling thread is waiting for it.
+			d->freeSlots--;
+			d->pendingWorkers++;
+			d->unlock();
+			d->runIndexes();
+			d->lock();
+
+			assert(d->pendingWorkers > 0);
+			if (--d->pendingWorkers == 0) {
+				// Last worker is done.
+				d->signal(&d->condDone);
+			}
+			continue;
+		}
+
+		ThreadPool::Future *const future = d->jobHead;
+		if (future) {
+			// Run the next job.
+			d->unlinkJob(future);
+			d->runJob(future);
+			continue;
+		}
+
+		if (d->quit)
+			break;
+
+		// Wait for a new task or job.
+		d->wait(&d->condStart);
+	}
+	d->unlock();
+
+#ifdef _WIN32
+	return 0;
+#else /* !_WIN32 */
+	return nullptr;
+#endif /* _WIN32 */
+}
+
+/**
+ * Remove a job from the queue.
+ * Mutex must be locked by the caller.
+ * @param future Job to remove.
+ */
+void ThreadPoolPrivate::unlinkJob(ThreadPool::Future *future)
+{
+	ThreadPool::Future *prev = nullptr;
+	for (ThreadPool::Future *p = jobHead; p != nullptr; prev = p, p = p->next) {
+		if (p != future)
+			continue;
+
+		if (prev) {
+			prev->next = p->next;
+		} else {
+			jobHead = p->next;
+		}
+		if (jobTail == p) {
+			jobTail = prev;
+		}
+		p->next = nullptr;
+		return;
+	}
+
+	// Job wasn't found.
+	assert(!"Job is not in the queue.");
+}
+
+/**
+ * Run a job and mark it as done.
+ * Mutex must be locked by the caller, and the job
+ * must have already been removed from the queue.
+ * The mutex is unlocked while the job is running.
+ * @param future Job to run.
+ */
+void ThreadPoolPrivate::runJob(ThreadPool::Future *future)
+{
+	assert(future->state == ThreadPool::Future::STATE_QUEUED);
+	future->state = ThreadPool::Future::STATE_RUNNING;
+	unlock();
+	future->fn(future->param);
+	lock();
+	future->state = ThreadPool::Future::STATE_DONE;
+	broadcast(&condJobDone);
+}
+
+/** ThreadPool **/
+
+/**
+ * Create a thread pool.
+ *
+ * Most code should use the shared thread pool instead.
+ * See instance().
+ *
+ * If pthread_create() or _beginthreadex() fails, fewer
+ * workers are used. With no workers, everything is run
+ * on the calling thread. This does *not* cover sandboxes
+ * that kill the process on a disallowed syscall, e.g.
+ * seccomp with SCMP_ACT_KILL, so sandboxed programs that
+ * use a thread pool must allow clone() and the other
+ * syscalls used to create threads.
+ *
+ * @param workerCount Number of worker threads. (max MAX_THREADS-1)
+ */
+ThreadPool::ThreadPool(unsigned int workerCount)
+	: d_ptr(new ThreadPoolPrivate(workerCount))
+{ }
+
+/**
+ * Shut down the thread pool.
+ * The worker threads are stopped and joined.
+ * All futures must be passed to wait() before the pool
+ * is deleted, and no task may be running.
+ */
+ThreadPool::~ThreadPool()
+{
+	delete d_ptr;
+}
+
+/**
+ * Get the shared thread pool.
+ *
+ * The pool is created on first use, with one thread per
+ * CPU (including the calling thread) up to MAX_THREADS.
+ * It is never destroyed; idle workers are blocked and
+ * don't use any CPU time.
+ *
+ * @return Shared thread pool.
+ */
+ThreadPool *ThreadPool::instance(void)
+{
+	pthread_once(&ThreadPoolPrivate::instance_once_control, ThreadPoolPrivate::initInstance);
+	return ThreadPoolPrivate::instance;
+}
+
+/**
+ * Get the number of threads that can run a task,
+ * including the calling thread.
+ * @return Number of threads.
+ */
+unsigned int ThreadPool::threadCount(void) const
+{
+	return d_ptr->workerCount + 1;
+}
+
+/**
+ * Run a task in parallel.
+ *
+ * fn(param, i) is called once for each i in [0, count).
+ * The calling thread participates, and this function
+ * returns once all calls have returned.
+ *
+ * Only one task can run at a time. If the pool is busy,
+ * e.g. if another thread is running a task or if this is
+ * called from a task, everything is run on the calling thread.
+ *
+ * @param fn		[in] Task function.
+ * @param param		[in] Task parameter.
+ * @param count		[in] Number of calls.
+ * @param maxThreads	[in,opt] Maximum number of threads, including the calling thread. (0 for no limit)
+ */
+void ThreadPool::run(TaskFn fn, void *param, unsigned int count, unsigned int maxThreads)
+{
+	assert(fn != nullptr);
+	if (!fn || count == 0)
+		return;
+
+	ThreadPoolPrivate *const d = d_ptr;
+
+	// Number of workers to use.
+	// The calling thread is used as well.
+	unsigned int workers = d->workerCount;
+	if (maxThreads > 0 && maxThreads - 1 < workers) {
+		workers = maxThreads - 1;
+	}
+	if (workers >= count) {
+		workers = count - 1;
+	}
+
+	d->lock();
+	if (workers == 0 || d->busy) {
+		// Run everything on the calling thread.
+		d->unlock();
+		for (unsigned int i = 0; i < count; i++) {
+			fn(param, i);
+		}
+		return;
+	}
+
+	// Start the task.
+	// Idle workers will join it. Workers that are running
+	// a job will join it once the job is finished.
+	d->busy = true;
+	d->fn = fn;
+	d->param = param;
+	d->count = static_cast<int>(count);
+	d->nextIndex = 0;
+	d->freeSlots = workers;
+	d->pendingWorkers = 0;
+	d->broadcast(&d->condStart);
+	d->unlock();
+
+	// Run indexes on the calling thread, too.
+	d->runIndexes();
+
+	// All indexes have been started, so no more workers
+	// are needed. Wait for the ones that joined to finish.
+	d->lock();
+	d->freeSlots = 0;
+	while (d->pendingWorkers > 0) {
+		d->wait(&d->condDone);
+	}
+	d->busy = false;
+	d->fn = nullptr;
+	d->param = nullptr;
+	d->unlock();
+}
+
+/**
+ * parallelFor() parameters.
+ */
+struct ParallelForParam {
+	ThreadPool::RangeFn fn;
+	void *param;
+	unsigned int begin;
+	unsigned int end;
+	unsigned int grainSize;
+};
+
+/**
+ * parallelFor() task function.
+ * @param param ParallelForParam
+ * @param index Chunk index.
+ */
+static void parallelForTask(void *param, unsigned int index)
+{
+	const ParallelForParam *const pfp = static_cast<const ParallelForParam*>(param);
+	const unsigned int chunkBegin = pfp->begin + (index * pfp->grainSize);
+	unsigned int chunkEnd = pfp->end;
+	if (pfp->end - chunkBegin > pfp->grainSize) {
+		chunkEnd = chunkBegin + pfp->grainSize;
+	}
+	pfp->fn(pfp->param, chunkBegin, chunkEnd);
+}
+
+/**
+ * Run a loop over an index range in parallel.
+ *
+ * The range [begin, end) is split into chunks of grainSize
+ * indexes, and fn(param, chunkBegin, chunkEnd) is called once
+ * for each chunk. Chunks are handed out to threads as they
+ * finish their previous chunk, so uneven workloads are
+ * balanced automatically.
+ *
+ * Same restrictions as run().
+ *
+ * @param fn		[in] Range function.
+ * @param param		[in] Task parameter.
+ * @param begin		[in] First index.
+ * @param end		[in] One past the last index.
+ * @param grainSize	[in,opt] Indexes per chunk. (0 for automatic)
+ * @param maxThreads	[in,opt] Maximum number of threads, including the calling thread. (0 for no limit)
+ */
+void ThreadPool::parallelFor(RangeFn fn, void *param, unsigned int begin, unsigned int end,
+	unsigned int grainSize, unsigned int maxThreads)
+{
+	assert(fn != nullptr);
+	assert(begin <= end);
+	if (!fn || begin >= end)
+		return;
+
+	const unsigned int total = end - begin;
+	if (grainSize == 0) {
+		// Automatic: Four chunks per thread, which is enough
+		// to balance uneven workloads without too much overhead.
+		unsigned int threads = threadCount();
+		if (maxThreads > 0 && maxThreads < threads) {
+			threads = maxThreads;
+		}
+		const unsigned int chunks = threads * 4;
+		grainSize = (total / chunks) + (total % chunks != 0);
+	}
+
+	ParallelForParam pfp;
+	pfp.fn = fn;
+	pfp.param = param;
+	pfp.begin = begin;
+	pfp.end = end;
+	pfp.grainSize = grainSize;
+
+	const unsigned int chunkCount = (total / grainSize) + (total % grainSize != 0);
+	run(parallelForTask, &pfp, chunkCount, maxThreads);
+}
+
+/**
+ * Submit a job to be run asynchronously on a worker thread.
+ *
+ * Jobs are run in the order they were submitted. Idle workers
+ * help with run() and parallelFor() before starting new jobs.
+ * If the pool has no worker threads, the job is run on the
+ * calling thread before this function returns.
+ *
+ * @param fn	[in] Job function.
+ * @param param	[in] Job parameter.
+ * @return Future for the job. (Must be passed to wait() exactly once.)
+ */
+ThreadPool::Future *ThreadPool::submit(JobFn fn, void *param)
+{
+	assert(fn != nullptr);
+	Future *const future = new Future;
+	future->fn = fn;
+	future->param = param;
+	future->next = nullptr;
+	future->state = Future::STATE_QUEUED;
+
+	ThreadPoolPrivate *const d = d_ptr;
+	d->lock();
+	if (d->workerCount == 0) {
+		// No worker threads. Run the job on the calling thread.
+		d->runJob(future);
+		d->unlock();
+		return future;
+	}
+
+	// Add the job to the end of the queue.
+	if (d->jobTail) {
+		d->jobTail->next = future;
+	} else {
+		d->jobHead = future;
+	}
+	d->jobTail = future;
+	d->signal(&d->condStart);
+	d->unlock();
+	return future;
+}
+
+/**
+ * Check if a job has finished.
+ * @param future Future from submit().
+ * @return True if the job has finished; false if not.
+ */
+bool ThreadPool::isReady(const Future *future) const
+{
+	assert(future != nullptr);
+	ThreadPoolPrivate *const d = d_ptr;
+	d->lock();
+	const bool ready = (future->state == Future::STATE_DONE);
+	d->unlock();
+	return ready;
+}
+
+/**
+ * Wait for a job to finish, then release the future.
+ *
+ * If the job hasn't been started yet, it's run on the calling
+ * thread, so jobs can wait on other jobs without deadlocking
+ * the pool.
+ *
+ * @param future Future from submit(). (Invalid after this call.)
+ */
+void ThreadPool::wait(Future *future)
+{
+	assert(future != nullptr);
+	if (!future)
+		return;
+
+	ThreadPoolPrivate *const d = d_ptr;
+	d->lock();
+	if (future->state == Future::STATE_QUEUED) {
+		// Job hasn't been started yet. Run it here.
+		d->unlinkJob(future);
+		d->runJob(future);
+	} else {
+		while (future->state != Future::STATE_DONE) {
+			d->wait(&d->condJobDone);
+		}
+	}
+	d->unlock();
+
+	delete future;
+}
+
+}
@@ -0,0 +1,181 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpthreads)                     *
+ * ThreadPool.hpp: Worker thread pool.                                     *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPTHREADS_THREADPOOL_HPP__
+#define __ROMPROPERTIES_LIBRPTHREADS_THREADPOOL_HPP__
+
+namespace LibRpBase {
+
+class ThreadPoolPrivate;
+class ThreadPool
+{
+	public:
+		/**
+		 * Create a thread pool.
+		 *
+		 * Most code should use the shared thread pool instead.
+		 * See instance().
+		 *
+		 * If pthread_create() or _beginthreadex() fails, fewer
+		 * workers are used. With no workers, everything is run
+		 * on the calling thread. This does *not* cover sandboxes
+		 * that kill the process on a disallowed syscall, e.g.
+		 * seccomp with SCMP_ACT_KILL, so sandboxed programs that
+		 * use a thread pool must allow clone() and the other
+		 * syscalls used to create threads.
+		 *
+		 * @param workerCount Number of worker threads. (max MAX_THREADS-1)
+		 */
+		explicit ThreadPool(unsigned int workerCount);
+
+		/**
+		 * Shut down the thread pool.
+		 * The worker threads are stopped and joined.
+		 * All futures must be passed to wait() before the pool
+		 * is deleted, and no task may be running.
+		 */
+		~ThreadPool();
+
+	private:
+#if __cplusplus >= 201103L
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool &operator=(const ThreadPool &) = delete;
+#else /* __cplusplus < 201103L */
+		ThreadPool(const ThreadPool &);
+		ThreadPool &operator=(const ThreadPool &);
+#endif /* __cplusplus */
+
+	private:
+		friend class ThreadPoolPrivate;
+		ThreadPoolPrivate *const d_ptr;
+
+	public:
+		// Maximum number of threads, including the calling thread.
+		static const unsigned int MAX_THREADS = 16;
+
+		/**
+		 * Get the shared thread pool.
+		 *
+		 * The pool is created on first use, with one thread per
+		 * CPU (including the calling thread) up to MAX_THREADS.
+		 * It is never destroyed; idle workers are blocked and
+		 * don't use any CPU time.
+		 *
+		 * @return Shared thread pool.
+		 */
+		static ThreadPool *instance(void);
+
+		/**
+		 * Get the number of threads that can run a task,
+		 * including the calling thread.
+		 * @return Number of threads.
+		 */
+		unsigned int threadCount(void) const;
+
+		/**
+		 * Task function.
+		 * @param param Task parameter.
+		 * @param index Index, from 0 to count-1.
+		 */
+		typedef void (*TaskFn)(void *param, unsigned int index);
+
+		/**
+		 * Run a task in parallel.
+		 *
+		 * fn(param, i) is called once for each i in [0, count).
+		 * The calling thread participates, and this function
+		 * returns once all calls have returned.
+		 *
+		 * Only one task can run at a time. If the pool is busy,
+		 * e.g. if another thread is running a task or if this is
+		 * called from a task, everything is run on the calling thread.
+		 *
+		 * @param fn		[in] Task function.
+		 * @param param		[in] Task parameter.
+		 * @param count		[in] Number of calls.
+		 * @param maxThreads	[in,opt] Maximum number of threads, including the calling thread. (0 for no limit)
+		 */
+		void run(TaskFn fn, void *param, unsigned int count, unsigned int maxThreads = 0);
+
+		/**
+		 * Range function for parallelFor().
+		 * @param param Task parameter.
+		 * @param begin First index.
+		 * @param end One past the last index.
+		 */
+		typedef void (*RangeFn)(void *param, unsigned int begin, unsigned int end);
+
+		/**
+		 * Run a loop over an index range in parallel.
+		 *
+		 * The range [begin, end) is split into chunks of grainSize
+		 * indexes, and fn(param, chunkBegin, chunkEnd) is called once
+		 * for each chunk. Chunks are handed out to threads as they
+		 * finish their previous chunk, so uneven workloads are
+		 * balanced automatically.
+		 *
+		 * Same restrictions as run().
+		 *
+		 * @param fn		[in] Range function.
+		 * @param param		[in] Task parameter.
+		 * @param begin		[in] First index.
+		 * @param end		[in] One past the last index.
+		 * @param grainSize	[in,opt] Indexes per chunk. (0 for automatic)
+		 * @param maxThreads	[in,opt] Maximum number of threads, including the calling thread. (0 for no limit)
+		 */
+		void parallelFor(RangeFn fn, void *param, unsigned int begin, unsigned int end,
+			unsigned int grainSize = 0, unsigned int maxThreads = 0);
+
+		/**
+		 * Job function.
+		 * @param param Job parameter.
+		 */
+		typedef void (*JobFn)(void *param);
+
+		/**
+		 * Handle for a submitted job.
+		 * Returned by submit(); released by wait().
+		 */
+		struct Future;
+
+		/**
+		 * Submit a job to be run asynchronously on a worker thread.
+		 *
+		 * Jobs are run in the order they were submitted. Idle workers
+		 * help with run() and parallelFor() before starting new jobs.
+		 * If the pool has no worker threads, the job is run on the
+		 * calling thread before this function returns.
+		 *
+		 * @param fn	[in] Job function.
+		 * @param param	[in] Job parameter.
+		 * @return Future for the job. (Must be passed to wait() exactly once.)
+		 */
+		Future *submit(JobFn fn, void *param);
+
+		/**
+		 * Check if a job has finished.
+		 * @param future Future from submit().
+		 * @return True if the job has finished; false if not.
+		 */
+		bool isReady(const Future *future) const;
+
+		/**
+		 * Wait for a job to finish, then release the future.
+		 *
+		 * If the job hasn't been started yet, it's run on the calling
+		 * thread, so jobs can wait on other jobs without deadlocking
+		 * the pool.
+		 *
+		 * @param future Future from submit(). (Invalid after this call.)
+		 */
+		void wait(Future *future);
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBRPTHREADS_THREADPOOL_HPP__ */
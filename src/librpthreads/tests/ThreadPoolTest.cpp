@@ -0,0 +1,466 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpthreads/tests)               *
+ * ThreadPoolTest.cpp: ThreadPool test.                                    *
+ *                                                                         *
+ * Copyright (c) 2020 by David Korth.                                      *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// ThreadPool
+#include "librpthreads/ThreadPool.hpp"
+#include "librpthreads/Atomics.h"
+
+// C includes.
+#include <stdint.h>
+
+// C includes. (C++ namespace)
+#include <cstdio>
+
+// C++ includes.
+#include <memory>
+#include <vector>
+using std::unique_ptr;
+using std::vector;
+
+namespace LibRpBase { namespace Tests {
+
+class ThreadPoolTest : public ::testing::Test
+{
+	public:
+		// Number of indexes for run() and parallelFor() tests.
+		static const unsigned int INDEX_COUNT = 10000;
+
+		// Number of jobs for submit() tests.
+		static const unsigned int JOB_COUNT = 256;
+
+		// Benchmark parameters.
+		static const unsigned int BENCHMARK_ITERATIONS = 100;
+		static const unsigned int BENCHMARK_COUNT = 65536;
+		static const unsigned int BENCHMARK_ROUNDS = 256;
+
+		// Number of worker threads in the test pool.
+		// The shared pool has no workers on single-CPU systems,
+		// so the tests use their own pool to ensure that tasks
+		// and jobs actually run on multiple threads.
+		static const unsigned int TEST_POOL_WORKERS = 3;
+
+		// Thread pool for the tests.
+		static ThreadPool *pool;
+
+		static void SetUpTestCase(void)
+		{
+			pool = new ThreadPool(TEST_POOL_WORKERS);
+		}
+
+		static void TearDownTestCase(void)
+		{
+			delete pool;
+			pool = nullptr;
+		}
+
+	public:
+		/**
+		 * Index counters.
+		 * Each task function increments counters[index],
+		 * so each counter should be 1 afterwards.
+		 */
+		struct Counters {
+			vector<int> counters;
+			volatile int calls;
+
+			explicit Counters(unsigned int count)
+				: counters(count), calls(0)
+			{ }
+
+			/**
+			 * Check that each counter was incremented exactly once.
+			 * @return Number of counters that weren't 1.
+			 */
+			unsigned int errors(void) const
+			{
+				unsigned int errors = 0;
+				for (auto iter = counters.cbegin(); iter != counters.cend(); ++iter) {
+					if (*iter != 1) {
+						errors++;
+					}
+				}
+				return errors;
+			}
+		};
+
+		/**
+		 * Task function for run().
+		 * @param param Counters
+		 * @param index Index
+		 */
+		static void countTask(void *param, unsigned int index)
+		{
+			Counters *const c = static_cast<Counters*>(param);
+			ATOMIC_INC_FETCH(&c->counters[index]);
+			ATOMIC_INC_FETCH(&c->calls);
+		}
+
+		/**
+		 * Range function for parallelFor().
+		 * @param param Counters
+		 * @param begin First index.
+		 * @param end One past the last index.
+		 */
+		static void countRange(void *param, unsigned int begin, unsigned int end)
+		{
+			Counters *const c = static_cast<Counters*>(param);
+			EXPECT_LT(begin, end);
+			for (unsigned int i = begin; i < end; i++) {
+				ATOMIC_INC_FETCH(&c->counters[i]);
+			}
+			ATOMIC_INC_FETCH(&c->calls);
+		}
+
+		/**
+		 * Job function for submit().
+		 * @param param int counter
+		 */
+		static void countJob(void *param)
+		{
+			ATOMIC_INC_FETCH(static_cast<volatile int*>(param));
+		}
+
+		/**
+		 * Benchmark kernel: xorshift32, BENCHMARK_ROUNDS times per index.
+		 * @param param uint32_t output array
+		 * @param begin First index.
+		 * @param end One past the last index.
+		 */
+		static void xorshiftRange(void *param, unsigned int begin, unsigned int end)
+		{
+			uint32_t *const out = static_cast<uint32_t*>(param);
+			for (unsigned int i = begin; i < end; i++) {
+				uint32_t x = i + 1;
+				for (unsigned int j = BENCHMARK_ROUNDS; j > 0; j--) {
+					x ^= x << 13;
+					x ^= x >> 17;
+					x ^= x << 5;
+				}
+				out[i] = x;
+			}
+		}
+
+		/**
+		 * Run the parallelFor() benchmark.
+		 * @param maxThreads Maximum number of threads. (0 for no limit)
+		 */
+		static void parallelForBenchmark(unsigned int maxThreads);
+};
+
+ThreadPool *ThreadPoolTest::pool = nullptr;
+
+/**
+ * Run the parallelFor() benchmark.
+ * @param maxThreads Maximum number of threads. (0 for no limit)
+ */
+void ThreadPoolTest::parallelForBenchmark(unsigned int maxThreads)
+{
+	// NOTE: Using the shared pool, since it's sized for this system.
+	ThreadPool *const sharedPool = ThreadPool::instance();
+	vector<uint32_t> out(BENCHMARK_COUNT);
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		sharedPool->parallelFor(xorshiftRange, out.data(), 0, BENCHMARK_COUNT, 0, maxThreads);
+	}
+
+	// Verify a few results against the single-threaded kernel.
+	uint32_t expected[4];
+	xorshiftRange(expected, 0, 4);
+	for (unsigned int i = 0; i < 4; i++) {
+		EXPECT_EQ(expected[i], out[i]);
+	}
+}
+
+/**
+ * The shared thread pool should have at least one thread.
+ */
+TEST_F(ThreadPoolTest, instance)
+{
+	ThreadPool *const sharedPool = ThreadPool::instance();
+	ASSERT_TRUE(sharedPool != nullptr);
+	EXPECT_EQ(sharedPool, ThreadPool::instance());
+	EXPECT_GE(sharedPool->threadCount(), 1U);
+	EXPECT_LE(sharedPool->threadCount(), static_cast<unsigned int>(ThreadPool::MAX_THREADS));
+}
+
+/**
+ * run() should call the task function once per index.
+ */
+TEST_F(ThreadPoolTest, run)
+{
+	Counters c(INDEX_COUNT);
+	pool->run(countTask, &c, INDEX_COUNT);
+	EXPECT_EQ(static_cast<int>(INDEX_COUNT), c.calls);
+	EXPECT_EQ(0U, c.errors());
+}
+
+/**
+ * run() with a thread limit.
+ */
+TEST_F(ThreadPoolTest, runMaxThreads)
+{
+	for (unsigned int maxThreads = 1; maxThreads <= 4; maxThreads++) {
+		Counters c(INDEX_COUNT);
+		pool->run(countTask, &c, INDEX_COUNT, maxThreads);
+		EXPECT_EQ(static_cast<int>(INDEX_COUNT), c.calls) << "maxThreads == " << maxThreads;
+		EXPECT_EQ(0U, c.errors()) << "maxThreads == " << maxThreads;
+	}
+}
+
+/**
+ * Nested task for runNested.
+ * Each index runs another task, which must run on the calling thread.
+ * @param param Counters array (64 entries)
+ * @param index Index
+ */
+static void nestedTask(void *param, unsigned int index)
+{
+	ThreadPoolTest::Counters *const c = static_cast<ThreadPoolTest::Counters*>(param);
+	ThreadPoolTest::pool->run(ThreadPoolTest::countTask, &c[index], 100);
+}
+
+/**
+ * run() from a task should run on the calling thread.
+ */
+TEST_F(ThreadPoolTest, runNested)
+{
+	vector<Counters> c(64, Counters(100));
+	pool->run(nestedTask, c.data(), static_cast<unsigned int>(c.size()));
+	for (size_t i = 0; i < c.size(); i++) {
+		EXPECT_EQ(100, c[i].calls) << "index == " << i;
+		EXPECT_EQ(0U, c[i].errors()) << "index == " << i;
+	}
+}
+
+/**
+ * parallelFor() should cover the whole range exactly once.
+ */
+TEST_F(ThreadPoolTest, parallelFor)
+{
+	static const struct {
+		unsigned int begin;
+		unsigned int end;
+		unsigned int grainSize;
+	} ranges[] = {
+		{0, INDEX_COUNT, 0},
+		{0, INDEX_COUNT, 1},
+		{0, INDEX_COUNT, 7},
+		{0, INDEX_COUNT, INDEX_COUNT},
+		{0, INDEX_COUNT, INDEX_COUNT * 2},
+		{123, INDEX_COUNT - 45, 0},
+		{123, INDEX_COUNT - 45, 64},
+		{INDEX_COUNT - 1, INDEX_COUNT, 0},
+		{0, 3, 0},
+	};
+
+	for (size_t i = 0; i < sizeof(ranges)/sizeof(ranges[0]); i++) {
+		Counters c(INDEX_COUNT);
+		pool->parallelFor(countRange, &c,
+			ranges[i].begin, ranges[i].end, ranges[i].grainSize);
+
+		unsigned int errors = 0;
+		for (unsigned int j = 0; j < INDEX_COUNT; j++) {
+			const int expected = (j >= ranges[i].begin && j < ranges[i].end) ? 1 : 0;
+			if (c.counters[j] != expected) {
+				errors++;
+			}
+		}
+		EXPECT_EQ(0U, errors) << "range index == " << i;
+
+		if (ranges[i].grainSize != 0) {
+			const unsigned int total = ranges[i].end - ranges[i].begin;
+			const unsigned int chunks = (total + ranges[i].grainSize - 1) / ranges[i].grainSize;
+			EXPECT_EQ(static_cast<int>(chunks), c.calls) << "range index == " << i;
+		}
+	}
+}
+
+/**
+ * parallelFor() with an empty range shouldn't call the range function.
+ */
+TEST_F(ThreadPoolTest, parallelForEmpty)
+{
+	Counters c(1);
+	pool->parallelFor(countRange, &c, 0, 0);
+	EXPECT_EQ(0, c.calls);
+}
+
+/**
+ * submit() and wait() should run every job once.
+ */
+TEST_F(ThreadPoolTest, submit)
+{
+	volatile int count = 0;
+	vector<ThreadPool::Future*> futures;
+	futures.reserve(JOB_COUNT);
+	for (unsigned int i = 0; i < JOB_COUNT; i++) {
+		futures.push_back(pool->submit(countJob, const_cast<int*>(&count)));
+	}
+	for (auto iter = futures.begin(); iter != futures.end(); ++iter) {
+		pool->wait(*iter);
+	}
+	EXPECT_EQ(static_cast<int>(JOB_COUNT), count);
+}
+
+/**
+ * Blocking job for waitRunsQueuedJob.
+ * Spins until *param is non-zero.
+ * @param param int flag
+ */
+static void blockingJob(void *param)
+{
+	volatile int *const flag = static_cast<volatile int*>(param);
+	while (ATOMIC_OR_FETCH(flag, 0) == 0) {
+		// Spin.
+	}
+}
+
+/**
+ * wait() should run a job on the calling thread
+ * if it hasn't been started yet.
+ */
+TEST_F(ThreadPoolTest, waitRunsQueuedJob)
+{
+	unique_ptr<ThreadPool> pool1(new ThreadPool(1));
+	if (pool1->threadCount() < 2) {
+		// Unable to create a worker thread.
+		return;
+	}
+
+	// Block the only worker.
+	volatile int flag = 0;
+	ThreadPool::Future *const blocker = pool1->submit(blockingJob, const_cast<int*>(&flag));
+
+	// This job can't be started by the worker,
+	// so wait() has to run it.
+	volatile int count = 0;
+	ThreadPool::Future *const future = pool1->submit(countJob, const_cast<int*>(&count));
+	pool1->wait(future);
+	EXPECT_EQ(1, count);
+	EXPECT_FALSE(pool1->isReady(blocker));
+
+	// Release the worker.
+	ATOMIC_EXCHANGE(&flag, 1);
+	pool1->wait(blocker);
+}
+
+/**
+ * Job for jobRunsTask.
+ * @param param Counters
+ */
+static void runTaskJob(void *param)
+{
+	ThreadPoolTest::pool->run(ThreadPoolTest::countTask, param, ThreadPoolTest::INDEX_COUNT);
+}
+
+/**
+ * run() from a job shouldn't deadlock.
+ */
+TEST_F(ThreadPoolTest, jobRunsTask)
+{
+	vector<Counters> c(8, Counters(INDEX_COUNT));
+	vector<ThreadPool::Future*> futures;
+	for (size_t i = 0; i < c.size(); i++) {
+		futures.push_back(pool->submit(runTaskJob, &c[i]));
+	}
+	for (size_t i = 0; i < c.size(); i++) {
+		pool->wait(futures[i]);
+		EXPECT_EQ(static_cast<int>(INDEX_COUNT), c[i].calls) << "job == " << i;
+		EXPECT_EQ(0U, c[i].errors()) << "job == " << i;
+	}
+}
+
+/**
+ * A pool with no workers should run everything on the calling thread.
+ */
+TEST_F(ThreadPoolTest, noWorkers)
+{
+	ThreadPool pool0(0);
+	EXPECT_EQ(1U, pool0.threadCount());
+
+	Counters c(INDEX_COUNT);
+	pool0.run(countTask, &c, INDEX_COUNT);
+	EXPECT_EQ(0U, c.errors());
+
+	volatile int count = 0;
+	ThreadPool::Future *const future = pool0.submit(countJob, const_cast<int*>(&count));
+	EXPECT_TRUE(pool0.isReady(future));
+	EXPECT_EQ(1, count);
+	pool0.wait(future);
+}
+
+/**
+ * Private pools should shut down cleanly,
+ * including immediately after they're created.
+ */
+TEST_F(ThreadPoolTest, shutdown)
+{
+	for (unsigned int i = 0; i < 32; i++) {
+		ThreadPool *const tmpPool = new ThreadPool(i % 4);
+		if (i & 1) {
+			Counters c(1000);
+			tmpPool->run(countTask, &c, 1000);
+			EXPECT_EQ(0U, c.errors());
+
+			volatile int count = 0;
+			ThreadPool::Future *const future = tmpPool->submit(countJob, const_cast<int*>(&count));
+			tmpPool->wait(future);
+			EXPECT_EQ(1, count);
+		}
+		delete tmpPool;
+	}
+}
+
+/** Benchmarks **/
+
+// parallelFor() scaling benchmark.
+// Compare the times for each thread count.
+TEST_F(ThreadPoolTest, parallelFor_1thread_benchmark)
+{
+	parallelForBenchmark(1);
+}
+
+TEST_F(ThreadPoolTest, parallelFor_2threads_benchmark)
+{
+	parallelForBenchmark(2);
+}
+
+TEST_F(ThreadPoolTest, parallelFor_4threads_benchmark)
+{
+	parallelForBenchmark(4);
+}
+
+TEST_F(ThreadPoolTest, parallelFor_8threads_benchmark)
+{
+	parallelForBenchmark(8);
+}
+
+TEST_F(ThreadPoolTest, parallelFor_allThreads_benchmark)
+{
+	parallelForBenchmark(0);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpBase test suite: ThreadPool tests.\n\n");
+	fprintf(stderr, "Thread count: %u\n", LibRpBase::ThreadPool::instance()->threadCount());
+	fprintf(stderr, "Benchmark iterations: %u\n", LibRpBase::Tests::ThreadPoolTest::BENCHMARK_ITERATIONS);
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -12,23 +12,38 @@
 // C++ STL classes.
 using std::string;
 
-// cURL for network access.
-#include <curl/curl.h>
-
 namespace RpDownload {
 
 CurlDownloader::CurlDownloader()
 	: super()
+	, m_curl(nullptr)
+	, m_curlShare(nullptr)
 { }
 
 CurlDownloader::CurlDownloader(const TCHAR *url)
 	: super(url)
+	, m_curl(nullptr)
+	, m_curlShare(nullptr)
 { }
 
 CurlDownloader::CurlDownloader(const tstring &url)
 	: super(url)
+	, m_curl(nullptr)
+	, m_curlShare(nullptr)
 { }
 
+CurlDownloader::~CurlDownloader()
+{
+	// NOTE: The easy handle must be cleaned up first,
+	// since it's still attached to the share handle.
+	if (m_curl) {
+		curl_easy_cleanup(m_curl);
+	}
+	if (m_curlShare) {
+		curl_share_cleanup(m_curlShare);
+	}
+}
+
 /**
  * Internal cURL data write function.
  * @param ptr Data to write.
@@ -151,26 +166,43 @@ size_t CurlDownloader::parse_header(char *ptr, size_t size, size_t nitems, void
 }
 
 /**
- * Download the file.
- * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
+ * Initialize the cURL handles.
+ * The handles are kept across downloads so connections,
+ * DNS lookups, and TLS sessions can be reused.
+ * @param useShare If true, create a share handle.
+ * @return 0 on success; negative POSIX error code on error.
  */
-int CurlDownloader::download(void)
+int CurlDownloader::initCurl(bool useShare)
 {
-	// References:
-	// - http://stackoverflow.com/questions/1636333/download-file-using-libcurl-in-c-c
-	// - http://stackoverflow.com/a/1636415
-	// - https://curl.haxx.se/libcurl/c/curl_easy_setopt.html
+	if (m_curl) {
+		// cURL is already initialized.
+		return 0;
+	}
 
-	// Clear the previous download.
-	m_data.clear();
-	m_mtime = -1;
+	// Share handle for DNS lookups, TLS sessions, and the
+	// connection cache. rp-download is single-threaded,
+	// so no locking functions are needed.
+	// NOTE: If this fails, we'll continue without it.
+	if (useShare) {
+		m_curlShare = curl_share_init();
+	}
+	if (m_curlShare) {
+		curl_share_setopt(m_curlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+		curl_share_setopt(m_curlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+		// CURL_LOCK_DATA_CONNECT requires cURL 7.57.0.
+		curl_share_setopt(m_curlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif /* LIBCURL_VERSION_NUM >= 0x073900 */
+	}
 
-	// Initialize cURL.
-	CURL *curl = curl_easy_init();
-	if (!curl) {
+	m_curl = curl_easy_init();
+	if (!m_curl) {
 		// Could not initialize cURL.
 		return -ENOMEM;	// TODO: Better error?
 	}
+	if (m_curlShare) {
+		curl_easy_setopt(m_curl, CURLOPT_SHARE, m_curlShare);
+	}
 
 	// Proxy settings should be set by the calling application
 	// in the http_proxy and https_proxy variables.
@@ -178,43 +210,86 @@ int CurlDownloader::download(void)
 	// TODO: Send a HEAD request first?
 
 	// Set options for curl's "easy" mode.
-	curl_easy_setopt(curl, CURLOPT_URL, m_url.c_str());
-	curl_easy_setopt(curl, CURLOPT_NOPROGRESS, true);
+	// These options are retained for all downloads
+	// that use this handle.
+	curl_easy_setopt(m_curl, CURLOPT_NOPROGRESS, true);
 	// Fail on HTTP errors. (>= 400)
-	curl_easy_setopt(curl, CURLOPT_FAILONERROR, true);
+	curl_easy_setopt(m_curl, CURLOPT_FAILONERROR, true);
 	// Redirection is required for https://amiibo.life/nfc/%08X-%08X
 	// TODO: Limit the number of redirects?
-	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, true);
+	curl_easy_setopt(m_curl, CURLOPT_FOLLOWLOCATION, true);
 
 	// Header and data functions.
-	curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, parse_header);
-	curl_easy_setopt(curl, CURLOPT_HEADERDATA, this);
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, this);
+	curl_easy_setopt(m_curl, CURLOPT_HEADERFUNCTION, parse_header);
+	curl_easy_setopt(m_curl, CURLOPT_HEADERDATA, this);
+	curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION, write_data);
+	curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, this);
 
 	// Don't use signals. We're running as a plugin, so using
 	// signals might interfere.
-	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
+	curl_easy_setopt(m_curl, CURLOPT_NOSIGNAL, 1);
 
 	// Set timeouts to ensure we don't take forever.
 	// TODO: User configuration?
 	// - Connect timeout: 2 seconds.
 	// - Total timeout: 10 seconds.
-	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 2);
-	curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10);
+	// NOTE: The timeouts in libromdata's ExecRpDownload_*.cpp
+	// must be larger than these.
+	curl_easy_setopt(m_curl, CURLOPT_CONNECTTIMEOUT, 2);
+	curl_easy_setopt(m_curl, CURLOPT_TIMEOUT, 10);
+
+	// Keep idle connections alive between requests.
+	curl_easy_setopt(m_curl, CURLOPT_TCP_KEEPALIVE, 1L);
 
 	// Set the User-Agent.
-	curl_easy_setopt(curl, CURLOPT_USERAGENT, m_userAgent.c_str());
+	curl_easy_setopt(m_curl, CURLOPT_USERAGENT, m_userAgent.c_str());
+	return 0;
+}
+
+/**
+ * Start a download.
+ * @param useShare If true, use a share handle. (See initCurl().)
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CurlDownloader::startDownload(bool useShare)
+{
+	// References:
+	// - http://stackoverflow.com/questions/1636333/download-file-using-libcurl-in-c-c
+	// - http://stackoverflow.com/a/1636415
+	// - https://curl.haxx.se/libcurl/c/curl_easy_setopt.html
+
+	// Clear the previous download.
+	m_data.clear();
+	m_mtime = -1;
+
+	// Initialize cURL.
+	int ret = initCurl(useShare);
+	if (ret != 0) {
+		// Could not initialize cURL.
+		return ret;
+	}
+
+	// NOTE: The URL string must remain valid until
+	// the download is finished.
+	curl_easy_setopt(m_curl, CURLOPT_URL, m_url.c_str());
+	m_inProgress = true;
+	return 0;
+}
 
-	// TODO: Set the User-Agent?
-	CURLcode res = curl_easy_perform(curl);
-	curl_easy_cleanup(curl);
+/**
+ * Finish a download.
+ * @param res Result code from cURL.
+ * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
+ */
+int CurlDownloader::finishDownload(CURLcode res)
+{
+	m_inProgress = false;
 	if (res != CURLE_OK) {
 		// Error downloading the file.
 		// Check if we have an HTTP response code.
 		// NOTE: GameTDB sometimes returns nothing instead of 404...
 		long response_code = 0;
-		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+		curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &response_code);
 		if (response_code <= 0) {
 			// No HTTP response code.
 			// TODO: Return a cURL error code and/or message...
@@ -233,4 +308,56 @@ int CurlDownloader::download(void)
 	return 0;
 }
 
+/**
+ * Download the file.
+ * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
+ */
+int CurlDownloader::download(void)
+{
+	int ret = startDownload(true);
+	if (ret != 0) {
+		return ret;
+	}
+	return finishDownload(curl_easy_perform(m_curl));
+}
+
+/**
+ * Start a download using a cURL multi handle.
+ *
+ * The caller must add the returned easy handle to the multi handle,
+ * and call finishMultiDownload() when the transfer is done. The easy
+ * handle must be removed from the multi handle before this object
+ * is deleted.
+ *
+ * A share handle is not used, since the multi handle has its own
+ * connection and DNS caches.
+ *
+ * @return Easy handle, or nullptr on error.
+ */
+CURL *CurlDownloader::startMultiDownload(void)
+{
+	return (startDownload(false) == 0 ? m_curl : nullptr);
+}
+
+/**
+ * Finish a download that was started using startMultiDownload().
+ * @param res Result code from the CURLMSG_DONE message.
+ * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
+ */
+int CurlDownloader::finishMultiDownload(CURLcode res)
+{
+	return finishDownload(res);
+}
+
+/**
+ * Cancel a download that was started using startMultiDownload().
+ * The easy handle must be removed from the multi handle first.
+ */
+void CurlDownloader::cancelMultiDownload(void)
+{
+	m_inProgress = false;
+	m_data.clear();
+	m_mtime = -1;
+}
+
 }
@@ -11,6 +11,9 @@
 
 #include "IDownloader.hpp"
 
+// cURL for network access.
+#include <curl/curl.h>
+
 namespace RpDownload {
 
 class CurlDownloader : public IDownloader
@@ -19,6 +22,7 @@ class CurlDownloader : public IDownloader
 		CurlDownloader();
 		explicit CurlDownloader(const TCHAR *url);
 		explicit CurlDownloader(const std::tstring &url);
+		~CurlDownloader() final;
 
 	private:
 		typedef IDownloader super;
@@ -45,12 +49,64 @@ class CurlDownloader : public IDownloader
 		 */
 		static size_t parse_header(char *ptr, size_t size, size_t nitems, void *userdata);
 
+		/**
+		 * Initialize the cURL handles.
+		 * The handles are kept across downloads so connections,
+		 * DNS lookups, and TLS sessions can be reused.
+		 * @param useShare If true, create a share handle.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int initCurl(bool useShare);
+
+		/**
+		 * Start a download.
+		 * @param useShare If true, use a share handle. (See initCurl().)
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int startDownload(bool useShare);
+
+		/**
+		 * Finish a download.
+		 * @param res Result code from cURL.
+		 * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
+		 */
+		int finishDownload(CURLcode res);
+
 	public:
 		/**
 		 * Download the file.
 		 * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
 		 */
 		int download(void) final;
+
+		/**
+		 * Start a download using a cURL multi handle.
+		 *
+		 * The caller must add the returned easy handle to the multi handle,
+		 * and call finishMultiDownload() when the transfer is done. The easy
+		 * handle must be removed from the multi handle before this object
+		 * is deleted.
+		 *
+		 * @return Easy handle, or nullptr on error.
+		 */
+		CURL *startMultiDownload(void);
+
+		/**
+		 * Finish a download that was started using startMultiDownload().
+		 * @param res Result code from the CURLMSG_DONE message.
+		 * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
+		 */
+		int finishMultiDownload(CURLcode res);
+
+		/**
+		 * Cancel a download that was started using startMultiDownload().
+		 * The easy handle must be removed from the multi handle first.
+		 */
+		void cancelMultiDownload(void);
+
+	protected:
+		CURL *m_curl;		// Easy handle.
+		CURLSH *m_curlShare;	// Share handle.
 };
 
 }
@@ -0,0 +1,170 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rp-download)                      *
+ * CurlMultiDownloader.cpp: libcurl-based concurrent file downloader.      *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "CurlMultiDownloader.hpp"
+
+// C++ STL classes.
+#include <vector>
+using std::vector;
+
+namespace RpDownload {
+
+CurlMultiDownloader::CurlMultiDownloader()
+	: m_multi(nullptr)
+	, m_maxHostConnections(DEFAULT_MAX_HOST_CONNECTIONS)
+{ }
+
+CurlMultiDownloader::~CurlMultiDownloader()
+{
+	if (m_multi) {
+		curl_multi_cleanup(m_multi);
+	}
+}
+
+/**
+ * Get the maximum number of simultaneous connections per host.
+ * @return Maximum number of connections per host.
+ */
+unsigned int CurlMultiDownloader::maxHostConnections(void) const
+{
+	return m_maxHostConnections;
+}
+
+/**
+ * Set the maximum number of simultaneous connections per host.
+ * Downloads over this limit are queued.
+ * @param maxHostConnections Maximum number of connections per host. (0 == unlimited)
+ */
+void CurlMultiDownloader::setMaxHostConnections(unsigned int maxHostConnections)
+{
+	m_maxHostConnections = maxHostConnections;
+	if (m_multi) {
+		curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+			static_cast<long>(m_maxHostConnections));
+	}
+}
+
+/**
+ * Download files concurrently, in priority order.
+ *
+ * All downloads are started at once, subject to the per-host
+ * connection limit. Once a download has succeeded and all
+ * higher-priority downloads have failed, the remaining downloads
+ * are cancelled.
+ *
+ * Connections are kept in the multi handle's connection cache,
+ * so they can be reused by later calls.
+ *
+ * @param downloaders	[in] CurlDownloaders with URLs set, in priority order.
+ * @param results	[out] Results: 0 on success; negative POSIX error code, positive HTTP status code on error. (-ECANCELED if cancelled)
+ * @param count		[in] Number of downloaders.
+ * @return Index of the first successful download in priority order, or -1 if none succeeded.
+ */
+int CurlMultiDownloader::downloadFirst(CurlDownloader *const *downloaders, int *results, unsigned int count)
+{
+	assert(downloaders != nullptr);
+	assert(results != nullptr);
+
+	if (!m_multi) {
+		m_multi = curl_multi_init();
+		if (!m_multi) {
+			// Could not initialize cURL.
+			for (unsigned int i = 0; i < count; i++) {
+				results[i] = -ENOMEM;	// TODO: Better error?
+			}
+			return -1;
+		}
+		curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+			static_cast<long>(m_maxHostConnections));
+	}
+
+	// Start all downloads.
+	// cURL queues downloads over the per-host connection limit.
+	vector<CURL*> handles(count, nullptr);
+	unsigned int active = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		CURL *const curl = downloaders[i]->startMultiDownload();
+		if (!curl) {
+			// Could not initialize cURL.
+			results[i] = -ENOMEM;	// TODO: Better error?
+			continue;
+		}
+		if (curl_multi_add_handle(m_multi, curl) != CURLM_OK) {
+			downloaders[i]->cancelMultiDownload();
+			results[i] = -EIO;
+			continue;
+		}
+		handles[i] = curl;
+		active++;
+	}
+
+	int first = -1;
+	while (active > 0) {
+		int running = 0;
+		curl_multi_perform(m_multi, &running);
+
+		// Check for completed downloads.
+		CURLMsg *msg;
+		int msgs_in_queue;
+		while ((msg = curl_multi_info_read(m_multi, &msgs_in_queue)) != nullptr) {
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+
+			for (unsigned int i = 0; i < count; i++) {
+				if (handles[i] != msg->easy_handle)
+					continue;
+
+				// NOTE: msg is invalid after the handle is removed.
+				const CURLcode res = msg->data.result;
+				curl_multi_remove_handle(m_multi, handles[i]);
+				handles[i] = nullptr;
+				active--;
+				results[i] = downloaders[i]->finishMultiDownload(res);
+				break;
+			}
+		}
+
+		// Check if the first successful download is known.
+		// This requires all higher-priority downloads to be finished.
+		for (unsigned int i = 0; i < count; i++) {
+			if (handles[i] != nullptr) {
+				// Still downloading.
+				break;
+			} else if (results[i] == 0) {
+				// Found the first successful download.
+				first = static_cast<int>(i);
+				break;
+			}
+		}
+
+		if (first >= 0) {
+			// Cancel the remaining downloads.
+			for (unsigned int i = first + 1; i < count; i++) {
+				if (!handles[i])
+					continue;
+				curl_multi_remove_handle(m_multi, handles[i]);
+				handles[i] = nullptr;
+				downloaders[i]->cancelMultiDownload();
+				results[i] = -ECANCELED;
+			}
+			break;
+		}
+
+		if (active > 0) {
+			// Wait for activity.
+			// NOTE: Using curl_multi_wait() instead of curl_multi_poll(),
+			// since the latter requires cURL 7.66.0.
+			curl_multi_wait(m_multi, nullptr, 0, 1000, nullptr);
+		}
+	}
+
+	return first;
+}
+
+}
@@ -0,0 +1,68 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rp-download)                      *
+ * CurlMultiDownloader.hpp: libcurl-based concurrent file downloader.      *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_RP_DOWNLOAD_CURLMULTIDOWNLOADER_HPP__
+#define __ROMPROPERTIES_RP_DOWNLOAD_CURLMULTIDOWNLOADER_HPP__
+
+#include "CurlDownloader.hpp"
+
+namespace RpDownload {
+
+class CurlMultiDownloader
+{
+	public:
+		CurlMultiDownloader();
+		~CurlMultiDownloader();
+
+	private:
+		RP_DISABLE_COPY(CurlMultiDownloader)
+
+	public:
+		// Default maximum number of simultaneous connections per host.
+		static const unsigned int DEFAULT_MAX_HOST_CONNECTIONS = 2;
+
+		/**
+		 * Get the maximum number of simultaneous connections per host.
+		 * @return Maximum number of connections per host.
+		 */
+		unsigned int maxHostConnections(void) const;
+
+		/**
+		 * Set the maximum number of simultaneous connections per host.
+		 * Downloads over this limit are queued.
+		 * @param maxHostConnections Maximum number of connections per host. (0 == unlimited)
+		 */
+		void setMaxHostConnections(unsigned int maxHostConnections);
+
+	public:
+		/**
+		 * Download files concurrently, in priority order.
+		 *
+		 * All downloads are started at once, subject to the per-host
+		 * connection limit. Once a download has succeeded and all
+		 * higher-priority downloads have failed, the remaining downloads
+		 * are cancelled.
+		 *
+		 * Connections are kept in the multi handle's connection cache,
+		 * so they can be reused by later calls.
+		 *
+		 * @param downloaders	[in] CurlDownloaders with URLs set, in priority order.
+		 * @param results	[out] Results: 0 on success; negative POSIX error code, positive HTTP status code on error. (-ECANCELED if cancelled)
+		 * @param count		[in] Number of downloaders.
+		 * @return Index of the first successful download in priority order, or -1 if none succeeded.
+		 */
+		int downloadFirst(CurlDownloader *const *downloaders, int *results, unsigned int count);
+
+	protected:
+		CURLM *m_multi;
+		unsigned int m_maxHostConnections;
+};
+
+}
+
+#endif /* __ROMPROPERTIES_RP_DOWNLOAD_CURLMULTIDOWNLOADER_HPP__ */
@@ -15,6 +15,7 @@
 // C includes.
 #ifndef _WIN32
 # include <fcntl.h>
+# include <poll.h>
 # include <sys/stat.h>
 # include <unistd.h>
 #endif /* _WIN32 */
@@ -65,6 +66,7 @@ using std::unique_ptr;
 # include "WinInetDownloader.hpp"
 #else
 # include "CurlDownloader.hpp"
+# include "CurlMultiDownloader.hpp"
 #endif
 #include "SetFileOriginInfo.hpp"
 using namespace RpDownload;
@@ -75,12 +77,26 @@ using namespace RpDownload;
 static const TCHAR *argv0 = nullptr;
 static bool verbose = false;
 
+// Maximum download size.
+// TODO: Configure this somewhere?
+static const size_t MAX_DOWNLOAD_SIZE = 4*1024*1024;
+
+#ifndef _WIN32
+// Server mode: Exit if no requests are received within this many seconds.
+static const int SERVER_IDLE_TIMEOUT = 60;
+// Server mode: Maximum number of cache keys per request.
+static const unsigned int SERVER_MAX_KEYS = 16;
+#endif /* !_WIN32 */
+
 /**
  * Show command usage.
  */
 static void show_usage(void)
 {
 	_ftprintf(stderr, _T("Syntax: %s [-v] cache_key\n"), argv0);
+#ifndef _WIN32
+	_ftprintf(stderr, _T("        %s [-v] --server [max_host_connections]\n"), argv0);
+#endif /* !_WIN32 */
 }
 
 /**
@@ -262,143 +278,24 @@ int rmkdir(const tstring &path)
 }
 
 /**
- * rp-download: Download an image from a supported online database.
- * @param cache_key Cache key, e.g. "ds/cover/US/ADAE.png"
- * @return 0 on success; non-zero on error.
- *
- * TODO:
- * - More error codes based on the error.
+ * Cache key status, as determined by check_cache_key().
  */
-int RP_C_API _tmain(int argc, TCHAR *argv[])
-{
-	// Create a downloader based on OS:
-	// - Linux: CurlDownloader
-	// - Windows: WinInetDownloader
-
-	// Syntax: rp-download cache_key
-	// Example: rp-download ds/coverM/US/ADAE.png
-
-	// If http_proxy or https_proxy are set, they will be used
-	// by the downloader code if supported.
-
-	// Reduce process integrity, if available.
-	rp_secure_reduce_integrity();
-
-	// Set OS-specific security options.
-	rp_secure_param_t param;
-#if defined(_WIN32)
-	param.bHighSec = FALSE;
-#elif defined(HAVE_SECCOMP)
-	static const int syscall_wl[] = {
-		// Syscalls used by rp-download.
-		// TODO: Add more syscalls.
-		// FIXME: glibc-2.31 uses 64-bit time syscalls that may not be
-		// defined in earlier versions, including Ubuntu 14.04.
-
-		// NOTE: Special case for clone(). If it's the first syscall
-		// in the list, it has a parameter restriction added that
-		// ensures it can only be used to create threads.
-		SCMP_SYS(clone),
-		// Other multi-threading syscalls
-		SCMP_SYS(set_robust_list),
-
-		SCMP_SYS(access), SCMP_SYS(clock_gettime),
-#if defined(__SNR_clock_gettime64) || defined(__NR_clock_gettime64)
-		SCMP_SYS(clock_gettime64),
-#endif /* __SNR_clock_gettime64 || __NR_clock_gettime64 */
-		SCMP_SYS(close),
-		SCMP_SYS(fcntl), SCMP_SYS(fcntl64),
-		SCMP_SYS(fsetxattr),
-		SCMP_SYS(fstat),     SCMP_SYS(fstat64),		// __GI___fxstat() [printf()]
-		SCMP_SYS(fstatat64), SCMP_SYS(newfstatat),	// Ubuntu 19.10 (32-bit)
-		SCMP_SYS(futex),
-		SCMP_SYS(getdents), SCMP_SYS(getdents64),
-		SCMP_SYS(getrusage),
-		SCMP_SYS(gettimeofday),	// 32-bit only?
-		SCMP_SYS(getuid),
-		SCMP_SYS(lseek), SCMP_SYS(_llseek),
-		//SCMP_SYS(lstat), SCMP_SYS(lstat64),	// Not sure if used?
-		SCMP_SYS(mkdir), SCMP_SYS(mmap), SCMP_SYS(mmap2),
-		SCMP_SYS(munmap),
-		SCMP_SYS(open),		// Ubuntu 16.04
-		SCMP_SYS(openat),	// glibc-2.31
-#if defined(__SNR_openat2) || defined(__NR_openat2)
-		SCMP_SYS(openat2),	// Linux 5.6
-#endif /* __SNR_openat2 || __NR_openat2 */
-		SCMP_SYS(poll), SCMP_SYS(select),
-		SCMP_SYS(stat), SCMP_SYS(stat64),
-		SCMP_SYS(utimensat),
-
-#if defined(__SNR_statx) || defined(__NR_statx)
-		SCMP_SYS(getcwd),	// called by glibc's statx()
-		SCMP_SYS(statx),
-#endif /* __SNR_statx || __NR_statx */
-
-		// glibc ncsd
-		// TODO: Restrict connect() to AF_UNIX.
-		SCMP_SYS(connect), SCMP_SYS(recvmsg), SCMP_SYS(sendto),
-		SCMP_SYS(sendmmsg),	// getaddrinfo() (32-bit only?)
-		SCMP_SYS(ioctl),	// getaddrinfo() (32-bit only?) [FIXME: Filter for FIONREAD]
-		SCMP_SYS(recvfrom),	// getaddrinfo() (32-bit only?)
-
-		// cURL and OpenSSL
-		SCMP_SYS(bind),		// getaddrinfo() [curl_thread_create_thunk(), curl-7.68.0]
-#ifdef __SNR_getrandom
-		SCMP_SYS(getrandom),
-#endif /* __SNR_getrandom */
-		SCMP_SYS(getpeername), SCMP_SYS(getsockname),
-		SCMP_SYS(getsockopt), SCMP_SYS(madvise), SCMP_SYS(mprotect),
-		SCMP_SYS(setsockopt), SCMP_SYS(socket),
-		SCMP_SYS(socketcall),	// FIXME: Enhanced filtering? [cURL+GnuTLS only?]
-		SCMP_SYS(socketpair), SCMP_SYS(sysinfo),
-
-		-1	// End of whitelist
-	};
-	param.syscall_wl = syscall_wl;
-#elif defined(HAVE_PLEDGE)
-	// Promises:
-	// - stdio: General stdio functionality.
-	// - rpath: Read from ~/.config/rom-properties/ and ~/.cache/rom-properties/
-	// - wpath: Write to ~/.cache/rom-properties/
-	// - cpath: Create ~/.cache/rom-properties/ if it doesn't exist.
-	// - inet: Internet access.
-	// - fattr: Modify file attributes, e.g. mtime.
-	// - dns: Resolve hostnames.
-	// - getpw: Get user's home directory if HOME is empty.
-	param.promises = "stdio rpath wpath cpath inet fattr dns getpw";
-#elif defined(HAVE_TAME)
-	// NOTE: stdio includes fattr, e.g. utimes().
-	param.tame_flags = TAME_STDIO | TAME_RPATH | TAME_WPATH | TAME_CPATH |
-	                   TAME_INET | TAME_DNS | TAME_GETPW;
-#else
-	param.dummy = 0;
-#endif
-	rp_secure_enable(param);
-
-	// Store argv[0] globally.
-	argv0 = argv[0];
-
-	const TCHAR *cache_key = argv[1];
-	if (argc < 2) {
-		// TODO: Add a verbose option to print messages.
-		// Normally, the only output is a return value.
-		show_usage();
-		return EXIT_FAILURE;
-	}
-
-	// Check for "-v" or "--verbose".
-	if (!_tcscmp(argv[1], _T("-v")) || !_tcscmp(argv[1], _T("--verbose"))) {
-		// Verbose mode is enabled.
-		verbose = true;
-		// We need at least three parameters now.
-		if (argc < 3) {
-			show_error(_T("No cache key specified."));
-			show_usage();
-			return EXIT_FAILURE;
-		}
-		cache_key = argv[2];
-	}
+enum CacheKeyStatus {
+	CKS_ERROR	= -1,	// Invalid cache key, or negative cache entry.
+	CKS_DOWNLOAD	= 0,	// File needs to be downloaded.
+	CKS_CACHED	= 1,	// File is already cached.
+};
 
+/**
+ * Check a cache key, and determine its URL and cache filename.
+ * If the file needs to be downloaded, the cache directory is created.
+ * @param cache_key		[in] Cache key, e.g. "ds/cover/US/ADAE.png"
+ * @param full_url		[out] Full URL.
+ * @param cache_filename	[out] Cache filename.
+ * @return CacheKeyStatus
+ */
+static CacheKeyStatus check_cache_key(const TCHAR *cache_key, TCHAR (&full_url)[256], tstring &cache_filename)
+{
 	// Check the cache key prefix. The prefix indicates the system
 	// and identifies the online database used.
 	// [key] indicates the cache key without the prefix.
@@ -417,14 +314,14 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 		// - Does not contain any slashes.
 		// - First slash is either the first or the last character.
 		SHOW_ERROR(_T("Cache key '%s' is invalid."), cache_key);
-		return EXIT_FAILURE;
+		return CKS_ERROR;
 	}
 
 	const ptrdiff_t prefix_len = (slash_pos - cache_key);
 	if (prefix_len <= 0) {
 		// Empty prefix.
 		SHOW_ERROR(_T("Cache key '%s' is invalid."), cache_key);
-		return EXIT_FAILURE;
+		return CKS_ERROR;
 	}
 
 	// Cache key must include a lowercase file extension.
@@ -432,18 +329,17 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 	if (!lastdot) {
 		// No dot...
 		SHOW_ERROR(_T("Cache key '%s' is invalid."), cache_key);
-		return EXIT_FAILURE;
+		return CKS_ERROR;
 	}
 	if (_tcscmp(lastdot, _T(".png")) != 0 &&
 	    _tcscmp(lastdot, _T(".jpg")) != 0)
 	{
 		// Not a supported file extension.
 		SHOW_ERROR(_T("Cache key '%s' is invalid."), cache_key);
-		return EXIT_FAILURE;
+		return CKS_ERROR;
 	}
 
 	// Determine the full URL based on the cache key.
-	TCHAR full_url[256];
 	if ((prefix_len == 3 && !_tcsncmp(cache_key, _T("wii"), 3)) ||
 	    (prefix_len == 4 && !_tcsncmp(cache_key, _T("wiiu"), 4)) ||
 	    (prefix_len == 3 && !_tcsncmp(cache_key, _T("3ds"), 3)) ||
@@ -459,7 +355,7 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 		if (filename_len <= 4) {
 			// Can't remove the extension...
 			SHOW_ERROR(_T("Cache key '%s' is invalid."), cache_key);
-			return EXIT_FAILURE;
+			return CKS_ERROR;
 		}
 		filename_len -= 4;
 
@@ -474,19 +370,35 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 	} else {
 		// Prefix is not supported.
 		SHOW_ERROR(_T("Cache key '%s' has an unsupported prefix."), cache_key);
-		return EXIT_FAILURE;
+		return CKS_ERROR;
+	}
+
+#ifdef RP_DOWNLOAD_TEST_HOOKS
+	// Base URL override for testing with a local HTTP server.
+	// The scheme and hostname are replaced with this value.
+	// NOTE: This is only available in rp-download-test,
+	// which is built for the test suite and isn't installed.
+	const TCHAR *const base_url = _tgetenv(_T("RP_DOWNLOAD_BASE_URL"));
+	if (base_url && base_url[0] != _T('\0')) {
+		const TCHAR *const path = _tcschr(full_url + 8, _T('/'));
+		if (path) {
+			TCHAR test_url[_countof(full_url)];
+			_sntprintf(test_url, _countof(test_url), _T("%s%s"), base_url, path);
+			memcpy(full_url, test_url, sizeof(full_url));
+		}
 	}
+#endif /* RP_DOWNLOAD_TEST_HOOKS */
 
 	if (verbose) {
 		_ftprintf(stderr, _T("URL: %s\n"), full_url);
 	}
 
 	// Get the cache filename.
-	tstring cache_filename = LibCacheCommon::getCacheFilename(cache_key);
+	cache_filename = LibCacheCommon::getCacheFilename(cache_key);
 	if (cache_filename.empty()) {
 		// Invalid cache filename.
 		SHOW_ERROR(_T("Cache key '%s' is invalid."), cache_key);
-		return EXIT_FAILURE;
+		return CKS_ERROR;
 	}
 	if (verbose) {
 		_ftprintf(stderr, _T("Cache Filename: %s\n"), cache_filename.c_str());
@@ -516,20 +428,20 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 			if ((systime - filemtime) < (86400*7)) {
 				// Less than a week old.
 				SHOW_ERROR(_T("Negative cache file for '%s' has not expired; not redownloading."), cache_key);
-				return EXIT_FAILURE;
+				return CKS_ERROR;
 			}
 
 			// More than a week old.
 			// Delete the cache file and try to download it again.
 			if (_tremove(cache_filename.c_str()) != 0) {
 				SHOW_ERROR(_T("Error deleting negative cache file for '%s': %s"), cache_key, _tcserror(errno));
-				return EXIT_FAILURE;
+				return CKS_ERROR;
 			}
 		} else if (filesize > 0) {
 			// File is larger than 0 bytes, which indicates
 			// it was previously cached successfully
 			SHOW_ERROR(_T("Cache file for '%s' is already downloaded."), cache_key);
-			return EXIT_SUCCESS;
+			return CKS_CACHED;
 		}
 	} else if (ret == -ENOENT) {
 		// File not found. We'll need to download it.
@@ -537,24 +449,31 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 		int ret = rmkdir(cache_filename.c_str());
 		if (ret != 0) {
 			SHOW_ERROR(_T("Error creating directory structure: %s"), _tcserror(-ret));
-			return EXIT_FAILURE;
+			return CKS_ERROR;
 		}
 	} else {
 		// Other error.
 		SHOW_ERROR(_T("Error checking cache file for '%s': %s"), cache_key, _tcserror(-ret));
-		return EXIT_FAILURE;
+		return CKS_ERROR;
 	}
 
-	// Attempt to download the file.
-	// TODO: IDownloaderFactory?
-#ifdef _WIN32
-	unique_ptr<IDownloader> m_downloader(new WinInetDownloader());
-#else /* !_WIN32 */
-	unique_ptr<IDownloader> m_downloader(new CurlDownloader());
-#endif /* _WIN32 */
+	// File needs to be downloaded.
+	return CKS_DOWNLOAD;
+}
 
-	// Open the cache file now so we can use it as a negative hit
-	// if the download fails.
+/**
+ * Write a downloaded file to the cache.
+ * If the download failed, an empty file is written as a negative cache entry.
+ * @param cache_filename	[in] Cache filename.
+ * @param full_url		[in] Full URL.
+ * @param downloader		[in] IDownloader
+ * @param ret			[in] Return value from the download.
+ * @return EXIT_SUCCESS on success; EXIT_FAILURE on error.
+ */
+static int write_cache_file(const tstring &cache_filename, const TCHAR *full_url, const IDownloader *downloader, int ret)
+{
+	// Open the cache file.
+	// If the download failed, the empty file is used as a negative hit.
 	FILE *f_out = _tfopen(cache_filename.c_str(), _T("wb"));
 	if (!f_out) {
 		// Error opening the cache file.
@@ -562,17 +481,12 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 		return EXIT_FAILURE;
 	}
 
-	// TODO: Configure this somewhere?
-	m_downloader->setMaxSize(4*1024*1024);
-
-	m_downloader->setUrl(full_url);
-	ret = m_downloader->download();
 	if (ret != 0) {
 		// Error downloading the file.
 		if (verbose) {
 			if (ret < 0) {
 				// POSIX error code
-				show_error(_T("Error downloading file: %s"), _tcserror(errno));
+				show_error(_T("Error downloading file: %s"), _tcserror(-ret));
 			} else /*if (ret > 0)*/ {
 				// HTTP status code
 				const TCHAR *msg = http_status_string(ret);
@@ -587,7 +501,7 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 		return EXIT_FAILURE;
 	}
 
-	if (m_downloader->dataSize() <= 0) {
+	if (downloader->dataSize() <= 0) {
 		// No data downloaded...
 		SHOW_ERROR(_T("Error downloading file: 0 bytes received"));
 		fclose(f_out);
@@ -596,18 +510,419 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 
 	// Write the file to the cache.
 	// TODO: Verify the size.
-	size_t size = fwrite(m_downloader->data(), 1, m_downloader->dataSize(), f_out);
+	fwrite(downloader->data(), 1, downloader->dataSize(), f_out);
 
 	// Save the file origin information.
 #ifdef _WIN32
 	// TODO: Figure out how to setFileOriginInfo() on Windows
 	// using an open file handle.
-	setFileOriginInfo(f_out, cache_filename.c_str(), full_url, m_downloader->mtime());
+	setFileOriginInfo(f_out, cache_filename.c_str(), full_url, downloader->mtime());
 #else /* !_WIN32 */
-	setFileOriginInfo(f_out, full_url, m_downloader->mtime());
+	setFileOriginInfo(f_out, full_url, downloader->mtime());
 #endif /* _WIN32 */
 	fclose(f_out);
 
 	// Success.
 	return EXIT_SUCCESS;
 }
+
+/**
+ * Download a file from a supported online database to the cache.
+ * @param downloader IDownloader
+ * @param cache_key Cache key, e.g. "ds/cover/US/ADAE.png"
+ * @return EXIT_SUCCESS on success; EXIT_FAILURE on error.
+ */
+static int download_cache_key(IDownloader *downloader, const TCHAR *cache_key)
+{
+	TCHAR full_url[256];
+	tstring cache_filename;
+	switch (check_cache_key(cache_key, full_url, cache_filename)) {
+		case CKS_DOWNLOAD:
+			break;
+		case CKS_CACHED:
+			return EXIT_SUCCESS;
+		case CKS_ERROR:
+		default:
+			return EXIT_FAILURE;
+	}
+
+	downloader->setUrl(full_url);
+	const int ret = downloader->download();
+	return write_cache_file(cache_filename, full_url, downloader, ret);
+}
+
+#ifndef _WIN32
+/**
+ * Write a server mode response to stdout.
+ * @param response Response, including the trailing newline.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+static int server_write_response(const std::string &response)
+{
+	const char *p = response.data();
+	size_t len = response.size();
+	while (len > 0) {
+		ssize_t sz = write(STDOUT_FILENO, p, len);
+		if (sz < 0) {
+			if (errno == EINTR)
+				continue;
+			// Write error. The client probably went away.
+			return -EIO;
+		}
+		p += sz;
+		len -= sz;
+	}
+	return 0;
+}
+
+/**
+ * Server mode: Process a request.
+ *
+ * The request contains one or more cache keys, in priority order.
+ * The files are downloaded concurrently, and once the first available
+ * file in priority order is known, the remaining downloads are cancelled.
+ *
+ * The response contains one status character per cache key:
+ * - '0': File was downloaded, or was already cached.
+ * - '1': File could not be downloaded.
+ * - '2': File was not needed, since a higher-priority file is available.
+ *
+ * @param multi		[in] CurlMultiDownloader
+ * @param request	[in] Request: Cache keys, separated by tabs.
+ * @param response	[out] Response, without the trailing newline.
+ */
+static void server_process_request(CurlMultiDownloader *multi, char *request, std::string &response)
+{
+	// Count the cache keys.
+	unsigned int count = 1;
+	for (const char *p = request; (p = strchr(p, '\t')) != nullptr; p++) {
+		count++;
+	}
+	if (count > SERVER_MAX_KEYS) {
+		// Too many cache keys.
+		SHOW_ERROR(_T("Too many cache keys in request."));
+		response.assign(count, '1');
+		return;
+	}
+
+	// Split the request into cache keys.
+	const char *cache_keys[SERVER_MAX_KEYS];
+	char *p = request;
+	for (unsigned int i = 0; i < count; i++) {
+		cache_keys[i] = p;
+		char *const tab = strchr(p, '\t');
+		if (tab) {
+			*tab = '\0';
+			p = tab + 1;
+		}
+	}
+
+	// Check the cache keys.
+	// Cache keys after the first one that's already cached aren't needed.
+	response.assign(count, '2');
+	TCHAR full_urls[SERVER_MAX_KEYS][256];
+	tstring cache_filenames[SERVER_MAX_KEYS];
+	unique_ptr<CurlDownloader> downloaders[SERVER_MAX_KEYS];
+	CurlDownloader *dl_ptrs[SERVER_MAX_KEYS];
+	unsigned int dl_idx[SERVER_MAX_KEYS];
+	unsigned int dl_count = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		const CacheKeyStatus cks = check_cache_key(cache_keys[i], full_urls[i], cache_filenames[i]);
+		if (cks == CKS_CACHED) {
+			response[i] = '0';
+			break;
+		} else if (cks != CKS_DOWNLOAD) {
+			response[i] = '1';
+			continue;
+		}
+
+		CurlDownloader *const downloader = new CurlDownloader(full_urls[i]);
+		downloader->setMaxSize(MAX_DOWNLOAD_SIZE);
+		downloaders[i].reset(downloader);
+		dl_ptrs[dl_count] = downloader;
+		dl_idx[dl_count] = i;
+		dl_count++;
+	}
+	if (dl_count == 0) {
+		// Nothing to download.
+		return;
+	}
+
+	// Download the files.
+	int results[SERVER_MAX_KEYS];
+	multi->downloadFirst(dl_ptrs, results, dl_count);
+	for (unsigned int j = 0; j < dl_count; j++) {
+		if (results[j] == -ECANCELED) {
+			// Download was cancelled.
+			continue;
+		}
+		const unsigned int i = dl_idx[j];
+		const int status = write_cache_file(cache_filenames[i], full_urls[i], dl_ptrs[j], results[j]);
+		response[i] = (status == EXIT_SUCCESS ? '0' : '1');
+	}
+}
+
+/**
+ * Server mode: Download cache keys read from stdin.
+ *
+ * Each request is a tab-separated list of cache keys in priority
+ * order, terminated by '\n'. Each response is one status character
+ * per cache key, terminated by '\n', written to stdout in the same
+ * order as the requests. See server_process_request().
+ *
+ * Network connections are kept open between requests.
+ *
+ * The server exits when stdin is closed, or if no requests
+ * are received within SERVER_IDLE_TIMEOUT seconds.
+ *
+ * @param multi CurlMultiDownloader
+ * @return EXIT_SUCCESS on success; EXIT_FAILURE on error.
+ */
+static int run_server(CurlMultiDownloader *multi)
+{
+	// Request buffer.
+	// Requests are always much shorter than this.
+	char buf[4096];
+	size_t len = 0;
+	bool discard = false;	// Discarding an overlong request.
+	std::string response;
+
+	for (;;) {
+		char *const nl = static_cast<char*>(memchr(buf, '\n', len));
+		if (!nl) {
+			// No complete request. Read more data.
+			if (len == sizeof(buf)) {
+				// Request is too long. Discard it.
+				discard = true;
+				len = 0;
+			}
+
+			struct pollfd pfd;
+			pfd.fd = STDIN_FILENO;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			int ret = poll(&pfd, 1, SERVER_IDLE_TIMEOUT * 1000);
+			if (ret == 0) {
+				// Idle timeout.
+				SHOW_ERROR(_T("Idle timeout; exiting."));
+				break;
+			} else if (ret < 0) {
+				if (errno == EINTR)
+					continue;
+				return EXIT_FAILURE;
+			}
+
+			ssize_t sz = read(STDIN_FILENO, &buf[len], sizeof(buf) - len);
+			if (sz == 0) {
+				// EOF. The client closed the connection.
+				break;
+			} else if (sz < 0) {
+				if (errno == EINTR)
+					continue;
+				return EXIT_FAILURE;
+			}
+			len += sz;
+			continue;
+		}
+
+		// Process the request.
+		*nl = '\0';
+		if (nl > buf && nl[-1] == '\r') {
+			nl[-1] = '\0';
+		}
+		if (!discard) {
+			server_process_request(multi, buf, response);
+		} else {
+			// NOTE: The number of cache keys is unknown,
+			// so the client will treat this as an error.
+			SHOW_ERROR(_T("Request is too long."));
+			response.clear();
+			discard = false;
+		}
+		response += '\n';
+		if (server_write_response(response) != 0) {
+			return EXIT_FAILURE;
+		}
+
+		// Remove the request from the buffer.
+		const size_t req_len = (nl - buf) + 1;
+		len -= req_len;
+		memmove(buf, &buf[req_len], len);
+	}
+
+	return EXIT_SUCCESS;
+}
+#endif /* !_WIN32 */
+
+/**
+ * rp-download: Download an image from a supported online database.
+ * @param cache_key Cache key, e.g. "ds/cover/US/ADAE.png"
+ * @return 0 on success; non-zero on error.
+ *
+ * If "--server" is specified instead of a cache key, cache keys
+ * will be read from stdin until it's closed. See run_server().
+ *
+ * TODO:
+ * - More error codes based on the error.
+ */
+int RP_C_API _tmain(int argc, TCHAR *argv[])
+{
+	// Create a downloader based on OS:
+	// - Linux: CurlDownloader
+	// - Windows: WinInetDownloader
+
+	// Syntax: rp-download cache_key
+	// Example: rp-download ds/coverM/US/ADAE.png
+	// Server mode: rp-download --server
+
+	// If http_proxy or https_proxy are set, they will be used
+	// by the downloader code if supported.
+
+	// Reduce process integrity, if available.
+	rp_secure_reduce_integrity();
+
+	// Set OS-specific security options.
+	rp_secure_param_t param;
+#if defined(_WIN32)
+	param.bHighSec = FALSE;
+#elif defined(HAVE_SECCOMP)
+	static const int syscall_wl[] = {
+		// Syscalls used by rp-download.
+		// TODO: Add more syscalls.
+		// FIXME: glibc-2.31 uses 64-bit time syscalls that may not be
+		// defined in earlier versions, including Ubuntu 14.04.
+
+		// NOTE: Special case for clone(). If it's the first syscall
+		// in the list, it has a parameter restriction added that
+		// ensures it can only be used to create threads.
+		SCMP_SYS(clone),
+		// Other multi-threading syscalls
+		SCMP_SYS(set_robust_list),
+
+		SCMP_SYS(access), SCMP_SYS(clock_gettime),
+#if defined(__SNR_clock_gettime64) || defined(__NR_clock_gettime64)
+		SCMP_SYS(clock_gettime64),
+#endif /* __SNR_clock_gettime64 || __NR_clock_gettime64 */
+		SCMP_SYS(close),
+		SCMP_SYS(fcntl), SCMP_SYS(fcntl64),
+		SCMP_SYS(fsetxattr),
+		SCMP_SYS(fstat),     SCMP_SYS(fstat64),		// __GI___fxstat() [printf()]
+		SCMP_SYS(fstatat64), SCMP_SYS(newfstatat),	// Ubuntu 19.10 (32-bit)
+		SCMP_SYS(futex),
+		SCMP_SYS(getdents), SCMP_SYS(getdents64),
+		SCMP_SYS(getrusage),
+		SCMP_SYS(gettimeofday),	// 32-bit only?
+		SCMP_SYS(getuid),
+		SCMP_SYS(lseek), SCMP_SYS(_llseek),
+		//SCMP_SYS(lstat), SCMP_SYS(lstat64),	// Not sure if used?
+		SCMP_SYS(mkdir), SCMP_SYS(mmap), SCMP_SYS(mmap2),
+		SCMP_SYS(munmap),
+		SCMP_SYS(open),		// Ubuntu 16.04
+		SCMP_SYS(openat),	// glibc-2.31
+#if defined(__SNR_openat2) || defined(__NR_openat2)
+		SCMP_SYS(openat2),	// Linux 5.6
+#endif /* __SNR_openat2 || __NR_openat2 */
+		SCMP_SYS(poll), SCMP_SYS(select),
+		SCMP_SYS(stat), SCMP_SYS(stat64),
+		SCMP_SYS(utimensat),
+
+#if defined(__SNR_statx) || defined(__NR_statx)
+		SCMP_SYS(getcwd),	// called by glibc's statx()
+		SCMP_SYS(statx),
+#endif /* __SNR_statx || __NR_statx */
+
+		// glibc ncsd
+		// TODO: Restrict connect() to AF_UNIX.
+		SCMP_SYS(connect), SCMP_SYS(recvmsg), SCMP_SYS(sendto),
+		SCMP_SYS(sendmmsg),	// getaddrinfo() (32-bit only?)
+		SCMP_SYS(ioctl),	// getaddrinfo() (32-bit only?) [FIXME: Filter for FIONREAD]
+		SCMP_SYS(recvfrom),	// getaddrinfo() (32-bit only?)
+
+		// cURL and OpenSSL
+		SCMP_SYS(bind),		// getaddrinfo() [curl_thread_create_thunk(), curl-7.68.0]
+#ifdef __SNR_getrandom
+		SCMP_SYS(getrandom),
+#endif /* __SNR_getrandom */
+		SCMP_SYS(getpeername), SCMP_SYS(getsockname),
+		SCMP_SYS(getsockopt), SCMP_SYS(madvise), SCMP_SYS(mprotect),
+		SCMP_SYS(setsockopt), SCMP_SYS(socket),
+		SCMP_SYS(socketcall),	// FIXME: Enhanced filtering? [cURL+GnuTLS only?]
+		SCMP_SYS(socketpair), SCMP_SYS(sysinfo),
+
+		-1	// End of whitelist
+	};
+	param.syscall_wl = syscall_wl;
+#elif defined(HAVE_PLEDGE)
+	// Promises:
+	// - stdio: General stdio functionality.
+	// - rpath: Read from ~/.config/rom-properties/ and ~/.cache/rom-properties/
+	// - wpath: Write to ~/.cache/rom-properties/
+	// - cpath: Create ~/.cache/rom-properties/ if it doesn't exist.
+	// - inet: Internet access.
+	// - fattr: Modify file attributes, e.g. mtime.
+	// - dns: Resolve hostnames.
+	// - getpw: Get user's home directory if HOME is empty.
+	param.promises = "stdio rpath wpath cpath inet fattr dns getpw";
+#elif defined(HAVE_TAME)
+	// NOTE: stdio includes fattr, e.g. utimes().
+	param.tame_flags = TAME_STDIO | TAME_RPATH | TAME_WPATH | TAME_CPATH |
+	                   TAME_INET | TAME_DNS | TAME_GETPW;
+#else
+	param.dummy = 0;
+#endif
+	rp_secure_enable(param);
+
+	// Store argv[0] globally.
+	argv0 = argv[0];
+
+	if (argc < 2) {
+		// TODO: Add a verbose option to print messages.
+		// Normally, the only output is a return value.
+		show_usage();
+		return EXIT_FAILURE;
+	}
+
+	// Check for "-v" or "--verbose".
+	int argidx = 1;
+	if (!_tcscmp(argv[argidx], _T("-v")) || !_tcscmp(argv[argidx], _T("--verbose"))) {
+		// Verbose mode is enabled.
+		verbose = true;
+		argidx++;
+		// We need at least three parameters now.
+		if (argc < 3) {
+			show_error(_T("No cache key specified."));
+			show_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+#ifndef _WIN32
+	// Check for "-s" or "--server".
+	if (!_tcscmp(argv[argidx], _T("-s")) || !_tcscmp(argv[argidx], _T("--server"))) {
+		CurlMultiDownloader multi;
+		if (argidx + 1 < argc) {
+			// Maximum number of connections per host.
+			char *endptr = nullptr;
+			const unsigned long maxHostConnections = strtoul(argv[argidx + 1], &endptr, 10);
+			if (*endptr != '\0' || maxHostConnections > 64) {
+				show_error(_T("Invalid maximum number of connections per host: %s"), argv[argidx + 1]);
+				show_usage();
+				return EXIT_FAILURE;
+			}
+			multi.setMaxHostConnections(static_cast<unsigned int>(maxHostConnections));
+		}
+		return run_server(&multi);
+	}
+#endif /* !_WIN32 */
+
+	// Create a downloader.
+	// TODO: IDownloaderFactory?
+#ifdef _WIN32
+	unique_ptr<IDownloader> downloader(new WinInetDownloader());
+#else /* !_WIN32 */
+	unique_ptr<IDownloader> downloader(new CurlDownloader());
+#endif /* _WIN32 */
+	downloader->setMaxSize(MAX_DOWNLOAD_SIZE);
+
+	return download_cache_key(downloader.get(), argv[argidx]);
+}
@@ -0,0 +1,682 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rp-download/tests)                *
+ * RpDownloadServerTest.cpp: rp-download server mode test.                 *
+ *                                                                         *
+ * Copyright (c) 2020 by David Korth.                                      *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// ExecRpDownload (POSIX)
+// NOTE: RP_DOWNLOAD_TEST_HOOKS and RP_DOWNLOAD_TEST_EXE are set by CMake,
+// so rp-download-test is run instead of the installed rp-download.
+// CacheManager is linked from libromdata. Since this file defines the
+// CacheManager::execRpDownload*() functions, the versions in libromdata
+// aren't linked, so CacheManager uses rp-download-test, too.
+#include "libromdata/img/ExecRpDownload_posix.cpp"
+
+// OS-specific includes.
+#include <arpa/inet.h>
+#include <ftw.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+// C++ includes.
+#include <map>
+using std::map;
+
+namespace LibRomData { namespace Tests {
+
+/**
+ * Minimal HTTP/1.1 server for the rp-download test.
+ *
+ * Listens on 127.0.0.1 using an ephemeral port. Requests are handled
+ * on a single thread using poll(). Keep-alive connections are supported,
+ * since rp-download reuses its connections.
+ */
+class TestHttpServer
+{
+	public:
+		TestHttpServer()
+			: m_listen_fd(-1)
+			, m_port(0)
+			, m_thread_started(false)
+		{
+			m_wake_fd[0] = -1;
+			m_wake_fd[1] = -1;
+		}
+
+		~TestHttpServer()
+		{
+			stop();
+		}
+
+	private:
+		RP_DISABLE_COPY(TestHttpServer)
+
+	public:
+		/**
+		 * Add a file to the server.
+		 * @param path Path, e.g. "/ds/cover/US/AAAE.png".
+		 * @param status HTTP status code.
+		 * @param delay_ms Delay before sending the response, in milliseconds.
+		 */
+		void addFile(const string &path, int status, int delay_ms = 0)
+		{
+			MutexLocker locker(m_mutex);
+			File &file = m_files[path];
+			file.status = status;
+			file.delay_ms = delay_ms;
+			file.requests = 0;
+		}
+
+		/**
+		 * Get the contents of a file on the server.
+		 * @param path Path.
+		 * @return File contents.
+		 */
+		static string fileData(const string &path)
+		{
+			// PNG magic, followed by the path.
+			return string("\x89PNG\r\n\x1A\n", 8) + path;
+		}
+
+		/**
+		 * Get the number of requests received for a file.
+		 * @param path Path.
+		 * @return Number of requests.
+		 */
+		unsigned int requestCount(const string &path)
+		{
+			MutexLocker locker(m_mutex);
+			auto iter = m_files.find(path);
+			return (iter != m_files.end() ? iter->second.requests : 0);
+		}
+
+		/**
+		 * Get the base URL of the server.
+		 * @return Base URL, e.g. "http://127.0.0.1:12345".
+		 */
+		string baseUrl(void) const
+		{
+			char buf[32];
+			snprintf(buf, sizeof(buf), "http://127.0.0.1:%u", m_port);
+			return string(buf);
+		}
+
+		/**
+		 * Start the server.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int start(void)
+		{
+			if (pipe(m_wake_fd) != 0) {
+				return -errno;
+			}
+
+			m_listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+			if (m_listen_fd < 0) {
+				return -errno;
+			}
+			int optval = 1;
+			setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+
+			struct sockaddr_in addr;
+			memset(&addr, 0, sizeof(addr));
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			addr.sin_port = 0;
+			socklen_t addrlen = sizeof(addr);
+			if (bind(m_listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+			    listen(m_listen_fd, 16) != 0 ||
+			    getsockname(m_listen_fd, reinterpret_cast<struct sockaddr*>(&addr), &addrlen) != 0)
+			{
+				return -errno;
+			}
+			m_port = ntohs(addr.sin_port);
+
+			int ret = pthread_create(&m_thread, nullptr, thread_func, this);
+			if (ret != 0) {
+				return -ret;
+			}
+			m_thread_started = true;
+			return 0;
+		}
+
+		/**
+		 * Stop the server.
+		 */
+		void stop(void)
+		{
+			if (m_thread_started) {
+				// Wake up the server thread.
+				const char c = 0;
+				while (write(m_wake_fd[1], &c, 1) < 0 && errno == EINTR) { }
+				pthread_join(m_thread, nullptr);
+				m_thread_started = false;
+			}
+			if (m_listen_fd >= 0) {
+				close(m_listen_fd);
+				m_listen_fd = -1;
+			}
+			for (int &fd : m_wake_fd) {
+				if (fd >= 0) {
+					close(fd);
+					fd = -1;
+				}
+			}
+		}
+
+	private:
+		struct File {
+			int status;
+			int delay_ms;
+			unsigned int requests;
+		};
+
+		struct Conn {
+			int fd;
+			string inbuf;		// Received data
+			string response;	// Pending response
+			int64_t respond_at;	// Time to send the pending response, or -1 if none
+		};
+
+		static void *thread_func(void *param)
+		{
+			static_cast<TestHttpServer*>(param)->run();
+			return nullptr;
+		}
+
+		/**
+		 * Handle a complete request, if one has been received.
+		 * @param conn Connection.
+		 */
+		void handleRequest(Conn &conn)
+		{
+			const size_t hdr_end = conn.inbuf.find("\r\n\r\n");
+			if (hdr_end == string::npos) {
+				// Request isn't complete yet.
+				return;
+			}
+
+			// Request line: "GET /path HTTP/1.1"
+			string path;
+			const size_t sp1 = conn.inbuf.find(' ');
+			const size_t sp2 = (sp1 != string::npos ? conn.inbuf.find(' ', sp1 + 1) : string::npos);
+			if (sp2 != string::npos && sp2 < hdr_end) {
+				path = conn.inbuf.substr(sp1 + 1, sp2 - sp1 - 1);
+			}
+			conn.inbuf.erase(0, hdr_end + 4);
+
+			int status = 404;
+			int delay_ms = 0;
+			{
+				MutexLocker locker(m_mutex);
+				auto iter = m_files.find(path);
+				if (iter != m_files.end()) {
+					status = iter->second.status;
+					delay_ms = iter->second.delay_ms;
+					iter->second.requests++;
+				}
+			}
+
+			char hdr[128];
+			if (status == 200) {
+				const string data = fileData(path);
+				snprintf(hdr, sizeof(hdr),
+					"HTTP/1.1 200 OK\r\n"
+					"Content-Type: image/png\r\n"
+					"Content-Length: %u\r\n\r\n",
+					static_cast<unsigned int>(data.size()));
+				conn.response = hdr + data;
+			} else {
+				snprintf(hdr, sizeof(hdr),
+					"HTTP/1.1 %d Error\r\n"
+					"Content-Length: 0\r\n\r\n", status);
+				conn.response = hdr;
+			}
+			conn.respond_at = getTimeMs() + delay_ms;
+		}
+
+		/**
+		 * Server thread.
+		 */
+		void run(void)
+		{
+			vector<Conn> conns;
+			for (;;) {
+				// Send pending responses that are due.
+				const int64_t now = getTimeMs();
+				int timeout = -1;
+				for (auto iter = conns.begin(); iter != conns.end(); ) {
+					Conn &conn = *iter;
+					if (conn.respond_at >= 0 && conn.respond_at <= now) {
+						const ssize_t sz = send(conn.fd, conn.response.data(), conn.response.size(), MSG_NOSIGNAL);
+						conn.respond_at = -1;
+						if (sz != static_cast<ssize_t>(conn.response.size())) {
+							// Client went away, e.g. the download was cancelled.
+							close(conn.fd);
+							iter = conns.erase(iter);
+							continue;
+						}
+						// Check for another request on this connection.
+						handleRequest(conn);
+					}
+					if (conn.respond_at >= 0) {
+						const int conn_timeout = static_cast<int>(conn.respond_at - now);
+						if (timeout < 0 || conn_timeout < timeout) {
+							timeout = (conn_timeout > 0 ? conn_timeout : 0);
+						}
+					}
+					++iter;
+				}
+
+				vector<struct pollfd> pfds(conns.size() + 2);
+				pfds[0].fd = m_wake_fd[0];
+				pfds[1].fd = m_listen_fd;
+				for (size_t i = 0; i < conns.size(); i++) {
+					pfds[i + 2].fd = conns[i].fd;
+				}
+				for (struct pollfd &pfd : pfds) {
+					pfd.events = POLLIN;
+					pfd.revents = 0;
+				}
+				int ret = poll(pfds.data(), pfds.size(), timeout);
+				if (ret < 0) {
+					if (errno == EINTR)
+						continue;
+					break;
+				}
+
+				if (pfds[0].revents) {
+					// Server is stopping.
+					break;
+				}
+
+				// Check the connections in reverse order,
+				// since closed connections are removed.
+				for (size_t i = conns.size(); i > 0; i--) {
+					if (!pfds[i + 1].revents)
+						continue;
+					Conn &conn = conns[i - 1];
+					char buf[1024];
+					const ssize_t sz = recv(conn.fd, buf, sizeof(buf), 0);
+					if (sz <= 0) {
+						// Connection closed.
+						close(conn.fd);
+						conns.erase(conns.begin() + (i - 1));
+						continue;
+					}
+					conn.inbuf.append(buf, sz);
+					if (conn.respond_at < 0) {
+						handleRequest(conn);
+					}
+				}
+
+				if (pfds[1].revents) {
+					// New connection.
+					const int fd = accept(m_listen_fd, nullptr, nullptr);
+					if (fd >= 0) {
+						Conn conn;
+						conn.fd = fd;
+						conn.respond_at = -1;
+						conns.push_back(std::move(conn));
+					}
+				}
+			}
+
+			for (const Conn &conn : conns) {
+				close(conn.fd);
+			}
+		}
+
+	private:
+		int m_listen_fd;
+		int m_wake_fd[2];
+		unsigned int m_port;
+		pthread_t m_thread;
+		bool m_thread_started;
+
+		Mutex m_mutex;
+		map<string, File> m_files;
+};
+
+class RpDownloadServerTest : public ::testing::Test
+{
+	protected:
+		RpDownloadServerTest() = default;
+
+	public:
+		static void SetUpTestCase(void);
+		static void TearDownTestCase(void);
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+	public:
+		/**
+		 * Get the cache filename for a cache key.
+		 * @param cache_key Cache key.
+		 * @return Cache filename.
+		 */
+		static string cacheFilename(const string &cache_key)
+		{
+			return home + "/.cache/rom-properties/" + cache_key;
+		}
+
+		/**
+		 * Get the process ID of the running rp-download server.
+		 * @return Process ID, or -1 if no server is running.
+		 */
+		static pid_t serverPid(void)
+		{
+			for (const RpDownloadServer &s : rpDownloadServers) {
+				if (s.pid > 0) {
+					return s.pid;
+				}
+			}
+			return -1;
+		}
+
+	public:
+		TestHttpServer m_http;
+
+		// Temporary home directory.
+		// NOTE: The cache directory is only determined once,
+		// so this is shared by all tests. Each test uses
+		// different cache keys.
+		static string home;
+};
+
+string RpDownloadServerTest::home;
+
+/**
+ * CacheManager with recordLatency() made public.
+ */
+class LatencyTestCacheManager : public CacheManager
+{
+	public:
+		using CacheManager::recordLatency;
+};
+
+/**
+ * Remove a file or directory. (nftw() callback)
+ */
+static int remove_fn(const char *fpath, const struct stat *sb, int typeflag, struct FTW *ftwbuf)
+{
+	RP_UNUSED(sb);
+	RP_UNUSED(typeflag);
+	RP_UNUSED(ftwbuf);
+	return remove(fpath);
+}
+
+/**
+ * SetUpTestCase() function.
+ * Run before all tests.
+ */
+void RpDownloadServerTest::SetUpTestCase(void)
+{
+	// rp-download and CacheManager write to $HOME/.cache/rom-properties/,
+	// so use a temporary home directory.
+	const char *tmpdir = getenv("TMPDIR");
+	if (!tmpdir || tmpdir[0] == '\0') {
+		tmpdir = "/tmp";
+	}
+	string tmpl = string(tmpdir) + "/rpdl_test_XXXXXX";
+	if (!mkdtemp(&tmpl[0])) {
+		return;
+	}
+	home = tmpl;
+	setenv("HOME", home.c_str(), 1);
+	unsetenv("XDG_CACHE_HOME");
+	unsetenv("XDG_CONFIG_HOME");
+
+	// Don't use a proxy for the local HTTP server.
+	unsetenv("http_proxy");
+	unsetenv("https_proxy");
+}
+
+/**
+ * TearDownTestCase() function.
+ * Run after all tests.
+ */
+void RpDownloadServerTest::TearDownTestCase(void)
+{
+	if (!home.empty()) {
+		nftw(home.c_str(), remove_fn, 16, FTW_DEPTH | FTW_PHYS);
+		home.clear();
+	}
+}
+
+/**
+ * SetUp() function.
+ * Run before each test.
+ */
+void RpDownloadServerTest::SetUp(void)
+{
+	ASSERT_FALSE(home.empty()) << "Unable to create a temporary home directory.";
+	ASSERT_EQ(0, m_http.start());
+	ASSERT_EQ(0, setenv("RP_DOWNLOAD_BASE_URL", m_http.baseUrl().c_str(), 1));
+}
+
+/**
+ * TearDown() function.
+ * Run after each test.
+ */
+void RpDownloadServerTest::TearDown(void)
+{
+	// Stop rp-download. It will be started with
+	// the new HTTP server's URL by the next test.
+	for (RpDownloadServer &s : rpDownloadServers) {
+		s.stop(false);
+	}
+	m_http.stop();
+}
+
+/**
+ * Check the response for each cache key:
+ * - '0': Downloaded, or already cached.
+ * - '1': Not available.
+ * - '2': Not needed, since a higher-priority file is available.
+ */
+TEST_F(RpDownloadServerTest, responsePerKey)
+{
+	m_http.addFile("/ds/cover/US/AAAE.png", 404);
+	m_http.addFile("/ds/cover/US/BBBE.png", 200);
+	m_http.addFile("/ds/cover/US/CCCE.png", 200, 5000);
+
+	vector<string> cacheKeys;
+	cacheKeys.push_back("ds/cover/US/AAAE.png");
+	cacheKeys.push_back("ds/cover/US/BBBE.png");
+	cacheKeys.push_back("ds/cover/US/CCCE.png");
+
+	string results;
+	ASSERT_EQ(0, rpDownloadServerRequest(cacheKeys, string(), 4, results));
+	EXPECT_EQ("102", results);
+
+	// The downloaded file should be in the cache.
+	// The missing file should have a negative cache entry.
+	// The cancelled file shouldn't be in the cache.
+	struct stat sb;
+	ASSERT_EQ(0, stat(cacheFilename(cacheKeys[1]).c_str(), &sb));
+	EXPECT_EQ(static_cast<off_t>(TestHttpServer::fileData("/ds/cover/US/BBBE.png").size()), sb.st_size);
+	ASSERT_EQ(0, stat(cacheFilename(cacheKeys[0]).c_str(), &sb));
+	EXPECT_EQ(0, sb.st_size);
+	EXPECT_NE(0, stat(cacheFilename(cacheKeys[2]).c_str(), &sb));
+
+	// Request the same cache keys again.
+	// The negative cache entry hasn't expired, and the
+	// downloaded file is cached, so nothing is downloaded.
+	ASSERT_EQ(0, rpDownloadServerRequest(cacheKeys, string(), 4, results));
+	EXPECT_EQ("102", results);
+	EXPECT_EQ(1U, m_http.requestCount("/ds/cover/US/AAAE.png"));
+	EXPECT_EQ(1U, m_http.requestCount("/ds/cover/US/BBBE.png"));
+}
+
+/**
+ * The first successful cache key in priority order wins,
+ * even if a lower-priority download finishes first.
+ */
+TEST_F(RpDownloadServerTest, firstSuccessInPriorityOrder)
+{
+	m_http.addFile("/ds/cover/US/PAAE.png", 404, 300);
+	m_http.addFile("/ds/cover/US/PBBE.png", 200, 600);
+	m_http.addFile("/ds/cover/US/PCCE.png", 200);
+	m_http.addFile("/ds/cover/US/PDDE.png", 200, 5000);
+
+	vector<string> cacheKeys;
+	cacheKeys.push_back("ds/cover/US/PAAE.png");
+	cacheKeys.push_back("ds/cover/US/PBBE.png");
+	cacheKeys.push_back("ds/cover/US/PCCE.png");
+	cacheKeys.push_back("ds/cover/US/PDDE.png");
+
+	// PBBE is the first available file in priority order.
+	// PCCE finished before PBBE, so it's also cached.
+	// PDDE is cancelled once PBBE has been downloaded.
+	string results;
+	ASSERT_EQ(0, rpDownloadServerRequest(cacheKeys, string(), 4, results));
+	EXPECT_EQ("1002", results);
+	EXPECT_EQ(1U, results.find('0'));
+}
+
+/**
+ * rp-download is restarted if it exits between requests.
+ */
+TEST_F(RpDownloadServerTest, restartAfterEPIPE)
+{
+	m_http.addFile("/ds/cover/US/RAAE.png", 200);
+	m_http.addFile("/ds/cover/US/RBBE.png", 200);
+
+	vector<string> cacheKeys(1, "ds/cover/US/RAAE.png");
+	string results;
+	ASSERT_EQ(0, rpDownloadServerRequest(cacheKeys, string(), 2, results));
+	EXPECT_EQ("0", results);
+
+	// Kill rp-download. The next request will get EPIPE.
+	const pid_t pid1 = serverPid();
+	ASSERT_GT(pid1, 0);
+	ASSERT_EQ(0, kill(pid1, SIGKILL));
+
+	cacheKeys[0] = "ds/cover/US/RBBE.png";
+	ASSERT_EQ(0, rpDownloadServerRequest(cacheKeys, string(), 2, results));
+	EXPECT_EQ("0", results);
+	EXPECT_EQ(1U, m_http.requestCount("/ds/cover/US/RBBE.png"));
+
+	// A new rp-download process should be running,
+	// and the old one should have been reaped.
+	const pid_t pid2 = serverPid();
+	EXPECT_GT(pid2, 0);
+	EXPECT_NE(pid1, pid2);
+	int wstatus;
+	EXPECT_EQ(-1, waitpid(pid1, &wstatus, WNOHANG));
+	EXPECT_EQ(ECHILD, errno);
+}
+
+/**
+ * Latency histogram buckets.
+ */
+TEST_F(RpDownloadServerTest, latencyHistogramBuckets)
+{
+	LatencyTestCacheManager::resetLatencyHistograms();
+	LatencyTestCacheManager::recordLatency(CacheManager::RT_DOWNLOAD, 0, true);
+	LatencyTestCacheManager::recordLatency(CacheManager::RT_DOWNLOAD, 1, true);
+	LatencyTestCacheManager::recordLatency(CacheManager::RT_DOWNLOAD, 1000, false);
+	LatencyTestCacheManager::recordLatency(CacheManager::RT_DOWNLOAD, 100000, true);
+
+	CacheManager::LatencyHistogram hist;
+	CacheManager::getLatencyHistogram(CacheManager::RT_DOWNLOAD, &hist);
+	EXPECT_EQ(1U, hist.buckets[0]);		// 0 ms
+	EXPECT_EQ(1U, hist.buckets[1]);		// 1 ms
+	EXPECT_EQ(1U, hist.buckets[10]);	// 512-1023 ms
+	EXPECT_EQ(1U, hist.buckets[15]);	// Slower requests
+	EXPECT_EQ(4U, hist.count);
+	EXPECT_EQ(1U, hist.failed);
+	EXPECT_EQ(101001U, hist.total_ms);
+	EXPECT_EQ(100000U, hist.max_ms);
+
+	// Other request types aren't affected.
+	CacheManager::getLatencyHistogram(CacheManager::RT_DOWNLOAD_FIRST, &hist);
+	EXPECT_EQ(0U, hist.count);
+
+	CacheManager::resetLatencyHistograms();
+	CacheManager::getLatencyHistogram(CacheManager::RT_DOWNLOAD, &hist);
+	EXPECT_EQ(0U, hist.count);
+	EXPECT_EQ(0U, hist.buckets[15]);
+}
+
+/**
+ * CacheManager counts requests that run rp-download
+ * in the latency histograms.
+ */
+TEST_F(RpDownloadServerTest, latencyHistogramRequests)
+{
+	m_http.addFile("/ds/cover/US/LAAE.png", 200);
+	m_http.addFile("/ds/cover/US/LBBE.png", 404);
+	m_http.addFile("/ds/cover/US/LCCE.png", 404);
+	m_http.addFile("/ds/cover/US/LDDE.png", 200);
+
+	CacheManager::resetLatencyHistograms();
+	CacheManager cache;
+	CacheManager::LatencyHistogram hist;
+
+	// download(): One successful request and one failed request.
+	// The second request for LAAE is cached, so it isn't counted.
+	EXPECT_EQ(cacheFilename("ds/cover/US/LAAE.png"), cache.download("ds/cover/US/LAAE.png"));
+	EXPECT_EQ(cacheFilename("ds/cover/US/LAAE.png"), cache.download("ds/cover/US/LAAE.png"));
+	EXPECT_EQ("", cache.download("ds/cover/US/LBBE.png"));
+	EXPECT_EQ(1U, m_http.requestCount("/ds/cover/US/LAAE.png"));
+
+	CacheManager::getLatencyHistogram(CacheManager::RT_DOWNLOAD, &hist);
+	EXPECT_EQ(2U, hist.count);
+	EXPECT_EQ(1U, hist.failed);
+	uint32_t total = 0;
+	for (uint32_t bucket : hist.buckets) {
+		total += bucket;
+	}
+	EXPECT_EQ(2U, total);
+	EXPECT_GE(hist.total_ms, static_cast<uint64_t>(hist.max_ms));
+
+	// downloadFirst(): One successful request.
+	// The second request is cached, so it isn't counted.
+	vector<CacheManager::DownloadEntry> entries(2);
+	entries[0].cache_key = "ds/cover/US/LCCE.png";
+	entries[0].cacheOnly = false;
+	entries[1].cache_key = "ds/cover/US/LDDE.png";
+	entries[1].cacheOnly = false;
+	unsigned int index = ~0U;
+	EXPECT_EQ(cacheFilename("ds/cover/US/LDDE.png"), cache.downloadFirst(entries, &index));
+	EXPECT_EQ(1U, index);
+	EXPECT_EQ(cacheFilename("ds/cover/US/LDDE.png"), cache.downloadFirst(entries, &index));
+	EXPECT_EQ(1U, m_http.requestCount("/ds/cover/US/LDDE.png"));
+
+	CacheManager::getLatencyHistogram(CacheManager::RT_DOWNLOAD_FIRST, &hist);
+	EXPECT_EQ(1U, hist.count);
+	EXPECT_EQ(0U, hist.failed);
+
+	// download() statistics are unchanged.
+	CacheManager::getLatencyHistogram(CacheManager::RT_DOWNLOAD, &hist);
+	EXPECT_EQ(2U, hist.count);
+
+	// Totals for all request types.
+	CacheManager::getTotalLatencyHistogram(&hist);
+	EXPECT_EQ(3U, hist.count);
+	EXPECT_EQ(1U, hist.failed);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+int main(int argc, char *argv[])
+{
+	fprintf(stderr, "rp-download server mode test\n\n");
+	fflush(nullptr);
+
+	// NOTE: The seccomp sandbox isn't enabled here, since
+	// rp-download-test would inherit the test's filter.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
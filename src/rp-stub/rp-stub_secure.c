@@ -95,6 +95,14 @@ int rp_stub_do_security_options(bool config)
 		SCMP_SYS(lstat), SCMP_SYS(lstat64),	// realpath() [LibRpBase::FileSystem::resolve_symlink()]
 		SCMP_SYS(readlink),	// realpath() [LibRpBase::FileSystem::resolve_symlink()]
 
+		// Multi-threading (ThreadPool: parallel image decoding)
+		// NOTE: clone() is listed below for ExecRpDownload.
+		SCMP_SYS(madvise),		// freeing thread stacks
+		SCMP_SYS(sched_getaffinity),	// sysconf(_SC_NPROCESSORS_ONLN)
+#if defined(__SNR_rseq) || defined(__NR_rseq)
+		SCMP_SYS(rseq),			// glibc-2.35
+#endif /* __SNR_rseq || __NR_rseq */
+
 		// ExecRpDownload_posix.cpp
 		// FIXME: Need to fix the clone() check in librpsecure/os-secure_linux.c.
 		SCMP_SYS(clock_nanosleep), SCMP_SYS(clone), SCMP_SYS(fork),
@@ -0,0 +1,405 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rpcli)                            *
+ * batch.cpp: Batch mode.                                                  *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "batch.hpp"
+#include "properties.hpp"
+
+// librpbase, librpfile
+#include "librpbase/RomData.hpp"
+#include "librpbase/TextFuncs.hpp"
+#include "librpfile/RpFile.hpp"
+#include "libi18n/i18n.h"
+using namespace LibRpBase;
+using LibRpFile::RpFile;
+
+// libromdata
+#include "libromdata/RomDataFactory.hpp"
+using LibRomData::RomDataFactory;
+
+// librpthreads
+#include "librpthreads/Mutex.hpp"
+#include "librpthreads/ThreadPool.hpp"
+
+#ifdef _WIN32
+# include "libwin32common/RpWin32_sdk.h"
+# include "librpbase/TextFuncs_wchar.hpp"
+#else /* !_WIN32 */
+# include <dirent.h>
+# include <sys/stat.h>
+# include <time.h>
+#endif /* _WIN32 */
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cerrno>
+
+// C++ includes.
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+using std::cerr;
+using std::cin;
+using std::cout;
+using std::endl;
+using std::ostringstream;
+using std::string;
+using std::vector;
+
+/**
+ * Get the current time from a monotonic clock.
+ * @return Time, in microseconds.
+ */
+static int64_t getTimeUs(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (count.QuadPart / freq.QuadPart * 1000000) +
+		((count.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart);
+#else /* !_WIN32 */
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (static_cast<int64_t>(ts.tv_sec) * 1000000) + (ts.tv_nsec / 1000);
+#endif /* _WIN32 */
+}
+
+/**
+ * Recursively add all files in a directory.
+ * Entries are sorted by name so the output order is consistent.
+ * Symbolic links to directories are not followed.
+ * @param files	[out] File list.
+ * @param path	[in] Directory path.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+static int addDirectory(vector<string> &files, const string &path)
+{
+	vector<string> entries;
+	vector<string> subdirs;
+
+#ifdef _WIN32
+	WIN32_FIND_DATAW ffd;
+	HANDLE hFind = FindFirstFileW(U82W_s(path + "\\*"), &ffd);
+	if (hFind == INVALID_HANDLE_VALUE) {
+		return -ENOENT;
+	}
+	do {
+		if (ffd.cFileName[0] == L'.' && (ffd.cFileName[1] == L'\0' ||
+		    (ffd.cFileName[1] == L'.' && ffd.cFileName[2] == L'\0')))
+		{
+			// "." or ".."
+			continue;
+		}
+
+		string filename = path;
+		filename += '\\';
+		filename += W2U8(ffd.cFileName);
+		if (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+			if (!(ffd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+				subdirs.emplace_back(std::move(filename));
+			}
+		} else {
+			entries.emplace_back(std::move(filename));
+		}
+	} while (FindNextFileW(hFind, &ffd));
+	FindClose(hFind);
+#else /* !_WIN32 */
+	DIR *const dir = opendir(path.c_str());
+	if (!dir) {
+		return -errno;
+	}
+	struct dirent *d;
+	while ((d = readdir(dir)) != nullptr) {
+		if (d->d_name[0] == '.' && (d->d_name[1] == '\0' ||
+		    (d->d_name[1] == '.' && d->d_name[2] == '\0')))
+		{
+			// "." or ".."
+			continue;
+		}
+
+		string filename = path;
+		if (filename.empty() || filename[filename.size()-1] != '/') {
+			filename += '/';
+		}
+		filename += d->d_name;
+
+		// NOTE: d_type might be DT_UNKNOWN on some filesystems.
+		// lstat() is used so symlinks to directories aren't followed.
+		unsigned char d_type = d->d_type;
+		if (d_type == DT_UNKNOWN || d_type == DT_LNK) {
+			struct stat sb;
+			if (lstat(filename.c_str(), &sb) != 0)
+				continue;
+			if (S_ISDIR(sb.st_mode)) {
+				d_type = DT_DIR;
+			} else if (S_ISLNK(sb.st_mode)) {
+				// Symlinks are only followed for files.
+				if (stat(filename.c_str(), &sb) != 0 || S_ISDIR(sb.st_mode))
+					continue;
+				d_type = DT_REG;
+			} else {
+				d_type = (S_ISREG(sb.st_mode) ? DT_REG : DT_UNKNOWN);
+			}
+		}
+
+		if (d_type == DT_DIR) {
+			subdirs.emplace_back(std::move(filename));
+		} else if (d_type == DT_REG) {
+			entries.emplace_back(std::move(filename));
+		}
+	}
+	closedir(dir);
+#endif /* _WIN32 */
+
+	std::sort(entries.begin(), entries.end());
+	files.insert(files.end(), entries.begin(), entries.end());
+
+	std::sort(subdirs.begin(), subdirs.end());
+	for (auto iter = subdirs.cbegin(); iter != subdirs.cend(); ++iter) {
+		addDirectory(files, *iter);
+	}
+	return 0;
+}
+
+/**
+ * Add a path to the file list.
+ * @param files	[out] File list.
+ * @param path	[in] File or directory path.
+ */
+static void addPath(vector<string> &files, const string &path)
+{
+#ifdef _WIN32
+	const DWORD dwAttrs = GetFileAttributesW(U82W_s(path));
+	const bool isDir = (dwAttrs != INVALID_FILE_ATTRIBUTES &&
+	                    (dwAttrs & FILE_ATTRIBUTE_DIRECTORY));
+#else /* !_WIN32 */
+	struct stat sb;
+	const bool isDir = (stat(path.c_str(), &sb) == 0 && S_ISDIR(sb.st_mode));
+#endif /* _WIN32 */
+
+	if (isDir) {
+		addDirectory(files, path);
+	} else {
+		// NOTE: Nonexistent files are still added so
+		// an error will be shown in the results.
+		files.push_back(path);
+	}
+}
+
+// File status.
+enum BatchStatus {
+	BATCH_OK = 0,
+	BATCH_UNSUPPORTED,
+	BATCH_OPEN_ERROR,
+};
+
+/**
+ * Batch processing state.
+ * Shared between all threads.
+ */
+struct BatchState {
+	const vector<string> *files;
+	const BatchParams *params;
+
+	// Everything below is protected by the mutex.
+	Mutex mutex;
+
+	// Results. (NDJSON lines)
+	// Only used for ordered output.
+	vector<string> results;
+	vector<uint8_t> done;
+	size_t nextOutput;	// Next result to write.
+
+	// Statistics.
+	unsigned int count[3];	// indexed by BatchStatus
+	int64_t total_time_us;
+	int64_t max_time_us;
+	size_t max_time_idx;
+};
+
+/**
+ * Write results that are ready.
+ * Must be called with the mutex held.
+ * @param state Batch state.
+ */
+static void writeResults(BatchState *state)
+{
+	const size_t count = state->files->size();
+	while (state->nextOutput < count && state->done[state->nextOutput]) {
+		string &line = state->results[state->nextOutput];
+		cout << line << '\n';
+		// Free the memory.
+		string().swap(line);
+		state->nextOutput++;
+	}
+}
+
+/**
+ * Process a single file.
+ * This may run on any thread.
+ * @param param BatchState.
+ * @param index File index.
+ */
+static void processFile(void *param, unsigned int index)
+{
+	BatchState *const state = static_cast<BatchState*>(param);
+	const string &filename = (*state->files)[index];
+
+	const int64_t start_us = getTimeUs();
+
+	BatchStatus status;
+	string rom_json;
+	int err = 0;
+	RpFile *const file = new RpFile(filename,
+		static_cast<RpFile::FileMode>(RpFile::FM_OPEN_READ_GZ_MMAP | RpFile::FM_GZIP_INDEX));
+	if (file->isOpen()) {
+		RomData *const romData = RomDataFactory::create(file);
+		if (romData && romData->isValid()) {
+			ostringstream oss;
+			oss << JSONROMOutput(romData, state->params->languageCode);
+			rom_json = oss.str();
+			// NOTE: JSONROMOutput adds newlines between some elements.
+			// Strings have all control characters escaped, so any
+			// newlines are whitespace and can be removed.
+			rom_json.erase(std::remove(rom_json.begin(), rom_json.end(), '\n'), rom_json.end());
+			status = BATCH_OK;
+		} else {
+			status = BATCH_UNSUPPORTED;
+		}
+		if (romData) {
+			romData->unref();
+		}
+	} else {
+		err = file->lastError();
+		status = BATCH_OPEN_ERROR;
+	}
+	file->unref();
+
+	const int64_t time_us = getTimeUs() - start_us;
+
+	// Build the NDJSON line.
+	ostringstream oss;
+	oss << "{\"file\":" << JSONString(filename.c_str()) << ",\"time_us\":" << time_us;
+	switch (status) {
+		case BATCH_OK:
+			oss << ",\"rom\":" << rom_json;
+			break;
+		case BATCH_UNSUPPORTED:
+			oss << ",\"error\":\"rom is not supported\"";
+			break;
+		case BATCH_OPEN_ERROR:
+		default:
+			oss << ",\"error\":\"couldn't open file\",\"code\":" << err;
+			break;
+	}
+	oss << '}';
+
+	MutexLocker locker(state->mutex);
+	state->count[status]++;
+	state->total_time_us += time_us;
+	if (time_us > state->max_time_us) {
+		state->max_time_us = time_us;
+		state->max_time_idx = index;
+	}
+
+	if (state->params->ordered) {
+		state->results[index] = oss.str();
+		state->done[index] = 1;
+		writeResults(state);
+	} else {
+		cout << oss.str() << '\n';
+	}
+}
+
+/**
+ * Process files in batch mode.
+ *
+ * Directories are scanned recursively. A path of "-" reads
+ * a newline-separated list of paths from stdin.
+ *
+ * Files are processed in parallel, and each result is written
+ * to stdout as a single line of JSON (NDJSON). A summary with
+ * timing information is written to stderr.
+ *
+ * @param paths Files and/or directories.
+ * @param params Batch parameters.
+ * @return 0 on success; non-zero if any files couldn't be opened.
+ */
+int DoBatch(const vector<const char*> &paths, const BatchParams &params)
+{
+	const int64_t start_us = getTimeUs();
+
+	// Get the list of files.
+	vector<string> files;
+	for (auto iter = paths.cbegin(); iter != paths.cend(); ++iter) {
+		if (!strcmp(*iter, "-")) {
+			// Read paths from stdin.
+			string line;
+			while (std::getline(cin, line)) {
+				if (!line.empty() && line[line.size()-1] == '\r') {
+					line.resize(line.size()-1);
+				}
+				if (!line.empty()) {
+					addPath(files, line);
+				}
+			}
+		} else {
+			addPath(files, *iter);
+		}
+	}
+
+	cerr << "== " << rp_sprintf(NC_("rpcli", "Batch mode: %u file", "Batch mode: %u files",
+		static_cast<int>(files.size())), static_cast<unsigned int>(files.size())) << endl;
+	if (files.empty()) {
+		return 0;
+	}
+
+	BatchState state;
+	state.files = &files;
+	state.params = &params;
+	if (params.ordered) {
+		state.results.resize(files.size());
+		state.done.resize(files.size());
+	}
+	state.nextOutput = 0;
+	memset(state.count, 0, sizeof(state.count));
+	state.total_time_us = 0;
+	state.max_time_us = 0;
+	state.max_time_idx = 0;
+
+	// Process the files using the shared thread pool.
+	// NOTE: If the thread pool is busy, everything is
+	// processed on the calling thread.
+	ThreadPool *const pool = ThreadPool::instance();
+	unsigned int threads = pool->threadCount();
+	if (params.threads > 0 && params.threads < threads) {
+		threads = params.threads;
+	}
+	if (threads > files.size()) {
+		threads = static_cast<unsigned int>(files.size());
+	}
+	pool->run(processFile, &state, static_cast<unsigned int>(files.size()), threads);
+	cout.flush();
+
+	// Print the summary.
+	const int64_t wall_us = getTimeUs() - start_us;
+	const double wall_s = static_cast<double>(wall_us) / 1000000.0;
+	cerr << "-- " << rp_sprintf(C_("rpcli", "Supported: %u, unsupported: %u, couldn't open: %u"),
+		state.count[BATCH_OK], state.count[BATCH_UNSUPPORTED], state.count[BATCH_OPEN_ERROR]) << endl;
+	cerr << "-- " << rp_sprintf(C_("rpcli", "Total time: %.3f s using %u thread(s) (%.1f files/s)"),
+		wall_s, threads, (wall_s > 0 ? static_cast<double>(files.size()) / wall_s : 0.0)) << endl;
+	cerr << "-- " << rp_sprintf(C_("rpcli", "Per-file time: average %.3f ms, maximum %.3f ms (%s)"),
+		static_cast<double>(state.total_time_us) / 1000.0 / static_cast<double>(files.size()),
+		static_cast<double>(state.max_time_us) / 1000.0,
+		files[state.max_time_idx].c_str()) << endl;
+
+	return (state.count[BATCH_OPEN_ERROR] > 0 ? 1 : 0);
+}
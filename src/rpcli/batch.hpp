@@ -0,0 +1,40 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rpcli)                            *
+ * batch.hpp: Batch mode.                                                  *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_RPCLI_BATCH_HPP__
+#define __ROMPROPERTIES_RPCLI_BATCH_HPP__
+
+#include <stdint.h>
+#include <vector>
+
+struct BatchParams {
+	uint32_t languageCode;	// Language code. (0 for default)
+	unsigned int threads;	// Maximum number of threads. (0 == one per CPU)
+	bool ordered;		// If true, results are written in input order.
+
+	BatchParams()
+		: languageCode(0), threads(0), ordered(true) { }
+};
+
+/**
+ * Process files in batch mode.
+ *
+ * Directories are scanned recursively. A path of "-" reads
+ * a newline-separated list of paths from stdin.
+ *
+ * Files are processed in parallel, and each result is written
+ * to stdout as a single line of JSON (NDJSON). A summary with
+ * timing information is written to stderr.
+ *
+ * @param paths Files and/or directories.
+ * @param params Batch parameters.
+ * @return 0 on success; non-zero if any files couldn't be opened.
+ */
+int DoBatch(const std::vector<const char*> &paths, const BatchParams &params);
+
+#endif /* __ROMPROPERTIES_RPCLI_BATCH_HPP__ */
@@ -723,56 +723,53 @@ public:
 	}
 };
 
-class JSONString {
-	const char* str;
-public:
-	explicit JSONString(const char* str) :str(str) {}
-	friend ostream& operator<<(ostream& os, const JSONString& js) {
-		if (!js.str) {
-			// NULL string.
-			// Treat this like an empty string.
-			return os << "\"\"";
-		}
+JSONString::JSONString(const char *str)
+	: str(str) { }
+ostream& operator<<(ostream& os, const JSONString& js) {
+	if (!js.str) {
+		// NULL string.
+		// Treat this like an empty string.
+		return os << "\"\"";
+	}
 
-		// Certain characters need to be escaped.
-		const char *str = js.str;
-		os << '"';
-		for (; *str != 0; str++) {
-			const uint8_t chr = static_cast<uint8_t>(*str);
-			if (chr < 0x20) { 
-				// Control characters need to be escaped.
-				static const char ctrl_escape_letters[0x20] = {
-					  0,   0,   0,   0,   0,   0,   0,   0,	// 0x00-0x07
-					'b', 't', 'n',   0, 'f', 'r',   0,   0,	// 0x08-0x0F
-					  0,   0,   0,   0,   0,   0,   0,   0,	// 0x10-0x17
-					  0,   0,   0,   0,   0,   0,   0,   0,	// 0x18-0x1F
-				};
-				const char letter = ctrl_escape_letters[chr];
-				if (letter != 0) {
-					// Escape character is available.
-					os << '\\' << letter;
-				} else {
-					// No escape character. Use a Unicode escape.
-					char buf[16];
-					snprintf(buf, sizeof(buf), "\\u%04X", chr);
-					os << buf;
-				}
+	// Certain characters need to be escaped.
+	const char *str = js.str;
+	os << '"';
+	for (; *str != 0; str++) {
+		const uint8_t chr = static_cast<uint8_t>(*str);
+		if (chr < 0x20) { 
+			// Control characters need to be escaped.
+			static const char ctrl_escape_letters[0x20] = {
+				  0,   0,   0,   0,   0,   0,   0,   0,	// 0x00-0x07
+				'b', 't', 'n',   0, 'f', 'r',   0,   0,	// 0x08-0x0F
+				  0,   0,   0,   0,   0,   0,   0,   0,	// 0x10-0x17
+				  0,   0,   0,   0,   0,   0,   0,   0,	// 0x18-0x1F
+			};
+			const char letter = ctrl_escape_letters[chr];
+			if (letter != 0) {
+				// Escape character is available.
+				os << '\\' << letter;
 			} else {
-				// Check for backslash and double-quotes.
-				if (chr == '\\') {
-					os << "\\\\";
-				} else if (chr == '"') {
-					os << "\\\"";
-				} else {
-					// Normal character.
-					os << static_cast<char>(chr);
-				}
+				// No escape character. Use a Unicode escape.
+				char buf[16];
+				snprintf(buf, sizeof(buf), "\\u%04X", chr);
+				os << buf;
+			}
+		} else {
+			// Check for backslash and double-quotes.
+			if (chr == '\\') {
+				os << "\\\\";
+			} else if (chr == '"') {
+				os << "\\\"";
+			} else {
+				// Normal character.
+				os << static_cast<char>(chr);
 			}
 		}
-
-		return os << '"';
 	}
-};
+
+	return os << '"';
+}
 
 class JSONFieldsOutput {
 	const RomFields& fields;
@@ -24,6 +24,13 @@ public:
 	friend std::ostream& operator<<(std::ostream& os, const ROMOutput& fo);
 };
 
+class JSONString {
+	const char *const str;
+public:
+	explicit JSONString(const char *str);
+	friend std::ostream& operator<<(std::ostream& os, const JSONString& js);
+};
+
 class JSONROMOutput {
 	const LibRpBase::RomData *const romdata;
 	uint32_t lc;
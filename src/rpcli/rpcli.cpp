@@ -12,6 +12,7 @@
 
 // OS-specific security options.
 #include "rpcli_secure.h"
+#include "librpsecure/config.librpsecure.h"
 
 // librpbase, librpcpu
 #include "librpcpu/byteswap.h"
@@ -27,12 +28,15 @@ using namespace LibRpBase;
 // librpfile
 #include "librpfile/config.librpfile.h"
 #include "librpfile/FileSystem.hpp"
+#include "librpfile/GzIndexedReader.hpp"
 #include "librpfile/RpFile.hpp"
 using namespace LibRpFile;
 
 // libromdata
 #include "libromdata/RomDataFactory.hpp"
+#include "libromdata/img/CacheMaintenance.hpp"
 using LibRomData::RomDataFactory;
+using LibRomData::CacheMaintenance;
 
 // librptexture
 #include "librptexture/img/rp_image.hpp"
@@ -44,6 +48,7 @@ using LibRpTexture::rp_image;
 #endif /* _WIN32 */
 
 #include "properties.hpp"
+#include "batch.hpp"
 #ifdef ENABLE_DECRYPTION
 # include "verifykeys.hpp"
 #endif /* ENABLE_DECRYPTION */
@@ -173,7 +178,8 @@ static void ExtractImages(const RomData *romData, vector<ExtractParam>& extract)
 static void DoFile(const char *filename, bool json, vector<ExtractParam>& extract, uint32_t languageCode = 0)
 {
 	cerr << "== " << rp_sprintf(C_("rpcli", "Reading file '%s'..."), filename) << endl;
-	RpFile *const file = new RpFile(filename, RpFile::FM_OPEN_READ_GZ);
+	RpFile *const file = new RpFile(filename,
+		static_cast<RpFile::FileMode>(RpFile::FM_OPEN_READ_GZ_MMAP | RpFile::FM_GZIP_INDEX));
 	if (file->isOpen()) {
 		RomData *romData = RomDataFactory::create(file);
 		if (romData && romData->isValid()) {
@@ -253,6 +259,45 @@ static void PrintPathnames(void)
 	cout << endl;
 }
 
+/**
+ * Remove least-recently-used files from the download cache.
+ * @param budget Cache budget.
+ * @return 0 on success; non-zero on error.
+ */
+static int DoCacheMaintenance(const CacheMaintenance::Budget &budget)
+{
+	if (budget.maxBytes == 0 && budget.maxFiles == 0) {
+		cerr << C_("rpcli", "No cache size limit is set. Use -m or -n, or set MaxCacheSize or MaxCacheFiles in rom-properties.conf.") << endl;
+		return EXIT_FAILURE;
+	}
+
+	// Run the maintenance pass in time slices,
+	// the same way CacheManager does it.
+	CacheMaintenance maint;
+	maint.setBudget(budget);
+	int ret;
+	do {
+		ret = maint.step(100);
+	} while (ret > 0);
+	if (ret < 0) {
+		cerr << rp_sprintf(C_("rpcli", "Cache maintenance failed: %s"), strerror(-ret)) << endl;
+		return EXIT_FAILURE;
+	}
+
+	const CacheMaintenance::Stats &stats = maint.stats();
+	cout << rp_sprintf("Cache directory:  ") << FileSystem::getCacheDirectory() << endl;
+	cout << rp_sprintf("Cached files:     %u (%s)", stats.totalFiles,
+		LibRpBase::formatFileSize(stats.totalBytes).c_str()) << endl;
+	cout << rp_sprintf("Removed files:    %u (%s reclaimed)", stats.removedFiles,
+		LibRpBase::formatFileSize(stats.reclaimedBytes).c_str()) << endl;
+	cout << rp_sprintf("Skipped files:    %u", stats.skippedFiles) << endl;
+	cout << rp_sprintf("Elapsed time:     %u.%03u ms in %u slice(s)",
+		static_cast<unsigned int>(stats.elapsed_us / 1000),
+		static_cast<unsigned int>(stats.elapsed_us % 1000), stats.slices) << endl;
+	cout << endl;
+	return 0;
+}
+
 #ifdef RP_OS_SCSI_SUPPORTED
 /**
  * Run a SCSI INQUIRY command on a device.
@@ -317,8 +362,24 @@ static void DoAtaIdentifyDevice(const char *filename, bool json)
 
 int RP_C_API main(int argc, char *argv[])
 {
+	// Check for cache maintenance mode first, since it's the
+	// only mode that needs to remove and rename files.
+	bool cacheMaint = false;
+	for (int i = 1; i < argc; i++) {
+		if (argv[i][0] == '-' && argv[i][1] == 'e') {
+			cacheMaint = true;
+			break;
+		}
+	}
+
 	// Enable security options.
-	rpcli_do_security_options();
+	rpcli_do_security_options(cacheMaint);
+#ifdef HAVE_SECCOMP
+	// The seccomp filter only allows removing and renaming files in
+	// cache maintenance mode, so gzip indexes can't be saved otherwise.
+	// Existing indexes are still loaded.
+	GzIndexedReader::setIndexCacheWritable(cacheMaint);
+#endif /* HAVE_SECCOMP */
 
 	// Set the C and C++ locales.
 	locale::global(locale(""));
@@ -345,9 +406,13 @@ int RP_C_API main(int argc, char *argv[])
 	if(argc < 2){
 #ifdef ENABLE_DECRYPTION
 		cerr << C_("rpcli", "Usage: rpcli [-k] [-c] [-p] [-j] [-l lang] [[-x[b]N outfile]... [-a apngoutfile] filename]...") << endl;
+		cerr << C_("rpcli", "       rpcli -b [-t threads] [-u] [-l lang] [path]...") << endl;
+		cerr << C_("rpcli", "       rpcli -e [-m size] [-n files]") << endl;
 		cerr << "  -k:   " << C_("rpcli", "Verify encryption keys in keys.conf.") << endl;
 #else /* !ENABLE_DECRYPTION */
 		cerr << C_("rpcli", "Usage: rpcli [-c] [-p] [-j] [-l lang] [[-x[b]N outfile]... [-a apngoutfile] filename]...") << endl;
+		cerr << C_("rpcli", "       rpcli -b [-t threads] [-u] [-l lang] [path]...") << endl;
+		cerr << C_("rpcli", "       rpcli -e [-m size] [-n files]") << endl;
 #endif /* ENABLE_DECRYPTION */
 		cerr << "  -c:   " << C_("rpcli", "Print system region information.") << endl;
 		cerr << "  -p:   " << C_("rpcli", "Print system path information.") << endl;
@@ -356,6 +421,17 @@ int RP_C_API main(int argc, char *argv[])
 		cerr << "  -xN:  " << C_("rpcli", "Extract image N to outfile in PNG format.") << endl;
 		cerr << "  -a:   " << C_("rpcli", "Extract the animated icon to outfile in APNG format.") << endl;
 		cerr << endl;
+		cerr << "Batch mode:" << endl;
+		cerr << "  -b:   " << C_("rpcli", "Process files in parallel and output one line of JSON per file.") << endl;
+		cerr << "        " << C_("rpcli", "Directories are scanned recursively. '-' reads paths from stdin.") << endl;
+		cerr << "  -t:   " << C_("rpcli", "Maximum number of threads. (default is one per CPU)") << endl;
+		cerr << "  -u:   " << C_("rpcli", "Output results as they're completed instead of in input order.") << endl;
+		cerr << endl;
+		cerr << "Cache maintenance:" << endl;
+		cerr << "  -e:   " << C_("rpcli", "Remove least-recently-used files from the download cache.") << endl;
+		cerr << "  -m:   " << C_("rpcli", "Maximum cache size, in MiB. (default is MaxCacheSize)") << endl;
+		cerr << "  -n:   " << C_("rpcli", "Maximum number of cached files. (default is MaxCacheFiles)") << endl;
+		cerr << endl;
 #ifdef RP_OS_SCSI_SUPPORTED
 		cerr << "Special options for devices:" << endl;
 		cerr << "  -is:   " << C_("rpcli", "Run a SCSI INQUIRY command.") << endl;
@@ -367,6 +443,8 @@ int RP_C_API main(int argc, char *argv[])
 		cerr << "\t " << C_("rpcli", "displays info about s3.gen") << endl;
 		cerr << "* rpcli -x0 icon.png pokeb2.nds" << endl;
 		cerr << "\t " << C_("rpcli", "extracts icon from pokeb2.nds") << endl;
+		cerr << "* find roms/ -name '*.nds' | rpcli -b -" << endl;
+		cerr << "\t " << C_("rpcli", "outputs info about all .nds files in roms/") << endl;
 	}
 	
 	assert(RomData::IMG_INT_MIN == 0);
@@ -374,12 +452,24 @@ int RP_C_API main(int argc, char *argv[])
 	bool json = false;
 	vector<ExtractParam> extract;
 
-	for (int i = 1; i < argc; i++) { // figure out the json mode in advance
+	// Batch mode parameters
+	bool batch = false;
+	BatchParams batchParams;
+	vector<const char*> batchPaths;
+
+	// Cache maintenance parameters
+	CacheMaintenance::Budget cacheBudget;
+	CacheMaintenance::getConfigBudget(&cacheBudget);
+
+	for (int i = 1; i < argc; i++) { // figure out the json and batch modes in advance
 		if (argv[i][0] == '-' && argv[i][1] == 'j') {
 			json = true;
+		} else if (argv[i][0] == '-' && argv[i][1] == 'b') {
+			batch = true;
 		}
 	}
-	if (json) cout << "[\n";
+	// NOTE: Batch mode uses NDJSON, which doesn't have an enclosing array.
+	if (json && !batch) cout << "[\n";
 
 #ifdef RP_OS_SCSI_SUPPORTED
 	bool inq_scsi = false;
@@ -389,7 +479,7 @@ int RP_C_API main(int argc, char *argv[])
 	bool first = true;
 	int ret = 0;
 	for (int i = 1; i < argc; i++){
-		if (argv[i][0] == '-'){
+		if (argv[i][0] == '-' && !(batch && argv[i][1] == '\0')){
 			switch (argv[i][1]) {
 #ifdef ENABLE_DECRYPTION
 			case 'k': {
@@ -457,6 +547,70 @@ int RP_C_API main(int argc, char *argv[])
 				break;
 			case 'j': // do nothing
 				break;
+			case 'b': // do nothing
+				break;
+			case 't': {
+				// Maximum number of threads for batch mode.
+				const char *s_threads;
+				if (argv[i][2] == '\0') {
+					// Separate argument.
+					s_threads = argv[i+1];
+					i++;
+				} else {
+					// Same argument.
+					s_threads = &argv[i][2];
+				}
+				if (!s_threads) {
+					break;
+				}
+
+				char *endptr = nullptr;
+				const long threads = strtol(s_threads, &endptr, 10);
+				if (*endptr != '\0' || threads < 0) {
+					cerr << rp_sprintf(C_("rpcli", "Warning: ignoring invalid thread count '%s'"), s_threads) << endl;
+					break;
+				}
+				batchParams.threads = static_cast<unsigned int>(threads);
+				break;
+			}
+			case 'u':
+				// Unordered batch output.
+				batchParams.ordered = false;
+				break;
+			case 'e':
+				// Download cache maintenance.
+				cacheMaint = true;
+				break;
+			case 'm':
+			case 'n': {
+				// Cache budget for cache maintenance.
+				const char opt = argv[i][1];
+				const char *s_value;
+				if (argv[i][2] == '\0') {
+					// Separate argument.
+					s_value = argv[i+1];
+					i++;
+				} else {
+					// Same argument.
+					s_value = &argv[i][2];
+				}
+				if (!s_value) {
+					break;
+				}
+
+				char *endptr = nullptr;
+				const long long value = strtoll(s_value, &endptr, 10);
+				if (*endptr != '\0' || value < 0 || (opt == 'n' && value > UINT32_MAX)) {
+					cerr << rp_sprintf(C_("rpcli", "Warning: ignoring invalid cache limit '%s'"), s_value) << endl;
+					break;
+				}
+				if (opt == 'm') {
+					cacheBudget.maxBytes = static_cast<uint64_t>(value) * 1024U * 1024U;
+				} else {
+					cacheBudget.maxFiles = static_cast<uint32_t>(value);
+				}
+				break;
+			}
 #ifdef RP_OS_SCSI_SUPPORTED
 			case 'i':
 				// TODO: Check if a SCSI implementation is available for this OS?
@@ -474,6 +628,9 @@ int RP_C_API main(int argc, char *argv[])
 				cerr << rp_sprintf(C_("rpcli", "Warning: skipping unknown switch '%c'"), argv[i][1]) << endl;
 				break;
 			}
+		} else if (batch) {
+			// Batch mode. Files are processed after all options are parsed.
+			batchPaths.push_back(argv[i]);
 		} else {
 			if (first) first = false;
 			else if (json) cout << "," << endl;
@@ -500,6 +657,23 @@ int RP_C_API main(int argc, char *argv[])
 			extract.clear();
 		}
 	}
-	if (json) cout << "]\n";
+
+	if (cacheMaint) {
+		const int cm_ret = DoCacheMaintenance(cacheBudget);
+		if (ret == 0) {
+			ret = cm_ret;
+		}
+	}
+
+	if (batch) {
+		// If no paths were specified, read them from stdin.
+		if (batchPaths.empty()) {
+			batchPaths.push_back("-");
+		}
+		batchParams.languageCode = languageCode;
+		ret = DoBatch(batchPaths, batchParams);
+	}
+
+	if (json && !batch) cout << "]\n";
 	return ret;
 }
@@ -9,23 +9,47 @@
 #include "stdafx.h"
 #include "rpcli_secure.h"
 #include "librpsecure/os-secure.h"
+#include "common.h"	// ARRAY_SIZE()
 
 /**
  * Enable security options.
+ * @param cacheMaint True for cache maintenance mode. (-e)
  * @return 0 on success; negative POSIX error code on error.
  */
-int rpcli_do_security_options(void)
+int rpcli_do_security_options(bool cacheMaint)
 {
 	// Set OS-specific security options.
 	rp_secure_param_t param;
 #if defined(_WIN32)
+	((void)cacheMaint);
 	param.bHighSec = FALSE;
 #elif defined(HAVE_SECCOMP)
-	static const int syscall_wl[] = {
+	static const int syscall_wl_common[] = {
 		// Syscalls used by rp-download.
 		// TODO: Add more syscalls.
 		// FIXME: glibc-2.31 uses 64-bit time syscalls that may not be
 		// defined in earlier versions, including Ubuntu 14.04.
+
+		// NOTE: Special case for clone(). If it's the first syscall
+		// in the list, it has a parameter restriction added that
+		// ensures it can only be used to create threads.
+		SCMP_SYS(clone),
+		// Other multi-threading syscalls
+		// (ThreadPool: parallel image decoding and batch mode)
+		SCMP_SYS(set_robust_list),
+		SCMP_SYS(madvise),		// freeing thread stacks
+		SCMP_SYS(sched_getaffinity),	// sysconf(_SC_NPROCESSORS_ONLN)
+#if defined(__SNR_rseq) || defined(__NR_rseq)
+		SCMP_SYS(rseq),			// glibc-2.35
+#endif /* __SNR_rseq || __NR_rseq */
+
+		// Batch mode
+		SCMP_SYS(getdents), SCMP_SYS(getdents64),	// readdir()
+		SCMP_SYS(clock_gettime),
+#if defined(__SNR_clock_gettime64) || defined(__NR_clock_gettime64)
+		SCMP_SYS(clock_gettime64),
+#endif /* __SNR_clock_gettime64 || __NR_clock_gettime64 */
+
 		SCMP_SYS(close),
 		SCMP_SYS(dup),		// gzdopen()
 		SCMP_SYS(fstat),     SCMP_SYS(fstat64),		// __GI___fxstat() [printf()]
@@ -37,6 +61,7 @@ int rpcli_do_security_options(void)
 		SCMP_SYS(ioctl),	// for devices; also afl-fuzz
 		SCMP_SYS(lseek), SCMP_SYS(_llseek),
 		SCMP_SYS(lstat), SCMP_SYS(lstat64),	// LibRpBase::FileSystem::is_symlink(), resolve_symlink()
+		SCMP_SYS(mkdir), SCMP_SYS(mkdirat),	// LibRpFile::FileSystem::rmkdir() [gzip index cache]
 		SCMP_SYS(mmap), SCMP_SYS(mmap2),
 		SCMP_SYS(mprotect),	// dlopen()
 		SCMP_SYS(munmap),
@@ -68,8 +93,30 @@ int rpcli_do_security_options(void)
 
 		-1	// End of whitelist
 	};
+
+	// Cache maintenance (-e) removes files and rewrites the cache index.
+	// Other modes don't need to remove or rename files.
+	static const int syscall_wl_cacheMaint[] = {
+		SCMP_SYS(unlink), SCMP_SYS(unlinkat),	// LibRpFile::FileSystem::delete_file()
+		SCMP_SYS(rename), SCMP_SYS(renameat),	// LibRpFile::FileSystem::rename_file() [CacheIndex]
+#if defined(__SNR_renameat2) || defined(__NR_renameat2)
+		SCMP_SYS(renameat2),
+#endif /* __SNR_renameat2 || __NR_renameat2 */
+		SCMP_SYS(flock),			// CacheIndex::commit()
+	};
+
+	// Build the whitelist.
+	int syscall_wl[ARRAY_SIZE(syscall_wl_common) + ARRAY_SIZE(syscall_wl_cacheMaint)];
+	size_t count = ARRAY_SIZE(syscall_wl_common) - 1;
+	memcpy(syscall_wl, syscall_wl_common, count * sizeof(int));
+	if (cacheMaint) {
+		memcpy(&syscall_wl[count], syscall_wl_cacheMaint, sizeof(syscall_wl_cacheMaint));
+		count += ARRAY_SIZE(syscall_wl_cacheMaint);
+	}
+	syscall_wl[count] = -1;
 	param.syscall_wl = syscall_wl;
 #elif defined(HAVE_PLEDGE)
+	((void)cacheMaint);
 	// Promises:
 	// - stdio: General stdio functionality.
 	// - rpath: Read from ~/.config/rom-properties/ and ~/.cache/rom-properties/
@@ -78,8 +125,10 @@ int rpcli_do_security_options(void)
 	// - getpw: Get user's home directory if HOME is empty.
 	param.promises = "stdio rpath wpath cpath getpw";
 #elif defined(HAVE_TAME)
+	((void)cacheMaint);
 	param.tame_flags = TAME_STDIO | TAME_RPATH | TAME_WPATH | TAME_CPATH | TAME_GETPW;
 #else
+	((void)cacheMaint);
 	param.dummy = 0;
 #endif
 	return rp_secure_enable(param);
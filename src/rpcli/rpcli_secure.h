@@ -9,15 +9,18 @@
 #ifndef __ROMPROPERTIES_RPCLI_RPCLI_SECURE_H__
 #define __ROMPROPERTIES_RPCLI_RPCLI_SECURE_H__
 
+#include "stdboolx.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
  * Enable security options.
+ * @param cacheMaint True for cache maintenance mode. (-e)
  * @return 0 on success; negative POSIX error code on error.
  */
-int rpcli_do_security_options(void);
+int rpcli_do_security_options(bool cacheMaint);
 
 #ifdef __cplusplus
 }
@@ -571,6 +571,12 @@ int CacheTabPrivate::recursiveScan(const TCHAR *path, list<pair<tstring, DWORD>
 	tstring findFilter(path);
 	findFilter += _T("\\*");
 
+	// gzidx\ contains gzip index files. (GzIndexedReader)
+	// romdata\ contains cached RomData fields. (RomDataCache)
+	const size_t pathLen = _tcslen(path);
+	const bool isGzIdxDir = (pathLen > 6 && !_tcsicmp(&path[pathLen-6], _T("\\gzidx")));
+	const bool isRomDataDir = (pathLen > 8 && !_tcsicmp(&path[pathLen-8], _T("\\romdata")));
+
 	WIN32_FIND_DATA findFileData;
 	HANDLE hFindFile = FindFirstFile(findFilter.c_str(), &findFileData);
 	if (!hFindFile || hFindFile == INVALID_HANDLE_VALUE) {
@@ -596,6 +602,13 @@ int CacheTabPrivate::recursiveScan(const TCHAR *path, list<pair<tstring, DWORD>
 			if (!_tcsicmp(findFileData.cFileName, _T("Thumbs.db")))
 				goto isok;
 
+			// Cache index file and its lock file. (CacheIndex)
+			if (!_tcsicmp(findFileData.cFileName, _T("index.bin")) ||
+			    !_tcsicmp(findFileData.cFileName, _T("index.lock")))
+			{
+				goto isok;
+			}
+
 			// Check the extension.
 			len = _tcslen(findFileData.cFileName);
 			if (len <= 4) {
@@ -605,15 +618,32 @@ int CacheTabPrivate::recursiveScan(const TCHAR *path, list<pair<tstring, DWORD>
 			}
 
 			pExt = &findFileData.cFileName[len-4];
-			if (_tcsicmp(pExt, _T(".png")) != 0 &&
-			    _tcsicmp(pExt, _T(".jpg")) != 0)
+			if (!_tcsicmp(pExt, _T(".png")) || !_tcsicmp(pExt, _T(".jpg")))
+				goto isok;
+
+			// gzip index files, including temporary files
+			// that are left behind if a write is interrupted.
+			if (isGzIdxDir && (!_tcsicmp(pExt, _T(".idx")) || !_tcsicmp(pExt, _T(".tmp"))))
+				goto isok;
+
+			// RomDataCache files, including temporary files
+			// and the prune timestamp.
+			if (isRomDataDir && (!_tcsicmp(pExt, _T(".bin")) || !_tcsicmp(pExt, _T(".tmp")) ||
+			                     !_tcsicmp(findFileData.cFileName, _T("prune.stamp"))))
 			{
-				// Extension is not valid.
-				FindClose(hFindFile);
-				return -EIO;
+				goto isok;
+			}
+
+			// Temporary cache index files: "index.bin.*.tmp"
+			if (!_tcsicmp(pExt, _T(".tmp")) && len > 10 &&
+			    !_tcsnicmp(findFileData.cFileName, _T("index.bin."), 10))
+			{
+				goto isok;
 			}
 
-			// All checks pass.
+			// Extension is not valid.
+			FindClose(hFindFile);
+			return -EIO;
 		}
 	isok:
 